@@ -1,199 +1,326 @@
 //ARRAY simple operations
+//
+//The array is a gap buffer: one allocation holding the elements before the
+//cursor at its start, the elements after it at its end, and the free room
+//(the gap) in between. Inserting or deleting at the cursor is O(1); an edit
+//elsewhere first moves the gap there with one memmove of the elements in
+//between, so edits near each other stay cheap. When the gap is used up the
+//buffer doubles. Sorting and searching close the gap at the end first, so
+//the elements are one plain array again.
+//
+//Run with --bench N to time N inserts near a slowly moving cursor against
+//an array that shifts its whole tail on every insert.
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "Eytzinger.h"
+#include "SimdSearch.h"
 
-int arr[100],i,j,position,n,element,choice;
+#define MIN_CAPACITY 16
 
-void menu();
+struct gap_array{
+    int *buf;
+    int capacity;
+    int gap_start,gap_end;  //buf[gap_start..gap_end) is free
+};
+
+struct gap_array arr;
+int position,element;
+
+int length(struct gap_array *a){
+    return a->capacity-(a->gap_end-a->gap_start);
+}
+
+//moves the gap so that it starts at position pos
+void move_gap(struct gap_array *a,int pos){
+    if(pos<a->gap_start){
+        int k=a->gap_start-pos;
+        memmove(a->buf+a->gap_end-k,a->buf+pos,k*sizeof(int));
+        a->gap_start-=k;
+        a->gap_end-=k;
+    }
+    else if(pos>a->gap_start){
+        int k=pos-a->gap_start;
+        memmove(a->buf+a->gap_start,a->buf+a->gap_end,k*sizeof(int));
+        a->gap_start+=k;
+        a->gap_end+=k;
+    }
+}
+
+//doubles the buffer; the elements after the gap move to the new end
+int grow(struct gap_array *a){
+    int capacity=a->capacity ? 2*a->capacity : MIN_CAPACITY;
+    int after=a->capacity-a->gap_end;
+    int *buf=realloc(a->buf,capacity*sizeof(int));
+    if(buf==NULL)
+        return -1;
+    memmove(buf+capacity-after,buf+a->gap_end,after*sizeof(int));
+    a->buf=buf;
+    a->gap_end=capacity-after;
+    a->capacity=capacity;
+    return 0;
+}
+
+//puts x at position pos (0 .. length), shifting the rest up
+int insert_at(struct gap_array *a,int pos,int x){
+    if(a->gap_start==a->gap_end && grow(a)!=0)
+        return -1;
+    move_gap(a,pos);
+    a->buf[a->gap_start++]=x;
+    return 0;
+}
+
+//takes out the element at position pos (0 .. length-1)
+void delete_at(struct gap_array *a,int pos){
+    move_gap(a,pos);
+    a->gap_end++;
+}
+
+int *at(struct gap_array *a,int pos){
+    return a->buf+(pos<a->gap_start ? pos : pos+a->gap_end-a->gap_start);
+}
+
+//closes the gap at the end and returns the elements as one array
+int *flatten(struct gap_array *a){
+    move_gap(a,length(a));
+    return a->buf;
+}
+
+int read_int(int *x){
+    if(scanf("%d",x)!=1){
+        printf("\n");
+        exit(0);  //end of input
+    }
+    return *x;
+}
 
 void insertion(){
     printf("ENTER THE POSITION YOU WANT TO ENTER THE ELEMENT");
-    scanf("%d",&position);
+    read_int(&position);
     position=position-1;
-    if(position>n-1){
+    if(position<0 || position>length(&arr)){
         printf("\n INVALID POSITION\n");
-        menu();
+        return;
     }
     printf("ENTER THE ELEMENT ");
-    scanf("%d",&element);
-    for(i=n;i>=position;i--){
-        arr[i+1]=arr[i];
-    }
-    arr[position]=element;
-    n=n+1;
-    menu();
+    read_int(&element);
+    if(insert_at(&arr,position,element)!=0)
+        printf("\n OUT OF MEMORY\n");
 }
 
 void traversing(){
+    int i,n=length(&arr);
     printf("\n THE ARRAY ENTERED IS:--\n");
     for(i=0;i<n;i++){
-       printf("%d\t",*(arr+i));
+       printf("%d\t",*at(&arr,i));
     }
-    menu();
 }
 
 void deletion(){
     printf("ENTER THE POSITION OF THE ELEMENT TO BE DELETED");
-    scanf("%d",&position);
+    read_int(&position);
     position=position-1;
-        if(position>n-1){
+    if(position<0 || position>length(&arr)-1){
         printf("\n INVALID POSITION\n");
-        menu();
-    }
-    for(i=position;i<n;i++){
-        arr[i]=arr[i+1];
+        return;
     }
+    delete_at(&arr,position);
     printf("ELEMENT IS DELETED!!!\n");
-    n=n-1;
-    menu();
 }
 
 void updation(){
     printf("ENTER THE POSITION WHERE U WANT TO UPDATE");
-    scanf("%d",&position);
-    if(position>n){
+    read_int(&position);
+    position=position-1;
+    if(position<0 || position>length(&arr)-1){
         printf("\n INVALID POSITION\n");
-        menu();
+        return;
     }
     printf("\n ENTER THE ELEMENT :-");
-    scanf("%d",&element);
-    arr[position]=element;
-
+    read_int(&element);
+    *at(&arr,position)=element;
 }
 
 void linear_search(){
+    int i,n=length(&arr);
     printf("ENTER THE ELEMENT YOU WANT TO SEARCH\n");
-    scanf("%d",&element);
-    for(i=0;i<n;i++){
-        if(arr[i] == element){
-            printf("ELEMENT FOUND AT THE POSITION %d\n\n",i+1);
-            choice=20;
-            break;
-        }
-    }
-    if(choice!=20){
-        printf("\nELEMNT NOT FOUND!!!");
+    read_int(&element);
+    i=(int)simdFind(flatten(&arr),n,element);
+    if(i<n){
+        printf("ELEMENT FOUND AT THE POSITION %d\n\n",i+1);
+        return;
     }
-    menu();
+    printf("\nELEMNT NOT FOUND!!!");
 }
-bubble_sort_algo(){
+
+void bubble_sort_algo(){
+    int i,j,t,n=length(&arr);
+    int *a=flatten(&arr);
     for(i=0;i<n;i++){
         for(j=0;j<n-i-1;j++){
-            if(arr[j] > arr[j+1]){
-                arr[j]=arr[j]+arr[j+1];
-                arr[j+1]=arr[j]-arr[j+1];
-                arr[j]=arr[j]-arr[j+1];
+            if(a[j] > a[j+1]){
+                t=a[j];
+                a[j]=a[j+1];
+                a[j+1]=t;
             }
         }
     }
 }
+
 void bubble_sort(){
     bubble_sort_algo();
     printf("\nTHE ARRAY HAS BEEN SORTED\n");
-    menu();
 }
 
+//searches the sorted array through an Eytzinger index (Eytzinger.h), which
+//is what to keep around when one array gets searched many times
 void binary_search(){
+    EytzingerIndex index;
+    size_t rank;
+    int *a;
     printf("ENTER THE ELEMENT YOU WANT TO SEARCH\n");
-    scanf("%d",&element);
-    int beg,mid,end,check;
-    check=0;
-    beg=0;
-    end=n-1;
+    read_int(&element);
     bubble_sort_algo();
-    while(beg<=end){
-        mid=(beg+end)/2;
-        if(arr[mid]==element){
-            printf("ELEMENT FOUND AT POSITION: %d, AFTER THE SORTING",mid+1);
-            check=10;
-            break;
-        }
-        else if(arr[mid]>element){
-            end = mid-1;
-        }
-        else if(arr[mid]<element){
-            beg = mid+1;
-        }
+    a=flatten(&arr);
+    if(eytzingerBuild(&index,a,length(&arr))!=0){
+        printf("\n OUT OF MEMORY\n");
+        return;
     }
-    if(check!=10){
+    rank=eytzingerLowerBound(&index,element);
+    if(rank<index.n && a[rank]==element)
+        printf("ELEMENT FOUND AT POSITION: %d, AFTER THE SORTING",(int)rank+1);
+    else
         printf("ELEMENT NOT FOUND IN THE ARRAY!!!");
-    }
-    menu();
+    eytzingerFree(&index);
 }
 
-selection_sort(){
+void selection_sort(){
+    int i,j,t,n=length(&arr);
+    int *a=flatten(&arr);
     for(i=0;i<n-1;i++){
         for(j=i+1;j<n;j++){
-            if(arr[i]>arr[j]){
-                arr[i]=arr[i]+arr[j];
-                arr[j]=arr[i]-arr[j];
-                arr[i]=arr[i]-arr[j];
+            if(a[i]>a[j]){
+                t=a[i];
+                a[i]=a[j];
+                a[j]=t;
             }
         }
     }
     printf("ARRAY IS SORTED");
-    menu();
 }
 
+void create(){
+    int choice;
+    free(arr.buf);
+    memset(&arr,0,sizeof arr);
+    printf("ENTER THE ELEMENTS OF ARRAY");
+    do{
+        printf("\nENTER THE ELEMENT:-\n");
+        read_int(&element);
+        if(insert_at(&arr,length(&arr),element)!=0){
+            printf("\n OUT OF MEMORY\n");
+            exit(1);
+        }
+        printf("\nDO YOU WANT TO ENTER ANOTHER ELEMENT PRESS ANY KEY ELSE PRESS 1\n");
+        read_int(&choice);
+    }while(choice!=1);
+}
 
+//a loop, not a function calling itself, so the stack does not grow
 void menu(){
-       while(1){
-            printf("\n1. INSERTION\t 2. UPDATION\t 3. TRAVERSING\t 4. DELETION\t 5.EXIT\t 6. RECREATE THE ARRAY \n");
-            printf("7. LINEAR SEARCH\t 8. BUBBLE SORT\t 9. BINARY SEARCH\t 10. SELECTION SORT\n\n");
-            scanf("%d",&choice);
-            switch(choice){
-                case 1:
-                    insertion();
-                    break;
-                case 2:
-                    updation();
-                    break;
-                case 3:
-                    traversing();
-                    break;
-                case 4:
-                    deletion();
-                    break;
-                case 5:
-                    exit(1);
-                case 6:
-                    main();
-                    break;
-                case 7:
-                    linear_search();
-                    break;
-                case 8:
-                    bubble_sort();
-                    break;
-                case 9:
-                    binary_search();
-                    break;
-                case 10:
-                    selection_sort();
-                    break;
-                default:
-                    menu();
-                    break;
-            }
+    int choice;
+    while(1){
+        printf("\n1. INSERTION\t 2. UPDATION\t 3. TRAVERSING\t 4. DELETION\t 5.EXIT\t 6. RECREATE THE ARRAY \n");
+        printf("7. LINEAR SEARCH\t 8. BUBBLE SORT\t 9. BINARY SEARCH\t 10. SELECTION SORT\n\n");
+        read_int(&choice);
+        switch(choice){
+            case 1:
+                insertion();
+                break;
+            case 2:
+                updation();
+                break;
+            case 3:
+                traversing();
+                break;
+            case 4:
+                deletion();
+                break;
+            case 5:
+                free(arr.buf);
+                exit(1);
+            case 6:
+                create();
+                break;
+            case 7:
+                linear_search();
+                break;
+            case 8:
+                bubble_sort();
+                break;
+            case 9:
+                binary_search();
+                break;
+            case 10:
+                selection_sort();
+                break;
         }
-
+    }
 }
 
-int main(){
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
 
-    printf("ENTER THE ELEMENTS OF ARRAY");
-    i=0;
-    while(1){
-    printf("\nENTER THE ELEMENT:-\n");
-    scanf("%d",arr+i);
-    printf("\nDO YOU WANT TO ENTER ANOTHER ELEMENT PRESS ANY KEY ELSE PRESS 1\n");
-    scanf("%d",&choice);
-    if(choice == 1){
-        n=i+1;
-        menu();
+//a document of n elements, then n inserts at a cursor that starts in its
+//middle and drifts a few places each time, into the gap buffer and into a
+//plain array that shifts everything after the cursor
+int bench(int n){
+    struct gap_array g={NULL,0,0,0};
+    int *plain=malloc(2*(size_t)n*sizeof(int));
+    int i,k,cursor,len,differ;
+    double t[2];
+    if(n<1 || plain==NULL){
+        printf("USAGE: --bench N, N >= 1\n");
+        return 1;
     }
-    i++;
-   }
+    for(k=0;k<2;k++){
+        unsigned seed=1;
+        for(len=0;len<n;len++)
+            if(k==0 ? insert_at(&g,len,-len)!=0 : (plain[len]=-len,0))
+                return 1;
+        t[k]=now();
+        for(i=0,cursor=n/2;i<n;i++,len++){
+            seed=seed*1103515245+12345;
+            cursor+=(int)(seed>>16)%9-3;  //mostly forward, like typing
+            cursor=cursor<0 ? 0 : cursor>len ? len : cursor;
+            if(k==0){
+                if(insert_at(&g,cursor,i)!=0)
+                    return 1;
+            }
+            else{
+                memmove(plain+cursor+1,plain+cursor,(len-cursor)*sizeof(int));
+                plain[cursor]=i;
+            }
+        }
+        t[k]=now()-t[k];
+    }
+    printf("%d inserts: gap buffer %.3f s, shifting array %.3f s\n",n,t[0],t[1]);
+    differ=memcmp(flatten(&g),plain,2*(size_t)n*sizeof(int))!=0;
+    if(differ)
+        printf("THE ARRAYS DIFFER\n");
+    free(g.buf);
+    free(plain);
+    return differ;
+}
 
-   return 0;
+int main(int argc,char *argv[]){
+    if(argc>2 && strcmp(argv[1],"--bench")==0)
+        return bench(atoi(argv[2]));
+    create();
+    menu();
+    return 0;
 }
@@ -1,8 +1,155 @@
 #include <stdio.h>
-int main(){
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Rational.h"
+#include "Random.h"
+
+/*
+ * Run with --sum to add up the fractions on stdin, written "p/q" (or "p")
+ * and separated by white space, and print the exact sum in lowest terms and
+ * its value. --bench N times three ways of adding N fractions.
+ */
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int sum(void)
+{
+	size_t n = 0, cap = 1024;
+	int64_t *num = malloc(cap * sizeof *num);
+	uint64_t *den = malloc(cap * sizeof *den);
+	long long p, q;
+	char text[RAT_TEXT];
+	Rational total;
+	int got;
+	if (num == NULL || den == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	while ((got = scanf("%lld", &p)) == 1) {
+		q = 1;
+		if (scanf("/%lld", &q) == 1 && q == 0) {
+			fprintf(stderr, "Zero denominator in term %zu\n", n + 1);
+			return 1;
+		}
+		if (q < 0) {
+			p = -p;
+			q = -q;
+		}
+		if (n == cap) {
+			cap *= 2;
+			num = realloc(num, cap * sizeof *num);
+			den = realloc(den, cap * sizeof *den);
+			if (num == NULL || den == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				return 1;
+			}
+		}
+		num[n] = p;
+		den[n++] = (uint64_t)q;
+	}
+	if (got != EOF) {
+		fprintf(stderr, "Not a fraction after term %zu\n", n);
+		return 1;
+	}
+	if (ratSum(num, den, n, &total) != 0) {
+		fprintf(stderr, "The sum does not fit 128 bits\n");
+		return 1;
+	}
+	ratFormat(&total, text);
+	printf("%s = %.17g\n", text, ratToDouble(&total));
+	free(num);
+	free(den);
+	return 0;
+}
+
+static int bench(size_t n)
+{
+	// probabilities of dice and cards: denominators that divide 720720,
+	// the lcm of 1 .. 16
+	static const uint64_t sizes[] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 36, 52, 720, 1001, 720720};
+	int64_t *num = malloc(n * sizeof *num);
+	uint64_t *den = malloc(n * sizeof *den);
+	char text[RAT_TEXT];
+	Rational r, term, s;
+	Xoshiro256 rng;
+	double t, best;
+	size_t i, overflowAt = 0;
+	int rep;
+	if (num == NULL || den == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	xoshiroSeed(&rng, 123);
+	for (i = 0; i < n; i++) {
+		den[i] = sizes[xoshiroBelow(&rng, sizeof sizes / sizeof *sizes)];
+		num[i] = xoshiroBelow(&rng, (uint32_t)den[i]);
+	}
+	printf("%zu fractions with denominators dividing 720720, best of 3\n", n);
+
+	// the way main() used to: cross-multiply and never reduce
+	{
+		long long p = 0, q = 1, x, y;
+		for (i = 0; i < n && !overflowAt; i++)
+			if (__builtin_mul_overflow(p, (long long)den[i], &x) || __builtin_mul_overflow(num[i], q, &y) ||
+			    __builtin_add_overflow(x, y, &p) || __builtin_mul_overflow(q, (long long)den[i], &q))
+				overflowAt = i + 1;
+		if (overflowAt)
+			printf("  cross-multiplied in 64 bits: overflows at term %zu\n", overflowAt);
+	}
+
+	best = 1e30;
+	for (rep = 0; rep < 3; rep++) {
+		t = now();
+		s.num = 0;
+		s.den = 1;
+		for (i = 0; i < n; i++) {
+			ratInit(&term, num[i], (int64_t)den[i]);
+			if (ratAdd(&s, &s, &term) != 0)
+				break;
+			ratNormalize(&s);
+		}
+		if ((t = now() - t) < best)
+			best = t;
+	}
+	printf("  ratAdd(), reduced every step %8.2f ns a term\n", best / n * 1e9);
+
+	best = 1e30;
+	for (rep = 0; rep < 3; rep++) {
+		t = now();
+		if (ratSum(num, den, n, &r) != 0) {
+			fprintf(stderr, "ratSum() overflowed\n");
+			return 1;
+		}
+		if ((t = now() - t) < best)
+			best = t;
+	}
+	printf("  ratSum()                     %8.2f ns a term\n", best / n * 1e9);
+	if (i < n || s.num != r.num || s.den != r.den) {
+		fprintf(stderr, "The sums differ\n");
+		return 1;
+	}
+	ratFormat(&r, text);
+	printf("  sum %s = %.17g\n", text, ratToDouble(&r));
+	free(num);
+	free(den);
+	return 0;
+}
+
+int main(int argc, char **argv){
 	/* variable declaration */
-	int numerator1, numerator2, denominator1, denominator2, 
-num_result, denom_result ;
+	int numerator1, numerator2, denominator1, denominator2;
+	Rational a, b, result;
+	char text[RAT_TEXT];
+	if (argc > 1 && strcmp(argv[1], "--sum") == 0)
+		return sum();
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoul(argv[2], NULL, 10));
 	/* Read each fraction */
 	printf("Please provide the first numerator:\n");
 	scanf("%d",&numerator1);
@@ -12,17 +159,13 @@ num_result, denom_result ;
         scanf("%d",&numerator2);
 	printf("Please provide the second denominator:\n");
 	scanf("%d",&denominator2);
-	/*compare the demonators*/
-	if ( denominator1 == denominator2 ) {
-		num_result = numerator1 + numerator2;
-		denom_result = denominator1; /*  or 2, they are equal */
-	} else {
-		num_result = (numerator1 * denominator2) + (numerator2 * denominator1 );
-		denom_result = denominator1 * denominator2;
-	}
-	printf("The result of %d / %d  + %d / %d  is: %d / %d \n", numerator1,denominator1, numerator2, denominator2,num_result,denom_result);
+	/* 64-bit terms cannot overflow 128 bits, but a denominator can be 0 */
+	if (ratInit(&a, numerator1, denominator1) != 0 || ratInit(&b, numerator2, denominator2) != 0) {
+		printf("A denominator cannot be 0\n");
+		return 1;
+	}
+	ratAdd(&result, &a, &b);
+	ratFormat(&result, text);
+	printf("The result of %d / %d  + %d / %d  is: %s \n", numerator1,denominator1, numerator2, denominator2,text);
 	return 0;
 }
-
-
-
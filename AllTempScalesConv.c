@@ -1,49 +1,114 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "TempScale.h"
 
-// Function that performs the conversion
+// Run with --csv COLUMN FROM TO [DECIMALS] to convert column COLUMN
+// (counting from 0) of a CSV file on stdin from scale FROM to scale TO,
+// each one of C, K, F or R, and write it to stdout. --bench N times
+// convertTemp() against tempConvert() on N values.
+
+// The scales of the menu: 1 Celsius, 2 Kelvin, 3 Fahrenheit
+static const int menuScales[4] = {-1, TEMP_CELSIUS, TEMP_KELVIN, TEMP_FAHRENHEIT};
+
+// Function that performs the conversion; finalScale 1 or 2 is the first
+// or the second of the other two scales, in the order above
 double convertTemp(double initValue, int initScale, int finalScale){
-    double finalValue;
-    switch(initScale){
-        // Celsius
-        case 1:
-            // Celsius to Kelvin
-            if(finalScale == 1){
-                finalValue = initValue + 273.15;
-            }
-            // Celsius to Fahrenheit
-            else if(finalScale == 2){
-                finalValue = (initValue * 9 / 5) + 32;
-            }
-            break;
-        case 2:
-            // Kelvin to Celsius
-            if(finalScale == 1){
-                finalValue = initValue - 273.15;
-            }
-            // Kelvin to Fahrenheit
-            else if(finalScale == 2){
-                finalValue = ((initValue - 273.15) * 9 / 5) + 32;
-            }
-            break;
-        case 3:
-            // Fahrenheit to Celsius
-            if(finalScale == 1){
-                finalValue = (initValue - 32) * 5 / 9;
-            }
-            // Fahrenheit to Kelvin
-            else if(finalScale == 2){
-                finalValue = ((initValue - 32) * 5 / 9) + 273,15;
-            }
-            break;
+    TempTransform t;
+    int to;
+    if(initScale < 1 || initScale > 3 || finalScale < 1 || finalScale > 2)
+        return 0;
+    to = finalScale < initScale ? finalScale : finalScale + 1;
+    tempTransform(menuScales[initScale], menuScales[to], &t);
+    return tempApply(t, initValue);
+}
+
+static double now(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int convert_csv(int argc, char *argv[]){
+    int from = tempScaleFromName(argv[3]), to = tempScaleFromName(argv[4]);
+    int decimals = argc > 5 ? atoi(argv[5]) : 2;
+    TempTransform t;
+    OutBuffer out;
+    if(tempTransform(from, to, &t) != 0){
+        fprintf(stderr, "Scales are C, K, F or R\n");
+        return 1;
+    }
+    if(outInit(&out, stdout, 0) != 0){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if((tempConvertCsv(stdin, &out, strtoul(argv[2], NULL, 10), t, decimals) | outClose(&out)) != 0){
+        fprintf(stderr, "Read or write error, or out of memory\n");
+        return 1;
+    }
+    return 0;
+}
 
+static int bench(size_t n){
+    double *x = malloc(n * sizeof *x), *y = malloc(n * sizeof *y), best[3] = {1e9, 1e9, 1e9}, t0, t1, t2, t3;
+    float *xf = malloc(n * sizeof *xf), *yf = malloc(n * sizeof *yf);
+    TempTransform t;
+    size_t i, bad = 0;
+    // read for every value, as scales that come with the data would be
+    volatile int from = 3, to = 1;
+    int rep;
+    if(x == NULL || y == NULL || xf == NULL || yf == NULL){
+        printf("Out of memory\n");
+        return 1;
+    }
+    for(i = 0; i < n; i++){
+        x[i] = (double)(i % 2000) / 10 - 50;
+        xf[i] = (float)x[i];
+    }
+    tempTransform(TEMP_FAHRENHEIT, TEMP_CELSIUS, &t);
+    // the best of three, the first of which also faults the outputs in
+    for(rep = 0; rep < 3; rep++){
+        t0 = now();
+        for(i = 0; i < n; i++)
+            y[i] = convertTemp(x[i], from, to);
+        t1 = now();
+        tempConvert(t, x, y, n);
+        t2 = now();
+        tempConvertFloats(t, xf, yf, n);
+        t3 = now();
+        best[0] = t1 - t0 < best[0] ? t1 - t0 : best[0];
+        best[1] = t2 - t1 < best[1] ? t2 - t1 : best[1];
+        best[2] = t3 - t2 < best[2] ? t3 - t2 : best[2];
     }
-    return finalValue;
+    for(i = 0; i < n; i++){
+        double c = (x[i] - 32) * 5 / 9;
+        bad += y[i] - c > 1e-12 || c - y[i] > 1e-12;
+    }
+    printf("%zu values F to C: convertTemp %.3f s, tempConvert %.3f s (%.0f M/s), floats %.3f s (%.0f M/s)%s\n",
+           n, best[0], best[1], n / best[1] / 1e6, best[2], n / best[2] / 1e6, bad ? " MISMATCH" : "");
+    free(x); free(y); free(xf); free(yf);
+    return bad != 0;
 }
 
-int main(){
+int main(int argc, char *argv[]){
+    // option: from, to, and the name of the result
+    static const struct { int from, to; const char *name; } options[7] = {
+        {0, 0, NULL},
+        {TEMP_CELSIUS, TEMP_KELVIN, "Kelvin"},
+        {TEMP_CELSIUS, TEMP_FAHRENHEIT, "Fahrenheit"},
+        {TEMP_KELVIN, TEMP_FAHRENHEIT, "Fahrenheit"},
+        {TEMP_KELVIN, TEMP_CELSIUS, "Celsius"},
+        {TEMP_FAHRENHEIT, TEMP_CELSIUS, "Celsius"},
+        {TEMP_FAHRENHEIT, TEMP_KELVIN, "Kelvin"},
+    };
     int option;
     double initialValue, finalValue;
+    TempTransform t;
+    if(argc >= 5 && argc <= 6 && strcmp(argv[1], "--csv") == 0)
+        return convert_csv(argc, argv);
+    if(argc == 3 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10));
     while(1){
         // main menu
         printf("\n0 - Exit\n");
@@ -55,44 +120,24 @@ int main(){
         printf("6 - Convert from Fahrenheit to Kelvin\n");
         
         printf("Select a number: ");
-        scanf("%d",&option);
-        if(!option){
+        if(scanf("%d",&option) != 1 || !option){
             printf("Ending program\n");
             return 0;
         }
+        if(option < 1 || option > 6)
+            continue;
 
         printf("Please enter the initial value: ");
-        scanf("%lf",&initialValue);
-        
-        switch(option){
-            case 1:
-                finalValue = convertTemp(initialValue,1,1);
-                printf("Valor em Kelvin: %.2lf",finalValue);
-                break;
-            case 2:
-                finalValue = convertTemp(initialValue,1,2);
-                printf("Valor em Fahrenheit: %.2lf",finalValue);
-                break;
-            case 3:
-                finalValue = convertTemp(initialValue,2,1);
-                printf("Valor em Celsius: %.2lf",finalValue);
-                break;
-            case 4:
-                finalValue = convertTemp(initialValue,2,2);
-                printf("Valor em Fahrenheit: %.2lf",finalValue);
-                break;
-            case 5:
-                finalValue = convertTemp(initialValue,3,1);
-                printf("Valor em Celsius: %.2lf",finalValue);
-                break;
-            case 6:
-                finalValue = convertTemp(initialValue,3,1);
-                printf("Valor em Kelvin: %.2lf",finalValue);
-                break;
-
+        if(scanf("%lf",&initialValue) != 1){
+            printf("Ending program\n");
+            return 0;
         }
+        
+        tempTransform(options[option].from, options[option].to, &t);
+        finalValue = tempApply(t, initialValue);
+        printf("Valor em %s: %.2lf",options[option].name,finalValue);
         printf("\n");
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,425 @@
+// Loan instalments (EMIs) and amortization schedules in bulk, for
+// SimpleEMICalculator.c and runs over a whole book of loans.
+//
+// The EMI of a loan of p over n months at a monthly rate r is
+// p r g / (g - 1) with g = (1 + r)^n. loanGrowth() works g out once, by
+// squaring: 1 + r squared once per bit of n and multiplied in where the
+// bit is set, about 2 log2(n) multiplies and no pow() call. A LoanBook
+// keeps its loans as separate arrays, one per field, so loanEmis() takes
+// LOAN_LANES loans side by side through the same squarings, a blend
+// choosing 1 + r or 1 per lane, with no branch on any one loan's term;
+// the compiler turns those loops into vector instructions (-O2 uses SSE2,
+// -march=native AVX2 or AVX-512). The order of the multiplies is the
+// same as in loanEmi(), so an EMI comes out the same either way.
+//
+// Books usually have a few dozen rates shared by millions of loans.
+// loanShareRates() finds the distinct ones and gives every loan its row
+// of a LoanRateTable, the factor r g / (g - 1) for that rate and every
+// term up to maxMonths, worked out once; an EMI is then one load and a
+// multiply. Loans longer than the table take the squarings.
+//
+// loanSchedule() writes one loan's schedule: the interest, the principal
+// and the balance left each month, the last payment clearing what is
+// left. The balance goes from month to month as p (1 + r) - EMI, one
+// FMA, with the interest and principal worked out beside it rather than
+// in the chain. loanCashflows() adds those up over the whole book, month
+// by month, LOAN_LANES loans at a time into sums kept per lane, so again
+// nothing depends on the lane next to it, with AVX and FMA in registers
+// eight loans to two vectors; a loan paid off sits at 0 and adds nothing
+// until the longest of its block is done. The loans go in chunks of
+// LOAN_CHUNK to the workers of pool (TaskPool.h), each chunk into its own
+// sums, which are then added in chunk order, so the totals do not depend
+// on the number of threads; pool may be NULL to stay on the calling
+// thread.
+//
+// A loan of 0 months is paid off at once; one at a rate of 0 in n equal
+// parts. The functions that allocate return 0, or -1 when out of memory;
+// loanShareRates() also when there are more than maxRates distinct rates
+// or a rate is NaN, and then leaves b without rateId.
+// Header-only; build with -pthread.
+
+#ifndef AMORTIZATION_H
+#define AMORTIZATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "TaskPool.h"
+
+#if defined(__AVX__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#define LOAN_LANES 8
+#define LOAN_CHUNK 8192
+#define LOAN_TERM_BITS 32
+
+typedef struct
+{
+    size_t n;
+    double *principal;
+    double *rate; // per month: an annual percentage / 1200
+    uint32_t *months;
+    uint32_t *rateId; // the row of a LoanRateTable for each loan, or NULL
+} LoanBook;
+
+typedef struct
+{
+    size_t count;
+    uint32_t maxMonths;
+    double *rate;   // count distinct rates
+    double *factor; // factor[id * (maxMonths + 1) + n]: the EMI of 1
+} LoanRateTable;
+
+static inline int loanBookInit(LoanBook *b, size_t n)
+{
+    memset(b, 0, sizeof *b);
+    b->principal = (double *)malloc((n ? n : 1) * sizeof *b->principal);
+    b->rate = (double *)malloc((n ? n : 1) * sizeof *b->rate);
+    b->months = (uint32_t *)malloc((n ? n : 1) * sizeof *b->months);
+    if (b->principal == NULL || b->rate == NULL || b->months == NULL)
+    {
+        free(b->principal);
+        free(b->rate);
+        free(b->months);
+        memset(b, 0, sizeof *b);
+        return -1;
+    }
+    b->n = n;
+    return 0;
+}
+
+static inline void loanBookFree(LoanBook *b)
+{
+    free(b->principal);
+    free(b->rate);
+    free(b->months);
+    free(b->rateId);
+    memset(b, 0, sizeof *b);
+}
+
+static inline void loanRateTableFree(LoanRateTable *t)
+{
+    free(t->rate);
+    free(t->factor);
+    memset(t, 0, sizeof *t);
+}
+
+// (1 + r)^n
+static inline double loanGrowth(double r, uint32_t n)
+{
+    double g = 1, base = 1 + r;
+    for (; n != 0; n >>= 1)
+    {
+        g *= n & 1 ? base : 1.0;
+        base *= base;
+    }
+    return g;
+}
+
+// The EMI of 1: r g / (g - 1), 1 / n at a rate of 0 and 1 for no months
+static inline double loanFactor(double r, uint32_t n, double g)
+{
+    return n == 0 ? 1.0 : r == 0 ? 1.0 / n : r * g / (g - 1);
+}
+
+static inline double loanEmi(double principal, double r, uint32_t n)
+{
+    return principal * loanFactor(r, n, loanGrowth(r, n));
+}
+
+// The EMIs of loans [begin, end) without the table: LOAN_LANES at a time
+// through as many squarings as the longest of them needs
+static inline void loanEmisRange(const LoanBook *b, double *emi, size_t begin, size_t end)
+{
+    size_t i = begin, l;
+    for (; i + LOAN_LANES <= end; i += LOAN_LANES)
+    {
+        const double *r = b->rate + i;
+        const uint32_t *n = b->months + i;
+        double g[LOAN_LANES], base[LOAN_LANES];
+        uint32_t all = 0;
+        int bit;
+        for (l = 0; l < LOAN_LANES; l++)
+        {
+            g[l] = 1;
+            base[l] = 1 + r[l];
+            all |= n[l];
+        }
+        for (bit = 0; bit < LOAN_TERM_BITS && all >> bit != 0; bit++)
+            for (l = 0; l < LOAN_LANES; l++)
+            {
+                g[l] *= n[l] >> bit & 1 ? base[l] : 1.0;
+                base[l] *= base[l];
+            }
+        for (l = 0; l < LOAN_LANES; l++)
+            emi[i + l] = b->principal[i + l] * loanFactor(r[l], n[l], g[l]);
+    }
+    for (; i < end; i++)
+        emi[i] = loanEmi(b->principal[i], b->rate[i], b->months[i]);
+}
+
+// The same with the table, for a book that has rateId
+static inline void loanEmisTable(const LoanBook *b, const LoanRateTable *t, double *emi, size_t begin, size_t end)
+{
+    size_t i, row = (size_t)t->maxMonths + 1;
+    for (i = begin; i < end; i++)
+    {
+        uint32_t n = b->months[i];
+        emi[i] = n <= t->maxMonths ? b->principal[i] * t->factor[b->rateId[i] * row + n]
+                                   : loanEmi(b->principal[i], b->rate[i], n);
+    }
+}
+
+// Fills t with the distinct rates of b and their factors for terms up to
+// maxMonths, and b->rateId with each loan's row. The rates get their rows
+// in the order they first come, through a hash table of their bits with
+// room for 2 maxRates, so a loan costs one probe or two, with no sort of
+// the whole book
+static inline int loanShareRates(LoanBook *b, LoanRateTable *t, size_t maxRates, uint32_t maxMonths)
+{
+    size_t i, k = 0, row = (size_t)maxMonths + 1, slots = 2, mask;
+    uint32_t *slot, n;
+    int rc = 0;
+    memset(t, 0, sizeof *t);
+    while (slots < 2 * maxRates)
+        slots *= 2;
+    mask = slots - 1;
+    // slot[h] is 1 + the row of the rate there, or 0 when free
+    slot = (uint32_t *)calloc(slots, sizeof *slot);
+    t->rate = (double *)malloc((maxRates ? maxRates : 1) * sizeof *t->rate);
+    free(b->rateId);
+    b->rateId = (uint32_t *)malloc((b->n ? b->n : 1) * sizeof *b->rateId);
+    if (slot == NULL || t->rate == NULL || b->rateId == NULL)
+        rc = -1;
+    for (i = 0; rc == 0 && i < b->n; i++)
+    {
+        double r = b->rate[i];
+        uint64_t bits;
+        size_t h;
+        // neighbours in a book often share a rate
+        if (i > 0 && r == b->rate[i - 1])
+        {
+            b->rateId[i] = b->rateId[i - 1];
+            continue;
+        }
+        r += 0.0; // -0 to 0, which it equals
+        memcpy(&bits, &r, sizeof bits);
+        for (h = (size_t)(bits * 0x9E3779B97F4A7C15ULL >> 40) & mask; slot[h] != 0; h = (h + 1) & mask)
+            if (t->rate[slot[h] - 1] == r)
+                break;
+        if (slot[h] == 0)
+        {
+            if (k == maxRates || r != r)
+            {
+                rc = -1;
+                break;
+            }
+            t->rate[k++] = r;
+            slot[h] = (uint32_t)k;
+        }
+        b->rateId[i] = slot[h] - 1;
+    }
+    if (rc == 0 && k != 0 && row > SIZE_MAX / sizeof(double) / k)
+        rc = -1;
+    if (rc == 0 && (t->factor = (double *)malloc((k ? k : 1) * row * sizeof *t->factor)) == NULL)
+        rc = -1;
+    free(slot);
+    if (rc != 0)
+    {
+        free(b->rateId);
+        b->rateId = NULL;
+        loanRateTableFree(t);
+        return -1;
+    }
+    t->count = k;
+    t->maxMonths = maxMonths;
+    for (i = 0; i < k; i++)
+        for (n = 0; n <= maxMonths; n++)
+            t->factor[i * row + n] = loanFactor(t->rate[i], n, loanGrowth(t->rate[i], n));
+    return 0;
+}
+
+typedef struct
+{
+    const LoanBook *book;
+    const LoanRateTable *table;
+    double *emi;
+} LoanEmiJob;
+
+static inline void loanEmiPiece(size_t begin, size_t end, void *arg)
+{
+    const LoanEmiJob *job = (const LoanEmiJob *)arg;
+    size_t first = begin * LOAN_CHUNK, last = end * LOAN_CHUNK;
+    last = last < job->book->n ? last : job->book->n;
+    if (job->table != NULL && job->book->rateId != NULL)
+        loanEmisTable(job->book, job->table, job->emi, first, last);
+    else
+        loanEmisRange(job->book, job->emi, first, last);
+}
+
+// emi[i] for every loan of b, from t when it is not NULL
+static inline void loanEmis(TaskPool *pool, const LoanBook *b, const LoanRateTable *t, double *emi)
+{
+    LoanEmiJob job = {b, t, emi};
+    size_t chunks = (b->n + LOAN_CHUNK - 1) / LOAN_CHUNK;
+    if (pool == NULL)
+        loanEmiPiece(0, chunks, &job);
+    else
+        poolParallelFor(pool, 0, chunks, 1, loanEmiPiece, &job);
+}
+
+// Month k (from 0) of a loan: interest[k], principal[k] and balance[k]
+// after the payment, for the n months; any of the arrays may be NULL
+static inline void loanSchedule(double p, double r, uint32_t n, double emi,
+                                double *interest, double *principal, double *balance)
+{
+    double grow = 1 + r;
+    uint32_t k;
+    for (k = 0; k < n; k++)
+    {
+        double in = p * r, paid = k + 1 < n ? emi - in : p;
+        p = k + 1 < n ? p * grow - emi : 0;
+        if (interest != NULL)
+            interest[k] = in;
+        if (principal != NULL)
+            principal[k] = paid;
+        if (balance != NULL)
+            balance[k] = p;
+    }
+}
+
+typedef struct
+{
+    const LoanBook *book;
+    const double *emi;
+    size_t months;
+    double *sums; // per chunk: 3 months, interest, principal, balance
+    double *lanes; // per worker: 3 months LOAN_LANES
+} LoanFlowJob;
+
+static inline void loanFlowPiece(size_t begin, size_t end, void *arg)
+{
+    const LoanFlowJob *job = (const LoanFlowJob *)arg;
+    const LoanBook *b = job->book;
+    size_t months = job->months, c, m, l;
+    double *acc = job->lanes + (size_t)poolWorkerId() * 3 * months * LOAN_LANES;
+    double *accInterest = acc, *accPrincipal = acc + months * LOAN_LANES, *accBalance = acc + 2 * months * LOAN_LANES;
+    for (c = begin; c < end; c++)
+    {
+        size_t first = c * LOAN_CHUNK, last = first + LOAN_CHUNK < b->n ? first + LOAN_CHUNK : b->n, i;
+        double *sums = job->sums + c * 3 * months;
+        memset(acc, 0, 3 * months * LOAN_LANES * sizeof *acc);
+        for (i = first; i < last; i += LOAN_LANES)
+        {
+            double p[LOAN_LANES], r[LOAN_LANES], g[LOAN_LANES], e[LOAN_LANES], left[LOAN_LANES];
+            uint32_t n[LOAN_LANES], longest = 0;
+            // the last few loans of the book fill the block with nothing
+            for (l = 0; l < LOAN_LANES; l++)
+            {
+                int here = i + l < last;
+                p[l] = here ? b->principal[i + l] : 0;
+                r[l] = here ? b->rate[i + l] : 0;
+                g[l] = 1 + r[l];
+                e[l] = here ? job->emi[i + l] : 0;
+                n[l] = here ? b->months[i + l] : 0;
+                left[l] = n[l];
+                longest = n[l] > longest ? n[l] : longest;
+            }
+            longest = longest < months ? longest : (uint32_t)months;
+#if defined(__AVX__) && defined(__FMA__) && LOAN_LANES == 8
+            {
+                __m256d p0 = _mm256_loadu_pd(p), p1 = _mm256_loadu_pd(p + 4);
+                __m256d r0 = _mm256_loadu_pd(r), r1 = _mm256_loadu_pd(r + 4);
+                __m256d g0 = _mm256_loadu_pd(g), g1 = _mm256_loadu_pd(g + 4);
+                __m256d e0 = _mm256_loadu_pd(e), e1 = _mm256_loadu_pd(e + 4);
+                __m256d n0 = _mm256_loadu_pd(left), n1 = _mm256_loadu_pd(left + 4);
+                for (m = 0; m < longest; m++)
+                {
+                    double *ai = accInterest + m * LOAN_LANES, *ap = accPrincipal + m * LOAN_LANES;
+                    double *ab = accBalance + m * LOAN_LANES;
+                    __m256d next = _mm256_set1_pd((double)(m + 1));
+                    __m256d more0 = _mm256_cmp_pd(next, n0, _CMP_LT_OQ), more1 = _mm256_cmp_pd(next, n1, _CMP_LT_OQ);
+                    __m256d in0 = _mm256_mul_pd(p0, r0), in1 = _mm256_mul_pd(p1, r1);
+                    __m256d paid0 = _mm256_blendv_pd(p0, _mm256_sub_pd(e0, in0), more0);
+                    __m256d paid1 = _mm256_blendv_pd(p1, _mm256_sub_pd(e1, in1), more1);
+                    p0 = _mm256_and_pd(_mm256_fmsub_pd(p0, g0, e0), more0);
+                    p1 = _mm256_and_pd(_mm256_fmsub_pd(p1, g1, e1), more1);
+                    _mm256_storeu_pd(ai, _mm256_add_pd(_mm256_loadu_pd(ai), in0));
+                    _mm256_storeu_pd(ai + 4, _mm256_add_pd(_mm256_loadu_pd(ai + 4), in1));
+                    _mm256_storeu_pd(ap, _mm256_add_pd(_mm256_loadu_pd(ap), paid0));
+                    _mm256_storeu_pd(ap + 4, _mm256_add_pd(_mm256_loadu_pd(ap + 4), paid1));
+                    _mm256_storeu_pd(ab, _mm256_add_pd(_mm256_loadu_pd(ab), p0));
+                    _mm256_storeu_pd(ab + 4, _mm256_add_pd(_mm256_loadu_pd(ab + 4), p1));
+                }
+                continue;
+            }
+#endif
+            for (m = 0; m < longest; m++)
+            {
+                double *ai = accInterest + m * LOAN_LANES, *ap = accPrincipal + m * LOAN_LANES;
+                double *ab = accBalance + m * LOAN_LANES;
+                double next = (double)(m + 1);
+                // a loan paid off stays at 0, so it adds nothing
+                for (l = 0; l < LOAN_LANES; l++)
+                {
+                    double in = p[l] * r[l], paid = next < left[l] ? e[l] - in : p[l];
+                    p[l] = next < left[l] ? p[l] * g[l] - e[l] : 0;
+                    ai[l] += in;
+                    ap[l] += paid;
+                    ab[l] += p[l];
+                }
+            }
+        }
+        for (m = 0; m < 3 * months; m++)
+        {
+            double s = 0;
+            for (l = 0; l < LOAN_LANES; l++)
+                s += acc[m * LOAN_LANES + l];
+            sums[m] = s;
+        }
+    }
+}
+
+// interest[k], principal[k] and balance[k]: the totals over the book of
+// month k of every schedule, for k < months, given the EMIs
+static inline int loanCashflows(TaskPool *pool, const LoanBook *b, const double *emi, size_t months,
+                                double *interest, double *principal, double *balance)
+{
+    size_t chunks = (b->n + LOAN_CHUNK - 1) / LOAN_CHUNK, workers = pool != NULL ? (size_t)pool->nthreads : 1, c, m;
+    LoanFlowJob job;
+    if (months == 0)
+        return 0;
+    job.book = b;
+    job.emi = emi;
+    job.months = months;
+    job.sums = (double *)malloc((chunks ? chunks : 1) * 3 * months * sizeof *job.sums);
+    // a multiple of 64 bytes, each worker's on lines of its own
+    job.lanes = (double *)aligned_alloc(64, workers * 3 * months * LOAN_LANES * sizeof *job.lanes);
+    if (job.sums == NULL || job.lanes == NULL)
+    {
+        free(job.sums);
+        free(job.lanes);
+        return -1;
+    }
+    if (pool == NULL)
+        loanFlowPiece(0, chunks, &job);
+    else
+        poolParallelFor(pool, 0, chunks, 1, loanFlowPiece, &job);
+    for (m = 0; m < months; m++)
+        interest[m] = principal[m] = balance[m] = 0;
+    for (c = 0; c < chunks; c++)
+        for (m = 0; m < months; m++)
+        {
+            const double *sums = job.sums + c * 3 * months;
+            interest[m] += sums[m];
+            principal[m] += sums[months + m];
+            balance[m] += sums[2 * months + m];
+        }
+    free(job.sums);
+    free(job.lanes);
+    return 0;
+}
+
+#endif
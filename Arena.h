@@ -0,0 +1,206 @@
+// A bump allocator for records that are loaded together and dropped
+// together, for DynamicMemoryAllocation and loaders like it.
+//
+// malloc() keeps a header per allocation and free() has to put every
+// record back on its own; a loader of millions of small records pays
+// that twice. An Arena hands out memory by moving a pointer up through a
+// block: arenaAlloc() is an add and a compare, with any power of two
+// alignment, and there is nothing per allocation to free. When a block
+// is full the next one is twice as big (from ARENA_MIN_BLOCK), so n
+// bytes take about log2(n) blocks, and arenaInit() can make the first
+// block as big as the whole load, which then lives in one malloc().
+// Blocks of at least ARENA_HUGE_PAGE bytes, with ARENA_HUGE, are aligned
+// to a 2 MB huge page and marked MADV_HUGEPAGE, as Matrix.h does, so a
+// big arena needs a few TLB entries rather than one per 4 KB.
+//
+// arenaMark() / arenaRewind() go back to where the arena was, freeing
+// the blocks taken since; arenaReset() empties it but keeps its biggest
+// block for the next load; arenaDestroy() frees it all, one free() per
+// block.
+//
+//     Arena arena;
+//     arenaInit(&arena, 0, 0);
+//     struct course *c = ARENA_NEW(&arena, struct course);
+//
+// arenaInit() returns 0, or -1 when out of memory; arenaAlloc() returns
+// NULL then. Header-only; it compiles as C++ too.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define ARENA_MIN_BLOCK (64u << 10)
+#define ARENA_HUGE_PAGE (2u << 20)
+#define ARENA_HEADER 64
+
+enum
+{
+    ARENA_HUGE = 1
+};
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *prev;
+    size_t size; // bytes, with this header
+} ArenaBlock;
+
+typedef struct
+{
+    ArenaBlock *block; // the newest, which top and end are in
+    unsigned char *top, *end;
+    size_t nextSize;
+    int flags;
+} Arena;
+
+typedef struct
+{
+    ArenaBlock *block;
+    unsigned char *top;
+} ArenaMark;
+
+#if defined(__cplusplus)
+#define ARENA_NEW(arena, type) ((type *)arenaAlloc((arena), sizeof(type), alignof(type)))
+#else
+#define ARENA_NEW(arena, type) ((type *)arenaAlloc((arena), sizeof(type), _Alignof(type)))
+#endif
+
+static inline ArenaBlock *arenaNewBlock(Arena *a, size_t size)
+{
+    void *p;
+    size_t align = ARENA_HEADER;
+    if ((a->flags & ARENA_HUGE) && size >= ARENA_HUGE_PAGE)
+    {
+        size = (size + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+        align = ARENA_HUGE_PAGE;
+    }
+    if (posix_memalign(&p, align, size) != 0)
+        return NULL;
+#if defined(MADV_HUGEPAGE)
+    if (align == ARENA_HUGE_PAGE)
+        madvise(p, size, MADV_HUGEPAGE);
+#endif
+    ((ArenaBlock *)p)->size = size;
+    return (ArenaBlock *)p;
+}
+
+static inline void arenaUse(Arena *a, ArenaBlock *b)
+{
+    b->prev = a->block;
+    a->block = b;
+    a->top = (unsigned char *)b + ARENA_HEADER;
+    a->end = (unsigned char *)b + b->size;
+}
+
+// With a first block of size bytes, or none until the first allocation
+// when size is 0; flags is 0 or ARENA_HUGE
+static inline int arenaInit(Arena *a, size_t size, int flags)
+{
+    ArenaBlock *b;
+    memset(a, 0, sizeof *a);
+    a->flags = flags;
+    a->nextSize = ARENA_MIN_BLOCK;
+    if (size == 0)
+        return 0;
+    if (size > SIZE_MAX - ARENA_HEADER || (b = arenaNewBlock(a, size + ARENA_HEADER)) == NULL)
+        return -1;
+    arenaUse(a, b);
+    a->nextSize = b->size * 2;
+    return 0;
+}
+
+// A new block for size bytes aligned to align, when the one in use is full
+static inline void *arenaGrow(Arena *a, size_t size, size_t align)
+{
+    size_t need = ARENA_HEADER + align + size, bytes = a->nextSize;
+    ArenaBlock *b;
+    uintptr_t p;
+    if (size > SIZE_MAX - ARENA_HEADER - align)
+        return NULL;
+    while (bytes < need)
+        bytes *= 2;
+    if ((b = arenaNewBlock(a, bytes)) == NULL)
+        return NULL;
+    arenaUse(a, b);
+    a->nextSize = b->size * 2;
+    p = ((uintptr_t)a->top + align - 1) & ~(uintptr_t)(align - 1);
+    a->top = (unsigned char *)p + size;
+    return (void *)p;
+}
+
+// size bytes aligned to align, a power of two
+static inline void *arenaAlloc(Arena *a, size_t size, size_t align)
+{
+    uintptr_t p = ((uintptr_t)a->top + align - 1) & ~(uintptr_t)(align - 1);
+    if (a->top != NULL && p <= (uintptr_t)a->end && size <= (uintptr_t)a->end - p)
+    {
+        a->top = (unsigned char *)p + size;
+        return (void *)p;
+    }
+    return arenaGrow(a, size, align);
+}
+
+// A copy of the len bytes at s with a '\0' after them
+static inline char *arenaStrdup(Arena *a, const char *s, size_t len)
+{
+    char *copy = (char *)arenaAlloc(a, len + 1, 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static inline ArenaMark arenaMark(const Arena *a)
+{
+    ArenaMark m;
+    m.block = a->block;
+    m.top = a->top;
+    return m;
+}
+
+// Frees everything allocated since m was taken
+static inline void arenaRewind(Arena *a, ArenaMark m)
+{
+    while (a->block != m.block)
+    {
+        ArenaBlock *prev = a->block->prev;
+        free(a->block);
+        a->block = prev;
+    }
+    a->top = m.top;
+    a->end = a->block != NULL ? (unsigned char *)a->block + a->block->size : NULL;
+}
+
+// Frees everything allocated, keeping the newest block, the biggest, to
+// allocate from again
+static inline void arenaReset(Arena *a)
+{
+    ArenaBlock *keep = a->block;
+    if (keep == NULL)
+        return;
+    while (keep->prev != NULL)
+    {
+        ArenaBlock *prev = keep->prev->prev;
+        free(keep->prev);
+        keep->prev = prev;
+    }
+    a->block = NULL;
+    arenaUse(a, keep);
+}
+
+static inline void arenaDestroy(Arena *a)
+{
+    ArenaMark none = {NULL, NULL};
+    arenaRewind(a, none);
+    a->nextSize = ARENA_MIN_BLOCK;
+}
+
+#endif
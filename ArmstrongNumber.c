@@ -1,31 +1,77 @@
 //To check whether the given number is Armstrong number or not
 //Armstrong number: An n -digit number equal to the sum of the nth powers of its digits.
 //Example: (1^3) + (5^3) + (3^3)= 153
+//
+//  ArmstrongNumber                               asks for a number
+//  ArmstrongNumber --range LO HI [--threads N]   every Armstrong number in [LO, HI]
+//  ArmstrongNumber --bench HI                    pow() per digit against Digits.h on 1 .. HI
 
+#define _POSIX_C_SOURCE 200809L
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
 #include<math.h>
+#include<time.h>
+#include "Digits.h"
 
-  void main() {
-    int number, sum = 0, rem = 0, nthPower = 0, digits = 0, temp;
-    printf("Enter a number");
-    scanf("%d", & number);
-    temp = number;
-    //to calculate the number of digits in the number
-    while (number != 0) {
-      number = number / 10;
+  static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, & t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+  }
+
+  // the check as it was: count the digits, then a pow() per digit
+  static int powCheck(long long number) {
+    long long sum = 0, temp = number;
+    int digits = 0;
+    while (temp != 0) {
+      temp = temp / 10;
       digits++;
     }
-    number = temp;
-    //to get the nth power of each digit and add it to the sum
-    while (number != 0) {
-      rem = number % 10;
-      nthPower = pow(rem, digits);
-      sum = sum + nthPower;
-      number = number / 10;
+    for (temp = number; temp != 0; temp = temp / 10)
+      sum = sum + (long long) pow(temp % 10, digits);
+    return sum == number;
+  }
+
+  static int bench(long long hi) {
+    double best[2] = {1e30, 1e30}, t;
+    long long n, found[2] = {0, 0};
+    DigitHits h;
+    int k;
+    for (k = 0; k < 3; k++) {
+      t = now();
+      for (found[0] = 0, n = 1; n <= hi; n++)
+        found[0] += powCheck(n);
+      if ((t = now() - t) < best[0])
+        best[0] = t;
+      t = now();
+      if (digitScan(NULL, DIGIT_ARMSTRONG, 1, hi, & h) != 0)
+        return 1;
+      found[1] = h.count;
+      free(h.n);
+      if ((t = now() - t) < best[1])
+        best[1] = t;
     }
-    //to check if obtained sum is equal to the original number
-    if (sum == temp)
+    printf("1 .. %lld, best of 3\n", hi);
+    printf("  pow() per digit   %8.3f s  %5.2f ns a number  %lld found\n", best[0], best[0] / hi * 1e9, found[0]);
+    printf("  Digits.h scan     %8.3f s  %5.2f ns a number  %lld found\n", best[1], best[1] / hi * 1e9, found[1]);
+    return found[0] != found[1];
+  }
+
+  int main(int argc, char ** argv) {
+    long long number;
+    if (argc >= 4 && strcmp(argv[1], "--range") == 0)
+      return digitReport(DIGIT_ARMSTRONG, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10),
+        argc > 5 && strcmp(argv[4], "--threads") == 0 ? atoi(argv[5]) : 1, "Armstrong numbers") != 0;
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+      return bench(atoll(argv[2]) > 0 ? atoll(argv[2]) : 10000000);
+    printf("Enter a number");
+    if (scanf("%lld", & number) != 1 || number < 0)
+      return 1;
+    //the sum of the nth powers of the digits, from a table of digit^n rather than pow()
+    if (digitIsArmstrong((uint64_t) number))
       printf("The given number is an Armstrong number");
     else
       printf("The given number is not an Armstrong number");
+    return 0;
   }
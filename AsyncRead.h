@@ -0,0 +1,552 @@
+// Reading a file with several large reads in flight, for the file modes
+// of EncryptDecryptXOR.c, ExternalSort.c, string_suffix_array_lcp_search.c
+// and MostFrequentWordInString.c.
+//
+// A program that reads a block, works on it and reads the next leaves
+// the disk idle while it works, and a fast SSD needs several requests
+// queued to get to its full rate. An AsyncReader keeps depth buffers of
+// size bytes each (ASYNC_DEPTH of ASYNC_BUFFER by default), aligned to
+// ASYNC_ALIGN, all being read at once through io_uring, ASYNC_REQUEST
+// bytes to a request (the kernel's readahead keeps up with requests of
+// that size better than with one huge one): the reads of the next pieces
+// of the file go on while the caller parses the one it has.
+// asyncReaderNext() hands the buffers back in file order, whichever read
+// finished first, and gives the one before back to the ring for the
+// piece after the last one asked for. A read that comes back short
+// before the end of the file is topped up with pread().
+//
+//     AsyncReader r;
+//     unsigned char *piece;
+//     ssize_t n;
+//     if (asyncReaderOpen(&r, fd, 0, 0, 0) == 0)
+//     {
+//         while ((n = asyncReaderNext(&r, &piece)) > 0)
+//             ... piece[0 .. n), until the next call ...
+//         asyncReaderClose(&r);             // does not close fd
+//     }
+//
+// asyncReadFile() reads all of a file into one buffer the same way, the
+// reads going straight to their place in it, with ASYNC_ALIGN zero bytes
+// after the end, so the text is '\0'-terminated; free it with
+// asyncFree().
+//
+// With ASYNC_DIRECT the file is read with O_DIRECT, past the page cache,
+// which saves a copy when the file is read once and is much bigger than
+// memory; the file system must allow it (tmpfs does not) and the reads
+// must start at a multiple of ASYNC_ALIGN, or it is read through the
+// cache as usual. Where io_uring cannot be had (before Linux 5.6, or
+// turned off by a seccomp filter or kernel.io_uring_disabled) the pieces
+// are read one at a time with pread(), and a pipe or terminal is read
+// with read(), so the same code works on any input. Everything comes
+// from the position fd has when opened, which is not moved.
+//
+// asyncReaderOpen() returns 0, or -1 when out of memory; Next returns the
+// bytes in the piece, 0 at the end of the file, -1 on a read error (errno
+// then says which). asyncReadFile() returns 0, or -1 when the file cannot
+// be opened or read (or path is not a regular file). Header-only; it
+// compiles as C++ too.
+
+#ifndef ASYNC_READ_H
+#define ASYNC_READ_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define ASYNC_BUFFER (8u << 20)
+#define ASYNC_DEPTH 4
+#define ASYNC_MAX_DEPTH 32
+#define ASYNC_REQUEST (1u << 20) // bytes a read asks the kernel for
+#define ASYNC_QUEUE 16           // requests asyncReadFile() keeps in flight
+#define ASYNC_ALIGN 4096
+
+enum
+{
+    ASYNC_DIRECT = 1
+};
+
+// glibc defines O_DIRECT only with _GNU_SOURCE
+#if defined(O_DIRECT)
+#define ASYNC_O_DIRECT O_DIRECT
+#elif defined(__O_DIRECT)
+#define ASYNC_O_DIRECT __O_DIRECT
+#endif
+
+typedef struct
+{
+    int fd; // the io_uring, -1 without one
+#if defined(__linux__)
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray, *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+#endif
+    void *sqMap, *cqMap, *sqeMap;
+    size_t sqMapLen, cqMapLen, sqeMapLen;
+} AsyncRing;
+
+typedef struct
+{
+    int fd, regular, direct;
+    AsyncRing ring;
+    unsigned char *buf; // depth * size bytes
+    size_t size;
+    int depth;
+    off_t at, end;      // the next piece to read, the file size
+    long issued, taken; // pieces asked for and handed out
+    int held;           // the one handed out last is still the caller's
+    off_t from[ASYNC_MAX_DEPTH]; // where the piece in each buffer starts
+    size_t len[ASYNC_MAX_DEPTH];
+    int pending[ASYNC_MAX_DEPTH]; // its requests still in flight
+    int failed;         // the errno of a failed read, or 0
+} AsyncReader;
+
+// ---------- the ring ----------
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+static inline void asyncRingClose(AsyncRing *ring)
+{
+    if (ring->sqeMap != NULL)
+        munmap(ring->sqeMap, ring->sqeMapLen);
+    if (ring->cqMap != NULL && ring->cqMap != ring->sqMap)
+        munmap(ring->cqMap, ring->cqMapLen);
+    if (ring->sqMap != NULL)
+        munmap(ring->sqMap, ring->sqMapLen);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof *ring);
+    ring->fd = -1;
+}
+
+// A ring for entries reads in flight; -1 (and ring->fd -1) without one
+static inline int asyncRingOpen(AsyncRing *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    unsigned char *sq, *cq;
+    memset(ring, 0, sizeof *ring);
+    memset(&p, 0, sizeof p);
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0)
+    {
+        ring->fd = -1;
+        return -1;
+    }
+    ring->sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cqMapLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && ring->cqMapLen > ring->sqMapLen)
+        ring->sqMapLen = ring->cqMapLen;
+    ring->sqMap = mmap(NULL, ring->sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+                       IORING_OFF_SQ_RING);
+    if (ring->sqMap == MAP_FAILED)
+        ring->sqMap = NULL;
+    else if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cqMap = ring->sqMap;
+    else if ((ring->cqMap = mmap(NULL, ring->cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                 ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+        ring->cqMap = NULL;
+    ring->sqeMapLen = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (ring->cqMap != NULL && (ring->sqeMap = mmap(NULL, ring->sqeMapLen, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED, ring->fd, IORING_OFF_SQES)) == MAP_FAILED)
+        ring->sqeMap = NULL;
+    if (ring->sqeMap == NULL)
+    {
+        asyncRingClose(ring);
+        return -1;
+    }
+    sq = (unsigned char *)ring->sqMap;
+    cq = (unsigned char *)ring->cqMap;
+    ring->sqHead = (unsigned *)(sq + p.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + p.sq_off.array);
+    ring->cqHead = (unsigned *)(cq + p.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    ring->sqes = (struct io_uring_sqe *)ring->sqeMap;
+    return 0;
+}
+
+// Queues and submits a read of len bytes of fd at off into buf, tagged
+// with tag; -1 when the kernel would not take it
+static inline int asyncRingRead(AsyncRing *ring, int fd, void *buf, size_t len, off_t off, uint64_t tag)
+{
+    unsigned tail = *ring->sqTail, i = tail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[i];
+    memset(sqe, 0, sizeof *sqe);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (unsigned)len;
+    sqe->off = (uint64_t)off;
+    sqe->user_data = tag;
+    ring->sqArray[i] = i;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0)
+        if (errno != EINTR)
+        {
+            // not taken: the caller reads it some other way
+            __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+            return -1;
+        }
+    return 0;
+}
+
+// Waits for the next read to finish: its tag, and its result in *res,
+// the bytes read or -errno
+static inline int asyncRingWait(AsyncRing *ring, uint64_t *tag, int *res)
+{
+    for (;;)
+    {
+        unsigned head = *ring->cqHead;
+        if (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+            *tag = cqe->user_data;
+            *res = cqe->res;
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -1;
+    }
+}
+
+#else
+
+static inline void asyncRingClose(AsyncRing *ring)
+{
+    ring->fd = -1;
+}
+
+static inline int asyncRingOpen(AsyncRing *ring, unsigned entries)
+{
+    (void)entries;
+    memset(ring, 0, sizeof *ring);
+    ring->fd = -1;
+    return -1;
+}
+
+static inline int asyncRingRead(AsyncRing *ring, int fd, void *buf, size_t len, off_t off, uint64_t tag)
+{
+    (void)ring, (void)fd, (void)buf, (void)len, (void)off, (void)tag;
+    return -1;
+}
+
+static inline int asyncRingWait(AsyncRing *ring, uint64_t *tag, int *res)
+{
+    (void)ring, (void)tag, (void)res;
+    return -1;
+}
+
+#endif
+
+// ---------- shared pieces ----------
+
+// Reads len bytes of fd at off into buf, short only at end, the file
+// size (an O_DIRECT read may not start there); the bytes read, or -1
+static inline ssize_t asyncPread(int fd, unsigned char *buf, size_t len, off_t off, off_t end)
+{
+    size_t done = 0;
+    while (done < len && off + (off_t)done < end)
+    {
+        ssize_t n = pread(fd, buf + done, len - done, off + (off_t)done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+// Turns O_DIRECT on for fd when it can be used from offset at
+static inline int asyncDirect(int fd, off_t at)
+{
+#if defined(ASYNC_O_DIRECT)
+    int fl = fcntl(fd, F_GETFL);
+    if (at % ASYNC_ALIGN == 0 && fl >= 0 && fcntl(fd, F_SETFL, fl | ASYNC_O_DIRECT) == 0)
+        return 1;
+#else
+    (void)fd, (void)at;
+#endif
+    return 0;
+}
+
+static inline void asyncUndirect(int fd)
+{
+#if defined(ASYNC_O_DIRECT)
+    int fl = fcntl(fd, F_GETFL);
+    if (fl >= 0)
+        fcntl(fd, F_SETFL, fl & ~ASYNC_O_DIRECT);
+#else
+    (void)fd;
+#endif
+}
+
+// A read of up to len bytes at off came back with res: tops up one that
+// is short before end, the file size, with pread(); the bytes in the
+// buffer, or -1 with errno set
+static inline ssize_t asyncFinish(int fd, unsigned char *buf, size_t len, off_t off, off_t end, int res)
+{
+    ssize_t more;
+    if (res < 0 && res != -EAGAIN && res != -EINTR && res != -EINVAL) // EINVAL: no IORING_OP_READ before 5.6
+    {
+        errno = -res;
+        return -1;
+    }
+    if (res < 0)
+        res = 0;
+    if ((size_t)res == len || off + res >= end)
+        return res;
+    // short: the end of the file, or a read the kernel cut off
+    if ((more = asyncPread(fd, buf + res, len - (size_t)res, off + res, end)) < 0)
+        return -1;
+    return res + more;
+}
+
+// ---------- reading in pieces ----------
+
+// The bytes request k of a piece of len bytes asks for: ASYNC_REQUEST,
+// less for the last, which O_DIRECT rounds up to whole blocks (the file
+// ends inside the last one)
+static inline size_t asyncRequestLen(size_t len, size_t k, int direct)
+{
+    size_t n = len - k * ASYNC_REQUEST < ASYNC_REQUEST ? len - k * ASYNC_REQUEST : ASYNC_REQUEST;
+    return direct ? (n + ASYNC_ALIGN - 1) / ASYNC_ALIGN * ASYNC_ALIGN : n;
+}
+
+// Queues the reads of the next piece into buffer slot, ASYNC_REQUEST
+// bytes each
+static inline void asyncIssue(AsyncReader *r, int slot)
+{
+    unsigned char *buf = r->buf + (size_t)slot * r->size;
+    size_t len = r->end - r->at < (off_t)r->size ? (size_t)(r->end - r->at) : r->size, k;
+    r->from[slot] = r->at;
+    r->len[slot] = len;
+    r->pending[slot] = 0;
+    for (k = 0; k * ASYNC_REQUEST < len; k++)
+    {
+        size_t n = asyncRequestLen(len, k, r->direct);
+        off_t off = r->at + (off_t)(k * ASYNC_REQUEST);
+        if (r->ring.fd >= 0 &&
+            asyncRingRead(&r->ring, r->fd, buf + k * ASYNC_REQUEST, n, off, (uint64_t)slot << 32 | k) == 0)
+            r->pending[slot]++;
+        else if (asyncPread(r->fd, buf + k * ASYNC_REQUEST, n, off, r->end) < 0)
+            r->failed = errno; // no ring: read it now
+    }
+    r->at += (off_t)len;
+    r->issued++;
+}
+
+// Reads fd from where it is now; size and depth are 0 for the defaults,
+// flags 0 or ASYNC_DIRECT
+static inline int asyncReaderOpen(AsyncReader *r, int fd, size_t size, int depth, int flags)
+{
+    struct stat st;
+    off_t start;
+    void *p;
+    memset(r, 0, sizeof *r);
+    r->ring.fd = -1;
+    r->fd = fd;
+    r->size = size ? (size + ASYNC_ALIGN - 1) / ASYNC_ALIGN * ASYNC_ALIGN : ASYNC_BUFFER;
+    r->depth = depth > 0 ? (depth < ASYNC_MAX_DEPTH ? depth : ASYNC_MAX_DEPTH) : ASYNC_DEPTH;
+    start = lseek(fd, 0, SEEK_CUR);
+    r->regular = start >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (!r->regular)
+        r->depth = 1;
+    if (r->size > SIZE_MAX / (size_t)r->depth || posix_memalign(&p, ASYNC_ALIGN, r->size * (size_t)r->depth) != 0)
+        return -1;
+    r->buf = (unsigned char *)p;
+    if (r->regular)
+    {
+        size_t requests = (r->size + ASYNC_REQUEST - 1) / ASYNC_REQUEST * (size_t)r->depth;
+        r->at = start;
+        r->end = st.st_size > start ? st.st_size : start;
+        if (flags & ASYNC_DIRECT)
+            r->direct = asyncDirect(fd, start);
+        asyncRingOpen(&r->ring, requests < 4096 ? (unsigned)requests : 4096);
+    }
+    return 0;
+}
+
+// The next piece in *piece, good until the next call
+static inline ssize_t asyncReaderNext(AsyncReader *r, unsigned char **piece)
+{
+    int slot;
+    if (!r->regular)
+    {
+        ssize_t n;
+        while ((n = read(r->fd, r->buf, r->size)) < 0 && errno == EINTR)
+            ;
+        *piece = r->buf;
+        return n;
+    }
+    // the piece handed out last is done with: its buffer reads the next
+    if (r->held && r->at < r->end && !r->failed)
+        asyncIssue(r, (int)((r->taken - 1) % r->depth));
+    r->held = 0;
+    while (r->issued < r->taken + r->depth && r->at < r->end && !r->failed)
+        asyncIssue(r, (int)(r->issued % r->depth));
+    if (r->taken == r->issued && !r->failed)
+        return 0;
+    slot = (int)(r->taken % r->depth);
+    while (r->pending[slot] > 0 && !r->failed)
+    {
+        uint64_t tag;
+        int res, i;
+        size_t k, n;
+        if (asyncRingWait(&r->ring, &tag, &res) != 0)
+        {
+            r->failed = errno;
+            break;
+        }
+        i = (int)(tag >> 32);
+        k = (size_t)(uint32_t)tag;
+        n = asyncRequestLen(r->len[i], k, r->direct);
+        r->pending[i]--;
+        if (asyncFinish(r->fd, r->buf + (size_t)i * r->size + k * ASYNC_REQUEST, n,
+                        r->from[i] + (off_t)(k * ASYNC_REQUEST), r->end, res) < 0)
+            r->failed = errno;
+    }
+    if (r->failed)
+    {
+        errno = r->failed;
+        return -1;
+    }
+    *piece = r->buf + (size_t)slot * r->size;
+    r->taken++;
+    r->held = 1;
+    return (ssize_t)r->len[slot];
+}
+
+// Waits for the reads still in flight, which write into the buffers
+static inline void asyncReaderClose(AsyncReader *r)
+{
+    long pending = 0;
+    int i;
+    for (i = 0; i < r->depth; i++)
+        pending += r->pending[i];
+    if (r->ring.fd >= 0)
+    {
+        uint64_t tag;
+        int res;
+        for (; pending > 0; pending--)
+            if (asyncRingWait(&r->ring, &tag, &res) != 0)
+                break;
+    }
+    asyncRingClose(&r->ring);
+    if (r->direct)
+        asyncUndirect(r->fd);
+    free(r->buf);
+    r->buf = NULL;
+}
+
+// ---------- reading a whole file ----------
+
+static inline void asyncFree(void *data)
+{
+    free(data);
+}
+
+// All of the regular file path in *data (*len bytes, then ASYNC_ALIGN
+// zero bytes), read ASYNC_REQUEST at a time with ASYNC_QUEUE in flight
+static inline int asyncReadFile(const char *path, int flags, unsigned char **data, size_t *len)
+{
+    struct stat st;
+    AsyncRing ring;
+    unsigned char *buf;
+    void *p;
+    size_t size, requests, issued = 0, done = 0;
+    int fd = open(path, O_RDONLY), direct = 0, failed = 0;
+    *data = NULL;
+    *len = 0;
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > SIZE_MAX - 2 * ASYNC_ALIGN)
+    {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    size = (size_t)st.st_size;
+    if (posix_memalign(&p, ASYNC_ALIGN, (size + 2 * ASYNC_ALIGN - 1) / ASYNC_ALIGN * ASYNC_ALIGN) != 0)
+    {
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    buf = (unsigned char *)p;
+    if (flags & ASYNC_DIRECT)
+        direct = asyncDirect(fd, 0);
+    requests = (size + ASYNC_REQUEST - 1) / ASYNC_REQUEST;
+    asyncRingOpen(&ring, ASYNC_QUEUE);
+    while (done < requests && !failed)
+    {
+        // keep ASYNC_QUEUE reads going; without a ring each is read at once
+        while (issued < requests && issued - done < ASYNC_QUEUE)
+        {
+            size_t off = issued * ASYNC_REQUEST, n = asyncRequestLen(size, issued, direct);
+            if (ring.fd < 0 || asyncRingRead(&ring, fd, buf + off, n, (off_t)off, issued) != 0)
+            {
+                if (asyncPread(fd, buf + off, n, (off_t)off, (off_t)size) < 0)
+                    failed = 1;
+                done++;
+            }
+            issued++;
+        }
+        if (done < issued && !failed)
+        {
+            uint64_t tag;
+            int res;
+            size_t off;
+            if (asyncRingWait(&ring, &tag, &res) != 0)
+            {
+                failed = 1;
+                break;
+            }
+            off = (size_t)tag * ASYNC_REQUEST;
+            if (asyncFinish(fd, buf + off, asyncRequestLen(size, (size_t)tag, direct), (off_t)off, (off_t)size,
+                            res) < 0)
+                failed = 1;
+            done++;
+        }
+    }
+    // reads still in flight write into buf: wait for them before it goes
+    if (ring.fd >= 0)
+        while (done < issued)
+        {
+            uint64_t tag;
+            int res;
+            if (asyncRingWait(&ring, &tag, &res) != 0)
+                break;
+            done++;
+        }
+    asyncRingClose(&ring);
+    close(fd);
+    if (failed)
+    {
+        free(buf);
+        return -1;
+    }
+    memset(buf + size, 0, ASYNC_ALIGN);
+    *data = buf;
+    *len = size;
+    return 0;
+}
+
+#endif
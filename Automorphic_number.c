@@ -1,9 +1,16 @@
+// Automorphic_number                               asks for a number
+// Automorphic_number --range LO HI [--threads N]   every automorphic number in [LO, HI]
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<math.h>
-int main() {
+#include "Digits.h"
+int main(int argc, char **argv) {
   int num, sqr, temp, last;
   int n = 0;
+  if (argc >= 4 && strcmp(argv[1], "--range") == 0)
+    return digitReport(DIGIT_AUTOMORPHIC, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10),
+      argc > 5 && strcmp(argv[4], "--threads") == 0 ? atoi(argv[5]) : 1, "automorphic numbers") != 0;
   printf("Enter a number \n");
   scanf("%d", & num);
   sqr = num * num; //calculating square of num
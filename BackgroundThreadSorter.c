@@ -5,14 +5,41 @@
  * 0,1,2,3,4,0,1,2,3,4,.....(For an array of size 5).
  * This program demonstrates usage of pthreads, mutexes, qsort(in built C sorting function).
  * The array used is an array of structures. 
+ *
+ * Run with --lock-free for the same program without the mutex: the input is
+ * pushed into a lock-free ring buffer, the sorter sorts its own copy of the
+ * array and publishes it by swapping one atomic pointer, and a printer thread
+ * reads the published copy. Nobody waits for the sort or for the printing.
+ *
+ * Run with --incremental to keep the array sorted as rectangles arrive: the
+ * sorter sleeps on a condition variable until there is new input, sorts only
+ * the new batch and merges it into the order it already has.
+ *
+ * Run with --keyed to have the sorter compute each area once, as a 64-bit
+ * key, and radix sort the keys instead of calling a comparator.
+ *
+ * Add --size N to any of them for an array of N rects instead of 5 (the rest
+ * start out as 0 x 0). Input is taken a chunk at a time, and every rect of a
+ * chunk is added under a single lock.
+ *
+ * Build with -DPROBE to time the waits for the lock and the time it is held,
+ * by the sorter and by the input, and the sorts; Probe.h writes them out as
+ * JSON at the end of the input.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include <pthread.h>
 #include <unistd.h>
 
-#define RECT_ARRAY_SIZE 5
+#include "Probe.h"
+
+#define RECT_ARRAY_SIZE 5 /* the default; --size N changes it */
+#define CACHE_LINE 64
 
 /*
  * Rectangle structure has length and breadth.
@@ -23,104 +50,644 @@ struct rect {
 };
 
 /*
- * Array of rectangle structs to be sorted.
+ * Array of rectangle structs to be sorted, rect_array_size long.
  */
-struct rect r[RECT_ARRAY_SIZE];
+struct rect *r;
+size_t rect_array_size = RECT_ARRAY_SIZE;
 /*
  * mutex lock to serialize the array of rectangle structs
  */
 pthread_mutex_t lock;
 
+/*
+ * n rects on the heap, starting on a cache line so that the threads that
+ * write neighbouring arrays do not share lines with them
+ */
+struct rect *alloc_rects(size_t n)
+{
+	size_t bytes = (n * sizeof(struct rect) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	return aligned_alloc(CACHE_LINE, bytes ? bytes : CACHE_LINE);
+}
+
+/*
+ * Big arrays are printed as their first and last PRINT_EDGE rects.
+ * Returns whether row i of n is printed.
+ */
+#define PRINT_EDGE 10
+
+int print_row(size_t i, size_t n)
+{
+	if (n <= 2 * PRINT_EDGE || i < PRINT_EDGE || i >= n - PRINT_EDGE)
+		return 1;
+	if (i == PRINT_EDGE)
+		printf("... %zu more ...\n", n - 2 * PRINT_EDGE);
+	return 0;
+}
+
 /*
  * The comparator to compare the 2 rectangle structures.
  * Comparison is based on area. 
  */
 int area_comp(const void *r1, const void *r2) 
 {
-	int area1, area2;
+	const struct rect *r1_t = r1, *r2_t = r2;
+	/* in 64 bits the product of two ints cannot overflow */
+	long long area1 = (long long)r1_t->length * r1_t->breadth;
+	long long area2 = (long long)r2_t->length * r2_t->breadth;
 
-	struct rect r1_t = *(const struct rect *)r1;
-	struct rect r2_t = *(const struct rect *)r2;
+	return (area1 > area2) - (area1 < area2);
+} 
 
-	area1 = r1_t.length * r1_t.breadth;
-	area2 = r2_t.length * r2_t.breadth;
+/*
+ * Area as an unsigned key in the same order: flipping the sign bit puts
+ * negative areas below positive ones.
+ */
+uint64_t area_key(const struct rect *rc)
+{
+	return (uint64_t)((long long)rc->length * rc->breadth) ^ 0x8000000000000000ULL;
+}
 
-	return area1 > area2 ? 1 : 0;
-} 
+struct keyed {
+	uint64_t key;
+	int index;
+};
+
+/*
+ * Sorts a[0..n) by area through (key, index) pairs: each key is computed
+ * once, then the pairs are radix sorted a byte at a time from the lowest
+ * byte up. Every pass is stable, so rects of equal area keep their order.
+ * Bytes that are the same in every key are skipped. Small arrays are
+ * insertion sorted on the keys instead. Falls back to qsort if out of
+ * memory.
+ */
+void keyed_sort(struct rect *a, int n)
+{
+	struct keyed *src = malloc(2 * (size_t)n * sizeof *src + 1);
+	struct keyed *dst = src + n, *t;
+	struct rect *copy = malloc((size_t)n * sizeof *copy + 1);
+	int i, j;
+
+	if (src == NULL || copy == NULL) {
+		free(src);
+		free(copy);
+		qsort(a, n, sizeof(struct rect), area_comp);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		src[i].key = area_key(&a[i]);
+		src[i].index = i;
+	}
+
+	if (n < 64) {
+		for (i = 1; i < n; i++) {
+			struct keyed v = src[i];
+			for (j = i; j > 0 && src[j - 1].key > v.key; j--)
+				src[j] = src[j - 1];
+			src[j] = v;
+		}
+	} else {
+		for (int shift = 0; shift < 64; shift += 8) {
+			size_t count[256] = {0}, sum = 0;
+
+			for (i = 0; i < n; i++)
+				count[(src[i].key >> shift) & 255]++;
+			if (count[(src[0].key >> shift) & 255] == (size_t)n)
+				continue;
+			for (int b = 0; b < 256; b++) {
+				size_t c = count[b];
+				count[b] = sum;
+				sum += c;
+			}
+			for (i = 0; i < n; i++)
+				dst[count[(src[i].key >> shift) & 255]++] = src[i];
+			t = src;
+			src = dst;
+			dst = t;
+		}
+	}
+
+	memcpy(copy, a, (size_t)n * sizeof *copy);
+	for (i = 0; i < n; i++)
+		a[i] = copy[src[i].index];
+	free(src < dst ? src : dst);
+	free(copy);
+}
 
 /*
  * Function of the background pthread.
  * This function sorts the array of rectangle structs 
  * every 10 seconds and prints out the output.
+ * p is non-NULL for --keyed.
  */
 void *sorter(void *p)
 {
 	for(;;) {
+		PROBE_BEGIN(wait, "sorter lock wait");
 		pthread_mutex_lock(&lock);
-		qsort(r, RECT_ARRAY_SIZE, sizeof(struct rect), area_comp);
+		PROBE_END(wait);
+		PROBE_BEGIN(held, "sorter lock held");
+		PROBE_BEGIN(sort, "sorter sort");
+		if (p != NULL)
+			keyed_sort(r, rect_array_size);
+		else
+			qsort(r, rect_array_size, sizeof(struct rect), area_comp);
+		PROBE_END(sort);
 		printf("The rect array is\n");
-		for (int i = 0; i < RECT_ARRAY_SIZE; i++) {
-			printf("%d %d\n", r[i].length, r[i].breadth);
+		for (size_t i = 0; i < rect_array_size; i++) {
+			if (print_row(i, rect_array_size))
+				printf("%d %d\n", r[i].length, r[i].breadth);
 		}
+		PROBE_END(held);
 		pthread_mutex_unlock(&lock);
 		sleep(10);
 		printf("\n");
 	}
 }
 
-int main(void)
+/*
+ * Bounded lock-free queue of rects (Dmitry Vyukov's design). Every slot has
+ * a sequence number that says whose turn it is: a producer may fill slot
+ * pos when seq == pos, the consumer may take it when seq == pos + 1. Any
+ * number of producers can push; the sorter thread is the only consumer.
+ */
+#define RING_SIZE 1024 /* a power of two */
+
+struct ring_slot {
+	atomic_size_t seq;
+	struct rect value;
+};
+
+struct ring {
+	struct ring_slot slots[RING_SIZE];
+	atomic_size_t head; /* next slot to push */
+	size_t tail;        /* next slot to pop, used by the consumer only */
+};
+
+static struct ring ring;
+
+void ring_init(struct ring *q)
+{
+	for (size_t i = 0; i < RING_SIZE; i++)
+		atomic_init(&q->slots[i].seq, i);
+	atomic_init(&q->head, 0);
+	q->tail = 0;
+}
+
+/*
+ * Returns 0 when the ring is full. A push never waits on the consumer:
+ * it is one compare-and-swap and two stores however long the sort runs.
+ */
+int ring_push(struct ring *q, struct rect value)
+{
+	size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+	for (;;) {
+		struct ring_slot *slot = &q->slots[pos & (RING_SIZE - 1)];
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+			    memory_order_relaxed, memory_order_relaxed)) {
+				slot->value = value;
+				atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+				return 1;
+			}
+		} else if (diff < 0) {
+			return 0;
+		} else {
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+	}
+}
+
+int ring_pop(struct ring *q, struct rect *value)
+{
+	struct ring_slot *slot = &q->slots[q->tail & (RING_SIZE - 1)];
+	size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+	if (seq != q->tail + 1)
+		return 0;
+	*value = slot->value;
+	atomic_store_explicit(&slot->seq, q->tail + RING_SIZE, memory_order_release);
+	q->tail++;
+	return 1;
+}
+
+/*
+ * A sorted copy of the array. Once published it is never written again,
+ * so readers can use it without a lock.
+ */
+struct snapshot {
+	unsigned long version;
+	unsigned long inputs; /* rects pushed into the ring so far that it includes */
+	size_t count;
+	struct rect r[];
+};
+
+static _Atomic(struct snapshot *) current;
+
+/*
+ * Readers announce which version they may be holding, so the sorter knows
+ * when an old snapshot can be freed (a small grace period, RCU-style).
+ * 0 means the reader holds nothing.
+ */
+#define MAX_READERS 4
+static atomic_ulong published = 1;
+static atomic_ulong reader_version[MAX_READERS];
+
+struct snapshot *snapshot_get(int reader)
+{
+	atomic_store(&reader_version[reader], atomic_load(&published));
+	return atomic_load(&current);
+}
+
+void snapshot_put(int reader)
+{
+	atomic_store(&reader_version[reader], 0);
+}
+
+/*
+ * Swaps in the new snapshot. Readers keep going; only the sorter waits,
+ * until nobody can still hold the old snapshot, before freeing it.
+ */
+void snapshot_publish(struct snapshot *s)
+{
+	struct snapshot *old = atomic_exchange(&current, s);
+	unsigned long version = atomic_fetch_add(&published, 1) + 1;
+
+	for (int i = 0; i < MAX_READERS; i++) {
+		unsigned long v;
+		while ((v = atomic_load(&reader_version[i])) != 0 && v < version)
+			sched_yield();
+	}
+	free(old);
+}
+
+/*
+ * The sorter keeps its own copy of the circular array. It drains the
+ * ring into it, and whenever something new came in, sorts a fresh copy
+ * and publishes it.
+ */
+void *lock_free_sorter(void *p)
+{
+	size_t count = rect_array_size;
+	struct rect *window = alloc_rects(count);
+	uint64_t head = 0;
+	unsigned long version = 0, inputs = 0;
+
+	if (window == NULL)
+		return p;
+	memcpy(window, r, count * sizeof *window);
+	for (;;) {
+		struct rect value;
+		int fresh = 0;
+		struct snapshot *s;
+
+		while (ring_pop(&ring, &value)) {
+			window[(head++) % count] = value;
+			inputs++;
+			fresh = 1;
+		}
+		if (!fresh && version > 0) {
+			usleep(1000);
+			continue;
+		}
+
+		s = malloc(sizeof *s + count * sizeof(struct rect));
+		if (s == NULL) {
+			usleep(1000);
+			continue;
+		}
+		s->version = ++version;
+		s->inputs = inputs;
+		s->count = count;
+		memcpy(s->r, window, count * sizeof(struct rect));
+		qsort(s->r, s->count, sizeof(struct rect), area_comp);
+		snapshot_publish(s);
+	}
+	return p;
+}
+
+void print_snapshot(const struct snapshot *s)
+{
+	printf("The rect array is (version %lu)\n", s->version);
+	for (size_t i = 0; i < s->count; i++) {
+		if (print_row(i, s->count))
+			printf("%d %d\n", s->r[i].length, s->r[i].breadth);
+	}
+	printf("\n");
+}
+
+/*
+ * Prints the latest sorted array every 10 seconds, without any lock
+ */
+void *printer(void *p)
+{
+	int reader = 0;
+
+	for (;;) {
+		struct snapshot *s = snapshot_get(reader);
+		if (s != NULL)
+			print_snapshot(s);
+		snapshot_put(reader);
+		sleep(10);
+	}
+	return p;
+}
+
+/*
+ * Incremental mode. main adds each new rect to the pending batch and
+ * signals new_data. The sorter takes the whole batch under the lock,
+ * then sorts and merges it with the lock released. Every rect carries its
+ * arrival number, so the ones pushed out of the circular array are
+ * simply left out of the merge.
+ */
+struct arrival {
+	struct rect r;
+	uint64_t seq;
+};
+
+static pthread_cond_t new_data = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t caught_up = PTHREAD_COND_INITIALIZER;
+static struct rect *pending; /* newest rect_array_size rects of the batch */
+static uint64_t arrived;     /* rects ever added, under lock */
+static uint64_t taken;       /* rects handed to the sorter, under lock */
+static uint64_t shown;       /* rects merged and printed, under lock */
+
+int arrival_comp(const void *a1, const void *a2)
+{
+	const struct arrival *x = a1, *y = a2;
+	int c = area_comp(&x->r, &y->r);
+
+	if (c != 0)
+		return c;
+	return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+void add_rects(const struct rect *batch, size_t n)
+{
+	pthread_mutex_lock(&lock);
+	for (size_t i = 0; i < n; i++)
+		pending[(arrived++) % rect_array_size] = batch[i];
+	pthread_cond_signal(&new_data);
+	pthread_mutex_unlock(&lock);
+}
+
+void *incremental_sorter(void *p)
+{
+	size_t size = rect_array_size, count = size;
+	struct arrival *sorted = malloc(size * sizeof *sorted);
+	struct arrival *merged = malloc(size * sizeof *merged);
+	struct arrival *batch = malloc(size * sizeof *batch), *t;
+
+	if (sorted == NULL || merged == NULL || batch == NULL) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+
+	/*
+	 * The starting array counts as the first size arrivals, so rect
+	 * number a from main gets seq a + size.
+	 */
+	for (size_t i = 0; i < size; i++) {
+		sorted[i].r = r[i];
+		sorted[i].seq = i;
+	}
+	qsort(sorted, count, sizeof *sorted, arrival_comp);
+
+	for (;;) {
+		uint64_t first, end, oldest;
+		size_t nbatch = 0, i = 0, j = 0, k = 0;
+
+		pthread_mutex_lock(&lock);
+		while (arrived == taken)
+			pthread_cond_wait(&new_data, &lock);
+		end = arrived;
+		/* older rects of a big batch have already been overwritten */
+		first = end - taken > size ? end - size : taken;
+		for (uint64_t a = first; a < end; a++) {
+			batch[nbatch].r = pending[a % size];
+			batch[nbatch++].seq = a + size;
+		}
+		taken = end;
+		pthread_mutex_unlock(&lock);
+
+		/* only the batch is sorted; the rest is merged in one pass */
+		qsort(batch, nbatch, sizeof *batch, arrival_comp);
+		oldest = end; /* seqs end .. end + size - 1 are in the array */
+		while (i < count || j < nbatch) {
+			if (i < count && sorted[i].seq < oldest) {
+				i++;
+				continue;
+			}
+			if (j == nbatch || (i < count && arrival_comp(&sorted[i], &batch[j]) <= 0))
+				merged[k++] = sorted[i++];
+			else
+				merged[k++] = batch[j++];
+		}
+		count = k;
+		t = sorted;
+		sorted = merged;
+		merged = t;
+
+		printf("The rect array is\n");
+		for (i = 0; i < count; i++) {
+			if (print_row(i, count))
+				printf("%d %d\n", sorted[i].r.length, sorted[i].r.breadth);
+		}
+		printf("\n");
+
+		pthread_mutex_lock(&lock);
+		shown = end;
+		pthread_cond_broadcast(&caught_up);
+		pthread_mutex_unlock(&lock);
+	}
+	return p;
+}
+
+/*
+ * Input is read with read(), which returns whatever is there already: a
+ * line at a time from a terminal, up to READ_CHUNK bytes from a pipe.
+ * A rect takes at least 4 bytes ("1 1\n"), so a chunk holds at most
+ * BATCH_MAX of them.
+ */
+#define READ_CHUNK 65536
+#define BATCH_MAX (READ_CHUNK / 4 + 1)
+
+/*
+ * Parses every complete rect in the next chunk of input into batch.
+ * A number or a rect cut off at the end of the chunk is kept for the
+ * next call. Returns how many rects, 0 at the end of input.
+ */
+size_t read_rects(struct rect *batch)
+{
+	static char buf[READ_CHUNK + 1];
+	static size_t have; /* bytes kept from the last chunk */
+	size_t n = 0;
+
+	while (n == 0) {
+		ssize_t got = read(0, buf + have, READ_CHUNK - have);
+		size_t len, done = 0;
+		char *p, *end, cut;
+		int eof = got <= 0, half = 0;
+		long number[2];
+
+		if (eof && have == 0)
+			return 0;
+		len = have + (got > 0 ? (size_t)got : 0);
+
+		/* only numbers followed by white space are complete */
+		if (!eof) {
+			while (len > done && buf[len - 1] != ' ' && buf[len - 1] != '\n' &&
+			       buf[len - 1] != '\t' && buf[len - 1] != '\r')
+				len--;
+		}
+		cut = buf[len];
+		buf[len] = '\0';
+
+		for (p = buf; ; p = end) {
+			number[half] = strtol(p, &end, 10);
+			if (end == p) {
+				if (*p == '\0')
+					break;
+				end = p + 1; /* not a number: skip it */
+				continue;
+			}
+			if (half) {
+				batch[n].length = (int)number[0];
+				batch[n++].breadth = (int)number[1];
+				done = (size_t)(end - buf);
+			}
+			half ^= 1;
+		}
+
+		/* keep the unparsed tail: a half rect, and a cut-off number */
+		buf[len] = cut;
+		len = have + (got > 0 ? (size_t)got : 0);
+		if (eof || len - done >= READ_CHUNK / 2)
+			done = len;
+		memmove(buf, buf + done, len - done);
+		have = len - done;
+		if (eof)
+			return n;
+	}
+	return n;
+}
+
+int main(int argc, char *argv[])
 {
 	/*
 	 * Our background thread to sort the array
 	 * of rectangle structs
 	 */
-	pthread_t thread;
-	int index = 0;
+	pthread_t thread, print_thread;
+	uint64_t head = 0;
+	int lock_free = 0, incremental = 0, keyed = 0;
+	static struct rect batch[BATCH_MAX];
+	size_t n;
+	static const struct rect start[] = { {10, 2}, {34, 23}, {32, 3}, {2, 45}, {2, 12} };
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--lock-free") == 0)
+			lock_free = 1;
+		else if (strcmp(argv[i], "--incremental") == 0)
+			incremental = 1;
+		else if (strcmp(argv[i], "--keyed") == 0)
+			keyed = 1;
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+			rect_array_size = (size_t)atol(argv[++i]);
+		else {
+			printf("Usage: %s [--lock-free | --incremental | --keyed] [--size N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	r = alloc_rects(rect_array_size);
+	pending = alloc_rects(rect_array_size);
+	if (r == NULL || pending == NULL) {
+		printf("Out of memory\n");
+		return 1;
+	}
 	
 	/*
 	 * First initialise the rectangle struct to some values
 	 */
-	r[0].length = 10;
-	r[0].breadth = 2;
+	memset(r, 0, rect_array_size * sizeof *r);
+	for (size_t i = 0; i < rect_array_size && i < sizeof start / sizeof start[0]; i++)
+		r[i] = start[i];
 
-	r[1].length = 34;
-	r[1].breadth = 23;
-	
-	r[2].length = 32;
-	r[2].breadth = 3;
+	if (lock_free) {
+		unsigned long pushed = 0;
+		struct snapshot *s;
 
-	r[3].length = 2;
-	r[3].breadth = 45;
+		ring_init(&ring);
+		pthread_create(&thread, NULL, &lock_free_sorter, (void*)NULL);
+		pthread_create(&print_thread, NULL, &printer, (void*)NULL);
+		while ((n = read_rects(batch)) > 0) {
+			for (size_t i = 0; i < n; i++) {
+				/* only a full ring can hold us up, never the sort */
+				while (!ring_push(&ring, batch[i]))
+					sched_yield();
+			}
+			pushed += n;
+		}
 
-	r[4].length = 2;
-	r[4].breadth = 12;
+		/* end of input: show the array once everything has been sorted in */
+		for (;;) {
+			s = snapshot_get(1);
+			if (s != NULL && s->inputs == pushed)
+				break;
+			snapshot_put(1);
+			usleep(1000);
+		}
+		print_snapshot(s);
+		snapshot_put(1);
+		return 0;
+	}
 
 	/*
 	 * Init the mutexes and the pthread
 	 */
 	pthread_mutex_init(&lock, NULL);
-	pthread_create(&thread, NULL, &sorter, (void*)NULL);
+
+	if (incremental) {
+		pthread_create(&thread, NULL, &incremental_sorter, (void*)NULL);
+		while ((n = read_rects(batch)) > 0)
+			add_rects(batch, n);
+
+		/* end of input: let the sorter finish what it was given */
+		pthread_mutex_lock(&lock);
+		while (shown != arrived)
+			pthread_cond_wait(&caught_up, &lock);
+		pthread_mutex_unlock(&lock);
+		return 0;
+	}
+
+	pthread_create(&thread, NULL, &sorter, keyed ? (void*)&keyed : (void*)NULL);
 
 	/*
 	 * The main thread allows the user to input data i.e length
 	 * and breadth of the users rectangle. The length and breadth inputted 
 	 * are stored in a structure which is placed into the rectangle struct array.
 	 * The rectangle struct array is of fixed size. The size is defined by
-	 * RECT_ARRAY_SIZE. The array acts like a circular buffer.  
+	 * rect_array_size. The array acts like a circular buffer. head counts
+	 * every rect ever added; at 64 bits it does not wrap around.
 	 */
-	for (;;) {
-		struct rect temp_rect;
-		int length, breadth;
-
-		scanf("%d %d", &length, &breadth);
-
-		temp_rect.length = length;
-		temp_rect.breadth = breadth;
-
+	while ((n = read_rects(batch)) > 0) {
+		PROBE_BEGIN(wait, "input lock wait");
 		pthread_mutex_lock(&lock);
-		r[(index++)%RECT_ARRAY_SIZE] = temp_rect;
+		PROBE_END(wait);
+		PROBE_BEGIN(held, "input lock held");
+		for (size_t i = 0; i < n; i++)
+			r[(head++) % rect_array_size] = batch[i];
+		PROBE_END(held);
 		pthread_mutex_unlock(&lock);	
+		PROBE_VALUE("input batch", n);
 	}
+	PROBE_DUMP(); /* the program never exits by itself */
 
+	/* end of input: the sorter keeps on printing the array */
+	pthread_join(thread, NULL);
 	return 0;
 }
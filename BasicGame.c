@@ -2,7 +2,10 @@
 #include<stdio.h>
 #include<time.h>
 #include <stdbool.h>
-#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "Random.h"
 #define MAX 10
 #define A "P"
 #define B "Q"
@@ -10,162 +13,172 @@ int getRandom(int low, int high);
 int getValidInteger(int low, int high);
 unsigned int playerRoll(int low, int high);
 
-void seed(void)
+void seed(void) // seed this thread's generator from the OS; the first roll would anyway
 {
-	srand(time(NULL));
+	randomThread();
 }
-void space(unsigned int size) // create space
-{
-	printf("     ");
-}
-char getDisplayType(unsigned int index, unsigned int playerPosition, char playerName) // check the index and return character
+// the rules the board is drawn by: C (checkout) at 0; L (lose an item) at a
+// multiple of lose, G instead if it is a multiple of grand as well; W (win a
+// prize) at any other multiple of win; G (grand prize) at any other multiple
+// of grand. The game has always used 3, 5 and 7
+typedef struct
 {
+	unsigned int win, lose, grand;
+} BoardRules;
 
-	if (playerName != '#')
-	{
-		if (index == playerPosition)
-			return playerName;
-
-		if (index == 0)
-			return ('C');
-
-		if (index % 3 == 0)
-			if (index % 5 == 0)
-				if (index % 7 == 0)
-					return('G');
-				else return ('L');
-			else return ('W');
-
-		if (index % 5 == 0)
-			if (index % 7 == 0)
-				return('G');
-			else return ('L');
-
-		if (index % 7 == 0) {
-			return('G');
-		}
-		else return (' ');
-	}
-
-	if (playerName == '#')
-	{
-
-		if (index == 0)
-			return ('C');
-
-		if (index % 3 == 0) {
-			if (index % 5 == 0) {
-				if (index % 7 == 0) {
-					return('G');
-				}
-				else return ('L');
-			}
-			else return ('W');
-		}
-
-		if (index % 5 == 0) {
-			if (index % 7 == 0) {
-				return('G');
-			}
-			else return ('L');
-		}
-		if (index % 7 == 0) {
-			return('G');
-		}
-		else
-			return (' ');
-
+static const BoardRules classicRules = { 3, 5, 7 };
 
+char cellType(unsigned int index, BoardRules rules)
+{
+	if (index == 0)
+		return ('C');
+	if (index % rules.lose == 0 || (index % rules.win != 0 && index % rules.grand == 0))
+		return index % rules.grand == 0 ? 'G' : 'L';
+	if (index % rules.win == 0)
+		return ('W');
+	return (' ');
+}
 
-	}
+char getDisplayType(unsigned int index, unsigned int playerPosition, char playerName) // check the index and return character
+{
+	if (playerName != '#' && index == playerPosition)
+		return playerName;
+	return cellType(index, classicRules);
 }
-void firstLine(unsigned int size) // create the upper line of the square  for the first and last line
+// The board is drawn from a frame built once per size: the whole picture
+// as text, the type of every square and where each square's letter sits
+// in it. Moving the player patches two letters, the old square back to
+// its type and the new one to the player's name, and the frame goes out
+// in a single fwrite instead of a few printf calls per square.
+typedef struct
 {
-	int i;
-
-	for (i = 0; i < size; i++)
+	unsigned int size, cells; // cells = 4 * (size - 1) squares around the edge
+	char *text;
+	size_t len;
+	char *type; // type[i], the letter of square i
+	size_t *at; // text[at[i]] shows square i
+	unsigned int shown; // the square showing the player, or cells for none
+} BoardFrame;
+
+// one line of count squares: " ___ " tops (c == 0), "|___|" bottoms
+// (c == 1), or "| x |" with the letters of the squares in index[]
+static void frameRow(BoardFrame *f, unsigned int count, int c, const unsigned int *index)
+{
+	unsigned int j;
+	for (j = 0; j < count; j++)
 	{
-		printf(" ___ ");
+		memcpy(f->text + f->len, c == 0 ? " ___ " : c == 1 ? "|___|" : "|   |", 5);
+		if (c == 2)
+		{
+			f->at[index[j]] = f->len + 2;
+			f->text[f->len + 2] = f->type[index[j]];
+		}
+		f->len += 5;
 	}
-	printf("\n");
+	f->text[f->len++] = '\n';
 }
 
-void secondLine(unsigned int size, unsigned int i, unsigned int playerPosition, char playerName) //create the inside and return the type for the first line
+// the outer boxes of a middle row, its two squares left and right and the
+// size - 2 gaps between them
+static void frameSides(BoardFrame *f, const char *left, const char *right, int c, unsigned int l, unsigned int r)
 {
-	int x, j;
-	for (j = 0; j < size; j++)
+	unsigned int j;
+	size_t n = strlen(left);
+	memcpy(f->text + f->len, left, n);
+	if (c == 2)
 	{
-		x = j;
-		printf("| %c |", getDisplayType(x, playerPosition, playerName));
+		f->at[l] = f->len + 2;
+		f->text[f->len + 2] = f->type[l];
 	}
-	printf("\n");
-}
-
-void secondLine2nd(unsigned int size, unsigned int i, unsigned int playerPosition, char playerName) { //create the inside and return the type for the last line
-	int x, y, z;
-	y = 3 * (size - 1);
-	printf("| %c |", getDisplayType(y, playerPosition, playerName));
-	for (i = 0; i < size - 2; i++)
+	f->len += n;
+	for (j = 0; j + 2 < f->size; j++)
 	{
-		z = 2 * (size - 1) + ((size - 2) - i);
-		printf("| %c |", getDisplayType(z, playerPosition, playerName));
+		memcpy(f->text + f->len, "     ", 5);
+		f->len += 5;
 	}
-	x = size + i;
-	printf("| %c |", getDisplayType(x, playerPosition, playerName));
-
-
-	printf("\n");
-}
-
-
-void thirdLine(unsigned int size) // create lower line for the first and last line
-{
-	int i;
-
-	for (i = 0; i < size; i++)
+	n = strlen(right);
+	memcpy(f->text + f->len, right, n);
+	if (c == 2)
 	{
-		printf("|___|");
+		f->at[r] = f->len + 2;
+		f->text[f->len + 2] = f->type[r];
 	}
-	printf("\n");
+	f->len += n;
+	f->text[f->len++] = '\n';
 }
-void upperrow(unsigned int size) // create the upper line for the square of the row
+
+void frameFree(BoardFrame *f)
 {
-	int i;
-	printf(" ___");
-	for (i = 0; i < size - 2; i++) {
-		space(size);
-	}
-	printf("  ___");
-	printf("\n");
+	free(f->text);
+	free(f->type);
+	free(f->at);
+	memset(f, 0, sizeof *f);
 }
 
-void lowerrow(unsigned int size) //create the lower line for the square of the row
+// 0, or -1 when out of memory
+int frameBuild(BoardFrame *f, unsigned int size)
 {
-	int i;
-	printf("|___|");
-	for (i = 0; i < size - 2; i++) {
-		space(size);
+	unsigned int i, cells = size > 1 ? 4 * (size - 1) : 0, *index;
+	frameFree(f);
+	if (size == 0)
+		return -1;
+	f->size = size;
+	f->cells = cells;
+	f->shown = cells;
+	// 3 size lines of at most 5 size characters and a newline
+	f->text = malloc(3 * ((size_t)size + 1) * (5 * (size_t)size + 1));
+	f->type = malloc(cells + 1);
+	f->at = malloc((cells + 1) * sizeof(size_t));
+	index = malloc(((size_t)size + 1) * sizeof(unsigned int));
+	if (f->text == NULL || f->type == NULL || f->at == NULL || index == NULL)
+	{
+		free(index);
+		frameFree(f);
+		return -1;
 	}
-
-	printf("|___|");
-	printf("\n");
+	if (size == 1)
+	{
+		f->len = strlen(strcpy(f->text, "  ___ \n | ? | \n |___|\n"));
+		free(index);
+		return 0;
+	}
+	for (i = 0; i < cells; i++)
+		f->type[i] = cellType(i, classicRules);
+	// the top row runs 0 .. size - 1 left to right
+	for (i = 0; i < size; i++)
+		index[i] = i;
+	frameRow(f, size, 0, NULL);
+	frameRow(f, size, 2, index);
+	frameRow(f, size, 1, NULL);
+	// down the sides, the right one going on from the top row and the left
+	// one coming back up to 0
+	for (i = 1; i < size - 1; i++)
+	{
+		frameSides(f, " ___", "  ___", 0, 0, 0);
+		frameSides(f, "| x |", "| x |", 2, 3 * (size - 1) + (size - 1 - i), size - 1 + i);
+		frameSides(f, "|___|", "|___|", 1, 0, 0);
+	}
+	// the bottom row runs 3 (size - 1) down to 2 (size - 1) left to right
+	for (i = 0; i < size; i++)
+		index[i] = 3 * (size - 1) - i;
+	frameRow(f, size, 0, NULL);
+	frameRow(f, size, 2, index);
+	frameRow(f, size, 1, NULL);
+	free(index);
+	return 0;
 }
 
-void middlerow(unsigned int size, unsigned int i, unsigned int playerPosition, char playerName) //create the inside and return the type for the square of the row
+// move the player's letter to playerPosition, wrapped onto the board
+void frameShow(BoardFrame *f, unsigned int playerPosition, char playerName)
 {
-	int q, b, p;
-	b = i;
-	q = 3 * (size - 1) + ((size - 1) - i);
-	printf("| %c |", getDisplayType(q, playerPosition, playerName));
-	for (b = 0; b < size - 2; b++) {
-		space(size);
-	}
-	p = size - 1 + i;
-	printf("| %c |", getDisplayType(p, playerPosition, playerName));
-	printf("\n");
+	if (f->cells == 0)
+		return;
+	if (f->shown < f->cells)
+		f->text[f->at[f->shown]] = f->type[f->shown];
+	f->shown = playerPosition % f->cells;
+	f->text[f->at[f->shown]] = playerName;
 }
 
-
 char getValidCharacter(char a, char b) //make sure the character input is right//
 {
 	char c, choice;
@@ -194,10 +207,12 @@ int getValidInteger(int low, int high) //validate the input number//
 	return choice;
 }
 
-int getRandom(int low, int high) //get a rando number
+int getRandom(int low, int high) //get a rando number in [low, high), without the bias of rand() % n
 {
 	int a;
-	a = rand() % (high - low) + low;
+	if (high <= low)
+		return low;
+	a = (int)randomBelow((uint32_t)(high - low)) + low;
 
 	return a;
 }
@@ -323,64 +338,17 @@ void initPlayer(int *playerScore, int playerPrizes[], unsigned int *prizeCount,
 
 void displayBoard(unsigned int size, unsigned int playerPosition, char playerName) //display the boardgame
 {
-
-	int k, size1, loop;
-	float loop2, playerPosition1, size2;
-	//printf("player name in display board: %c\n", playerName);
-	//printf("%d\n", r);
-	//printf("%d", playerPosition);
-	playerPosition1 = (float)playerPosition;
-	size1 = (4 * (size - 1));
-
-	size2 = (float)size1;
-	//printf("size2: %.2f\n", size2);
-	// printf("playerPo1: %.2f\n", playerPosition1);
-	//playerPosition2 = float size;
-	//printf("playerPos: %d\n", playerPosition);
-	loop2 = playerPosition1 / size2;
-
-	loop = trunc(loop2);
-
-
-	k = playerPosition - (4 * (size - 1))*loop;
-
-	playerPosition = k;
-
+	static BoardFrame frame;
+	if (frame.text == NULL || frame.size != size)
 	{
-		int i = 0;
-		if (size == 1)
+		if (frameBuild(&frame, size) != 0)
 		{
-			printf("  ___ \n");
-			printf(" | ? | \n");
-			printf(" |___|");
-			printf("\n");
-		}
-		else {
-
-			for (i = 0; i < size - 1; i++)
-			{
-
-				if (i == 0)
-				{
-					firstLine(size);
-					secondLine(size, i, playerPosition, playerName);
-					thirdLine(size);
-				}
-			}
-			for (i = 1; i < size - 1; i++)
-			{
-				upperrow(size);
-				middlerow(size, i, playerPosition, playerName);
-				lowerrow(size);
-			}
-			for (i = size - 2; i < size - 1; i++)
-			{
-				firstLine(size);
-				secondLine2nd(size, i, playerPosition, playerName);
-				thirdLine(size);
-			}
+			printf("The board is too big to draw\n");
+			return;
 		}
 	}
+	frameShow(&frame, playerPosition, playerName);
+	fwrite(frame.text, 1, frame.len, stdout);
 }
 
 int checkout(int *playerScore, int playerPrizes[], unsigned int* prizeCount) //do the checkout
@@ -408,6 +376,7 @@ void playGame(unsigned int size, int *playerScore, int playerPrizes[], unsigned
 	//printf("%d\n",*prizeCount);
 	//printf("%d\n", *playerScore);
 	int i, l = 1;
+	char square;
 	while (l)
 	{
 		displayBoard(size, *playerPosition, *playerName);
@@ -424,21 +393,22 @@ void playGame(unsigned int size, int *playerScore, int playerPrizes[], unsigned
 		//printf("player position in display %d\n", *playerPosition);
 		//printf("display type in play game: %c\n", getDisplayType(*playerPosition, *playerPosition, '#'));
 		//displayBoard(boardSize, playerPosition, playerName);
-		if (getDisplayType(*playerPosition, *playerPosition, '#') == 'G')
+		square = getDisplayType(*playerPosition, *playerPosition, '#');
+		if (square == 'G')
 		{
 			winGrandPrize(playerPrizes, prizeCount);
 		}
-		else if (getDisplayType(*playerPosition, *playerPosition, '#') == 'W')
+		else if (square == 'W')
 		{
 
 			winPrize(playerPrizes, prizeCount);
 		}
-		else if (getDisplayType(*playerPosition, *playerPosition, '#') == 'L')
+		else if (square == 'L')
 		{
 
 			loseItem(playerPrizes, prizeCount);
 		}
-		else if (getDisplayType(*playerPosition, *playerPosition, '#') == 'C')
+		else if (square == 'C')
 		{
 
 
@@ -459,7 +429,352 @@ void playGame(unsigned int size, int *playerScore, int playerPrizes[], unsigned
 
 
 
-int main(void)
+// Headless play, for tuning the board by simulation: --simulate plays many
+// games with no board drawn and no input read. A strategy picks how many
+// dice to roll each turn; the rest follows playGame(), except that the
+// position wraps with % so a long roll on a small board stays on it. Each
+// thread plays its share of the games with its own generator from Random.h,
+// and takes its dice from rollMany() a buffer at a time.
+#define SIM_ROLLS 4096
+#define SIM_MAX_TURNS 100000 // a game still going after this many turns is given up
+#define SIM_TURN_HIST 1024 // turns to win counted one by one up to here
+#define SIM_SCORE_STEP 100 // the final score histogram, from 200 in steps of this
+#define SIM_SCORE_BUCKETS 10
+#define SIM_MAX_THREADS 64
+#define SIM_DIE 5 // playerRoll(1, 6) rolls getRandom(1, 6), which is 1 to 5
+
+typedef struct
+{
+	unsigned int cells; // 4 * (size - 1) squares around the edge
+	char cell[4096];
+	double diceSum[4][3 * SIM_DIE + 1]; // diceSum[k][s]: the chance k dice add up to s
+} SimBoard;
+
+typedef struct
+{
+	int score;
+	int prizes[MAX];
+	unsigned int prizeCount;
+	unsigned int position;
+	unsigned long long turns;
+} SimPlayer;
+
+// 1 to 3, the dice to roll this turn
+typedef int (*SimStrategy)(const SimBoard *board, const SimPlayer *player);
+
+typedef struct
+{
+	unsigned long long games, finished, turns, won, grand, lost, full;
+	unsigned long long turnHist[SIM_TURN_HIST + 1];
+	unsigned long long scoreHist[SIM_SCORE_BUCKETS];
+	double score;
+} SimStats;
+
+typedef struct
+{
+	const SimBoard *board;
+	SimStrategy strategy;
+	unsigned long long games;
+	SimStats stats;
+} SimJob;
+
+// the fixed and random strategies look at neither the board nor the player
+int simOne(const SimBoard *board, const SimPlayer *player)
+{
+	(void)board;
+	(void)player;
+	return 1;
+}
+
+int simTwo(const SimBoard *board, const SimPlayer *player)
+{
+	(void)board;
+	(void)player;
+	return 2;
+}
+
+int simThree(const SimBoard *board, const SimPlayer *player)
+{
+	(void)board;
+	(void)player;
+	return 3;
+}
+
+int simRandom(const SimBoard *board, const SimPlayer *player)
+{
+	(void)board;
+	(void)player;
+	return 1 + (int)randomBelow(3);
+}
+
+// the dice with the best expected gain on the square they land on: a prize's
+// mean if there is room for it, minus an item's mean on L, and on C the
+// inventory, with a bonus when it would win the game
+int simGreedy(const SimBoard *board, const SimPlayer *player)
+{
+	double held = 0, best = -1e30;
+	int k, s, pick = 1;
+	unsigned int i;
+	for (i = 0; i < player->prizeCount; i++)
+		held += player->prizes[i];
+	for (k = 1; k <= 3; k++)
+	{
+		double gain = 0;
+		for (s = k; s <= k * SIM_DIE; s++)
+		{
+			double value = 0;
+			switch (board->cell[(player->position + s) % board->cells])
+			{
+			case 'W':
+				value = player->prizeCount < MAX ? 54.5 : 0;
+				break;
+			case 'G':
+				value = player->prizeCount < MAX ? 149.5 : 0;
+				break;
+			case 'L':
+				value = player->prizeCount > 0 ? -held / player->prizeCount : 0;
+				break;
+			case 'C':
+				value = held + (player->score + held >= 200 ? 1000 : 0);
+				break;
+			}
+			gain += board->diceSum[k][s] * value;
+		}
+		if (gain > best)
+		{
+			best = gain;
+			pick = k;
+		}
+	}
+	return pick;
+}
+
+static const struct
+{
+	const char *name;
+	SimStrategy play;
+} simStrategies[] = {
+	{ "one", simOne }, { "two", simTwo }, { "three", simThree }, { "random", simRandom }, { "greedy", simGreedy },
+};
+
+int simInit(SimBoard *board, unsigned int size, BoardRules rules)
+{
+	int k, s, d;
+	unsigned int i;
+	if (size < 2 || 4 * (size - 1) > sizeof board->cell || rules.win == 0 || rules.lose == 0 || rules.grand == 0)
+		return -1;
+	board->cells = 4 * (size - 1);
+	for (i = 0; i < board->cells; i++)
+		board->cell[i] = cellType(i, rules);
+	memset(board->diceSum, 0, sizeof board->diceSum);
+	board->diceSum[0][0] = 1;
+	for (k = 1; k <= 3; k++)
+		for (s = 0; s <= (k - 1) * SIM_DIE; s++)
+			for (d = 1; d <= SIM_DIE; d++)
+				board->diceSum[k][s + d] += board->diceSum[k - 1][s] / SIM_DIE;
+	return 0;
+}
+
+void *simPlay(void *arg)
+{
+	SimJob *job = arg;
+	const SimBoard *board = job->board;
+	SimStats *st = &job->stats;
+	int roll[SIM_ROLLS];
+	size_t used = SIM_ROLLS;
+	unsigned long long g;
+	memset(st, 0, sizeof *st);
+	for (g = 0; g < job->games; g++)
+	{
+		SimPlayer p;
+		int done = 0;
+		memset(&p, 0, sizeof p);
+		while (!done && p.turns < SIM_MAX_TURNS)
+		{
+			int k = job->strategy(board, &p), move = 0;
+			unsigned int i;
+			k = k < 1 ? 1 : k > 3 ? 3 : k;
+			if (used + k > SIM_ROLLS)
+			{
+				rollMany(SIM_DIE, SIM_ROLLS, roll);
+				used = 0;
+			}
+			while (k-- > 0)
+				move += roll[used++];
+			p.position = (p.position + move) % board->cells;
+			p.turns++;
+			switch (board->cell[p.position])
+			{
+			case 'W':
+			case 'G':
+				if (p.prizeCount == MAX)
+				{
+					st->full++;
+					break;
+				}
+				if (board->cell[p.position] == 'W')
+				{
+					p.prizes[p.prizeCount++] = getRandom(10, 100);
+					st->won++;
+				}
+				else
+				{
+					p.prizes[p.prizeCount++] = getRandom(100, 200);
+					st->grand++;
+				}
+				break;
+			case 'L':
+				if (p.prizeCount > 0)
+				{
+					// which one goes does not matter, only what is left
+					i = (unsigned int)getRandom(0, p.prizeCount);
+					p.prizes[i] = p.prizes[--p.prizeCount];
+					st->lost++;
+				}
+				break;
+			case 'C':
+				for (i = 0; i < p.prizeCount; i++)
+					p.score += p.prizes[i];
+				p.prizeCount = 0;
+				done = p.score >= 200;
+				break;
+			}
+		}
+		st->games++;
+		st->turns += p.turns;
+		if (done)
+		{
+			unsigned int bucket = (unsigned int)(p.score - 200) / SIM_SCORE_STEP;
+			st->finished++;
+			st->score += p.score;
+			st->turnHist[p.turns < SIM_TURN_HIST ? p.turns : SIM_TURN_HIST]++;
+			st->scoreHist[bucket < SIM_SCORE_BUCKETS ? bucket : SIM_SCORE_BUCKETS - 1]++;
+		}
+	}
+	return NULL;
+}
+
+// the least t with at least q of the finished games won in t turns or
+// fewer; SIM_TURN_HIST stands for more
+unsigned int simPercentile(const SimStats *st, double q)
+{
+	unsigned long long seen = 0;
+	unsigned int t;
+	for (t = 0; t < SIM_TURN_HIST; t++)
+	{
+		seen += st->turnHist[t];
+		if (seen >= q * st->finished)
+			break;
+	}
+	return t;
+}
+
+int simulate(unsigned long long games, unsigned int size, SimStrategy strategy, int threads, BoardRules rules)
+{
+	static SimBoard board;
+	static SimJob job[SIM_MAX_THREADS];
+	pthread_t id[SIM_MAX_THREADS];
+	SimStats all;
+	struct timespec t0, t1;
+	double seconds;
+	int t, b, k;
+	if (simInit(&board, size, rules) != 0 || threads < 1 || threads > SIM_MAX_THREADS)
+	{
+		printf("Needs a board size of 2 to %d, rules of 1 or more and 1 to %d threads\n",
+			(int)sizeof board.cell / 4 + 1, SIM_MAX_THREADS);
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (t = 0; t < threads; t++)
+	{
+		job[t].board = &board;
+		job[t].strategy = strategy;
+		job[t].games = games / threads + ((unsigned long long)t < games % threads);
+		if (t > 0 && pthread_create(&id[t], NULL, simPlay, &job[t]) != 0)
+		{
+			printf("Cannot start thread %d\n", t);
+			return 1;
+		}
+	}
+	simPlay(&job[0]);
+	memset(&all, 0, sizeof all);
+	for (t = 0; t < threads; t++)
+	{
+		if (t > 0)
+			pthread_join(id[t], NULL);
+		all.games += job[t].stats.games;
+		all.finished += job[t].stats.finished;
+		all.turns += job[t].stats.turns;
+		all.won += job[t].stats.won;
+		all.grand += job[t].stats.grand;
+		all.lost += job[t].stats.lost;
+		all.full += job[t].stats.full;
+		all.score += job[t].stats.score;
+		for (k = 0; k <= SIM_TURN_HIST; k++)
+			all.turnHist[k] += job[t].stats.turnHist[k];
+		for (b = 0; b < SIM_SCORE_BUCKETS; b++)
+			all.scoreHist[b] += job[t].stats.scoreHist[b];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	seconds = t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	printf("%llu games on a board of size %u (%u squares), rules %u/%u/%u, %d threads: %.3f s, %.0f games/s\n",
+		all.games, size, board.cells, rules.win, rules.lose, rules.grand, threads, seconds, all.games / seconds);
+	printf("finished %llu (%.2f%%), %.2f turns per game\n", all.finished,
+		100.0 * all.finished / all.games, (double)all.turns / all.games);
+	if (all.finished == 0)
+		return 0;
+	printf("turns to win: 10%% %u, median %u, 90%% %u, 99%% %u (%u means more than %u)\n", simPercentile(&all, 0.1),
+		simPercentile(&all, 0.5), simPercentile(&all, 0.9), simPercentile(&all, 0.99), SIM_TURN_HIST, SIM_TURN_HIST - 1);
+	printf("per game: %.2f prizes, %.2f grand prizes, %.2f lost, %.2f missed with a full inventory\n",
+		(double)all.won / all.games, (double)all.grand / all.games, (double)all.lost / all.games, (double)all.full / all.games);
+	printf("final score: mean %.1f\n", all.score / all.finished);
+	for (b = 0; b < SIM_SCORE_BUCKETS; b++)
+		printf("  %4d%s %6.2f%%\n", 200 + b * SIM_SCORE_STEP, b == SIM_SCORE_BUCKETS - 1 ? "+" : " ",
+			100.0 * all.scoreHist[b] / all.finished);
+	return 0;
+}
+
+int simMain(int argc, char *argv[])
+{
+	unsigned long long games = 1000000;
+	unsigned int size = 8;
+	int i, s, threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	SimStrategy strategy = simGreedy;
+	BoardRules rules = classicRules;
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+			games = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%u,%u,%u", &rules.win, &rules.lose, &rules.grand) != 3)
+				break;
+		}
+		else if (strcmp(argv[i], "--strategy") == 0 && i + 1 < argc)
+		{
+			i++;
+			for (s = 0; s < (int)(sizeof simStrategies / sizeof simStrategies[0]); s++)
+				if (strcmp(argv[i], simStrategies[s].name) == 0)
+					strategy = simStrategies[s].play;
+		}
+		else
+			break;
+	}
+	if (i < argc)
+	{
+		printf("Usage: %s --simulate [--games N] [--size S] [--strategy one|two|three|random|greedy]\n"
+			"       [--threads T] [--rules WIN,LOSE,GRAND]\n", argv[0]);
+		return 1;
+	}
+	return simulate(games, size, strategy, threads < 1 ? 1 : threads, rules);
+}
+
+int main(int argc, char *argv[])
 {
 	int i, l = 1;
 	char a, choice;
@@ -470,6 +785,8 @@ int main(void)
 	char playerName;
 	unsigned int size;
 	unsigned int playerPosition;
+	if (argc > 1 && strcmp(argv[1], "--simulate") == 0)
+		return simMain(argc, argv);
 	printf("Welcome to CHECKOUT\n");
 	while (l) {
 		printf("Main Menu\n");
@@ -0,0 +1,695 @@
+// Arbitrary-size non-negative integers, for large_factorial.c and
+// RussianPeasantMultiplication.c.
+//
+// A BigNum is an array of limbs in base 10^9, lowest first, so printing
+// it is a printf of each limb and nothing has to be converted. len counts
+// the live limbs (0 for the number 0, and the top limb is never 0), and
+// every loop runs over those only. cap is what has been allocated; it at
+// least doubles when it grows.
+//
+// A limb times a multiplier below BIG_SMALL_MAX plus the carry fits in 64
+// bits, so bigMulSmall() takes multipliers up to about 1.8e10, which is
+// several small factors at once.
+//
+// bigMul() picks by the length of the shorter factor:
+//   - below BIG_KARATSUBA limbs, schoolbook;
+//   - Karatsuba: split both at half the longer one, and a0 b0, a1 b1 and
+//     (a0 + a1)(b0 + b1) give the product in three half-size multiplies
+//     instead of four. A much longer factor is cut into pieces the size
+//     of the shorter one first;
+//   - from BIG_TOOM3 limbs, when the factors are close enough in length,
+//     Toom-3: both split in three, the two degree-2 polynomials evaluated
+//     at 0, 1, -1, -2 and infinity, five multiplies of a third of the
+//     size, and the product's five coefficients interpolated back
+//     (Bodrato's sequence: exact divisions by 2 and 3 only);
+//   - from BIG_NTT limbs, a number-theoretic transform: the limbs are
+//     convolved mod two primes just below 2^62 (each limb product is below
+//     2^60, so a coefficient is below 2^85 and the two residues pin it
+//     down), joined by CRT and carried back into base 10^9. That is
+//     O(n log n). It needs unsigned __int128; without it Karatsuba goes
+//     all the way.
+// The crossovers are read from bigThresholds, which starts at the
+// BIG_... values; the --bench mode of RussianPeasantMultiplication.c
+// times the algorithms against each other.
+//
+// bigProduct() multiplies a list of small numbers as a balanced tree, so
+// the big multiplies are between numbers of about the same size.
+//
+// Functions that can grow a number return 0, or -1 when out of memory,
+// and then leave it as it was. Header-only.
+
+#ifndef BIG_NUM_H
+#define BIG_NUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ModArith.h"
+
+#define BIG_BASE 1000000000u
+#define BIG_DIGITS 9                         // decimal digits per limb
+#define BIG_SMALL_MAX 18000000000ULL         // 10^9 * BIG_SMALL_MAX < 2^64
+#define BIG_KARATSUBA 32                     // limbs
+#define BIG_TOOM3 128                        // limbs
+#define BIG_NTT 512                          // limbs
+#define BIG_PRODUCT_LEAF 16                  // bigProduct() values per leaf
+#define BIG_NTT_P1 0x3fffffee00000001ULL     // 1073741806 * 2^32 + 1
+#define BIG_NTT_G1 3                         // a generator mod BIG_NTT_P1
+#define BIG_NTT_P2 0x3fffffb400000001ULL     // 268435437 * 2^34 + 1
+#define BIG_NTT_G2 19
+
+typedef struct
+{
+    uint32_t *limb;
+    size_t len, cap;
+} BigNum;
+
+// Where bigMul() switches algorithm, by the length of the shorter factor.
+// One copy per program, not per thread: change it before multiplying.
+typedef struct
+{
+    size_t karatsuba, toom3, ntt;
+} BigThresholds;
+
+static BigThresholds bigThresholds = {BIG_KARATSUBA, BIG_TOOM3, BIG_NTT};
+
+static inline void bigInit(BigNum *b)
+{
+    b->limb = NULL;
+    b->len = b->cap = 0;
+}
+
+static inline void bigFree(BigNum *b)
+{
+    free(b->limb);
+    bigInit(b);
+}
+
+// Room for n limbs
+static inline int bigReserve(BigNum *b, size_t n)
+{
+    uint32_t *limb;
+    size_t cap = b->cap;
+
+    if (n <= b->cap)
+        return 0;
+    while (cap < n)
+        cap = cap < 4 ? 4 : cap * 2;
+    limb = (uint32_t *)realloc(b->limb, cap * sizeof(uint32_t));
+    if (limb == NULL)
+        return -1;
+    b->limb = limb;
+    b->cap = cap;
+    return 0;
+}
+
+static inline int bigSetU64(BigNum *b, uint64_t v)
+{
+    if (bigReserve(b, 3) != 0)
+        return -1;
+    for (b->len = 0; v != 0; v /= BIG_BASE)
+        b->limb[b->len++] = (uint32_t)(v % BIG_BASE);
+    return 0;
+}
+
+static inline int bigCopy(BigNum *to, const BigNum *from)
+{
+    if (bigReserve(to, from->len) != 0)
+        return -1;
+    if (from->len != 0)
+        memcpy(to->limb, from->limb, from->len * sizeof(uint32_t));
+    to->len = from->len;
+    return 0;
+}
+
+// Reads a decimal number; returns 0, or -1 when out of memory or s has
+// anything but digits (and is then left as 0)
+static inline int bigFromString(BigNum *b, const char *s)
+{
+    size_t n = strlen(s), i, k;
+
+    b->len = 0;
+    if (n == 0 || strspn(s, "0123456789") != n)
+        return -1;
+    if (bigReserve(b, (n + BIG_DIGITS - 1) / BIG_DIGITS) != 0)
+        return -1;
+    // limbs from the end of the string, BIG_DIGITS digits at a time
+    for (i = n; i > 0; i = k)
+    {
+        uint32_t v = 0;
+        size_t j;
+        k = i > BIG_DIGITS ? i - BIG_DIGITS : 0;
+        for (j = k; j < i; j++)
+            v = v * 10 + (uint32_t)(s[j] - '0');
+        b->limb[b->len++] = v;
+    }
+    while (b->len > 0 && b->limb[b->len - 1] == 0)
+        b->len--;
+    return 0;
+}
+
+// b = limb[0 .. n) with the top zero limbs left off
+static inline int bigFromLimbs(BigNum *b, const uint32_t *limb, size_t n)
+{
+    while (n > 0 && limb[n - 1] == 0)
+        n--;
+    if (bigReserve(b, n) != 0)
+        return -1;
+    if (n != 0)
+        memcpy(b->limb, limb, n * sizeof(uint32_t));
+    b->len = n;
+    return 0;
+}
+
+// b *= x for x < BIG_SMALL_MAX
+static inline int bigMulSmall(BigNum *b, uint64_t x)
+{
+    uint64_t carry = 0;
+    size_t i;
+
+    if (x == 0 || b->len == 0)
+    {
+        b->len = 0;
+        return 0;
+    }
+    // the carry is below x, so up to two more limbs
+    if (bigReserve(b, b->len + 2) != 0)
+        return -1;
+    for (i = 0; i < b->len; i++)
+    {
+        uint64_t t = b->limb[i] * x + carry;
+        b->limb[i] = (uint32_t)(t % BIG_BASE);
+        carry = t / BIG_BASE;
+    }
+    for (; carry != 0; carry /= BIG_BASE)
+        b->limb[b->len++] = (uint32_t)(carry % BIG_BASE);
+    return 0;
+}
+
+// out = a + b; out may be a or b
+static inline int bigAdd(BigNum *out, const BigNum *a, const BigNum *b)
+{
+    const BigNum *longer = a->len >= b->len ? a : b, *shorter = a->len >= b->len ? b : a;
+    size_t i, n = longer->len, k = shorter->len;
+    uint32_t carry = 0;
+
+    if (bigReserve(out, n + 1) != 0)
+        return -1;
+    for (i = 0; i < n; i++)
+    {
+        uint32_t s = longer->limb[i] + (i < k ? shorter->limb[i] : 0) + carry;
+        carry = s >= BIG_BASE;
+        out->limb[i] = carry ? s - BIG_BASE : s;
+    }
+    out->len = n;
+    if (carry)
+        out->limb[out->len++] = 1;
+    return 0;
+}
+
+// -1, 0 or 1 as a < b, a == b or a > b
+static inline int bigCompare(const BigNum *a, const BigNum *b)
+{
+    size_t i;
+
+    if (a->len != b->len)
+        return a->len < b->len ? -1 : 1;
+    for (i = a->len; i > 0; i--)
+        if (a->limb[i - 1] != b->limb[i - 1])
+            return a->limb[i - 1] < b->limb[i - 1] ? -1 : 1;
+    return 0;
+}
+
+// out = a - b for a >= b; out may be a or b
+static inline int bigSub(BigNum *out, const BigNum *a, const BigNum *b)
+{
+    size_t i, n = a->len;
+    uint32_t borrow = 0;
+
+    if (bigReserve(out, n) != 0)
+        return -1;
+    for (i = 0; i < n; i++)
+    {
+        uint32_t t = (i < b->len ? b->limb[i] : 0) + borrow;
+        borrow = a->limb[i] < t;
+        out->limb[i] = borrow ? a->limb[i] + BIG_BASE - t : a->limb[i] - t;
+    }
+    out->len = n;
+    while (out->len > 0 && out->limb[out->len - 1] == 0)
+        out->len--;
+    return 0;
+}
+
+// b /= d for d >= 1; returns the remainder
+static inline uint32_t bigDivSmall(BigNum *b, uint32_t d)
+{
+    uint64_t rem = 0;
+    size_t i;
+
+    for (i = b->len; i > 0; i--)
+    {
+        uint64_t t = rem * BIG_BASE + b->limb[i - 1];
+        b->limb[i - 1] = (uint32_t)(t / d);
+        rem = t % d;
+    }
+    while (b->len > 0 && b->limb[b->len - 1] == 0)
+        b->len--;
+    return (uint32_t)rem;
+}
+
+// out = a + b with signs, a negative when an is 1 and b when bn is 1; the
+// sign of out goes to *on. out may be a or b.
+static inline int bigAddSigned(BigNum *out, int *on, const BigNum *a, int an, const BigNum *b, int bn)
+{
+    int c;
+
+    if (an == bn)
+    {
+        *on = an && (a->len != 0 || b->len != 0);
+        return bigAdd(out, a, b);
+    }
+    c = bigCompare(a, b);
+    *on = c == 0 ? 0 : c > 0 ? an : bn;
+    return c >= 0 ? bigSub(out, a, b) : bigSub(out, b, a);
+}
+
+// r[0 .. na + nb) = a * b; r must not overlap a or b
+static inline void bigMulSchool(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r)
+{
+    size_t i, j;
+
+    memset(r, 0, (na + nb) * sizeof(uint32_t));
+    for (i = 0; i < na; i++)
+    {
+        uint64_t carry = 0, x = a[i];
+        // r[i + j] + x * limb + carry stays below 10^18 + 10^9
+        for (j = 0; j < nb; j++)
+        {
+            uint64_t t = r[i + j] + x * b[j] + carry;
+            r[i + j] = (uint32_t)(t % BIG_BASE);
+            carry = t / BIG_BASE;
+        }
+        r[i + nb] = (uint32_t)carry;
+    }
+}
+
+// r[0 .. n) += a[0 .. na), na <= n; the sum has to fit in n limbs
+static inline void bigAddAt(uint32_t *r, size_t n, const uint32_t *a, size_t na)
+{
+    uint32_t carry = 0;
+    size_t i;
+
+    for (i = 0; i < na; i++)
+    {
+        uint32_t t = r[i] + a[i] + carry;
+        carry = t >= BIG_BASE;
+        r[i] = carry ? t - BIG_BASE : t;
+    }
+    for (; carry && i < n; i++)
+    {
+        carry = r[i] == BIG_BASE - 1;
+        r[i] = carry ? 0 : r[i] + 1;
+    }
+}
+
+// r[0 .. n) -= a[0 .. na), na <= n; r must be at least a
+static inline void bigSubAt(uint32_t *r, size_t n, const uint32_t *a, size_t na)
+{
+    uint32_t borrow = 0;
+    size_t i;
+
+    for (i = 0; i < na; i++)
+    {
+        uint32_t t = a[i] + borrow;
+        borrow = r[i] < t;
+        r[i] = borrow ? r[i] + BIG_BASE - t : r[i] - t;
+    }
+    for (; borrow && i < n; i++)
+    {
+        borrow = r[i] == 0;
+        r[i] = borrow ? BIG_BASE - 1 : r[i] - 1;
+    }
+}
+
+static inline int bigMulRaw(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r);
+
+// bigMulRaw() for na >= nb > na / 2
+static inline int bigMulKaratsuba(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r)
+{
+    // a = a1 B^h + a0 and b = b1 B^h + b0
+    size_t h = na / 2, la = na - h + 1, lb = (h > nb - h ? h : nb - h) + 1, lz = la + lb;
+    uint32_t *sa = (uint32_t *)malloc((la + lb + lz) * sizeof(uint32_t)), *sb = sa + la, *z = sb + lb;
+    int rc;
+
+    if (sa == NULL)
+        return -1;
+    memcpy(sa, a + h, (na - h) * sizeof(uint32_t));
+    sa[na - h] = 0;
+    bigAddAt(sa, la, a, h);
+    memcpy(sb, b, h * sizeof(uint32_t));
+    memset(sb + h, 0, (lb - h) * sizeof(uint32_t));
+    bigAddAt(sb, lb, b + h, nb - h);
+    // a0 b0 and a1 b1 go straight into r, the middle term on top
+    rc = bigMulRaw(a, h, b, h, r);
+    if (rc == 0)
+        rc = bigMulRaw(a + h, na - h, b + h, nb - h, r + 2 * h);
+    if (rc == 0)
+        rc = bigMulRaw(sa, la, sb, lb, z);
+    if (rc == 0)
+    {
+        bigSubAt(z, lz, r, 2 * h);
+        bigSubAt(z, lz, r + 2 * h, na + nb - 2 * h);
+        while (lz > 0 && z[lz - 1] == 0)
+            lz--;
+        bigAddAt(r + h, na + nb - h, z, lz);
+    }
+    free(sa);
+    return rc;
+}
+
+static inline int bigMul(BigNum *out, const BigNum *a, const BigNum *b);
+
+// bigMulRaw() for nb > 2 ceil(na / 3), so that b has three parts too
+static inline int bigMulToom3(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r)
+{
+    // a = a2 x^2 + a1 x + a0 and b likewise, with x = B^k
+    size_t k = (na + 2) / 3, i;
+    // the parts, the values at 1, -1 and -2 (s: their signs), the
+    // products there, and p for a0 + a2
+    BigNum v[20];
+    BigNum *a0 = &v[0], *a1 = &v[1], *a2 = &v[2], *b0 = &v[3], *b1 = &v[4], *b2 = &v[5];
+    BigNum *at1 = &v[6], *atm1 = &v[7], *atm2 = &v[8], *bt1 = &v[9], *btm1 = &v[10], *btm2 = &v[11];
+    BigNum *r0 = &v[12], *r1 = &v[13], *rm1 = &v[14], *rm2 = &v[15], *rinf = &v[16], *t1 = &v[17];
+    BigNum *t2 = &v[18], *t3 = &v[19];
+    int sam1, sam2, sbm1, sbm2, srm1, srm2, s1, s2, s3, rc = 0;
+    const BigNum *c[5];
+
+    for (i = 0; i < 20; i++)
+        bigInit(&v[i]);
+    rc |= bigFromLimbs(a0, a, k);
+    rc |= bigFromLimbs(a1, a + k, k);
+    rc |= bigFromLimbs(a2, a + 2 * k, na - 2 * k);
+    rc |= bigFromLimbs(b0, b, k);
+    rc |= bigFromLimbs(b1, b + k, k);
+    rc |= bigFromLimbs(b2, b + 2 * k, nb - 2 * k);
+    // p = x0 + x2, x(1) = p + x1, x(-1) = p - x1, x(-2) = 2 (x(-1) + x2) - x0
+    rc |= bigAdd(t1, a0, a2);
+    rc |= bigAdd(at1, t1, a1);
+    rc |= bigAddSigned(atm1, &sam1, t1, 0, a1, 1);
+    rc |= bigAddSigned(atm2, &sam2, atm1, sam1, a2, 0);
+    rc |= bigMulSmall(atm2, 2);
+    rc |= bigAddSigned(atm2, &sam2, atm2, sam2, a0, 1);
+    rc |= bigAdd(t1, b0, b2);
+    rc |= bigAdd(bt1, t1, b1);
+    rc |= bigAddSigned(btm1, &sbm1, t1, 0, b1, 1);
+    rc |= bigAddSigned(btm2, &sbm2, btm1, sbm1, b2, 0);
+    rc |= bigMulSmall(btm2, 2);
+    rc |= bigAddSigned(btm2, &sbm2, btm2, sbm2, b0, 1);
+    rc |= bigMul(r0, a0, b0);
+    rc |= bigMul(r1, at1, bt1);
+    rc |= bigMul(rm1, atm1, btm1);
+    srm1 = sam1 ^ sbm1;
+    rc |= bigMul(rm2, atm2, btm2);
+    srm2 = sam2 ^ sbm2;
+    rc |= bigMul(rinf, a2, b2);
+    // t3 = (r(-2) - r(1)) / 3, t1 = (r(1) - r(-1)) / 2, t2 = r(-1) - r(0)
+    rc |= bigAddSigned(t3, &s3, rm2, srm2, r1, 1);
+    bigDivSmall(t3, 3);
+    rc |= bigAddSigned(t1, &s1, r1, 0, rm1, !srm1);
+    bigDivSmall(t1, 2);
+    rc |= bigAddSigned(t2, &s2, rm1, srm1, r0, 1);
+    // t3 = (t2 - t3) / 2 + 2 r(inf), t2 += t1 - r(inf), t1 -= t3
+    rc |= bigAddSigned(t3, &s3, t2, s2, t3, !s3);
+    bigDivSmall(t3, 2);
+    rc |= bigAddSigned(t3, &s3, t3, s3, rinf, 0);
+    rc |= bigAddSigned(t3, &s3, t3, s3, rinf, 0);
+    rc |= bigAddSigned(t2, &s2, t2, s2, t1, s1);
+    rc |= bigAddSigned(t2, &s2, t2, s2, rinf, 1);
+    rc |= bigAddSigned(t1, &s1, t1, s1, t3, !s3);
+    // the coefficients of the product are r(0), t1, t2, t3 and r(inf)
+    if (rc == 0)
+    {
+        c[0] = r0;
+        c[1] = t1;
+        c[2] = t2;
+        c[3] = t3;
+        c[4] = rinf;
+        memset(r, 0, (na + nb) * sizeof(uint32_t));
+        for (i = 0; i < 5; i++)
+            if (c[i]->len != 0)
+                bigAddAt(r + i * k, na + nb - i * k, c[i]->limb, c[i]->len);
+    }
+    for (i = 0; i < 20; i++)
+        bigFree(&v[i]);
+    return rc;
+}
+
+#if defined(__SIZEOF_INT128__)
+// rt[h + j] = w^j for the 2h-th root of unity w, for every h = 1, 2, ...,
+// n / 2, in Montgomery form
+static inline void bigNttRoots(const Montgomery *mt, uint64_t g, uint64_t *rt, size_t n)
+{
+    size_t h, j;
+
+    for (h = 1; h < n; h *= 2)
+    {
+        uint64_t w = montIn(mt, modPow(g, (mt->n - 1) / (2 * h), mt->n));
+        rt[h] = mt->one;
+        for (j = 1; j < h; j++)
+            rt[h + j] = montMul(mt, rt[h + j - 1], w);
+    }
+}
+
+// In place, n a power of two; values are plain, the roots in Montgomery
+// form, so each butterfly product comes out plain
+static inline void bigNtt(const Montgomery *mt, const uint64_t *rt, uint64_t *x, size_t n)
+{
+    size_t i, j, k, h;
+
+    for (i = 1, j = 0; i < n; i++)
+    {
+        for (k = n >> 1; j & k; k >>= 1)
+            j ^= k;
+        j |= k;
+        if (i < j)
+        {
+            uint64_t t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+    }
+    for (h = 1; h < n; h *= 2)
+        for (i = 0; i < n; i += 2 * h)
+            for (j = 0; j < h; j++)
+            {
+                uint64_t u = x[i + j], v = montMul(mt, x[i + j + h], rt[h + j]);
+                x[i + j] = modAdd(u, v, mt->n);
+                x[i + j + h] = modSub(u, v, mt->n);
+            }
+}
+
+// out[0 .. n) = the cyclic convolution of a and b mod the prime p, with
+// fb and rt scratch of n values (fb unused when a and b are the same)
+static inline void bigNttConvolve(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, size_t n,
+                                  uint64_t p, uint64_t g, uint64_t *out, uint64_t *fb, uint64_t *rt)
+{
+    Montgomery mt = montInit(p);
+    int square = a == b && na == nb;
+    // montMul of two transforms takes out a 2^-64 and the inverse
+    // transform puts in an n; this takes both out again
+    uint64_t scale = modMul(mt.r2, modInverse(n % p, p), p);
+    size_t i;
+
+    bigNttRoots(&mt, g, rt, n);
+    for (i = 0; i < n; i++)
+        out[i] = i < na ? a[i] : 0;
+    bigNtt(&mt, rt, out, n);
+    if (!square)
+    {
+        for (i = 0; i < n; i++)
+            fb[i] = i < nb ? b[i] : 0;
+        bigNtt(&mt, rt, fb, n);
+    }
+    for (i = 0; i < n; i++)
+        out[i] = montMul(&mt, out[i], square ? out[i] : fb[i]);
+    // the inverse transform is the forward one with the outputs 1 .. n-1
+    // in reverse order
+    bigNtt(&mt, rt, out, n);
+    for (i = 1; i < n - i; i++)
+    {
+        uint64_t t = out[i];
+        out[i] = out[n - i];
+        out[n - i] = t;
+    }
+    for (i = 0; i < n; i++)
+        out[i] = montMul(&mt, out[i], scale);
+}
+
+static inline int bigMulNtt(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r)
+{
+    size_t n = 1, i;
+    uint64_t *x1, *x2, *fb, *rt, inv;
+    unsigned __int128 carry = 0;
+    Montgomery mt2 = montInit(BIG_NTT_P2);
+
+    while (n < na + nb - 1)
+        n *= 2;
+    x1 = (uint64_t *)malloc(4 * n * sizeof(uint64_t));
+    if (x1 == NULL)
+        return -1;
+    x2 = x1 + n;
+    fb = x2 + n;
+    rt = fb + n;
+    bigNttConvolve(a, na, b, nb, n, BIG_NTT_P1, BIG_NTT_G1, x1, fb, rt);
+    bigNttConvolve(a, na, b, nb, n, BIG_NTT_P2, BIG_NTT_G2, x2, fb, rt);
+    // x = x1 + P1 ((x2 - x1) / P1 mod P2), with 1/P1 in Montgomery form so
+    // one montMul gives a plain value
+    inv = montIn(&mt2, modInverse(BIG_NTT_P1 % BIG_NTT_P2, BIG_NTT_P2));
+    for (i = 0; i < na + nb; i++)
+    {
+        if (i < na + nb - 1)
+        {
+            uint64_t t = montMul(&mt2, modSub(x2[i], x1[i] % BIG_NTT_P2, BIG_NTT_P2), inv);
+            carry += (unsigned __int128)BIG_NTT_P1 * t + x1[i];
+        }
+        r[i] = (uint32_t)(carry % BIG_BASE);
+        carry /= BIG_BASE;
+    }
+    free(x1);
+    return 0;
+}
+#endif
+
+// r[0 .. na + nb) = a * b for na, nb >= 1; r must not overlap a or b.
+// Returns 0, or -1 when out of memory.
+static inline int bigMulRaw(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *r)
+{
+    uint32_t *t;
+    size_t i;
+
+    if (na < nb)
+    {
+        const uint32_t *c = a;
+        a = b;
+        b = c;
+        i = na;
+        na = nb;
+        nb = i;
+    }
+    if (nb < bigThresholds.karatsuba)
+    {
+        bigMulSchool(a, na, b, nb, r);
+        return 0;
+    }
+#if defined(__SIZEOF_INT128__)
+    if (nb >= bigThresholds.ntt)
+        return bigMulNtt(a, na, b, nb, r);
+#endif
+    if (nb >= bigThresholds.toom3 && nb > 2 * ((na + 2) / 3))
+        return bigMulToom3(a, na, b, nb, r);
+    if (nb > na / 2)
+        return bigMulKaratsuba(a, na, b, nb, r);
+    // pieces of a the length of b, each product added in at its offset
+    t = (uint32_t *)malloc(2 * nb * sizeof(uint32_t));
+    if (t == NULL)
+        return -1;
+    memset(r, 0, (na + nb) * sizeof(uint32_t));
+    for (i = 0; i < na; i += nb)
+    {
+        size_t len = na - i < nb ? na - i : nb;
+        if (bigMulRaw(a + i, len, b, nb, t) != 0)
+        {
+            free(t);
+            return -1;
+        }
+        bigAddAt(r + i, na + nb - i, t, len + nb);
+    }
+    free(t);
+    return 0;
+}
+
+// out = a * b; out may be a or b
+static inline int bigMul(BigNum *out, const BigNum *a, const BigNum *b)
+{
+    uint32_t *r;
+    size_t n;
+
+    if (a->len == 0 || b->len == 0)
+    {
+        out->len = 0;
+        return 0;
+    }
+    n = a->len + b->len;
+    r = (uint32_t *)malloc(n * sizeof(uint32_t));
+    if (r == NULL || bigMulRaw(a->limb, a->len, b->limb, b->len, r) != 0)
+    {
+        free(r);
+        return -1;
+    }
+    free(out->limb);
+    out->limb = r;
+    out->cap = n;
+    while (n > 0 && r[n - 1] == 0)
+        n--;
+    out->len = n;
+    return 0;
+}
+
+// out = w[0] * w[1] * ... * w[n - 1], each below BIG_SMALL_MAX; 1 when
+// n is 0. The halves are multiplied recursively and then together.
+static inline int bigProduct(const uint64_t *w, size_t n, BigNum *out)
+{
+    BigNum left, right;
+    size_t i;
+    int rc;
+
+    if (n <= BIG_PRODUCT_LEAF)
+    {
+        if (bigSetU64(out, 1) != 0)
+            return -1;
+        for (i = 0; i < n; i++)
+            if (bigMulSmall(out, w[i]) != 0)
+                return -1;
+        return 0;
+    }
+    bigInit(&left);
+    bigInit(&right);
+    rc = bigProduct(w, n / 2, &left);
+    if (rc == 0)
+        rc = bigProduct(w + n / 2, n - n / 2, &right);
+    if (rc == 0)
+        rc = bigMul(out, &left, &right);
+    bigFree(&left);
+    bigFree(&right);
+    return rc;
+}
+
+// The number of decimal digits, 1 for 0
+static inline size_t bigDigits(const BigNum *b)
+{
+    size_t digits = b->len == 0 ? 1 : (b->len - 1) * BIG_DIGITS;
+    uint32_t top;
+
+    for (top = b->len == 0 ? 0 : b->limb[b->len - 1]; top != 0; top /= 10)
+        digits++;
+    return digits;
+}
+
+// The top limb as it is, every other one padded to BIG_DIGITS digits
+static inline void bigPrint(FILE *f, const BigNum *b)
+{
+    size_t i;
+
+    if (b->len == 0)
+    {
+        fputc('0', f);
+        return;
+    }
+    fprintf(f, "%u", b->limb[b->len - 1]);
+    for (i = b->len - 1; i > 0; i--)
+        fprintf(f, "%09u", b->limb[i - 1]);
+}
+
+#endif
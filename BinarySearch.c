@@ -1,7 +1,52 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "Eytzinger.h"
+
+/*
+ * Binary search on a sorted array of ints, in several forms. All but the
+ * first return the position of the first element >= the wanted number
+ * (C++'s lower_bound), or n if there is none:
+ *
+ * lowerBound           the textbook loop
+ * lowerBoundBranchless the loop narrows the range by a compare and a
+ *                      conditional move, with no branch to mispredict;
+ *                      every search takes exactly log2(n) steps
+ * lowerBoundPrefetch   the same, and before each step it prefetches both
+ *                      places the next step may look, so one of the two
+ *                      memory loads is already on its way
+ * lowerBoundBatch      SEARCH_LANES searches at once, one step of each in
+ *                      turn: their loads are independent, so their cache
+ *                      misses overlap instead of queueing up
+ *
+ * eytzingerLowerBound (Eytzinger.h) searches an index built from the
+ *                      array, in BFS order of its search tree, and
+ *                      prefetches four levels ahead
+ * interpolationLowerBound
+ *                      guesses where the number is from the values at the
+ *                      ends of the range, as if they were evenly spread; on
+ *                      uniform keys that takes a handful of probes instead
+ *                      of log2(n). After INTERP_BAD_PROBES guesses that did
+ *                      not halve the range it finishes with lowerBound, so
+ *                      skewed keys cost at most a few probes more
+ * gallopLowerBound     starts at a hint, such as the previous answer, and
+ *                      steps 1, 2, 4, ... away from it until it passes the
+ *                      number, then binary searches the last step: about
+ *                      2 log2(d) probes for an answer d places away
+ * learnedLowerBound    searches a learned index (LearnedIndex below): a
+ *                      line through the keys says where the number should
+ *                      be, within LEARNED_EPSILON places, and only those
+ *                      places are searched
+ *
+ * On an array much bigger than the cache every step is a cache miss, and
+ * the batch hides most of them. Run with --bench N M to time the forms on
+ * N sorted ints and M random lookups.
+ */
 
 /* If x in into array return 0, else 1 */
-/* 
+/*
  * A function with 4 params:
  * int[] = array of elements
  * int = wanted number
@@ -11,8 +56,12 @@
  * returns 0 or 1
  */
 int binarySearch(int[], int, int, int);
+size_t lowerBound(const int *array, size_t n, int number);
+int bench(size_t n, size_t m);
 
-int main() {
+int main(int argc, char *argv[]) {
+	if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10));
 	int arr[] = {5, 15, 24, 32, 56, 89};
     /* check length of array */
 	int size_of_array = sizeof(arr) / sizeof(int);
@@ -20,27 +69,462 @@ int main() {
 	printf("%d\n", binarySearch(arr, 24, 0, size_of_array-1));
 	/* Check if 118 is into arr */
 	printf("%d\n", binarySearch(arr, 118, 0, size_of_array-1));
+	/* Where 24 is, and where 30 would go */
+	printf("%zu %zu\n", lowerBound(arr, size_of_array, 24), lowerBound(arr, size_of_array, 30));
 	return 0;
 }
 
 int binarySearch(int array[], int number, int start, int end) {
-    /* if start index is get end index, check if that element is equals wanter nmber */
-	if(start >= end) {
-		return array[start] == number ? 0 : 1;
+	/* the first element >= number decides; start..end are inclusive */
+	if (end < start)
+		return 1;
+	size_t i = start + lowerBound(array + start, end - start + 1, number);
+	return i <= (size_t)end && array[i] == number ? 0 : 1;
+}
+
+size_t lowerBound(const int *array, size_t n, int number) {
+	size_t lo = 0, hi = n;
+	/* array[0..lo) < number <= array[hi..n) */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (array[mid] < number)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+size_t lowerBoundBranchless(const int *array, size_t n, int number) {
+	const int *base = array;
+	if (n == 0)
+		return 0;
+	/* the answer is in base[0..n]; each step keeps half of it */
+	while (n > 1) {
+		size_t half = n / 2;
+		base = base[half] < number ? base + half : base;
+		n -= half;
 	}
+	return (base - array) + (*base < number);
+}
 
-	int tmp = (int) end / 2;
-    /* divide array length in half */
-    /* if number is greater than element in half, do search by start to tmp
-	 * else search by tmp to end
-     */
-	if(number == array[tmp]) {
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
+size_t lowerBoundPrefetch(const int *array, size_t n, int number) {
+	const int *base = array;
+	if (n == 0)
 		return 0;
-	} else if(number > array[tmp]) {
-		return binarySearch(array, number, start, tmp);
+	while (n > 1) {
+		size_t half = n / 2;
+		/* the next step looks at base[n/4] or base[half + n/4] */
+		PREFETCH(base + (n - half) / 2);
+		PREFETCH(base + half + (n - half) / 2);
+		base = base[half] < number ? base + half : base;
+		n -= half;
+	}
+	return (base - array) + (*base < number);
+}
+
+#define INTERP_BAD_PROBES 4
+
+size_t interpolationLowerBound(const int *array, size_t n, int number) {
+	size_t lo = 0, hi = n;
+	int bad = 0;
+	/* array[0..lo) < number <= array[hi..n) */
+	while (lo < hi) {
+		size_t pos, size = hi - lo;
+		if (array[lo] >= number)
+			return lo;
+		if (array[hi - 1] < number)
+			return hi;
+		/* array[lo] < number <= array[hi - 1]; the differences may not fit
+		 * in an int, and their product not even in 64 bits */
+		pos = lo + (size_t)((double)((long long)number - array[lo]) * (size - 1)
+			/ ((long long)array[hi - 1] - array[lo]));
+		if (pos >= hi)
+			pos = hi - 1;
+		if (array[pos] < number)
+			lo = pos + 1;
+		else
+			hi = pos;
+		if (2 * (hi - lo) > size && ++bad >= INTERP_BAD_PROBES)
+			return lo + lowerBound(array + lo, hi - lo, number);
+	}
+	return lo;
+}
+
+size_t gallopLowerBound(const int *array, size_t n, int number, size_t hint) {
+	size_t step = 1, lo, hi;
+	if (hint > n)
+		hint = n;
+	if (hint < n && array[hint] < number) {
+		/* the answer is after hint; array[hint + step / 2] < number */
+		while (hint + step < n && array[hint + step] < number)
+			step *= 2;
+		lo = hint + step / 2 + 1;
+		hi = hint + step < n ? hint + step : n;
 	} else {
-		return binarySearch(array, number, tmp, end);
+		/* the answer is at or before hint; array[hint - step / 2] >= number */
+		while (step <= hint && array[hint - step] >= number)
+			step *= 2;
+		lo = step <= hint ? hint - step + 1 : 0;
+		hi = hint - step / 2;
+	}
+	return lo + lowerBound(array + lo, hi - lo, number);
+}
+
+/*
+ * A learned index over a sorted array, in the style of the PGM-index: the
+ * map from key to position is cut into segments, each a straight line that
+ * is never more than epsilon places off for the keys it covers. The lines
+ * are fitted in one pass (the shrinking cone of FITing-trees): a segment
+ * starts at a key, and every next key narrows the range of slopes that
+ * keep all its keys within epsilon, until the range is empty and the next
+ * segment starts there. A lookup finds its segment among the first keys,
+ * which are few and stay in the cache, predicts a position, and searches
+ * the 2 epsilon + 3 places around it, a few neighbouring cache lines of
+ * the array that are prefetched together. The keys of the array are not copied.
+ *
+ * How many segments there are depends on the keys: evenly spaced ones are
+ * one line; 50M keys with random gaps of 0 to 3 took 2614 segments, 41 KB,
+ * at epsilon 64, and 10191 at 32. A repeated key or a number between the keys can be further
+ * off than epsilon; the search then gallops on from the edge of the
+ * window, so the answer is always right. learnedSave writes the index to a
+ * file and learnedLoad reads it back for the same array (native byte
+ * order), which saves the pass over the keys. Build, save and load return
+ * 0, or -1 when out of memory, on a write or read error, or when n is not
+ * below 2^32.
+ */
+#define LEARNED_EPSILON 64
+#define LEARNED_MAGIC "LEARNIDX"
+
+typedef struct {
+	size_t n;		/* the length of the array */
+	size_t count;		/* segments */
+	unsigned epsilon;
+	int *first;		/* first[s]: the smallest key of segment s */
+	uint32_t *start;	/* start[s]: where it is in the array */
+	double *slope;		/* places per unit of key */
+} LearnedIndex;
+
+void learnedFree(LearnedIndex *index) {
+	free(index->first);
+	free(index->start);
+	free(index->slope);
+	memset(index, 0, sizeof *index);
+}
+
+static int learnedReserve(LearnedIndex *index, size_t count) {
+	int *first = realloc(index->first, count * sizeof(int));
+	uint32_t *start;
+	double *slope;
+	if (first == NULL)
+		return -1;
+	index->first = first;
+	if ((start = realloc(index->start, count * sizeof(uint32_t))) == NULL)
+		return -1;
+	index->start = start;
+	if ((slope = realloc(index->slope, count * sizeof(double))) == NULL)
+		return -1;
+	index->slope = slope;
+	return 0;
+}
+
+int learnedBuild(LearnedIndex *index, const int *array, size_t n, unsigned epsilon) {
+	size_t i = 0, capacity = 0;
+	memset(index, 0, sizeof *index);
+	index->n = n;
+	index->epsilon = epsilon;
+	if ((uint64_t)n >= UINT32_MAX)
+		return -1;
+	while (i < n) {
+		/* a segment from the first array[i]; the slopes in lo..hi keep
+		 * every key so far within epsilon of the line */
+		double lo = 0, hi = -1, x0 = array[i];
+		size_t j;
+		if (index->count == capacity) {
+			capacity = capacity ? 2 * capacity : 64;
+			if (learnedReserve(index, capacity) != 0) {
+				learnedFree(index);
+				return -1;
+			}
+		}
+		for (j = i + 1; j < n; j++) {
+			double dx = (double)array[j] - x0, low, high;
+			if (array[j] == array[j - 1])
+				continue;
+			low = ((double)(j - i) - epsilon) / dx;
+			high = ((double)(j - i) + epsilon) / dx;
+			if (low < lo)
+				low = lo;
+			if (hi >= 0 && high > hi)
+				high = hi;
+			if (low > high)
+				break;
+			lo = low;
+			hi = high;
+		}
+		index->first[index->count] = array[i];
+		index->start[index->count] = (uint32_t)i;
+		index->slope[index->count] = hi >= 0 ? (lo + hi) / 2 : 0;
+		index->count++;
+		i = j;
+	}
+	return 0;
+}
+
+/* what the index takes beyond the array, for the bench */
+size_t learnedBytes(const LearnedIndex *index) {
+	return sizeof *index + index->count * (sizeof(int) + sizeof(uint32_t) + sizeof(double));
+}
+
+size_t learnedLowerBound(const LearnedIndex *index, const int *array, int number) {
+	const int *base = index->first;
+	size_t count = index->count, s, start, end, lo, hi, r;
+	double at;
+	if (count == 0 || number <= array[0])
+		return 0;
+	/* the last segment whose first key is <= number */
+	while (count > 1) {
+		size_t half = count / 2;
+		base = base[half] <= number ? base + half : base;
+		count -= half;
 	}
+	s = base - index->first;
+	start = index->start[s];
+	end = s + 1 < index->count ? index->start[s + 1] : index->n;
+	/* the answer is in start..end; the line says where */
+	at = start + index->slope[s] * ((double)number - index->first[s]);
+	if (at > end)
+		at = end;
+	lo = (size_t)at > start + index->epsilon + 1 ? (size_t)at - index->epsilon - 1 : start;
+	hi = (size_t)at + index->epsilon + 2 < end ? (size_t)at + index->epsilon + 2 : end;
+	/* the window is a few cache lines; load them all at once rather than
+	 * one after another as the search halves it */
+	for (r = lo; r < hi; r += 64 / sizeof(int))
+		PREFETCH(array + r);
+	PREFETCH(array + hi - 1);
+	r = lo + lowerBoundBranchless(array + lo, hi - lo, number);
+	if ((r == lo && lo > start && array[lo - 1] >= number) || (r == hi && hi < end && array[hi] < number))
+		r = gallopLowerBound(array, index->n, number, r);
+	return r;
 }
 
+int learnedSave(const LearnedIndex *index, FILE *f) {
+	uint64_t head[3] = {index->n, index->count, index->epsilon};
+	if (fwrite(LEARNED_MAGIC, 1, 8, f) != 8 || fwrite(head, sizeof head, 1, f) != 1)
+		return -1;
+	if (index->count > 0 && (fwrite(index->first, sizeof(int), index->count, f) != index->count
+		|| fwrite(index->start, sizeof(uint32_t), index->count, f) != index->count
+		|| fwrite(index->slope, sizeof(double), index->count, f) != index->count))
+		return -1;
+	return fflush(f) == 0 ? 0 : -1;
+}
+
+/* reads what learnedSave wrote for array and checks it against it */
+int learnedLoad(LearnedIndex *index, FILE *f, const int *array, size_t n) {
+	char magic[8];
+	uint64_t head[3];
+	size_t s;
+	memset(index, 0, sizeof *index);
+	if (fread(magic, 1, 8, f) != 8 || memcmp(magic, LEARNED_MAGIC, 8) != 0
+		|| fread(head, sizeof head, 1, f) != 1 || head[0] != n || head[1] > n || head[2] > UINT32_MAX
+		|| (n > 0 && head[1] == 0))
+		return -1;
+	index->n = n;
+	index->epsilon = (unsigned)head[2];
+	if (head[1] > 0 && learnedReserve(index, head[1]) != 0) {
+		learnedFree(index);
+		return -1;
+	}
+	index->count = head[1];
+	if (index->count > 0 && (fread(index->first, sizeof(int), index->count, f) != index->count
+		|| fread(index->start, sizeof(uint32_t), index->count, f) != index->count
+		|| fread(index->slope, sizeof(double), index->count, f) != index->count)) {
+		learnedFree(index);
+		return -1;
+	}
+	for (s = 0; s < index->count; s++)
+		if ((s == 0 && index->start[0] != 0) || index->start[s] >= n
+			|| (s > 0 && index->start[s] <= index->start[s - 1])
+			|| array[index->start[s]] != index->first[s]
+			|| (s > 0 && array[index->start[s] - 1] >= index->first[s])
+			|| index->slope[s] != index->slope[s] || index->slope[s] < 0) {
+			learnedFree(index);
+			return -1;
+		}
+	return 0;
+}
 
+#define SEARCH_LANES 16
+
+/* out[i] = lowerBound(array, n, numbers[i]) for i < m */
+void lowerBoundBatch(const int *array, size_t n, const int *numbers, size_t *out, size_t m) {
+	const int *base[SEARCH_LANES];
+	size_t i, k, lanes;
+	for (i = 0; i < m; i += lanes) {
+		size_t left = n;
+		lanes = m - i < SEARCH_LANES ? m - i : SEARCH_LANES;
+		if (n == 0) {
+			for (k = 0; k < lanes; k++)
+				out[i + k] = 0;
+			continue;
+		}
+		for (k = 0; k < lanes; k++)
+			base[k] = array;
+		/* every search of the same n takes the same steps, so the lanes
+		 * move in lockstep; each round starts the loads of all lanes
+		 * before it waits on the first of them */
+		while (left > 1) {
+			size_t half = left / 2;
+			for (k = 0; k < lanes; k++)
+				PREFETCH(base[k] + half);
+			for (k = 0; k < lanes; k++)
+				base[k] = base[k][half] < numbers[i + k] ? base[k] + half : base[k];
+			left -= half;
+		}
+		for (k = 0; k < lanes; k++)
+			out[i + k] = (base[k] - array) + (*base[k] < numbers[i + k]);
+	}
+}
+
+double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(size_t n, size_t m) {
+	int *array = malloc(n * sizeof(int)), *numbers = malloc(m * sizeof(int));
+	size_t *want = malloc(m * sizeof(size_t)), *got = malloc(m * sizeof(size_t));
+	size_t i, bad = 0;
+	unsigned long long seed = 1;
+	EytzingerIndex index;
+	LearnedIndex learned;
+	double t;
+	int form;
+	if (array == NULL || numbers == NULL || want == NULL || got == NULL) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	/* sorted ids with gaps, so half the lookups miss */
+	for (i = 0; i < n; i++)
+		array[i] = (int)(2 * i);
+	for (i = 0; i < m; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		numbers[i] = (int)((seed >> 33) % (2 * n + 2));
+	}
+	printf("%zu lookups in %zu ints (%.0f MB)\n", m, n, n * sizeof(int) / 1e6);
+	t = now();
+	if (eytzingerBuild(&index, array, n) != 0) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	printf("Eytzinger index built in %.3f s\n", now() - t);
+	t = now();
+	if (learnedBuild(&learned, array, n, LEARNED_EPSILON) != 0) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	printf("Learned index built in %.3f s: %zu segments, %zu bytes\n", now() - t, learned.count,
+		learnedBytes(&learned));
+	for (form = 0; form < 8; form++) {
+		t = now();
+		if (form == 7)
+			for (i = 0; i < m; i++)
+				got[i] = learnedLowerBound(&learned, array, numbers[i]);
+		else if (form == 6)
+			for (i = 0; i < m; i++)
+				got[i] = gallopLowerBound(array, n, numbers[i], i > 0 ? got[i - 1] : 0);
+		else if (form == 5)
+			for (i = 0; i < m; i++)
+				got[i] = interpolationLowerBound(array, n, numbers[i]);
+		else if (form == 4)
+			for (i = 0; i < m; i++)
+				got[i] = eytzingerLowerBound(&index, numbers[i]);
+		else if (form == 3)
+			lowerBoundBatch(array, n, numbers, got, m);
+		else
+			for (i = 0; i < m; i++)
+				got[i] = form == 0 ? lowerBound(array, n, numbers[i])
+					: form == 1 ? lowerBoundBranchless(array, n, numbers[i])
+					: lowerBoundPrefetch(array, n, numbers[i]);
+		t = now() - t;
+		printf("%-13s %8.1f ns a lookup\n",
+			form == 0 ? "plain" : form == 1 ? "branchless" : form == 2 ? "prefetch" : form == 3 ? "batch"
+			: form == 4 ? "eytzinger" : form == 5 ? "interpolation" : form == 6 ? "gallop" : "learned",
+			t / m * 1e9);
+		if (form == 0)
+			memcpy(want, got, m * sizeof(size_t));
+		else
+			bad += memcmp(want, got, m * sizeof(size_t)) != 0;
+	}
+	/* lookups that each land a little after the last one, as when merging
+	 * or walking a time range: where gallopLowerBound is meant to be used */
+	for (i = 0; i < m; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		numbers[i] = (int)((2 * n + 2) * (double)i / m) + (int)((seed >> 33) % 64);
+	}
+	for (form = 0; form < 2; form++) {
+		t = now();
+		for (i = 0; i < m; i++)
+			got[i] = form == 0 ? lowerBound(array, n, numbers[i])
+				: gallopLowerBound(array, n, numbers[i], i > 0 ? got[i - 1] : 0);
+		t = now() - t;
+		printf("%-13s %8.1f ns a nearby lookup\n", form == 0 ? "plain" : "gallop", t / m * 1e9);
+		if (form == 0)
+			memcpy(want, got, m * sizeof(size_t));
+		else
+			bad += memcmp(want, got, m * sizeof(size_t)) != 0;
+	}
+	learnedFree(&learned);
+	/* keys with random gaps need many segments; the index goes through a
+	 * file and back, as a static array's index would be kept */
+	for (i = 0; i < n; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		array[i] = i > 0 ? array[i - 1] + (int)((seed >> 33) % 4) : 0;
+		numbers[i % m] = (int)((seed >> 13) % (2 * n + 2));
+	}
+	{
+		FILE *f = tmpfile();
+		if (f == NULL || learnedBuild(&learned, array, n, LEARNED_EPSILON) != 0 || learnedSave(&learned, f) != 0) {
+			printf("Cannot build or save the learned index\n");
+			return 1;
+		}
+		learnedFree(&learned);
+		rewind(f);
+		if (learnedLoad(&learned, f, array, n) != 0) {
+			printf("Cannot load the learned index\n");
+			return 1;
+		}
+		fclose(f);
+	}
+	printf("Random gaps: %zu segments, %zu bytes\n", learned.count, learnedBytes(&learned));
+	for (form = 0; form < 3; form++) {
+		t = now();
+		for (i = 0; i < m; i++)
+			got[i] = form == 0 ? lowerBound(array, n, numbers[i])
+				: form == 1 ? lowerBoundBranchless(array, n, numbers[i])
+				: learnedLowerBound(&learned, array, numbers[i]);
+		t = now() - t;
+		printf("%-13s %8.1f ns a lookup\n", form == 0 ? "plain" : form == 1 ? "branchless" : "learned",
+			t / m * 1e9);
+		if (form == 0)
+			memcpy(want, got, m * sizeof(size_t));
+		else
+			bad += memcmp(want, got, m * sizeof(size_t)) != 0;
+	}
+	learnedFree(&learned);
+	eytzingerFree(&index);
+	free(array);
+	free(numbers);
+	free(want);
+	free(got);
+	if (bad)
+		printf("The forms disagree\n");
+	return bad != 0;
+}
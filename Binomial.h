@@ -0,0 +1,215 @@
+// n choose k modulo any m, for n up to 2^64 - 1, for
+// nCrCalculatorLargeNumbers.c.
+//
+// m is split into prime powers p^e (Factor.h), each one answered on its
+// own and the answers joined by the Chinese remainder theorem:
+//
+//   - e = 1: Lucas' theorem. Write n and k in base p; then C(n, k) is the
+//     product of C(n_i, k_i) over the digits, each from tables of i! and
+//     1/i! mod p.
+//   - e > 1: Granville's extension. Let F(x) be x! with every factor p
+//     taken out, mod p^e. Then C(n, k) = p^c F(n) / (F(k) F(n - k)), where
+//     c, the power of p in C(n, k), is the number of carries when adding k
+//     and n - k in base p (Kummer). F(x) comes from a table of the
+//     products of the numbers below p^e that p does not divide: the
+//     numbers up to x fall into whole blocks of p^e, each contributing
+//     the same product, +-1 by Wilson's theorem, plus a partial block, and
+//     then the multiples of p, divided by p, give F(x / p) again.
+//
+// The tables are of size p^e per prime power, never of size n, so each
+// prime power of m has to be at most BINOM_TABLE_LIMIT. binomModGet(m)
+// keeps the last BINOM_CACHE moduli built. Header-only.
+
+#ifndef BINOMIAL_H
+#define BINOMIAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "Factor.h"
+#include "ModArith.h"
+
+#define BINOM_TABLE_LIMIT (1u << 24)
+#define BINOM_CACHE 8
+
+typedef struct
+{
+    uint32_t p, e, pe;  // the prime power pe = p^e
+    int wilson;         // the product of a whole block: 1 or -1 (pe - 1)
+    uint32_t *fact;     // e = 1: i! mod p; e > 1: F-table, see above
+    uint32_t *invFact;  // e = 1: 1/i! mod p; NULL otherwise
+    uint64_t crt;       // 1 mod pe and 0 mod the other prime powers of m
+} BinomPart;
+
+typedef struct
+{
+    uint64_t m;
+    int parts;
+    BinomPart part[FACTOR_MAX_PRIMES];
+} BinomMod;
+
+static inline void binomModFree(BinomMod *b)
+{
+    int i;
+    for (i = 0; i < b->parts; i++)
+    {
+        free(b->part[i].fact);
+        free(b->part[i].invFact);
+    }
+    b->parts = 0;
+}
+
+// Returns 0, or -1 when out of memory, m is 0 or 2^63 or more (the CRT
+// sums need the headroom of ModArith.h), or a prime power of m is above
+// BINOM_TABLE_LIMIT
+static inline int binomModInit(BinomMod *b, uint64_t m)
+{
+    Factorization f;
+    int i, j;
+
+    b->m = m;
+    b->parts = 0;
+    if (m == 0 || m >= 1ULL << 63)
+        return -1;
+    factor64(m, &f);
+    for (i = 0; i < f.count; i++)
+    {
+        BinomPart *t = &b->part[b->parts];
+        uint64_t pe = 1, x, rest;
+        for (j = 0; j < f.exponent[i]; j++)
+            if ((pe *= f.prime[i]) > BINOM_TABLE_LIMIT)
+            {
+                binomModFree(b);
+                return -1;
+            }
+        t->p = (uint32_t)f.prime[i];
+        t->e = (uint32_t)f.exponent[i];
+        t->pe = (uint32_t)pe;
+        t->fact = (uint32_t *)malloc(pe * sizeof(uint32_t));
+        t->invFact = t->e == 1 ? (uint32_t *)malloc(pe * sizeof(uint32_t)) : NULL;
+        b->parts++;
+        if (t->fact == NULL || (t->e == 1 && t->invFact == NULL))
+        {
+            binomModFree(b);
+            return -1;
+        }
+        t->fact[0] = 1 % t->pe;
+        for (x = 1; x < pe; x++)
+            t->fact[x] = x % t->p == 0 && t->e > 1
+                             ? t->fact[x - 1]
+                             : (uint32_t)((uint64_t)t->fact[x - 1] * x % pe);
+        t->wilson = t->fact[pe - 1] == 1 % pe ? 1 : -1;
+        if (t->e == 1)
+        {
+            // one power for the top, then 1/(x-1)! = x / x! on the way down
+            t->invFact[pe - 1] = (uint32_t)modPow(t->fact[pe - 1], pe - 2, pe);
+            for (x = pe - 1; x > 0; x--)
+                t->invFact[x - 1] = (uint32_t)((uint64_t)t->invFact[x] * x % pe);
+        }
+        // rest = m / pe is a unit mod pe; its inverse by Euler's theorem,
+        // x^(phi(pe) - 1) with phi(p^e) = p^(e-1) (p - 1)
+        rest = m / pe;
+        x = modPow(rest % pe, pe / t->p * (t->p - 1) - 1, pe);
+        t->crt = modMul(rest % m, x, m);
+    }
+    return 0;
+}
+
+// C(n, k) mod p by Lucas' theorem
+static inline uint64_t binomLucas(const BinomPart *t, uint64_t n, uint64_t k)
+{
+    uint64_t r = 1;
+    while (k != 0 && r != 0)
+    {
+        uint64_t ni = n % t->p, ki = k % t->p;
+        if (ki > ni)
+            return 0;
+        r = r * t->fact[ni] % t->p * t->invFact[ki] % t->p * t->invFact[ni - ki] % t->p;
+        n /= t->p;
+        k /= t->p;
+    }
+    return r;
+}
+
+// x! with the factors p taken out, mod p^e
+static inline uint64_t binomF(const BinomPart *t, uint64_t x)
+{
+    uint64_t r = 1;
+    int negative = 0;
+    for (; x != 0; x /= t->p)
+    {
+        r = r * t->fact[x % t->pe] % t->pe;
+        if (t->wilson < 0 && (x / t->pe) & 1)
+            negative = !negative;
+    }
+    return negative && r != 0 ? t->pe - r : r;
+}
+
+// C(n, k) mod p^e by Granville's theorem
+static inline uint64_t binomGranville(const BinomPart *t, uint64_t n, uint64_t k)
+{
+    uint64_t carries = 0, a = k, b = n - k, carry = 0, r, d;
+    uint32_t i;
+
+    // Kummer: the power of p in C(n, k) is the number of carries
+    for (; a != 0 || b != 0 || carry != 0; a /= t->p, b /= t->p)
+    {
+        carry = a % t->p + b % t->p + carry >= t->p;
+        carries += carry;
+        if (carries >= t->e)
+            return 0;
+    }
+    d = binomF(t, k) * binomF(t, n - k) % t->pe;
+    // a unit mod p^e; its inverse by Euler's theorem
+    r = binomF(t, n) * modPow(d, t->pe / t->p * (t->p - 1) - 1, t->pe) % t->pe;
+    for (i = 0; i < carries; i++)
+        r = r * t->p % t->pe;
+    return r;
+}
+
+// C(n, k) mod b->m; 0 when k > n
+static inline uint64_t binomModQuery(const BinomMod *b, uint64_t n, uint64_t k)
+{
+    uint64_t r = 0;
+    int i;
+
+    if (k > n || b->m == 1)
+        return 0;
+    for (i = 0; i < b->parts; i++)
+    {
+        const BinomPart *t = &b->part[i];
+        uint64_t x = t->e == 1 ? binomLucas(t, n, k) : binomGranville(t, n, k);
+        r = modAdd(r, modMul(x, t->crt, b->m), b->m);
+    }
+    return r;
+}
+
+// The tables for m, built on first use and kept for the last BINOM_CACHE
+// moduli (not thread-safe); NULL as binomModInit()
+static inline const BinomMod *binomModGet(uint64_t m)
+{
+    static BinomMod cache[BINOM_CACHE];
+    static int used, next;
+    int i;
+
+    if (m == 0)
+        return NULL;
+    for (i = 0; i < used; i++)
+        if (cache[i].m == m)
+            return &cache[i];
+    // the oldest goes
+    if (used == BINOM_CACHE)
+        binomModFree(&cache[next]);
+    else
+        used++;
+    i = next;
+    next = (next + 1) % BINOM_CACHE;
+    if (binomModInit(&cache[i], m) != 0)
+    {
+        // leave the slot empty
+        cache[i].m = 0;
+        return NULL;
+    }
+    return &cache[i];
+}
+
+#endif
@@ -0,0 +1,187 @@
+// Strings of ASCII '0' and '1' of any length, as numbers, for
+// binary_to_octal.c and Binary to decimal.
+//
+// bitsParse() packs the string into 64-bit words, lowest word first, eight
+// characters to a byte at a time: one 8-byte load is checked against
+// "00000000" with its low bits masked off, and the low bit of each
+// character is gathered into a byte, with pext under BMI2 or otherwise
+// one multiply by 0x8040201008040201, which moves bit 8i to bit 63 - i
+// with no two products overlapping. Words are filled from the end of the
+// string, so only the first n % 64 characters go one at a time.
+//
+// From the words, base 8 and base 16 are just groups of 3 or 4 bits read
+// from the top (bitsToPow2Text()). Base 10 is not: bitsToBig() turns the
+// words into a BigNum (BigNum.h), whose limbs are already decimal, by
+// splitting the words in two at a power of two, converting each half and
+// joining them as high * 2^(64k) + low. The powers of two are squares of
+// each other, and with bigMul() below quadratic the whole conversion is
+// too, where a digit at a time would be O(n^2).
+//
+// The loads assume a little-endian machine. Header-only.
+
+#ifndef BIT_STRING_H
+#define BIT_STRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "BigNum.h"
+#include "IntText.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#define BITS_BIG_LEAF 16 // words converted one at a time by bitsToBig()
+#define BITS_BIG_LEVELS 48
+
+// The 8 characters at s, the first the top bit, into *byte; 0, or -1 if
+// one of them is not '0' or '1'
+static inline int bitsByte(const char *s, unsigned *byte)
+{
+    uint64_t v;
+    memcpy(&v, s, 8);
+#if defined(__BMI2__)
+    *byte = (unsigned)_pext_u64(__builtin_bswap64(v), 0x0101010101010101ULL);
+#else
+    *byte = (unsigned)(((v & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56);
+#endif
+    return (v & 0xfefefefefefefefeULL) == 0x3030303030303030ULL ? 0 : -1;
+}
+
+// w[0 .. (n + 63) / 64) = the bits s[0 .. n), s[n - 1] the lowest; 0, or
+// -1 if s has anything other than '0' and '1'
+static inline int bitsParse(const char *s, size_t n, uint64_t *w)
+{
+    size_t k = 0, i;
+    int bad = 0;
+    // the last 64 characters make w[0], the 64 before them w[1], ...
+    for (; n >= 64; n -= 64, k++)
+    {
+        const char *q = s + n - 64;
+        uint64_t word = 0;
+        for (i = 0; i < 8; i++)
+        {
+            unsigned byte;
+            bad |= bitsByte(q + 8 * i, &byte);
+            word |= (uint64_t)byte << (56 - 8 * i);
+        }
+        w[k] = word;
+    }
+    if (n > 0)
+    {
+        uint64_t word = 0;
+        for (i = 0; i < n; i++)
+        {
+            bad |= s[i] != '0' && s[i] != '1';
+            word = word << 1 | (uint64_t)(s[i] & 1);
+        }
+        w[k] = word;
+    }
+    return bad ? -1 : 0;
+}
+
+// The bit length of w[0 .. nw), 0 for 0
+static inline size_t bitsLength(const uint64_t *w, size_t nw)
+{
+    while (nw > 0 && w[nw - 1] == 0)
+        nw--;
+    return nw == 0 ? 0 : 64 * nw - (size_t)__builtin_clzll(w[nw - 1]);
+}
+
+// w[0 .. nw) in base 2^shift, shift 1 to 5, with no leading zeros ("0"
+// for 0) and a 0 after it; out needs room for 64 nw / shift + 2
+// characters. Returns the number of digits.
+static inline size_t bitsToPow2Text(const uint64_t *w, size_t nw, int shift, char *out)
+{
+    size_t bits = bitsLength(w, nw), digits = bits == 0 ? 1 : (bits + shift - 1) / shift, d;
+    uint64_t mask = (1u << shift) - 1;
+    char *p = out;
+    for (d = digits; d-- > 0;)
+    {
+        size_t pos = d * shift, k = pos / 64;
+        unsigned s = pos % 64;
+        uint64_t v = w[k] >> s;
+        // a digit across two words
+        if (s + shift > 64 && k + 1 < nw)
+            v |= w[k + 1] << (64 - s);
+        *p++ = intDigits[v & mask];
+    }
+    *p = '\0';
+    return digits;
+}
+
+// *out = w[0 .. nw) for at most BITS_BIG_LEAF words, 32 bits at a time
+static inline int bitsToBigLeaf(const uint64_t *w, size_t nw, BigNum *out)
+{
+    BigNum t;
+    int rc;
+    bigInit(&t);
+    rc = bigSetU64(out, 0);
+    while (nw-- > 0 && rc == 0)
+    {
+        rc |= bigMulSmall(out, 1ULL << 32);
+        rc |= bigSetU64(&t, w[nw] >> 32);
+        rc |= bigAdd(out, out, &t);
+        rc |= bigMulSmall(out, 1ULL << 32);
+        rc |= bigSetU64(&t, w[nw] & 0xffffffffULL);
+        rc |= bigAdd(out, out, &t);
+    }
+    bigFree(&t);
+    return rc;
+}
+
+// *out = w[0 .. nw), where power[j] is 2^(64 BITS_BIG_LEAF 2^j) once
+// *ready > j
+static inline int bitsToBigSplit(const uint64_t *w, size_t nw, BigNum *power, int *ready, BigNum *out)
+{
+    BigNum high;
+    size_t half = BITS_BIG_LEAF;
+    int j = 0, rc = 0;
+    if (nw <= BITS_BIG_LEAF)
+        return bitsToBigLeaf(w, nw, out);
+    // the largest BITS_BIG_LEAF 2^j below nw
+    while (2 * half < nw)
+    {
+        half *= 2;
+        j++;
+    }
+    for (; *ready <= j && rc == 0; ++*ready)
+    {
+        if (*ready == 0)
+        {
+            size_t i;
+            rc |= bigSetU64(&power[0], 1);
+            for (i = 0; i < 2 * BITS_BIG_LEAF; i++)
+                rc |= bigMulSmall(&power[0], 1ULL << 32);
+        }
+        else
+            rc |= bigMul(&power[*ready], &power[*ready - 1], &power[*ready - 1]);
+    }
+    bigInit(&high);
+    if (rc == 0)
+        rc = bitsToBigSplit(w + half, nw - half, power, ready, &high);
+    if (rc == 0)
+        rc = bigMul(&high, &high, &power[j]);
+    if (rc == 0)
+        rc = bitsToBigSplit(w, half, power, ready, out);
+    if (rc == 0)
+        rc = bigAdd(out, out, &high);
+    bigFree(&high);
+    return rc;
+}
+
+// *out = w[0 .. nw), lowest word first; 0, or -1 when out of memory
+static inline int bitsToBig(const uint64_t *w, size_t nw, BigNum *out)
+{
+    BigNum power[BITS_BIG_LEVELS];
+    int ready = 0, j, rc;
+    for (j = 0; j < BITS_BIG_LEVELS; j++)
+        bigInit(&power[j]);
+    rc = bitsToBigSplit(w, nw, power, &ready, out);
+    for (j = 0; j < BITS_BIG_LEVELS; j++)
+        bigFree(&power[j]);
+    return rc;
+}
+
+#endif
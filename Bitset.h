@@ -0,0 +1,562 @@
+// A packed bitset and the word kernels under it, for the sieve in
+// PrimeByEratosthenes.c, "finding the first missing natural number",
+// RoaringSet.h and closestpowerof2.c.
+//
+// A Bitset is bits bits in nwords 64-bit words, bit i at bit i % 64 of
+// word i / 64, starting on a cache line. The bits past the end of the
+// last word are kept at zero by every function here, so a count or a scan
+// can run over whole words. The work is done by kernels on plain word
+// arrays, which the programs with their own arrays (a sieve segment, a
+// Roaring bitmap container) call directly:
+//
+//     bitsetAndWords() ... bitsetNotWords()   word by word, in place or not
+//     bitsetShiftUpWords() / DownWords()      the array as one long number
+//     bitsetCountWords()                      popcount of n words
+//     bitsetCountRange()                      popcount of bits [from, to)
+//     bitsetNextSet() / bitsetNextClear()     scan from a bit on, with tzcnt
+//     bitsetToIndexes()                       the set bits as a list
+//
+// AND, OR, XOR, ANDNOT and NOT take four words at a time in one AVX2
+// register when built with -mavx2 (or -march=native), and are plain loops
+// the compiler vectorizes otherwise. The count is the Harley-Seal adder of
+// Mula, Kurz and Lemire with AVX2: sixteen registers are summed bit by bit
+// through carry-save adders into a sixteens register, and only that one
+// is counted per round, by a nibble table lookup (vpshufb) and vpsadbw.
+// Without AVX2 it is the popcnt instruction a word, when built with
+// -mpopcnt; without either, the same adder on 64-bit words with one
+// bit-twiddling count for every sixteen words. The scans use tzcnt (count
+// trailing zeros) to jump to the next set bit, and bitFloorPow2() the
+// leading zero count (lzcnt) for the highest power of two that is not
+// above x, which bitFloorPow2Many() does for a whole array, eight numbers
+// an instruction with AVX-512CD.
+//
+//     Bitset b;
+//     if (bitsetInit(&b, n) == 0)
+//     {
+//         bitsetSet(&b, i);                      // ... for each member
+//         count = bitsetCount(&b);
+//         for (i = bitsetNext(&b, 0); i < b.bits; i = bitsetNext(&b, i + 1))
+//             ...                                // each member, increasing
+//         bitsetFree(&b);
+//     }
+//
+// bitsetInit() returns 0, or -1 when out of memory. Functions that
+// combine two bitsets want them the same size. Header-only.
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__AVX512CD__)
+#include <immintrin.h>
+#endif
+
+#define BITSET_LINE 64
+
+typedef struct
+{
+    uint64_t *words; // starting on a cache line
+    size_t bits, nwords;
+} Bitset;
+
+// ---------- one word ----------
+
+static inline int bitPopcount(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    w -= (w >> 1) & 0x5555555555555555ULL;
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// The lowest set bit of w, which is not 0
+static inline int bitCtz(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int c = 0;
+    for (; !(w & 1); w >>= 1)
+        c++;
+    return c;
+#endif
+}
+
+// The zero bits above the highest set bit of w, which is not 0
+static inline int bitClz(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(w);
+#else
+    int c = 0;
+    for (; !(w >> 63); w <<= 1)
+        c++;
+    return c;
+#endif
+}
+
+// The highest power of two <= x, 0 for 0
+static inline uint64_t bitFloorPow2(uint64_t x)
+{
+    return x ? 1ULL << (63 - bitClz(x)) : 0;
+}
+
+// The lowest power of two >= x, 0 when it does not fit in 64 bits
+static inline uint64_t bitCeilPow2(uint64_t x)
+{
+    if (x <= 1)
+        return 1;
+    return x > 1ULL << 63 ? 0 : 1ULL << (64 - bitClz(x - 1));
+}
+
+// out[i] = bitFloorPow2(x[i]); out may be x. With AVX-512CD eight at a
+// time: vplzcntq gives 64 for 0, and a shift by 64 gives 0
+static inline void bitFloorPow2Many(const uint64_t *x, uint64_t *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX512CD__) && defined(__AVX512F__)
+    const __m512i top = _mm512_set1_epi64((long long)(1ULL << 63));
+    for (; i < n - n % 8; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(x + i));
+        // the zero-masking forms, which GCC 12 does not warn about in C++
+        __m512i lz = _mm512_maskz_lzcnt_epi64((__mmask8)0xff, v);
+        _mm512_storeu_si512((void *)(out + i), _mm512_maskz_srlv_epi64((__mmask8)0xff, top, lz));
+    }
+#endif
+    // with no branch, so with lzcnt the loop is straight line
+    for (; i < n; i++)
+        out[i] = (1ULL << 63 >> (bitClz(x[i] | 1) & 63)) & (0 - (uint64_t)(x[i] != 0));
+}
+
+// ---------- word arrays ----------
+
+static inline size_t bitsetWordsFor(size_t bits)
+{
+    return (bits + 63) / 64;
+}
+
+static inline void bitsetSetBit(uint64_t *w, size_t i)
+{
+    w[i / 64] |= 1ULL << (i % 64);
+}
+
+static inline void bitsetClearBit(uint64_t *w, size_t i)
+{
+    w[i / 64] &= ~(1ULL << (i % 64));
+}
+
+static inline int bitsetTestBit(const uint64_t *w, size_t i)
+{
+    return (int)(w[i / 64] >> (i % 64) & 1);
+}
+
+// dst = a OP b over n words; dst may be a or b. One AVX2 body and one
+// scalar body per operation, so each is a straight run of word operations
+#if defined(__AVX2__)
+#define BITSET_WORD_LOOP(vexpr, wexpr)                                                                            \
+    size_t i, body = n - n % 4;                                                                                  \
+    for (i = 0; i < body; i += 4)                                                                                \
+    {                                                                                                            \
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));                                               \
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));                                               \
+        _mm256_storeu_si256((__m256i *)(dst + i), vexpr);                                                        \
+    }                                                                                                            \
+    for (; i < n; i++)                                                                                           \
+        dst[i] = wexpr;
+#else
+#define BITSET_WORD_LOOP(vexpr, wexpr)                                                                            \
+    size_t i;                                                                                                    \
+    for (i = 0; i < n; i++)                                                                                      \
+        dst[i] = wexpr;
+#endif
+
+static inline void bitsetAndWords(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    BITSET_WORD_LOOP(_mm256_and_si256(va, vb), a[i] & b[i])
+}
+
+static inline void bitsetOrWords(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    BITSET_WORD_LOOP(_mm256_or_si256(va, vb), a[i] | b[i])
+}
+
+static inline void bitsetXorWords(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    BITSET_WORD_LOOP(_mm256_xor_si256(va, vb), a[i] ^ b[i])
+}
+
+// a AND NOT b
+static inline void bitsetAndNotWords(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    BITSET_WORD_LOOP(_mm256_andnot_si256(vb, va), a[i] & ~b[i])
+}
+
+// dst = NOT a
+static inline void bitsetNotWords(uint64_t *dst, const uint64_t *a, size_t n)
+{
+    const uint64_t *b = a;
+    (void)b;
+    BITSET_WORD_LOOP(_mm256_xor_si256(va, _mm256_cmpeq_epi64(vb, vb)), ~a[i])
+}
+
+#undef BITSET_WORD_LOOP
+
+// dst = src shifted k bits towards the high end, as one number of n
+// words: bit i goes to bit i + k and the bottom k bits become 0. dst may
+// be src, as the high words are done first
+static inline void bitsetShiftUpWords(uint64_t *dst, const uint64_t *src, size_t n, size_t k)
+{
+    size_t by = k / 64, i;
+    unsigned s = (unsigned)(k % 64);
+    if (by >= n)
+    {
+        memset(dst, 0, n * sizeof *dst);
+        return;
+    }
+    for (i = n; i-- > by + 1;)
+        dst[i] = s ? src[i - by] << s | src[i - by - 1] >> (64 - s) : src[i - by];
+    dst[by] = src[0] << s;
+    memset(dst, 0, by * sizeof *dst);
+}
+
+// The other way: bit i goes to bit i - k and the top k bits become 0. dst
+// may be src, as the low words are done first
+static inline void bitsetShiftDownWords(uint64_t *dst, const uint64_t *src, size_t n, size_t k)
+{
+    size_t by = k / 64, i;
+    unsigned s = (unsigned)(k % 64);
+    if (by >= n)
+    {
+        memset(dst, 0, n * sizeof *dst);
+        return;
+    }
+    for (i = 0; i + by + 1 < n; i++)
+        dst[i] = s ? src[i + by] >> s | src[i + by + 1] << (64 - s) : src[i + by];
+    dst[n - by - 1] = src[n - 1] >> s;
+    memset(dst + n - by, 0, by * sizeof *dst);
+}
+
+// ---------- counting ----------
+
+// Carry-save adder: the bits of a + b + c are h (twos) and l (ones)
+#define BITSET_CSA(h, l, a, b, c, XOR, AND, OR)                                                                   \
+    do                                                                                                           \
+    {                                                                                                            \
+        u_ = XOR(a, b);                                                                                          \
+        h = OR(AND(a, b), AND(u_, c));                                                                           \
+        l = XOR(u_, c);                                                                                          \
+    } while (0)
+
+#if defined(__AVX2__)
+
+// The bit counts of the four words of v, summed up in its 64-bit lanes
+static inline __m256i bitsetCount256(__m256i v)
+{
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1,
+                                           2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+static inline uint64_t bitsetCountAvx2(const uint64_t *w, size_t n)
+{
+#define BITSET_LOAD(k) _mm256_loadu_si256((const __m256i *)(w + i + 4 * (k)))
+#define BITSET_V(h, l, a, b, c) BITSET_CSA(h, l, a, b, c, _mm256_xor_si256, _mm256_and_si256, _mm256_or_si256)
+    __m256i total = _mm256_setzero_si256(), ones = total, twos = total, fours = total, eights = total;
+    __m256i sixteens, twosA, twosB, foursA, foursB, eightsA, eightsB, u_;
+    uint64_t t[4];
+    size_t i;
+    for (i = 0; i < n - n % 64; i += 64)
+    {
+        BITSET_V(twosA, ones, ones, BITSET_LOAD(0), BITSET_LOAD(1));
+        BITSET_V(twosB, ones, ones, BITSET_LOAD(2), BITSET_LOAD(3));
+        BITSET_V(foursA, twos, twos, twosA, twosB);
+        BITSET_V(twosA, ones, ones, BITSET_LOAD(4), BITSET_LOAD(5));
+        BITSET_V(twosB, ones, ones, BITSET_LOAD(6), BITSET_LOAD(7));
+        BITSET_V(foursB, twos, twos, twosA, twosB);
+        BITSET_V(eightsA, fours, fours, foursA, foursB);
+        BITSET_V(twosA, ones, ones, BITSET_LOAD(8), BITSET_LOAD(9));
+        BITSET_V(twosB, ones, ones, BITSET_LOAD(10), BITSET_LOAD(11));
+        BITSET_V(foursA, twos, twos, twosA, twosB);
+        BITSET_V(twosA, ones, ones, BITSET_LOAD(12), BITSET_LOAD(13));
+        BITSET_V(twosB, ones, ones, BITSET_LOAD(14), BITSET_LOAD(15));
+        BITSET_V(foursB, twos, twos, twosA, twosB);
+        BITSET_V(eightsB, fours, fours, foursA, foursB);
+        BITSET_V(sixteens, eights, eights, eightsA, eightsB);
+        total = _mm256_add_epi64(total, bitsetCount256(sixteens));
+    }
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(bitsetCount256(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(bitsetCount256(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(bitsetCount256(twos), 1));
+    total = _mm256_add_epi64(total, bitsetCount256(ones));
+    for (; i < n - n % 4; i += 4)
+        total = _mm256_add_epi64(total, bitsetCount256(BITSET_LOAD(0)));
+    _mm256_storeu_si256((__m256i *)t, total);
+    t[0] += t[1] + t[2] + t[3];
+    for (; i < n; i++)
+        t[0] += (uint64_t)bitPopcount(w[i]);
+    return t[0];
+#undef BITSET_V
+#undef BITSET_LOAD
+}
+
+#elif !defined(__POPCNT__)
+
+// The bit twiddling count, which the adder below needs once per sixteen
+// words
+static inline uint64_t bitsetCountSwar(uint64_t w)
+{
+    w -= (w >> 1) & 0x5555555555555555ULL;
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (w * 0x0101010101010101ULL) >> 56;
+}
+
+static inline uint64_t bitsetCountScalar(const uint64_t *w, size_t n)
+{
+#define BITSET_XOR(a, b) ((a) ^ (b))
+#define BITSET_AND(a, b) ((a) & (b))
+#define BITSET_OR(a, b) ((a) | (b))
+#define BITSET_W(h, l, a, b, c) BITSET_CSA(h, l, a, b, c, BITSET_XOR, BITSET_AND, BITSET_OR)
+    uint64_t total = 0, ones = 0, twos = 0, fours = 0, eights = 0;
+    uint64_t sixteens, twosA, twosB, foursA, foursB, eightsA, eightsB, u_;
+    size_t i;
+    for (i = 0; i < n - n % 16; i += 16)
+    {
+        BITSET_W(twosA, ones, ones, w[i], w[i + 1]);
+        BITSET_W(twosB, ones, ones, w[i + 2], w[i + 3]);
+        BITSET_W(foursA, twos, twos, twosA, twosB);
+        BITSET_W(twosA, ones, ones, w[i + 4], w[i + 5]);
+        BITSET_W(twosB, ones, ones, w[i + 6], w[i + 7]);
+        BITSET_W(foursB, twos, twos, twosA, twosB);
+        BITSET_W(eightsA, fours, fours, foursA, foursB);
+        BITSET_W(twosA, ones, ones, w[i + 8], w[i + 9]);
+        BITSET_W(twosB, ones, ones, w[i + 10], w[i + 11]);
+        BITSET_W(foursA, twos, twos, twosA, twosB);
+        BITSET_W(twosA, ones, ones, w[i + 12], w[i + 13]);
+        BITSET_W(twosB, ones, ones, w[i + 14], w[i + 15]);
+        BITSET_W(foursB, twos, twos, twosA, twosB);
+        BITSET_W(eightsB, fours, fours, foursA, foursB);
+        BITSET_W(sixteens, eights, eights, eightsA, eightsB);
+        total += bitsetCountSwar(sixteens);
+    }
+    total = 16 * total + 8 * bitsetCountSwar(eights) + 4 * bitsetCountSwar(fours) + 2 * bitsetCountSwar(twos) +
+            bitsetCountSwar(ones);
+    for (; i < n; i++)
+        total += bitsetCountSwar(w[i]);
+    return total;
+#undef BITSET_W
+#undef BITSET_OR
+#undef BITSET_AND
+#undef BITSET_XOR
+}
+
+#endif
+
+#undef BITSET_CSA
+
+// The set bits of n words
+static inline uint64_t bitsetCountWords(const uint64_t *w, size_t n)
+{
+#if defined(__AVX2__)
+    return bitsetCountAvx2(w, n);
+#elif defined(__POPCNT__)
+    // four sums, so the popcnts do not wait for each other
+    uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+    size_t i;
+    for (i = 0; i < n - n % 4; i += 4)
+    {
+        t0 += (uint64_t)bitPopcount(w[i]);
+        t1 += (uint64_t)bitPopcount(w[i + 1]);
+        t2 += (uint64_t)bitPopcount(w[i + 2]);
+        t3 += (uint64_t)bitPopcount(w[i + 3]);
+    }
+    for (; i < n; i++)
+        t0 += (uint64_t)bitPopcount(w[i]);
+    return t0 + t1 + t2 + t3;
+#else
+    return bitsetCountScalar(w, n);
+#endif
+}
+
+// The set bits among bits from .. to - 1 of w
+static inline uint64_t bitsetCountRange(const uint64_t *w, size_t from, size_t to)
+{
+    size_t first = from / 64, last = to / 64;
+    uint64_t head, total;
+    if (from >= to)
+        return 0;
+    head = w[first] & ~0ULL << (from % 64);
+    if (first == last)
+        return (uint64_t)bitPopcount(head & ~(~0ULL << (to % 64)));
+    total = (uint64_t)bitPopcount(head) + bitsetCountWords(w + first + 1, last - first - 1);
+    if (to % 64)
+        total += (uint64_t)bitPopcount(w[last] & ~(~0ULL << (to % 64)));
+    return total;
+}
+
+// ---------- scanning ----------
+
+// The first set bit i with from <= i < bits, or bits when there is none
+static inline size_t bitsetNextSet(const uint64_t *w, size_t bits, size_t from)
+{
+    size_t i = from / 64, n = bitsetWordsFor(bits), at;
+    uint64_t word;
+    if (from >= bits)
+        return bits;
+    word = w[i] & ~0ULL << (from % 64);
+    while (word == 0)
+    {
+        if (++i >= n)
+            return bits;
+        word = w[i];
+    }
+    at = i * 64 + (size_t)bitCtz(word);
+    return at < bits ? at : bits;
+}
+
+// The first clear bit i with from <= i < bits, or bits when there is none
+static inline size_t bitsetNextClear(const uint64_t *w, size_t bits, size_t from)
+{
+    size_t i = from / 64, n = bitsetWordsFor(bits), at;
+    uint64_t word;
+    if (from >= bits)
+        return bits;
+    word = ~w[i] & ~0ULL << (from % 64);
+    while (word == 0)
+    {
+        if (++i >= n)
+            return bits;
+        word = ~w[i];
+    }
+    at = i * 64 + (size_t)bitCtz(word);
+    return at < bits ? at : bits;
+}
+
+// Stores base + i for every set bit i of n words in out, increasing, and
+// returns how many there are; out needs room for all of them
+static inline size_t bitsetToIndexes(const uint64_t *w, size_t n, uint32_t base, uint32_t *out)
+{
+    size_t i, k = 0;
+    for (i = 0; i < n; i++)
+    {
+        uint64_t bits = w[i];
+        for (; bits; bits &= bits - 1)
+            out[k++] = base + (uint32_t)(i * 64 + (size_t)bitCtz(bits));
+    }
+    return k;
+}
+
+// ---------- the bitset ----------
+
+// bits zero bits
+static inline int bitsetInit(Bitset *b, size_t bits)
+{
+    size_t bytes = (bitsetWordsFor(bits) * sizeof(uint64_t) + BITSET_LINE - 1) / BITSET_LINE * BITSET_LINE;
+    b->bits = bits;
+    b->nwords = bitsetWordsFor(bits);
+    b->words = (uint64_t *)aligned_alloc(BITSET_LINE, bytes ? bytes : BITSET_LINE);
+    if (b->words == NULL)
+        return -1;
+    memset(b->words, 0, bytes);
+    return 0;
+}
+
+static inline void bitsetFree(Bitset *b)
+{
+    free(b->words);
+    b->words = NULL;
+    b->bits = b->nwords = 0;
+}
+
+static inline void bitsetSet(Bitset *b, size_t i)
+{
+    bitsetSetBit(b->words, i);
+}
+
+static inline void bitsetClear(Bitset *b, size_t i)
+{
+    bitsetClearBit(b->words, i);
+}
+
+static inline int bitsetTest(const Bitset *b, size_t i)
+{
+    return bitsetTestBit(b->words, i);
+}
+
+// Zeroes the bits past the end, after an operation that may have set them
+static inline void bitsetTrim(Bitset *b)
+{
+    if (b->bits % 64)
+        b->words[b->nwords - 1] &= ~(~0ULL << (b->bits % 64));
+}
+
+static inline uint64_t bitsetCount(const Bitset *b)
+{
+    return bitsetCountWords(b->words, b->nwords);
+}
+
+// The first member >= from, or b->bits when there is none
+static inline size_t bitsetNext(const Bitset *b, size_t from)
+{
+    return bitsetNextSet(b->words, b->bits, from);
+}
+
+// The first non-member >= from, or b->bits when there is none
+static inline size_t bitsetNextZero(const Bitset *b, size_t from)
+{
+    return bitsetNextClear(b->words, b->bits, from);
+}
+
+static inline void bitsetAnd(Bitset *dst, const Bitset *a, const Bitset *b)
+{
+    bitsetAndWords(dst->words, a->words, b->words, dst->nwords);
+}
+
+static inline void bitsetOr(Bitset *dst, const Bitset *a, const Bitset *b)
+{
+    bitsetOrWords(dst->words, a->words, b->words, dst->nwords);
+}
+
+static inline void bitsetXor(Bitset *dst, const Bitset *a, const Bitset *b)
+{
+    bitsetXorWords(dst->words, a->words, b->words, dst->nwords);
+}
+
+static inline void bitsetAndNot(Bitset *dst, const Bitset *a, const Bitset *b)
+{
+    bitsetAndNotWords(dst->words, a->words, b->words, dst->nwords);
+}
+
+static inline void bitsetNot(Bitset *dst, const Bitset *a)
+{
+    bitsetNotWords(dst->words, a->words, dst->nwords);
+    bitsetTrim(dst);
+}
+
+// Member i becomes member i + k; dst may be a
+static inline void bitsetShiftUp(Bitset *dst, const Bitset *a, size_t k)
+{
+    bitsetShiftUpWords(dst->words, a->words, dst->nwords, k);
+    bitsetTrim(dst);
+}
+
+// Member i becomes member i - k, and members below k go; dst may be a
+static inline void bitsetShiftDown(Bitset *dst, const Bitset *a, size_t k)
+{
+    bitsetShiftDownWords(dst->words, a->words, dst->nwords, k);
+}
+
+#endif
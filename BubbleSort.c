@@ -1,13 +1,19 @@
 // Bubble sort code 
  
 #include <stdio.h>
+#include <stdlib.h>
  
 int main()
 {
-  int array[100], n, c, d, swap;
+  int *array, n, c, d, swap;
  
   printf("Enter number of elements\n");
   scanf("%d", &n);
+
+  /* room for any number of elements */
+  array = malloc((n > 0 ? n : 1) * sizeof *array);
+  if (array == NULL)
+    return 1;
  
   printf("Enter %d integers\n", n);
  
@@ -32,5 +38,6 @@ int main()
   for (c = 0; c < n; c++)
      printf("%d\n", array[c]);
  
+  free(array);
   return 0;
 }
@@ -0,0 +1,200 @@
+// Byte order, for endian.c and anything that reads or writes big-endian
+// wire formats (network captures, file headers).
+//
+// BYTE_ORDER_LITTLE is 1 or 0, decided at compile time from the
+// compiler's __BYTE_ORDER__, so the tests below fold away; endian.c
+// still checks it against memory at run time.
+//
+//   - loadBe16/32/64() and storeBe16/32/64() read and write big-endian
+//     values at any address, and loadLe/storeLe little-endian ones. Each
+//     is a memcpy and, where the order differs, one bswap, which the
+//     compiler turns into a single movbe or load and bswap.
+//   - bswap16Array/32/64() reverse the bytes of every element of an
+//     array, in place or into another one: with AVX2 32 bytes per
+//     vpshufb, with SSSE3 16 bytes per pshufb, otherwise one bswap per
+//     element. beToHost32Array() and the like are those on a little-
+//     endian machine and a copy on a big-endian one.
+//
+// Header-only.
+
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BYTE_ORDER_LITTLE 0
+#else
+#define BYTE_ORDER_LITTLE 1
+#endif
+
+static inline uint16_t loadBe16(const void *p)
+{
+    uint16_t x;
+    memcpy(&x, p, 2);
+    return BYTE_ORDER_LITTLE ? __builtin_bswap16(x) : x;
+}
+
+static inline uint32_t loadBe32(const void *p)
+{
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return BYTE_ORDER_LITTLE ? __builtin_bswap32(x) : x;
+}
+
+static inline uint64_t loadBe64(const void *p)
+{
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return BYTE_ORDER_LITTLE ? __builtin_bswap64(x) : x;
+}
+
+static inline void storeBe16(void *p, uint16_t x)
+{
+    x = BYTE_ORDER_LITTLE ? __builtin_bswap16(x) : x;
+    memcpy(p, &x, 2);
+}
+
+static inline void storeBe32(void *p, uint32_t x)
+{
+    x = BYTE_ORDER_LITTLE ? __builtin_bswap32(x) : x;
+    memcpy(p, &x, 4);
+}
+
+static inline void storeBe64(void *p, uint64_t x)
+{
+    x = BYTE_ORDER_LITTLE ? __builtin_bswap64(x) : x;
+    memcpy(p, &x, 8);
+}
+
+static inline uint16_t loadLe16(const void *p)
+{
+    uint16_t x;
+    memcpy(&x, p, 2);
+    return BYTE_ORDER_LITTLE ? x : __builtin_bswap16(x);
+}
+
+static inline uint32_t loadLe32(const void *p)
+{
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return BYTE_ORDER_LITTLE ? x : __builtin_bswap32(x);
+}
+
+static inline uint64_t loadLe64(const void *p)
+{
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return BYTE_ORDER_LITTLE ? x : __builtin_bswap64(x);
+}
+
+static inline void storeLe16(void *p, uint16_t x)
+{
+    x = BYTE_ORDER_LITTLE ? x : __builtin_bswap16(x);
+    memcpy(p, &x, 2);
+}
+
+static inline void storeLe32(void *p, uint32_t x)
+{
+    x = BYTE_ORDER_LITTLE ? x : __builtin_bswap32(x);
+    memcpy(p, &x, 4);
+}
+
+static inline void storeLe64(void *p, uint64_t x)
+{
+    x = BYTE_ORDER_LITTLE ? x : __builtin_bswap64(x);
+    memcpy(p, &x, 8);
+}
+
+static const unsigned char bswapMask16[16] = {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+static const unsigned char bswapMask32[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+static const unsigned char bswapMask64[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+// Shuffles whole vectors of in[0 .. bytes) into out with mask, the pshufb
+// pattern for 16 bytes; returns how many bytes it did, which leaves less
+// than one vector for the caller
+static inline size_t bswapVectors(const void *in, void *out, size_t bytes, const unsigned char *mask)
+{
+    const unsigned char *s = (const unsigned char *)in;
+    unsigned char *d = (unsigned char *)out;
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i m = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask));
+    for (; i + 32 <= bytes; i += 32)
+        _mm256_storeu_si256((__m256i *)(d + i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(s + i)), m));
+#elif defined(__SSSE3__)
+    __m128i m = _mm_loadu_si128((const __m128i *)mask);
+    for (; i + 16 <= bytes; i += 16)
+        _mm_storeu_si128((__m128i *)(d + i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + i)), m));
+#else
+    (void)s;
+    (void)d;
+    (void)bytes;
+    (void)mask;
+#endif
+    return i;
+}
+
+// out[i] = in[i] with its bytes reversed, for i < n; in may be out. What
+// is left after the vectors is a plain loop, which without SSSE3 is all of
+// it and which the compiler can still vectorize with shifts.
+static inline void bswap16Array(const uint16_t *in, uint16_t *out, size_t n)
+{
+    size_t i;
+    for (i = bswapVectors(in, out, n * 2, bswapMask16) / 2; i < n; i++)
+        out[i] = __builtin_bswap16(in[i]);
+}
+
+static inline void bswap32Array(const uint32_t *in, uint32_t *out, size_t n)
+{
+    size_t i;
+    for (i = bswapVectors(in, out, n * 4, bswapMask32) / 4; i < n; i++)
+        out[i] = __builtin_bswap32(in[i]);
+}
+
+static inline void bswap64Array(const uint64_t *in, uint64_t *out, size_t n)
+{
+    size_t i;
+    for (i = bswapVectors(in, out, n * 8, bswapMask64) / 8; i < n; i++)
+        out[i] = __builtin_bswap64(in[i]);
+}
+
+// Big-endian arrays to this machine's order and back, which is the same
+// operation both ways
+static inline void beToHost16Array(const uint16_t *in, uint16_t *out, size_t n)
+{
+    if (BYTE_ORDER_LITTLE)
+        bswap16Array(in, out, n);
+    else if (in != out)
+        memmove(out, in, n * 2);
+}
+
+static inline void beToHost32Array(const uint32_t *in, uint32_t *out, size_t n)
+{
+    if (BYTE_ORDER_LITTLE)
+        bswap32Array(in, out, n);
+    else if (in != out)
+        memmove(out, in, n * 4);
+}
+
+static inline void beToHost64Array(const uint64_t *in, uint64_t *out, size_t n)
+{
+    if (BYTE_ORDER_LITTLE)
+        bswap64Array(in, out, n);
+    else if (in != out)
+        memmove(out, in, n * 8);
+}
+
+#define hostToBe16Array beToHost16Array
+#define hostToBe32Array beToHost32Array
+#define hostToBe64Array beToHost64Array
+
+#endif
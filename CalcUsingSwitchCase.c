@@ -1,11 +1,23 @@
 // Very tiny and stupid Calculator using switch case
 //Answer will be 0 in case 4 if quotients value is in points.
 //For instance, 5/3 will be shown as 0. This is because we have declared c as integer and not float.
+//Give a whole formula as the argument, such as "(5 + 3) * 2 % 7", to have it worked out in
+//floating point by Expr.h instead (build with -lm -pthread).
 
 #include <stdio.h>
-  int main() {
-    int a, b, c;
+#include "Expr.h"
+  int main(int argc, char *argv[]) {
+    int a, b, c = 0;
     char ch;
+    if (argc > 1) {
+      ExprProgram prog;
+      if (exprCompile(&prog, argv[1], NULL, 0) != 0) {
+        printf("%s\n%*s^ %s\n", argv[1], (int) prog.errorAt, "", prog.error);
+        return 1;
+      }
+      printf("calculated value=%g\n", exprEval(&prog, NULL));
+      return 0;
+    }
     printf("enter two number\n");
     scanf("%d%d", & a, & b);
     fflush(stdin);
@@ -17,7 +29,7 @@
     printf("3. enter 3 for multiplication\n");
     printf("4. Enter 4 for division\n");
     printf("5. enter 5 for modulo division\n");
-    scanf("%c", & ch);
+    scanf(" %c", & ch);
     switch (ch) {
     case '1':
       c = a + b;
@@ -36,6 +48,7 @@
       break;
     default:
       printf("wrong choice");
+      return 1;
     }
     printf("calculated value=%d", c);
 
@@ -1,19 +1,20 @@
 #include<stdio.h>
-main()
+#include "Interest.h"
+int main()
 {
     int principleAmount;
     int numberOfYears;
     int rateOfInterest;
     int SimpleInterest;
-    printf("enter principleAmount\n",principleAmount);
+    printf("enter principleAmount\n");
     scanf("%d",&principleAmount);
-    printf("enter number of year\n",numberOfYears);
+    printf("enter number of year\n");
     scanf("%d",&numberOfYears);
-    printf("enter rate of interest\n",rateOfInterest);
+    printf("enter rate of interest\n");
     scanf("%d",&rateOfInterest);
 
-    SimpleInterest=(principleAmount*numberOfYears*rateOfInterest)/100;
+    SimpleInterest=(int)simpleInterest(principleAmount,rateOfInterest,numberOfYears);
     printf("Simple interest is %d",SimpleInterest);
-
+    return 0;
 
 }
@@ -0,0 +1,266 @@
+// Dates for the leap-year programs and DayNameUsingSwitchCase.c, and for
+// bucketing Unix timestamps by day and weekday in bulk.
+//
+// Days are counted from 1970-01-01, day 0, on the proleptic Gregorian
+// calendar, and weekdays go 1 = Monday .. 7 = Sunday, as in ISO 8601 and
+// DayNameUsingSwitchCase.c. calDaysFromCivil() and calCivilFromDays() are
+// Howard Hinnant's conversions: the year is taken to start on March 1,
+// which puts February 29 last, so the day of the year falls out of one
+// linear formula, (153 m + 2) / 5, and 400-year eras of 146097 days
+// handle the centuries; there is no table and no loop. calIsLeap() is
+// branchless: a year is leap when it is a multiple of 4 and, if it is a
+// multiple of 25 (of 100, then), of 16 as well, so the %4/%100/%400 chain
+// comes down to one mask picked by y % 25.
+//
+// The array functions run four or eight at a time with AVX2. The
+// conversions are all floor divisions by constants, which AVX2 has no
+// instruction for on 64-bit integers, so they are done in doubles: every
+// value in them is an integer below 2^50, and floor(x / b) is the floor
+// of (x + 1/2) times the reciprocal, one FMA, which the rounding cannot
+// push past an integer. The leap test is on eight int32 years at once,
+// with y % 25 == 0 tested by a multiply by the inverse of 25 mod 2^32.
+// Without AVX2 they are loops over the scalar functions.
+//
+// calSecondsArray() gives the day and the weekday of timestamps in one
+// pass. The name tables are indexed by those numbers, entry 0 empty.
+// Timestamps go to +-2^47 seconds and days to +-2^31, about 4.4 million
+// years either way; the leap test takes years to +-2^30. Header-only.
+
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define CAL_DAY_SECONDS 86400
+#define CAL_EPOCH_SHIFT 719468 // days from 0000-03-01 to 1970-01-01
+
+static const char *const calDayNames[8] = {
+    "", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
+static const char *const calDayShort[8] = {"", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+static const char *const calMonthNames[13] = {
+    "", "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"};
+
+typedef struct
+{
+    int32_t year;
+    uint8_t month, day; // 1 .. 12, 1 .. 31
+} CalDate;
+
+static inline int calIsLeap(int32_t y)
+{
+    return (y & (y % 25 ? 3 : 15)) == 0;
+}
+
+static inline int calMonthDays(int32_t y, int m)
+{
+    return m == 2 ? 28 + calIsLeap(y) : 30 + ((m + (m >> 3)) & 1);
+}
+
+static inline int64_t calFloorDiv(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    return q - (a % b < 0);
+}
+
+static inline int32_t calDaysFromCivil(int32_t y, int m, int d)
+{
+    int64_t year = (int64_t)y - (m <= 2), era = calFloorDiv(year, 400);
+    int64_t yoe = year - era * 400;                                 // 0 .. 399
+    int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1; // 0 .. 365
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;           // 0 .. 146096
+    return (int32_t)(era * 146097 + doe - CAL_EPOCH_SHIFT);
+}
+
+static inline CalDate calCivilFromDays(int32_t days)
+{
+    int64_t z = (int64_t)days + CAL_EPOCH_SHIFT, era = calFloorDiv(z, 146097);
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    CalDate c;
+    c.day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    c.month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    c.year = (int32_t)(yoe + era * 400 + (c.month <= 2));
+    return c;
+}
+
+static inline int calWeekday(int32_t days)
+{
+    int w = (int)(((int64_t)days + 3) % 7); // 1970-01-01 was a Thursday
+    return w + (w < 0 ? 7 : 0) + 1;
+}
+
+static inline int32_t calDayOfSeconds(int64_t t)
+{
+    return (int32_t)calFloorDiv(t, CAL_DAY_SECONDS);
+}
+
+#if defined(__AVX2__)
+// floor(x / b) for an integer x below 2^50 in size: (x + 1/2) / b is at
+// least 1 / 2b from an integer, and the rounding moves it less than that
+static inline __m256d calDiv4(__m256d x, double b)
+{
+#if defined(__FMA__)
+    return _mm256_floor_pd(_mm256_fmadd_pd(x, _mm256_set1_pd(1 / b), _mm256_set1_pd(0.5 / b)));
+#else
+    return _mm256_floor_pd(_mm256_mul_pd(_mm256_add_pd(x, _mm256_set1_pd(0.5)), _mm256_set1_pd(1 / b)));
+#endif
+}
+
+static inline __m256d calSelect4(__m256d flag, double v)
+{
+    return _mm256_and_pd(flag, _mm256_set1_pd(v));
+}
+
+// Four doubles that are integers 0 .. 255 into out[0 .. 4)
+static inline void calStoreBytes4(uint8_t *out, __m256d x)
+{
+    __m128i v = _mm256_cvttpd_epi32(x);
+    int32_t packed;
+    v = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+    packed = _mm_cvtsi128_si32(v);
+    memcpy(out, &packed, 4);
+}
+
+static inline __m256d calLoadBytes4(const uint8_t *in)
+{
+    int32_t packed;
+    memcpy(&packed, in, 4);
+    return _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+}
+
+// The weekday, as a double 1 .. 7, of days as doubles
+static inline __m256d calWeekday4(__m256d days)
+{
+    __m256d z = _mm256_add_pd(days, _mm256_set1_pd(3));
+    __m256d w = _mm256_sub_pd(z, _mm256_mul_pd(calDiv4(z, 7), _mm256_set1_pd(7)));
+    return _mm256_add_pd(w, _mm256_set1_pd(1));
+}
+#endif
+
+// leap[i] = calIsLeap(year[i])
+static inline void calLeapArray(const int32_t *year, uint8_t *leap, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i three = _mm256_set1_epi32(3), fifteen = _mm256_set1_epi32(15), zero = _mm256_setzero_si256();
+    const __m256i inverse = _mm256_set1_epi32((int32_t)0xC28F5C29u); // 25 * this = 1 mod 2^32
+    const __m256i bias = _mm256_set1_epi32(1073741800);              // 25 * 42949672, makes y >= 0
+    const __m256i limit = _mm256_set1_epi32(171798691);              // (2^32 - 1) / 25
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i y = _mm256_loadu_si256((const __m256i *)(year + i));
+        __m256i u = _mm256_mullo_epi32(_mm256_add_epi32(y, bias), inverse);
+        __m256i by25 = _mm256_cmpeq_epi32(_mm256_min_epu32(u, limit), u);
+        __m256i mask = _mm256_blendv_epi8(three, fifteen, by25);
+        __m256i is = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(y, mask), zero), _mm256_set1_epi32(1));
+        __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(is), _mm256_extracti128_si256(is, 1));
+        _mm_storel_epi64((__m128i *)(leap + i), _mm_packus_epi16(w, w));
+    }
+#endif
+    for (; i < n; i++)
+        leap[i] = (uint8_t)calIsLeap(year[i]);
+}
+
+// days[i] = calDayOfSeconds(seconds[i]), and weekday[i] = calWeekday() of
+// it when weekday is not NULL
+static inline void calSecondsArray(const int64_t *seconds, int32_t *days, uint8_t *weekday, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    // 2^52 + 2^51: added to an int64 below 2^51 in size, it gives the bits of
+    // a double from which the same sum, taken off, leaves the int64's value
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(seconds + i));
+        __m256d x = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(t, _mm256_castpd_si256(magic))), magic);
+        __m256d d = calDiv4(x, CAL_DAY_SECONDS);
+        _mm_storeu_si128((__m128i *)(days + i), _mm256_cvttpd_epi32(d));
+        if (weekday != NULL)
+            calStoreBytes4(weekday + i, calWeekday4(d));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        days[i] = calDayOfSeconds(seconds[i]);
+        if (weekday != NULL)
+            weekday[i] = (uint8_t)calWeekday(days[i]);
+    }
+}
+
+// weekday[i] = calWeekday(days[i])
+static inline void calWeekdayArray(const int32_t *days, uint8_t *weekday, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4)
+        calStoreBytes4(weekday + i, calWeekday4(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(days + i)))));
+#endif
+    for (; i < n; i++)
+        weekday[i] = (uint8_t)calWeekday(days[i]);
+}
+
+// The dates of days[0 .. n), into year, month and day
+static inline void calCivilArray(const int32_t *days, int32_t *year, uint8_t *month, uint8_t *day, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d z = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(days + i))),
+                                  _mm256_set1_pd(CAL_EPOCH_SHIFT));
+        __m256d era = calDiv4(z, 146097), doe, yoe, doy, mp, m, y, shortYear;
+        doe = _mm256_sub_pd(z, _mm256_mul_pd(era, _mm256_set1_pd(146097)));
+        yoe = _mm256_add_pd(_mm256_sub_pd(doe, calDiv4(doe, 1460)), calDiv4(doe, 36524));
+        yoe = calDiv4(_mm256_sub_pd(yoe, calDiv4(doe, 146096)), 365);
+        shortYear = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(yoe, _mm256_set1_pd(365)), calDiv4(yoe, 4)), calDiv4(yoe, 100));
+        doy = _mm256_sub_pd(doe, shortYear);
+        mp = calDiv4(_mm256_add_pd(_mm256_mul_pd(doy, _mm256_set1_pd(5)), _mm256_set1_pd(2)), 153);
+        calStoreBytes4(day + i, _mm256_add_pd(_mm256_sub_pd(doy, calDiv4(_mm256_add_pd(_mm256_mul_pd(mp, _mm256_set1_pd(153)), _mm256_set1_pd(2)), 5)), _mm256_set1_pd(1)));
+        m = _mm256_sub_pd(_mm256_add_pd(mp, _mm256_set1_pd(3)), calSelect4(_mm256_cmp_pd(mp, _mm256_set1_pd(10), _CMP_GE_OQ), 12));
+        calStoreBytes4(month + i, m);
+        y = _mm256_add_pd(_mm256_add_pd(yoe, _mm256_mul_pd(era, _mm256_set1_pd(400))), calSelect4(_mm256_cmp_pd(m, _mm256_set1_pd(2), _CMP_LE_OQ), 1));
+        _mm_storeu_si128((__m128i *)(year + i), _mm256_cvttpd_epi32(y));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        CalDate c = calCivilFromDays(days[i]);
+        year[i] = c.year;
+        month[i] = c.month;
+        day[i] = c.day;
+    }
+}
+
+// days[i] = calDaysFromCivil(year[i], month[i], day[i])
+static inline void calDaysFromCivilArray(const int32_t *year, const uint8_t *month, const uint8_t *day, int32_t *days, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d m = calLoadBytes4(month + i), d = calLoadBytes4(day + i);
+        __m256d early = _mm256_cmp_pd(m, _mm256_set1_pd(2), _CMP_LE_OQ);
+        __m256d y = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(year + i))), calSelect4(early, 1));
+        __m256d era = calDiv4(y, 400), yoe, mm, doy, doe, z;
+        yoe = _mm256_sub_pd(y, _mm256_mul_pd(era, _mm256_set1_pd(400)));
+        mm = _mm256_add_pd(_mm256_sub_pd(m, _mm256_set1_pd(3)), calSelect4(early, 12));
+        doy = _mm256_add_pd(calDiv4(_mm256_add_pd(_mm256_mul_pd(mm, _mm256_set1_pd(153)), _mm256_set1_pd(2)), 5), _mm256_sub_pd(d, _mm256_set1_pd(1)));
+        doe = _mm256_add_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(yoe, _mm256_set1_pd(365)), calDiv4(yoe, 4)), calDiv4(yoe, 100)), doy);
+        z = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(era, _mm256_set1_pd(146097)), doe), _mm256_set1_pd(CAL_EPOCH_SHIFT));
+        _mm_storeu_si128((__m128i *)(days + i), _mm256_cvttpd_epi32(z));
+    }
+#endif
+    for (; i < n; i++)
+        days[i] = calDaysFromCivil(year[i], month[i], day[i]);
+}
+
+#endif
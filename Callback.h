@@ -0,0 +1,131 @@
+// Algorithms written out once per comparator or operator, for
+// lambda_in_c.c and any code that would pass a function to qsort().
+//
+// A comparator passed as a pointer, a clang block or a GCC nested function
+// is called indirectly, once per comparison, from code that was compiled
+// without knowing it: the call cannot be inlined, and everything around it
+// in the loop waits for it. A nested function that uses its caller's
+// variables is worse, as its address is a trampoline built on the stack,
+// which must then be executable. Here the comparator is a macro instead,
+// an expression of x and y, and the macros below write the algorithm with
+// it pasted in, so the compiler sees the whole loop and there is no
+// indirect call at all:
+//
+//   SORTLIB_DEFINE(suffix, type, LESS)         (SortLib.h)
+//       void sort_<suffix>(type *a, size_t n)
+//       int stable_sort_<suffix>(type *a, size_t n)
+//   CALLBACK_SEARCH_DEFINE(suffix, type, LESS)
+//       size_t lower_bound_<suffix>(const type *a, size_t n, type x)
+//           the first i with !LESS(a[i], x), or n, on an array sorted
+//           by LESS; halving with no branch on the data
+//       int binary_search_<suffix>(const type *a, size_t n, type x)
+//   CALLBACK_FOLD_DEFINE(suffix, type, OP)
+//       type fold_<suffix>(const type *a, size_t n, type init)
+//           OP(... OP(OP(init, a[0]), a[1]) ..., a[n - 1]) in some order,
+//           so OP must be associative and commutative, as + * min max
+//           & | ^ are: four running results, combined at the end, keep
+//           the loop from waiting on one
+//   CALLBACK_DEFINE(suffix, type, LESS, OP)
+//       all of the above
+//
+// LESS and OP may use anything in scope where the macro is expanded, such
+// as a static variable, which is how a "lambda" captures state; they are
+// evaluated more than once, so they must not have side effects that
+// matter. Ready-made: lower_bound and binary_search for i32, i64, u64 and
+// f64 (NaNs last, as SortLib.h sorts them), and fold_sum_i64 and
+// fold_sum_f64. CALLBACK_SORT(), CALLBACK_LOWER_BOUND() and CALLBACK_SUM()
+// pick the ready-made function for the type of the array with _Generic
+// (C11). Header-only.
+
+#ifndef CALLBACK_H
+#define CALLBACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SortLib.h"
+
+#define CALLBACK_ADD(x, y) ((x) + (y))
+#define CALLBACK_MIN(x, y) ((y) < (x) ? (y) : (x))
+#define CALLBACK_MAX(x, y) ((x) < (y) ? (y) : (x))
+
+#define CALLBACK_SEARCH_DEFINE(suffix, type, LESS)                             \
+                                                                               \
+static inline size_t lower_bound_##suffix(const type *a, size_t n, type x)     \
+{                                                                              \
+    const type *base = a;                                                      \
+    if (n == 0)                                                                \
+        return 0;                                                              \
+    while (n > 1)                                                              \
+    {                                                                          \
+        size_t half = n / 2;                                                   \
+        base = LESS(base[half], x) ? base + half : base;                       \
+        n -= half;                                                             \
+    }                                                                          \
+    return (size_t)(base - a) + (LESS(*base, x) ? 1 : 0);                      \
+}                                                                              \
+                                                                               \
+static inline int binary_search_##suffix(const type *a, size_t n, type x)      \
+{                                                                              \
+    size_t i = lower_bound_##suffix(a, n, x);                                  \
+    return i < n && !LESS(x, a[i]);                                            \
+}
+
+#define CALLBACK_FOLD_DEFINE(suffix, type, OP)                                 \
+                                                                               \
+static inline type fold_##suffix(const type *a, size_t n, type init)           \
+{                                                                              \
+    type r0, r1, r2, r3;                                                       \
+    size_t i;                                                                  \
+    if (n < 4)                                                                 \
+    {                                                                          \
+        for (i = 0; i < n; i++)                                                \
+            init = OP(init, a[i]);                                             \
+        return init;                                                           \
+    }                                                                          \
+    r0 = a[0];                                                                 \
+    r1 = a[1];                                                                 \
+    r2 = a[2];                                                                 \
+    r3 = a[3];                                                                 \
+    for (i = 4; i + 4 <= n; i += 4)                                            \
+    {                                                                          \
+        r0 = OP(r0, a[i]);                                                     \
+        r1 = OP(r1, a[i + 1]);                                                 \
+        r2 = OP(r2, a[i + 2]);                                                 \
+        r3 = OP(r3, a[i + 3]);                                                 \
+    }                                                                          \
+    for (; i < n; i++)                                                         \
+        r0 = OP(r0, a[i]);                                                     \
+    r0 = OP(r0, r1);                                                           \
+    r2 = OP(r2, r3);                                                           \
+    return OP(init, OP(r0, r2));                                               \
+}
+
+#define CALLBACK_DEFINE(suffix, type, LESS, OP)                                \
+    SORTLIB_DEFINE(suffix, type, LESS)                                         \
+    CALLBACK_SEARCH_DEFINE(suffix, type, LESS)                                 \
+    CALLBACK_FOLD_DEFINE(suffix, type, OP)
+
+CALLBACK_SEARCH_DEFINE(i32, int32_t, SORTLIB_LESS)
+CALLBACK_SEARCH_DEFINE(i64, int64_t, SORTLIB_LESS)
+CALLBACK_SEARCH_DEFINE(u64, uint64_t, SORTLIB_LESS)
+CALLBACK_SEARCH_DEFINE(f64, double, SORTLIB_LESS_FLOAT)
+CALLBACK_FOLD_DEFINE(sum_i64, int64_t, CALLBACK_ADD)
+CALLBACK_FOLD_DEFINE(sum_f64, double, CALLBACK_ADD)
+
+#define CALLBACK_SORT(a, n)                                                    \
+    _Generic((a), int32_t *: sort_i32, int64_t *: sort_i64,                    \
+             uint64_t *: sort_u64, float *: sort_f32, double *: sort_f64,      \
+             SortKV *: sort_kv)(a, n)
+
+#define CALLBACK_LOWER_BOUND(a, n, x)                                          \
+    _Generic((a), int32_t *: lower_bound_i32,                                  \
+             const int32_t *: lower_bound_i32, int64_t *: lower_bound_i64,     \
+             const int64_t *: lower_bound_i64, uint64_t *: lower_bound_u64,    \
+             const uint64_t *: lower_bound_u64, double *: lower_bound_f64,     \
+             const double *: lower_bound_f64)(a, n, x)
+
+#define CALLBACK_SUM(a, n)                                                     \
+    _Generic((a), int64_t *: fold_sum_i64, const int64_t *: fold_sum_i64,      \
+             double *: fold_sum_f64, const double *: fold_sum_f64)(a, n, 0)
+
+#endif
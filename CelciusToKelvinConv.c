@@ -1,13 +1,17 @@
 // Celsius to Kelvin converter
 
 #include <stdio.h>
+#include "TempScale.h"
 
 int main()
 {
 	double c, k;
+	TempTransform t;
+	tempTransform(TEMP_CELSIUS, TEMP_KELVIN, &t);
 	printf("Enter the desired temperature in Celcius:\n");
-	scanf("%c", &c);
-	k = c + 273.15;
+	if (scanf("%lf", &c) != 1)
+		return 1;
+	k = tempApply(t, c);
 	printf("Converted value: %f K\n", k);
 	return 0;
 }
@@ -1,39 +1,52 @@
 #include <stdio.h>
-#include <math.h>//used because of predefined power function
+#include "IntText.h"
+
+// The no. is read as digits in base x and turned into a value by Horner's
+// rule, a = a*x + digit, in integers; pow() in doubles lost digits past
+// 2^53. IntText.h then writes the value in base y, so any base up to 36
+// works, with A .. Z past 9, where the old answer had to fit as decimal
+// digits in a long long.
 
 int main()
 {
-	long long int n,x,y,b,j=-1,c,d,e,a=0,k=-1,f=0;
+	long long int n,x,y,b,a=0,p=1;
+	char out[INT_TEXT_MAX];
 
 	printf("This program converts the no. from one base to another\n");
 
 	printf("enter the no. you want to convert\n");
-	scanf("%lld",&n);
+	if(scanf("%lld",&n)!=1 || n<0)
+		return 1;
 	
 	printf("enter the base of no.\n");
-	scanf("%lld",&x);
+	if(scanf("%lld",&x)!=1 || x<2 || x>10)
+	{
+		printf("the base of the no. must be between 2 and 10\n");
+		return 1;
+	}
 	
 	printf("enter the base to which you want to convert\n");
-	scanf("%lld",&y);
-	
-	while(n>0)
+	if(scanf("%lld",&y)!=1 || y<2 || y>36)
 	{
-		b=n%10;
-	    n=n/10;	
-        j++;	
-       	d=b*pow(x,j);
-	    a=d+a;//converted the no. to base 10
+		printf("the base to convert to must be between 2 and 36\n");
+		return 1;
 	}
-
-	while(a>0)
+	
+	// the highest decimal place of n, so its digits go from the top down
+	while(p<=n/10)
+		p*=10;
+	for(;p>0;p/=10)
 	{
-		c=a%y;
-	    a=a/y;
-	    k++;
-	    e=c*pow(10,k);
-	    f=e+f;//converted the no. to base user wanted
+		b=n/p%10;
+		if(b>=x)
+		{
+			printf("%lld is not a digit in base %lld\n",b,x);
+			return 1;
+		}
+		a=a*x+b;//converted the no. to base 10
 	}
 
-	printf("%lld\n",f);
+	u64ToBase((unsigned long long)a,(unsigned)y,out);//converted the no. to base user wanted
+	printf("%s\n",out);
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,134 @@
+// Table-driven character classification shared by CheckCharacterType.c
+// and VowelorConsonant.c.
+//
+// Each byte is looked up in one 256-entry table of class flags, so a
+// character is classified with a single load instead of a chain of range
+// comparisons. Bulk helpers count the classes over a whole buffer, build a
+// bitmap of the positions of a class, and skip over a run of one class.
+// Bytes of 128 and above count as other.
+
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CC_ALPHA 1
+#define CC_DIGIT 2
+#define CC_VOWEL 4
+#define CC_SPACE 8
+#define CC_OTHER 16 // not a letter, digit or white space
+
+#define CC_NFLAGS 5
+
+#define A CC_ALPHA
+#define D CC_DIGIT
+#define V CC_VOWEL
+#define S CC_SPACE
+#define O CC_OTHER
+static const unsigned char ccTable[256] =
+{
+    /* 0x00 */ O, O, O, O, O, O, O, O, O, S, S, S, S, S, O, O,
+    /* 0x10 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0x20 */ S, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0x30 */ D, D, D, D, D, D, D, D, D, D, O, O, O, O, O, O,
+    /* 0x40 */ O, A | V, A, A, A, A | V, A, A, A, A | V, A, A, A, A, A, A | V,
+    /* 0x50 */ A, A, A, A, A, A | V, A, A, A, A, A, O, O, O, O, O,
+    /* 0x60 */ O, A | V, A, A, A, A | V, A, A, A, A | V, A, A, A, A, A, A | V,
+    /* 0x70 */ A, A, A, A, A, A | V, A, A, A, A, A, O, O, O, O, O,
+    /* 0x80 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0x90 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xA0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xB0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xC0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xD0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xE0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    /* 0xF0 */ O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+};
+#undef A
+#undef D
+#undef V
+#undef S
+#undef O
+
+static inline unsigned char ccClass(char c)
+{
+    return ccTable[(unsigned char)c];
+}
+
+// counts[k] = number of bytes of s[0..n) that have flag 1 << k.
+// The bytes are histogrammed first, into four tables so that runs of
+// the same byte do not wait on each other's increments. Only the 256
+// totals are then looked up in the class table.
+static inline void ccCount(const char *s, size_t n, size_t counts[CC_NFLAGS])
+{
+    size_t hist[4][256];
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i;
+    int c, k;
+
+    memset(hist, 0, sizeof hist);
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        hist[0][p[i]]++;
+        hist[1][p[i + 1]]++;
+        hist[2][p[i + 2]]++;
+        hist[3][p[i + 3]]++;
+    }
+    for (; i < n; i++)
+        hist[0][p[i]]++;
+
+    for (k = 0; k < CC_NFLAGS; k++)
+        counts[k] = 0;
+    for (c = 0; c < 256; c++)
+    {
+        size_t total = hist[0][c] + hist[1][c] + hist[2][c] + hist[3][c];
+        for (k = 0; k < CC_NFLAGS; k++)
+        {
+            if (ccTable[c] & (1 << k))
+                counts[k] += total;
+        }
+    }
+}
+
+// Sets bit i of bits (64 positions per word) when s[i] has any of the
+// flags in mask. bits must hold (n + 63) / 64 words.
+static inline void ccMask(const char *s, size_t n, unsigned char mask, uint64_t *bits)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    size_t w, i;
+
+    for (w = 0; w * 64 < n; w++)
+    {
+        size_t end = (w + 1) * 64 < n ? (w + 1) * 64 : n;
+        uint64_t word = 0;
+        for (i = w * 64; i < end; i++)
+            word |= (uint64_t)((ccTable[p[i]] & mask) != 0) << (i % 64);
+        bits[w] = word;
+    }
+}
+
+// Index of the first clear bit at or after pos (or n if there is none),
+// which is where the run of the class given to ccMask ends.
+// It moves forward 64 positions per step.
+static inline size_t ccRunEnd(const uint64_t *bits, size_t n, size_t pos)
+{
+    size_t w = pos / 64;
+    uint64_t clear;
+
+    if (pos >= n)
+        return n;
+
+    clear = ~bits[w] & (~0ULL << (pos % 64));
+    while (clear == 0)
+    {
+        if (++w * 64 >= n)
+            return n;
+        clear = ~bits[w];
+    }
+    pos = w * 64 + (size_t)__builtin_ctzll(clear);
+    return pos < n ? pos : n;
+}
+
+#endif
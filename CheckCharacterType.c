@@ -2,13 +2,37 @@
 
 
 #include <stdio.h>
-  int main() {
+
+#include "CharClass.h"
+#include "StringKernels.h"
+
+// Bulk mode: counts alphabets, digits, white space and special symbols
+// in a whole file (or stdin for -)
+  int countFile(const char * path) {
+    size_t size, counts[CC_NFLAGS];
+    char * text = skReadFile(path, & size);
+    if (text == NULL) {
+      printf("Cannot read %s\n", path);
+      return 1;
+    }
+    ccCount(text, size, counts);
+    printf("Alphabets        : %zu\n", counts[0]);
+    printf("Digits           : %zu\n", counts[1]);
+    printf("White space      : %zu\n", counts[3]);
+    printf("Special symbols  : %zu\n", counts[4]);
+    free(text);
+    return 0;
+  }
+
+  int main(int argc, char * argv[]) {
     char ch;
+    if (argc == 2)
+      return countFile(argv[1]);
     printf("Enter a character\n");
     scanf("%c", & ch);
-    if ((ch >= 65 && ch <= 90) || (ch >= 97 && ch <= 122))
+    if (ccClass(ch) & CC_ALPHA)
       printf("Entered character is an alphabet");
-    else if (ch >= 48 && ch <= 57)
+    else if (ccClass(ch) & CC_DIGIT)
       printf("Entered character is a digit");
     else
       printf("Entered character is a special symbol");
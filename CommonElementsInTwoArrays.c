@@ -1,26 +1,452 @@
+//Common elements in two arrays
+//
+//Each number that is in both arrays is printed once. The arrays may have
+//different lengths and repeated numbers. There are several ways to get the
+//common numbers (the intersection), and each returns a new array without
+//repeats, or NULL when out of memory:
+//
+//intersectHash    any order: the smaller array goes into a hash set and the
+//                 other looks its numbers up; O(n + m)
+//intersectBloom   any order: a blocked Bloom filter (BloomFilter.h) of the
+//                 smaller array drops most numbers of the other that are
+//                 not in it, one cache line each, and only the rest go
+//                 through intersectHash
+//intersectMerge   both sorted: one pass over both, like the merge in merge
+//                 sort; O(n + m)
+//intersectSimd    both sorted: the merge done four by four, comparing every
+//                 number of a block of a with all four of a block of b in
+//                 four SSE2 compares (b rotated by one each time)
+//intersectGallop  both sorted, one much smaller: each number of the small
+//                 one is looked for in the big one by galloping on from
+//                 where the previous one was found; O(n log(m / n))
+//intersectSorted  both sorted: picks gallop when one array is more than
+//                 GALLOP_RATIO times longer, otherwise the SIMD merge
+//intersectRoaring both sorted: turns both into compressed bitmaps
+//                 (RoaringSet.h) and ANDs those; for dense sets kept in
+//                 that form, the AND is the cheap part
+//
+//Run with --bench N M [SPREAD] to time them on sorted arrays of N and M
+//numbers spread over SPREAD times the longer length (default 4; 1 gives
+//runs of consecutive numbers).
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "BloomFilter.h"
+#include "RoaringSet.h"
+#if defined(__SSE2__)
+#include<immintrin.h>
+#endif
+
+#define GALLOP_RATIO 128
+
+//add x to a sorted result unless it is already the last one
+static inline void emitSorted(int *out, size_t *count, int x)
 {
-    int i,j,n;
-    printf("enter the number of elements in an arrays\n");
-    scanf("%d",&n);
-    int a[n],b[n];
-    printf("enter the elements of 1st array\n");
-    for(i=0;i<n;i++)
+    if (*count == 0 || out[*count - 1] != x)
+        out[(*count)++] = x;
+}
+
+static inline unsigned hashInt(int x, int shift)
+{
+    return ((unsigned)x * 0x9E3779B1u) >> shift;
+}
+
+int *intersectHash(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    const int *small = na <= nb ? a : b, *big = na <= nb ? b : a;
+    size_t ns = na <= nb ? na : nb, nbig = na <= nb ? nb : na;
+    size_t capacity = 1, i;
+    int shift = 32;
+    int *keys, *out;
+    unsigned char *state; //0 empty, 1 in the set, 2 already in the result
+
+    while (capacity < 2 * ns)
     {
-        scanf("%d",&a[i]);
+        capacity *= 2;
+        shift--;
     }
-    printf("enter the elements of 2nd array\n");
-    for(j=0;j<n;j++)
+    keys = malloc(capacity * sizeof(int));
+    state = calloc(capacity, 1);
+    out = malloc((ns ? ns : 1) * sizeof(int));
+    if (keys == NULL || state == NULL || out == NULL)
     {
-        scanf("%d",&b[j]);
+        free(keys);
+        free(state);
+        free(out);
+        return NULL;
     }
-    printf("The common numbers are: ");
-   for(i=0; i<n; i++){
-	   for(j=0;j<n;j++){
-		   if(a[i]==b[j]){
-			   printf("%d\n", b[j]);
-			   }
-		   }
+    for (i = 0; i < ns; i++)
+    {
+        unsigned h = capacity > 1 ? hashInt(small[i], shift) : 0;
+        while (state[h] && keys[h] != small[i])
+            h = (h + 1) & (capacity - 1);
+        keys[h] = small[i];
+        state[h] = 1;
+    }
+    *count = 0;
+    for (i = 0; i < nbig; i++)
+    {
+        unsigned h = capacity > 1 ? hashInt(big[i], shift) : 0;
+        while (state[h] && keys[h] != big[i])
+            h = (h + 1) & (capacity - 1);
+        if (state[h] == 1)
+        {
+            out[(*count)++] = big[i];
+            state[h] = 2;
+        }
+    }
+    free(keys);
+    free(state);
+    return out;
+}
+
+int *intersectBloom(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    const int *small = na <= nb ? a : b, *big = na <= nb ? b : a;
+    size_t ns = na <= nb ? na : nb, nbig = na <= nb ? nb : na;
+    size_t hits, i;
+    size_t *at = malloc((nbig ? nbig : 1) * sizeof(size_t));
+    int *maybe = malloc((nbig ? nbig : 1) * sizeof(int)), *out = NULL;
+    BloomFilter bf;
+
+    if (at != NULL && maybe != NULL && bloomInit(&bf, ns, BLOOM_BITS_PER_KEY) == 0)
+    {
+        bloomAddInts(&bf, small, ns);
+        hits = bloomMayContainInts(&bf, big, nbig, at);
+        bloomFree(&bf);
+        for (i = 0; i < hits; i++)
+            maybe[i] = big[at[i]];
+        out = intersectHash(small, ns, maybe, hits, count);
     }
+    free(at);
+    free(maybe);
+    return out;
+}
+
+//the scalar merge from a[i], b[j] on, for intersectMerge and the tails
+static void mergeFrom(const int *a, size_t na, size_t i, const int *b, size_t nb, size_t j,
+                      int *out, size_t *count)
+{
+    while (i < na && j < nb)
+    {
+        if (a[i] < b[j])
+            i++;
+        else if (b[j] < a[i])
+            j++;
+        else
+        {
+            emitSorted(out, count, a[i]);
+            i++;
+            j++;
+        }
+    }
+}
+
+int *intersectMerge(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    int *out = malloc(((na < nb ? na : nb) + 1) * sizeof(int));
+    if (out == NULL)
+        return NULL;
+    *count = 0;
+    mergeFrom(a, na, 0, b, nb, 0, out, count);
+    return out;
+}
+
+int *intersectSimd(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    int *out = malloc(((na < nb ? na : nb) + 1) * sizeof(int));
+    size_t i = 0, j = 0;
+    if (out == NULL)
+        return NULL;
+    *count = 0;
+#if defined(__SSE2__)
+    while (i + 4 <= na && j + 4 <= nb)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + j));
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        unsigned mask;
+        int amax = a[i + 3], bmax = b[j + 3];
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        //bit k: a[i + k] is somewhere in b[j .. j + 3]
+        mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+        while (mask != 0)
+        {
+            emitSorted(out, count, a[i + __builtin_ctz(mask)]);
+            mask &= mask - 1;
+        }
+        //the block with the smaller last number cannot match anything later
+        if (amax <= bmax)
+            i += 4;
+        if (bmax <= amax)
+            j += 4;
+    }
+#endif
+    mergeFrom(a, na, i, b, nb, j, out, count);
+    return out;
+}
+
+//first position p >= from with big[p] >= x, stepping 1, 2, 4, ... from from
+static size_t gallop(const int *big, size_t n, size_t from, int x)
+{
+    size_t step = 1, lo, hi;
+    if (from >= n || big[from] >= x)
+        return from;
+    while (from + step < n && big[from + step] < x)
+        step *= 2;
+    //big[from + step / 2] < x <= big[hi], or hi == n
+    lo = from + step / 2 + 1;
+    hi = from + step < n ? from + step : n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (big[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int *intersectGallop(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    const int *small = na <= nb ? a : b, *big = na <= nb ? b : a;
+    size_t ns = na <= nb ? na : nb, nbig = na <= nb ? nb : na;
+    size_t i, p = 0;
+    int *out = malloc((ns + 1) * sizeof(int));
+    if (out == NULL)
+        return NULL;
+    *count = 0;
+    for (i = 0; i < ns && p < nbig; i++)
+    {
+        p = gallop(big, nbig, p, small[i]);
+        if (p < nbig && big[p] == small[i])
+            emitSorted(out, count, small[i]);
+    }
+    return out;
+}
+
+int *intersectSorted(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    if (na > GALLOP_RATIO * nb || nb > GALLOP_RATIO * na)
+        return intersectGallop(a, na, b, nb, count);
+    return intersectSimd(a, na, b, nb, count);
+}
+
+//ints in the order of uint32_t, so negative ones sort first
+static inline uint32_t toBiased(int x)
+{
+    return (uint32_t)x ^ 0x80000000u;
+}
+
+//a sorted array as a RoaringSet; repeats are dropped
+int roaringFromInts(RoaringSet *s, const int *a, size_t n)
+{
+    uint32_t *v = malloc((n + 1) * sizeof(uint32_t));
+    size_t i, k = 0;
+    int rc;
+    if (v == NULL)
+        return -1;
+    for (i = 0; i < n; i++)
+        if (k == 0 || v[k - 1] != toBiased(a[i]))
+            v[k++] = toBiased(a[i]);
+    rc = roaringFromSorted(s, v, k);
+    free(v);
+    return rc;
+}
+
+int *intersectRoaring(const int *a, size_t na, const int *b, size_t nb, size_t *count)
+{
+    RoaringSet sa, sb, both;
+    int *out = NULL;
+    size_t i;
+    if (roaringFromInts(&sa, a, na) != 0)
+        return NULL;
+    if (roaringFromInts(&sb, b, nb) != 0)
+    {
+        roaringFree(&sa);
+        return NULL;
+    }
+    if (roaringAnd(&both, &sa, &sb) == 0)
+    {
+        out = malloc((roaringCardinality(&both) + 1) * sizeof(int));
+        if (out != NULL)
+        {
+            *count = roaringToArray(&both, (uint32_t *)out);
+            for (i = 0; i < *count; i++)
+                out[i] = (int)(((uint32_t *)out)[i] ^ 0x80000000u);
+        }
+        roaringFree(&both);
+    }
+    roaringFree(&sa);
+    roaringFree(&sb);
+    return out;
+}
+
+int isSorted(const int *a, size_t n)
+{
+    size_t i;
+    for (i = 1; i < n; i++)
+        if (a[i - 1] > a[i])
+            return 0;
+    return 1;
+}
+
+int *readArray(const char *which, size_t *n)
+{
+    int k;
+    size_t i;
+    int *a;
+    printf("enter the number of elements in the %s array\n", which);
+    if (scanf("%d", &k) != 1 || k < 0)
+        return NULL;
+    a = malloc(((size_t)k + 1) * sizeof(int));
+    if (a == NULL)
+        return NULL;
+    printf("enter the elements of %s array\n", which);
+    for (i = 0; i < (size_t)k; i++)
+        if (scanf("%d", &a[i]) != 1)
+        {
+            free(a);
+            return NULL;
+        }
+    *n = (size_t)k;
+    return a;
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//n increasing numbers spread over about 0 .. range
+int *randomSet(size_t n, size_t range, unsigned long long *seed)
+{
+    int *a = malloc((n + 1) * sizeof(int));
+    size_t i, v = 0;
+    if (a == NULL)
+        return NULL;
+    for (i = 0; i < n; i++)
+    {
+        *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        v += 1 + (*seed >> 33) % (2 * range / (n ? n : 1) - 1);
+        a[i] = (int)v;
+    }
+    return a;
+}
+
+int bench(size_t n, size_t m, size_t spread)
+{
+    unsigned long long seed = 1;
+    size_t range = (spread ? spread : 1) * (n > m ? n : m), want = 0, i;
+    int *a = randomSet(n, range, &seed), *b = randomSet(m, range, &seed);
+    int *(*engines[])(const int *, size_t, const int *, size_t, size_t *) =
+        {intersectHash, intersectBloom, intersectMerge, intersectSimd, intersectGallop, intersectSorted,
+         intersectRoaring};
+    const char *names[] = {"hash", "bloom", "merge", "simd", "gallop", "sorted", "roaring"};
+    RoaringSet sa, sb, both;
+    int e, bad = 0, rounds = (int)(2e7 / (n + m + 1)) + 1;
+
+    if (a == NULL || b == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    printf("%zu and %zu sorted numbers, %d rounds\n", n, m, rounds);
+    for (e = 0; e < 7; e++)
+    {
+        size_t count = 0;
+        int r, *out = NULL;
+        double t = now();
+        for (r = 0; r < rounds; r++)
+        {
+            free(out);
+            out = engines[e](a, n, b, m, &count);
+            if (out == NULL)
+            {
+                printf("Out of memory\n");
+                return 1;
+            }
+        }
+        t = (now() - t) / rounds;
+        printf("%-8s %10.3f ms  %zu common\n", names[e], t * 1e3, count);
+        if (e == 0)
+            want = count;
+        else if (count != want)
+            bad = 1;
+        for (i = 1; i < count; i++)
+            if (e > 0 && out[i - 1] >= out[i])
+                bad = 1;
+        free(out);
+    }
+    //the AND alone, on sets already in compressed form
+    if (roaringFromInts(&sa, a, n) != 0 || roaringFromInts(&sb, b, m) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    {
+        double t = now();
+        int r;
+        for (r = 0; r < rounds; r++)
+        {
+            if (roaringAnd(&both, &sa, &sb) != 0)
+            {
+                printf("Out of memory\n");
+                return 1;
+            }
+            if (r + 1 < rounds)
+                roaringFree(&both);
+        }
+        t = (now() - t) / rounds;
+        printf("%-8s %10.3f ms  %llu common, %zu + %zu containers\n", "AND only", t * 1e3,
+               (unsigned long long)roaringCardinality(&both), sa.n, sb.n);
+        bad |= roaringCardinality(&both) != want;
+        roaringFree(&both);
+        roaringFree(&sa);
+        roaringFree(&sb);
+    }
+    free(a);
+    free(b);
+    if (bad)
+        printf("The engines disagree\n");
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n, m, count, i;
+    int *a, *b, *common;
+    if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10),
+                     argc > 4 ? strtoul(argv[4], NULL, 10) : 4);
+    a = readArray("1st", &n);
+    b = a ? readArray("2nd", &m) : NULL;
+    if (b == NULL)
+    {
+        printf("invalid input\n");
+        free(a);
+        return 1;
+    }
+    if (isSorted(a, n) && isSorted(b, m))
+        common = intersectSorted(a, n, b, m, &count);
+    else
+        common = intersectBloom(a, n, b, m, &count);
+    if (common == NULL)
+    {
+        printf("out of memory\n");
+        return 1;
+    }
+    printf("The common numbers are: ");
+    for (i = 0; i < count; i++)
+        printf("%d\n", common[i]);
+    free(a);
+    free(b);
+    free(common);
+    return 0;
 }
@@ -1,10 +1,214 @@
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include "SortLib.h"
+#include "HashMap.h"
+
+//Run with --sort for an O(n log n) conversion, --radix for an O(n) one
+//or --hash for one that sorts only the distinct values, for arrays too
+//big for the bubble sort below. All give equal values the same rank, so
+//the ranks are 0..d-1 for d distinct values.
+
+//key that orders like the signed value when compared unsigned
+static uint32_t flip(int v)
 {
+	return (uint32_t)v^0x80000000u;
+}
+
+//sorts (value, index) pairs once, then walks them in order and writes
+//each rank back at its index
+int reduce_sorted(int a[],int n)
+{
+	SortKV *p=malloc((n>0 ? n : 1)*sizeof(SortKV));
+	int i,rank=-1;
+	if(p==NULL)
+	    return -1;
+	for(i=0;i<n;i++)
+	{
+	    p[i].key=flip(a[i]);
+	    p[i].value=(uint64_t)i;
+	}
+	sort_kv(p,n);
+	for(i=0;i<n;i++)
+	{
+	    if(i==0 || p[i].key!=p[i-1].key)
+	        rank++;
+	    a[p[i].value]=rank;
+	}
+	free(p);
+	return 0;
+}
+
+//Values within a range of at most 4n (or 2^16): mark which values occur,
+//and the running count of marks below a value is its rank. Wider ranges
+//are radix sorted as (key, index) pairs, 11 bits per pass.
+int reduce_radix(int a[],int n)
+{
+	int i,min,max;
+	if(n==0)
+	    return 0;
+	min=max=a[0];
+	for(i=1;i<n;i++)
+	{
+	    if(a[i]<min)
+	        min=a[i];
+	    if(a[i]>max)
+	        max=a[i];
+	}
+
+	uint32_t range=flip(max)-flip(min);
+	if(range<(uint32_t)n*4u || range<(1u<<16))
+	{
+	    int *rank=calloc((size_t)range+1,sizeof(int));
+	    int next=0;
+	    if(rank==NULL)
+	        return -1;
+	    for(i=0;i<n;i++)
+	        rank[flip(a[i])-flip(min)]=1;
+	    for(uint32_t v=0;v<=range;v++)
+	    {
+	        int seen=rank[v];
+	        rank[v]=next;
+	        next+=seen;
+	    }
+	    for(i=0;i<n;i++)
+	        a[i]=rank[flip(a[i])-flip(min)];
+	    free(rank);
+	    return 0;
+	}
+
+	uint32_t *key=malloc(2*(size_t)n*sizeof(uint32_t));
+	int *idx=malloc(2*(size_t)n*sizeof(int));
+	if(key==NULL || idx==NULL)
+	{
+	    free(key);
+	    free(idx);
+	    return -1;
+	}
+	uint32_t *ks=key,*kd=key+n;
+	int *is=idx,*id=idx+n;
+	for(i=0;i<n;i++)
+	{
+	    ks[i]=flip(a[i])-flip(min);
+	    is[i]=i;
+	}
+	for(int shift=0;shift<32 && (range>>shift)!=0;shift+=11)
+	{
+	    size_t count[2048]={0},sum=0;
+	    for(i=0;i<n;i++)
+	        count[(ks[i]>>shift)&2047]++;
+	    for(int b=0;b<2048;b++)
+	    {
+	        size_t c=count[b];
+	        count[b]=sum;
+	        sum+=c;
+	    }
+	    for(i=0;i<n;i++)
+	    {
+	        size_t at=count[(ks[i]>>shift)&2047]++;
+	        kd[at]=ks[i];
+	        id[at]=is[i];
+	    }
+	    uint32_t *kt=ks;ks=kd;kd=kt;
+	    int *it=is;is=id;id=it;
+	}
+	int rank=-1;
+	for(i=0;i<n;i++)
+	{
+	    if(i==0 || ks[i]!=ks[i-1])
+	        rank++;
+	    a[is[i]]=rank;
+	}
+	free(key);
+	free(idx);
+	return 0;
+}
+
+//Few distinct values spread too wide for reduce_radix's count array: an
+//IntMap (HashMap.h) collects the d distinct values, only those are
+//sorted, and each value's rank is stored in its entry and looked up
+//again, HASHMAP_BATCH values at a time. With mostly distinct values the
+//map is as big as the array and --radix is faster.
+int reduce_hash(int a[],int n)
+{
+	IntMap ranks;
+	IntMapEntry *e,*found[HASHMAP_BATCH];
+	int64_t batch[HASHMAP_BATCH],*keys;
+	size_t d=0,at=0;
+	int i,j,k;
+	intMapInit(&ranks);
+	for(i=0;i<n;i+=k)
+	{
+	    k=n-i<HASHMAP_BATCH ? n-i : HASHMAP_BATCH;
+	    for(j=0;j<k;j++)
+	        batch[j]=a[i+j];
+	    if(intMapInsertMany(&ranks,batch,(size_t)k,NULL)!=0)
+	    {
+	        intMapFree(&ranks);
+	        return -1;
+	    }
+	}
+	keys=malloc((ranks.size>0 ? ranks.size : 1)*sizeof(int64_t));
+	if(keys==NULL)
+	{
+	    intMapFree(&ranks);
+	    return -1;
+	}
+	while((e=intMapNext(&ranks,&at))!=NULL)
+	    keys[d++]=e->key;
+	sort_i64(keys,d);
+	for(i=0;i<(int)d;i++)
+	    intMapFind(&ranks,keys[i])->value=i;
+	for(i=0;i<n;i+=k)
+	{
+	    k=n-i<HASHMAP_BATCH ? n-i : HASHMAP_BATCH;
+	    for(j=0;j<k;j++)
+	        batch[j]=a[i+j];
+	    intMapFindMany(&ranks,batch,(size_t)k,found);
+	    for(j=0;j<k;j++)
+	        a[i+j]=(int)found[j]->value;
+	}
+	free(keys);
+	intMapFree(&ranks);
+	return 0;
+}
+
+int main(int argc,char *argv[])
+{
+	int mode=0;
+	if(argc>1 && strcmp(argv[1],"--sort")==0)
+	    mode=1;
+	else if(argc>1 && strcmp(argv[1],"--radix")==0)
+	    mode=2;
+	else if(argc>1 && strcmp(argv[1],"--hash")==0)
+	    mode=3;
 	int num;scanf("%d",&num);
 	while(num--)
 	{
 	    int n;scanf("%d",&n);
+	    if(mode)
+	    {
+	        int *a=malloc((n>0 ? n : 1)*sizeof(int));
+	        if(a==NULL)
+	        {
+	            printf("Out of memory\n");
+	            return 1;
+	        }
+	        for(int i=0;i<n;i++)
+	            scanf("%d",&a[i]);
+	        if((mode==1 ? reduce_sorted(a,n) : mode==2 ? reduce_radix(a,n) : reduce_hash(a,n))!=0)
+	        {
+	            printf("Out of memory\n");
+	            free(a);
+	            return 1;
+	        }
+	        for(int i=0;i<n;i++)
+	            printf("%d ",a[i]);
+	        printf("\n");
+	        free(a);
+	        continue;
+	    }
 	    int a[n],t[n],tmp,k=0;
 	    for(int i=0;i<n;i++)
 	    {
@@ -33,4 +237,5 @@ int main()
 	    printf("%d ",a[i]);
 	    printf("\n");
 	}
+	return 0;
 }
@@ -1,7 +1,171 @@
 // Program to display the day name using switch case
+//   DayNameUsingSwitchCase                          asks for a day number, 1 = Monday
+//   DayNameUsingSwitchCase --date YEAR MONTH DAY    the day name of a date
+//   DayNameUsingSwitchCase --bucket < timestamps    Unix timestamps, counted by weekday and by day
+//   DayNameUsingSwitchCase --bench N                gmtime_r() against Calendar.h on N timestamps
 #include <stdio.h>
-int main(){
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Calendar.h"
+#include "FastInput.h"
+#include "Random.h"
+
+#define BLOCK 65536
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// counts[day - *first] for the days seen so far, grown to take day
+static int countDay(long long **counts, int32_t *first, size_t *span, int32_t day)
+{
+    if (*span == 0 || day < *first || day - *first >= (int64_t)*span)
+    {
+        int32_t lo = *span == 0 || day < *first ? day : *first;
+        int64_t hi = *span == 0 ? day : (int64_t)*first + (int64_t)*span - 1;
+        size_t grown;
+        long long *bigger;
+        hi = day > hi ? day : hi;
+        grown = (size_t)(hi - lo + 1);
+        if ((bigger = calloc(grown, sizeof *bigger)) == NULL)
+            return -1;
+        if (*span != 0)
+            memcpy(bigger + (*first - lo), *counts, *span * sizeof *bigger);
+        free(*counts);
+        *counts = bigger;
+        *first = lo;
+        *span = grown;
+    }
+    (*counts)[day - *first]++;
+    return 0;
+}
+
+static int bucket(void)
+{
+    static long long raw[BLOCK];
+    static int64_t t[BLOCK];
+    static int32_t days[BLOCK];
+    static uint8_t weekday[BLOCK];
+    long long byWeekday[8] = {0}, *counts = NULL, total = 0;
+    int32_t first = 0;
+    size_t span = 0, got, i;
+    FastInput in;
+    int d;
+
+    if (fastInputOpen(&in, stdin) != 0)
+        return 1;
+    while ((got = fastReadLongLongs(&in, raw, BLOCK)) > 0)
+    {
+        for (i = 0; i < got; i++)
+            t[i] = raw[i];
+        calSecondsArray(t, days, weekday, got);
+        for (i = 0; i < got; i++)
+        {
+            byWeekday[weekday[i]]++;
+            if (countDay(&counts, &first, &span, days[i]) != 0)
+                return 1;
+        }
+        total += got;
+    }
+    fastInputClose(&in);
+    for (d = 1; d <= 7; d++)
+        printf("%-9s %lld\n", calDayNames[d], byWeekday[d]);
+    for (i = 0; i < span; i++)
+        if (counts[i] != 0)
+        {
+            CalDate c = calCivilFromDays(first + (int32_t)i);
+            printf("%04d-%02d-%02d %s %lld\n", c.year, c.month, c.day, calDayShort[calWeekday(first + (int32_t)i)], counts[i]);
+        }
+    printf("%lld timestamps\n", total);
+    free(counts);
+    return 0;
+}
+
+static int bench(size_t n)
+{
+    int64_t *t = malloc(n * sizeof *t);
+    int32_t *days = malloc(n * sizeof *days), *year = malloc(n * sizeof *year);
+    uint8_t *weekday = malloc(n), *month = malloc(n), *day = malloc(n);
+    double best[3] = {1e30, 1e30, 1e30}, s;
+    long long sum[3];
+    Xoshiro256 r;
+    size_t i;
+    int k;
+
+    if (!t || !days || !year || !weekday || !month || !day)
+        return 1;
+    xoshiroSeed(&r, 121);
+    for (i = 0; i < n; i++)
+        t[i] = (int64_t)(xoshiroNext(&r) % 2208988800u); // 1970 .. 2040
+    for (k = 0; k < 3; k++)
+    {
+        s = now();
+        for (sum[0] = 0, i = 0; i < n; i++)
+        {
+            struct tm tm;
+            time_t x = (time_t)t[i];
+            gmtime_r(&x, &tm);
+            sum[0] += (tm.tm_wday ? tm.tm_wday : 7) + tm.tm_year + 1900 + tm.tm_mon + 1 + tm.tm_mday;
+        }
+        if ((s = now() - s) < best[0])
+            best[0] = s;
+        s = now();
+        for (sum[1] = 0, i = 0; i < n; i++)
+        {
+            int32_t z = calDayOfSeconds(t[i]);
+            CalDate c = calCivilFromDays(z);
+            sum[1] += calWeekday(z) + c.year + c.month + c.day;
+        }
+        if ((s = now() - s) < best[1])
+            best[1] = s;
+        s = now();
+        calSecondsArray(t, days, weekday, n);
+        calCivilArray(days, year, month, day, n);
+        for (sum[2] = 0, i = 0; i < n; i++)
+            sum[2] += weekday[i] + year[i] + month[i] + day[i];
+        if ((s = now() - s) < best[2])
+            best[2] = s;
+    }
+    printf("%zu timestamps in 1970 .. 2040, the date and weekday of each, best of 3\n", n);
+    printf("  gmtime_r()          %6.2f ns a timestamp\n", best[0] / n * 1e9);
+    printf("  Calendar.h scalar   %6.2f ns a timestamp\n", best[1] / n * 1e9);
+    printf("  Calendar.h arrays   %6.2f ns a timestamp\n", best[2] / n * 1e9);
+    free(t);
+    free(days);
+    free(year);
+    free(weekday);
+    free(month);
+    free(day);
+    if (sum[0] != sum[1] || sum[0] != sum[2])
+    {
+        fprintf(stderr, "the dates differ: %lld %lld %lld\n", sum[0], sum[1], sum[2]);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
     int day;
+
+    if (argc == 5 && strcmp(argv[1], "--date") == 0)
+    {
+        int y = atoi(argv[2]), m = atoi(argv[3]), d = atoi(argv[4]);
+        if (m < 1 || m > 12 || d < 1 || d > calMonthDays(y, m))
+        {
+            printf("Wrong date");
+            return 1;
+        }
+        printf("Day is %s", calDayNames[calWeekday(calDaysFromCivil(y, m, d))]);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "--bucket") == 0)
+        return bucket();
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+        return bench(atol(argv[2]) > 0 ? (size_t)atol(argv[2]) : 10000000);
     printf("Enter the day number\n");
     scanf("%d", &day);
 
@@ -17,7 +181,7 @@ int main(){
         printf("Day is Wednesday");
         break;
     case 4 :
-        printf("Day is Thrusday");
+        printf("Day is Thursday");
         break;
     case 5 :
         printf("Day is Friday");
@@ -1,44 +1,121 @@
 // Convert base10(decimal) values any base
+//
+// printDigit() used to recurse once per digit and printf each one; now
+// IntText.h writes the whole number into a buffer, which is printed once.
+// Negative numbers get a '-' and 0 prints as 0, where before both printed
+// nothing. Run with --bench N to time N conversions each way.
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "IntText.h"
 
-void printDigit(int, int);
+void printDigit(long long, int);
+int bench(size_t);
 
-int main(){
+int main(int argc, char *argv[]){
 
-    int input, base;
+    long long input;
+    int base;
+
+    if(argc > 2 && strcmp(argv[1], "--bench") == 0){
+        return bench((size_t)strtod(argv[2], NULL));
+    }
 
     // Getting user input
     printf("Enter number: ");
-    scanf("%d", &input);
+    if(scanf("%lld", &input) != 1){
+        return 1;
+    }
     printf("Enter base: ");
-    scanf("%d", &base);
+    if(scanf("%d", &base) != 1 || base < 2 || base > 36){
+        printf("The base must be between 2 and 36\n");
+        return 1;
+    }
 
-    printf("%d to base %d : ", input, base);
+    printf("%lld to base %d : ", input, base);
 
     printDigit(input, base);
 
     return 0;
 }
 
-// This is a reccursive function that prints digit by digit
-void printDigit(int num, int base){
-    if(num > 0){
-        // getting current digit to be printed
-        int digit = num % base;
-        num = num - digit;
-        num = num / base;
-        // Call to function to print next digit
-        printDigit(num, base);
-        // If the current digit is more than 9 (eg: 10=A, 11=B)
-        if(digit > 9){
-            printf("%c", 55 + digit);
+// Converts num into a buffer and prints it in one go
+void printDigit(long long num, int base){
+    char text[INT_TEXT_MAX];
+    size_t len = i64ToBase(num, (unsigned)base, text);
+    fwrite(text, 1, len, stdout);
+    printf("\n");
+}
+
+// The old way, one digit per call, for the benchmark
+char *oldDigits(unsigned long long num, unsigned base, char *out){
+    if(num >= base){
+        out = oldDigits(num / base, base, out);
+    }
+    *out++ = intDigits[num % base];
+    return out;
+}
+
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(size_t n){
+    static const unsigned bases[] = {10, 2, 16, 7};
+    unsigned long long *x = malloc(n * sizeof *x), s = 88172645463325252ULL;
+    char text[INT_TEXT_MAX], check[INT_TEXT_MAX];
+    size_t i, total = 0;
+    int b;
+
+    if(x == NULL){
+        printf("Out of memory\n");
+        return 1;
+    }
+    // all sizes, from one digit to twenty
+    for(i = 0; i < n; i++){
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        x[i] = s >> (s % 64);
+    }
+    for(b = 0; b < 4; b++){
+        double t0, t1, t2, t3;
+        t0 = now();
+        for(i = 0; i < n; i++){
+            total += (size_t)(oldDigits(x[i], bases[b], text) - text);
+        }
+        t1 = now();
+        for(i = 0; i < n; i++){
+            total += u64ToBase(x[i], bases[b], text);
         }
-        // Else print the digit directly
-        else {
-            printf("%d", digit);
+        t2 = now();
+        if(bases[b] == 10 || bases[b] == 16){
+            for(i = 0; i < n; i++){
+                total += (size_t)sprintf(text, bases[b] == 10 ? "%llu" : "%llX", x[i]);
+            }
         }
-    } else {
-        return;
+        t3 = now();
+        for(i = 0; i < n; i++){
+            *oldDigits(x[i], bases[b], check) = '\0';
+            u64ToBase(x[i], bases[b], text);
+            if(strcmp(text, check) != 0){
+                printf("MISMATCH at %llu in base %u\n", x[i], bases[b]);
+                free(x);
+                return 1;
+            }
+        }
+        printf("base %2u: recursive %6.2f ns, u64ToBase() %6.2f ns", bases[b],
+               (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n);
+        if(bases[b] == 10 || bases[b] == 16){
+            printf(", sprintf() %6.2f ns", (t3 - t2) * 1e9 / n);
+        }
+        printf(" per number\n");
     }
-}
\ No newline at end of file
+    printf("%zu characters\n", total);
+    free(x);
+    return 0;
+}
@@ -1,45 +1,32 @@
 // Convert base10(decimal) values to base2(binary)
+//
+// The digits come from IntText.h: the bit length sizes the output and a
+// shift and a mask give each digit. The loop before doubled an int power
+// up to num, which overflowed for anything above 2^30.
 
 #include <stdio.h>
+#include "IntText.h"
 
-void PrintBits(int power, int num){
-    // firstOne is a flag that stops "0" being printed before a "1" is printed
-    int firstOne = 0;
+void PrintBits(unsigned int num){
+    char bits[INT_TEXT_MAX];
+    size_t len = u64ToPow2(num, 1, bits);
 
-    // Conversion loop
-    while (power > 0) {
-      if (num >= power) {
-        firstOne = 1;
-        printf("1");
-        num %= power;
-      } else if (firstOne == 1) {
-          printf("0");
-      }
-      power /= 2;
-    }
+    fwrite(bits, 1, len, stdout);
     printf("\n");
 }
 
 int main() {
 
     int num = 0;
-    int power = 1;
 
     // Getting input
     printf("Please enter a numeric value: ");
-    scanf("%d", & num);
-    printf("%d represented in binary is: ", num);
-
-    // Determine highest order of magnitude needed for the base2 conversion
-    while (power < num) {
-      power *= 2;
+    if (scanf("%d", & num) != 1 || num < 0) {
+      printf("Enter a number from 0 up\n");
+      return (1);
     }
+    printf("%d represented in binary is: ", num);
 
-    // Edge case in event of 0 being entered
-    if (num == 0) {
-      printf("0\n");
-    } else {
-      PrintBits(power, num);
-    }
+    PrintBits((unsigned int)num);
     return (0);
 }
@@ -1,12 +1,26 @@
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include "Hex.h"
 void decimal_hex(int n, char hex[]);
-int hex_decimal(char hex[]);
-int main()
+int hex_decimal(char hex[], int *n);
+int bench(size_t mb);
+
+// Both ways go through Hex.h: a table of the two characters of every byte
+// to encode, and a table of digit values that also flags anything that is
+// not a digit to decode. A negative number comes out as its 32-bit two's
+// complement, the way printf("%X") shows it.
+//
+// Run with --bench MB to time encoding and decoding MB megabytes against
+// sprintf("%02x") and the old nibble-by-nibble loop.
+
+int main(int argc, char *argv[])
 {
     char hex[20];
     int n,c;
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtoull(argv[2], NULL, 10));
     printf("**----Program to Convert Decimal and Hexadeciaml Vice Versa----***\n\n");
     printf("Choose Your Choice: \n");
     printf("1.Decimal to Hexadecimal:\n");
@@ -22,62 +36,113 @@ int main()
     if (c==2)
     {
         printf("Enter hexadecimal number: ");
-        scanf("%s",hex);
-        printf("Decimal number: %d",hex_decimal(hex));
+        scanf("%19s",hex);
+        if (hex_decimal(hex, &n) != 0)
+            printf("Not a hexadecimal number of up to 8 digits: %s", hex);
+        else
+            printf("Decimal number: %d",n);
     }
     return 0;
 }
 
 void decimal_hex(int n, char hex[]) 
 {
-    int i=0,rem;
-    while (n!=0)
+    hexFromU64((unsigned int)n, hex, 1);
+}
+
+// 0, or -1 when hex is not a number that fits in 32 bits
+int hex_decimal(char hex[], int *n)  
+{
+    uint64_t x;
+    if (hexToU64(hex, &x) != 0 || x > 0xffffffffULL)
+        return -1;
+    *n = (int)(uint32_t)x;
+    return 0;
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the old way, a digit at a time from the bottom
+void nibble_hex(const unsigned char *in, size_t n, char *out)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
     {
-        rem=n%16;
-        switch(rem)
-        {
-            case 10:
-              hex[i]='A';
-              break;
-            case 11:
-              hex[i]='B';
-              break;
-            case 12:
-              hex[i]='C';
-              break;
-            case 13:
-              hex[i]='D';
-              break;
-            case 14:
-              hex[i]='E';
-              break;
-            case 15:
-              hex[i]='F';
-              break;
-            default:
-              hex[i]=rem+'0';
-              break;
-        }
-        ++i;
-        n/=16;
+        int k, b = in[i];
+        for (k = 1; k >= 0; k--, b /= 16)
+            out[2 * i + k] = b % 16 < 10 ? b % 16 + '0' : b % 16 - 10 + 'a';
     }
-    hex[i]='\0';
-    strrev(hex);  
 }
 
-int hex_decimal(char hex[])  
+// the best of three runs of body, in MB/s of bytes
+#define BEST(mb, body)                       \
+    do                                       \
+    {                                        \
+        double best = 1e30, t0;              \
+        int rep;                             \
+        for (rep = 0; rep < 3; rep++)        \
+        {                                    \
+            t0 = now();                      \
+            body;                            \
+            if (now() - t0 < best)           \
+                best = now() - t0;           \
+        }                                    \
+        rate = (mb) / best;                  \
+    } while (0)
+
+int bench(size_t mb)
 {
-    int i, length, sum=0;
-    for(length=0; hex[length]!='\0'; ++length);
-    for(i=0; hex[i]!='\0'; ++i, --length)
+    size_t n = mb << 20, slow, i;
+    unsigned char *raw, *back;
+    char *text, *check;
+    double rate;
+    int same, bad;
+    uint64_t seed = 88172645463325252ULL;
+    if (mb == 0)
+        return 1;
+    raw = malloc(n);
+    back = malloc(n);
+    text = malloc(2 * n + 1);
+    check = malloc(2 * n + 1);
+    if (raw == NULL || back == NULL || text == NULL || check == NULL)
+    {
+        printf("Not enough memory for %zu MB\n", mb);
+        return 1;
+    }
+    for (i = 0; i < n; i++)
     {
-        if(hex[i]>='0' && hex[i]<='9')
-            sum+=(hex[i]-'0')*pow(16,length-1);
-        if(hex[i]>='A' && hex[i]<='F')
-            sum+=(hex[i]-55)*pow(16,length-1);  
-        if(hex[i]>='a' && hex[i]<='f')
-            sum+=(hex[i]-87)*pow(16,length-1);
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        raw[i] = (unsigned char)seed;
     }
-    return sum;
+    // every page touched before anything is timed
+    memset(back, 0, n);
+    memset(text, 0, 2 * n + 1);
+    memset(check, 0, 2 * n + 1);
+    printf("%zu MB, MB/s of bytes:\n", mb);
+    // sprintf is slow enough that 1 MB of it will do
+    slow = n < ((size_t)1 << 20) ? n : (size_t)1 << 20;
+    BEST(slow / 1048576.0, for (i = 0; i < slow; i++) sprintf(check + 2 * i, "%02x", raw[i]));
+    printf("sprintf(\"%%02x\")   %8.0f\n", rate);
+    BEST(mb, nibble_hex(raw, n, check));
+    printf("nibble at a time  %8.0f\n", rate);
+    BEST(mb, hexEncode(raw, n, text, 0));
+    printf("hexEncode()       %8.0f  %s\n", rate, memcmp(text, check, 2 * n) == 0 ? "same" : "DIFFERENT");
+    BEST(mb, bad = hexDecode(text, 2 * n, back));
+    same = bad == 0 && memcmp(raw, back, n) == 0;
+    printf("hexDecode()       %8.0f  %s\n", rate, same ? "round trip" : "DIFFERENT");
+    text[n] = 'g';
+    BEST(mb, bad = hexDecode(text, 2 * n, back));
+    printf("hexDecode(), bad  %8.0f  %s\n", rate, bad != 0 ? "rejected" : "NOT REJECTED");
+    free(raw);
+    free(back);
+    free(text);
+    free(check);
+    return !same || bad == 0;
 }
-
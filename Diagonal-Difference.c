@@ -1,39 +1,144 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
-int main()
+#include <time.h>
+#include "Matrix.h"
+#include "FastInput.h"
+
+// Run with --stream to read the matrix from stdin a row at a time and keep
+// only the two sums, for matrices too big to hold (n = 1e5 is 40 GB as
+// int); --bench N times the diagonal sums of an N x N matrix in memory.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void print_difference(long long sum1, long long sum2)
 {
-    int n,i,j,sum1=0,sum2=0; //n denotes the number of rows and columns in the matrix arr.
-    
-    scanf("%d", &n);
-    int arr[n][n];
-    for (i=0;i<n;i++)
-    {
-        for (j=0;j<n;j++)
-        {
-            scanf("%d ", &arr[i][j]);
-            //Taking diagonal sum of the matrix arr from the both side
-            if(arr[i][j]>=-100 && arr[i][j]<=100)
-            {
-                if(i==j)
-                {
-                    sum1+=arr[i][j];
-                }
-                if(j==(n-1-i))
-                {
-                    sum2+=arr[i][j];
-                }
-            }
-        }
-    }
     // This code part belongs to the absolute difference between the sums of the matrix's along two diagonals
     if((sum1-sum2)<0)
     {
-        printf("%d", (-((sum1)-(sum2))));
+        printf("%lld", (-((sum1)-(sum2))));
     }
     else
     {
-        printf("%d", ((sum1)-(sum2)));
+        printf("%lld", ((sum1)-(sum2)));
     } 
+}
+
+// Row i has its primary diagonal element at column i and the secondary
+// at n - 1 - i; the words in between are skipped without being converted
+static int stream_diagonals(void)
+{
+    FastInput in;
+    long long n, i, x, y, sum1 = 0, sum2 = 0;
+    if (fastInputOpen(&in, stdin) != 0)
+        return 1;
+    if (fastReadLongLong(&in, &n) != 0 || n <= 0)
+    {
+        fastInputClose(&in);
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        long long p = i < n - 1 - i ? i : n - 1 - i, q = n - 1 - p; // the first and second column wanted
+        size_t got = fastSkipWords(&in, (size_t)p);
+        int bad = got != (size_t)p || fastReadLongLong(&in, &x) != 0;
+        if (!bad && q != p)
+        {
+            bad = fastSkipWords(&in, (size_t)(q - p - 1)) != (size_t)(q - p - 1) || fastReadLongLong(&in, &y) != 0;
+        }
+        else
+        {
+            y = x;
+        }
+        if (bad || fastSkipWords(&in, (size_t)(n - 1 - q)) != (size_t)(n - 1 - q))
+        {
+            printf("The matrix ends in row %lld\n", i + 1);
+            fastInputClose(&in);
+            return 1;
+        }
+        // x is in the column nearer the left
+        sum1 += p == i ? x : y;
+        sum2 += p == i ? y : x;
+    }
+    fastInputClose(&in);
+    print_difference(sum1, sum2);
+    return 0;
+}
+
+// Writes over more memory than the caches hold, so each timing starts
+// with the diagonals out of cache
+static void evict(void)
+{
+    static char junk[64 << 20];
+    memset(junk, (int)now(), sizeof junk);
+}
+
+static int bench(size_t n)
+{
+    Matrix m;
+    size_t i, j, k;
+    long long s1 = 0, s2 = 0, g1, g2;
+    double t0, t1, t2, t3;
+    if (matrixInit(&m, n, n) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            *matrixAt(&m, i, j) = (int)((i * 31 + j * 17) % 201) - 100;
+    evict();
+    t0 = now();
+    for (k = 0; k < n; k++)
+    {
+        s1 += *matrixAt(&m, k, k);
+        s2 += *matrixAt(&m, k, n - 1 - k);
+    }
+    t1 = now();
+    evict();
+    t2 = now();
+    g1 = viewSum(matrixDiagonal(&m));
+    g2 = viewSum(matrixAntiDiagonal(&m));
+    t3 = now();
+    printf("%zu x %zu: loop %.1f us, viewSum %.1f us%s\n", n, n, (t1 - t0) * 1e6, (t3 - t2) * 1e6,
+           s1 == g1 && s2 == g2 ? "" : " MISMATCH");
+    matrixFree(&m);
+    return s1 != g1 || s2 != g2;
+}
+
+int main(int argc, char *argv[])
+{
+    int n,i,j; //n denotes the number of rows and columns in the matrix arr.
+    long long sum1=0,sum2=0;
+    Matrix arr;
+    
+    if (argc == 2 && strcmp(argv[1], "--stream") == 0)
+        return stream_diagonals();
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10));
+
+    if (scanf("%d", &n) != 1 || n <= 0 || matrixInit(&arr, n, n) != 0)
+    {
+        return 1;
+    }
+    for (i=0;i<n;i++)
+    {
+        for (j=0;j<n;j++)
+        {
+            scanf("%d ", matrixAt(&arr, i, j));
+        }
+    }
+    //Taking diagonal sum of the matrix arr from the both side
+    sum1 = viewSum(matrixDiagonal(&arr));
+    sum2 = viewSum(matrixAntiDiagonal(&arr));
+    matrixFree(&arr);
+    print_difference(sum1, sum2);
     return 0; 
 }
 
@@ -4,10 +4,26 @@
 // is multiple digits, you add those digits together, repeating the process 
 //until you get a single digit. That digit is the digital root of the original number.
 
+//   DigitalRoot                  asks for a number
+//   DigitalRoot --range LO HI    how many numbers of [LO, HI] have each digital root,
+//                                counted without a scan: the root of n > 0 is 1 + (n - 1) % 9
+
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Digits.h"
 
-int main() {
+int main(int argc, char **argv) {
    unsigned int number, temp, droot = 0;
+   if (argc == 4 && strcmp(argv[1], "--range") == 0) {
+      uint64_t counts[10];
+      int r;
+      digitRootCounts(strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10), counts);
+      for (r = 0; r < 10; r++)
+         printf("%d %" PRIu64 "\n", r, counts[r]);
+      return 0;
+   }
    printf("Enter a positive number: ");
    scanf("%u", &number);
    temp = number;
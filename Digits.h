@@ -0,0 +1,444 @@
+// Digit checks over ranges of numbers, for ArmstrongNumber.c,
+// PalindromeNumber.c, Automorphic_number.c, MagicNumbers.c,
+// MirrorNumber.c, ReverseNumber.c and DigitalRoot.c.
+//
+// Testing every number on its own splits it into digits with a division
+// a digit, and ArmstrongNumber.c adds a pow() a digit on top. A range
+// scan does not need to: n + 1 has the digits of n but for the last one,
+// unless there is a carry. A DigitState keeps, for the block of ten
+// numbers base .. base + 9, the digits of base / 10 and what they add to
+// each check: their sum, the sum of their len-th powers from a table made
+// once per length, and the reverse they make in the top len - 1 places.
+// digitNext() moves to the next block; that changes one digit nine times
+// in ten, and the sums are moved by the change rather than made again.
+// Within a block the last digit d runs 0 .. 9 and every check is an add
+// and a compare:
+//
+//     Armstrong      sum of powers + d^len == base + d
+//     palindrome     reverse + d * 10^(len - 1) == base + d, only for d
+//                    the leading digit
+//     automorphic    n^2 ends in n: only n ending in 5 or 6 can, past 1,
+//                    and the last four digits are tried before n^2
+//     magic          (s + d) * reverse(s + d) == base + d, s the digit
+//                    sum, from a table; none is above DIGIT_MAGIC_MAX
+//     mirror         reverse(isqrt(reverse(n^2))) == n, as
+//                    MirrorNumber.c has it; n^2 is not kept, so this one
+//                    is the plain loop
+//
+// digitScan() cuts [lo, hi] into pieces of DIGIT_CHUNK numbers that the
+// workers of pool (TaskPool.h) scan, each from a DigitState of its own,
+// and gives the hits in order; pool may be NULL. Numbers go up to
+// DIGIT_MAX, where the sums of powers still fit 64 bits; mirror numbers
+// go to DIGIT_MIRROR_MAX, where n^2 and its reverse do. digitReport()
+// prints what a scan found through an OutBuffer, and digitWriteReverses()
+// writes a range's reverses off the same DigitState. digitRootCounts()
+// needs no scan: the digital root of n > 0 is 1 + (n - 1) % 9.
+// digitScan() and digitReport() return 0, or -1 when out of memory.
+// Header-only; build with -pthread -lm.
+
+#ifndef DIGITS_H
+#define DIGITS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "OutBuffer.h"
+#include "TaskPool.h"
+
+#define DIGIT_MAX 1000000000000000000ULL // 10^18
+#define DIGIT_MAGIC_MAX 180000           // 9 * 20 digits * 1000 > any s * reverse(s)
+#define DIGIT_MIRROR_MAX 3162277660ULL   // n^2 < 10^19, so its reverse fits too
+#define DIGIT_CHUNK (1u << 24)
+#define DIGIT_WINDOW 256
+
+enum
+{
+    DIGIT_ARMSTRONG,
+    DIGIT_PALINDROME,
+    DIGIT_AUTOMORPHIC,
+    DIGIT_MAGIC,
+    DIGIT_MIRROR
+};
+
+static const uint64_t digitPow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL};
+
+typedef struct
+{
+    uint64_t base;    // the block is base .. base + 9
+    int len;          // digits of every number in the block
+    uint8_t d[20];    // d[i] is the digit of 10^i in base; d[0] is 0
+    uint64_t pw[10];  // pw[k] = k^len
+    uint64_t sum;     // of d[1 .. len)
+    uint64_t powers;  // of pw[d[i]], 1 <= i < len
+    uint64_t reverse; // of d[i] * 10^(len - 1 - i), 1 <= i < len
+} DigitState;
+
+typedef struct
+{
+    uint64_t *n;
+    size_t count, cap;
+} DigitHits;
+
+static inline int digitCount(uint64_t n)
+{
+    int len = 1;
+    while (len < 20 && n >= digitPow10[len])
+        len++;
+    return len;
+}
+
+static inline uint64_t digitSum(uint64_t n)
+{
+    uint64_t s = 0;
+    for (; n != 0; n /= 10)
+        s += n % 10;
+    return s;
+}
+
+// Wraps past 64 bits, as the programs' int loops do past theirs
+static inline uint64_t digitReverse(uint64_t n)
+{
+    uint64_t r = 0;
+    for (; n != 0; n /= 10)
+        r = r * 10 + n % 10;
+    return r;
+}
+
+static inline uint64_t digitRoot(uint64_t n)
+{
+    return n == 0 ? 0 : 1 + (n - 1) % 9;
+}
+
+// floor(sqrt(x)): the double's root, off by at most one past 2^52, put right
+static inline uint64_t digitIsqrt(uint64_t x)
+{
+    uint64_t r = (uint64_t)sqrt((double)x);
+    while (r > 0 && (r > UINT32_MAX || r * r > x))
+        r--;
+    while (r < UINT32_MAX && (r + 1) * (r + 1) <= x)
+        r++;
+    return r;
+}
+
+// The block of n
+static inline void digitStart(DigitState *s, uint64_t n)
+{
+    uint64_t m;
+    int i, k;
+    memset(s, 0, sizeof *s);
+    s->base = n - n % 10;
+    s->len = digitCount(s->base);
+    for (k = 0; k < 10; k++)
+        for (s->pw[k] = 1, i = 0; i < s->len; i++)
+            s->pw[k] *= (uint64_t)k;
+    for (m = s->base / 10, i = 1; m != 0; m /= 10, i++)
+    {
+        s->d[i] = (uint8_t)(m % 10);
+        s->sum += s->d[i];
+        s->powers += s->pw[s->d[i]];
+        s->reverse += s->d[i] * digitPow10[s->len - 1 - i];
+    }
+}
+
+// The next block: the digits of base / 10 + 1, moved by what changed
+static inline void digitNext(DigitState *s)
+{
+    int i = 1;
+    s->base += 10;
+    while (s->d[i] == 9)
+    {
+        s->d[i] = 0;
+        s->sum -= 9;
+        s->powers -= s->pw[9];
+        s->reverse -= 9 * digitPow10[s->len - 1 - i];
+        i++;
+    }
+    if (i == s->len)
+    {
+        digitStart(s, s->base); // one digit longer: new powers
+        return;
+    }
+    s->d[i]++;
+    s->sum++;
+    s->powers += s->pw[s->d[i]] - s->pw[s->d[i] - 1];
+    s->reverse += digitPow10[s->len - 1 - i];
+}
+
+static inline int digitIsArmstrong(uint64_t n)
+{
+    DigitState s;
+    digitStart(&s, n);
+    return s.powers + s.pw[n % 10] == n;
+}
+
+static inline int digitIsPalindrome(uint64_t n)
+{
+    return digitReverse(n) == n;
+}
+
+static inline int digitIsAutomorphic(uint64_t n)
+{
+    int len = n == 0 ? 0 : digitCount(n);
+    return (uint64_t)((__uint128_t)n * n % digitPow10[len]) == n;
+}
+
+static inline int digitIsMagic(uint64_t n)
+{
+    uint64_t s = digitSum(n);
+    return s * digitReverse(s) == n;
+}
+
+static inline int digitIsMirror(uint64_t n)
+{
+    return n <= DIGIT_MIRROR_MAX && digitReverse(digitIsqrt(digitReverse(n * n))) == n;
+}
+
+static inline int digitPush(DigitHits *h, uint64_t n)
+{
+    if (h->count == h->cap)
+    {
+        size_t cap = h->cap ? 2 * h->cap : 64;
+        uint64_t *bigger = (uint64_t *)realloc(h->n, cap * sizeof *bigger);
+        if (bigger == NULL)
+            return -1;
+        h->n = bigger;
+        h->cap = cap;
+    }
+    h->n[h->count++] = n;
+    return 0;
+}
+
+// The numbers of [lo, hi] that pass check, added to h; one piece
+static inline int digitScanRange(int check, uint64_t lo, uint64_t hi, DigitHits *h)
+{
+    static const uint8_t ends[4] = {0, 1, 5, 6}; // of automorphic numbers
+    uint64_t magic[9 * 20 + 1];
+    DigitState s;
+    uint64_t n;
+    int rc = 0, k;
+    if (lo > hi)
+        return 0;
+    if (check == DIGIT_MIRROR)
+    {
+        for (n = lo; n <= hi && n <= DIGIT_MIRROR_MAX && rc == 0; n++)
+            if (digitIsMirror(n))
+                rc = digitPush(h, n);
+        return rc;
+    }
+    if (check == DIGIT_MAGIC)
+    {
+        for (n = 0; n < sizeof magic / sizeof *magic; n++)
+            magic[n] = n * digitReverse(n);
+        if (hi > DIGIT_MAGIC_MAX)
+            hi = DIGIT_MAGIC_MAX;
+        if (lo > hi)
+            return 0;
+    }
+    for (digitStart(&s, lo); s.base <= hi && rc == 0; digitNext(&s))
+    {
+        uint64_t first = s.base < lo ? lo - s.base : 0;
+        uint64_t last = hi - s.base < 9 ? hi - s.base : 9, d;
+        uint64_t top = digitPow10[s.len - 1], lead;
+        switch (check)
+        {
+        case DIGIT_ARMSTRONG:
+            for (d = first; d <= last; d++)
+                if (s.powers + s.pw[d] == s.base + d)
+                    rc |= digitPush(h, s.base + d);
+            break;
+        case DIGIT_PALINDROME:
+            if (s.len == 1)
+            {
+                for (d = first; d <= last; d++)
+                    rc |= digitPush(h, d);
+                break;
+            }
+            lead = s.d[s.len - 1];
+            if (lead >= first && lead <= last && s.reverse + lead * top == s.base + lead)
+                rc = digitPush(h, s.base + lead);
+            break;
+        case DIGIT_AUTOMORPHIC:
+            for (k = s.base == 0 ? 0 : 2; k < 4; k++)
+            {
+                uint64_t x = s.base + ends[k], low = x % 10000;
+                if (ends[k] < first || ends[k] > last)
+                    continue;
+                if (s.len >= 4 && low * low % 10000 != low)
+                    continue;
+                if (digitIsAutomorphic(x))
+                    rc |= digitPush(h, x);
+            }
+            break;
+        case DIGIT_MAGIC:
+            for (d = first; d <= last; d++)
+                if (magic[s.sum + d] == s.base + d)
+                    rc |= digitPush(h, s.base + d);
+            break;
+        }
+        if (hi - s.base < 10)
+            break; // base + 10 would be past hi, or past 2^64
+    }
+    return rc;
+}
+
+typedef struct
+{
+    int check;
+    atomic_int failed;
+    uint64_t lo, hi;
+    DigitHits *pieces;
+} DigitJob;
+
+static inline void digitPieces(size_t begin, size_t end, void *arg)
+{
+    DigitJob *job = (DigitJob *)arg;
+    size_t c;
+    for (c = begin; c < end; c++)
+    {
+        uint64_t from = job->lo + (uint64_t)c * DIGIT_CHUNK;
+        uint64_t to = job->hi - from < DIGIT_CHUNK - 1 ? job->hi : from + DIGIT_CHUNK - 1;
+        if (digitScanRange(job->check, from, to, &job->pieces[c]) != 0)
+            atomic_store(&job->failed, 1);
+    }
+}
+
+// The numbers of [lo, hi] that pass check, in order, into h (which is
+// filled as a new one and freed with free(h->n)); DIGIT_WINDOW pieces at
+// a time, so a long range needs no list of all of them
+static inline int digitScan(TaskPool *pool, int check, uint64_t lo, uint64_t hi, DigitHits *h)
+{
+    DigitJob job;
+    uint64_t left;
+    size_t chunks, c, i;
+    memset(h, 0, sizeof *h);
+    if (hi > DIGIT_MAX)
+        hi = DIGIT_MAX;
+    if (lo > hi)
+        return 0;
+    job.check = check;
+    atomic_init(&job.failed, 0);
+    job.hi = hi;
+    if ((job.pieces = (DigitHits *)calloc(DIGIT_WINDOW, sizeof *job.pieces)) == NULL)
+        return -1;
+    for (job.lo = lo;; job.lo += (uint64_t)DIGIT_WINDOW * DIGIT_CHUNK)
+    {
+        left = (hi - job.lo) / DIGIT_CHUNK + 1;
+        chunks = left < DIGIT_WINDOW ? (size_t)left : DIGIT_WINDOW;
+        if (pool != NULL && pool->nthreads > 1 && chunks > 1)
+            poolParallelFor(pool, 0, chunks, 1, digitPieces, &job);
+        else
+            digitPieces(0, chunks, &job);
+        for (c = 0; c < chunks; c++)
+        {
+            for (i = 0; i < job.pieces[c].count && !atomic_load(&job.failed); i++)
+                if (digitPush(h, job.pieces[c].n[i]) != 0)
+                    atomic_store(&job.failed, 1);
+            job.pieces[c].count = 0;
+        }
+        if (left <= DIGIT_WINDOW || atomic_load(&job.failed))
+            break;
+    }
+    for (c = 0; c < DIGIT_WINDOW; c++)
+        free(job.pieces[c].n);
+    free(job.pieces);
+    if (atomic_load(&job.failed))
+    {
+        free(h->n);
+        memset(h, 0, sizeof *h);
+        return -1;
+    }
+    return 0;
+}
+
+// The numbers of [lo, hi] that pass check to stdout, a line each, then
+// "<count> <what> in [lo, hi]", scanned by threads threads
+static inline int digitReport(int check, uint64_t lo, uint64_t hi, int threads, const char *what)
+{
+    TaskPool pool;
+    OutBuffer out;
+    DigitHits h;
+    size_t i;
+    int rc;
+    if (poolCreate(&pool, threads > 1 ? threads : 1) != 0)
+        return -1;
+    rc = digitScan(&pool, check, lo, hi, &h);
+    poolDestroy(&pool);
+    if (rc != 0 || outInit(&out, stdout, 0) != 0)
+    {
+        free(h.n);
+        return -1;
+    }
+    for (i = 0; i < h.count; i++)
+    {
+        outInt(&out, (long long)h.n[i]);
+        outChar(&out, '\n');
+    }
+    outInt(&out, (long long)h.count);
+    outChar(&out, ' ');
+    outStr(&out, what);
+    outStr(&out, " in [");
+    outInt(&out, (long long)lo);
+    outStr(&out, ", ");
+    outInt(&out, (long long)(hi < DIGIT_MAX ? hi : DIGIT_MAX));
+    outStr(&out, "]\n");
+    free(h.n);
+    return outClose(&out);
+}
+
+// "n reverse(n)" for every n of [lo, hi], a line each, into o
+static inline void digitWriteReverses(OutBuffer *o, uint64_t lo, uint64_t hi)
+{
+    DigitState s;
+    uint64_t d;
+    if (hi > DIGIT_MAX)
+        hi = DIGIT_MAX;
+    if (lo > hi)
+        return;
+    for (digitStart(&s, lo);; digitNext(&s))
+    {
+        uint64_t first = s.base < lo ? lo - s.base : 0;
+        uint64_t last = hi - s.base < 9 ? hi - s.base : 9;
+        for (d = first; d <= last; d++)
+        {
+            outInt(o, (long long)(s.base + d));
+            outChar(o, ' ');
+            outInt(o, (long long)(s.reverse + d * digitPow10[s.len - 1]));
+            outChar(o, '\n');
+        }
+        if (hi - s.base < 10)
+            break;
+    }
+}
+
+// counts[r] = how many numbers of [lo, hi] have digital root r
+static inline void digitRootCounts(uint64_t lo, uint64_t hi, uint64_t counts[10])
+{
+    int r;
+    memset(counts, 0, 10 * sizeof *counts);
+    if (lo > hi)
+        return;
+    if (lo == 0)
+    {
+        counts[0] = 1;
+        if (hi == 0)
+            return;
+        lo = 1;
+    }
+    // n - 1 in [lo - 1, hi - 1]; root r for n - 1 = r - 1 (mod 9)
+    for (r = 1; r <= 9; r++)
+    {
+        uint64_t a = lo - 1, b = hi - 1, k = (uint64_t)(r - 1);
+        // how many x in [a, b] with x % 9 == k
+        uint64_t upTo = b / 9 + (b % 9 >= k ? 1 : 0);
+        uint64_t below = a == 0 ? 0 : (a - 1) / 9 + ((a - 1) % 9 >= k ? 1 : 0);
+        counts[r] = upTo - below;
+    }
+}
+
+#endif
@@ -1,8 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "EnvIndex.h"
+#include "OutBuffer.h"
+
+// The variables go into one OutBuffer.h buffer and out in one write, not
+// a printf() each.
+//
+//     DisplayLinuxEnvirmentVariables              every variable
+//     DisplayLinuxEnvirmentVariables NAME...      NAME=VALUE of the names
+//                                                 that are set; 1 if one
+//                                                 is not
+//     DisplayLinuxEnvirmentVariables --bench N    getenv() against the
+//                                                 EnvIndex.h index, N
+//                                                 lookups of every name
+
+static double now(void){
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// The names of the environment, plus as many that are not set
+static char **benchNames(size_t *count){
+	extern char **environ;
+	size_t n = 0, i;
+	char **names;
+
+	while (environ[n])
+		n++;
+	if ((names = malloc(2 * n * sizeof *names)) == NULL)
+		return NULL;
+	for (i = 0; i < n; i++) {
+		const char *eq = strchr(environ[i], '=');
+		size_t len = eq ? (size_t)(eq - environ[i]) : strlen(environ[i]);
+
+		names[i] = malloc(len + 1);
+		names[n + i] = malloc(len + 8);
+		memcpy(names[i], environ[i], len);
+		names[i][len] = '\0';
+		snprintf(names[n + i], len + 8, "UNSET_%s", names[i]);
+	}
+	*count = 2 * n;
+	return names;
+}
+
+static int bench(long rounds){
+	extern char **environ;
+	char name[32], value[64];
+	char **names;
+	const EnvVar **found;
+	size_t n, i, hits[3] = {0};
+	double best[4] = {1e30, 1e30, 1e30, 1e30}, t;
+	EnvIndex idx;
+	long r;
+	int k;
+
+	// a launcher's environment: a few hundred variables on top of ours
+	for (i = 0; i < 300; i++) {
+		snprintf(name, sizeof name, "LAUNCH_VAR_%zu", i);
+		snprintf(value, sizeof value, "/opt/tool/%zu/bin:/usr/local/bin", i);
+		setenv(name, value, 1);
+	}
+	if ((names = benchNames(&n)) == NULL || (found = malloc(n * sizeof *found)) == NULL)
+		return 1;
+	for (k = 0; k < 3; k++) {
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			envIndexBuild(&idx, environ);
+			envIndexFree(&idx);
+		}
+		if ((t = now() - t) < best[0])
+			best[0] = t;
+		envIndexBuild(&idx, environ);
+
+		hits[0] = hits[1] = hits[2] = 0;
+		t = now();
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < n; i++)
+				hits[0] += getenv(names[i]) != NULL;
+		if ((t = now() - t) < best[1])
+			best[1] = t;
+		t = now();
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < n; i++)
+				hits[1] += envGet(&idx, names[i]) != NULL;
+		if ((t = now() - t) < best[2])
+			best[2] = t;
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			envLookupMany(&idx, (const char *const *)names, n, found);
+			for (i = 0; i < n; i++)
+				hits[2] += found[i] != NULL;
+		}
+		if ((t = now() - t) < best[3])
+			best[3] = t;
+		envIndexFree(&idx);
+	}
+	printf("%zu variables, %zu lookups a round (half of them unset), %ld rounds, best of 3\n", n / 2, n, rounds);
+	printf("  build the index  %8.1f us a build\n", best[0] / rounds * 1e6);
+	printf("  getenv()         %8.1f ns a lookup\n", best[1] / rounds / n * 1e9);
+	printf("  envGet()         %8.1f ns a lookup\n", best[2] / rounds / n * 1e9);
+	printf("  envLookupMany()  %8.1f ns a lookup\n", best[3] / rounds / n * 1e9);
+	for (i = 0; i < n; i++)
+		free(names[i]);
+	free(names);
+	free(found);
+	if (hits[0] != hits[1] || hits[0] != hits[2]) {
+		fprintf(stderr, "the index found %zu and %zu, getenv() %zu\n", hits[1], hits[2], hits[0]);
+		return 1;
+	}
+	return 0;
+}
 
 int main(int argc, char **argv, char **environ){
-	int i = -1;
+	int i = -1, missing = 0;
+	OutBuffer out;
+	EnvIndex idx;
+	const EnvVar **found;
 
-	while (environ[++i])
-		printf("%s\n",environ[i]);
+	if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+		return bench(atol(argv[2]) > 0 ? atol(argv[2]) : 1000);
+	if (outInit(&out, stdout, 0) != 0)
+		return 1;
+	if (argc == 1) {
+		while (environ[++i]) {
+			outStr(&out, environ[i]);
+			outChar(&out, '\n');
+		}
+		return outClose(&out) != 0;
+	}
+	if (envIndexBuild(&idx, environ) != 0 || (found = malloc((argc - 1) * sizeof *found)) == NULL) {
+		outClose(&out);
+		return 1;
+	}
+	envLookupMany(&idx, (const char *const *)argv + 1, argc - 1, found);
+	envWriteFound(&out, found, argc - 1);
+	for (i = 0; i < argc - 1; i++)
+		missing |= found[i] == NULL;
+	free(found);
+	envIndexFree(&idx);
+	return (outClose(&out) != 0) | missing;
 }
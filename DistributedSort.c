@@ -0,0 +1,811 @@
+// Distributed sample sort of 64-bit keys across several machines.
+//
+//   DistributedSort --hosts FILE --rank R IN OUT
+//   DistributedSort --local P IN OUT     P nodes as processes on this machine
+//
+// FILE lists one host:port per line, the same file on every node, and line
+// R (counting from 0) is this node. IN and OUT hold raw native-endian
+// uint64_t keys, as for ExternalSort.c, so all nodes must share one byte
+// order. IN is this node's share of the data; OUT gets this node's part of
+// the result, and every key in node R's OUT is <= every key in node R+1's,
+// so the outputs taken in rank order are the sorted whole. --local splits
+// one IN into P slices, runs P nodes that talk over loopback, and writes
+// OUT.0 .. OUT.P-1. To try it out:
+//
+//   ExternalSort --random 10000000 keys
+//   DistributedSort --local 4 keys sorted
+//   cat sorted.0 sorted.1 sorted.2 sorted.3 | ExternalSort --check -
+//
+// Every node goes through five phases and reports the time of each:
+//  1. read     IN into memory
+//  2. sort     locally with sort_u64 from SortLib.h
+//  3. sample   regular sampling: each node takes DS_OVERSAMPLE * P keys
+//              evenly spaced in its sorted array and sends them to every
+//              other node, so all nodes sort the same samples and take the
+//              same P - 1 splitters from them, with no coordinator
+//  4. exchange all to all, one TCP connection for each pair of nodes: the
+//              keys from splitter i - 1 up to splitter i go to node i, sent
+//              straight out of the sorted array with no staging copy, while
+//              the other nodes' keys for this one come in; one poll() loop
+//              drives all the sockets, so no pair waits for another
+//  5. merge    the P sorted runs this node now has, with a loser tree as
+//              in ExternalSort.c, written to OUT in blocks of DS_BLOCK keys
+//
+// With distinct keys regular sampling sends no node much more than
+// (1 + 1 / DS_OVERSAMPLE) times the average; many copies of one key all go
+// to one node. A node holds its share and what it receives, so it needs
+// about twice its share of memory: 10 TB on 64 nodes is 160 GB a node in
+// and 320 GB of memory. Shares bigger than that need more nodes, or an
+// ExternalSort of the merged runs.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "SortLib.h"
+
+#define DS_OVERSAMPLE 16         // samples per node per destination
+#define DS_BLOCK (1 << 20)       // keys per fwrite of the merge
+#define DS_CONNECT_TRIES 600     // 100 ms apart, for nodes that start late
+#define DS_MAX_NODES 4096
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------- connections ----------
+
+typedef struct
+{
+    int p, rank;
+    int *fd; // fd[j] is the connection to node j; -1 for this node
+} Node;
+
+static int fail(const Node *node, const char *what)
+{
+    fprintf(stderr, "node %d: %s failed: %s\n", node->rank, what, errno ? strerror(errno) : "bad data");
+    return -1;
+}
+
+// Splits "host:port" at the last ':' into host and port (in place)
+static int splitAddress(char *line, char **host, char **port)
+{
+    char *colon = strrchr(line, ':');
+    if (colon == NULL || colon == line || colon[1] == '\0')
+        return -1;
+    *colon = '\0';
+    *host = line;
+    *port = colon + 1;
+    if (**host == '[' && colon[-1] == ']') // [::1]:port
+    {
+        colon[-1] = '\0';
+        (*host)++;
+    }
+    return 0;
+}
+
+// A socket listening on port (on every address when host is NULL)
+static int listenOn(const char *host, const char *port)
+{
+    struct addrinfo hints, *list, *a;
+    int fd = -1, one = 1;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host, port, &hints, &list) != 0)
+        return -1;
+    for (a = list; a != NULL; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+            continue;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        if (bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, DS_MAX_NODES) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+static int connectTo(const char *host, const char *port)
+{
+    struct addrinfo hints, *list, *a;
+    int fd = -1, try;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &list) != 0)
+        return -1;
+    for (try = 0; try < DS_CONNECT_TRIES && fd < 0; try++)
+    {
+        if (try > 0)
+            usleep(100000);
+        for (a = list; a != NULL; a = a->ai_next)
+        {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+                break;
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+// Blocking read or write of exactly n bytes
+static int readAll(int fd, void *buf, size_t n)
+{
+    unsigned char *p = buf;
+    while (n > 0)
+    {
+        ssize_t got = read(fd, p, n);
+        if (got <= 0)
+        {
+            if (got < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += got;
+        n -= (size_t)got;
+    }
+    return 0;
+}
+
+static int writeAll(int fd, const void *buf, size_t n)
+{
+    const unsigned char *p = buf;
+    while (n > 0)
+    {
+        ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += put;
+        n -= (size_t)put;
+    }
+    return 0;
+}
+
+// Connects node rank to all the others: it dials the lower ranks, which
+// are listening, and says who it is, and takes the calls of the higher
+// ones on listenFd. Returns 0, or -1 with the connections made closed.
+static int nodeConnect(Node *node, int listenFd, char **host, char **port)
+{
+    int j, calls, one = 1;
+    uint32_t who;
+
+    node->fd = malloc(node->p * sizeof(int));
+    if (node->fd == NULL)
+        return fail(node, "malloc");
+    for (j = 0; j < node->p; j++)
+        node->fd[j] = -1;
+    errno = 0;
+    for (j = 0; j < node->rank; j++)
+    {
+        who = (uint32_t)node->rank;
+        if ((node->fd[j] = connectTo(host[j], port[j])) < 0 || writeAll(node->fd[j], &who, sizeof who) != 0)
+            goto failed;
+    }
+    for (calls = node->p - 1 - node->rank; calls > 0; calls--)
+    {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            goto failed;
+        if (readAll(fd, &who, sizeof who) != 0 || who <= (uint32_t)node->rank || who >= (uint32_t)node->p ||
+            node->fd[who] >= 0)
+        {
+            close(fd);
+            goto failed;
+        }
+        node->fd[who] = fd;
+    }
+    for (j = 0; j < node->p; j++)
+        if (j != node->rank)
+            setsockopt(node->fd[j], IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return 0;
+
+failed:
+    fail(node, "connect");
+    for (j = 0; j < node->p; j++)
+        if (node->fd[j] >= 0)
+            close(node->fd[j]);
+    free(node->fd);
+    node->fd = NULL;
+    return -1;
+}
+
+static void nodeClose(Node *node)
+{
+    int j;
+    for (j = 0; j < node->p; j++)
+        if (node->fd[j] >= 0)
+            close(node->fd[j]);
+    free(node->fd);
+    node->fd = NULL;
+}
+
+// ---------- all-to-all exchange ----------
+
+// What goes to one peer and comes from it: an 8-byte count of keys, then
+// the keys
+typedef struct
+{
+    const uint64_t *out;
+    uint64_t outCount, inCount;
+    size_t sent, got; // bytes so far, the count included
+    uint64_t *in;
+} Transfer;
+
+// to[j], toCount[j] go to node j and from[j], fromCount[j] (malloc'ed)
+// come from it, for every j but this node, whose slots are left alone.
+// Returns the bytes sent, or -1.
+static long long exchange(Node *node, const uint64_t **to, const size_t *toCount, uint64_t **from,
+                          size_t *fromCount)
+{
+    Transfer *t = calloc(node->p, sizeof *t);
+    struct pollfd *fds = malloc(node->p * sizeof *fds);
+    int *peer = malloc(node->p * sizeof(int));
+    long long total = 0;
+    int j, status = 0;
+
+    if (t == NULL || fds == NULL || peer == NULL)
+    {
+        free(t);
+        free(fds);
+        free(peer);
+        return fail(node, "malloc");
+    }
+    for (j = 0; j < node->p; j++)
+    {
+        t[j].out = to[j];
+        t[j].outCount = toCount[j];
+        if (j != node->rank)
+            fcntl(node->fd[j], F_SETFL, fcntl(node->fd[j], F_GETFL) | O_NONBLOCK);
+    }
+    errno = 0;
+    for (;;)
+    {
+        int n = 0, k;
+        for (j = 0; j < node->p; j++)
+        {
+            short events = 0;
+            if (j == node->rank)
+                continue;
+            if (t[j].sent < 8 + 8 * t[j].outCount)
+                events |= POLLOUT;
+            if (t[j].got < 8 || t[j].got < 8 + 8 * t[j].inCount)
+                events |= POLLIN;
+            if (events == 0)
+                continue;
+            fds[n].fd = node->fd[j];
+            fds[n].events = events;
+            peer[n++] = j;
+        }
+        if (n == 0)
+            break;
+        if (poll(fds, n, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            status = fail(node, "poll");
+            break;
+        }
+        for (k = 0; k < n && status == 0; k++)
+        {
+            Transfer *x = &t[peer[k]];
+            ssize_t r;
+            if (fds[k].events & POLLOUT && fds[k].revents & (POLLOUT | POLLERR))
+            {
+                if (x->sent < 8)
+                    r = send(fds[k].fd, (const char *)&x->outCount + x->sent, 8 - x->sent, MSG_NOSIGNAL);
+                else
+                    r = send(fds[k].fd, (const char *)x->out + (x->sent - 8), 8 * x->outCount - (x->sent - 8),
+                             MSG_NOSIGNAL);
+                if (r < 0 && errno != EAGAIN && errno != EINTR)
+                    status = fail(node, "send");
+                else if (r > 0)
+                    x->sent += (size_t)r;
+            }
+            if (status == 0 && fds[k].events & POLLIN && fds[k].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                if (x->got < 8)
+                    r = recv(fds[k].fd, (char *)&x->inCount + x->got, 8 - x->got, 0);
+                else
+                    r = recv(fds[k].fd, (char *)x->in + (x->got - 8), 8 * x->inCount - (x->got - 8), 0);
+                if (r == 0)
+                {
+                    errno = ECONNRESET;
+                    status = fail(node, "receive");
+                }
+                else if (r < 0 && errno != EAGAIN && errno != EINTR)
+                    status = fail(node, "receive");
+                else if (r > 0 && (x->got += (size_t)r) == 8)
+                {
+                    x->in = x->inCount <= SIZE_MAX / 8 ? malloc(x->inCount ? 8 * x->inCount : 1) : NULL;
+                    if (x->in == NULL)
+                        status = fail(node, "malloc");
+                }
+            }
+        }
+        if (status != 0)
+            break;
+    }
+    for (j = 0; j < node->p; j++)
+    {
+        if (j == node->rank)
+            continue;
+        fcntl(node->fd[j], F_SETFL, fcntl(node->fd[j], F_GETFL) & ~O_NONBLOCK);
+        total += (long long)t[j].sent;
+        if (status == 0)
+        {
+            from[j] = t[j].in;
+            fromCount[j] = (size_t)t[j].inCount;
+        }
+        else
+            free(t[j].in);
+    }
+    free(t);
+    free(fds);
+    free(peer);
+    return status == 0 ? total : -1;
+}
+
+// ---------- merging the received runs ----------
+
+// The loser tree of ExternalSort.c over runs in memory: tree[0] is the
+// winner, tree[1..k) the loser of each match, leaf i is node k + i
+typedef struct
+{
+    int k;
+    int *tree;
+    const uint64_t **run;
+    size_t *pos, *len;
+} RunTree;
+
+static inline int rtLess(const RunTree *t, int a, int b)
+{
+    if (t->pos[a] == t->len[a])
+        return 0;
+    if (t->pos[b] == t->len[b])
+        return 1;
+    return t->run[a][t->pos[a]] < t->run[b][t->pos[b]];
+}
+
+static int rtBuild(RunTree *t, int node)
+{
+    int l, r;
+    if (node >= t->k)
+        return node - t->k;
+    l = rtBuild(t, 2 * node);
+    r = rtBuild(t, 2 * node + 1);
+    if (rtLess(t, r, l))
+    {
+        t->tree[node] = l;
+        return r;
+    }
+    t->tree[node] = r;
+    return l;
+}
+
+// Merges the k runs into out; returns 0, or -1 when out of memory or a
+// write failed
+static int mergeRuns(const uint64_t **run, const size_t *len, int k, FILE *out)
+{
+    RunTree t;
+    uint64_t *block = malloc(DS_BLOCK * sizeof *block);
+    size_t fill = 0;
+    int status = 0;
+
+    t.k = k;
+    t.run = run;
+    t.tree = malloc(k * sizeof *t.tree);
+    t.pos = calloc(k, sizeof *t.pos);
+    t.len = malloc(k * sizeof *t.len);
+    if (block == NULL || t.tree == NULL || t.pos == NULL || t.len == NULL)
+        status = -1;
+    else
+    {
+        memcpy(t.len, len, k * sizeof *t.len);
+        t.tree[0] = rtBuild(&t, 1);
+        while (t.pos[t.tree[0]] < t.len[t.tree[0]])
+        {
+            int w = t.tree[0], node;
+            block[fill++] = run[w][t.pos[w]++];
+            if (fill == DS_BLOCK)
+            {
+                if (fwrite(block, sizeof *block, fill, out) != fill)
+                    status = -1;
+                fill = 0;
+            }
+            for (node = (w + k) / 2; node > 0; node /= 2)
+            {
+                if (rtLess(&t, t.tree[node], w))
+                {
+                    int loser = w;
+                    w = t.tree[node];
+                    t.tree[node] = loser;
+                }
+            }
+            t.tree[0] = w;
+        }
+        if (fwrite(block, sizeof *block, fill, out) != fill)
+            status = -1;
+    }
+    free(block);
+    free(t.tree);
+    free(t.pos);
+    free(t.len);
+    return status;
+}
+
+// ---------- the phases ----------
+
+// Keys [n * part / parts, n * (part + 1) / parts) of the n in path
+static uint64_t *readShare(const char *path, int part, int parts, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    uint64_t *keys = NULL;
+    off_t size, from, to;
+
+    if (f == NULL || fseeko(f, 0, SEEK_END) != 0 || (size = ftello(f)) < 0)
+        goto done;
+    size /= sizeof(uint64_t);
+    from = size * part / parts;
+    to = size * (part + 1) / parts;
+    *count = (size_t)(to - from);
+    keys = malloc((*count ? *count : 1) * sizeof *keys);
+    if (keys != NULL &&
+        (fseeko(f, from * (off_t)sizeof *keys, SEEK_SET) != 0 || fread(keys, sizeof *keys, *count, f) != *count))
+    {
+        free(keys);
+        keys = NULL;
+    }
+done:
+    if (f != NULL)
+        fclose(f);
+    return keys;
+}
+
+// The first i with a[i] >= x
+static size_t lowerBound(const uint64_t *a, size_t n, uint64_t x)
+{
+    size_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Frees what exchange() received
+static void freeReceived(uint64_t **recv, int p, int rank)
+{
+    int j;
+    for (j = 0; j < p; j++)
+        if (j != rank)
+            free(recv[j]);
+}
+
+// One node of the sort: share slice part of parts of in, result to out
+static int sampleSort(Node *node, const char *in, int part, int parts, const char *out)
+{
+    int p = node->p, me = node->rank, j;
+    size_t n = 0, s = (size_t)DS_OVERSAMPLE * p, total = 0, i, received = 0;
+    const uint64_t **send = calloc(p, sizeof *send);
+    size_t *sendCount = calloc(p, sizeof *sendCount), *recvCount = calloc(p, sizeof *recvCount);
+    uint64_t **recv = calloc(p, sizeof *recv), *keys = NULL, *samples = NULL, *all = NULL, *splitter = NULL;
+    double t[6];
+    long long bytes;
+    FILE *f;
+    int status = -1;
+
+    t[0] = now();
+    if (send == NULL || sendCount == NULL || recvCount == NULL || recv == NULL)
+    {
+        fail(node, "malloc");
+        goto done;
+    }
+    errno = 0;
+    if ((keys = readShare(in, part, parts, &n)) == NULL)
+    {
+        fail(node, "read");
+        goto done;
+    }
+    t[1] = now();
+    sort_u64(keys, n);
+    t[2] = now();
+
+    // 3. the same s samples to every node
+    if (s > n)
+        s = n;
+    samples = malloc((s ? s : 1) * sizeof *samples);
+    splitter = malloc(p * sizeof *splitter);
+    if (samples == NULL || splitter == NULL)
+    {
+        fail(node, "malloc");
+        goto done;
+    }
+    for (i = 0; i < s; i++)
+        samples[i] = keys[(i + 1) * n / (s + 1)];
+    for (j = 0; j < p; j++)
+    {
+        send[j] = samples;
+        sendCount[j] = s;
+    }
+    if (exchange(node, send, sendCount, recv, recvCount) < 0)
+        goto done;
+    recv[me] = samples;
+    recvCount[me] = s;
+    for (j = 0; j < p; j++)
+        total += recvCount[j];
+    all = malloc((total ? total : 1) * sizeof *all);
+    if (all == NULL)
+    {
+        freeReceived(recv, p, me);
+        fail(node, "malloc");
+        goto done;
+    }
+    for (j = 0, i = 0; j < p; i += recvCount[j++])
+        memcpy(all + i, recv[j], recvCount[j] * sizeof *all);
+    freeReceived(recv, p, me);
+    sort_u64(all, total);
+    // node j gets the keys from splitter[j - 1] up to splitter[j]. Sample i
+    // of every node stands for quantile (i + 1) / (s + 1), so the samples
+    // for quantile (j + 1) / p are the p around rank (j + 1) (s + 1) - p.
+    for (j = 0; j + 1 < p; j++)
+    {
+        size_t r = (j + 1) * (total + p) / p, back = (size_t)(p + 1) / 2;
+        r = r > back ? r - back : 0;
+        splitter[j] = total ? all[r < total ? r : total - 1] : UINT64_MAX;
+    }
+    t[3] = now();
+
+    // 4. the partitions
+    for (j = 0, i = 0; j < p; j++)
+    {
+        size_t end = j + 1 < p ? lowerBound(keys, n, splitter[j]) : n;
+        send[j] = keys + i;
+        sendCount[j] = end - i;
+        i = end;
+    }
+    if ((bytes = exchange(node, send, sendCount, recv, recvCount)) < 0)
+        goto done;
+    recv[me] = (uint64_t *)send[me];
+    recvCount[me] = sendCount[me];
+    for (j = 0; j < p; j++)
+        received += recvCount[j];
+    t[4] = now();
+
+    // 5. the merge
+    f = strcmp(out, "-") == 0 ? stdout : fopen(out, "wb");
+    errno = 0;
+    if (f == NULL || mergeRuns((const uint64_t **)recv, recvCount, p, f) != 0 ||
+        (f == stdout ? fflush(f) : fclose(f)) != 0)
+    {
+        if (f != NULL && f != stdout)
+            fclose(f);
+        freeReceived(recv, p, me);
+        fail(node, "write");
+        goto done;
+    }
+    freeReceived(recv, p, me);
+    t[5] = now();
+
+    fprintf(stderr,
+            "node %d: %zu keys in, %zu out; read %.3f s, sort %.3f s, sample %.3f s, "
+            "exchange %.3f s (%.0f MB/s sent), merge %.3f s\n",
+            me, n, received, t[1] - t[0], t[2] - t[1], t[3] - t[2], t[4] - t[3],
+            bytes / 1e6 / (t[4] - t[3] > 0 ? t[4] - t[3] : 1e-9), t[5] - t[4]);
+    status = 0;
+
+done:
+    free(send);
+    free(sendCount);
+    free(recvCount);
+    free(recv);
+    free(keys);
+    free(samples);
+    free(all);
+    free(splitter);
+    return status;
+}
+
+// ---------- running the nodes ----------
+
+// P nodes on loopback: the parent opens every listening socket on a port
+// the system picks, so the children know each other's ports before any of
+// them starts
+static int runLocal(int p, const char *in, const char *out)
+{
+    char **host = malloc(p * sizeof *host), **port = malloc(p * sizeof *port);
+    char *ports = malloc((size_t)p * 8);
+    int *listenFd = malloc(p * sizeof(int));
+    int j, status = 0, started = 0;
+
+    if (host == NULL || port == NULL || ports == NULL || listenFd == NULL)
+    {
+        status = -1;
+        goto done;
+    }
+    for (j = 0; j < p; j++)
+    {
+        struct sockaddr_in a;
+        socklen_t len = sizeof a;
+        host[j] = "127.0.0.1";
+        port[j] = ports + 8 * (size_t)j;
+        if ((listenFd[j] = listenOn(host[j], "0")) < 0 || getsockname(listenFd[j], (struct sockaddr *)&a, &len) != 0)
+        {
+            fprintf(stderr, "Cannot listen on loopback: %s\n", strerror(errno));
+            status = -1;
+            break;
+        }
+        snprintf(port[j], 8, "%u", (unsigned)ntohs(a.sin_port));
+        started++;
+    }
+    fflush(stdout);
+    for (j = 0; j < p && status == 0; j++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            status = -1;
+            break;
+        }
+        if (pid == 0)
+        {
+            Node node;
+            char path[4096];
+            int k, rc;
+            for (k = 0; k < p; k++)
+                if (k != j)
+                    close(listenFd[k]);
+            node.p = p;
+            node.rank = j;
+            snprintf(path, sizeof path, "%s.%d", out, j);
+            rc = nodeConnect(&node, listenFd[j], host, port);
+            close(listenFd[j]);
+            if (rc == 0)
+            {
+                rc = sampleSort(&node, in, j, p, path);
+                nodeClose(&node);
+            }
+            _exit(rc == 0 ? 0 : 1);
+        }
+    }
+    for (j = 0; j < started; j++)
+        close(listenFd[j]);
+    for (;;)
+    {
+        int rc;
+        pid_t pid = wait(&rc);
+        if (pid < 0)
+            break;
+        if (!WIFEXITED(rc) || WEXITSTATUS(rc) != 0)
+            status = -1;
+    }
+
+done:
+    free(host);
+    free(port);
+    free(ports);
+    free(listenFd);
+    return status;
+}
+
+// The nodes listed in hosts; this is node rank
+static int runNode(const char *hosts, int rank, const char *in, const char *out)
+{
+    FILE *f = fopen(hosts, "r");
+    char line[1024], **text = NULL, **host = NULL, **port = NULL;
+    int p = 0, j, status = -1, listenFd;
+    Node node;
+
+    if (f == NULL)
+    {
+        printf("Cannot open %s\n", hosts);
+        return -1;
+    }
+    while (fgets(line, sizeof line, f) != NULL && p < DS_MAX_NODES)
+    {
+        char **more;
+        line[strcspn(line, " \t\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+        if ((more = realloc(text, (p + 1) * sizeof *text)) == NULL)
+            break;
+        text = more;
+        if ((text[p] = strdup(line)) == NULL)
+            break;
+        p++;
+    }
+    fclose(f);
+    host = malloc((p ? p : 1) * sizeof *host);
+    port = malloc((p ? p : 1) * sizeof *port);
+    if (host == NULL || port == NULL)
+        goto done;
+    for (j = 0; j < p; j++)
+        if (splitAddress(text[j], &host[j], &port[j]) != 0)
+        {
+            printf("Line %d of %s is not host:port\n", j + 1, hosts);
+            goto done;
+        }
+    if (rank < 0 || rank >= p)
+    {
+        printf("Rank %d is not one of the %d nodes in %s\n", rank, p, hosts);
+        goto done;
+    }
+    if ((listenFd = listenOn(NULL, port[rank])) < 0)
+    {
+        printf("Cannot listen on port %s\n", port[rank]);
+        goto done;
+    }
+    node.p = p;
+    node.rank = rank;
+    if (nodeConnect(&node, listenFd, host, port) == 0)
+    {
+        close(listenFd);
+        status = sampleSort(&node, in, 0, 1, out);
+        nodeClose(&node);
+    }
+    else
+        close(listenFd);
+
+done:
+    for (j = 0; j < p; j++)
+        free(text[j]);
+    free(text);
+    free(host);
+    free(port);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    int status;
+
+    if (argc == 5 && strcmp(argv[1], "--local") == 0 && atoi(argv[2]) >= 1 && atoi(argv[2]) <= DS_MAX_NODES)
+        status = runLocal(atoi(argv[2]), argv[3], argv[4]);
+    else if (argc == 7 && strcmp(argv[1], "--hosts") == 0 && strcmp(argv[3], "--rank") == 0)
+        status = runNode(argv[2], atoi(argv[4]), argv[5], argv[6]);
+    else
+    {
+        printf("Usage: %s --hosts FILE --rank R IN OUT\n", argv[0]);
+        printf("       %s --local P IN OUT\n", argv[0]);
+        return 1;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Distributed sort failed\n");
+        return 1;
+    }
+    return 0;
+}
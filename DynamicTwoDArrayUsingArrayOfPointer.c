@@ -1,12 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "Matrix.h"
 
 int main() {
     int r = 3, c = 4, i, j, count;
+    Matrix m;
 
+    // One allocation for all the rows (Matrix.h), with a pointer to the
+    // start of each, rather than a malloc() per row
+    if (matrixInit(&m, r, c) != 0)
+        return 1;
     int * arr[r];
     for (i = 0; i < r; i++)
-        arr[i] = (int * ) malloc(c * sizeof(int));
+        arr[i] = matrixRow(&m, i);
 
     // Note that arr[i][j] is same as *(*(arr+i)+j) 
     count = 0;
@@ -18,8 +24,6 @@ int main() {
         for (j = 0; j < c; j++)
             printf("%d ", arr[i][j]);
 
-    /* Code for further processing and free the  
-        dynamically allocated memory */
-
+    matrixFree(&m);
     return 0;
 }
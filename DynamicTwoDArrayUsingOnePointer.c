@@ -1,22 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "Matrix.h"
 
 int main() {
     int r = 3, c = 4;
-    int * arr = (int * ) malloc(r * c * sizeof(int));
+    Matrix m;
+
+    // one block, rows m.stride elements apart (Matrix.h)
+    if (matrixInit(&m, r, c) != 0)
+        return 1;
 
     int i, j, count = 0;
     for (i = 0; i < r; i++)
         for (j = 0; j < c; j++)
-            *
-            (arr + i * c + j) = ++count;
+            *matrixAt(&m, i, j) = ++count;
 
     for (i = 0; i < r; i++)
         for (j = 0; j < c; j++)
-            printf("%d ", *(arr + i * c + j));
-
-    /* Code for further processing and free the  
-        dynamically allocated memory */
+            printf("%d ", *matrixAt(&m, i, j));
 
+    matrixFree(&m);
     return 0;
 }
@@ -1,17 +1,90 @@
 // Program to find employee grade
 // Given TA : 5% , DA : 7.5% , HRA : 10%
+//
+// With --bulk it reads one basic salary a line from stdin into a
+// RecordStore (Records.h) and writes the grade of each, one a line, and
+// with --counts after it how many employees have each grade instead.
 
 #include<stdio.h>
-int main(){
-    float BaseSalary, TA, DA, HRA, GrossSalary;
+#include<stdlib.h>
+#include<string.h>
+#include "OutBuffer.h"
+#include "Records.h"
 
-    printf("Enter basic salary of employee\n");
-    scanf("%f", &BaseSalary);
+/* E below 20000, D from 20000, C from 50000, B from 75000, A from 100000 */
+static const float gradeFrom[] = {20000, 50000, 75000, 100000};
+static const char gradeNames[] = "EDCBA";
 
+static float grossSalary(float BaseSalary)
+{
+    float TA, DA, HRA;
     TA  = 0.05 * BaseSalary;
     DA  = 0.075 * BaseSalary;
     HRA = 0.1 * BaseSalary;
-    GrossSalary = BaseSalary + TA + DA + HRA;
+    return BaseSalary + TA + DA + HRA;
+}
+
+static int bulk(int countsOnly)
+{
+    RecordStore r;
+    float *gross;
+    uint8_t *grade;
+    size_t i, counts[5];
+    OutBuffer o;
+    int g, rc;
+    if (recordsInit(&r, 1, 1024) != 0 || recordsRead(&r, stdin, 0) != 0)
+    {
+        fprintf(stderr, "out of memory or failed to read\n");
+        recordsFree(&r);
+        return 1;
+    }
+    gross = malloc((r.n ? r.n : 1) * sizeof *gross);
+    grade = malloc(r.n ? r.n : 1);
+    if (gross == NULL || grade == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        free(gross);
+        free(grade);
+        recordsFree(&r);
+        return 1;
+    }
+    for (i = 0; i < r.n; i++)
+        gross[i] = grossSalary(r.score[0][i]);
+    recordGrades(gross, r.n, gradeFrom, 4, countsOnly ? NULL : grade, counts);
+    outInit(&o, stdout, 0);
+    if (!countsOnly)
+        for (i = 0; i < r.n; i++)
+        {
+            outChar(&o, gradeNames[grade[i]]);
+            outChar(&o, '\n');
+        }
+    else
+        for (g = 4; g >= 0; g--)
+        {
+            outChar(&o, gradeNames[g]);
+            outText(&o, ": ", 2);
+            outInt(&o, (long long)counts[g]);
+            outChar(&o, '\n');
+        }
+    rc = outClose(&o);
+    if (r.skipped)
+        fprintf(stderr, "%zu lines skipped\n", r.skipped);
+    free(gross);
+    free(grade);
+    recordsFree(&r);
+    return rc != 0;
+}
+
+int main(int argc, char *argv[]){
+    float BaseSalary, GrossSalary;
+
+    if (argc > 1 && strcmp(argv[1], "--bulk") == 0)
+        return bulk(argc > 2 && strcmp(argv[2], "--counts") == 0);
+
+    printf("Enter basic salary of employee\n");
+    scanf("%f", &BaseSalary);
+
+    GrossSalary = grossSalary(BaseSalary);
 
     if (GrossSalary >= 100000)
         printf("A grade employee");
@@ -25,4 +98,3 @@ int main(){
         printf("E grade employee");
     return 0;
 }
-
@@ -0,0 +1,197 @@
+// A hash index of the environment, for DisplayLinuxEnvirmentVariables.c
+// and launchers that look up many variables for every child they start.
+//
+// getenv() walks environ from the top and compares the name against each
+// entry, so a lookup costs the whole environment when the name is near the
+// end or missing. envIndexBuild() goes through environ once. For each
+// entry it finds the '=', hashes the name eight bytes at a time and puts
+// the entry in an open-addressing table with at least twice as many slots
+// as entries. A slot keeps the entry's position and 32 bits of its hash,
+// so a probe compares a name only when the hashes already agree.
+// Nothing is copied: an EnvVar is a view, a pointer and a length for the
+// name and for the value, into the strings of environ themselves. A name
+// set twice resolves to its first entry, as getenv() does.
+//
+// envLookup() is one hash and, with the table at most half full, one or
+// two probes. envLookupMany() resolves a batch: it hashes the names and
+// prefetches their slots ENV_BATCH at a time before it probes, so the
+// cache misses of a big table overlap. envWrite() and envWriteFound()
+// write the environment, or the variables a batch found, through an
+// OutBuffer, which sends it in one write().
+//
+// The views stay good while the environment does; after setenv() or
+// putenv() build the index again. envIndexBuild() returns 0, or -1 when
+// out of memory. Header-only.
+
+#ifndef ENV_INDEX_H
+#define ENV_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "OutBuffer.h"
+
+#define ENV_BATCH 16
+#define ENV_EMPTY UINT32_MAX
+
+typedef struct
+{
+    const char *name, *value;
+    size_t nameLen, valueLen;
+} EnvVar;
+
+typedef struct
+{
+    uint32_t hash, at; // at is the position in vars, or ENV_EMPTY
+} EnvSlot;
+
+typedef struct
+{
+    size_t n, mask; // mask + 1 slots
+    EnvVar *vars;   // in the order of environ
+    EnvSlot *slots;
+} EnvIndex;
+
+// The name of len bytes to 64 bits: eight bytes at a time, each word
+// mixed in by a multiply and a fold of its high half, as wyhash does
+static inline uint64_t envHash(const char *s, size_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len, w;
+    __uint128_t m;
+    for (; len >= 8; s += 8, len -= 8)
+    {
+        memcpy(&w, s, 8);
+        m = (__uint128_t)(h ^ w) * 0xA0761D6478BD642FULL;
+        h = (uint64_t)m ^ (uint64_t)(m >> 64);
+    }
+    w = 0;
+    memcpy(&w, s, len);
+    m = (__uint128_t)(h ^ w) * 0xE7037ED1A0B428DBULL;
+    return (uint64_t)m ^ (uint64_t)(m >> 64);
+}
+
+static inline void envIndexFree(EnvIndex *x)
+{
+    free(x->vars);
+    free(x->slots);
+    memset(x, 0, sizeof *x);
+}
+
+// The slot of the name, or the empty one where it would go
+static inline EnvSlot *envProbe(const EnvIndex *x, const char *name, size_t len, uint64_t h)
+{
+    size_t i = (size_t)(h >> 32) & x->mask;
+    for (;; i = (i + 1) & x->mask)
+    {
+        EnvSlot *s = &x->slots[i];
+        if (s->at == ENV_EMPTY)
+            return s;
+        if (s->hash == (uint32_t)h && x->vars[s->at].nameLen == len && memcmp(x->vars[s->at].name, name, len) == 0)
+            return s;
+    }
+}
+
+// An index of env, an environ-like array ended by NULL
+static inline int envIndexBuild(EnvIndex *x, char *const *env)
+{
+    size_t n = 0, slots = 16, i;
+    memset(x, 0, sizeof *x);
+    while (env[n] != NULL)
+        n++;
+    while (slots < 2 * n)
+        slots *= 2;
+    x->vars = (EnvVar *)malloc((n ? n : 1) * sizeof *x->vars);
+    x->slots = (EnvSlot *)malloc(slots * sizeof *x->slots);
+    if (x->vars == NULL || x->slots == NULL || n >= ENV_EMPTY)
+    {
+        envIndexFree(x);
+        return -1;
+    }
+    x->mask = slots - 1;
+    for (i = 0; i < slots; i++)
+        x->slots[i].at = ENV_EMPTY;
+    for (i = 0; i < n; i++)
+    {
+        const char *e = env[i], *eq = strchr(e, '=');
+        EnvVar *v = &x->vars[x->n];
+        EnvSlot *s;
+        uint64_t h;
+        if (eq == NULL || eq == e)
+            continue; // no name; getenv() never finds it either
+        v->name = e;
+        v->nameLen = (size_t)(eq - e);
+        v->value = eq + 1;
+        v->valueLen = strlen(eq + 1);
+        h = envHash(e, v->nameLen);
+        s = envProbe(x, e, v->nameLen, h);
+        if (s->at != ENV_EMPTY)
+            continue; // the name again: the first one stays
+        s->hash = (uint32_t)h;
+        s->at = (uint32_t)x->n++;
+    }
+    return 0;
+}
+
+// The variable called name, of len bytes, or NULL
+static inline const EnvVar *envLookup(const EnvIndex *x, const char *name, size_t len)
+{
+    const EnvSlot *s = envProbe(x, name, len, envHash(name, len));
+    return s->at != ENV_EMPTY ? &x->vars[s->at] : NULL;
+}
+
+// getenv() from the index
+static inline const char *envGet(const EnvIndex *x, const char *name)
+{
+    const EnvVar *v = envLookup(x, name, strlen(name));
+    return v != NULL ? v->value : NULL;
+}
+
+// found[i] = envLookup() of names[i] for i < n, in batches whose slots are
+// prefetched before any of them is probed
+static inline void envLookupMany(const EnvIndex *x, const char *const *names, size_t n, const EnvVar **found)
+{
+    uint64_t h[ENV_BATCH];
+    size_t len[ENV_BATCH], i, j, k;
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < ENV_BATCH ? n - i : ENV_BATCH;
+        for (j = 0; j < k; j++)
+        {
+            len[j] = strlen(names[i + j]);
+            h[j] = envHash(names[i + j], len[j]);
+            __builtin_prefetch(&x->slots[(size_t)(h[j] >> 32) & x->mask]);
+        }
+        for (j = 0; j < k; j++)
+        {
+            const EnvSlot *s = envProbe(x, names[i + j], len[j], h[j]);
+            found[i + j] = s->at != ENV_EMPTY ? &x->vars[s->at] : NULL;
+        }
+    }
+}
+
+// "NAME=VALUE\n" for every variable of x, in the order of environ, into o
+static inline void envWrite(OutBuffer *o, const EnvIndex *x)
+{
+    size_t i;
+    for (i = 0; i < x->n; i++)
+    {
+        outText(o, x->vars[i].name, x->vars[i].nameLen + 1 + x->vars[i].valueLen);
+        outChar(o, '\n');
+    }
+}
+
+// "NAME=VALUE\n" for found[0 .. n), what envLookupMany() found, skipping
+// the names it did not
+static inline void envWriteFound(OutBuffer *o, const EnvVar *const *found, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        if (found[i] != NULL)
+        {
+            outText(o, found[i]->name, found[i]->nameLen + 1 + found[i]->valueLen);
+            outChar(o, '\n');
+        }
+}
+
+#endif
@@ -0,0 +1,788 @@
+// Formulas compiled once to bytecode and evaluated over many rows, for
+// combine_calculator.c and CalcUsingSwitchCase.c.
+//
+// exprCompile() parses a formula such as "a * b + sqrt(a) - b / 2" with
+// + - * / % ^, unary minus, parentheses, numbers, the variables it is
+// given by name, the constants pi and e, and the functions sqrt, log (the
+// natural one), exp, floor, ceil, abs of one argument and min, max, pow
+// of two. ^ binds tightest and to the right, so -2^2 is -4. The parser is
+// recursive descent and emits code for a stack machine as it goes: two
+// bytes an instruction, an opcode and the index of a variable or of a
+// constant. Where an operator's operands are all constants it runs it
+// there and emits the result instead, so "x * (2 * pi)" is one multiply.
+//
+// exprEval() runs the code for one row of variables. Each instruction's
+// handler ends by jumping straight to the next one through a table of
+// label addresses (GCC's computed goto), so each opcode has an indirect
+// branch of its own to predict rather than all of them sharing the one
+// of a switch; other compilers, or EXPR_THREADED 0, get the switch.
+//
+// exprEvalColumns() takes the variables by column, of doubles, or of
+// floats with exprEvalColumnsFloat(), and runs each instruction over a
+// block of EXPR_BLOCK rows at a time, so the dispatch is paid once a
+// block instead of once a row, like the operators of a column store. A
+// variable is pushed as a pointer into its column, not copied (floats
+// are widened into a register: the work is in double either way). Each
+// instruction is a kernel over the block: + - * / min max neg abs floor
+// ceil four doubles to an AVX instruction, sqrt through sqrtArray()
+// (SquareRoot.h), log through logArray() (Logarithm.h), and with AVX2
+// and FMA e^x by interestExpVector() (Interest.h) and a^b as e^(b log a)
+// from the two of them, four at a time where the a are positive and the
+// result in range, pow() where not (gcc -O2 left the plain loops scalar,
+// as the result may be written over an operand). That a^b is within
+// about 1 + 2 |b log a| ulps of pow() rather than one, so results with ^
+// can differ from exprEval()'s in the last digits.
+// exprEvalParallel() shares the blocks out to the workers of a TaskPool.
+//
+// exprCompile() returns 0, or -1 with error and errorAt (the offset in
+// the formula) set; the column functions return -1 when out of memory
+// for their registers. Header-only; build with -lm, and with -pthread
+// for exprEvalParallel().
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Interest.h"
+#include "Logarithm.h"
+#include "SquareRoot.h"
+#include "TaskPool.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#define EXPR_MAX_CODE 256
+#define EXPR_MAX_STACK 32
+#define EXPR_MAX_VARS 64
+#define EXPR_BLOCK 1024
+#define EXPR_MAX_NESTING 200
+
+#ifndef EXPR_THREADED
+#if defined(__GNUC__)
+#define EXPR_THREADED 1
+#else
+#define EXPR_THREADED 0
+#endif
+#endif
+
+// the order of the table in exprEval()
+enum
+{
+    EXPR_CONST,
+    EXPR_VAR,
+    EXPR_NEG,
+    EXPR_SQRT,
+    EXPR_LOG,
+    EXPR_EXP,
+    EXPR_FLOOR,
+    EXPR_CEIL,
+    EXPR_ABS,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_MOD,
+    EXPR_POW,
+    EXPR_MIN,
+    EXPR_MAX,
+    EXPR_END
+};
+
+typedef struct
+{
+    uint8_t op, arg;
+} ExprInstr;
+
+typedef struct
+{
+    ExprInstr code[EXPR_MAX_CODE];
+    double consts[EXPR_MAX_CODE];
+    int ncode, nconsts, nvars;
+    int depth, maxDepth; // of the stack, while compiling and at its deepest
+    const char *error;
+    size_t errorAt;
+} ExprProgram;
+
+typedef struct
+{
+    const char *src, *p;
+    const char *const *names;
+    ExprProgram *prog;
+    int nesting; // of the parser's calls, so that "((((..." cannot overflow the C stack
+} ExprParser;
+
+static inline double exprUnary(int op, double a)
+{
+    switch (op)
+    {
+    case EXPR_NEG:
+        return -a;
+    case EXPR_SQRT:
+        return sqrt(a);
+    case EXPR_LOG:
+        return log(a);
+    case EXPR_EXP:
+        return exp(a);
+    case EXPR_FLOOR:
+        return floor(a);
+    case EXPR_CEIL:
+        return ceil(a);
+    default:
+        return fabs(a);
+    }
+}
+
+static inline double exprBinary(int op, double a, double b)
+{
+    switch (op)
+    {
+    case EXPR_ADD:
+        return a + b;
+    case EXPR_SUB:
+        return a - b;
+    case EXPR_MUL:
+        return a * b;
+    case EXPR_DIV:
+        return a / b;
+    case EXPR_MOD:
+        return fmod(a, b);
+    case EXPR_POW:
+        return pow(a, b);
+    case EXPR_MIN:
+        return b < a ? b : a;
+    default:
+        return b > a ? b : a;
+    }
+}
+
+static inline int exprFail(ExprParser *ps, const char *error)
+{
+    if (ps->prog->error == NULL)
+    {
+        ps->prog->error = error;
+        ps->prog->errorAt = (size_t)(ps->p - ps->src);
+    }
+    return -1;
+}
+
+static inline int exprEmit(ExprParser *ps, int op, int arg)
+{
+    ExprProgram *g = ps->prog;
+    if (g->ncode == EXPR_MAX_CODE - 1) // room for EXPR_END
+        return exprFail(ps, "formula too long");
+    if (op == EXPR_CONST || op == EXPR_VAR)
+        g->depth++;
+    else if (op >= EXPR_ADD)
+        g->depth--;
+    if (g->depth > EXPR_MAX_STACK)
+        return exprFail(ps, "formula nested too deeply");
+    g->maxDepth = g->depth > g->maxDepth ? g->depth : g->maxDepth;
+    g->code[g->ncode].op = (uint8_t)op;
+    g->code[g->ncode].arg = (uint8_t)arg;
+    g->ncode++;
+    return 0;
+}
+
+static inline int exprEmitConst(ExprParser *ps, double x)
+{
+    ExprProgram *g = ps->prog;
+    if (g->nconsts == EXPR_MAX_CODE)
+        return exprFail(ps, "formula too long");
+    g->consts[g->nconsts] = x;
+    return exprEmit(ps, EXPR_CONST, g->nconsts++);
+}
+
+// An operator, or its value when its operands were constants just
+// emitted, which are then the last instructions and the last constants
+static inline int exprEmitOp(ExprParser *ps, int op)
+{
+    ExprProgram *g = ps->prog;
+    int args = op >= EXPR_ADD ? 2 : 1, i;
+    double x;
+    for (i = 1; i <= args; i++)
+        if (g->ncode < i || g->code[g->ncode - i].op != EXPR_CONST)
+            return exprEmit(ps, op, 0);
+    x = args == 2 ? exprBinary(op, g->consts[g->nconsts - 2], g->consts[g->nconsts - 1])
+                  : exprUnary(op, g->consts[g->nconsts - 1]);
+    g->ncode -= args;
+    g->nconsts -= args;
+    g->depth -= args;
+    return exprEmitConst(ps, x);
+}
+
+static inline void exprSkipBlanks(ExprParser *ps)
+{
+    while (*ps->p == ' ' || *ps->p == '\t' || *ps->p == '\r' || *ps->p == '\n')
+        ps->p++;
+}
+
+static inline int exprExpression(ExprParser *ps);
+static inline int exprUnaryExpression(ExprParser *ps);
+
+static inline int exprName(ExprParser *ps, const char *name, size_t len)
+{
+    static const struct
+    {
+        const char *name;
+        int op, args;
+    } functions[] = {{"sqrt", EXPR_SQRT, 1}, {"log", EXPR_LOG, 1},   {"exp", EXPR_EXP, 1},
+                     {"floor", EXPR_FLOOR, 1}, {"ceil", EXPR_CEIL, 1}, {"abs", EXPR_ABS, 1},
+                     {"min", EXPR_MIN, 2},   {"max", EXPR_MAX, 2},   {"pow", EXPR_POW, 2}};
+    size_t f;
+    int v, i;
+    for (v = 0; v < ps->prog->nvars; v++)
+        if (strlen(ps->names[v]) == len && memcmp(ps->names[v], name, len) == 0)
+            return exprEmit(ps, EXPR_VAR, v);
+    for (f = 0; f < sizeof functions / sizeof functions[0]; f++)
+    {
+        if (strlen(functions[f].name) != len || memcmp(functions[f].name, name, len) != 0)
+            continue;
+        exprSkipBlanks(ps);
+        if (*ps->p != '(')
+            return exprFail(ps, "expected ( after a function");
+        ps->p++;
+        for (i = 0; i < functions[f].args; i++)
+        {
+            if (i > 0)
+            {
+                exprSkipBlanks(ps);
+                if (*ps->p != ',')
+                    return exprFail(ps, "expected , between arguments");
+                ps->p++;
+            }
+            if (exprExpression(ps) != 0)
+                return -1;
+        }
+        exprSkipBlanks(ps);
+        if (*ps->p != ')')
+            return exprFail(ps, "expected )");
+        ps->p++;
+        return exprEmitOp(ps, functions[f].op);
+    }
+    if (len == 2 && memcmp(name, "pi", 2) == 0)
+        return exprEmitConst(ps, 3.14159265358979323846);
+    if (len == 1 && *name == 'e')
+        return exprEmitConst(ps, 2.71828182845904523536);
+    ps->p = name;
+    return exprFail(ps, "unknown name");
+}
+
+// a number, a name, or a formula in parentheses
+static inline int exprPrimary(ExprParser *ps)
+{
+    const char *s;
+    exprSkipBlanks(ps);
+    s = ps->p;
+    if ((unsigned)(*s - '0') < 10 || *s == '.')
+    {
+        char *end;
+        double x = strtod(s, &end);
+        if (end == s)
+            return exprFail(ps, "bad number");
+        ps->p = end;
+        return exprEmitConst(ps, x);
+    }
+    if (*s == '_' || (unsigned)((*s | 32) - 'a') < 26)
+    {
+        while (*ps->p == '_' || (unsigned)((*ps->p | 32) - 'a') < 26 || (unsigned)(*ps->p - '0') < 10)
+            ps->p++;
+        return exprName(ps, s, (size_t)(ps->p - s));
+    }
+    if (*s == '(')
+    {
+        ps->p++;
+        if (exprExpression(ps) != 0)
+            return -1;
+        exprSkipBlanks(ps);
+        if (*ps->p != ')')
+            return exprFail(ps, "expected )");
+        ps->p++;
+        return 0;
+    }
+    return exprFail(ps, *s ? "expected a number, a name or (" : "formula ends too soon");
+}
+
+// primary ^ unary, to the right
+static inline int exprPower(ExprParser *ps)
+{
+    if (exprPrimary(ps) != 0)
+        return -1;
+    exprSkipBlanks(ps);
+    if (*ps->p != '^')
+        return 0;
+    ps->p++;
+    if (exprUnaryExpression(ps) != 0)
+        return -1;
+    return exprEmitOp(ps, EXPR_POW);
+}
+
+static inline int exprUnaryExpression(ExprParser *ps)
+{
+    int rc;
+    exprSkipBlanks(ps);
+    if (++ps->nesting > EXPR_MAX_NESTING)
+        return exprFail(ps, "formula nested too deeply");
+    if (*ps->p == '+')
+    {
+        ps->p++;
+        rc = exprUnaryExpression(ps);
+    }
+    else if (*ps->p == '-')
+    {
+        ps->p++;
+        rc = exprUnaryExpression(ps) != 0 ? -1 : exprEmitOp(ps, EXPR_NEG);
+    }
+    else
+        rc = exprPower(ps);
+    ps->nesting--;
+    return rc;
+}
+
+static inline int exprTerm(ExprParser *ps)
+{
+    if (exprUnaryExpression(ps) != 0)
+        return -1;
+    for (;;)
+    {
+        int op;
+        exprSkipBlanks(ps);
+        if (*ps->p == '*')
+            op = EXPR_MUL;
+        else if (*ps->p == '/')
+            op = EXPR_DIV;
+        else if (*ps->p == '%')
+            op = EXPR_MOD;
+        else
+            return 0;
+        ps->p++;
+        if (exprUnaryExpression(ps) != 0 || exprEmitOp(ps, op) != 0)
+            return -1;
+    }
+}
+
+static inline int exprExpression(ExprParser *ps)
+{
+    if (exprTerm(ps) != 0)
+        return -1;
+    for (;;)
+    {
+        int op;
+        exprSkipBlanks(ps);
+        if (*ps->p == '+')
+            op = EXPR_ADD;
+        else if (*ps->p == '-')
+            op = EXPR_SUB;
+        else
+            return 0;
+        ps->p++;
+        if (exprTerm(ps) != 0 || exprEmitOp(ps, op) != 0)
+            return -1;
+    }
+}
+
+// src into prog, with nvars variables called names[0 .. nvars)
+static inline int exprCompile(ExprProgram *prog, const char *src, const char *const *names, int nvars)
+{
+    ExprParser ps;
+    memset(prog, 0, sizeof *prog);
+    prog->nvars = nvars;
+    ps.src = ps.p = src;
+    ps.names = names;
+    ps.prog = prog;
+    ps.nesting = 0;
+    if (nvars < 0 || nvars > EXPR_MAX_VARS)
+        return exprFail(&ps, "too many variables");
+    if (exprExpression(&ps) != 0)
+        return -1;
+    exprSkipBlanks(&ps);
+    if (*ps.p != '\0')
+        return exprFail(&ps, "unexpected character");
+    prog->code[prog->ncode].op = EXPR_END;
+    prog->code[prog->ncode].arg = 0;
+    prog->ncode++;
+    return 0;
+}
+
+// The formula for one row, vars[v] the value of variable v
+static inline double exprEval(const ExprProgram *prog, const double *vars)
+{
+    double stack[EXPR_MAX_STACK + 1], *sp = stack;
+    const ExprInstr *ip = prog->code;
+    const double *consts = prog->consts;
+#if EXPR_THREADED
+    static const void *const handlers[] = {&&op_EXPR_CONST, &&op_EXPR_VAR,   &&op_EXPR_NEG,  &&op_EXPR_SQRT,
+                                           &&op_EXPR_LOG,   &&op_EXPR_EXP,   &&op_EXPR_FLOOR, &&op_EXPR_CEIL,
+                                           &&op_EXPR_ABS,   &&op_EXPR_ADD,   &&op_EXPR_SUB,  &&op_EXPR_MUL,
+                                           &&op_EXPR_DIV,   &&op_EXPR_MOD,   &&op_EXPR_POW,  &&op_EXPR_MIN,
+                                           &&op_EXPR_MAX,   &&op_EXPR_END};
+#define EXPR_CASE(op) op_##op:
+#define EXPR_NEXT goto *handlers[(++ip)->op]
+    goto *handlers[ip->op];
+#else
+#define EXPR_CASE(op) case op:
+#define EXPR_NEXT                                                              \
+    ip++;                                                                      \
+    continue
+    for (;;)
+        switch (ip->op)
+        {
+#endif
+    // sp points at the top of the stack; stack[0] is never used
+    EXPR_CASE(EXPR_CONST)
+    *++sp = consts[ip->arg];
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_VAR)
+    *++sp = vars[ip->arg];
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_NEG)
+    *sp = -*sp;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_SQRT)
+    *sp = sqrt(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_LOG)
+    *sp = log(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_EXP)
+    *sp = exp(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_FLOOR)
+    *sp = floor(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_CEIL)
+    *sp = ceil(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_ABS)
+    *sp = fabs(*sp);
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_ADD)
+    sp[-1] += *sp;
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_SUB)
+    sp[-1] -= *sp;
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_MUL)
+    sp[-1] *= *sp;
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_DIV)
+    sp[-1] /= *sp;
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_MOD)
+    sp[-1] = fmod(sp[-1], *sp);
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_POW)
+    sp[-1] = pow(sp[-1], *sp);
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_MIN)
+    sp[-1] = *sp < sp[-1] ? *sp : sp[-1];
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_MAX)
+    sp[-1] = *sp > sp[-1] ? *sp : sp[-1];
+    sp--;
+    EXPR_NEXT;
+    EXPR_CASE(EXPR_END)
+    return *sp;
+#if !EXPR_THREADED
+        }
+#endif
+#undef EXPR_CASE
+#undef EXPR_NEXT
+}
+
+// The kernels of exprEvalBlock(): r[j] = a[j] op b[j], or op b[j], for
+// j < k. r may be a or b. EXPR_LANES is the AVX loop, four at a time,
+// left out without AVX; the scalar line does the rest.
+#if defined(__AVX__)
+#define EXPR_LANES(load, vector)                                               \
+    for (; j + 4 <= k; j += 4)                                                 \
+    {                                                                          \
+        __m256d y = _mm256_loadu_pd(b + j);                                    \
+        load;                                                                  \
+        _mm256_storeu_pd(r + j, vector);                                       \
+    }
+#else
+#define EXPR_LANES(load, vector)
+#endif
+
+#define EXPR_KERNEL2(name, vector, scalar)                                     \
+    static inline void name(const double *a, const double *b, double *r,       \
+                            size_t k)                                          \
+    {                                                                          \
+        size_t j = 0;                                                          \
+        EXPR_LANES(__m256d x = _mm256_loadu_pd(a + j), vector)                 \
+        for (; j < k; j++)                                                     \
+            r[j] = scalar;                                                     \
+    }
+
+#define EXPR_KERNEL1(name, vector, scalar)                                     \
+    static inline void name(const double *b, double *r, size_t k)              \
+    {                                                                          \
+        size_t j = 0;                                                          \
+        EXPR_LANES((void)0, vector)                                            \
+        for (; j < k; j++)                                                     \
+            r[j] = scalar;                                                     \
+    }
+
+EXPR_KERNEL2(exprAddArray, _mm256_add_pd(x, y), a[j] + b[j])
+EXPR_KERNEL2(exprSubArray, _mm256_sub_pd(x, y), a[j] - b[j])
+EXPR_KERNEL2(exprMulArray, _mm256_mul_pd(x, y), a[j] * b[j])
+EXPR_KERNEL2(exprDivArray, _mm256_div_pd(x, y), a[j] / b[j])
+// vminpd and vmaxpd give their second operand unless the first is less
+// (greater), as the scalar lines do, NaNs included
+EXPR_KERNEL2(exprMinArray, _mm256_min_pd(y, x), b[j] < a[j] ? b[j] : a[j])
+EXPR_KERNEL2(exprMaxArray, _mm256_max_pd(y, x), b[j] > a[j] ? b[j] : a[j])
+EXPR_KERNEL1(exprNegArray, _mm256_xor_pd(y, _mm256_set1_pd(-0.0)), -b[j])
+EXPR_KERNEL1(exprAbsArray, _mm256_andnot_pd(_mm256_set1_pd(-0.0), y), fabs(b[j]))
+EXPR_KERNEL1(exprFloorArray, _mm256_floor_pd(y), floor(b[j]))
+EXPR_KERNEL1(exprCeilArray, _mm256_ceil_pd(y), ceil(b[j]))
+
+#undef EXPR_KERNEL1
+#undef EXPR_KERNEL2
+#undef EXPR_LANES
+
+// r[j] = e^b[j]: four at a time by interestExpVector() (Interest.h), and
+// exp() for those out of its range, so each r[j] depends on b[j] alone
+static inline void exprExpArray(const double *b, double *r, size_t k)
+{
+    size_t j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    for (; j + 4 <= k; j += 4)
+    {
+        __m256d z = _mm256_loadu_pd(b + j);
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(z, _mm256_set1_pd(-708.0), _CMP_GE_OQ),
+                                   _mm256_cmp_pd(z, _mm256_set1_pd(INTEREST_EXP_MAX), _CMP_LE_OQ));
+        double t[4];
+        int lanes = _mm256_movemask_pd(ok), l;
+        _mm256_storeu_pd(t, interestExpVector(_mm256_blendv_pd(_mm256_setzero_pd(), z, ok)));
+        for (l = 0; lanes != 15 && l < 4; l++)
+            if (!(lanes >> l & 1))
+                t[l] = exp(b[j + l]); // before r, which may be an operand, is written
+        memcpy(r + j, t, sizeof t);
+    }
+#endif
+    for (; j < k; j++)
+        r[j] = exp(b[j]);
+}
+
+// r[j] = a[j]^b[j]: e^(b log a) four at a time, with the logarithm from
+// logVector() (Logarithm.h), where a is a positive normal double and
+// b log a in the range of interestExpVector(); pow() for the rest, which
+// has the rules for negative bases, infinities and NaNs
+static inline void exprPowArray(const double *a, const double *b, double *r, size_t k)
+{
+    size_t j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    for (; j + 4 <= k; j += 4)
+    {
+        __m256d x = _mm256_loadu_pd(a + j), y = _mm256_loadu_pd(b + j), z;
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(x, _mm256_set1_pd(0x1p-1022), _CMP_GE_OQ),
+                                   _mm256_cmp_pd(x, _mm256_set1_pd(0x1.fffffffffffffp1023), _CMP_LE_OQ));
+        double t[4];
+        int lanes, l;
+        z = _mm256_mul_pd(y, logVector(_mm256_blendv_pd(_mm256_set1_pd(1.0), x, ok), LOG_E, LOG_EXACT));
+        ok = _mm256_and_pd(ok, _mm256_and_pd(_mm256_cmp_pd(z, _mm256_set1_pd(-708.0), _CMP_GE_OQ),
+                                             _mm256_cmp_pd(z, _mm256_set1_pd(INTEREST_EXP_MAX), _CMP_LE_OQ)));
+        lanes = _mm256_movemask_pd(ok);
+        _mm256_storeu_pd(t, interestExpVector(_mm256_blendv_pd(_mm256_setzero_pd(), z, ok)));
+        for (l = 0; lanes != 15 && l < 4; l++)
+            if (!(lanes >> l & 1))
+                t[l] = pow(a[j + l], b[j + l]); // before r, which may be an operand, is written
+        memcpy(r + j, t, sizeof t);
+    }
+#endif
+    for (; j < k; j++)
+        r[j] = pow(a[j], b[j]);
+}
+
+// Rows [begin, begin + k) of the formula, k at most EXPR_BLOCK, an
+// instruction at a time over all k. The variables are cols[v] or, when
+// cols is NULL, floats[v], which are widened into a register; reg holds
+// prog->maxDepth registers of EXPR_BLOCK. Returns where the result is.
+static inline const double *exprEvalBlock(const ExprProgram *prog, const double *const *cols,
+                                          const float *const *floats, size_t begin, size_t k, double *reg)
+{
+    const double *top[EXPR_MAX_STACK]; // what each slot holds, its register or a column
+    const ExprInstr *ip;
+    size_t j;
+    int sp = -1;
+    for (ip = prog->code; ip->op != EXPR_END; ip++)
+    {
+        double *r;
+        const double *a, *b;
+        int at;
+        if (ip->op == EXPR_CONST || ip->op == EXPR_VAR)
+        {
+            r = reg + (size_t)++sp * EXPR_BLOCK;
+            top[sp] = r;
+            if (ip->op == EXPR_CONST)
+                for (j = 0; j < k; j++)
+                    r[j] = prog->consts[ip->arg];
+            else if (cols != NULL)
+                top[sp] = cols[ip->arg] + begin;
+            else
+                for (j = 0; j < k; j++)
+                    r[j] = floats[ip->arg][begin + j];
+            continue;
+        }
+        // the result goes to the register of the deeper operand; either
+        // operand may be that register itself
+        at = ip->op >= EXPR_ADD ? sp - 1 : sp;
+        r = reg + (size_t)at * EXPR_BLOCK;
+        a = top[at];
+        b = top[sp];
+        switch (ip->op)
+        {
+        case EXPR_NEG:
+            exprNegArray(b, r, k);
+            break;
+        case EXPR_SQRT:
+            sqrtArray(b, r, k);
+            break;
+        case EXPR_LOG:
+            logArray(b, r, k, LOG_E, LOG_EXACT);
+            break;
+        case EXPR_EXP:
+            exprExpArray(b, r, k);
+            break;
+        case EXPR_FLOOR:
+            exprFloorArray(b, r, k);
+            break;
+        case EXPR_CEIL:
+            exprCeilArray(b, r, k);
+            break;
+        case EXPR_ABS:
+            exprAbsArray(b, r, k);
+            break;
+        case EXPR_ADD:
+            exprAddArray(a, b, r, k);
+            break;
+        case EXPR_SUB:
+            exprSubArray(a, b, r, k);
+            break;
+        case EXPR_MUL:
+            exprMulArray(a, b, r, k);
+            break;
+        case EXPR_DIV:
+            exprDivArray(a, b, r, k);
+            break;
+        case EXPR_MOD:
+            for (j = 0; j < k; j++)
+                r[j] = fmod(a[j], b[j]);
+            break;
+        case EXPR_POW:
+            exprPowArray(a, b, r, k);
+            break;
+        case EXPR_MIN:
+            exprMinArray(a, b, r, k);
+            break;
+        case EXPR_MAX:
+            exprMaxArray(a, b, r, k);
+            break;
+        }
+        sp = at;
+        top[sp] = r;
+    }
+    return top[0];
+}
+
+// Room for prog's registers, or NULL
+static inline double *exprRegisters(const ExprProgram *prog)
+{
+    size_t depth = prog->maxDepth > 0 ? (size_t)prog->maxDepth : 1;
+    return (double *)aligned_alloc(64, depth * EXPR_BLOCK * sizeof(double));
+}
+
+// out[i] = the formula for row i of the columns, for i < n; 0, or -1
+// when out of memory
+static inline int exprEvalColumns(const ExprProgram *prog, const double *const *cols, size_t n, double *out)
+{
+    double *reg = exprRegisters(prog);
+    size_t i, k;
+    if (reg == NULL)
+        return -1;
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < EXPR_BLOCK ? n - i : EXPR_BLOCK;
+        memcpy(out + i, exprEvalBlock(prog, cols, NULL, i, k, reg), k * sizeof *out);
+    }
+    free(reg);
+    return 0;
+}
+
+// exprEvalColumns() for columns of floats, worked out in double
+static inline int exprEvalColumnsFloat(const ExprProgram *prog, const float *const *cols, size_t n, float *out)
+{
+    double *reg = exprRegisters(prog);
+    size_t i, j, k;
+    if (reg == NULL)
+        return -1;
+    for (i = 0; i < n; i += k)
+    {
+        const double *r;
+        k = n - i < EXPR_BLOCK ? n - i : EXPR_BLOCK;
+        r = exprEvalBlock(prog, NULL, cols, i, k, reg);
+        for (j = 0; j < k; j++)
+            out[i + j] = (float)r[j];
+    }
+    free(reg);
+    return 0;
+}
+
+typedef struct
+{
+    const ExprProgram *prog;
+    const double *const *cols;
+    size_t n;
+    double *out;
+    _Atomic(int) failed;
+} ExprJob;
+
+// blocks [begin, end) of the rows
+static inline void exprBlocks(size_t begin, size_t end, void *arg)
+{
+    ExprJob *job = (ExprJob *)arg;
+    double *reg = exprRegisters(job->prog);
+    size_t c;
+    if (reg == NULL)
+    {
+        atomic_store(&job->failed, 1);
+        return;
+    }
+    for (c = begin; c < end; c++)
+    {
+        size_t i = c * EXPR_BLOCK, k = job->n - i < EXPR_BLOCK ? job->n - i : EXPR_BLOCK;
+        memcpy(job->out + i, exprEvalBlock(job->prog, job->cols, NULL, i, k, reg), k * sizeof *job->out);
+    }
+    free(reg);
+}
+
+// exprEvalColumns() on pool's workers, 16 blocks a task; the blocks are
+// the same as exprEvalColumns()'s, and so is the answer, to the bit
+static inline int exprEvalParallel(TaskPool *pool, const ExprProgram *prog, const double *const *cols, size_t n,
+                                   double *out)
+{
+    ExprJob job;
+    if (pool == NULL || pool->nthreads < 2)
+        return exprEvalColumns(prog, cols, n, out);
+    job.prog = prog;
+    job.cols = cols;
+    job.n = n;
+    job.out = out;
+    atomic_init(&job.failed, 0);
+    poolParallelFor(pool, 0, (n + EXPR_BLOCK - 1) / EXPR_BLOCK, 16, exprBlocks, &job);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+#endif
@@ -0,0 +1,652 @@
+// External merge sort for files of 64-bit keys bigger than memory.
+//
+//   ExternalSort [--memory MB] [--tmpdir DIR] [--fan-in K] [--direct] [--stats] IN OUT
+//   ExternalSort --random N OUT    writes N random keys, for trying it out
+//   ExternalSort --check FILE      tells whether FILE is sorted
+//
+// IN and OUT hold raw native-endian uint64_t keys ("-" for stdin or
+// stdout). Sorting takes two phases:
+//  1. IN is read in runs of MB / 3 megabytes, with several reads in
+//     flight (AsyncRead.h) so the disk keeps going while a run is copied
+//     in and with --direct past the page cache. Each run is sorted in
+//     memory with sort_u64 from SortLib.h and written to a temporary file
+//     in DIR (default /tmp). The file is unlinked at once, so nothing is
+//     left behind even if the sort is killed. Reading, sorting and
+//     writing are the stages of a pipeline (Pipeline.h), so the next run
+//     is read and the last one written while one is sorted; --stats
+//     prints what each stage did to stderr.
+//  2. The runs are merged K at a time (default 64) with a loser tree,
+//     until one pass writes all of them to OUT. Each run has a thread
+//     that reads its next large block while the merge works through the
+//     current one. A writer thread does the same for the output, so the
+//     disk stays busy while the merge compares keys.
+// The merge buffers share the same MB budget. For example, 200 GB with
+// --memory 24000 makes 26 runs and a single merge pass.
+// Build with -pthread.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "SortLib.h"
+#include "AsyncRead.h"
+#include "Pipeline.h"
+
+#define RUN_BATCHES 3 // runs in memory at once in phase 1
+
+// ---------- double-buffered block reader ----------
+
+typedef struct
+{
+    FILE *f;
+    uint64_t *buf[2];
+    size_t len[2];  // keys in each buffer; 0 once the file is done
+    int full[2];    // filled by the thread, not yet used up by the merge
+    size_t cap;     // keys per buffer
+    int cur;        // buffer the merge is reading
+    size_t pos;
+    int stop, failed;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Reader;
+
+static void *readerMain(void *arg)
+{
+    Reader *r = arg;
+    int slot = 0;
+
+    for (;;)
+    {
+        size_t n;
+
+        pthread_mutex_lock(&r->lock);
+        while (r->full[slot] && !r->stop)
+            pthread_cond_wait(&r->cond, &r->lock);
+        if (r->stop)
+        {
+            pthread_mutex_unlock(&r->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        n = fread(r->buf[slot], sizeof(uint64_t), r->cap, r->f);
+
+        pthread_mutex_lock(&r->lock);
+        if (n == 0 && ferror(r->f))
+            r->failed = 1;
+        r->len[slot] = n;
+        r->full[slot] = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        if (n == 0)
+            return NULL;
+        slot ^= 1;
+    }
+}
+
+static int readerOpen(Reader *r, FILE *f, size_t cap)
+{
+    memset(r, 0, sizeof *r);
+    r->f = f;
+    r->cap = cap;
+    r->buf[0] = malloc(cap * sizeof(uint64_t));
+    r->buf[1] = malloc(cap * sizeof(uint64_t));
+    if (r->buf[0] == NULL || r->buf[1] == NULL)
+    {
+        free(r->buf[0]);
+        free(r->buf[1]);
+        return -1;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if (pthread_create(&r->thread, NULL, readerMain, r) != 0)
+    {
+        free(r->buf[0]);
+        free(r->buf[1]);
+        return -1;
+    }
+    return 0;
+}
+
+// Waits for the current buffer; returns the keys in it, 0 at the end
+static size_t readerWait(Reader *r)
+{
+    size_t n;
+    pthread_mutex_lock(&r->lock);
+    while (!r->full[r->cur])
+        pthread_cond_wait(&r->cond, &r->lock);
+    n = r->len[r->cur];
+    pthread_mutex_unlock(&r->lock);
+    return n;
+}
+
+// Hands the used-up buffer back to the thread and moves to the other one
+static size_t readerNext(Reader *r)
+{
+    pthread_mutex_lock(&r->lock);
+    r->full[r->cur] = 0;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+    r->cur ^= 1;
+    r->pos = 0;
+    return readerWait(r);
+}
+
+static void readerClose(Reader *r)
+{
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+    free(r->buf[0]);
+    free(r->buf[1]);
+}
+
+// ---------- double-buffered block writer ----------
+
+typedef struct
+{
+    FILE *f;
+    uint64_t *buf[2];
+    size_t len[2];
+    int full[2];
+    size_t cap;
+    int cur;        // buffer the merge is filling
+    int stop, failed;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Writer;
+
+static void *writerMain(void *arg)
+{
+    Writer *w = arg;
+    int slot = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&w->lock);
+        while (!w->full[slot] && !w->stop)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (!w->full[slot])
+        {
+            pthread_mutex_unlock(&w->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&w->lock);
+
+        if (fwrite(w->buf[slot], sizeof(uint64_t), w->len[slot], w->f) != w->len[slot])
+            w->failed = 1;
+
+        pthread_mutex_lock(&w->lock);
+        w->full[slot] = 0;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        slot ^= 1;
+    }
+}
+
+static int writerOpen(Writer *w, FILE *f, size_t cap)
+{
+    memset(w, 0, sizeof *w);
+    w->f = f;
+    w->cap = cap;
+    w->buf[0] = malloc(cap * sizeof(uint64_t));
+    w->buf[1] = malloc(cap * sizeof(uint64_t));
+    if (w->buf[0] == NULL || w->buf[1] == NULL)
+    {
+        free(w->buf[0]);
+        free(w->buf[1]);
+        return -1;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    if (pthread_create(&w->thread, NULL, writerMain, w) != 0)
+    {
+        free(w->buf[0]);
+        free(w->buf[1]);
+        return -1;
+    }
+    return 0;
+}
+
+// Queues the current buffer for writing and waits until the other is free
+static void writerFlush(Writer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    if (w->len[w->cur] > 0)
+    {
+        w->full[w->cur] = 1;
+        pthread_cond_broadcast(&w->cond);
+        w->cur ^= 1;
+        while (w->full[w->cur])
+            pthread_cond_wait(&w->cond, &w->lock);
+        w->len[w->cur] = 0;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+static inline void writerPut(Writer *w, uint64_t key)
+{
+    w->buf[w->cur][w->len[w->cur]++] = key;
+    if (w->len[w->cur] == w->cap)
+        writerFlush(w);
+}
+
+// Writes what is left; returns -1 if any write failed
+static int writerClose(Writer *w)
+{
+    int failed;
+    writerFlush(w);
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    failed = w->failed || fflush(w->f) != 0;
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->buf[0]);
+    free(w->buf[1]);
+    return failed ? -1 : 0;
+}
+
+// ---------- loser tree k-way merge ----------
+
+// tree[1..k) holds the loser of the match at each inner node and tree[0]
+// the overall winner. Leaf i sits at node k + i. After the winner's run
+// moves on, only the matches on its path to the root are replayed: log k
+// comparisons per key, against the 2 log k of a binary heap.
+typedef struct
+{
+    int k;
+    int *tree;
+    uint64_t *key;  // current key of each run
+    char *done;     // run is used up; loses every match
+} LoserTree;
+
+static inline int ltLess(const LoserTree *t, int a, int b)
+{
+    if (t->done[a])
+        return 0;
+    if (t->done[b])
+        return 1;
+    return t->key[a] < t->key[b];
+}
+
+static int ltBuild(LoserTree *t, int node)
+{
+    int l, r;
+    if (node >= t->k)
+        return node - t->k;
+    l = ltBuild(t, 2 * node);
+    r = ltBuild(t, 2 * node + 1);
+    if (ltLess(t, r, l))
+    {
+        t->tree[node] = l;
+        return r;
+    }
+    t->tree[node] = r;
+    return l;
+}
+
+static inline void ltReplay(LoserTree *t, int w)
+{
+    int node;
+    for (node = (w + t->k) / 2; node > 0; node /= 2)
+    {
+        if (ltLess(t, t->tree[node], w))
+        {
+            int loser = w;
+            w = t->tree[node];
+            t->tree[node] = loser;
+        }
+    }
+    t->tree[0] = w;
+}
+
+// Merges the k sorted files in runs[] into out with buffers of cap keys
+static int mergeRuns(FILE **runs, int k, FILE *out, size_t cap)
+{
+    Reader *readers = calloc(k, sizeof *readers);
+    LoserTree t;
+    Writer w;
+    int i, opened = 0, status = 0;
+
+    t.k = k;
+    t.tree = calloc(k, sizeof *t.tree);
+    t.key = calloc(k, sizeof *t.key);
+    t.done = calloc(k, 1);
+    if (readers == NULL || t.tree == NULL || t.key == NULL || t.done == NULL ||
+        writerOpen(&w, out, cap) != 0)
+    {
+        free(readers);
+        free(t.tree);
+        free(t.key);
+        free(t.done);
+        return -1;
+    }
+
+    for (i = 0; i < k; i++, opened++)
+    {
+        rewind(runs[i]);
+        if (readerOpen(&readers[i], runs[i], cap) != 0)
+        {
+            status = -1;
+            break;
+        }
+        if (readerWait(&readers[i]) == 0)
+            t.done[i] = 1;
+        else
+            t.key[i] = readers[i].buf[0][0];
+    }
+
+    if (status == 0)
+    {
+        t.tree[0] = ltBuild(&t, 1);
+        while (!t.done[t.tree[0]])
+        {
+            int win = t.tree[0];
+            Reader *r = &readers[win];
+
+            writerPut(&w, t.key[win]);
+            if (++r->pos == r->len[r->cur] && readerNext(r) == 0)
+                t.done[win] = 1;
+            else
+                t.key[win] = r->buf[r->cur][r->pos];
+            ltReplay(&t, win);
+        }
+    }
+
+    for (i = 0; i < opened; i++)
+    {
+        if (readers[i].failed)
+            status = -1;
+        readerClose(&readers[i]);
+    }
+    if (writerClose(&w) != 0)
+        status = -1;
+    free(readers);
+    free(t.tree);
+    free(t.key);
+    free(t.done);
+    return status;
+}
+
+// ---------- the two phases ----------
+
+static FILE *tempRun(const char *dir)
+{
+    char path[4096];
+    int fd;
+    FILE *f;
+
+    snprintf(path, sizeof path, "%s/extsort-XXXXXX", dir);
+    fd = mkstemp(path);
+    if (fd < 0)
+        return NULL;
+    unlink(path);
+    f = fdopen(fd, "w+b");
+    if (f == NULL)
+        close(fd);
+    return f;
+}
+
+// Copies up to cap keys from the pieces of r into buf; what is left of
+// the last piece (*piece, *left bytes) is for the next run. Short only at
+// the end of the input, or when a read failed (then *failed is set).
+static size_t fillRun(AsyncReader *r, unsigned char **piece, size_t *left, uint64_t *buf, size_t cap,
+                      int *failed)
+{
+    size_t bytes = 0, want = cap * sizeof *buf;
+    while (bytes < want)
+    {
+        size_t take;
+        if (*left == 0)
+        {
+            ssize_t got = asyncReaderNext(r, piece);
+            if (got <= 0)
+            {
+                *failed = got < 0;
+                break;
+            }
+            *left = (size_t)got;
+        }
+        take = *left < want - bytes ? *left : want - bytes;
+        memcpy((unsigned char *)buf + bytes, *piece, take);
+        *piece += take;
+        *left -= take;
+        bytes += take;
+    }
+    return bytes / sizeof *buf;
+}
+
+// Phase 1 is a pipeline (Pipeline.h) of RUN_BATCHES run buffers: while
+// one run is being sorted the next is read in and the one before written
+// out.
+typedef struct
+{
+    AsyncReader reader;
+    unsigned char *piece;
+    size_t left;
+    FILE *out, **runs;
+    const char *dir;
+    int nruns;
+} RunMaker;
+
+static int readRun(void *ctx, PipeBatch *b, int worker)
+{
+    RunMaker *m = ctx;
+    int failed = 0;
+    size_t n = fillRun(&m->reader, &m->piece, &m->left, (uint64_t *)b->data, b->cap / sizeof(uint64_t), &failed);
+    (void)worker;
+    b->len = n * sizeof(uint64_t);
+    return failed ? -1 : n > 0;
+}
+
+static int sortRun(void *ctx, PipeBatch *b, int worker)
+{
+    (void)ctx, (void)worker;
+    sort_u64((uint64_t *)b->data, b->len / sizeof(uint64_t));
+    return 0;
+}
+
+static int writeRun(void *ctx, PipeBatch *b, int worker)
+{
+    RunMaker *m = ctx;
+    FILE **more, *f;
+    (void)worker;
+
+    // input that fits in one run needs no temporary file: the first run
+    // is short only when there is no other
+    if (b->seq == 0 && b->len < b->cap)
+    {
+        return fwrite(b->data, 1, b->len, m->out) == b->len && fflush(m->out) == 0 ? 0 : -1;
+    }
+
+    more = realloc(m->runs, (m->nruns + 1) * sizeof *m->runs);
+    if (more == NULL)
+        return -1;
+    m->runs = more;
+    f = tempRun(m->dir);
+    if (f == NULL || fwrite(b->data, 1, b->len, f) != b->len || fflush(f) != 0)
+    {
+        if (f != NULL)
+            fclose(f);
+        return -1;
+    }
+    m->runs[m->nruns++] = f;
+    return 0;
+}
+
+static int externalSort(FILE *in, FILE *out, size_t memory, const char *dir, int fanIn, int flags, int stats)
+{
+    size_t runBytes = memory / RUN_BATCHES / sizeof(uint64_t) * sizeof(uint64_t), cap;
+    size_t pieceBytes = memory / 16 < ASYNC_BUFFER ? memory / 16 : ASYNC_BUFFER;
+    RunMaker m = {0};
+    Pipeline p;
+    FILE **runs;
+    int nruns, first = 0, i, status = 0;
+
+    m.out = out;
+    m.dir = dir;
+    // the reads in flight take a quarter of the budget at most, beside it
+    if (asyncReaderOpen(&m.reader, fileno(in), pieceBytes, ASYNC_DEPTH, flags) != 0)
+        return -1;
+    if (pipeInit(&p, RUN_BATCHES, runBytes) != 0)
+    {
+        asyncReaderClose(&m.reader);
+        return -1;
+    }
+
+    // phase 1: sorted runs
+    if (pipeStage(&p, "read", readRun, &m, 1, 0) != 0 || pipeStage(&p, "sort", sortRun, &m, 1, 0) != 0 ||
+        pipeStage(&p, "write", writeRun, &m, 1, 0) != 0 || pipeRun(&p) != 0)
+        status = -1;
+    if (stats)
+        pipeReport(&p, stderr);
+    pipeFree(&p);
+    asyncReaderClose(&m.reader);
+    runs = m.runs;
+    nruns = m.nruns;
+
+    // phase 2: merge fanIn runs at a time, the last pass into out
+    while (status == 0 && nruns - first > 0)
+    {
+        int k = nruns - first < fanIn ? nruns - first : fanIn;
+        int last = k == nruns - first;
+        FILE *dst = last ? out : tempRun(dir);
+
+        // two buffers for each run and two for the output
+        cap = memory / (2 * (size_t)(k + 1) * sizeof(uint64_t));
+        if (cap < 4096)
+            cap = 4096;
+
+        if (dst == NULL || mergeRuns(runs + first, k, dst, cap) != 0)
+        {
+            status = -1;
+            if (dst != NULL && !last)
+                fclose(dst);
+            break;
+        }
+        for (i = first; i < first + k; i++)
+            fclose(runs[i]);
+        first += k;
+        if (!last)
+        {
+            FILE **more = realloc(runs, (nruns + 1) * sizeof *runs);
+            if (more == NULL)
+            {
+                fclose(dst);
+                status = -1;
+                break;
+            }
+            runs = more;
+            runs[nruns++] = dst;
+        }
+    }
+
+    for (i = first; i < nruns; i++)
+        fclose(runs[i]);
+    free(runs);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t memory = (size_t)1024 << 20;
+    const char *dir = "/tmp";
+    int fanIn = 64, i, status, flags = 0, stats = 0;
+    FILE *in, *out;
+
+    if (argc == 4 && strcmp(argv[1], "--random") == 0)
+    {
+        unsigned long long n = strtoull(argv[2], NULL, 10), j;
+        uint64_t x = 88172645463325252ULL;
+        out = strcmp(argv[3], "-") == 0 ? stdout : fopen(argv[3], "wb");
+        if (out == NULL)
+        {
+            printf("Cannot open %s\n", argv[3]);
+            return 1;
+        }
+        for (j = 0; j < n; j++)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            fwrite(&x, sizeof x, 1, out);
+        }
+        return fclose(out) == 0 ? 0 : 1;
+    }
+
+    if (argc == 3 && strcmp(argv[1], "--check") == 0)
+    {
+        uint64_t prev = 0, x;
+        unsigned long long n = 0;
+        in = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "rb");
+        if (in == NULL)
+        {
+            printf("Cannot open %s\n", argv[2]);
+            return 1;
+        }
+        while (fread(&x, sizeof x, 1, in) == 1)
+        {
+            if (n++ > 0 && x < prev)
+            {
+                printf("Not sorted at key %llu\n", n - 1);
+                return 1;
+            }
+            prev = x;
+        }
+        printf("Sorted, %llu keys\n", n);
+        return 0;
+    }
+
+    for (i = 1; i + 2 < argc; i++)
+    {
+        if (strcmp(argv[i], "--memory") == 0)
+            memory = (size_t)strtoull(argv[++i], NULL, 10) << 20;
+        else if (strcmp(argv[i], "--tmpdir") == 0)
+            dir = argv[++i];
+        else if (strcmp(argv[i], "--fan-in") == 0)
+            fanIn = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--direct") == 0)
+            flags = ASYNC_DIRECT;
+        else if (strcmp(argv[i], "--stats") == 0)
+            stats = 1;
+        else
+            break;
+    }
+    if (i + 2 != argc || memory < ((size_t)1 << 20) || fanIn < 2)
+    {
+        printf("Usage: %s [--memory MB] [--tmpdir DIR] [--fan-in K] [--direct] [--stats] IN OUT\n", argv[0]);
+        printf("       %s --random N OUT\n       %s --check FILE\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    in = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "rb");
+    out = strcmp(argv[i + 1], "-") == 0 ? stdout : fopen(argv[i + 1], "wb");
+    if (in == NULL || out == NULL)
+    {
+        printf("Cannot open %s\n", in == NULL ? argv[i] : argv[i + 1]);
+        return 1;
+    }
+
+    status = externalSort(in, out, memory, dir, fanIn, flags, stats);
+    if (in != stdin)
+        fclose(in);
+    if (out != stdout && fclose(out) != 0)
+        status = -1;
+    if (status != 0)
+    {
+        fprintf(stderr, "External sort failed (out of memory or disk space?)\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// A search index over a sorted array of ints, for BinarySearch.c and ARRAY.c.
+//
+// The keys are copied in Eytzinger order: the order of a breadth-first walk
+// of the balanced search tree over the array, so the root is keys[1] and
+// the children of keys[k] are keys[2k] and keys[2k+1]. A search goes down
+// from the root like a tree search, but with no pointers: the next index is
+// 2k + (keys[k] < x). The first levels sit together in a few cache lines
+// that stay cached, and the 16 descendants of k four levels down,
+// keys[16k .. 16k+15], are one aligned 64-byte line, so every step can
+// prefetch the line it will need four steps later. Classic binary search
+// has its first probes spread over the whole array instead, one cache line
+// and one page each.
+//
+//     EytzingerIndex e;
+//     if (eytzingerBuild(&e, sorted, n) == 0)
+//         i = eytzingerLowerBound(&e, x);    // like lower_bound on sorted
+//
+// The search returns ranks in the original array, so n must be below 2^32.
+// Header-only.
+
+#ifndef EYTZINGER_H
+#define EYTZINGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define EYTZINGER_LINE 64
+
+typedef struct
+{
+    int *keys;       // keys[1 .. n]; keys[0] starts a cache line
+    uint32_t *ranks; // ranks[k]: where keys[k] is in the sorted array
+    size_t n;
+} EytzingerIndex;
+
+static inline void eytzingerFree(EytzingerIndex *e)
+{
+    free(e->keys);
+    free(e->ranks);
+    e->keys = NULL;
+    e->ranks = NULL;
+    e->n = 0;
+}
+
+// Returns 0, or -1 when out of memory or n is too big
+static inline int eytzingerBuild(EytzingerIndex *e, const int *sorted, size_t n)
+{
+    size_t bytes = ((n + 1) * sizeof(int) + EYTZINGER_LINE - 1) / EYTZINGER_LINE * EYTZINGER_LINE;
+    size_t stack[64], depth = 0, k = 1, i = 0;
+
+    e->n = n;
+    e->keys = (int *)aligned_alloc(EYTZINGER_LINE, bytes);
+    e->ranks = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+    if (e->keys == NULL || e->ranks == NULL || (uint64_t)n >= UINT32_MAX)
+    {
+        eytzingerFree(e);
+        return -1;
+    }
+    // an inorder walk of the implicit tree meets slots in sorted order
+    while (k <= n || depth > 0)
+    {
+        while (k <= n)
+        {
+            stack[depth++] = k;
+            k = 2 * k;
+        }
+        k = stack[--depth];
+        e->keys[k] = sorted[i];
+        e->ranks[k] = (uint32_t)i;
+        i++;
+        k = 2 * k + 1;
+    }
+    return 0;
+}
+
+// The rank of the first key >= x, or n if every key is less
+static inline size_t eytzingerLowerBound(const EytzingerIndex *e, int x)
+{
+    size_t k = 1;
+
+    while (k <= e->n)
+    {
+#if defined(__GNUC__)
+        // the line of keys[16k]; just an address, it may be past the end
+        __builtin_prefetch((const void *)((uintptr_t)e->keys + 16 * sizeof(int) * k));
+#endif
+        k = 2 * k + (e->keys[k] < x);
+    }
+    // undo the right turns after the last left one, which was at the answer:
+    // shift out the trailing ones and then one more bit
+#if defined(__GNUC__)
+    k >>= __builtin_ctzll(~(unsigned long long)k) + 1;
+#else
+    while (k & 1)
+        k >>= 1;
+    k >>= 1;
+#endif
+    return k == 0 ? e->n : e->ranks[k];
+}
+
+#endif
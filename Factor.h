@@ -0,0 +1,198 @@
+// Factoring 64-bit numbers, for PrimeFactorization.c and PerfectNumber.c.
+//
+// factor64(n, &f) fills f with the distinct primes of n, smallest first,
+// and their exponents:
+//   - trial division by 2 and the odd primes below 256 with the multiply
+//     by inverse trick of Primality.h, which also gives the quotient;
+//   - isPrime64() on what is left;
+//   - Pollard's rho with Brent's cycle finding on a composite rest. The
+//     walk x -> x^2 + c runs in Montgomery form, and rather than a gcd per
+//     step the differences are multiplied together FACTOR_BATCH at a time
+//     with one gcd64() (Gcd.h) per batch. If the batch overshoots (the
+//     gcd is n) it is walked again one step at a time; if that fails too,
+//     c changes.
+// Rho finds a prime factor p in about sqrt(p) steps, and the smallest
+// factor of a composite rest is at most its square root, so no number
+// takes more than about 2^16 steps.
+//
+// factorDivisors() lists all divisors from the factorization, and
+// factorSigma() is their sum. Header-only.
+
+#ifndef FACTOR_H
+#define FACTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Gcd.h"
+#include "ModArith.h"
+#include "Primality.h"
+
+#define FACTOR_MAX_PRIMES 15 // 2 * 3 * ... * 47 is the most below 2^64
+#define FACTOR_MAX_DIVISORS 103680 // the most divisors of any 64-bit number
+#define FACTOR_BATCH 128
+#define FACTOR_TRIAL_LIMIT 256
+
+typedef struct
+{
+    uint64_t prime[FACTOR_MAX_PRIMES];
+    int exponent[FACTOR_MAX_PRIMES];
+    int count;
+} Factorization;
+
+// A nontrivial divisor of n, which is odd, composite and has no prime
+// factor below FACTOR_TRIAL_LIMIT
+static inline uint64_t pollardBrent(uint64_t n)
+{
+    Montgomery mt = montInit(n);
+    uint64_t c;
+
+    for (c = mt.one;; c = modAdd(c, mt.one, n))
+    {
+        uint64_t x, y = c, ys = c, q = mt.one, g = 1, r, k, i;
+
+        // y runs ahead; x stays at the last power of two, so the gap
+        // between them takes every length and the cycle cannot be missed
+        for (r = 1; g == 1; r *= 2)
+        {
+            x = y;
+            for (i = 0; i < r; i++)
+                y = modAdd(montMul(&mt, y, y), c, n);
+            for (k = 0; k < r && g == 1; k += FACTOR_BATCH)
+            {
+                ys = y;
+                for (i = 0; i < FACTOR_BATCH && i < r - k; i++)
+                {
+                    y = modAdd(montMul(&mt, y, y), c, n);
+                    q = montMul(&mt, q, x > y ? x - y : y - x);
+                }
+                // q is in Montgomery form, q * 2^64 mod n, which has the
+                // same gcd with the odd n
+                g = gcd64(q, n);
+            }
+        }
+        if (g == n)
+        {
+            // the batch passed over the factor, or q hit 0: redo it a step
+            // at a time from ys
+            do
+            {
+                ys = modAdd(montMul(&mt, ys, ys), c, n);
+                g = gcd64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n)
+            return g;
+    }
+}
+
+static inline void factorAdd(Factorization *f, uint64_t p, int e)
+{
+    int i, j;
+
+    for (i = 0; i < f->count; i++)
+        if (f->prime[i] == p)
+        {
+            f->exponent[i] += e;
+            return;
+        }
+    // keep the primes in order; there are few of them
+    for (j = f->count; j > 0 && f->prime[j - 1] > p; j--)
+    {
+        f->prime[j] = f->prime[j - 1];
+        f->exponent[j] = f->exponent[j - 1];
+    }
+    f->prime[j] = p;
+    f->exponent[j] = e;
+    f->count++;
+}
+
+// n odd, above 1, with no prime factor below FACTOR_TRIAL_LIMIT
+static inline void factorRest(Factorization *f, uint64_t n)
+{
+    uint64_t d;
+
+    if (n < (uint64_t)FACTOR_TRIAL_LIMIT * FACTOR_TRIAL_LIMIT || isPrime64(n))
+    {
+        factorAdd(f, n, 1);
+        return;
+    }
+    d = pollardBrent(n);
+    factorRest(f, d);
+    factorRest(f, n / d);
+}
+
+// n = 0 gives an empty factorization, like n = 1
+static inline void factor64(uint64_t n, Factorization *f)
+{
+    size_t k;
+
+    f->count = 0;
+    if (n == 0)
+        return;
+    if ((n & 1) == 0)
+    {
+        int e = __builtin_ctzll(n);
+        factorAdd(f, 2, e);
+        n >>= e;
+    }
+    // once p * p > n, what is left is 1 or a prime
+    for (k = 0; k < PRIME_DIVISORS && primeDivisors[k][0] * primeDivisors[k][0] <= n; k++)
+    {
+        int e = 0;
+        while (primeDivides(k, n))
+        {
+            n *= primeDivisors[k][1]; // exact, so this is n / p
+            e++;
+        }
+        if (e != 0)
+            factorAdd(f, primeDivisors[k][0], e);
+    }
+    if (n > 1)
+        factorRest(f, n);
+}
+
+// Writes every divisor of the factored number to out, which needs room
+// for FACTOR_MAX_DIVISORS, 1 first but otherwise not in order. Returns
+// how many there are.
+static inline size_t factorDivisors(const Factorization *f, uint64_t *out)
+{
+    size_t count = 1, i, from, end;
+    int j, e;
+
+    out[0] = 1;
+    for (j = 0; j < f->count; j++)
+    {
+        // the divisors so far times p, then the newest of those times p
+        // again, up to p^e
+        for (e = 0, from = 0; e < f->exponent[j]; e++, from = end)
+            for (i = from, end = count; i < end; i++)
+                out[count++] = out[i] * f->prime[j];
+    }
+    return count;
+}
+
+// Sets *sigma to the sum of the divisors and returns 0, or returns -1 if
+// it does not fit in 64 bits (which a number below 2^64 / 8 never
+// reaches). sigma(2^63) is 2^64 - 1, so no value can mark the overflow.
+static inline int factorSigma(const Factorization *f, uint64_t *sigma)
+{
+    int j, e;
+
+    *sigma = 1;
+    for (j = 0; j < f->count; j++)
+    {
+        // 1 + p + ... + p^e
+        uint64_t term = 1, power = 1;
+        for (e = 0; e < f->exponent[j]; e++)
+        {
+            power *= f->prime[j];
+            if (__builtin_add_overflow(term, power, &term))
+                return -1;
+        }
+        if (__builtin_mul_overflow(*sigma, term, sigma))
+            return -1;
+    }
+    return 0;
+}
+
+#endif
@@ -1,11 +1,90 @@
 #include <stdio.h>
-int main()
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Factorial.h"
+#include "Primality.h"
+
+// Run with --mod N P for N! mod the prime P, for any N up to 2^64 - 1,
+// along with N! with its factors P taken out, mod P, and how many there
+// were. --bench P times Factorial.h against the plain product for
+// (P - 1) / 2! mod P.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int parsePrime(const char *s, uint64_t *p)
+{
+    char *end;
+    *p = strtoull(s, &end, 10);
+    if (*end != '\0' || !isPrime64(*p))
+    {
+        printf("%s is not a prime\n", s);
+        return -1;
+    }
+    return 0;
+}
+
+static int modFactorial(const char *ns, const char *ps)
+{
+    uint64_t n = strtoull(ns, NULL, 10), p, r, rest, e;
+    if (parsePrime(ps, &p) != 0)
+        return 1;
+    if (factorialModPrime(n, p, &r) != 0 || factorialModPrimeFree(n, p, &rest, &e) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    printf("%llu! mod %llu = %llu\n", (unsigned long long)n, (unsigned long long)p, (unsigned long long)r);
+    printf("%llu! = %llu^%llu * %llu mod %llu\n", (unsigned long long)n, (unsigned long long)p, (unsigned long long)e,
+           (unsigned long long)rest, (unsigned long long)p);
+    return 0;
+}
+
+static int bench(const char *ps)
 {
-    int n, i;
-    unsigned long long factorial = 1;
+    uint64_t p, n, fast = 0, slow = 0;
+    double t, best = 1e30, plain;
+    int rep;
+    if (parsePrime(ps, &p) != 0)
+        return 1;
+    n = (p - 1) / 2;
+    for (rep = 0; rep < 3; rep++)
+    {
+        t = now();
+        if (factorialModPrime(n, p, &fast) != 0)
+        {
+            printf("Out of memory\n");
+            return 1;
+        }
+        if ((t = now() - t) < best)
+            best = t;
+    }
+    t = now();
+    slow = factProduct(2, n, p);
+    plain = now() - t;
+    printf("%llu! mod %llu = %llu\n", (unsigned long long)n, (unsigned long long)p, (unsigned long long)fast);
+    printf("  one factor at a time  %10.4f s\n", plain);
+    printf("  Factorial.h           %10.4f s, best of 3\n", best);
+    return fast == slow ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int n;
+    uint64_t factorial;
     //unsigned long long is the same as unsigned long long int. 
     //Its size is platform-dependent, but guaranteed by the C standard (ISO C99) to be at least 64 bits. 
 
+    if (argc > 3 && strcmp(argv[1], "--mod") == 0)
+        return modFactorial(argv[2], argv[3]);
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench(argv[2]);
+
     printf("Enter a number: ");
     scanf("%d",&n);
 
@@ -13,14 +92,12 @@ int main()
     if (n < 0)
         printf("Error! Factorial of a negative number doesn't exist.");
 
+    // and if it does not fit 64 bits, which is past 20!
+    else if (factorialU64(n, &factorial) != 0)
+        printf("Error! %d! does not fit in 64 bits; try --mod %d P.", n, n);
+
     else
-    {
-        for(i=1; i<=n; ++i)
-        {
-            factorial *= i;              // factorial = factorial*i;
-        }
-        printf("Factorial of %d = %llu", n, factorial);
-    }
+        printf("Factorial of %d = %llu", n, (unsigned long long)factorial);
 
     return 0;
 }
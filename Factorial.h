@@ -0,0 +1,224 @@
+// Factorials, for Factorial.c and RecursiveFactorial.c: exact in 64 bits
+// while they fit, and mod a prime p for any n.
+//
+// factorialU64() is the plain product, and says so when n! passes 2^64,
+// which is at 21!.
+//
+// n! mod p is 0 for n >= p, since p is one of the factors. Below p, Wilson's
+// theorem, (p - 1)! = -1 mod p, turns n! into (-1)^(n+1) / (p - 1 - n)!, so
+// n is at most p / 2 from there on. Past FACT_DIRECT, the product is not
+// taken one factor at a time but in blocks of v = ceil(sqrt(n)): with
+//
+//     g_d(x) = (v x + 1) (v x + 2) ... (v x + d),
+//
+// n! is g_v(0) g_v(1) ... g_v(n / v - 1) times the last few factors. The
+// values g_d(0 .. d) give g_2d(0 .. 2d), as g_2d(x) = g_d(x) g_d(x + d / v),
+// once g_d, a polynomial of degree d, is known at d + 1 .. 2d and at
+// d / v + 0 .. 2d. factShift() finds those by Lagrange interpolation, which
+// for evenly spaced points is one convolution (Ntt.h); g_d to g_d+1 is a
+// multiply per point. From d = 1 up the bits of v that is log v steps, the
+// last of them dominant, for O(sqrt(p) log p) in all. The shifted points
+// never meet 0 .. d mod p because v^2 stays below p; that is what the
+// reduction to n <= p / 2 is for. This needs p < 2^32, the limit of
+// nttMultiplyMod(); for larger primes the product is taken directly.
+//
+// factorialModPrimeFree() is n! with every factor p taken out, mod p, and
+// the number of them, e = n / p + n / p^2 + ... (Legendre). With
+// (p - 1)! = -1 again, it is (-1)^(n / p) (n mod p)! times the same for
+// n / p, so any n up to 2^64 - 1 costs log_p n factorials below p. This is
+// the part of a huge factorial that carries information mod p: binomials
+// and other quotients of factorials divide the p's out before they
+// reduce.
+//
+// p must be prime. Header-only; the mod p functions return 0, or -1 when
+// out of memory.
+
+#ifndef FACTORIAL_H
+#define FACTORIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ModArith.h"
+#include "Ntt.h"
+
+#define FACT_U64_MAX 20 // 20! < 2^64 < 21!
+#define FACT_DIRECT (1u << 20)
+
+static inline int factorialU64(uint64_t n, uint64_t *out)
+{
+    uint64_t f = 1, i;
+    if (n > FACT_U64_MAX)
+        return -1;
+    for (i = 2; i <= n; i++)
+        f *= i;
+    *out = f;
+    return 0;
+}
+
+// lo (lo + 1) ... hi mod p, for hi < p
+static inline uint64_t factProduct(uint64_t lo, uint64_t hi, uint64_t p)
+{
+    uint64_t f = 1 % p, i;
+    if (p & 1)
+    {
+        Montgomery mt = montInit(p);
+        f = montIn(&mt, f);
+        for (i = lo; i <= hi; i++)
+            f = montMul(&mt, f, montIn(&mt, i));
+        return montOut(&mt, f);
+    }
+    for (i = lo; i <= hi; i++)
+        f = modMul(f, i, p);
+    return f;
+}
+
+// out[k] = h(m + k) for k = 0 .. d, from h(0 .. d) of a polynomial h of
+// degree d; m + t must not be 0 mod p for |t| <= d. invFact[i] = 1/i!.
+//
+//     h(m + k) = sum over i of h(i) prod over j != i of (m + k - j) / (i - j)
+//              = P(k) sum over i of a(i) / (m + k - i),
+//
+// where a(i) = h(i) (-1)^(d - i) / (i! (d - i)!) and P(k) is the product of
+// m + k - d .. m + k. The sums are the middle of the convolution of a with
+// 1/(m - d + j), j = 0 .. 2d.
+static inline int factShift(const uint64_t *h, size_t d, uint64_t m, uint64_t p, const uint64_t *invFact, uint64_t *out)
+{
+    size_t n = 1, i;
+    uint64_t *a, *x, *inv, *c, prod;
+    while (n < 2 * d + 1)
+        n <<= 1;
+    a = (uint64_t *)malloc((3 * (2 * d + 1) + n) * sizeof *a);
+    if (a == NULL)
+        return -1;
+    x = a + (d + 1);
+    inv = x + (2 * d + 1);
+    c = inv + (2 * d + 1);
+    for (i = 0; i <= d; i++)
+    {
+        a[i] = modMul(modMul(h[i], invFact[i], p), invFact[d - i], p);
+        if ((d - i) & 1 && a[i] != 0)
+            a[i] = p - a[i];
+    }
+    for (i = 0; i <= 2 * d; i++)
+        x[i] = (m + p - d % p + i) % p;
+    if (modInverseBatch(x, inv, 2 * d + 1, p) != 0 || nttMultiplyMod(a, d + 1, inv, 2 * d + 1, c, p, n) != 0)
+    {
+        free(a);
+        return -1;
+    }
+    prod = 1;
+    for (i = 0; i <= d; i++)
+        prod = modMul(prod, x[i], p);
+    for (i = 0; i <= d; i++)
+    {
+        out[i] = modMul(c[d + i], prod, p);
+        if (i < d)
+            prod = modMul(modMul(prod, x[d + i + 1], p), inv[i], p);
+    }
+    free(a);
+    return 0;
+}
+
+// n! mod p for FACT_DIRECT <= n <= p / 2, p < 2^32, in blocks of ceil(sqrt(n))
+static inline int factorialBlocks(uint64_t n, uint64_t p, uint64_t *out)
+{
+    uint64_t v = 1, invV, f, *invFact, *g, *s, i;
+    size_t d = 1;
+    int bit, status = -1;
+    while (v * v < n)
+        v++;
+    invFact = (uint64_t *)malloc((v + 1 + 2 * (v + 2) + 3 * (v / 2 + 1)) * sizeof *invFact);
+    if (invFact == NULL)
+        return -1;
+    g = invFact + v + 1;   // g_d(0 .. 2d + 1), while it grows
+    s = g + 2 * (v + 2);   // three shifted copies of g_d(0 .. d)
+    invFact[0] = 1;
+    for (i = 1; i <= v; i++)
+        invFact[i] = modMul(invFact[i - 1], i, p);
+    invFact[v] = modInverse(invFact[v], p);
+    for (i = v; i > 1; i--)
+        invFact[i - 1] = modMul(invFact[i], i, p);
+    invV = modInverse(v, p);
+    g[0] = 1;
+    g[1] = (v + 1) % p;
+    for (bit = 62 - __builtin_clzll(v); bit >= 0; bit--)
+    {
+        uint64_t shift = modMul(d % p, invV, p); // d / v
+        uint64_t *later = s, *moved = s + d + 1, *movedLater = s + 2 * (d + 1);
+        if (factShift(g, d, d + 1, p, invFact, later) != 0 || factShift(g, d, shift, p, invFact, moved) != 0 ||
+            factShift(g, d, (shift + d + 1) % p, p, invFact, movedLater) != 0)
+            goto done;
+        for (i = 0; i <= d; i++)
+            g[i] = modMul(g[i], moved[i], p);
+        for (i = 0; i < d; i++)
+            g[d + 1 + i] = modMul(later[i], movedLater[i], p);
+        d *= 2;
+        if (v >> bit & 1)
+        {
+            for (i = 0; i <= d; i++)
+                g[i] = modMul(g[i], (v * i + d + 1) % p, p);
+            g[d + 1] = factProduct(v * (d + 1) + 1, v * (d + 1) + d + 1, p);
+            d++;
+        }
+    }
+    // g[i] = g_v(i), the product of v i + 1 .. v i + v
+    f = 1;
+    for (i = 0; (i + 1) * v <= n; i++)
+        f = modMul(f, g[i], p);
+    *out = modMul(f, factProduct(i * v + 1, n, p), p);
+    status = 0;
+done:
+    free(invFact);
+    return status;
+}
+
+// n! mod the prime p
+static inline int factorialModPrime(uint64_t n, uint64_t p, uint64_t *out)
+{
+    uint64_t f, m = n;
+    int reflect = 0;
+    if (n >= p)
+    {
+        *out = 0;
+        return 0;
+    }
+    if (p > 2 && n > p / 2) // n! = (-1)^(n+1) / (p - 1 - n)!
+    {
+        m = p - 1 - n;
+        reflect = 1;
+    }
+    if (m < FACT_DIRECT || p >= (1ULL << 32))
+        f = factProduct(2, m, p);
+    else if (factorialBlocks(m, p, &f) != 0)
+        return -1;
+    if (reflect)
+    {
+        f = modInverse(f, p);
+        if ((n & 1) == 0 && f != 0)
+            f = p - f;
+    }
+    *out = f;
+    return 0;
+}
+
+// n! / p^e mod p, and e, the power of p in n!
+static inline int factorialModPrimeFree(uint64_t n, uint64_t p, uint64_t *out, uint64_t *e)
+{
+    uint64_t f = 1 % p, part;
+    *e = 0;
+    while (n > 0)
+    {
+        if (factorialModPrime(n % p, p, &part) != 0)
+            return -1;
+        f = modMul(f, part, p);
+        if ((n / p) & 1 && f != 0)
+            f = p - f;
+        n /= p;
+        *e += n;
+    }
+    *out = f;
+    return 0;
+}
+
+#endif
@@ -1,12 +1,15 @@
 // Fahrenheit to celcius temp converter
 
 #include<stdio.h>
+#include "TempScale.h"
 int main()
 {
         float c, f;
+        TempTransform t;
+        tempTransform(TEMP_FAHRENHEIT, TEMP_CELSIUS, &t);
         printf("Enter temp in fahrenheit :\n");
         scanf("%f", &f);
-        c = (f-32)*5/9;
+        c = (float)tempApply(t, f);
         printf("Temp in celcius is : %f",c);
 
 }
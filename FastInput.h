@@ -0,0 +1,258 @@
+// Reading whitespace-separated integers in bulk, for the programs that
+// take an array on stdin (Quicksort.c, Mergesort.c, counting_sort.c,
+// Largest.c) when run with --fast-input.
+//
+// scanf("%d") goes through the locale, the format string and the FILE
+// lock for every value. Here the input is one buffer: the file itself,
+// mmap()ed, when it is a regular file (as with < file), and otherwise a
+// 1 MB block read with fread() and topped up when fewer than
+// FAST_INPUT_SLACK bytes are left, so a number never straddles two
+// reads.
+//
+// Digits are converted eight at a time. One 8-byte load is tested for
+// where the first non-digit is: a byte c is a digit when c & 0xf0 and
+// (c + 6) & 0xf0 are both 0x30, and the lowest failing byte gives the
+// count. The digits are shifted up so that any missing ones are leading
+// zeros, and three multiply-and-shift steps fold them, pairs into 2-digit
+// values, those into 4 digits and then 8. Only the last few bytes of an
+// mmap()ed file go a character at a time.
+//
+// A number is an optional sign and up to 19 digits after any leading
+// zeros. The readers return 0, or -1 at the end of input, on something
+// that is not a number, or for a value out of range for the type; the
+// array readers return how many values they read. Use one FastInput for
+// all of a program's input, not after scanf(), which may have taken some
+// of it into stdin's buffer already. The loads assume a little-endian
+// machine. Header-only.
+
+#ifndef FAST_INPUT_H
+#define FAST_INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FAST_INPUT_BLOCK (1 << 20)
+#define FAST_INPUT_SLACK 64 // more than any number, so refills come between numbers
+
+typedef struct
+{
+    const char *p, *end;
+    char *buf;   // the fread() buffer, or NULL when mapped
+    char *map;   // the mapping, or NULL
+    size_t mapLen;
+    FILE *f;
+    int eof;
+} FastInput;
+
+// Reads f from where it is now; 0, or -1 when out of memory
+static inline int fastInputOpen(FastInput *in, FILE *f)
+{
+    struct stat st;
+    int fd = fileno(f);
+    off_t at;
+    memset(in, 0, sizeof *in);
+    in->f = f;
+    at = fd < 0 ? -1 : lseek(fd, 0, SEEK_CUR);
+    if (at >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > at)
+    {
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED)
+        {
+            madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+            in->map = (char *)m;
+            in->mapLen = (size_t)st.st_size;
+            in->p = in->map + at;
+            in->end = in->map + in->mapLen;
+            in->eof = 1;
+            return 0;
+        }
+    }
+    in->buf = (char *)malloc(FAST_INPUT_BLOCK);
+    if (in->buf == NULL)
+        return -1;
+    in->p = in->end = in->buf;
+    return 0;
+}
+
+static inline void fastInputClose(FastInput *in)
+{
+    if (in->map != NULL)
+        munmap(in->map, in->mapLen);
+    free(in->buf);
+    in->map = in->buf = NULL;
+}
+
+// Moves what is left to the front of the buffer and reads after it
+static inline void fastInputFill(FastInput *in)
+{
+    size_t left = (size_t)(in->end - in->p), got;
+    memmove(in->buf, in->p, left);
+    got = fread(in->buf + left, 1, FAST_INPUT_BLOCK - left, in->f);
+    in->p = in->buf;
+    in->end = in->buf + left + got;
+    if (got == 0)
+        in->eof = 1;
+}
+
+// How many of the 8 characters in v, first in the low byte, are leading
+// digits
+static inline int fastDigitRun(uint64_t v)
+{
+    uint64_t bad = ((v & 0xf0f0f0f0f0f0f0f0ULL) ^ 0x3030303030303030ULL) |
+                   (((v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) ^ 0x3030303030303030ULL);
+    return bad == 0 ? 8 : __builtin_ctzll(bad) / 8;
+}
+
+// The 8 digits in v as a number, the first the most significant
+static inline uint32_t fastEightDigits(uint64_t v)
+{
+    v &= 0x0f0f0f0f0f0f0f0fULL;
+    v = (v * 2561) >> 8;
+    v = ((v & 0x00ff00ff00ff00ffULL) * 6553601) >> 16;
+    return (uint32_t)(((v & 0x0000ffff0000ffffULL) * 42949672960001ULL) >> 32);
+}
+
+static const uint32_t fastPowersOf10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+// *x = the next number, between lo and hi
+static inline int fastReadRange(FastInput *in, long long *x, long long lo, long long hi)
+{
+    const char *p;
+    uint64_t value = 0, limit;
+    int negative = 0, digits = 0, run;
+    for (;;)
+    {
+        while (in->p < in->end && (*in->p == ' ' || (unsigned)(*in->p - '\t') < 5))
+            in->p++;
+        if (in->end - in->p >= FAST_INPUT_SLACK || in->eof)
+            break;
+        fastInputFill(in);
+    }
+    p = in->p;
+    if (p < in->end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p == in->end || (unsigned)(*p - '0') > 9)
+        return -1;
+    while (p < in->end && *p == '0')
+        p++;
+    for (;;)
+    {
+        uint64_t v;
+        if (in->end - p < 8)
+        {
+            // the last few bytes of the input
+            for (; p < in->end && (unsigned)(*p - '0') <= 9 && digits <= 19; p++, digits++)
+                value = value * 10 + (uint64_t)(*p - '0');
+            break;
+        }
+        memcpy(&v, p, 8);
+        run = fastDigitRun(v);
+        if (run > 0)
+            value = value * fastPowersOf10[run] + fastEightDigits(v << (64 - 8 * run));
+        p += run;
+        digits += run;
+        if (run < 8 || digits > 19)
+            break;
+    }
+    in->p = p;
+    limit = negative ? 0 - (uint64_t)lo : (uint64_t)hi;
+    if (digits > 19 || value > limit)
+        return -1;
+    *x = negative ? (long long)(0 - value) : (long long)value;
+    return 0;
+}
+
+static inline int fastReadLongLong(FastInput *in, long long *x)
+{
+    return fastReadRange(in, x, LLONG_MIN, LLONG_MAX);
+}
+
+static inline int fastReadInt(FastInput *in, int *x)
+{
+    long long v;
+    if (fastReadRange(in, &v, INT_MIN, INT_MAX) != 0)
+        return -1;
+    *x = (int)v;
+    return 0;
+}
+
+// Skips count whitespace-separated words, numbers or not, without
+// converting them; returns how many there were before the end of input.
+// Eight bytes at a time: a byte is part of a word when it is above ' '
+// (for ASCII, when adding 0x5f sets its top bit), a word starts where
+// such a byte follows one that is not, and a popcount of the starts says
+// whether the word to stop after is in these eight.
+static inline size_t fastSkipWords(FastInput *in, size_t count)
+{
+    size_t skipped = 0;
+    uint64_t inWord = 0; // 0x80 when the byte before in->p is in a word
+    if (count == 0)
+        return 0;
+    // until the start of the word after them, so the last one is passed
+    // whole
+    for (;;)
+    {
+        uint64_t v, word, starts;
+        int n;
+        if (in->end - in->p < FAST_INPUT_SLACK && !in->eof)
+            fastInputFill(in);
+        if (in->end - in->p < 8)
+        {
+            // the last few bytes of the input
+            for (; in->p < in->end; in->p++)
+            {
+                uint64_t now = (unsigned char)*in->p > ' ' ? 0x80 : 0;
+                if (now && !inWord && skipped++ == count)
+                    break;
+                inWord = now;
+            }
+            if (in->p == in->end)
+                return skipped;
+            skipped--;
+            break;
+        }
+        memcpy(&v, in->p, 8);
+        word = (((v & 0x7f7f7f7f7f7f7f7fULL) + 0x5f5f5f5f5f5f5f5fULL) | v) & 0x8080808080808080ULL;
+        starts = word & ~(word << 8 | inWord);
+        n = __builtin_popcountll(starts);
+        if (skipped + n <= count)
+        {
+            skipped += n;
+            inWord = word >> 56;
+            in->p += 8;
+            continue;
+        }
+        // the word after the last one to skip starts in here
+        while (skipped++ < count)
+            starts &= starts - 1;
+        skipped--;
+        in->p += __builtin_ctzll(starts) / 8;
+        break;
+    }
+    return skipped;
+}
+
+static inline size_t fastReadInts(FastInput *in, int *a, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n && fastReadInt(in, &a[i]) == 0; i++)
+        ;
+    return i;
+}
+
+static inline size_t fastReadLongLongs(FastInput *in, long long *a, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n && fastReadLongLong(in, &a[i]) == 0; i++)
+        ;
+    return i;
+}
+
+#endif
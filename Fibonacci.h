@@ -0,0 +1,214 @@
+// Fibonacci numbers by fast doubling, for FibonacciGeneration.c and
+// last-digit-fibonacci.c.
+//
+// From F(k) and F(k + 1),
+//     F(2k)     = F(k) (2 F(k + 1) - F(k))
+//     F(2k + 1) = F(k)^2 + F(k + 1)^2
+// so reading n from the top bit down, each bit doubles k and a set bit
+// adds one more step, F(k + 2) = F(k) + F(k + 1). That is three
+// multiplies per bit of n, O(log n) in all, where the naive recursion
+// takes about F(n) calls and the loop n additions.
+//
+//   - fibMod(n, m): F(n) mod any 1 <= m < 2^63, in Montgomery form when m
+//     is odd (ModArith.h); fibPairMod() also gives F(n + 1).
+//   - fibModBatch(): many n for one m, a few at a time side by side.
+//   - fibBig(n, &f): F(n) exactly as a BigNum (BigNum.h), where the two
+//     squarings use the cheaper square path of bigMul().
+//
+// F(n) mod m repeats with the Pisano period pi(m), so n can be taken mod
+// pi(m) first. pisanoPeriod(m) gets it from the factorization of m
+// (Factor.h): pi is the lcm of pi(p^e) over the prime powers of m. For a
+// prime p, pi(p) divides p - 1 when p is 1 or 4 mod 5 and 2 (p + 1) when
+// it is 2 or 3 mod 5 (pi(2) = 3, pi(5) = 20), and pi(p^e) divides
+// p^(e-1) pi(p). From such a multiple the period is found like an order
+// in a group: divide by each of its prime factors for as long as F and
+// the next one are still 0 and 1 there.
+//
+// Header-only.
+
+#ifndef FIBONACCI_H
+#define FIBONACCI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BigNum.h"
+#include "Factor.h"
+#include "Gcd.h"
+#include "ModArith.h"
+
+// *f = F(n) mod m and *g = F(n + 1) mod m. The bit picks (F(2k), F(2k+1))
+// or (F(2k+1), F(2k+2)) by a mask rather than a branch, which would
+// mispredict on about half the bits.
+static inline void fibPairMod(uint64_t n, uint64_t m, uint64_t *f, uint64_t *g)
+{
+    uint64_t a = 0, b = 1 % m, c, d;
+    int bit;
+
+    if (m & 1 && m > 1)
+    {
+        Montgomery mt = montInit(m);
+        b = mt.one;
+        for (bit = n == 0 ? -1 : 63 - __builtin_clzll(n); bit >= 0; bit--)
+        {
+            uint64_t mask = 0 - (n >> bit & 1);
+            c = montMul(&mt, a, modSub(modAdd(b, b, m), a, m));
+            d = modAdd(montMul(&mt, a, a), montMul(&mt, b, b), m);
+            a = c ^ ((c ^ d) & mask);
+            b = d ^ ((d ^ modAdd(c, d, m)) & mask);
+        }
+        *f = montOut(&mt, a);
+        *g = montOut(&mt, b);
+        return;
+    }
+    for (bit = n == 0 ? -1 : 63 - __builtin_clzll(n); bit >= 0; bit--)
+    {
+        uint64_t mask = 0 - (n >> bit & 1);
+        c = modMul(a, modSub(modAdd(b, b, m), a, m), m);
+        d = modAdd(modMul(a, a, m), modMul(b, b, m), m);
+        a = c ^ ((c ^ d) & mask);
+        b = d ^ ((d ^ modAdd(c, d, m)) & mask);
+    }
+    *f = a;
+    *g = b;
+}
+
+// F(n) mod m for 1 <= m < 2^63
+static inline uint64_t fibMod(uint64_t n, uint64_t m)
+{
+    uint64_t f, g;
+    fibPairMod(n, m, &f, &g);
+    return f;
+}
+
+// out[i] = F(n[i]) mod m for i < count. For an odd m, MONT_LANES values
+// of n go through the bits side by side so their multiply chains overlap;
+// the lanes start together at the top bit of the largest, which is no
+// loss since a leading 0 bit leaves F(0), F(1) as it is.
+static inline void fibModBatch(const uint64_t *n, uint64_t *out, size_t count, uint64_t m)
+{
+    size_t i = 0, full = count - count % MONT_LANES;
+
+    if (m & 1 && m > 1)
+    {
+        Montgomery mt = montInit(m);
+        for (; i < full; i += MONT_LANES)
+        {
+            uint64_t a[MONT_LANES], b[MONT_LANES], all = 0;
+            int bit, l;
+            for (l = 0; l < MONT_LANES; l++)
+            {
+                a[l] = 0;
+                b[l] = mt.one;
+                all |= n[i + l];
+            }
+            for (bit = all == 0 ? -1 : 63 - __builtin_clzll(all); bit >= 0; bit--)
+                for (l = 0; l < MONT_LANES; l++)
+                {
+                    uint64_t c = montMul(&mt, a[l], modSub(modAdd(b[l], b[l], m), a[l], m));
+                    uint64_t d = modAdd(montMul(&mt, a[l], a[l]), montMul(&mt, b[l], b[l]), m);
+                    uint64_t mask = 0 - (n[i + l] >> bit & 1);
+                    a[l] = c ^ ((c ^ d) & mask);
+                    b[l] = d ^ ((d ^ modAdd(c, d, m)) & mask);
+                }
+            for (l = 0; l < MONT_LANES; l++)
+                out[i + l] = montOut(&mt, a[l]);
+        }
+    }
+    for (; i < count; i++)
+        out[i] = fibMod(n[i], m);
+}
+
+// The least t dividing the multiple of pi(m) given with F(t), F(t + 1)
+// = 0, 1 mod m
+static inline uint64_t pisanoReduce(uint64_t multiple, uint64_t m)
+{
+    Factorization f;
+    int k;
+
+    factor64(multiple, &f);
+    for (k = 0; k < f.count; k++)
+    {
+        int e;
+        for (e = 0; e < f.exponent[k]; e++)
+        {
+            uint64_t t = multiple / f.prime[k], a, b;
+            fibPairMod(t, m, &a, &b);
+            if (a != 0 || b != 1 % m)
+                break;
+            multiple = t;
+        }
+    }
+    return multiple;
+}
+
+// pi(m), the period of F(n) mod m, for 1 <= m < 2^63; 0 if it is 2^64
+// or more (pi(m) <= 6m)
+static inline uint64_t pisanoPeriod(uint64_t m)
+{
+    Factorization f;
+    uint64_t period = 1;
+    int k, e;
+
+    factor64(m, &f);
+    for (k = 0; k < f.count; k++)
+    {
+        uint64_t p = f.prime[k], pe = 1, multiple;
+        for (e = 0; e < f.exponent[k]; e++)
+            pe *= p;
+        multiple = p == 2 ? 3 : p == 5 ? 20 : p % 5 == 1 || p % 5 == 4 ? p - 1 : 2 * (p + 1);
+        if (__builtin_mul_overflow(multiple, pe / p, &multiple) ||
+            lcm64(period, pisanoReduce(multiple, pe), &period) != 0)
+            return 0;
+    }
+    return period;
+}
+
+// *f = F(n); returns 0, or -1 when out of memory
+static inline int fibBig(uint64_t n, BigNum *f)
+{
+    // a = F(k), b = F(k + 1), c and t scratch
+    BigNum a, b, c, t, swap;
+    int bit, rc = 0;
+
+    bigInit(&a);
+    bigInit(&b);
+    bigInit(&c);
+    bigInit(&t);
+    rc |= bigSetU64(&a, 0);
+    rc |= bigSetU64(&b, 1);
+    for (bit = n == 0 ? -1 : 63 - __builtin_clzll(n); bit >= 0 && rc == 0; bit--)
+    {
+        // c = F(2k) = a (2b - a), b = F(2k + 1) = a^2 + b^2
+        rc |= bigAdd(&c, &b, &b);
+        rc |= bigSub(&c, &c, &a);
+        rc |= bigMul(&c, &a, &c);
+        rc |= bigMul(&t, &a, &a);
+        rc |= bigMul(&b, &b, &b);
+        rc |= bigAdd(&b, &t, &b);
+        // a = c, and one step further for a set bit
+        swap = a;
+        a = c;
+        c = swap;
+        if (n >> bit & 1)
+        {
+            rc |= bigAdd(&c, &a, &b);
+            swap = a;
+            a = b;
+            b = c;
+            c = swap;
+        }
+    }
+    if (rc == 0)
+    {
+        swap = *f;
+        *f = a;
+        a = swap;
+    }
+    bigFree(&a);
+    bigFree(&b);
+    bigFree(&c);
+    bigFree(&t);
+    return rc;
+}
+
+#endif
@@ -1,23 +1,154 @@
-// Fibonacci Series using Recursion 
-#include <stdio.h> 
+// Fibonacci Series using fast doubling
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Fibonacci.h"
+#include "Memo.h"
 
-// fib function with argument n to generate nth Fibanocci Number
-int fib(int n) 
-{ 
-	// Base case defined
-    if (n <= 1){ 
-        return n; 
+// The nth Fibonacci number in O(log n) multiplies (Fibonacci.h) instead
+// of the fib(n - 1) + fib(n - 2) recursion, which makes about F(n) calls
+// and overflows an int past F(46).
+//
+//     FibonacciGeneration             F(11)
+//     FibonacciGeneration N           F(N), every digit
+//     FibonacciGeneration --mod M N   F(N) mod M, for M below 2^63
+//     FibonacciGeneration --batch M   F(n) mod M for each n read from stdin
+//     FibonacciGeneration --batch M --memo C
+//                                     the same, remembering the last C
+//                                     answers (Memo.h) for n that come
+//                                     up again; hits and misses go to
+//                                     stderr at the end
+//     FibonacciGeneration --bench     timings
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Reads n values until the input ends and prints F(n) mod m for each,
+// BATCH at a time through fibModBatch(). With a memo only the n it does
+// not have go to fibModBatch(), and their answers go into it.
+#define BATCH 4096
+int batch(uint64_t m, MemoCache *memo)
+{
+    static uint64_t n[BATCH], out[BATCH], miss[BATCH], got[BATCH];
+    static size_t at[BATCH];
+    unsigned long long x;
+    size_t count, misses, i;
+    int more = 1;
+    while (more)
+    {
+        for (count = 0; count < BATCH && (more = scanf("%llu", &x) == 1); count++)
+            n[count] = x;
+        if (memo == NULL)
+        {
+            fibModBatch(n, out, count, m);
+        }
+        else
+        {
+            for (i = 0, misses = 0; i < count; i++)
+            {
+                if (!memoGet(memo, n[i], m, &out[i]))
+                {
+                    at[misses] = i;
+                    miss[misses++] = n[i];
+                }
+            }
+            fibModBatch(miss, got, misses, m);
+            for (i = 0; i < misses; i++)
+            {
+                out[at[i]] = got[i];
+                memoPut(memo, miss[i], m, got[i]);
+            }
+        }
+        for (i = 0; i < count; i++)
+            printf("%llu\n", (unsigned long long)out[i]);
     }
+    return 0;
+}
 
-    // Recursive Calls to fib function
-    return fib(n - 1) + fib(n - 2); 
-} 
-  
-int main() 
-{ 
-	// Sample input
-    int n = 11; 
+int bench()
+{
+    static uint64_t n[1000000], out[1000000];
+    uint64_t p = 1000000007, seed = 88172645463325252ULL, sum = 0;
+    BigNum f;
+    double t0;
+    size_t i;
+    t0 = now();
+    sum = fibMod(1000000000, p);
+    printf("F(1e9) mod 1e9+7 = %llu, %.2f us\n", (unsigned long long)sum, (now() - t0) * 1e6);
+    for (i = 0; i < 1000000; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        n[i] = seed;
+    }
+    t0 = now();
+    fibModBatch(n, out, 1000000, p);
+    for (i = 0, sum = 0; i < 1000000; i++)
+        sum += out[i];
+    printf("1e6 random 64-bit n mod 1e9+7: %.1f ns each (%llu)\n", (now() - t0) * 1e3, (unsigned long long)sum);
+    bigInit(&f);
+    t0 = now();
+    if (fibBig(10000000, &f) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    printf("F(1e7) exactly: %zu digits, %.3f s\n", bigDigits(&f), now() - t0);
+    bigFree(&f);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // Sample input
+    unsigned long long n = 11;
+    BigNum f;
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench();
+    if (argc > 2 && (strcmp(argv[1], "--batch") == 0 || (argc > 3 && strcmp(argv[1], "--mod") == 0)))
+    {
+        uint64_t m = strtoull(argv[2], NULL, 10);
+        if (m == 0 || m >= 1ULL << 63)
+        {
+            printf("The modulus must be between 1 and 2^63 - 1\n");
+            return 1;
+        }
+        if (strcmp(argv[1], "--batch") == 0 && argc > 4 && strcmp(argv[3], "--memo") == 0)
+        {
+            MemoCache memo;
+            int status;
+            if (memoInit(&memo, strtoull(argv[4], NULL, 10)) != 0)
+            {
+                printf("Out of memory\n");
+                return 1;
+            }
+            status = batch(m, &memo);
+            memoReport(&memo, stderr);
+            memoFree(&memo);
+            return status;
+        }
+        if (strcmp(argv[1], "--batch") == 0)
+            return batch(m, NULL);
+        printf("%llu\n", (unsigned long long)fibMod(strtoull(argv[3], NULL, 10), m));
+        return 0;
+    }
+    if (argc > 1)
+        n = strtoull(argv[1], NULL, 10);
 
     // Printing the nth Fibanocci Number
-    printf("%d", fib(n));
-} 
\ No newline at end of file
+    bigInit(&f);
+    if (fibBig(n, &f) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    bigPrint(stdout, &f);
+    bigFree(&f);
+    return 0;
+}
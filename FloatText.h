@@ -0,0 +1,87 @@
+// Doubles to and from decimal text in bulk, for the programs that stream
+// columns of numbers (AllTempScalesConv.c, Log_Conversion.c).
+//
+// parseDouble() takes a plain decimal of up to 15 digits, with a sign
+// and a point, as an exact integer and one division by a power of ten,
+// which is correctly rounded; anything else, exponents, more digits,
+// inf and nan, goes to strtod(). outFixed() writes x with a fixed number
+// of decimals into an OutBuffer: while x 10^decimals is well inside the
+// integers a double holds exactly it is rounded to one and written with
+// IntText.h, otherwise, and for infinities and NaN, snprintf() does it.
+// Header-only.
+
+#ifndef FLOAT_TEXT_H
+#define FLOAT_TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "OutBuffer.h"
+
+static const double floatPow10[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// [s, end) as a number, all of it; 0, or -1 when it is not one. Up to 15
+// digits the digits are an exact integer m and there are k < 23 after
+// the point, so m / 10^k is one correctly rounded division.
+static inline int parseDouble(const char *s, const char *end, double *x)
+{
+    const char *p = s;
+    uint64_t m = 0;
+    int digits = 0, frac = 0, neg = 0;
+    char tmp[64], *stop;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    for (; p < end && (unsigned)(*p - '0') < 10; p++, digits++)
+        m = m * 10 + (unsigned)(*p - '0');
+    if (p < end && *p == '.')
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++, digits++, frac++)
+            m = m * 10 + (unsigned)(*p - '0');
+    if (p == end && digits > 0 && digits <= 15)
+    {
+        *x = (double)m / floatPow10[frac];
+        if (neg)
+            *x = -*x;
+        return 0;
+    }
+    if (end - s == 0 || (size_t)(end - s) >= sizeof tmp)
+        return -1;
+    memcpy(tmp, s, (size_t)(end - s));
+    tmp[end - s] = '\0';
+    *x = strtod(tmp, &stop);
+    return stop == tmp + (end - s) ? 0 : -1;
+}
+
+// x with decimals (at most 9) digits after the point, as printf("%.*f")
+// but with ties rounded away from zero
+static inline void outFixed(OutBuffer *o, double x, int decimals)
+{
+    double y = x * floatPow10[decimals];
+    char tmp[512];
+    if (y > -9e15 && y < 9e15)
+    {
+        int64_t r = (int64_t)(y < 0 ? y - 0.5 : y + 0.5);
+        uint64_t u = r < 0 ? (uint64_t)-r : (uint64_t)r, p = (uint64_t)floatPow10[decimals];
+        size_t n = 0;
+        int i;
+        // printf() keeps the sign of what rounds to 0
+        if (x < 0)
+            tmp[n++] = '-';
+        n += u64ToDec(u / p, tmp + n);
+        if (decimals > 0)
+        {
+            uint64_t f = u % p;
+            tmp[n++] = '.';
+            for (i = decimals - 1; i >= 0; i--, f /= 10)
+                tmp[n + i] = (char)('0' + f % 10);
+            n += decimals;
+        }
+        outText(o, tmp, n);
+        return;
+    }
+    outText(o, tmp, (size_t)snprintf(tmp, sizeof tmp, "%.*f", decimals, x));
+}
+
+#endif
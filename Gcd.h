@@ -0,0 +1,159 @@
+// Greatest common divisor and least common multiple of unsigned integers,
+// for gcd.c, lcm.c and Factor.h.
+//
+// gcd64() is Stein's binary gcd: strip the common factors of two with one
+// count-trailing-zeros, then repeatedly replace the larger odd number by
+// the difference with its twos shifted out. That is a subtract, a compare
+// and a shift per step where Euclid divides, and a 64-bit divide costs
+// as much as a few dozen of those. gcd128() is the same on unsigned
+// __int128, dropping to gcd64() once both values fit in 64 bits.
+//
+// lcm64() divides before it multiplies, a / gcd(a, b) * b, and reports
+// when the result does not fit instead of wrapping around. gcdArray() and
+// lcmArray() fold a whole array.
+//
+// gcdBatch() takes many independent pairs. GCD_LANES pairs go through the
+// steps together, each step branch-free, so the lanes' dependency chains overlap instead of one pair's
+// unpredictable branches stalling the next. Header-only.
+
+#ifndef GCD_H
+#define GCD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GCD_LANES 4
+
+static inline uint64_t gcd64(uint64_t a, uint64_t b)
+{
+    int shift;
+
+    if (a == 0)
+        return b;
+    if (b == 0)
+        return a;
+    shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    b >>= __builtin_ctzll(b);
+    // both odd from here on, so their difference is even and nonzero
+    // until they meet
+    while (a != b)
+    {
+        // min and |a - b| from one subtraction and its sign as a mask, so
+        // no compiler turns them into a branch; a - b and b - a have the
+        // same trailing zeros, so the count does not wait for the mask
+        uint64_t t = a - b, mask = 0 - (uint64_t)(a < b);
+        int z = __builtin_ctzll(t);
+        a = b + (t & mask);
+        b = ((t ^ mask) - mask) >> z;
+    }
+    return a << shift;
+}
+
+#if defined(__SIZEOF_INT128__)
+static inline int ctz128(unsigned __int128 x)
+{
+    uint64_t low = (uint64_t)x;
+    return low != 0 ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(x >> 64));
+}
+
+static inline unsigned __int128 gcd128(unsigned __int128 a, unsigned __int128 b)
+{
+    int shift;
+
+    if (a == 0)
+        return b;
+    if (b == 0)
+        return a;
+    shift = ctz128(a | b);
+    a >>= ctz128(a);
+    b >>= ctz128(b);
+    while ((a | b) >> 64 != 0)
+    {
+        unsigned __int128 d = a > b ? a - b : b - a;
+        if (d == 0)
+            return a << shift;
+        a = a < b ? a : b;
+        b = d >> ctz128(d);
+    }
+    return (unsigned __int128)gcd64((uint64_t)a, (uint64_t)b) << shift;
+}
+#endif
+
+// Returns 0 and the lcm in *out, or -1 if it is above 2^64 - 1. The lcm
+// with 0 is 0.
+static inline int lcm64(uint64_t a, uint64_t b, uint64_t *out)
+{
+    if (a == 0 || b == 0)
+    {
+        *out = 0;
+        return 0;
+    }
+    return __builtin_mul_overflow(a / gcd64(a, b), b, out) ? -1 : 0;
+}
+
+// gcd of n values (0 for none); stops early once it reaches 1
+static inline uint64_t gcdArray(const uint64_t *a, size_t n)
+{
+    uint64_t g = 0;
+    size_t i;
+
+    for (i = 0; i < n && g != 1; i++)
+        g = gcd64(g, a[i]);
+    return g;
+}
+
+// Returns 0 and the lcm of n values (1 for none) in *out, or -1 on overflow
+static inline int lcmArray(const uint64_t *a, size_t n, uint64_t *out)
+{
+    uint64_t l = 1;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        if (lcm64(l, a[i], &l) != 0)
+            return -1;
+    *out = l;
+    return 0;
+}
+
+// out[i] = gcd(a[i], b[i]) for i < n
+static inline void gcdBatch(const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n)
+{
+    size_t i, full = n - n % GCD_LANES;
+
+    for (i = 0; i < full; i += GCD_LANES)
+    {
+        uint64_t x[GCD_LANES], y[GCD_LANES], busy;
+        int shift[GCD_LANES], l;
+
+        for (l = 0; l < GCD_LANES; l++)
+        {
+            uint64_t u = a[i + l], v = b[i + l];
+            // a zero makes the gcd the other value; run such a lane as
+            // gcd(1, 1) and patch it afterwards
+            uint64_t su = u == 0 || v == 0 ? 1 : u, sv = u == 0 || v == 0 ? 1 : v;
+            shift[l] = __builtin_ctzll(su | sv);
+            x[l] = su >> __builtin_ctzll(su);
+            y[l] = sv >> __builtin_ctzll(sv);
+        }
+        // a finished lane has x == y and the step leaves it so
+        do
+        {
+            busy = 0;
+            for (l = 0; l < GCD_LANES; l++)
+            {
+                uint64_t t = x[l] - y[l], mask = 0 - (uint64_t)(x[l] < y[l]);
+                int z = __builtin_ctzll(t | 1ULL << 63);
+                x[l] = y[l] + (t & mask);
+                y[l] = t == 0 ? x[l] : ((t ^ mask) - mask) >> z;
+                busy |= t;
+            }
+        } while (busy != 0);
+        for (l = 0; l < GCD_LANES; l++)
+            out[i + l] = a[i + l] == 0 || b[i + l] == 0 ? a[i + l] | b[i + l] : x[l] << shift[l];
+    }
+    for (; i < n; i++)
+        out[i] = gcd64(a[i], b[i]);
+}
+
+#endif
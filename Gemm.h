@@ -0,0 +1,318 @@
+// Dense matrix multiply, C = A B, for float, double and int32, with the
+// matrices row-major and rows lda, ldb, ldc elements apart (a Matrix from
+// Matrix.h is data and stride; the int one can go to gemm_matrix()):
+//
+//   int gemm_<suffix>(TaskPool *pool, size_t m, size_t n, size_t k,
+//                     const type *a, size_t lda, const type *b, size_t ldb,
+//                     type *c, size_t ldc)
+//       C (m x n) = A (m x k) B (k x n); 0, or -1 when out of memory
+//
+// for suffix f32, f64 and i32 (which wraps around on overflow, as
+// unsigned arithmetic does).
+//
+// The triple loop reads a column of B for every element of C, and does
+// one multiply-add per value loaded. Here, as in BLIS and GotoBLAS:
+//
+//   - B is copied GEMM_KC rows x GEMM_NC columns at a time into a packed
+//     panel, NR columns at a time side by side, so the kernel reads it
+//     as one stream; the panel stays in the last-level cache.
+//   - A is copied GEMM_MC rows x GEMM_KC at a time, MR rows side by side,
+//     a block that stays in L2.
+//   - The micro-kernel keeps an MR x NR tile of C in registers over the
+//     GEMM_KC steps: each step loads NR values of B and MR of A and does
+//     MR x NR multiply-adds. With AVX2 and FMA that is 6 x 16 for float
+//     and int32 and 6 x 8 for double, 12 ymm accumulators; otherwise a
+//     4 x 8 loop the compiler vectorizes as best it can.
+//
+// The packed copies are padded with zeros to whole MR and NR, so the
+// kernel never deals with edges; tiles that stick out of C go through a
+// tile on the stack. The GEMM_MC blocks of rows of C are independent and
+// go to pool's workers (pool may be NULL), each packing its own A block.
+// Header-only; build with -pthread.
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Matrix.h"
+#include "TaskPool.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define GEMM_MC 72
+#define GEMM_KC 256
+#define GEMM_NC 4080
+#define GEMM_ALIGN 64
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define GEMM_FMA 1
+#else
+#define GEMM_FMA 0
+#endif
+
+// A plain micro-kernel, for the types without one for this target
+#define GEMM_GENERIC_KERNEL(suffix, type, acc, MR, NR)                         \
+                                                                               \
+/* The MR x NR tile at c (rows ldc apart) = or += (with first 0) packed   */   \
+/* a (MR rows side by side) times packed b (NR columns side by side)      */   \
+static inline void gemm_generic_kernel_##suffix(size_t k, const type *a,       \
+                                                 const type *b, type *c,       \
+                                                 size_t ldc, int first)        \
+{                                                                              \
+    acc t[MR][NR];                                                             \
+    size_t p, i, j;                                                            \
+    for (i = 0; i < MR; i++)                                                   \
+        for (j = 0; j < NR; j++)                                               \
+            t[i][j] = 0;                                                       \
+    for (p = 0; p < k; p++, a += MR, b += NR)                                  \
+        for (i = 0; i < MR; i++)                                               \
+            for (j = 0; j < NR; j++)                                           \
+                t[i][j] += (acc)a[i] * (acc)b[j];                              \
+    for (i = 0; i < MR; i++)                                                   \
+        for (j = 0; j < NR; j++)                                               \
+            c[i * ldc + j] = first ? (type)t[i][j]                             \
+                                   : (type)((acc)c[i * ldc + j] + t[i][j]);    \
+}
+
+// The packing and blocking around kernel, an MR x NR micro-kernel
+#define GEMM_DEFINE(suffix, type, acc, MR, NR, kernel)                         \
+                                                                               \
+typedef struct                                                                 \
+{                                                                              \
+    size_t m, kc, nc, lda, ldc;                                                \
+    const type *a; /* at column pc */                                          \
+    const type *packedB;                                                       \
+    type *c;       /* at column jc */                                          \
+    type **packedA; /* one per worker */                                       \
+    int first;                                                                 \
+} GemmJob_##suffix;                                                            \
+                                                                               \
+/* mc x kc of a into MR-row slivers, zero-padded to whole slivers */           \
+static inline void gemm_pack_a_##suffix(const type *a, size_t lda, size_t mc,  \
+                                        size_t kc, type *out)                  \
+{                                                                              \
+    size_t i0, p, r;                                                           \
+    for (i0 = 0; i0 < mc; i0 += MR)                                            \
+        for (p = 0; p < kc; p++)                                               \
+            for (r = 0; r < MR; r++)                                           \
+                *out++ = i0 + r < mc ? a[(i0 + r) * lda + p] : (type)0;        \
+}                                                                              \
+                                                                               \
+/* kc x nc of b into NR-column slivers, zero-padded the same way */            \
+static inline void gemm_pack_b_##suffix(const type *b, size_t ldb, size_t kc,  \
+                                        size_t nc, type *out)                  \
+{                                                                              \
+    size_t j0, p, r;                                                           \
+    for (j0 = 0; j0 < nc; j0 += NR)                                            \
+        for (p = 0; p < kc; p++)                                               \
+            for (r = 0; r < NR; r++)                                           \
+                *out++ = j0 + r < nc ? b[p * ldb + j0 + r] : (type)0;          \
+}                                                                              \
+                                                                               \
+/* Blocks begin .. end of GEMM_MC rows of C against the packed panel */        \
+static inline void gemm_blocks_##suffix(size_t begin, size_t end, void *arg)   \
+{                                                                              \
+    GemmJob_##suffix *job = (GemmJob_##suffix *)arg;                           \
+    type *pa = job->packedA[poolWorkerId()];                                   \
+    size_t blk;                                                                \
+    for (blk = begin; blk < end; blk++)                                        \
+    {                                                                          \
+        size_t ic = blk * GEMM_MC, ir, jr;                                     \
+        size_t mc = job->m - ic < GEMM_MC ? job->m - ic : GEMM_MC;             \
+        gemm_pack_a_##suffix(job->a + ic * job->lda, job->lda, mc, job->kc, pa);\
+        for (jr = 0; jr < job->nc; jr += NR)                                   \
+            for (ir = 0; ir < mc; ir += MR)                                    \
+            {                                                                  \
+                const type *sa = pa + ir * job->kc;                            \
+                const type *sb = job->packedB + jr * job->kc;                  \
+                type *c = job->c + (ic + ir) * job->ldc + jr;                  \
+                if (ir + MR <= mc && jr + NR <= job->nc)                       \
+                    kernel(job->kc, sa, sb, c, job->ldc, job->first);          \
+                else                                                           \
+                {                                                              \
+                    /* the bottom or right edge of C */                        \
+                    type t[MR * NR];                                           \
+                    size_t rows = mc - ir < MR ? mc - ir : MR;                 \
+                    size_t cols = job->nc - jr < NR ? job->nc - jr : NR, i, j; \
+                    kernel(job->kc, sa, sb, t, NR, 1);                         \
+                    for (i = 0; i < rows; i++)                                 \
+                        for (j = 0; j < cols; j++)                             \
+                            c[i * job->ldc + j] =                              \
+                                job->first ? t[i * NR + j]                     \
+                                           : (type)((acc)c[i * job->ldc + j] + \
+                                                    (acc)t[i * NR + j]);       \
+                }                                                              \
+            }                                                                  \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline int gemm_##suffix(TaskPool *pool, size_t m, size_t n, size_t k,  \
+                                const type *a, size_t lda, const type *b,      \
+                                size_t ldb, type *c, size_t ldc)               \
+{                                                                              \
+    GemmJob_##suffix job;                                                      \
+    int workers = pool != NULL ? pool->nthreads : 1, w, rc = 0;                \
+    size_t jc, pc, i, blocks = (m + GEMM_MC - 1) / GEMM_MC;                    \
+    size_t bBytes = GEMM_KC * ((GEMM_NC + NR - 1) / NR * NR) * sizeof(type);   \
+    size_t aBytes = ((GEMM_MC + MR - 1) / MR * MR) * GEMM_KC * sizeof(type);   \
+    type *packedB = (type *)aligned_alloc(GEMM_ALIGN, bBytes);                 \
+    type **packedA = (type **)calloc(workers, sizeof *packedA);                \
+    if (k == 0)                                                                \
+        for (i = 0; i < m; i++)                                                \
+            memset(c + i * ldc, 0, n * sizeof(type));                          \
+    for (w = 0; w < workers && packedA != NULL; w++)                           \
+        if ((packedA[w] = (type *)aligned_alloc(GEMM_ALIGN, aBytes)) == NULL)  \
+            rc = -1;                                                           \
+    if (packedB == NULL || packedA == NULL)                                    \
+        rc = -1;                                                               \
+    job.m = m;                                                                 \
+    job.lda = lda;                                                             \
+    job.ldc = ldc;                                                             \
+    job.packedB = packedB;                                                     \
+    job.packedA = packedA;                                                     \
+    for (jc = 0; jc < n && rc == 0; jc += GEMM_NC)                             \
+        for (pc = 0; pc < k; pc += GEMM_KC)                                    \
+        {                                                                      \
+            job.nc = n - jc < GEMM_NC ? n - jc : GEMM_NC;                      \
+            job.kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;                      \
+            job.a = a + pc;                                                    \
+            job.c = c + jc;                                                    \
+            job.first = pc == 0;                                               \
+            gemm_pack_b_##suffix(b + pc * ldb + jc, ldb, job.kc, job.nc, packedB);\
+            if (pool != NULL && blocks > 1)                                    \
+                poolParallelFor(pool, 0, blocks, 1, gemm_blocks_##suffix, &job);\
+            else                                                               \
+                gemm_blocks_##suffix(0, blocks, &job);                         \
+        }                                                                      \
+    for (w = 0; w < workers && packedA != NULL; w++)                           \
+        free(packedA[w]);                                                      \
+    free(packedA);                                                             \
+    free(packedB);                                                             \
+    return rc;                                                                 \
+}
+#if GEMM_FMA
+// One step of a row of the tile: the row's value of A times the NR values
+// of B, into the row's accumulators
+#define GEMM_ROW_F32(i)                                                        \
+    {                                                                          \
+        __m256 x = _mm256_broadcast_ss(a + i);                                 \
+        c##i##0 = _mm256_fmadd_ps(x, b0, c##i##0);                             \
+        c##i##1 = _mm256_fmadd_ps(x, b1, c##i##1);                             \
+    }
+#define GEMM_STORE_F32(i)                                                      \
+    if (!first)                                                                \
+    {                                                                          \
+        c##i##0 = _mm256_add_ps(c##i##0, _mm256_loadu_ps(c + i * ldc));        \
+        c##i##1 = _mm256_add_ps(c##i##1, _mm256_loadu_ps(c + i * ldc + 8));    \
+    }                                                                          \
+    _mm256_storeu_ps(c + i * ldc, c##i##0);                                    \
+    _mm256_storeu_ps(c + i * ldc + 8, c##i##1);
+
+static inline void gemm_kernel_f32(size_t k, const float *a, const float *b, float *c, size_t ldc, int first)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+    __m256 c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    size_t p;
+    for (p = 0; p < k; p++, a += 6, b += 16)
+    {
+        __m256 b0 = _mm256_load_ps(b), b1 = _mm256_load_ps(b + 8);
+        GEMM_ROW_F32(0) GEMM_ROW_F32(1) GEMM_ROW_F32(2)
+        GEMM_ROW_F32(3) GEMM_ROW_F32(4) GEMM_ROW_F32(5)
+    }
+    GEMM_STORE_F32(0) GEMM_STORE_F32(1) GEMM_STORE_F32(2)
+    GEMM_STORE_F32(3) GEMM_STORE_F32(4) GEMM_STORE_F32(5)
+}
+
+#define GEMM_ROW_F64(i)                                                        \
+    {                                                                          \
+        __m256d x = _mm256_broadcast_sd(a + i);                                \
+        c##i##0 = _mm256_fmadd_pd(x, b0, c##i##0);                             \
+        c##i##1 = _mm256_fmadd_pd(x, b1, c##i##1);                             \
+    }
+#define GEMM_STORE_F64(i)                                                      \
+    if (!first)                                                                \
+    {                                                                          \
+        c##i##0 = _mm256_add_pd(c##i##0, _mm256_loadu_pd(c + i * ldc));        \
+        c##i##1 = _mm256_add_pd(c##i##1, _mm256_loadu_pd(c + i * ldc + 4));    \
+    }                                                                          \
+    _mm256_storeu_pd(c + i * ldc, c##i##0);                                    \
+    _mm256_storeu_pd(c + i * ldc + 4, c##i##1);
+
+static inline void gemm_kernel_f64(size_t k, const double *a, const double *b, double *c, size_t ldc, int first)
+{
+    __m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+    __m256d c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    size_t p;
+    for (p = 0; p < k; p++, a += 6, b += 8)
+    {
+        __m256d b0 = _mm256_load_pd(b), b1 = _mm256_load_pd(b + 4);
+        GEMM_ROW_F64(0) GEMM_ROW_F64(1) GEMM_ROW_F64(2)
+        GEMM_ROW_F64(3) GEMM_ROW_F64(4) GEMM_ROW_F64(5)
+    }
+    GEMM_STORE_F64(0) GEMM_STORE_F64(1) GEMM_STORE_F64(2)
+    GEMM_STORE_F64(3) GEMM_STORE_F64(4) GEMM_STORE_F64(5)
+}
+
+GEMM_DEFINE(f32, float, float, 6, 16, gemm_kernel_f32)
+GEMM_DEFINE(f64, double, double, 6, 8, gemm_kernel_f64)
+#else
+GEMM_GENERIC_KERNEL(f32, float, float, 4, 8)
+GEMM_GENERIC_KERNEL(f64, double, double, 4, 8)
+GEMM_DEFINE(f32, float, float, 4, 8, gemm_generic_kernel_f32)
+GEMM_DEFINE(f64, double, double, 4, 8, gemm_generic_kernel_f64)
+#endif
+
+#if defined(__AVX2__)
+// No FMA for integers: a multiply keeping the low 32 bits, then an add
+#define GEMM_ROW_I32(i)                                                        \
+    {                                                                          \
+        __m256i x = _mm256_set1_epi32(a[i]);                                   \
+        c##i##0 = _mm256_add_epi32(c##i##0, _mm256_mullo_epi32(x, b0));        \
+        c##i##1 = _mm256_add_epi32(c##i##1, _mm256_mullo_epi32(x, b1));        \
+    }
+#define GEMM_STORE_I32(i)                                                      \
+    if (!first)                                                                \
+    {                                                                          \
+        c##i##0 = _mm256_add_epi32(c##i##0,                                    \
+                                   _mm256_loadu_si256((__m256i *)(c + i * ldc))); \
+        c##i##1 = _mm256_add_epi32(c##i##1,                                    \
+                                   _mm256_loadu_si256((__m256i *)(c + i * ldc + 8))); \
+    }                                                                          \
+    _mm256_storeu_si256((__m256i *)(c + i * ldc), c##i##0);                    \
+    _mm256_storeu_si256((__m256i *)(c + i * ldc + 8), c##i##1);
+
+static inline void gemm_kernel_i32(size_t k, const int32_t *a, const int32_t *b, int32_t *c, size_t ldc, int first)
+{
+    __m256i c00 = _mm256_setzero_si256(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+    __m256i c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    size_t p;
+    for (p = 0; p < k; p++, a += 6, b += 16)
+    {
+        __m256i b0 = _mm256_load_si256((const __m256i *)b), b1 = _mm256_load_si256((const __m256i *)(b + 8));
+        GEMM_ROW_I32(0) GEMM_ROW_I32(1) GEMM_ROW_I32(2)
+        GEMM_ROW_I32(3) GEMM_ROW_I32(4) GEMM_ROW_I32(5)
+    }
+    GEMM_STORE_I32(0) GEMM_STORE_I32(1) GEMM_STORE_I32(2)
+    GEMM_STORE_I32(3) GEMM_STORE_I32(4) GEMM_STORE_I32(5)
+}
+
+GEMM_DEFINE(i32, int32_t, uint32_t, 6, 16, gemm_kernel_i32)
+#else
+GEMM_GENERIC_KERNEL(i32, int32_t, uint32_t, 4, 8)
+GEMM_DEFINE(i32, int32_t, uint32_t, 4, 8, gemm_generic_kernel_i32)
+#endif
+
+// C = A B for int matrices; -1 when the shapes do not fit or out of memory
+static inline int gemm_matrix(TaskPool *pool, const Matrix *a, const Matrix *b, Matrix *c)
+{
+    if (a->cols != b->rows || c->rows != a->rows || c->cols != b->cols)
+        return -1;
+    return gemm_i32(pool, a->rows, b->cols, a->cols, a->data, a->stride, b->data, b->stride, c->data, c->stride);
+}
+
+#endif
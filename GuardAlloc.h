@@ -0,0 +1,457 @@
+// Sampled guard-page allocation, for catching heap overflows and uses
+// after free in the list, stack and record programs where a build with
+// AddressSanitizer would be too slow to run for real.
+//
+// One allocation in about GUARD_SAMPLE_RATE (the GUARD_SAMPLE_RATE
+// environment variable overrides it, 0 turns sampling off) is not taken
+// from malloc but from a slot of its own: a page, with a page that can
+// never be touched on either side. The allocation is placed at the end of
+// its page, right up against the guard page after it, aligned only as much
+// as its size needs (12 bytes at 4, 13 at 1, 16 or more at 16). Writing
+// one byte past its end faults. Once freed, the slot is made unreadable as
+// well, and slots are reused oldest first, so a use after free faults too
+// for as long as the slot stays unused. A handler for SIGSEGV and SIGBUS
+// tells those faults from any other, prints what happened, the size of
+// the allocation and the call stacks of its allocation and of its free,
+// and then lets the fault kill the program as it would have.
+//
+// Every other allocation pays for a decrement and a branch on a
+// thread-local counter. The counter restarts at a random count, so the
+// sampled allocations are not always the same ones from one run to the
+// next, and over a fleet of runs they cover them all. There are
+// GUARD_SLOTS slots; while all of them are in use nothing is sampled.
+//
+// guardMalloc(), guardCalloc(), guardRealloc(), guardAlignedAlloc() and
+// guardFree() take the places of the five standard calls. Build with
+// -DGUARD_ALLOC and NodePool.h, Stack.h and Records.h include this header,
+// after which malloc(), calloc(), realloc(), aligned_alloc() and free() in
+// the rest of the translation unit are these (in C; C++ calls them by
+// name). Pointers that the C library allocates itself, such as getline()
+// buffers, are still freed correctly, but one of these must not be handed
+// to a library call that reallocates it. POSIX and glibc: mmap, mprotect
+// and backtrace(). Header-only.
+
+#ifndef GUARD_ALLOC_H
+#define GUARD_ALLOC_H
+
+#include <execinfo.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "IntText.h"
+
+#define GUARD_SAMPLE_RATE 5000
+#define GUARD_SLOTS 64
+#define GUARD_STACK_DEPTH 16
+#define GUARD_MAX_ALIGN 16
+
+enum
+{
+    GUARD_UNUSED,
+    GUARD_LIVE,
+    GUARD_FREED
+};
+
+typedef struct
+{
+    unsigned char *user;   // the allocation, at the end of the slot's page
+    size_t size;
+    const void *owner;     // the NodePool it belongs to, or NULL
+    uint64_t freedAt;      // when it was freed, to reuse the oldest first
+    int state, allocDepth, freeDepth;
+    void *allocStack[GUARD_STACK_DEPTH];
+    void *freeStack[GUARD_STACK_DEPTH];
+} GuardSlot;
+
+typedef struct
+{
+    unsigned char *base; // a guard page, then a slot and a guard page each
+    size_t page;
+    uint64_t rate, frees;
+    int ready, off;
+    volatile char lock;
+    struct sigaction previousSegv, previousBus;
+    GuardSlot slot[GUARD_SLOTS];
+} GuardState;
+
+static GuardState guardState;
+static __thread uint64_t guardCountdown, guardSeed;
+
+static inline void guardLock(void)
+{
+    while (__atomic_test_and_set(&guardState.lock, __ATOMIC_ACQUIRE))
+        ;
+}
+
+static inline void guardUnlock(void)
+{
+    __atomic_clear(&guardState.lock, __ATOMIC_RELEASE);
+}
+
+static inline unsigned char *guardSlotPage(size_t i)
+{
+    return guardState.base + (2 * i + 1) * guardState.page;
+}
+
+// The slot whose page holds p, or -1
+static inline int guardSlotOf(const void *p)
+{
+    const unsigned char *c = (const unsigned char *)p;
+    size_t off;
+    if (guardState.base == NULL || c < guardState.base + guardState.page)
+        return -1;
+    off = (size_t)(c - guardState.base - guardState.page);
+    if (off >= 2 * GUARD_SLOTS * guardState.page || off % (2 * guardState.page) >= guardState.page)
+        return -1;
+    return (int)(off / (2 * guardState.page));
+}
+
+static inline int guardOwns(const void *p)
+{
+    return guardSlotOf(p) >= 0;
+}
+
+static inline void guardWrite(const char *s, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = write(2, s, n);
+        if (k <= 0)
+            return;
+        s += k;
+        n -= (size_t)k;
+    }
+}
+
+static inline void guardWriteText(const char *s)
+{
+    guardWrite(s, strlen(s));
+}
+
+static inline void guardWriteNumber(uint64_t x)
+{
+    char digits[INT_TEXT_MAX];
+    guardWrite(digits, u64ToDec(x, digits));
+}
+
+static inline void guardWriteAddress(const void *p)
+{
+    char text[2 + 16];
+    uintptr_t x = (uintptr_t)p;
+    int i;
+    text[0] = '0';
+    text[1] = 'x';
+    for (i = 0; i < 16; i++)
+        text[2 + i] = "0123456789abcdef"[(x >> (60 - 4 * i)) & 15];
+    guardWrite(text, sizeof text);
+}
+
+static inline void guardWriteStack(const char *what, void *const *frames, int depth)
+{
+    guardWriteText(what);
+    if (depth == 0)
+        guardWriteText(" (none)\n");
+    else
+    {
+        guardWriteText(":\n");
+        backtrace_symbols_fd(frames, depth, 2);
+    }
+}
+
+static inline void guardReport(const char *what, const void *at, const GuardSlot *s)
+{
+    const unsigned char *c = (const unsigned char *)at;
+    guardWriteText("GuardAlloc: ");
+    guardWriteText(what);
+    guardWriteText(" at ");
+    guardWriteAddress(at);
+    if (s->state == GUARD_UNUSED)
+    {
+        guardWriteText(", near no allocation\n");
+        return;
+    }
+    guardWriteText(", ");
+    if (c >= s->user + s->size)
+    {
+        guardWriteNumber((uint64_t)(c - (s->user + s->size)));
+        guardWriteText(" bytes past the end of ");
+    }
+    else if (c < s->user)
+    {
+        guardWriteNumber((uint64_t)(s->user - c));
+        guardWriteText(" bytes before ");
+    }
+    else
+    {
+        guardWriteText("byte ");
+        guardWriteNumber((uint64_t)(c - s->user));
+        guardWriteText(" of ");
+    }
+    guardWriteText(s->state == GUARD_FREED ? "a freed " : "a ");
+    guardWriteNumber(s->size);
+    guardWriteText("-byte allocation at ");
+    guardWriteAddress(s->user);
+    guardWriteText("\n");
+    guardWriteStack("allocated", s->allocStack, s->allocDepth);
+    if (s->state == GUARD_FREED)
+        guardWriteStack("freed", s->freeStack, s->freeDepth);
+}
+
+static inline void guardOnFault(int sig, siginfo_t *info, void *context)
+{
+    const unsigned char *at = (const unsigned char *)info->si_addr;
+    const struct sigaction *previous = sig == SIGBUS ? &guardState.previousBus : &guardState.previousSegv;
+    size_t total = (2 * GUARD_SLOTS + 1) * guardState.page;
+    if (at >= guardState.base && at < guardState.base + total)
+    {
+        size_t page = (size_t)(at - guardState.base) / guardState.page;
+        int i = (int)(page / 2), left = (int)page / 2 - 1;
+        if (page % 2 == 1) // in a slot: unused or freed
+            guardReport(guardState.slot[i].state == GUARD_FREED ? "use after free" : "wild access", at,
+                        &guardState.slot[i]);
+        // in a guard page: the end of the live slot before it, or the
+        // start of the one after
+        else if (left >= 0 && guardState.slot[left].state != GUARD_UNUSED)
+            guardReport(guardState.slot[left].state == GUARD_LIVE ? "heap buffer overflow" : "use after free", at,
+                        &guardState.slot[left]);
+        else if (i < GUARD_SLOTS && guardState.slot[i].state != GUARD_UNUSED)
+            guardReport("heap buffer underflow", at, &guardState.slot[i]);
+        else
+            guardReport("wild access", at, &guardState.slot[i < GUARD_SLOTS ? i : left]);
+        sigaction(SIGSEGV, &guardState.previousSegv, NULL);
+        sigaction(SIGBUS, &guardState.previousBus, NULL);
+        return; // the access runs again and faults the usual way
+    }
+    if (previous->sa_flags & SA_SIGINFO)
+        previous->sa_sigaction(sig, info, context);
+    else if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN)
+        previous->sa_handler(sig);
+    else
+    {
+        sigaction(sig, previous, NULL);
+        raise(sig);
+    }
+}
+
+// Sets up the slots the first time; returns 0, or -1 when sampling is off
+static inline int guardInit(void)
+{
+    const char *env;
+    struct sigaction sa;
+    void *frame;
+    if (__atomic_load_n(&guardState.ready, __ATOMIC_ACQUIRE))
+        return guardState.off ? -1 : 0;
+    guardLock();
+    if (!guardState.ready)
+    {
+        env = getenv("GUARD_SAMPLE_RATE");
+        guardState.rate = env != NULL ? strtoull(env, NULL, 10) : GUARD_SAMPLE_RATE;
+        guardState.page = (size_t)sysconf(_SC_PAGESIZE);
+        guardState.off = guardState.rate == 0;
+        if (!guardState.off)
+        {
+            void *base = mmap(NULL, (2 * GUARD_SLOTS + 1) * guardState.page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                              -1, 0);
+            if (base == MAP_FAILED)
+                guardState.off = 1;
+            else
+            {
+                guardState.base = (unsigned char *)base;
+                backtrace(&frame, 1); // loads what backtrace() needs, not in a handler
+                memset(&sa, 0, sizeof sa);
+                sa.sa_sigaction = guardOnFault;
+                sa.sa_flags = SA_SIGINFO;
+                sigemptyset(&sa.sa_mask);
+                sigaction(SIGSEGV, &sa, &guardState.previousSegv);
+                sigaction(SIGBUS, &sa, &guardState.previousBus);
+            }
+        }
+        __atomic_store_n(&guardState.ready, 1, __ATOMIC_RELEASE);
+    }
+    guardUnlock();
+    return guardState.off ? -1 : 0;
+}
+
+// 1 for about one call in guardState.rate
+static inline int guardSampleSlow(void)
+{
+    int take = guardCountdown == 1;
+    if (guardInit() != 0)
+    {
+        guardCountdown = UINT64_MAX;
+        return 0;
+    }
+    if (guardSeed == 0)
+        guardSeed = (uint64_t)(uintptr_t)&guardSeed | 1;
+    guardSeed ^= guardSeed << 13; // xorshift64
+    guardSeed ^= guardSeed >> 7;
+    guardSeed ^= guardSeed << 17;
+    guardCountdown = 1 + guardSeed % (2 * guardState.rate); // rate on average
+    return take;
+}
+
+static inline int guardSampleNow(void)
+{
+    if (__builtin_expect(guardCountdown > 1, 1))
+    {
+        guardCountdown--;
+        return 0;
+    }
+    return guardSampleSlow();
+}
+
+// size bytes from a slot, aligned to align; NULL when they do not fit one or
+// no slot is free
+static inline void *guardSlotAlloc(size_t size, size_t align, const void *owner)
+{
+    size_t i, best = GUARD_SLOTS;
+    GuardSlot *s;
+    unsigned char *page;
+    if (size == 0 || size > guardState.page || align > guardState.page)
+        return NULL;
+    guardLock();
+    for (i = 0; i < GUARD_SLOTS; i++)
+    {
+        GuardSlot *t = &guardState.slot[i];
+        if (t->state == GUARD_UNUSED)
+        {
+            best = i;
+            break;
+        }
+        if (t->state == GUARD_FREED && (best == GUARD_SLOTS || t->freedAt < guardState.slot[best].freedAt))
+            best = i;
+    }
+    if (best == GUARD_SLOTS)
+    {
+        guardUnlock();
+        return NULL;
+    }
+    s = &guardState.slot[best];
+    page = guardSlotPage(best);
+    if (mprotect(page, guardState.page, PROT_READ | PROT_WRITE) != 0)
+    {
+        guardUnlock();
+        return NULL;
+    }
+    s->state = GUARD_LIVE;
+    guardUnlock();
+    s->user = (unsigned char *)((uintptr_t)(page + guardState.page - size) & ~(uintptr_t)(align - 1));
+    s->size = size;
+    s->owner = owner;
+    s->freeDepth = 0;
+    s->allocDepth = backtrace(s->allocStack, GUARD_STACK_DEPTH);
+    return s->user;
+}
+
+// The alignment malloc() owes an allocation of size bytes
+static inline size_t guardAlignFor(size_t size)
+{
+    size_t lowest = size & (0 - size);
+    return lowest < GUARD_MAX_ALIGN ? lowest : GUARD_MAX_ALIGN;
+}
+
+static inline void guardSlotFree(int i, const void *p)
+{
+    GuardSlot *s = &guardState.slot[i];
+    if (s->state != GUARD_LIVE || p != s->user)
+    {
+        guardReport(s->state == GUARD_FREED ? "double free" : "free of a pointer it did not return", p, s);
+        abort();
+    }
+    s->freeDepth = backtrace(s->freeStack, GUARD_STACK_DEPTH);
+    guardLock();
+    mprotect(guardSlotPage((size_t)i), guardState.page, PROT_NONE);
+    s->state = GUARD_FREED;
+    s->freedAt = ++guardState.frees;
+    guardUnlock();
+}
+
+static inline void *guardMalloc(size_t size)
+{
+    if (guardSampleNow())
+    {
+        void *p = guardSlotAlloc(size, guardAlignFor(size), NULL);
+        if (p != NULL)
+            return p;
+    }
+    return malloc(size);
+}
+
+static inline void *guardCalloc(size_t n, size_t size)
+{
+    size_t bytes;
+    if (guardSampleNow() && !__builtin_mul_overflow(n, size, &bytes))
+    {
+        void *p = guardSlotAlloc(bytes, guardAlignFor(size), NULL);
+        if (p != NULL)
+            return memset(p, 0, bytes);
+    }
+    return calloc(n, size);
+}
+
+static inline void *guardAlignedAlloc(size_t align, size_t size)
+{
+    if (guardSampleNow())
+    {
+        size_t natural = guardAlignFor(size);
+        void *p = guardSlotAlloc(size, align > natural ? align : natural, NULL);
+        if (p != NULL)
+            return p;
+    }
+    return aligned_alloc(align, size);
+}
+
+static inline void guardFree(void *p)
+{
+    int i = guardSlotOf(p);
+    if (i >= 0)
+        guardSlotFree(i, p);
+    else
+        free(p);
+}
+
+// Growing a sampled block moves it to malloc, or to another slot
+static inline void *guardRealloc(void *p, size_t size)
+{
+    int i = guardSlotOf(p);
+    void *q;
+    if (p == NULL)
+        return guardMalloc(size);
+    if (i < 0)
+        return realloc(p, size);
+    if (size == 0)
+    {
+        guardSlotFree(i, p);
+        return NULL;
+    }
+    if ((q = guardMalloc(size)) == NULL)
+        return NULL;
+    memcpy(q, p, size < guardState.slot[i].size ? size : guardState.slot[i].size);
+    guardSlotFree(i, p);
+    return q;
+}
+
+// Frees the live slots handed to owner, for a NodePool let go all at once
+static inline void guardFreeOwned(const void *owner)
+{
+    size_t i;
+    if (guardState.base == NULL)
+        return;
+    for (i = 0; i < GUARD_SLOTS; i++)
+        if (guardState.slot[i].state == GUARD_LIVE && guardState.slot[i].owner == owner)
+            guardSlotFree((int)i, guardState.slot[i].user);
+}
+
+#if defined(GUARD_ALLOC) && !defined(__cplusplus)
+#define malloc(size) guardMalloc(size)
+#define calloc(n, size) guardCalloc(n, size)
+#define realloc(p, size) guardRealloc(p, size)
+#define aligned_alloc(align, size) guardAlignedAlloc(align, size)
+#define free(p) guardFree(p)
+#endif
+
+#endif
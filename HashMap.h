@@ -0,0 +1,348 @@
+// An open-addressing hash map in the style of Swiss tables, for the
+// counting and grouping programs: Anagram-Program-in-C, "Convert an array
+// to reduced form.c" and anything else that maps words or numbers to a
+// count or an index.
+//
+// Besides the array of entries there is one control byte for each slot:
+// HASHMAP_EMPTY, or the low 7 bits of the hash of the key in the slot. A
+// lookup takes the 16 control bytes from the slot the hash picks in one
+// SSE2 load, compares all of them with the key's 7 bits in one compare,
+// and only compares keys where those match, which for a missing key is
+// almost never; a group with an empty byte ends the search. The table
+// has a power of two slots and grows to twice the size before it is more
+// than 7/8 full. The first 16 control bytes are repeated after the last,
+// so a group that runs past the end is still one load.
+//
+// Keys are placed by linear probing, slot after slot, so a removal needs
+// no tombstone: the entries after the removed one that would be closer to
+// their home slot move back into the gap (backward shift deletion), and
+// the table is as if the key had never been added. The hash is the
+// multiply-and-fold of wyhash, 64 bits.
+//
+// HASHMAP_DEFINE(Map, map, Key, Value, HASH, EQUAL) makes the type Map,
+// with entries Map##Entry {key, value}, and its functions map##Init(),
+// map##Find() and so on, for keys compared by EQUAL(a, b) and hashed to 64
+// bits by HASH(key). Two are made here: IntMap, int64_t keys, and StrMap,
+// StrView keys (the text is not copied, so it must outlive the map); both
+// have int64_t values.
+//
+//     StrMap counts;
+//     StrMapEntry *e;
+//     size_t at = 0;
+//     strMapInit(&counts);
+//     while (...)
+//         if ((e = strMapInsert(&counts, word, NULL)) != NULL)
+//             e->value++;                   // 0 for a new key
+//     while ((e = strMapNext(&counts, &at)) != NULL)
+//         printf("%.*s %lld\n", (int)e->key.n, e->key.p, (long long)e->value);
+//     strMapFree(&counts);
+//
+// map##FindMany() and map##InsertMany() take a batch of keys: they hash
+// HASHMAP_BATCH keys ahead and prefetch their control bytes and slots, so
+// the cache misses of a table bigger than the caches overlap.
+//
+// An entry pointer stays good until the next insert or remove. Insert
+// returns NULL, and Reserve -1, when out of memory. Header-only.
+
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "StrView.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define HASHMAP_GROUP 16
+#define HASHMAP_EMPTY 0x80
+#define HASHMAP_BATCH 16
+
+static inline uint64_t hashMapFold(uint64_t a, uint64_t b)
+{
+    __uint128_t m = (__uint128_t)a * b;
+    return (uint64_t)m ^ (uint64_t)(m >> 64);
+}
+
+// n bytes to 64 bits, eight at a time
+static inline uint64_t hashMapBytes(const void *p, size_t n)
+{
+    const unsigned char *s = (const unsigned char *)p;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n, w;
+    for (; n >= 8; s += 8, n -= 8)
+    {
+        memcpy(&w, s, 8);
+        h = hashMapFold(h ^ w, 0xA0761D6478BD642FULL);
+    }
+    w = 0;
+    memcpy(&w, s, n);
+    return hashMapFold(h ^ w, 0xE7037ED1A0B428DBULL);
+}
+
+static inline uint64_t hashMapU64(uint64_t x)
+{
+    return hashMapFold(x ^ 0x9E3779B97F4A7C15ULL, 0xA0761D6478BD642FULL);
+}
+
+// Bit k is set when ctrl[k] == tag, for the 16 bytes from ctrl
+static inline unsigned hashMapMatch(const uint8_t *ctrl, uint8_t tag)
+{
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    unsigned bits = 0;
+    int k;
+    for (k = 0; k < HASHMAP_GROUP; k++)
+        bits |= (unsigned)(ctrl[k] == tag) << k;
+    return bits;
+#endif
+}
+
+// Bit k is set when ctrl[k] is empty: the only byte with its top bit set
+static inline unsigned hashMapEmpty(const uint8_t *ctrl)
+{
+#if defined(__SSE2__)
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    unsigned bits = 0;
+    int k;
+    for (k = 0; k < HASHMAP_GROUP; k++)
+        bits |= (unsigned)(ctrl[k] >> 7) << k;
+    return bits;
+#endif
+}
+
+#define HASHMAP_DEFINE(Map, map, Key, Value, HASH, EQUAL)                                                     \
+    typedef struct                                                                                             \
+    {                                                                                                          \
+        Key key;                                                                                               \
+        Value value;                                                                                           \
+    } Map##Entry;                                                                                              \
+                                                                                                               \
+    typedef struct                                                                                             \
+    {                                                                                                          \
+        uint8_t *ctrl; /* capacity + HASHMAP_GROUP bytes */                                                    \
+        Map##Entry *slots;                                                                                     \
+        size_t capacity, size; /* capacity is 0 or a power of two >= HASHMAP_GROUP */                          \
+    } Map;                                                                                                     \
+                                                                                                               \
+    static inline void map##Init(Map *m)                                                                       \
+    {                                                                                                          \
+        memset(m, 0, sizeof *m);                                                                               \
+    }                                                                                                          \
+                                                                                                               \
+    static inline void map##Free(Map *m)                                                                       \
+    {                                                                                                          \
+        free(m->ctrl);                                                                                         \
+        free(m->slots);                                                                                        \
+        memset(m, 0, sizeof *m);                                                                               \
+    }                                                                                                          \
+                                                                                                               \
+    static inline void map##SetCtrl(Map *m, size_t i, uint8_t c)                                               \
+    {                                                                                                          \
+        m->ctrl[i] = c;                                                                                        \
+        if (i < HASHMAP_GROUP)                                                                                 \
+            m->ctrl[m->capacity + i] = c;                                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    /* the first empty slot from the home of hash h on */                                                      \
+    static inline size_t map##FreeSlot(const Map *m, uint64_t h)                                               \
+    {                                                                                                          \
+        size_t mask = m->capacity - 1, i = (size_t)(h >> 7) & mask;                                            \
+        unsigned empty;                                                                                        \
+        while ((empty = hashMapEmpty(m->ctrl + i)) == 0)                                                       \
+            i = (i + HASHMAP_GROUP) & mask;                                                                    \
+        return (i + (size_t)__builtin_ctz(empty)) & mask;                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    /* moves everything to a table of capacity slots, a power of two */                                        \
+    static inline int map##Rehash(Map *m, size_t capacity)                                                     \
+    {                                                                                                          \
+        Map old = *m;                                                                                          \
+        size_t i;                                                                                              \
+        m->ctrl = (uint8_t *)malloc(capacity + HASHMAP_GROUP);                                                 \
+        m->slots = (Map##Entry *)malloc(capacity * sizeof(Map##Entry));                                        \
+        if (m->ctrl == NULL || m->slots == NULL)                                                               \
+        {                                                                                                      \
+            free(m->ctrl);                                                                                     \
+            free(m->slots);                                                                                    \
+            *m = old;                                                                                          \
+            return -1;                                                                                         \
+        }                                                                                                      \
+        memset(m->ctrl, HASHMAP_EMPTY, capacity + HASHMAP_GROUP);                                              \
+        m->capacity = capacity;                                                                                \
+        for (i = 0; i < old.capacity; i++)                                                                     \
+            if (old.ctrl[i] != HASHMAP_EMPTY)                                                                  \
+            {                                                                                                  \
+                size_t s = map##FreeSlot(m, HASH(old.slots[i].key));                                           \
+                map##SetCtrl(m, s, old.ctrl[i]);                                                               \
+                m->slots[s] = old.slots[i];                                                                    \
+            }                                                                                                  \
+        free(old.ctrl);                                                                                        \
+        free(old.slots);                                                                                       \
+        return 0;                                                                                              \
+    }                                                                                                          \
+                                                                                                               \
+    /* room for n keys in all without growing */                                                               \
+    static inline int map##Reserve(Map *m, size_t n)                                                           \
+    {                                                                                                          \
+        size_t capacity = m->capacity ? m->capacity : HASHMAP_GROUP;                                           \
+        while (n > capacity / 8 * 7)                                                                           \
+        {                                                                                                      \
+            if (capacity > SIZE_MAX / 2 / sizeof(Map##Entry))                                                  \
+                return -1;                                                                                     \
+            capacity *= 2;                                                                                     \
+        }                                                                                                      \
+        return capacity != m->capacity ? map##Rehash(m, capacity) : 0;                                         \
+    }                                                                                                          \
+                                                                                                               \
+    static inline Map##Entry *map##FindHashed(const Map *m, Key key, uint64_t h)                               \
+    {                                                                                                          \
+        size_t mask = m->capacity - 1, i = (size_t)(h >> 7) & mask;                                            \
+        uint8_t tag = (uint8_t)(h & 0x7F);                                                                     \
+        if (m->capacity == 0)                                                                                  \
+            return NULL;                                                                                       \
+        for (;; i = (i + HASHMAP_GROUP) & mask)                                                                \
+        {                                                                                                      \
+            unsigned hit = hashMapMatch(m->ctrl + i, tag), empty = hashMapEmpty(m->ctrl + i);                  \
+            if (empty)                                                                                         \
+                hit &= (empty & (0u - empty)) - 1; /* the key is before the first empty slot */                \
+            for (; hit; hit &= hit - 1)                                                                        \
+            {                                                                                                  \
+                Map##Entry *e = &m->slots[(i + (size_t)__builtin_ctz(hit)) & mask];                            \
+                if (EQUAL(e->key, key))                                                                        \
+                    return e;                                                                                  \
+            }                                                                                                  \
+            if (empty)                                                                                         \
+                return NULL;                                                                                   \
+        }                                                                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    static inline Map##Entry *map##Find(const Map *m, Key key)                                                 \
+    {                                                                                                          \
+        return map##FindHashed(m, key, HASH(key));                                                             \
+    }                                                                                                          \
+                                                                                                               \
+    static inline Map##Entry *map##InsertHashed(Map *m, Key key, uint64_t h, int *added)                       \
+    {                                                                                                          \
+        Map##Entry *e;                                                                                         \
+        size_t s;                                                                                              \
+        if (m->capacity > 0) /* the slot is needed either way: load it with the control bytes */               \
+            __builtin_prefetch(m->slots + ((size_t)(h >> 7) & (m->capacity - 1)), 1);                          \
+        e = map##FindHashed(m, key, h);                                                                        \
+        if (added != NULL)                                                                                     \
+            *added = e == NULL;                                                                                \
+        if (e != NULL)                                                                                         \
+            return e;                                                                                          \
+        if (map##Reserve(m, m->size + 1) != 0)                                                                 \
+            return NULL;                                                                                       \
+        s = map##FreeSlot(m, h);                                                                               \
+        map##SetCtrl(m, s, (uint8_t)(h & 0x7F));                                                               \
+        e = &m->slots[s];                                                                                      \
+        memset(e, 0, sizeof *e);                                                                               \
+        e->key = key;                                                                                          \
+        m->size++;                                                                                             \
+        return e;                                                                                              \
+    }                                                                                                          \
+                                                                                                               \
+    /* the entry of key, added with a zero value if it was not there */                                        \
+    static inline Map##Entry *map##Insert(Map *m, Key key, int *added)                                         \
+    {                                                                                                          \
+        return map##InsertHashed(m, key, HASH(key), added);                                                    \
+    }                                                                                                          \
+                                                                                                               \
+    /* 1 if key was there, 0 if not */                                                                         \
+    static inline int map##Remove(Map *m, Key key)                                                             \
+    {                                                                                                          \
+        Map##Entry *e = map##Find(m, key);                                                                     \
+        size_t mask = m->capacity - 1, i, j;                                                                   \
+        if (e == NULL)                                                                                         \
+            return 0;                                                                                          \
+        i = (size_t)(e - m->slots);                                                                            \
+        for (j = (i + 1) & mask; m->ctrl[j] != HASHMAP_EMPTY; j = (j + 1) & mask)                              \
+        {                                                                                                      \
+            size_t home = (size_t)(HASH(m->slots[j].key) >> 7) & mask;                                         \
+            if (((j - home) & mask) >= ((j - i) & mask))                                                       \
+            {                                                                                                  \
+                m->slots[i] = m->slots[j];                                                                     \
+                map##SetCtrl(m, i, m->ctrl[j]);                                                                \
+                i = j;                                                                                         \
+            }                                                                                                  \
+        }                                                                                                      \
+        map##SetCtrl(m, i, HASHMAP_EMPTY);                                                                     \
+        m->size--;                                                                                             \
+        return 1;                                                                                              \
+    }                                                                                                          \
+                                                                                                               \
+    /* the entry at or after *at, which then points past it; NULL at the end */                                \
+    static inline Map##Entry *map##Next(const Map *m, size_t *at)                                              \
+    {                                                                                                          \
+        for (; *at < m->capacity; (*at)++)                                                                     \
+            if (m->ctrl[*at] != HASHMAP_EMPTY)                                                                 \
+                return &m->slots[(*at)++];                                                                     \
+        return NULL;                                                                                           \
+    }                                                                                                          \
+                                                                                                               \
+    /* out[i] = map##Find(m, keys[i]) for i < n */                                                             \
+    static inline void map##FindMany(const Map *m, const Key *keys, size_t n, Map##Entry **out)                \
+    {                                                                                                          \
+        uint64_t h[HASHMAP_BATCH];                                                                             \
+        size_t i, j, k, mask = m->capacity - 1;                                                                \
+        for (i = 0; i < n; i += k)                                                                             \
+        {                                                                                                      \
+            k = n - i < HASHMAP_BATCH ? n - i : HASHMAP_BATCH;                                                 \
+            for (j = 0; j < k; j++)                                                                            \
+            {                                                                                                  \
+                h[j] = HASH(keys[i + j]);                                                                      \
+                if (m->capacity > 0)                                                                           \
+                {                                                                                              \
+                    __builtin_prefetch(m->ctrl + ((size_t)(h[j] >> 7) & mask));                                \
+                    __builtin_prefetch(m->slots + ((size_t)(h[j] >> 7) & mask));                               \
+                }                                                                                              \
+            }                                                                                                  \
+            for (j = 0; j < k; j++)                                                                            \
+                out[i + j] = map##FindHashed(m, keys[i + j], h[j]);                                            \
+        }                                                                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    /* out[i] = map##Insert(m, keys[i], NULL) for i < n, or NULL if out is; */                                 \
+    /* returns 0, or -1 when out of memory (and nothing was added) */                                          \
+    static inline int map##InsertMany(Map *m, const Key *keys, size_t n, Map##Entry **out)                     \
+    {                                                                                                          \
+        uint64_t h[HASHMAP_BATCH];                                                                             \
+        size_t i, j, k, mask;                                                                                  \
+        if (map##Reserve(m, m->size + n) != 0)                                                                 \
+            return -1;                                                                                         \
+        mask = m->capacity - 1;                                                                                \
+        for (i = 0; i < n; i += k)                                                                             \
+        {                                                                                                      \
+            k = n - i < HASHMAP_BATCH ? n - i : HASHMAP_BATCH;                                                 \
+            for (j = 0; j < k; j++)                                                                            \
+            {                                                                                                  \
+                h[j] = HASH(keys[i + j]);                                                                      \
+                __builtin_prefetch(m->ctrl + ((size_t)(h[j] >> 7) & mask));                                    \
+                __builtin_prefetch(m->slots + ((size_t)(h[j] >> 7) & mask), 1);                                \
+            }                                                                                                  \
+            for (j = 0; j < k; j++)                                                                            \
+            {                                                                                                  \
+                Map##Entry *e = map##InsertHashed(m, keys[i + j], h[j], NULL);                                 \
+                if (out != NULL)                                                                               \
+                    out[i + j] = e;                                                                            \
+            }                                                                                                  \
+        }                                                                                                      \
+        return 0;                                                                                              \
+    }
+
+#define HASHMAP_INT_HASH(k) hashMapU64((uint64_t)(k))
+#define HASHMAP_INT_EQUAL(a, b) ((a) == (b))
+#define HASHMAP_STR_HASH(k) hashMapBytes((k).p, (k).n)
+#define HASHMAP_STR_EQUAL(a, b) svEqual(a, b)
+
+HASHMAP_DEFINE(IntMap, intMap, int64_t, int64_t, HASHMAP_INT_HASH, HASHMAP_INT_EQUAL)
+HASHMAP_DEFINE(StrMap, strMap, StrView, int64_t, HASHMAP_STR_HASH, HASHMAP_STR_EQUAL)
+
+#endif
@@ -1,41 +1,953 @@
 // Function that takes a string "haystack" and a string "needle"
 // and checks if needle appears in haystack
+//
+// FindSubString is the fast engine behind SubString:
+//  - A SIMD filter compares the first and the last byte of the needle
+//    against 32 (AVX2) or 16 (SSE2) haystack positions at once and only
+//    verifies positions where both match. Without SIMD it uses memchr.
+//  - If the filter produces too many false candidates (for example
+//    "aaaa...ab" in "aaaa...a") it switches to the Two-Way algorithm of
+//    Crochemore and Perrin, which is linear in the worst case and needs
+//    no extra memory.
+//
+// AhoCompile / AhoSearch handle many needles at once: the needle set is
+// compiled into an Aho-Corasick automaton that reports every match of
+// every needle in one pass over the haystack (run the program with the
+// needles as arguments to try it).
+//
+// StreamSearch / AhoStreamSearch scan a file of any size in fixed-size
+// chunks with constant memory: "-f FILE needle..." on the command line.
+//
+// ApproxSearch finds the needle with up to k typos (bit-parallel Bitap
+// or Myers, needles of any length), also over a stream: "-k K needle",
+// optionally with -f FILE and "-e bitap" or "-e myers" to pick the
+// engine. "-d A B" prints the edit distance of A and B.
+//
+// Compile with -pthread, and -mavx2 (or -march=native) to enable the
+// AVX2 path.
 
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
 
-int SubString(char *haystack, char *needle ){
-	int bigIndex = 0;
-	int littleIndex = 0;
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 16
+#endif
+
+// Maximal suffix of x for the normal (reverse == 0) or reversed
+// (reverse == 1) byte order. Returns the index just before the suffix
+// and stores its period in *period.
+static long MaximalSuffix(const unsigned char *x, long m, int reverse, long *period){
+	long ms = -1, j = 0, k = 1, p = 1;
 
-	// Iterate through Haystack until a match is found
-	// then iterate through both strings until the end of needle
-	// or a difference is found
-	while (haystack[bigIndex] != '\0'){
-		while (haystack[bigIndex + littleIndex] == needle[littleIndex]){
-			if (needle[littleIndex + 1] == '\0')
-				return (1);
-			littleIndex++;
+	while (j + k < m){
+		unsigned char a = x[j + k];
+		unsigned char b = x[ms + k];
+		if (reverse ? a > b : a < b){
+			j += k;
+			k = 1;
+			p = j - ms;
+		} else if (a == b){
+			if (k != p)
+				k++;
+			else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			ms = j;
+			j = ms + 1;
+			k = p = 1;
 		}
-		littleIndex = 0;\
-		bigIndex++;
 	}
+	*period = p;
+	return (ms);
+}
+
+// Two-Way string matching: first match of x (length m) in y (length n)
+// or -1. Runs in O(n + m) time with O(1) extra space.
+long TwoWaySearch(const unsigned char *y, long n, const unsigned char *x, long m){
+	long p, q, ell, per;
+	long i = MaximalSuffix(x, m, 0, &p);
+	long j = MaximalSuffix(x, m, 1, &q);
+
+	// The critical factorization splits x at ell + 1
+	if (i > j){
+		ell = i;
+		per = p;
+	} else {
+		ell = j;
+		per = q;
+	}
+
+	if (memcmp(x, x + per, ell + 1) == 0){
+		// x is periodic: remember how much of the left part matched
+		long memory = -1;
+		j = 0;
+		while (j <= n - m){
+			i = (ell > memory ? ell : memory) + 1;
+			while (i < m && x[i] == y[i + j])
+				i++;
+			if (i >= m){
+				i = ell;
+				while (i > memory && x[i] == y[i + j])
+					i--;
+				if (i <= memory)
+					return (j);
+				j += per;
+				memory = m - per - 1;
+			} else {
+				j += i - ell;
+				memory = -1;
+			}
+		}
+	} else {
+		per = (ell + 1 > m - ell - 1 ? ell + 1 : m - ell - 1) + 1;
+		j = 0;
+		while (j <= n - m){
+			i = ell + 1;
+			while (i < m && x[i] == y[i + j])
+				i++;
+			if (i >= m){
+				i = ell;
+				while (i >= 0 && x[i] == y[i + j])
+					i--;
+				if (i < 0)
+					return (j);
+				j += per;
+			} else
+				j += i - ell;
+		}
+	}
+	return (-1);
+}
+
+// Candidate verification is cheap while candidates are rare. Once the
+// bytes spent verifying exceed this many times the bytes scanned we
+// hand the rest of the haystack to Two-Way.
+#define VERIFY_BUDGET 8
+
+// Position of the first occurrence of needle (m bytes) in haystack
+// (n bytes), or -1. Both may contain any bytes, including '\0'.
+long FindSubString(const char *haystack, long n, const char *needle, long m){
+	const unsigned char *y = (const unsigned char *)haystack;
+	const unsigned char *x = (const unsigned char *)needle;
+	long i = 0, work = 0;
+
+	if (m == 0)
+		return (0);
+	if (m > n)
+		return (-1);
+	if (m == 1){
+		const void *hit = memchr(y, x[0], n);
+		return (hit ? (const unsigned char *)hit - y : -1);
+	}
+
+#ifdef SIMD_WIDTH
+	// Scan SIMD_WIDTH start positions per step
+#if SIMD_WIDTH == 32
+	const __m256i first = _mm256_set1_epi8((char)x[0]);
+	const __m256i last = _mm256_set1_epi8((char)x[m - 1]);
+#else
+	const __m128i first = _mm_set1_epi8((char)x[0]);
+	const __m128i last = _mm_set1_epi8((char)x[m - 1]);
+#endif
+	for (; i + m - 1 + SIMD_WIDTH <= n; i += SIMD_WIDTH){
+#if SIMD_WIDTH == 32
+		__m256i a = _mm256_loadu_si256((const __m256i *)(y + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(y + i + m - 1));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+#else
+		__m128i a = _mm_loadu_si128((const __m128i *)(y + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(y + i + m - 1));
+		unsigned mask = (unsigned)_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+#endif
+		while (mask != 0){
+			int bit = __builtin_ctz(mask);
+			if (memcmp(y + i + bit + 1, x + 1, m - 2) == 0)
+				return (i + bit);
+			work += m;
+			mask &= mask - 1;
+		}
+		if (work > VERIFY_BUDGET * i + 4096)
+			break; // too many false candidates
+	}
+#else
+	// Portable filter: jump between occurrences of the first byte
+	while (i <= n - m){
+		const unsigned char *hit = memchr(y + i, x[0], n - m + 1 - i);
+		if (hit == NULL)
+			return (-1);
+		i = hit - y;
+		if (y[i + m - 1] == x[m - 1] && memcmp(y + i + 1, x + 1, m - 2) == 0)
+			return (i);
+		work += m;
+		i++;
+		if (work > VERIFY_BUDGET * i + 4096)
+			break;
+	}
+#endif
+
+	// Tail (or too many false candidates): worst-case linear Two-Way
+	if (i > n - m)
+		return (-1);
+	long pos = TwoWaySearch(y + i, n - i, x, m);
+	return (pos < 0 ? -1 : i + pos);
+}
+
+// ---------------------------------------------------------------------
+// Aho-Corasick multi-needle search
+//
+// The automaton is a flat DFA: next[state * classes + class] is the
+// state after reading a byte of that class, with the failure links
+// already folded in, so searching does exactly one table lookup per
+// haystack byte and never backtracks.
+// Bytes that appear in no needle share class 0, which keeps the table
+// at states x (distinct needle bytes + 1) entries.
+// ---------------------------------------------------------------------
+typedef struct {
+	int		*next;		// dense transition table
+	unsigned char	classOf[256];	// byte -> column of next[]
+	int		classes;
+	int		states;
+	int		*stateOut;	// first needle ending at a state, or -1
+	int		*idNext;	// next needle ending at the same state, or -1
+	int		*dictLink;	// nearest suffix state where a needle ends, or -1
+	long		*length;	// needle lengths, by needle id
+	int		needles;
+} AhoCorasick;
+
+// Called for every match: needle id and offset of its first byte
+typedef void (*AhoMatchFn)(int needleId, long offset, void *ctx);
+
+// Builds the automaton for count needles. Empty needles are ignored.
+AhoCorasick *AhoCompile(const char **needles, int count){
+	AhoCorasick *ac = calloc(1, sizeof(AhoCorasick));
+	long total = 1;
+	int i, c;
+
+	// Pass 1: byte classes and an upper bound on the number of states
+	for (i = 0; i < count; i++){
+		const unsigned char *x = (const unsigned char *)needles[i];
+		for (; *x != '\0'; x++){
+			if (ac->classOf[*x] == 0)
+				ac->classOf[*x] = ++ac->classes;
+			total++;
+		}
+	}
+	ac->classes++;	// plus class 0 for all other bytes
+
+	int C = ac->classes;
+	ac->next = malloc(total * C * sizeof(int));
+	ac->stateOut = malloc(total * sizeof(int));
+	ac->dictLink = malloc(total * sizeof(int));
+	ac->idNext = malloc((count > 0 ? count : 1) * sizeof(int));
+	ac->length = malloc((count > 0 ? count : 1) * sizeof(long));
+	ac->needles = count;
+	ac->states = 1;
+	for (c = 0; c < C; c++)
+		ac->next[c] = -1;
+	ac->stateOut[0] = -1;
+
+	// Pass 2: the trie (-1 marks a missing edge)
+	for (i = 0; i < count; i++){
+		const unsigned char *x = (const unsigned char *)needles[i];
+		int s = 0;
+		ac->length[i] = strlen(needles[i]);
+		ac->idNext[i] = -1;
+		if (*x == '\0')
+			continue;
+		for (; *x != '\0'; x++){
+			int *edge = &ac->next[(long)s * C + ac->classOf[*x]];
+			if (*edge < 0){
+				int t = ac->states++;
+				for (c = 0; c < C; c++)
+					ac->next[(long)t * C + c] = -1;
+				ac->stateOut[t] = -1;
+				*edge = t;
+			}
+			s = *edge;
+		}
+		ac->idNext[i] = ac->stateOut[s];
+		ac->stateOut[s] = i;
+	}
+
+	// Pass 3: breadth-first failure links, folded into the table
+	int *fail = malloc(ac->states * sizeof(int));
+	int *queue = malloc(ac->states * sizeof(int));
+	int head = 0, tail = 0;
+
+	for (c = 0; c < C; c++){
+		int v = ac->next[c];
+		if (v < 0)
+			ac->next[c] = 0;
+		else {
+			fail[v] = 0;
+			ac->dictLink[v] = -1;
+			queue[tail++] = v;
+		}
+	}
+	ac->dictLink[0] = -1;
+	while (head < tail){
+		int u = queue[head++];
+		for (c = 0; c < C; c++){
+			int *edge = &ac->next[(long)u * C + c];
+			int via = ac->next[(long)fail[u] * C + c];
+			if (*edge < 0){
+				*edge = via;	// no child: follow the failure link
+				continue;
+			}
+			int v = *edge;
+			fail[v] = via;
+			ac->dictLink[v] = ac->stateOut[via] >= 0 ? via : ac->dictLink[via];
+			queue[tail++] = v;
+		}
+	}
+	free(fail);
+	free(queue);
+	return (ac);
+}
+
+// Reports needles ending at state s after haystack byte end
+static long AhoReport(const AhoCorasick *ac, int s, long end, AhoMatchFn fn, void *ctx){
+	long found = 0;
+
+	for (; s >= 0; s = ac->dictLink[s])
+		for (int id = ac->stateOut[s]; id >= 0; id = ac->idNext[id]){
+			if (fn != NULL)
+				fn(id, end - ac->length[id] + 1, ctx);
+			found++;
+		}
+	return (found);
+}
+
+// Feeds n more bytes to the automaton, starting from *state. base is
+// the offset of haystack[0] in the whole input, so a long input can be
+// scanned piece by piece; *state is updated for the next piece.
+long AhoSearchFrom(const AhoCorasick *ac, int *state, const char *haystack, long n, long base, AhoMatchFn fn, void *ctx){
+	const unsigned char *y = (const unsigned char *)haystack;
+	const int *next = ac->next;
+	int C = ac->classes;
+	long found = 0;
+	int s = *state;
+
+	for (long i = 0; i < n; i++){
+		s = next[(long)s * C + ac->classOf[y[i]]];
+		if (ac->stateOut[s] >= 0 || ac->dictLink[s] >= 0)
+			found += AhoReport(ac, s, base + i, fn, ctx);
+	}
+	*state = s;
+	return (found);
+}
+
+// Scans n haystack bytes once and reports every needle occurrence.
+// Returns the number of matches.
+long AhoSearch(const AhoCorasick *ac, const char *haystack, long n, AhoMatchFn fn, void *ctx){
+	int state = 0;
+	return (AhoSearchFrom(ac, &state, haystack, n, 0, fn, ctx));
+}
+
+void AhoFree(AhoCorasick *ac){
+	if (ac == NULL)
+		return;
+	free(ac->next);
+	free(ac->stateOut);
+	free(ac->idNext);
+	free(ac->dictLink);
+	free(ac->length);
+	free(ac);
+}
+
+// ---------------------------------------------------------------------
+// Approximate matching: every place where the needle occurs with at
+// most k errors (insertions, deletions or substitutions of one byte).
+// A match is reported at the offset of its last haystack byte, with the
+// fewest errors it can end there with; where it starts is not unique.
+//
+// Both engines keep one bit per needle byte in 64-bit words, so the
+// whole automaton advances a byte in a few word operations, and a
+// needle longer than 64 bytes just takes more words:
+//  - Bitap (Shift-And, Wu and Manber): bit i of row R[d] says the first
+//    i + 1 needle bytes match the text just read with at most d errors.
+//    k + 1 rows, so the cost per byte grows with k.
+//  - Myers' bit-vector algorithm keeps the differences between adjacent
+//    cells of one column of the edit distance table (Pv / Mv: +1 / -1
+//    down the column), which an addition updates all at once, whatever
+//    k is. The same column, started with the top row 0, 1, 2, ... gives
+//    EditDistance, the plain Levenshtein distance of two strings.
+// ApproxCompile picks Bitap while k is small (k <= APPROX_BITAP_MAX_K)
+// and Myers above that.
+// ---------------------------------------------------------------------
+#define APPROX_BITAP_MAX_K	1
+
+enum { APPROX_AUTO, APPROX_BITAP, APPROX_MYERS };
+
+typedef struct {
+	long		m;
+	int		k;
+	int		words;		// 64-bit words per bit vector
+	int		engine;		// APPROX_BITAP or APPROX_MYERS
+	uint64_t	top;		// bit of the last needle byte in the last word
+	uint64_t	*peq;		// peq[c * words + w]: needle bytes equal to c
+	uint64_t	*row;		// Bitap: R[0..k]; Myers: Pv then Mv
+	uint64_t	*old;		// Bitap: R[d - 1] before this byte
+	long		score;		// Myers: distance at the last needle byte
+} ApproxMatcher;
+
+// Called for every match: offset of its last byte and its errors
+typedef void (*ApproxMatchFn)(long end, int errors, void *ctx);
+
+// Puts a matcher back at the start of a haystack
+void ApproxReset(ApproxMatcher *am){
+	int W = am->words;
+
+	if (am->engine == APPROX_MYERS){
+		for (int w = 0; w < W; w++){
+			am->row[w] = ~(uint64_t)0;	// Pv: the column is 0, 1, 2, ...
+			am->row[W + w] = 0;
+		}
+		am->score = am->m;
+		return;
+	}
+	// R[d]: the first d needle bytes can always be deleted
+	memset(am->row, 0, (am->k + 1) * W * sizeof(uint64_t));
+	for (int d = 0; d <= am->k; d++)
+		for (int i = 0; i < d; i++)
+			am->row[d * W + i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+// Matcher for needle (m bytes) with at most k errors, 0 <= k < m, or
+// NULL when that is not the case
+ApproxMatcher *ApproxCompile(const char *needle, long m, int k, int engine){
+	const unsigned char *x = (const unsigned char *)needle;
+	ApproxMatcher *am;
+
+	if (m <= 0 || k < 0 || k >= m)
+		return (NULL);
+	am = calloc(1, sizeof(ApproxMatcher));
+	am->m = m;
+	am->k = k;
+	am->words = (int)((m + 63) / 64);
+	am->engine = engine != APPROX_AUTO ? engine : k <= APPROX_BITAP_MAX_K ? APPROX_BITAP : APPROX_MYERS;
+	am->top = (uint64_t)1 << ((m - 1) % 64);
+	am->peq = calloc(256 * (size_t)am->words, sizeof(uint64_t));
+	for (long i = 0; i < m; i++)
+		am->peq[x[i] * am->words + i / 64] |= (uint64_t)1 << (i % 64);
+	am->row = malloc((am->engine == APPROX_MYERS ? 2 : k + 1) * (size_t)am->words * sizeof(uint64_t));
+	am->old = malloc(am->words * sizeof(uint64_t));
+	ApproxReset(am);
+	return (am);
+}
+
+void ApproxFree(ApproxMatcher *am){
+	if (am == NULL)
+		return;
+	free(am->peq);
+	free(am->row);
+	free(am->old);
+	free(am);
+}
+
+static long BitapFeed(ApproxMatcher *am, const unsigned char *y, long n, long base, ApproxMatchFn fn, void *ctx){
+	int W = am->words, k = am->k, last = W - 1;
+	uint64_t *R = am->row, *old = am->old, top = am->top;
+	long found = 0;
+
+	for (long i = 0; i < n; i++){
+		const uint64_t *B = am->peq + y[i] * W;
+		uint64_t carry = 1;
+
+		// Exact row: extend every partial match by this byte
+		for (int w = 0; w < W; w++){
+			uint64_t v = R[w];
+			old[w] = v;
+			R[w] = ((v << 1) | carry) & B[w];
+			carry = v >> 63;
+		}
+		// Row d: a match, an inserted byte (old R[d - 1]), a substituted
+		// one (old R[d - 1] shifted) or a deleted one (new R[d - 1] shifted)
+		for (int d = 1; d <= k; d++){
+			uint64_t *Rd = R + d * W;
+			const uint64_t *prev = R + (d - 1) * W;
+			uint64_t carryMatch = 1, carryEdit = 1;
+			for (int w = 0; w < W; w++){
+				uint64_t v = Rd[w], s = old[w] | prev[w];
+				Rd[w] = (((v << 1) | carryMatch) & B[w]) | old[w] | (s << 1) | carryEdit;
+				carryMatch = v >> 63;
+				carryEdit = s >> 63;
+				old[w] = v;
+			}
+		}
+		if (R[k * W + last] & top){
+			int d = 0;
+			while (!(R[d * W + last] & top))
+				d++;
+			if (fn != NULL)
+				fn(base + i, d, ctx);
+			found++;
+		}
+	}
+	return (found);
+}
+
+// One column step of Myers' algorithm for one word of the bit vectors.
+// hin is the change of the top row of the word (-1, 0, +1); returns
+// that of the row marked by hb.
+static inline int MyersStep(uint64_t *pv, uint64_t *mv, uint64_t eq, int hin, uint64_t hb){
+	uint64_t Pv = *pv, Mv = *mv;
+	uint64_t Xv = eq | Mv;
+	if (hin < 0)
+		eq |= 1;
+	uint64_t Xh = (((eq & Pv) + Pv) ^ Pv) | eq;
+	uint64_t Ph = Mv | ~(Xh | Pv);
+	uint64_t Mh = Pv & Xh;
+	int hout = (Ph & hb) ? 1 : (Mh & hb) ? -1 : 0;
+
+	Ph <<= 1;
+	Mh <<= 1;
+	if (hin < 0)
+		Mh |= 1;
+	else if (hin > 0)
+		Ph |= 1;
+	*pv = Mh | ~(Xv | Ph);
+	*mv = Ph & Xv;
+	return (hout);
+}
+
+static long MyersFeed(ApproxMatcher *am, const unsigned char *y, long n, long base, ApproxMatchFn fn, void *ctx){
+	int W = am->words, last = W - 1;
+	uint64_t *Pv = am->row, *Mv = am->row + W;
+	uint64_t hb = (uint64_t)1 << 63;
+	long found = 0, score = am->score;
+
+	if (W == 1){	// the common case, with the vectors in registers
+		uint64_t pv = Pv[0], mv = Mv[0];
+		for (long i = 0; i < n; i++){
+			score += MyersStep(&pv, &mv, am->peq[y[i]], 0, am->top);
+			if (score <= am->k){
+				if (fn != NULL)
+					fn(base + i, (int)score, ctx);
+				found++;
+			}
+		}
+		Pv[0] = pv;
+		Mv[0] = mv;
+		am->score = score;
+		return (found);
+	}
+	for (long i = 0; i < n; i++){
+		const uint64_t *B = am->peq + y[i] * W;
+		int h = 0;	// searching: a match may start anywhere
+
+		for (int w = 0; w < last; w++)
+			h = MyersStep(&Pv[w], &Mv[w], B[w], h, hb);
+		score += MyersStep(&Pv[last], &Mv[last], B[last], h, am->top);
+		if (score <= am->k){
+			if (fn != NULL)
+				fn(base + i, (int)score, ctx);
+			found++;
+		}
+	}
+	am->score = score;
+	return (found);
+}
+
+// Feeds n more haystack bytes to the matcher; base is the offset of
+// haystack[0] in the whole input, as for AhoSearchFrom. Returns the
+// number of matches.
+long ApproxSearchFrom(ApproxMatcher *am, const char *haystack, long n, long base, ApproxMatchFn fn, void *ctx){
+	const unsigned char *y = (const unsigned char *)haystack;
+
+	if (am->engine == APPROX_MYERS)
+		return (MyersFeed(am, y, n, base, fn, ctx));
+	return (BitapFeed(am, y, n, base, fn, ctx));
+}
+
+// Every match of the needle with at most k errors in one haystack
+long ApproxSearch(ApproxMatcher *am, const char *haystack, long n, ApproxMatchFn fn, void *ctx){
+	ApproxReset(am);
+	return (ApproxSearchFrom(am, haystack, n, 0, fn, ctx));
+}
+
+// Levenshtein distance of a (m bytes) and b (n bytes) by Myers'
+// algorithm: O(n * m / 64) word operations
+long EditDistance(const char *a, long m, const char *b, long n){
+	const unsigned char *x = (const unsigned char *)a, *y = (const unsigned char *)b;
+	int W = (int)((m + 63) / 64), last = W - 1;
+	uint64_t hb = (uint64_t)1 << 63, top;
+	long score = m;
+
+	if (m == 0)
+		return (n);
+	top = (uint64_t)1 << ((m - 1) % 64);
+	uint64_t *peq = calloc(256 * (size_t)W, sizeof(uint64_t));
+	uint64_t *Pv = malloc(2 * W * sizeof(uint64_t)), *Mv = Pv + W;
+	for (long i = 0; i < m; i++)
+		peq[x[i] * W + i / 64] |= (uint64_t)1 << (i % 64);
+	for (int w = 0; w < W; w++){
+		Pv[w] = ~(uint64_t)0;
+		Mv[w] = 0;
+	}
+	for (long i = 0; i < n; i++){
+		const uint64_t *B = peq + y[i] * W;
+		int h = 1;	// the top row is 0, 1, 2, ...: every step adds one
+		for (int w = 0; w < last; w++)
+			h = MyersStep(&Pv[w], &Mv[w], B[w], h, hb);
+		score += MyersStep(&Pv[last], &Mv[last], B[last], h, top);
+	}
+	free(peq);
+	free(Pv);
+	return (score);
+}
+
+// ---------------------------------------------------------------------
+// Streaming search over a file descriptor
+//
+// A reader thread fills two chunk buffers in turn while the caller scans
+// the other one, so reading and scanning overlap. Each buffer keeps
+// `keep` spare bytes in front of the chunk; before a chunk is scanned
+// the last `keep` bytes of the previous chunk are copied there, so a
+// match crossing the boundary is still seen. Memory use is fixed at
+// 2 x (keep + STREAM_CHUNK) bytes whatever the size of the input.
+// ---------------------------------------------------------------------
+#define STREAM_CHUNK (4L << 20)
+
+typedef struct {
+	int		fd;
+	long		keep;		// carried bytes in front of each chunk
+	char		*buf[2];
+	long		len[2];		// bytes read into the chunk part
+	int		full[2];	// 1 while the consumer owns the slot
+	int		error;
+	pthread_mutex_t	lock;
+	pthread_cond_t	changed;
+} ChunkReader;
+
+static void *ReaderThread(void *arg){
+	ChunkReader *r = arg;
+
+	for (int slot = 0;; slot ^= 1){
+		pthread_mutex_lock(&r->lock);
+		while (r->full[slot])
+			pthread_cond_wait(&r->changed, &r->lock);
+		pthread_mutex_unlock(&r->lock);
+
+		// Fill the whole chunk unless the input ends first
+		long got = 0;
+		while (got < STREAM_CHUNK){
+			ssize_t k = read(r->fd, r->buf[slot] + r->keep + got, STREAM_CHUNK - got);
+			if (k < 0 && errno == EINTR)
+				continue;
+			if (k <= 0){
+				if (k < 0)
+					r->error = errno;
+				break;
+			}
+			got += k;
+		}
+
+		pthread_mutex_lock(&r->lock);
+		r->len[slot] = got;
+		r->full[slot] = 1;
+		pthread_cond_broadcast(&r->changed);
+		pthread_mutex_unlock(&r->lock);
+		if (got == 0)
+			return (NULL);	// end of input (an empty slot tells the consumer)
+	}
+}
+
+// Scans one window (carry + chunk) of the stream
+typedef long (*WindowFn)(const char *win, long len, long carried, long base, void *ctx);
+
+// Runs fn over every window of the input. Returns the sum of its
+// results, or -1 on a read error.
+static long ScanStream(int fd, long keep, WindowFn fn, void *ctx){
+	ChunkReader r;
+	pthread_t tid;
+	long total = 0, offset = 0, carried = 0;
+
+	memset(&r, 0, sizeof(r));
+	r.fd = fd;
+	r.keep = keep;
+	r.buf[0] = malloc(keep + STREAM_CHUNK);
+	r.buf[1] = malloc(keep + STREAM_CHUNK);
+	pthread_mutex_init(&r.lock, NULL);
+	pthread_cond_init(&r.changed, NULL);
+	if (r.buf[0] == NULL || r.buf[1] == NULL || pthread_create(&tid, NULL, ReaderThread, &r) != 0){
+		free(r.buf[0]);
+		free(r.buf[1]);
+		return (-1);
+	}
+
+	for (int slot = 0, prev = -1;; prev = slot, slot ^= 1){
+		pthread_mutex_lock(&r.lock);
+		while (!r.full[slot])
+			pthread_cond_wait(&r.changed, &r.lock);
+		pthread_mutex_unlock(&r.lock);
+
+		long len = r.len[slot];
+		char *win = r.buf[slot] + keep - carried;	// window starts at the carry
+		if (prev >= 0){
+			memcpy(win, r.buf[prev] + keep + r.len[prev] - carried, carried);
+			pthread_mutex_lock(&r.lock);
+			r.full[prev] = 0;	// the reader may refill it now
+			pthread_cond_broadcast(&r.changed);
+			pthread_mutex_unlock(&r.lock);
+		}
+		if (len == 0)
+			break;
+
+		total += fn(win, carried + len, carried, offset - carried, ctx);
+		offset += len;
+		carried = carried + len < keep ? carried + len : keep;
+	}
+
+	pthread_join(tid, NULL);
+	free(r.buf[0]);
+	free(r.buf[1]);
+	pthread_mutex_destroy(&r.lock);
+	pthread_cond_destroy(&r.changed);
+	return (r.error != 0 ? -1 : total);
+}
+
+typedef struct {
+	const char	*needle;
+	long		m;
+	void		(*report)(long offset, void *ctx);
+	void		*ctx;
+} NeedleScan;
+
+// Every match in the window that was not complete in the previous one
+static long NeedleWindow(const char *win, long len, long carried, long base, void *arg){
+	NeedleScan *ns = arg;
+	long found = 0, from = 0;
+	(void)carried;	// matches inside the carry alone were reported already
+
+	for (;;){
+		long pos = FindSubString(win + from, len - from, ns->needle, ns->m);
+		if (pos < 0)
+			break;
+		if (ns->report != NULL)
+			ns->report(base + from + pos, ns->ctx);
+		found++;
+		from += pos + 1;
+	}
+	return (found);
+}
+
+// Reports the byte offset of every occurrence of needle in the input
+// read from fd. Returns the number of matches, or -1 on a read error.
+long StreamSearch(int fd, const char *needle, void (*report)(long offset, void *ctx), void *ctx){
+	NeedleScan ns = { needle, (long)strlen(needle), report, ctx };
+
+	if (ns.m == 0)
+		return (0);
+	return (ScanStream(fd, ns.m - 1, NeedleWindow, &ns));
+}
+
+typedef struct {
+	const AhoCorasick	*ac;
+	int			state;
+	AhoMatchFn		fn;
+	void			*ctx;
+} AhoScan;
+
+// The automaton state already remembers the previous chunk: no carry
+static long AhoWindow(const char *win, long len, long carried, long base, void *arg){
+	AhoScan *as = arg;
+	return (AhoSearchFrom(as->ac, &as->state, win + carried, len - carried, base + carried, as->fn, as->ctx));
+}
+
+// Multi-needle counterpart of StreamSearch
+long AhoStreamSearch(int fd, const AhoCorasick *ac, AhoMatchFn fn, void *ctx){
+	AhoScan as = { ac, 0, fn, ctx };
+	return (ScanStream(fd, 0, AhoWindow, &as));
+}
+
+typedef struct {
+	ApproxMatcher	*am;
+	ApproxMatchFn	fn;
+	void		*ctx;
+} ApproxScan;
+
+// The matcher's bit vectors carry over between chunks too
+static long ApproxWindow(const char *win, long len, long carried, long base, void *arg){
+	ApproxScan *as = arg;
+	return (ApproxSearchFrom(as->am, win + carried, len - carried, base + carried, as->fn, as->ctx));
+}
+
+// Approximate counterpart of StreamSearch
+long ApproxStreamSearch(int fd, ApproxMatcher *am, ApproxMatchFn fn, void *ctx){
+	ApproxScan as = { am, fn, ctx };
+
+	ApproxReset(am);
+	return (ScanStream(fd, 0, ApproxWindow, &as));
+}
+
+int SubString(char *haystack, char *needle ){
+	// An empty needle or an empty haystack never matched here
+	if (haystack[0] == '\0' || needle[0] == '\0')
+		return (0);
+	return (FindSubString(haystack, strlen(haystack), needle, strlen(needle)) >= 0);
+}
+
+// Reads one line of any length; the newline is removed
+static char *ReadLine(void){
+	char *line = NULL;
+	size_t cap = 0;
+	ssize_t len = getline(&line, &cap, stdin);
+
+	if (len < 0){
+		free(line);
+		return (NULL);
+	}
+	if (len > 0 && line[len - 1] == '\n')
+		line[--len] = '\0';
+	return (line);
+}
+
+// Prints one Aho-Corasick match
+static void PrintMatch(int needleId, long offset, void *ctx){
+	char **needles = ctx;
+	printf("  \"%s\" at offset %ld\n", needles[needleId], offset);
+}
+
+// Prints one StreamSearch match
+static void PrintOffset(long offset, void *ctx){
+	printf("  \"%s\" at offset %ld\n", (const char *)ctx, offset);
+}
+
+// Prints one approximate match
+static void PrintApprox(long end, int errors, void *ctx){
+	printf("  \"%s\" ending at offset %ld (%d error%s)\n", (const char *)ctx, end, errors, errors == 1 ? "" : "s");
+}
+
+// "-f FILE needle..." : search a file of any size chunk by chunk
+static int SearchFile(const char *path, int count, char **needles, ApproxMatcher *am){
+	int fd = strcmp(path, "-") == 0 ? 0 : open(path, O_RDONLY);
+	long found;
+
+	if (fd < 0){
+		perror(path);
+		return (1);
+	}
+	if (am != NULL)
+		found = ApproxStreamSearch(fd, am, PrintApprox, needles[0]);
+	else if (count == 1)
+		found = StreamSearch(fd, needles[0], PrintOffset, needles[0]);
+	else {
+		AhoCorasick *ac = AhoCompile((const char **)needles, count);
+		found = AhoStreamSearch(fd, ac, PrintMatch, needles);
+		AhoFree(ac);
+	}
+	if (fd != 0)
+		close(fd);
+	if (found < 0){
+		fprintf(stderr, "%s: read error\n", path);
+		return (1);
+	}
+	printf("%ld match(es)\n", found);
 	return (0);
 }
 
-int main(){
-	char	needle[100];
-	char	haystack[100];
+int main(int argc, char *argv[]){
+	char	*needle;
+	char	*haystack;
+	const char *path = NULL;
+	int	errors = -1, engine = APPROX_AUTO;
+
+	// Leading options: -f FILE, -k ERRORS, -e bitap|myers, -d A B
+	while (argc > 2 && argv[1][0] == '-'){
+		if (strcmp(argv[1], "-f") == 0)
+			path = argv[2];
+		else if (strcmp(argv[1], "-k") == 0)
+			errors = atoi(argv[2]);
+		else if (strcmp(argv[1], "-e") == 0)
+			engine = strcmp(argv[2], "bitap") == 0 ? APPROX_BITAP : APPROX_MYERS;
+		else if (strcmp(argv[1], "-d") == 0 && argc > 3){
+			printf("%ld\n", EditDistance(argv[2], strlen(argv[2]), argv[3], strlen(argv[3])));
+			return (0);
+		} else
+			break;
+		argc -= 2;
+		argv += 2;
+	}
+
+	// Approximate mode: one needle, at most ERRORS edits
+	if (errors >= 0){
+		ApproxMatcher *am = argc == 2 ? ApproxCompile(argv[1], strlen(argv[1]), errors, engine) : NULL;
+		int status = 0;
+		if (am == NULL){
+			fprintf(stderr, "-k needs one needle longer than the number of errors\n");
+			return (1);
+		}
+		if (path != NULL)
+			status = SearchFile(path, 1, argv + 1, am);
+		else {
+			printf("Please enter your Haystack string: ");
+			haystack = ReadLine();
+			if (haystack == NULL)
+				status = 1;
+			else {
+				long found = ApproxSearch(am, haystack, strlen(haystack), PrintApprox, argv[1]);
+				printf("%ld match(es)\n", found);
+				free(haystack);
+			}
+		}
+		ApproxFree(am);
+		return (status);
+	}
 
-	// Getting input
-	printf("Please enter your Haystack string (< 100 characters): ");
-	scanf("%s", haystack);
-	printf("Please enter your Needle string (< 100 characters): ");
-	scanf("%s", needle);
+	// Streaming mode over a file ("-" = standard input)
+	if (path != NULL && argc > 1)
+		return (SearchFile(path, argc - 1, argv + 1, NULL));
+
+	// Multi-needle mode: every argument is a needle
+	if (argc > 1){
+		AhoCorasick *ac = AhoCompile((const char **)(argv + 1), argc - 1);
+		printf("Please enter your Haystack string: ");
+		haystack = ReadLine();
+		if (haystack == NULL){
+			AhoFree(ac);
+			return (1);
+		}
+		long found = AhoSearch(ac, haystack, strlen(haystack), PrintMatch, argv + 1);
+		printf("%ld match(es)\n", found);
+		AhoFree(ac);
+		free(haystack);
+		return (0);
+	}
+
+	// Getting input (lines of any length, spaces allowed)
+	printf("Please enter your Haystack string: ");
+	haystack = ReadLine();
+	printf("Please enter your Needle string: ");
+	needle = ReadLine();
+	if (haystack == NULL || needle == NULL){
+		printf("Missing input\n");
+		free(haystack);
+		free(needle);
+		return (1);
+	}
 
 	if (SubString(haystack, needle))
 		printf("Needle was found in Haystack!\n");
 	else
 		printf("Needle not found in Haystack\n");
+	free(haystack);
+	free(needle);
 	return (0);
 }
@@ -0,0 +1,217 @@
+// Hex encoding and decoding by table, for DecimalToHexadecimalViceVersa.c
+// and anything that logs hashes or IDs.
+//
+// hexEncode() looks each byte up in a table of its two characters, 512
+// of them, instead of working out one nibble at a time. hexDecode() looks
+// up each character in a 256-entry table that gives 0 .. 15 for a hex
+// digit and 0x100 for anything else; ORing every pair's value together
+// and testing the bits above 0xff at the end checks the whole input with
+// no branch per character.
+//
+// With SSE2 both go 16 bytes at a time. Encoding splits the bytes into
+// nibbles and turns each into its character with one pshufb into the 16
+// digits under SSSE3, or without it by adding '0' and, past 9, the gap up
+// to 'a'. Decoding takes c - '0', or (c | 0x20) - 'a' + 10 for a letter,
+// checks with unsigned min that one of them is in range, and folds each
+// pair into a byte with 16-bit shifts and a pack.
+//
+// hexEncodeU32s() and hexEncodeU64s() write arrays of integers as fixed
+// width hex, most significant digit first; hexFromU64() writes one without
+// leading zeros and hexToU64() reads one back.
+//
+// Header-only.
+
+#ifndef HEX_H
+#define HEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// integers per step of hexEncodeU32s() and hexEncodeU64s()
+#define HEX_INT_CHUNK 64
+
+static const char hexPairsLower[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const char hexPairsUpper[] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static const uint16_t hexValue[256] = {
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x000, 0x001, 0x002, 0x003, 0x004, 0x005, 0x006, 0x007, 0x008, 0x009, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x00a, 0x00b, 0x00c, 0x00d, 0x00e, 0x00f, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x00a, 0x00b, 0x00c, 0x00d, 0x00e, 0x00f, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+    0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+};
+
+// out[0 .. 2n) = the hex of in[0 .. n), two characters a byte; no 0 is
+// written after them
+static inline void hexEncode(const unsigned char *in, size_t n, char *out, int upper)
+{
+    const char *pairs = upper ? hexPairsUpper : hexPairsLower;
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i low4 = _mm_set1_epi8(0x0f);
+#if defined(__SSSE3__)
+    const __m128i digits = _mm_loadu_si128((const __m128i *)(upper ? "0123456789ABCDEF" : "0123456789abcdef"));
+#define HEX_DIGITS(v) _mm_shuffle_epi8(digits, v)
+#else
+    const __m128i nine = _mm_set1_epi8(9), zero = _mm_set1_epi8('0');
+    const __m128i skip = _mm_set1_epi8(upper ? 'A' - '9' - 1 : 'a' - '9' - 1);
+#define HEX_DIGITS(v) _mm_add_epi8(_mm_add_epi8(v, zero), _mm_and_si128(_mm_cmpgt_epi8(v, nine), skip))
+#endif
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i hi = HEX_DIGITS(_mm_and_si128(_mm_srli_epi16(x, 4), low4));
+        __m128i lo = HEX_DIGITS(_mm_and_si128(x, low4));
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#undef HEX_DIGITS
+#endif
+    for (; i < n; i++)
+        memcpy(out + 2 * i, pairs + 2 * in[i], 2);
+}
+
+// out[0 .. n / 2) from the hex in[0 .. n), either case; 0, or -1 when n
+// is odd or a character is not a hex digit, and then out is undefined
+static inline int hexDecode(const char *in, size_t n, unsigned char *out)
+{
+    const unsigned char *s = (const unsigned char *)in;
+    unsigned bad = 0;
+    size_t i = 0;
+    if (n % 2 != 0)
+        return -1;
+#if defined(__SSE2__)
+    {
+        const __m128i zero = _mm_set1_epi8('0'), a = _mm_set1_epi8('a');
+        const __m128i nine = _mm_set1_epi8(9), five = _mm_set1_epi8(5), ten = _mm_set1_epi8(10);
+        const __m128i lower = _mm_set1_epi8(0x20), low8 = _mm_set1_epi16(0xff);
+        unsigned ok = 0xffff;
+        for (; i + 32 <= n; i += 32)
+        {
+            __m128i v[2];
+            int h;
+            for (h = 0; h < 2; h++)
+            {
+                __m128i c = _mm_loadu_si128((const __m128i *)(s + i + 16 * h));
+                __m128i d = _mm_sub_epi8(c, zero);
+                __m128i l = _mm_sub_epi8(_mm_or_si128(c, lower), a);
+                __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+                __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(l, five), l);
+                __m128i x;
+                ok &= (unsigned)_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter));
+                x = _mm_or_si128(_mm_and_si128(isDigit, d), _mm_andnot_si128(isDigit, _mm_add_epi8(l, ten)));
+                // a 16-bit lane holds a pair, the first character low: 16 first + second
+                v[h] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x, low8), 4), _mm_srli_epi16(x, 8));
+            }
+            _mm_storeu_si128((__m128i *)(out + i / 2), _mm_packus_epi16(v[0], v[1]));
+        }
+        if (ok != 0xffff)
+            return -1;
+    }
+#endif
+    for (; i < n; i += 2)
+    {
+        unsigned v = hexValue[s[i]] << 4 | hexValue[s[i + 1]];
+        bad |= v;
+        out[i / 2] = (unsigned char)v;
+    }
+    return bad > 0xff ? -1 : 0;
+}
+
+// out[0 .. 8n) = a[0 .. n) as 8 hex digits each
+static inline void hexEncodeU32s(const uint32_t *a, size_t n, char *out, int upper)
+{
+    unsigned char be[4 * HEX_INT_CHUNK];
+    size_t i, j, k;
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < HEX_INT_CHUNK ? n - i : HEX_INT_CHUNK;
+        for (j = 0; j < k; j++)
+        {
+            uint32_t x = __builtin_bswap32(a[i + j]);
+            memcpy(be + 4 * j, &x, 4);
+        }
+        hexEncode(be, 4 * k, out + 8 * i, upper);
+    }
+}
+
+// out[0 .. 16n) = a[0 .. n) as 16 hex digits each
+static inline void hexEncodeU64s(const uint64_t *a, size_t n, char *out, int upper)
+{
+    unsigned char be[8 * HEX_INT_CHUNK];
+    size_t i, j, k;
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < HEX_INT_CHUNK ? n - i : HEX_INT_CHUNK;
+        for (j = 0; j < k; j++)
+        {
+            uint64_t x = __builtin_bswap64(a[i + j]);
+            memcpy(be + 8 * j, &x, 8);
+        }
+        hexEncode(be, 8 * k, out + 16 * i, upper);
+    }
+}
+
+// the hex of x with no leading zeros ("0" for 0) and a 0 after it, into
+// out[0 .. 17); returns the number of digits
+static inline int hexFromU64(uint64_t x, char *out, int upper)
+{
+    char all[16];
+    int digits = x == 0 ? 1 : (64 - __builtin_clzll(x) + 3) / 4;
+    hexEncodeU64s(&x, 1, all, upper);
+    memcpy(out, all + 16 - digits, digits);
+    out[digits] = '\0';
+    return digits;
+}
+
+// *x = the hex number s, either case; 0, or -1 when s is empty, has
+// something other than hex digits or needs more than 64 bits
+static inline int hexToU64(const char *s, uint64_t *x)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    uint64_t v = 0;
+    unsigned bad = *p == '\0' ? 0x100 : 0, over = 0;
+    for (; *p != '\0'; p++)
+    {
+        over |= v >> 60 != 0;
+        bad |= hexValue[*p];
+        v = v << 4 | (hexValue[*p] & 0x0f);
+    }
+    *x = v;
+    return bad > 0xff || over ? -1 : 0;
+}
+
+#endif
@@ -1,14 +1,20 @@
 // Insertion sort ascending order
 
 #include <stdio.h>
+#include <stdlib.h>
 
 int main()
 {
-  int n, array[1000], c, d, t;
+  int n, *array, c, d, t;
 
   printf("Enter number of elements\n");
   scanf("%d", &n);
 
+  /* room for any number of elements */
+  array = malloc((n > 0 ? n : 1) * sizeof *array);
+  if (array == NULL)
+    return 1;
+
   printf("Enter %d integers\n", n);
 
   for (c = 0; c < n; c++)
@@ -32,5 +38,6 @@ int main()
     printf("%d\n", array[c]);
   }
 
+  free(array);
   return 0;
 }
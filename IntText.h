@@ -0,0 +1,239 @@
+// Writing integers as text into the caller's buffer, in any base from 2
+// to 36, without printf, for DecimalToBaseN.c, DecimalToBinary.c,
+// Changingbase.c and exporters that format a lot of numbers.
+//
+//   - Base 10 goes two digits at a time: x % 100 picks a pair out of a
+//     200-byte table of "00" .. "99", so there are half the divisions. The
+//     length is known before the first digit, from the bit length times
+//     log10(2) (1233 / 4096) checked against a table of powers of ten, so
+//     the digits go straight to where they belong, with nothing to
+//     reverse.
+//   - A base 2^k is k bits a digit: the bit length from count leading
+//     zeros sizes the output, and shifts and masks fill it.
+//   - Any other base has a case of its own in a switch, so the base is a
+//     constant there and the compiler turns x / base into a multiply and
+//     a shift instead of a divide instruction.
+//
+// Digits past 9 are A .. Z. Each call writes a 0 after the digits and
+// returns how many characters it wrote before it; INT_TEXT_MAX is enough
+// for any 64-bit value in any base, sign included. intArrayToText()
+// writes a whole array with a separator after each value.
+//
+// Header-only.
+
+#ifndef INT_TEXT_H
+#define INT_TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INT_TEXT_MAX 66 // '-', 64 binary digits and the 0
+
+static const char intDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char intDigits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static const uint64_t intPowersOf10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+// the number of decimal digits of x, 1 for 0
+static inline int decimalDigits(uint64_t x)
+{
+    int t = (64 - __builtin_clzll(x | 1)) * 1233 >> 12;
+    return t + ((x | 1) >= intPowersOf10[t]);
+}
+
+static inline size_t u64ToDec(uint64_t x, char *out)
+{
+    int len = decimalDigits(x);
+    char *p = out + len;
+    uint32_t y;
+    *p = '\0';
+    // 64-bit divisions only while x needs them
+    while (x > 0xffffffffULL)
+    {
+        p -= 2;
+        memcpy(p, intDigitPairs + 2 * (x % 100), 2);
+        x /= 100;
+    }
+    for (y = (uint32_t)x; y >= 100; y /= 100)
+    {
+        p -= 2;
+        memcpy(p, intDigitPairs + 2 * (y % 100), 2);
+    }
+    if (y >= 10)
+        memcpy(p - 2, intDigitPairs + 2 * y, 2);
+    else
+        p[-1] = (char)('0' + y);
+    return (size_t)len;
+}
+
+static inline size_t i64ToDec(int64_t x, char *out)
+{
+    if (x >= 0)
+        return u64ToDec((uint64_t)x, out);
+    *out = '-';
+    return 1 + u64ToDec(0 - (uint64_t)x, out + 1);
+}
+
+// x in base 2^shift, for shift 1 to 5
+static inline size_t u64ToPow2(uint64_t x, int shift, char *out)
+{
+    int bits = 64 - __builtin_clzll(x | 1), len = (bits + shift - 1) / shift, i;
+    uint64_t mask = (1u << shift) - 1;
+    for (i = len - 1; i >= 0; i--, x >>= shift)
+        out[i] = intDigits[x & mask];
+    out[len] = '\0';
+    return (size_t)len;
+}
+
+// the digits backwards into the end of a scratch buffer, then moved to
+// the front; inlined with base a constant for each case of u64ToBase()
+static inline size_t intToBaseConst(uint64_t x, char *out, unsigned base)
+{
+    char tmp[INT_TEXT_MAX];
+    char *p = tmp + sizeof tmp;
+    size_t len;
+    do
+    {
+        *--p = intDigits[x % base];
+        x /= base;
+    } while (x != 0);
+    len = (size_t)(tmp + sizeof tmp - p);
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+}
+
+// x in base 2 to 36; 0 with out = "" for any other base
+static inline size_t u64ToBase(uint64_t x, unsigned base, char *out)
+{
+    switch (base)
+    {
+    case 2:
+        return u64ToPow2(x, 1, out);
+    case 4:
+        return u64ToPow2(x, 2, out);
+    case 8:
+        return u64ToPow2(x, 3, out);
+    case 10:
+        return u64ToDec(x, out);
+    case 16:
+        return u64ToPow2(x, 4, out);
+    case 32:
+        return u64ToPow2(x, 5, out);
+    case 3:
+        return intToBaseConst(x, out, 3);
+    case 5:
+        return intToBaseConst(x, out, 5);
+    case 6:
+        return intToBaseConst(x, out, 6);
+    case 7:
+        return intToBaseConst(x, out, 7);
+    case 9:
+        return intToBaseConst(x, out, 9);
+    case 11:
+        return intToBaseConst(x, out, 11);
+    case 12:
+        return intToBaseConst(x, out, 12);
+    case 13:
+        return intToBaseConst(x, out, 13);
+    case 14:
+        return intToBaseConst(x, out, 14);
+    case 15:
+        return intToBaseConst(x, out, 15);
+    case 17:
+        return intToBaseConst(x, out, 17);
+    case 18:
+        return intToBaseConst(x, out, 18);
+    case 19:
+        return intToBaseConst(x, out, 19);
+    case 20:
+        return intToBaseConst(x, out, 20);
+    case 21:
+        return intToBaseConst(x, out, 21);
+    case 22:
+        return intToBaseConst(x, out, 22);
+    case 23:
+        return intToBaseConst(x, out, 23);
+    case 24:
+        return intToBaseConst(x, out, 24);
+    case 25:
+        return intToBaseConst(x, out, 25);
+    case 26:
+        return intToBaseConst(x, out, 26);
+    case 27:
+        return intToBaseConst(x, out, 27);
+    case 28:
+        return intToBaseConst(x, out, 28);
+    case 29:
+        return intToBaseConst(x, out, 29);
+    case 30:
+        return intToBaseConst(x, out, 30);
+    case 31:
+        return intToBaseConst(x, out, 31);
+    case 33:
+        return intToBaseConst(x, out, 33);
+    case 34:
+        return intToBaseConst(x, out, 34);
+    case 35:
+        return intToBaseConst(x, out, 35);
+    case 36:
+        return intToBaseConst(x, out, 36);
+    }
+    *out = '\0';
+    return 0;
+}
+
+static inline size_t i64ToBase(int64_t x, unsigned base, char *out)
+{
+    if (x >= 0)
+        return u64ToBase((uint64_t)x, base, out);
+    if (base < 2 || base > 36)
+    {
+        *out = '\0';
+        return 0;
+    }
+    *out = '-';
+    return 1 + u64ToBase(0 - (uint64_t)x, base, out + 1);
+}
+
+// a[0 .. n) in base, each followed by sep, and a 0 at the end; out needs
+// room for n * INT_TEXT_MAX characters. Returns the length, or 0 for a
+// base out of range. Base 10, the common one, gets a loop of its own with
+// no switch in it.
+static inline size_t intArrayToText(const int64_t *a, size_t n, unsigned base, char sep, char *out)
+{
+    char *p = out;
+    size_t i;
+    if (base < 2 || base > 36)
+    {
+        *out = '\0';
+        return 0;
+    }
+#define INT_ARRAY_LOOP(write)      \
+    for (i = 0; i < n; i++)        \
+    {                              \
+        p += write;                \
+        *p++ = sep;                \
+    }
+    if (base == 10)
+        INT_ARRAY_LOOP(i64ToDec(a[i], p))
+    else
+        INT_ARRAY_LOOP(i64ToBase(a[i], base, p))
+#undef INT_ARRAY_LOOP
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+#endif
@@ -0,0 +1,375 @@
+// Simple and compound interest over whole columns of accounts, for the
+// interest programs (CalculateSimpleInterest.c, SimpleInterestCalculator.c,
+// Simple_Interest.c, simple_interest.c).
+//
+// An InterestBook keeps the principal, the rate (percent a year) and the
+// time (years) of its accounts as three arrays, so interestArray() reads
+// each as a stream and works on them four at a time:
+//
+//   INTEREST_SIMPLE    p r t / 100, a loop the compiler vectorizes.
+//   INTEREST_COMPOUND  p ((1 + x)^(k t) - 1) with x = r / (100 k) a period
+//                      for k periods a year, or p (e^(r t / 100) - 1) for
+//                      k = 0, continuously. (1 + x)^(k t) is e^(k t log1p(x))
+//                      and t need not be whole. log1p(x) is log(u) x / (u - 1)
+//                      with u = 1 + x, which makes up for the rounding of u,
+//                      and log(u) comes from logArray() (Logarithm.h), a
+//                      batch of INTEREST_BATCH at a time. e^z - 1 is worked
+//                      out as interestExpm1() does, 2^j (e^f - 1) + 2^j - 1
+//                      for z = j ln 2 + f, with no 1 added to e^f - 1 and
+//                      taken off again, so a small z, one night's interest,
+//                      keeps all its digits; with AVX2 and FMA four at a time.
+//
+// simpleInterest() and compoundInterest() do one account the same way;
+// interestExpVector() is e^z by the same steps, for Expr.h.
+// interestCsv() streams a CSV file: the three fields given by columns are
+// found as views (StrView.h) and parsed, a batch of INTEREST_BATCH lines at a time, and each line goes
+// out with its interest added as a last field with the given number of
+// decimals (FloatText.h); a line whose fields are missing or are not
+// numbers, such as a header, goes out unchanged. The functions that
+// allocate return 0, or -1 when out of memory or when a read or write
+// failed. Header-only.
+
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FloatText.h"
+#include "StrView.h"
+#include "Logarithm.h"
+#include "OutBuffer.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+enum
+{
+    INTEREST_SIMPLE,
+    INTEREST_COMPOUND
+};
+
+#define INTEREST_BATCH 1024
+#define INTEREST_BLOCK (1 << 20)
+#define INTEREST_LN2_HI 6.93147180369123816490e-01
+#define INTEREST_LN2_LO 1.90821492927058770002e-10
+#define INTEREST_EXP_MAX 709.0
+
+typedef struct
+{
+    size_t n;
+    double *principal;
+    double *rate;  // percent a year
+    double *years;
+} InterestBook;
+
+static inline int interestBookInit(InterestBook *b, size_t n)
+{
+    memset(b, 0, sizeof *b);
+    b->principal = (double *)malloc((n ? n : 1) * sizeof *b->principal);
+    b->rate = (double *)malloc((n ? n : 1) * sizeof *b->rate);
+    b->years = (double *)malloc((n ? n : 1) * sizeof *b->years);
+    if (b->principal == NULL || b->rate == NULL || b->years == NULL)
+    {
+        free(b->principal);
+        free(b->rate);
+        free(b->years);
+        memset(b, 0, sizeof *b);
+        return -1;
+    }
+    b->n = n;
+    return 0;
+}
+
+static inline void interestBookFree(InterestBook *b)
+{
+    free(b->principal);
+    free(b->rate);
+    free(b->years);
+    memset(b, 0, sizeof *b);
+}
+
+// (e^f - 1) for |f| <= ln 2 / 2: the Taylor series to f^13, whose
+// remainder is below 2^-56 of the result
+static inline double interestExpm1Reduced(double f)
+{
+    double p = 1.0 / 6227020800.0;
+    p = p * f + 1.0 / 479001600.0;
+    p = p * f + 1.0 / 39916800.0;
+    p = p * f + 1.0 / 3628800.0;
+    p = p * f + 1.0 / 362880.0;
+    p = p * f + 1.0 / 40320.0;
+    p = p * f + 1.0 / 5040.0;
+    p = p * f + 1.0 / 720.0;
+    p = p * f + 1.0 / 120.0;
+    p = p * f + 1.0 / 24.0;
+    p = p * f + 1.0 / 6.0;
+    p = p * f + 0.5;
+    return f + f * f * p;
+}
+
+// e^z - 1, with z = j ln 2 + f, j whole and |f| <= ln 2 / 2; for z past
+// INTEREST_EXP_MAX 2^j is taken as 2 2^(j - 1), so e^z is right up to
+// where it overflows
+static inline double interestExpm1(double z)
+{
+    double j, f, e, s, two = 1;
+    uint64_t bits;
+    if (z != z)
+        return z;
+    if (z > 710)
+        return 1.0 / 0.0;
+    if (z < -708)
+        z = -708;
+    // z / ln 2 to the nearest whole number, as 1.5 2^52 added leaves it
+    j = (z * 1.4426950408889634 + 0x1.8p52) - 0x1.8p52;
+    f = (z - j * INTEREST_LN2_HI) - j * INTEREST_LN2_LO;
+    e = interestExpm1Reduced(f);
+    if (z > INTEREST_EXP_MAX)
+    {
+        j -= 1;
+        two = 2;
+    }
+    bits = (uint64_t)((int64_t)j + 1023) << 52;
+    memcpy(&s, &bits, sizeof s);
+    return two == 1 ? s * e + (s - 1) : (s * e + s) * two - 1;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+// e^f - 1 for four z = j ln 2 + f in [-708, INTEREST_EXP_MAX], with 2^j
+// in *scale
+static inline __m256d interestExpParts(__m256d z, __m256d *scale)
+{
+    __m256d j = _mm256_round_pd(_mm256_mul_pd(z, _mm256_set1_pd(1.4426950408889634)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d f = _mm256_fnmadd_pd(j, _mm256_set1_pd(INTEREST_LN2_LO), _mm256_fnmadd_pd(j, _mm256_set1_pd(INTEREST_LN2_HI), z));
+    __m256d p = _mm256_set1_pd(1.0 / 6227020800.0), s;
+    // j + 1023 in the low bits of 2^52 + j + 1023, shifted up to the exponent
+    __m256i bits = _mm256_castpd_si256(_mm256_add_pd(j, _mm256_set1_pd(0x1p52 + 1023)));
+    s = _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 479001600.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 39916800.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 3628800.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 362880.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 40320.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 5040.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 720.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 120.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 24.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(1.0 / 6.0));
+    p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(0.5));
+    *scale = s;
+    return _mm256_fmadd_pd(_mm256_mul_pd(f, f), p, f);
+}
+
+// interestExpm1() on four z in [-708, INTEREST_EXP_MAX]
+static inline __m256d interestExpm1Vector(__m256d z)
+{
+    __m256d s, p = interestExpParts(z, &s);
+    return _mm256_fmadd_pd(s, p, _mm256_sub_pd(s, _mm256_set1_pd(1.0)));
+}
+
+// e^z itself, 2^j (e^f - 1) + 2^j, for four z in [-708, INTEREST_EXP_MAX]
+static inline __m256d interestExpVector(__m256d z)
+{
+    __m256d s, p = interestExpParts(z, &s);
+    return _mm256_fmadd_pd(s, p, s);
+}
+#endif
+
+// out[i] = e^z[i] - 1 for i < n; z may be out
+static inline void interestExpm1Array(const double *z, double *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(z + i);
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(x, _mm256_set1_pd(-708.0), _CMP_GE_OQ),
+                                   _mm256_cmp_pd(x, _mm256_set1_pd(INTEREST_EXP_MAX), _CMP_LE_OQ));
+        if (_mm256_movemask_pd(ok) == 15)
+            _mm256_storeu_pd(out + i, interestExpm1Vector(x));
+        else
+        {
+            size_t k;
+            for (k = i; k < i + 4; k++)
+                out[k] = interestExpm1(z[k]);
+        }
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = interestExpm1(z[i]);
+}
+
+static inline double simpleInterest(double principal, double rate, double years)
+{
+    return principal * rate * years / 100;
+}
+
+// log1p(x) from u = 1 + x and log(u)
+static inline double interestLog1p(double x, double u, double logU)
+{
+    return u == 1 ? x : logU * x / (u - 1);
+}
+
+// Compounded periods times a year, or continuously for periods 0
+static inline double compoundInterest(double principal, double rate, double years, double periods)
+{
+    double z;
+    if (periods > 0)
+    {
+        double x = rate / (100 * periods), u = 1 + x;
+        z = periods * years * interestLog1p(x, u, logScalar(u, LOG_E, LOG_EXACT));
+    }
+    else
+        z = rate * years / 100;
+    return principal * interestExpm1(z);
+}
+
+// out[i], the interest of account i of b, for every account
+static inline void interestArray(const InterestBook *b, int mode, double periods, double *out)
+{
+    size_t i, k, n;
+    if (mode == INTEREST_SIMPLE)
+    {
+        for (i = 0; i < b->n; i++)
+            out[i] = b->principal[i] * b->rate[i] * b->years[i] / 100;
+        return;
+    }
+    for (i = 0; i < b->n; i += n)
+    {
+        double u[INTEREST_BATCH], z[INTEREST_BATCH];
+        const double *r = b->rate + i, *t = b->years + i;
+        n = b->n - i < INTEREST_BATCH ? b->n - i : INTEREST_BATCH;
+        if (periods > 0)
+        {
+            for (k = 0; k < n; k++)
+                u[k] = 1 + r[k] / (100 * periods);
+            logArray(u, z, n, LOG_E, LOG_EXACT);
+            for (k = 0; k < n; k++)
+            {
+                double x = r[k] / (100 * periods);
+                z[k] = periods * t[k] * (u[k] == 1 ? x : z[k] * x / (u[k] - 1));
+            }
+        }
+        else
+            for (k = 0; k < n; k++)
+                z[k] = r[k] * t[k] / 100;
+        interestExpm1Array(z, z, n);
+        for (k = 0; k < n; k++)
+            out[i + k] = b->principal[i + k] * z[k];
+    }
+}
+
+// Every line of in to out with the interest of its principal, rate and
+// years, fields columns[0], [1] and [2], added at the end
+static inline int interestCsv(FILE *in, OutBuffer *out, const size_t columns[3], int mode, double periods,
+                              int decimals)
+{
+    size_t cap = INTEREST_BLOCK, len = 0, got;
+    char *buf = (char *)malloc(cap);
+    // per line of a batch: where it starts, where its text ends (0 when
+    // it has no numbers) and where it ends, past the newline
+    size_t *at = (size_t *)malloc(INTEREST_BATCH * 3 * sizeof *at);
+    double *v = (double *)malloc(INTEREST_BATCH * sizeof *v);
+    InterestBook b;
+    int eof = 0, rc = interestBookInit(&b, INTEREST_BATCH);
+    if (decimals < 0)
+        decimals = 0;
+    if (decimals > 9)
+        decimals = 9;
+    if (buf == NULL || at == NULL || v == NULL)
+        rc = -1;
+    while (rc == 0 && !eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, cap - len, in);
+        len += got;
+        if (got == 0)
+        {
+            eof = 1;
+            if (ferror(in))
+                rc = -1;
+        }
+        while (pos < len)
+        {
+            size_t k = 0, m = 0, i, j;
+            // the whole lines from pos, and at the end of input the last
+            // one even without a newline; the accounts go to b in order
+            while (k < INTEREST_BATCH && pos < len)
+            {
+                const char *line = buf + pos, *nl = (const char *)memchr(line, '\n', len - pos), *e;
+                size_t *l = at + 3 * k;
+                double x[3];
+                if (nl == NULL && !eof)
+                    break;
+                e = nl != NULL ? nl : buf + len;
+                if (e > line && e[-1] == '\r')
+                    e--;
+                l[0] = pos;
+                l[1] = (size_t)(e - buf);
+                l[2] = nl != NULL ? (size_t)(nl + 1 - buf) : len;
+                for (j = 0; j < 3; j++)
+                {
+                    StrView f;
+                    if (svField(svMake(line, (size_t)(e - line)), ',', columns[j], &f) != 0 ||
+                        parseDouble(f.p, f.p + f.n, &x[j]) != 0)
+                        break;
+                }
+                if (j == 3)
+                {
+                    b.principal[m] = x[0];
+                    b.rate[m] = x[1];
+                    b.years[m] = x[2];
+                    m++;
+                }
+                else
+                    l[1] = 0;
+                pos = l[2];
+                k++;
+            }
+            if (k == 0)
+                break;
+            b.n = m;
+            interestArray(&b, mode, periods, v);
+            for (i = 0, m = 0; i < k; i++)
+            {
+                const size_t *l = at + 3 * i;
+                if (l[1] == 0)
+                    outText(out, buf + l[0], l[2] - l[0]);
+                else
+                {
+                    outText(out, buf + l[0], l[1] - l[0]);
+                    outChar(out, ',');
+                    outFixed(out, v[m++], decimals);
+                    outText(out, buf + l[1], l[2] - l[1]);
+                }
+            }
+        }
+        // the part line left goes to the front, and a line longer than
+        // the buffer makes it bigger
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+        if (len == cap)
+        {
+            char *bigger = (char *)realloc(buf, cap * 2);
+            if (bigger == NULL)
+                rc = -1;
+            else
+            {
+                buf = bigger;
+                cap *= 2;
+            }
+        }
+    }
+    interestBookFree(&b);
+    free(buf);
+    free(at);
+    free(v);
+    return rc;
+}
+
+#endif
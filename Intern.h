@@ -0,0 +1,161 @@
+// A string interner, for Lexicographic_Sorting.c and other programs that
+// sort or count the same words over and over.
+//
+// Every distinct string is copied once into an Arena (Arena.h), with a
+// '\0' after it, and gets a 32-bit id, 0, 1, 2, ... in order of first
+// appearance; a StrMap (HashMap.h) from the text to the id finds a string
+// that is already in. After that a word is its id: two words are equal
+// when their ids are, a list of words is four bytes a word however long
+// they are, and the text of a corpus with many repeats takes the space of
+// its vocabulary, not of every occurrence. The arena's blocks never move,
+// so internString() views and the map's keys stay good until internFree().
+//
+// internRank() sorts the distinct strings once, byte by byte as memcmp
+// and strcmp order them, and gives each id its rank among them, 0 for
+// the smallest; from then on words are put in order by sorting ranks,
+// integers, or by counting them when there are many repeats. New strings
+// interned later have no rank until internRank() is called again.
+//
+//     Interner in;
+//     internInit(&in);
+//     id = internId(&in, word, len);          // INTERN_NONE: out of memory
+//     ...
+//     if (internRank(&in) == 0)
+//         ... in.rank[id] ...
+//     printf("%s\n", internString(&in, id).p);
+//     internFree(&in);
+//
+// internRank() returns 0, or -1 when out of memory. Header-only.
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arena.h"
+#include "HashMap.h"
+#include "SortLib.h"
+#include "StrView.h"
+
+#define INTERN_NONE UINT32_MAX
+
+typedef struct
+{
+    StrMap ids;       // text -> id
+    StrView *strings; // by id, views into text
+    uint32_t *rank;   // by id, after internRank(); NULL before
+    uint32_t count, capacity, ranked; // ranked: ids that have a rank
+    Arena text;
+} Interner;
+
+// an id and its string, for sorting the strings once
+typedef struct
+{
+    StrView s;
+    uint32_t id;
+} InternSorted;
+
+static inline int internLess(StrView a, StrView b)
+{
+    int c = memcmp(a.p, b.p, a.n < b.n ? a.n : b.n);
+    return c < 0 || (c == 0 && a.n < b.n);
+}
+
+#define INTERN_LESS(x, y) internLess((x).s, (y).s)
+
+SORTLIB_DEFINE(intern, InternSorted, INTERN_LESS)
+
+static inline void internInit(Interner *in)
+{
+    strMapInit(&in->ids);
+    in->strings = NULL;
+    in->rank = NULL;
+    in->count = in->capacity = in->ranked = 0;
+    arenaInit(&in->text, 0, 0);
+}
+
+static inline void internFree(Interner *in)
+{
+    strMapFree(&in->ids);
+    free(in->strings);
+    free(in->rank);
+    arenaDestroy(&in->text);
+    in->strings = NULL;
+    in->rank = NULL;
+    in->count = in->capacity = in->ranked = 0;
+}
+
+// The id of the n bytes at s, which are copied in the first time
+static inline uint32_t internId(Interner *in, const char *s, size_t n)
+{
+    int added;
+    StrMapEntry *e;
+    char *copy;
+    if (in->count == INTERN_NONE)
+        return INTERN_NONE;
+    if ((e = strMapInsert(&in->ids, svMake(s, n), &added)) == NULL)
+        return INTERN_NONE;
+    if (!added)
+        return (uint32_t)e->value;
+    if (in->count == in->capacity)
+    {
+        uint32_t capacity = in->capacity ? (in->capacity < INTERN_NONE / 2 ? in->capacity * 2 : INTERN_NONE) : 1024;
+        StrView *bigger = (StrView *)realloc(in->strings, capacity * sizeof *bigger);
+        if (bigger == NULL)
+        {
+            strMapRemove(&in->ids, svMake(s, n));
+            return INTERN_NONE;
+        }
+        in->strings = bigger;
+        in->capacity = capacity;
+    }
+    if ((copy = arenaStrdup(&in->text, s, n)) == NULL)
+    {
+        strMapRemove(&in->ids, svMake(s, n));
+        return INTERN_NONE;
+    }
+    // the key pointed at s until now
+    e->key = in->strings[in->count] = svMake(copy, n);
+    e->value = in->count;
+    return in->count++;
+}
+
+// The string of id, with a '\0' after its n bytes
+static inline StrView internString(const Interner *in, uint32_t id)
+{
+    return in->strings[id];
+}
+
+// rank[id] = where string id comes among all the distinct strings
+static inline int internRank(Interner *in)
+{
+    InternSorted *order;
+    uint32_t *rank, i;
+    if (in->ranked == in->count && in->rank != NULL)
+        return 0;
+    order = (InternSorted *)malloc((in->count ? in->count : 1) * sizeof *order);
+    rank = (uint32_t *)realloc(in->rank, (in->count ? in->count : 1) * sizeof *rank);
+    if (order == NULL || rank == NULL)
+    {
+        free(order);
+        if (rank != NULL)
+            in->rank = rank;
+        return -1;
+    }
+    in->rank = rank;
+    for (i = 0; i < in->count; i++)
+    {
+        order[i].s = in->strings[i];
+        order[i].id = i;
+    }
+    sort_intern(order, in->count);
+    for (i = 0; i < in->count; i++)
+        rank[order[i].id] = i;
+    in->ranked = in->count;
+    free(order);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,675 @@
+// Kernel benchmark: times the search, number theory, string and
+// conversion kernels of this repository, and compares two such runs.
+//
+//   KernelBenchmark [--sizes 1000,100000,...] [--kernels name,name,...]
+//                   [--repeats R] [--min-time MS] [--warmup MS] [--cpu C]
+//                   [--seed S] [--hit-rate P] [--alphabet K] [--bits B]
+//   KernelBenchmark --compare OLD.csv NEW.csv [--threshold PCT]
+//
+// Every kernel gets a fresh input of size n from the generators below,
+// the same for every kernel of that n and seed whichever kernels are
+// chosen, so binary and eytzinger search the same array; it runs untimed, and is then timed R times (default 15). A timed run
+// repeats the kernel as many times as it takes to last --min-time (1 ms),
+// so small sizes are not lost in the clock. Columns: kernel, unit, n, the
+// generator parameters, repeats, the median, the median absolute deviation
+// and the minimum of the runs in ns per unit, and a checksum of the
+// kernel's results, which two builds of the same code must agree on.
+//
+// The generators: sorted ints with random gaps of 2 to 4, and lookups of
+// which the fraction --hit-rate (0.5) are keys and the rest fall in the
+// gaps; text of --alphabet (26) letters, where a small alphabet makes
+// many false candidates for the substring search; numbers of --bits (64)
+// random bits. Sizes may be written as 1e6.
+//
+// The clock speed moves under a benchmark: a core that was idle starts
+// slow and turbo fades as it warms. Before the first kernel a calibration
+// loop spins for at least --warmup ms (200) and until two timings of it
+// agree within 1%, and --cpu C pins the program to CPU C so it is not
+// moved halfway. The frequency governor is printed to stderr when it is
+// not "performance"; setting it needs root, so it is left as it is.
+//
+// --compare matches the rows of two such CSV files by kernel, n and
+// parameters. A row is a regression, or an improvement, when its median
+// moved by more than --threshold percent (5) and by more than three
+// standard errors: each median's error is taken as 1.2533 x 1.4826 MAD /
+// sqrt(R), the normal-theory error of a median with the MAD as a robust
+// standard deviation. A checksum that differs is reported too. The exit
+// status is 1 when there was a regression or a wrong checksum. The MAD
+// only sees the noise within a run: on a shared or virtual machine whole
+// runs of one build can differ by more (four runs of the same binary on
+// the machine this was written on were up to 20% apart on some kernels),
+// so there the threshold is what keeps the comparison honest.
+//
+// The kernels are those the programs use, from the headers or, for the
+// two that live in a program, from the program itself, included with its
+// main renamed, so a change to the program is what gets measured:
+//   binary     searchSorted from SimdSearch.h         BinarySearch.c
+//   eytzinger  eytzingerLowerBound from Eytzinger.h    BinarySearch.c
+//   linear     simdFind from SimdSearch.h              linearsearch.c
+//   substring  FindSubString                           HaystackAndNeedle_SubString.c
+//   gcd        gcd64 from Gcd.h                        gcd.c
+//   modpow     modPow from ModArith.h                  fastModuloExponentiation.c
+//   ncr        binomModQuery from Binomial.h, mod 999999 = 3^3 7 11 13 37
+//                                                      nCrCalculatorLargeNumbers.c
+//   sieve      sievePrimes                             PrimeByEratosthenes.c
+//   case       skToUpper / skToLower in turn           LowercaseToUppercase.c
+//   reverse    skReverse from StringKernels.h          StringReverse.c
+//   snake      skCamelToSnake from StringKernels.h     camelcase.c
+//   dec        u64ToDec from IntText.h                 DecimalToBaseN.c
+//   hex        hexEncode from Hex.h                    DecimalToHexadecimalViceVersa.c
+//
+// Build with -pthread.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <sched.h>
+#include <time.h>
+#include "SimdSearch.h"
+#include "Eytzinger.h"
+#include "Gcd.h"
+#include "ModArith.h"
+#include "Binomial.h"
+#include "StringKernels.h"
+#include "IntText.h"
+#include "Hex.h"
+#include "SortLib.h"
+
+#define main substring_main
+#include "HaystackAndNeedle_SubString.c"
+#undef main
+#define main sieve_main
+#include "PrimeByEratosthenes.c"
+#undef main
+
+#define LOOKUPS 16384 // a run of binary and eytzinger
+#define LINEAR_LOOKUPS 64
+#define NEEDLE 16
+#define NCR_MOD 999999
+
+static double hit_rate = 0.5;
+static int alphabet = 26, bits = 64;
+
+// xorshift64*, as in SortBenchmark.c, started again from seed for every input
+static uint64_t seed = 88172645463325252ULL, rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ULL;
+}
+
+static uint64_t rng_bits(void) {
+  return bits >= 64 ? rng() : rng() >> (64 - bits);
+}
+
+// Everything a kernel's run needs, made by its setup
+typedef struct {
+  size_t n, units; // units is how many a run handles
+  int * sorted, * lookups;
+  size_t nlookups;
+  EytzingerIndex index;
+  char * text, * out;
+  char needle[NEEDLE];
+  uint64_t * a, * b, mod;
+  const BinomMod * binom;
+  int flip;
+} Input;
+
+typedef struct {
+  const char * name;
+  const char * unit;
+  int (* setup)(Input * in, size_t n);
+  uint64_t (* run)(Input * in); // returns a checksum of the results
+} Kernel;
+
+// n sorted ints with gaps of 2 to 4, and m lookups, hit_rate of them keys
+static int gen_search(Input * in, size_t n, size_t m) {
+  size_t i;
+  int v = 0;
+  in -> sorted = malloc((n ? n : 1) * sizeof * in -> sorted);
+  in -> lookups = malloc(m * sizeof * in -> lookups);
+  if (in -> sorted == NULL || in -> lookups == NULL)
+    return -1;
+  for (i = 0; i < n; i++) {
+    v += 2 + (int)(rng() % 3);
+    in -> sorted[i] = v;
+  }
+  for (i = 0; i < m; i++) {
+    size_t at = n ? rng() % n : 0;
+    int hit = (double)(rng() >> 11) / 9007199254740992.0 < hit_rate;
+    in -> lookups[i] = n == 0 ? 0 : hit ? in -> sorted[at] : in -> sorted[at] - 1;
+  }
+  in -> nlookups = m;
+  in -> units = m;
+  return 0;
+}
+
+// n letters from the first alphabet letters of a..z
+static int gen_text(Input * in, size_t n, size_t out) {
+  size_t i;
+  in -> text = malloc(n + 1);
+  in -> out = malloc(out + 1);
+  if (in -> text == NULL || in -> out == NULL)
+    return -1;
+  for (i = 0; i < n; i++)
+    in -> text[i] = (char)('a' + rng() % alphabet);
+  in -> text[n] = '\0';
+  in -> units = n;
+  return 0;
+}
+
+// n pairs of numbers of bits bits
+static int gen_numbers(Input * in, size_t n) {
+  size_t i;
+  in -> a = malloc((n ? n : 1) * sizeof * in -> a);
+  in -> b = malloc((n ? n : 1) * sizeof * in -> b);
+  if (in -> a == NULL || in -> b == NULL)
+    return -1;
+  for (i = 0; i < n; i++) {
+    in -> a[i] = rng_bits();
+    in -> b[i] = rng_bits();
+  }
+  in -> units = n;
+  return 0;
+}
+
+static void input_free(Input * in) {
+  free(in -> sorted);
+  free(in -> lookups);
+  eytzingerFree( & in -> index);
+  free(in -> text);
+  free(in -> out);
+  free(in -> a);
+  free(in -> b);
+  memset(in, 0, sizeof * in);
+}
+
+static int setup_binary(Input * in, size_t n) {
+  return gen_search(in, n, LOOKUPS);
+}
+
+static uint64_t run_binary(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> nlookups; i++)
+    sum += searchSorted(in -> sorted, in -> n, in -> lookups[i]);
+  return sum;
+}
+
+static int setup_eytzinger(Input * in, size_t n) {
+  if (gen_search(in, n, LOOKUPS) != 0)
+    return -1;
+  return eytzingerBuild( & in -> index, in -> sorted, n);
+}
+
+static uint64_t run_eytzinger(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> nlookups; i++)
+    sum += eytzingerLowerBound( & in -> index, in -> lookups[i]);
+  return sum;
+}
+
+static int setup_linear(Input * in, size_t n) {
+  return gen_search(in, n, LINEAR_LOOKUPS);
+}
+
+static uint64_t run_linear(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> nlookups; i++)
+    sum += simdFind(in -> sorted, in -> n, in -> lookups[i]);
+  return sum;
+}
+
+// The needle is from near the end of the text with probability hit_rate,
+// so that a hit is found only after a scan of nearly all of it
+static int setup_substring(Input * in, size_t n) {
+  size_t i;
+  if (gen_text(in, n, 0) != 0)
+    return -1;
+  if (n >= 2 * NEEDLE && (double)(rng() >> 11) / 9007199254740992.0 < hit_rate)
+    memcpy(in -> needle, in -> text + n - 2 * NEEDLE + rng() % NEEDLE, NEEDLE);
+  else
+    for (i = 0; i < NEEDLE; i++)
+      in -> needle[i] = (char)('a' + rng() % alphabet);
+  return 0;
+}
+
+static uint64_t run_substring(Input * in) {
+  return (uint64_t) FindSubString(in -> text, (long) in -> n, in -> needle, NEEDLE);
+}
+
+static int setup_gcd(Input * in, size_t n) {
+  return gen_numbers(in, n);
+}
+
+static uint64_t run_gcd(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> n; i++)
+    sum += gcd64(in -> a[i], in -> b[i]);
+  return sum;
+}
+
+// base a[i], exponent b[i], and an odd modulus of bits bits
+static int setup_modpow(Input * in, size_t n) {
+  if (gen_numbers(in, n) != 0)
+    return -1;
+  in -> mod = rng_bits() | 1;
+  if (in -> mod < 3)
+    in -> mod = 3;
+  return 0;
+}
+
+static uint64_t run_modpow(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> n; i++)
+    sum += modPow(in -> a[i], in -> b[i], in -> mod);
+  return sum;
+}
+
+// C(a, b) with a of up to 32 bits and b <= a
+static int setup_ncr(Input * in, size_t n) {
+  size_t i;
+  if (gen_numbers(in, n) != 0 || (in -> binom = binomModGet(NCR_MOD)) == NULL)
+    return -1;
+  for (i = 0; i < n; i++) {
+    in -> a[i] >>= bits > 32 ? bits - 32 : 0;
+    in -> b[i] = in -> a[i] ? in -> b[i] % (in -> a[i] + 1) : 0;
+  }
+  return 0;
+}
+
+static uint64_t run_ncr(Input * in) {
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < in -> n; i++)
+    sum += binomModQuery(in -> binom, in -> a[i], in -> b[i]);
+  return sum;
+}
+
+static int setup_sieve(Input * in, size_t n) {
+  in -> units = n ? n : 1;
+  return 0;
+}
+
+static uint64_t run_sieve(Input * in) {
+  return sievePrimes(0, in -> n, NULL, NULL);
+}
+
+static int setup_text(Input * in, size_t n) {
+  return gen_text(in, n, 2 * n);
+}
+
+static uint64_t checksum(const char * s, size_t n) {
+  uint64_t h = 1469598103934665603ULL; // FNV-1a of a sample of the bytes
+  size_t i, step = n / 64 + 1;
+  for (i = 0; i < n; i += step)
+    h = (h ^ (unsigned char) s[i]) * 1099511628211ULL;
+  return h ^ n;
+}
+
+// upper case and back again in turn, so every run has letters to change;
+// the checksum is of the lower case, the same after any number of runs
+static uint64_t run_case(Input * in) {
+  uint64_t h = in -> n;
+  size_t i;
+  if ((in -> flip ^= 1) != 0)
+    skToUpper(in -> text, in -> n);
+  else
+    skToLower(in -> text, in -> n);
+  for (i = 0; i < in -> n; i += in -> n / 64 + 1)
+    h = (h ^ (unsigned char)(in -> text[i] | 0x20)) * 1099511628211ULL;
+  return h;
+}
+
+// the checksum adds up (i + 1) text[i] text[n - 1 - i], which reversing keeps
+static uint64_t run_reverse(Input * in) {
+  uint64_t h = in -> n;
+  size_t i;
+  skReverse(in -> text, in -> n);
+  for (i = 0; i < in -> n; i += in -> n / 64 + 1)
+    h += (uint64_t)(unsigned char) in -> text[i] * (unsigned char) in -> text[in -> n - 1 - i] * (i + 1);
+  return h;
+}
+
+// camelCase text: a fifth of the letters are capitals
+static int setup_snake(Input * in, size_t n) {
+  size_t i;
+  if (setup_text(in, n) != 0)
+    return -1;
+  for (i = 0; i < n; i++)
+    if (rng() % 5 == 0)
+      in -> text[i] = (char)(in -> text[i] - 'a' + 'A');
+  return 0;
+}
+
+static uint64_t run_snake(Input * in) {
+  size_t len = skCamelToSnake(in -> text, in -> n, in -> out);
+  return checksum(in -> out, len);
+}
+
+static int setup_dec(Input * in, size_t n) {
+  if (gen_numbers(in, n) != 0)
+    return -1;
+  free(in -> out);
+  if ((in -> out = malloc(20 * (n ? n : 1))) == NULL)
+    return -1;
+  return 0;
+}
+
+static uint64_t run_dec(Input * in) {
+  size_t i, len = 0;
+  for (i = 0; i < in -> n; i++)
+    len += u64ToDec(in -> a[i] >> (in -> b[i] % 64), in -> out + len);
+  return checksum(in -> out, len);
+}
+
+static uint64_t run_hex(Input * in) {
+  hexEncode((const unsigned char *) in -> text, in -> n, in -> out, 0);
+  return checksum(in -> out, 2 * in -> n);
+}
+
+static const Kernel kernels[] = {
+  { "binary", "lookup", setup_binary, run_binary },
+  { "eytzinger", "lookup", setup_eytzinger, run_eytzinger },
+  { "linear", "lookup", setup_linear, run_linear },
+  { "substring", "byte", setup_substring, run_substring },
+  { "gcd", "pair", setup_gcd, run_gcd },
+  { "modpow", "power", setup_modpow, run_modpow },
+  { "ncr", "query", setup_ncr, run_ncr },
+  { "sieve", "number", setup_sieve, run_sieve },
+  { "case", "byte", setup_text, run_case },
+  { "reverse", "byte", setup_text, run_reverse },
+  { "snake", "byte", setup_snake, run_snake },
+  { "dec", "number", setup_dec, run_dec },
+  { "hex", "byte", setup_text, run_hex },
+};
+
+#define NKERNELS (sizeof kernels / sizeof kernels[0])
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, & t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// 1 if name is one of the comma-separated names in list, or list is NULL
+static int selected(const char * list, const char * name) {
+  size_t len = strlen(name);
+  const char * p = list;
+  if (list == NULL)
+    return 1;
+  while ((p = strstr(p, name)) != NULL) {
+    if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+      return 1;
+    p += len;
+  }
+  return 0;
+}
+
+// The median of x[0 .. n), which it sorts
+static double median(double * x, size_t n) {
+  sort_f64(x, n);
+  return n % 2 ? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2;
+}
+
+// The median absolute deviation from m
+static double mad(const double * x, size_t n, double m) {
+  double * d = malloc(n * sizeof * d), r;
+  size_t i;
+  if (d == NULL)
+    return 0;
+  for (i = 0; i < n; i++)
+    d[i] = fabs(x[i] - m);
+  r = median(d, n);
+  free(d);
+  return r;
+}
+
+// A dependent chain of multiplies and adds: its time moves only with the
+// clock speed
+static double calibrate(void) {
+  volatile uint64_t sink;
+  uint64_t x = 1;
+  double t = now();
+  long i;
+  for (i = 0; i < 2000000; i++)
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  sink = x;
+  (void) sink;
+  return now() - t;
+}
+
+static void warm_up(double ms) {
+  double start = now(), last = calibrate(), t;
+  char governor[64] = "";
+  FILE * f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor", "r");
+  if (f != NULL) {
+    if (fgets(governor, sizeof governor, f) != NULL)
+      governor[strcspn(governor, "\n")] = '\0';
+    fclose(f);
+  }
+  if (governor[0] != '\0' && strcmp(governor, "performance") != 0)
+    fprintf(stderr, "The CPU frequency governor is \"%s\", not \"performance\": expect the clock to move\n", governor);
+  for (;;) {
+    t = calibrate();
+    if ((now() - start) * 1e3 >= ms && fabs(t - last) <= 0.01 * last)
+      break;
+    if ((now() - start) * 1e3 >= 10 * ms + 2000) {
+      fprintf(stderr, "The clock did not settle in the warm-up\n");
+      break;
+    }
+    last = t;
+  }
+}
+
+static int bench(const char * sizes, const char * only, int repeats, double min_time) {
+  double * runs = malloc(repeats * sizeof * runs);
+  const char * p;
+  size_t k;
+  if (runs == NULL)
+    return 1;
+  printf("kernel,unit,n,params,repeats,ns_median,ns_mad,ns_min,checksum\n");
+  for (p = sizes; * p != '\0';) {
+    char * end;
+    size_t n = (size_t) strtod(p, & end);
+    if (end == p)
+      break;
+    p = * end == ',' ? end + 1 : end;
+
+    for (k = 0; k < NKERNELS; k++) {
+      Input in;
+      uint64_t sum;
+      size_t inner = 1, i;
+      double best = 1e300, m;
+      int r;
+
+      if (!selected(only, kernels[k].name))
+        continue;
+      memset( & in, 0, sizeof in);
+      in.n = n;
+      rng_state = (seed ^ n * 0x9e3779b97f4a7c15ULL) | 1;
+      if (kernels[k].setup( & in, n) != 0) {
+        fprintf(stderr, "%s: out of memory for n = %zu\n", kernels[k].name, n);
+        input_free( & in);
+        continue;
+      }
+      // the untimed run, and the repeats a timed run needs
+      for (;;) {
+        double t = now();
+        for (i = 0; i < inner; i++)
+          sum = kernels[k].run( & in);
+        t = now() - t;
+        if (t * 1e3 >= min_time || inner >= ((size_t) 1 << 30))
+          break;
+        inner = t * 1e3 * 4 < min_time ? inner * 4 : inner * 2;
+      }
+      for (r = 0; r < repeats; r++) {
+        double t = now();
+        for (i = 0; i < inner; i++)
+          sum = kernels[k].run( & in);
+        t = now() - t;
+        runs[r] = t * 1e9 / ((double) inner * (in.units ? in.units : 1));
+        if (runs[r] < best)
+          best = runs[r];
+      }
+      m = median(runs, repeats);
+      printf("%s,%s,%zu,h%.2f a%d b%d,%d,%.4f,%.4f,%.4f,%016llx\n", kernels[k].name, kernels[k].unit, n,
+        hit_rate, alphabet, bits, repeats, m, mad(runs, repeats, m), best, (unsigned long long) sum);
+      fflush(stdout);
+      input_free( & in);
+    }
+  }
+  free(runs);
+  return 0;
+}
+
+typedef struct {
+  char key[128]; // kernel,unit,n,params
+  int repeats;
+  double median, mad;
+  char checksum[32];
+} Row;
+
+// The rows of a CSV file written by bench(), or NULL
+static Row * read_rows(const char * path, size_t * count) {
+  FILE * f = fopen(path, "r");
+  Row * rows = NULL, row;
+  size_t cap = 0;
+  char line[512];
+  * count = 0;
+  if (f == NULL) {
+    perror(path);
+    return NULL;
+  }
+  while (fgets(line, sizeof line, f) != NULL) {
+    char * field[9], * s = line;
+    int nf = 0;
+    while (nf < 9 && (field[nf] = strsep( & s, ",\n")) != NULL)
+      nf++;
+    if (nf < 9 || strcmp(field[0], "kernel") == 0)
+      continue;
+    snprintf(row.key, sizeof row.key, "%s,%s,%s,%s", field[0], field[1], field[2], field[3]);
+    row.repeats = atoi(field[4]);
+    row.median = strtod(field[5], NULL);
+    row.mad = strtod(field[6], NULL);
+    snprintf(row.checksum, sizeof row.checksum, "%s", field[8]);
+    if ( * count == cap) {
+      Row * more = realloc(rows, (cap = cap ? 2 * cap : 64) * sizeof * rows);
+      if (more == NULL)
+        break;
+      rows = more;
+    }
+    rows[( * count) ++] = row;
+  }
+  fclose(f);
+  return rows;
+}
+
+// The standard error of a median over r runs with this MAD
+static double median_error(double mad, int r) {
+  return 1.2533 * 1.4826 * mad / sqrt(r > 0 ? r : 1);
+}
+
+static int compare(const char * old_path, const char * new_path, double threshold) {
+  size_t nold, nnew, i, j;
+  Row * old = read_rows(old_path, & nold), * cur = read_rows(new_path, & nnew);
+  int bad = 0;
+  if (old == NULL || cur == NULL) {
+    free(old);
+    free(cur);
+    return 1;
+  }
+  printf("kernel,unit,n,params,old_median,new_median,change_pct,z,verdict\n");
+  for (i = 0; i < nnew; i++) {
+    const Row * a = NULL, * b = & cur[i];
+    double change, se, z;
+    const char * verdict = "same";
+    for (j = 0; j < nold && a == NULL; j++)
+      if (strcmp(old[j].key, b -> key) == 0)
+        a = & old[j];
+    if (a == NULL) {
+      printf("%s,,%.4f,,,new\n", b -> key, b -> median);
+      continue;
+    }
+    change = a -> median > 0 ? (b -> median - a -> median) / a -> median * 100 : 0;
+    se = sqrt(median_error(a -> mad, a -> repeats) * median_error(a -> mad, a -> repeats) +
+      median_error(b -> mad, b -> repeats) * median_error(b -> mad, b -> repeats));
+    z = se > 0 ? (b -> median - a -> median) / se : (b -> median == a -> median ? 0 : copysign(INFINITY, change));
+    if (fabs(change) > threshold && fabs(z) > 3)
+      verdict = change > 0 ? "REGRESSION" : "improvement";
+    if (strcmp(a -> checksum, b -> checksum) != 0)
+      verdict = "WRONG CHECKSUM";
+    bad |= verdict[0] == 'R' || verdict[0] == 'W';
+    printf("%s,%.4f,%.4f,%+.2f,%.1f,%s\n", b -> key, a -> median, b -> median, change, z, verdict);
+  }
+  free(old);
+  free(cur);
+  return bad;
+}
+
+int main(int argc, char * argv[]) {
+  const char * sizes = "1000,100000,10000000", * only = NULL;
+  int repeats = 15, cpu = -1, i;
+  double min_time = 1, warmup = 200, threshold = 5;
+
+  if (argc >= 4 && strcmp(argv[1], "--compare") == 0) {
+    if (argc == 6 && strcmp(argv[4], "--threshold") == 0)
+      threshold = strtod(argv[5], NULL);
+    else if (argc != 4) {
+      printf("Usage: %s --compare OLD.csv NEW.csv [--threshold PCT]\n", argv[0]);
+      return 1;
+    }
+    return compare(argv[2], argv[3], threshold);
+  }
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+      sizes = argv[++i];
+    else if (strcmp(argv[i], "--kernels") == 0 && i + 1 < argc)
+      only = argv[++i];
+    else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+      repeats = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+      min_time = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+      warmup = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc)
+      cpu = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      seed = strtoull(argv[++i], NULL, 10) | 1;
+    else if (strcmp(argv[i], "--hit-rate") == 0 && i + 1 < argc)
+      hit_rate = strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--alphabet") == 0 && i + 1 < argc)
+      alphabet = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc)
+      bits = atoi(argv[++i]);
+    else {
+      printf("Usage: %s [--sizes N,N,...] [--kernels a,b] [--repeats R] [--min-time MS] [--warmup MS] [--cpu C]\n"
+        "       [--seed S] [--hit-rate P] [--alphabet K] [--bits B]\n"
+        "       %s --compare OLD.csv NEW.csv [--threshold PCT]\n", argv[0], argv[0]);
+      return 1;
+    }
+  }
+  if (repeats < 1)
+    repeats = 1;
+  if (alphabet < 1 || alphabet > 26)
+    alphabet = 26;
+  if (bits < 1 || bits > 64)
+    bits = 64;
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO( & set);
+    CPU_SET(cpu, & set);
+    if (sched_setaffinity(0, sizeof set, & set) != 0)
+      perror("sched_setaffinity");
+  }
+  warm_up(warmup);
+  return bench(sizes, only, repeats, min_time);
+}
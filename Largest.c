@@ -1,29 +1,148 @@
+//Largest number of an array. The search is reduce_argmax_i32() from
+//Reduce.h: vectorized, and split over all CPUs when the array is big.
+//Run with --bench N to time it on N random numbers of each type against
+//a plain loop. With --fast-input the numbers are read through
+//FastInput.h instead of one scanf() each. Build with -pthread.
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<unistd.h>
+#include "FastInput.h"
+#include "Reduce.h"
 
-void main()
+double now()
 {
-    int size, i, max;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//best of five, in ms
+#define TIME(result, expr)                      \
+    do                                          \
+    {                                           \
+        int rep_;                               \
+        double best_ = 1e9, start_;             \
+        for(rep_ = 0; rep_ < 5; rep_++)         \
+        {                                       \
+            start_ = now();                     \
+            result = (expr);                    \
+            if(now() - start_ < best_)          \
+                best_ = now() - start_;         \
+        }                                       \
+        printf(" %9.3f", best_ * 1e3);          \
+    } while(0)
+
+size_t plain_argmax(const int *a, size_t n)
+{
+    size_t i, pos = 0;
+    for(i = 1; i < n; i++)
+        if(a[i] > a[pos])
+            pos = i;
+    return pos;
+}
+
+int bench(size_t n, TaskPool *pool)
+{
+    int32_t *i32 = malloc(n * sizeof *i32);
+    int64_t *i64 = malloc(n * sizeof *i64);
+    float *f32 = malloc(n * sizeof *f32);
+    double *f64 = malloc(n * sizeof *f64);
+    unsigned long long seed = 1;
+    size_t i, want, got[6];
+    int bad = 0;
+    if(i32 == NULL || i64 == NULL || f32 == NULL || f64 == NULL || n == 0)
+    {
+        printf("Cannot make %zu numbers\n", n);
+        return 1;
+    }
+    for(i = 0; i < n; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        i32[i] = (int32_t)(seed >> 32);
+        i64[i] = i32[i];
+        f32[i] = (float)i32[i];
+        f64[i] = i32[i];
+    }
+    printf("%zu numbers, %d threads, ms (best of 5)\n", n, pool->nthreads);
+    printf("%-8s %9s %9s %9s\n", "", "plain", "1 thread", "pool");
+    printf("%-8s", "argmax");
+    TIME(want, plain_argmax(i32, n));
+    TIME(got[0], reduce_argmax_i32(NULL, i32, n));
+    TIME(got[1], reduce_argmax_i32(pool, i32, n));
+    printf("\n%-8s %9s", "i64", "");
+    TIME(got[2], reduce_argmax_i64(pool, i64, n));
+    printf("\n%-8s %9s", "f32", "");
+    TIME(got[3], reduce_argmax_f32(pool, f32, n));
+    printf("\n%-8s %9s", "f64", "");
+    TIME(got[4], reduce_argmax_f64(pool, f64, n));
+    printf("\n");
+    //the float copies may round two different ints to the same value
+    bad = got[0] != want || got[1] != want || got[2] != want || f32[got[3]] != f32[want] || got[4] != want;
+    {
+        int32_t min, max;
+        printf("%-8s %9s", "minmax", "");
+        TIME(got[5], (reduce_minmax_i32(pool, i32, n, &min, &max), 0));
+        printf("\n");
+        bad |= max != i32[want];
+    }
+    free(i32);
+    free(i64);
+    free(f32);
+    free(f64);
+    if(bad)
+        printf("The results disagree\n");
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    int size, i, fast_input = argc > 1 && strcmp(argv[1], "--fast-input") == 0;
     int *array;
+    TaskPool pool;
+    FastInput in;
+    if(poolCreate(&pool, (int)sysconf(_SC_NPROCESSORS_ONLN)) != 0)
+    {
+        printf("Cannot start the threads\n");
+        return 1;
+    }
+    if(argc > 2 && strcmp(argv[1], "--bench") == 0)
+    {
+        int bad = bench(strtoull(argv[2], NULL, 10), &pool);
+        poolDestroy(&pool);
+        return bad;
+    }
+    if(fast_input && fastInputOpen(&in, stdin) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
     printf("Enter number of numbers: ");
-    scanf("%d", &size);
     //creating an array of entered size
-    array = malloc(size * sizeof(int));
+    if((fast_input ? fastReadInt(&in, &size) != 0 : scanf("%d", &size) != 1) || size < 1 ||
+       (array = malloc(size * sizeof(int))) == NULL)
+    {
+        printf("Enter at least one number\n");
+        return 1;
+    }
     printf("Enter %d numbers: \n", size);
     //accepting each number and adding them in the array
-    for(i=0; i<size; i++)
+    if(fast_input)
     {
-        scanf("%d", &array[i]);
+        fastReadInts(&in, array, size);
+        fastInputClose(&in);
     }
-    max = array[0];
-    //traversing the array and comparing each element to integer max
-    for(i=1; i<size; i++)
+    else
     {
-        if(array[i] > max)
+        for(i=0; i<size; i++)
         {
-            max = array[i];
+            scanf("%d", &array[i]);
         }
     }
-    //printing the integer max
-    printf("The largest number is %d\n", max);
+    //printing the largest
+    printf("The largest number is %d\n", array[reduce_argmax_i32(&pool, array, size)]);
+    free(array);
+    poolDestroy(&pool);
+    return 0;
 }
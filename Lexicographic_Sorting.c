@@ -1,11 +1,296 @@
 // Lexicographic sorting is the way of sorting words based on the alphabetical order of their component letters.
+//
+// Run with a file name (or - for stdin) to sort any number of words of
+// any length: lexsort words.txt
+// Those are sorted by pointer with multikey quicksort, so no string is
+// ever copied.
+// With --intern (lexsort --intern words.txt) the input is read in pieces
+// and every distinct word is kept once (Intern.h) with a count: for a
+// corpus with many repeats memory grows with the vocabulary rather than
+// with the text, only the distinct words are sorted, and the output is
+// the same.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-void main()
+#include "Intern.h"
+
+#define READ_PIECE (1 << 16)
+
+// byte d of s, as unsigned so that bytes above 127 sort like strcmp
+#define CHAR_AT(s, d) ((unsigned char)(s)[d])
+
+static void swapStr(char **a, char **b)
+{
+    char *t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// sorts strings that share their first d bytes
+static void insertionSort(char **a, size_t n, size_t d)
+{
+    size_t i, j;
+    for (i = 1; i < n; i++)
+    {
+        for (j = i; j > 0 && strcmp(a[j - 1] + d, a[j] + d) > 0; j--)
+        {
+            swapStr(&a[j - 1], &a[j]);
+        }
+    }
+}
+
+static size_t med3(char **a, size_t i, size_t j, size_t k, size_t d)
+{
+    int x = CHAR_AT(a[i], d), y = CHAR_AT(a[j], d), z = CHAR_AT(a[k], d);
+    if (x < y)
+        return y < z ? j : (x < z ? k : i);
+    return y > z ? j : (x < z ? i : k);
+}
+
+// Multikey (three-way radix) quicksort, Bentley and Sedgewick.
+// All strings a[0..n-1] share their first d bytes. They are split
+// three ways on byte d: less than, equal to and greater than the pivot
+// byte. Only the "equal" part moves on to byte d + 1, so each byte is
+// looked at about once per string and no full strcmp is needed.
+void multikeyQuicksort(char **a, size_t n, size_t d)
+{
+    while (n > 1)
+    {
+        size_t lt, gt, i;
+        int pivot;
+
+        if (n < 16)
+        {
+            insertionSort(a, n, d);
+            return;
+        }
+
+        swapStr(&a[0], &a[med3(a, 0, n / 2, n - 1, d)]);
+        pivot = CHAR_AT(a[0], d);
+
+        // a[0..lt) < pivot, a[lt..i) == pivot, a(gt..n) > pivot
+        lt = 0;
+        gt = n - 1;
+        i = 1;
+        while (i <= gt)
+        {
+            int c = CHAR_AT(a[i], d);
+            if (c < pivot)
+                swapStr(&a[lt++], &a[i++]);
+            else if (c > pivot)
+                swapStr(&a[i], &a[gt--]);
+            else
+                i++;
+        }
+
+        multikeyQuicksort(a, lt, d);
+        multikeyQuicksort(a + gt + 1, n - gt - 1, d);
+
+        // the equal part goes on to the next byte, unless every string
+        // in it has already ended
+        if (pivot == 0)
+            return;
+        a += lt;
+        n = gt + 1 - lt;
+        d++;
+    }
+}
+
+// Reads every whitespace-separated word of fp, sorts and prints them
+int sortWords(FILE *fp)
+{
+    char *text = NULL, **words = NULL, *p;
+    size_t size = 0, cap = 0, got, nwords = 0, i;
+
+    // read the whole input into one buffer
+    do
+    {
+        if (size + 65536 + 1 > cap)
+        {
+            char *bigger;
+            cap = cap ? cap * 2 : 1 << 20;
+            bigger = realloc(text, cap);
+            if (bigger == NULL)
+            {
+                printf("Out of memory\n");
+                free(text);
+                return 1;
+            }
+            text = bigger;
+        }
+        got = fread(text + size, 1, cap - size - 1, fp);
+        size += got;
+    } while (got > 0);
+    text[size] = '\0';
+
+    // cut it into words in place
+    for (i = 0; i < size; i++)
+    {
+        if (text[i] == ' ' || text[i] == '\n' || text[i] == '\t' || text[i] == '\r')
+            text[i] = '\0';
+        else if (i == 0 || text[i - 1] == '\0')
+            nwords++;
+    }
+
+    words = malloc((nwords ? nwords : 1) * sizeof *words);
+    if (words == NULL)
+    {
+        printf("Out of memory\n");
+        free(text);
+        return 1;
+    }
+    nwords = 0;
+    for (p = text; p < text + size; p += strlen(p) + 1)
+    {
+        if (*p != '\0')
+            words[nwords++] = p;
+    }
+
+    multikeyQuicksort(words, nwords, 0);
+
+    for (i = 0; i < nwords; i++)
+    {
+        puts(words[i]);
+    }
+
+    free(words);
+    free(text);
+    return 0;
+}
+
+static int isWordSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// Counts the words of buf[0..n) and returns where the last one starts
+// if it may go on past n (n when it cannot), or -1 when out of memory
+static long countWords(Interner *in, size_t **counts, size_t *cap, const char *buf, size_t n, int last)
+{
+    size_t i = 0, start;
+    while (i < n)
+    {
+        uint32_t id;
+        while (i < n && isWordSpace(buf[i]))
+            i++;
+        start = i;
+        while (i < n && !isWordSpace(buf[i]))
+            i++;
+        if (i == start)
+            break;
+        if (i == n && !last)
+            return (long)start;
+        if ((id = internId(in, buf + start, i - start)) == INTERN_NONE)
+            return -1;
+        if (id >= *cap)
+        {
+            size_t *bigger = realloc(*counts, 2 * *cap * sizeof *bigger);
+            if (bigger == NULL)
+                return -1;
+            memset(bigger + *cap, 0, *cap * sizeof *bigger);
+            *counts = bigger;
+            *cap *= 2;
+        }
+        (*counts)[id]++;
+    }
+    return (long)n;
+}
+
+// Sorts and prints the words of fp as sortWords() does, keeping each
+// distinct word once
+int sortInterned(FILE *fp)
+{
+    Interner in;
+    size_t *counts, cap = 1024, size = READ_PIECE, kept = 0, got, i;
+    uint32_t *byRank = NULL, d;
+    char *buf = malloc(size);
+    int status = 1;
+    long used;
+
+    internInit(&in);
+    counts = calloc(cap, sizeof *counts);
+    if (buf == NULL || counts == NULL)
+        goto done;
+
+    // a word cut off at the end of a piece is kept for the next one
+    do
+    {
+        if (kept == size)
+        {
+            char *bigger = realloc(buf, 2 * size);
+            if (bigger == NULL)
+                goto done;
+            buf = bigger;
+            size *= 2;
+        }
+        got = fread(buf + kept, 1, size - kept, fp);
+        used = countWords(&in, &counts, &cap, buf, kept + got, got == 0);
+        if (used < 0)
+            goto done;
+        kept = kept + got - (size_t)used;
+        memmove(buf, buf + used, kept);
+    } while (got > 0);
+
+    // the distinct words are sorted once; their ranks put them in order
+    d = in.count;
+    if (internRank(&in) != 0 || (byRank = malloc((d ? d : 1) * sizeof *byRank)) == NULL)
+        goto done;
+    for (i = 0; i < d; i++)
+        byRank[in.rank[i]] = (uint32_t)i;
+    for (i = 0; i < d; i++)
+    {
+        size_t k;
+        for (k = 0; k < counts[byRank[i]]; k++)
+            puts(internString(&in, byRank[i]).p);
+    }
+    status = 0;
+
+done:
+    if (status != 0)
+        printf("Out of memory\n");
+    free(byRank);
+    free(counts);
+    free(buf);
+    internFree(&in);
+    return status;
+}
+
+int main(int argc, char *argv[])
 {
     char str[20][20], temp[20];
     int n, i, j;
+
+    if (argc == 3 && strcmp(argv[1], "--intern") == 0)
+    {
+        FILE *fp = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "rb");
+        int status;
+        if (fp == NULL)
+        {
+            printf("Cannot open %s\n", argv[2]);
+            return 1;
+        }
+        status = sortInterned(fp);
+        if (fp != stdin)
+            fclose(fp);
+        return status;
+    }
+
+    if (argc == 2)
+    {
+        FILE *fp = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+        int status;
+        if (fp == NULL)
+        {
+            printf("Cannot open %s\n", argv[1]);
+            return 1;
+        }
+        status = sortWords(fp);
+        if (fp != stdin)
+            fclose(fp);
+        return status;
+    }
+
     printf("Enter the Number of Strings:\n");
     scanf("%d", &n);
 
@@ -35,4 +320,5 @@ void main()
     {
         puts(str[i]);
     }
+    return 0;
 }
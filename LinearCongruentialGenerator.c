@@ -1,8 +1,34 @@
 // A basic implementation of a linear congruential pseudorandom number generator in C
+//
+// Each step is the affine map x -> a x + c (mod m), and two affine maps
+// compose into another: k steps are x -> A x + C with A = a^k and
+// C = c (a^(k-1) + ... + 1), found by squaring the map O(log k) times.
+// lcg_jump() skips k steps that way, and lcg_stream() hands out the i-th
+// block of a sequence to each of several threads, so they draw from
+// non-overlapping parts of it without sharing a generator or a lock.
+// lcg_fill() writes n values at once; for a power-of-two modulus it keeps
+// 8 lanes apart by 8 steps, which the compiler can turn into vector
+// multiplies instead of one long chain of dependent ones.
+//
+// Run with --streams T N for a Monte Carlo estimate of pi from N pairs on
+// each of T threads (build with -pthread), checked against one generator
+// drawing the same 2TN values in order.
+//
+// The generator was called random(), the same name as the one in
+// <stdlib.h>, so it is lcg_next() now. Its low bits are weak: with
+// modulus 2^31 the lowest one just alternates. Random.h has xoshiro256**
+// and PCG64, which are not, and --bench compares them all: throughput of
+// each, of the 8-lane xoshiro fill, and of unbiased values below n
+// against r % n.
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
-#include <math.h>
+#include <pthread.h>
+#include "Random.h"
+
+#define LCG_LANES 8
+#define MAX_STREAMS 64
 
 struct lcg_rand {
   unsigned int modulus;
@@ -22,16 +48,207 @@ struct lcg_rand new_generator(unsigned int modulus, unsigned int multiplier, uns
   return random;
 }
 
-int random(struct lcg_rand * random) {
-  int number = ((random->multiplier * random->last) + random->increment) % random->modulus;
-  random->last = number;
+// in 64 bits, so a modulus that is not a power of two does not wrap at 2^32
+int lcg_next(struct lcg_rand * rng) {
+  int number = ((unsigned long long)rng->multiplier * rng->last + rng->increment) % rng->modulus;
+  rng->last = number;
   return number;
 }
 
-int main() {
-  struct lcg_rand rng = new_generator(pow(2, 31), 1103515245, 12345);
+// x -> a x + c (mod m)
+struct lcg_affine {
+  unsigned int a;
+  unsigned int c;
+};
+
+// first f, then g
+struct lcg_affine lcg_compose(struct lcg_affine f, struct lcg_affine g, unsigned int m) {
+  struct lcg_affine h;
+  h.a = (unsigned long long)g.a * f.a % m;
+  h.c = ((unsigned long long)g.a * f.c + g.c) % m;
+  return h;
+}
+
+// the map of k steps
+struct lcg_affine lcg_steps(const struct lcg_rand * rng, unsigned long long k) {
+  struct lcg_affine result = {1 % rng->modulus, 0};
+  struct lcg_affine step = {rng->multiplier % rng->modulus, rng->increment % rng->modulus};
+  for (; k > 0; k >>= 1) {
+    if (k & 1)
+      result = lcg_compose(result, step, rng->modulus);
+    step = lcg_compose(step, step, rng->modulus);
+  }
+  return result;
+}
+
+// skip k values, as k calls of lcg_next() would
+void lcg_jump(struct lcg_rand * rng, unsigned long long k) {
+  struct lcg_affine f = lcg_steps(rng, k);
+  rng->last = ((unsigned long long)f.a * rng->last + f.c) % rng->modulus;
+}
+
+// the generator for block index of stride values of master's sequence
+struct lcg_rand lcg_stream(const struct lcg_rand * master, unsigned int index, unsigned long long stride) {
+  struct lcg_rand stream = *master;
+  lcg_jump(&stream, stride * index);
+  return stream;
+}
+
+// the next n values of lcg_next() into buf
+void lcg_fill(struct lcg_rand * rng, unsigned int * buf, size_t n) {
+  unsigned int m = rng->modulus;
+  size_t i = 0;
+  // m divides 2^32, so arithmetic mod 2^32 and a mask at the end is exact
+  if (m != 0 && (m & (m - 1)) == 0 && n >= 2 * LCG_LANES) {
+    struct lcg_affine f = lcg_steps(rng, LCG_LANES);
+    unsigned int x[LCG_LANES], mask = m - 1;
+    int l;
+    for (l = 0; l < LCG_LANES; l++)
+      x[l] = buf[l] = lcg_next(rng);
+    for (i = LCG_LANES; i + LCG_LANES <= n; i += LCG_LANES)
+      for (l = 0; l < LCG_LANES; l++) {
+        x[l] = (f.a * x[l] + f.c) & mask;
+        buf[i + l] = x[l];
+      }
+    rng->last = buf[i - 1];
+  }
+  for (; i < n; i++)
+    buf[i] = lcg_next(rng);
+}
+
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct pi_job {
+  struct lcg_rand rng;
+  unsigned long long pairs;
+  unsigned long long hits;
+};
+
+// pairs (x, y) of values in the quarter circle of radius m
+void *pi_count(void * arg) {
+  struct pi_job * job = arg;
+  unsigned int buf[4096];
+  unsigned long long left = job->pairs, r2 = (unsigned long long)job->rng.modulus * job->rng.modulus;
+  job->hits = 0;
+  while (left > 0) {
+    size_t n = left < sizeof buf / sizeof buf[0] / 2 ? left : sizeof buf / sizeof buf[0] / 2, i;
+    lcg_fill(&job->rng, buf, 2 * n);
+    for (i = 0; i < n; i++)
+      job->hits += (unsigned long long)buf[2 * i] * buf[2 * i] + (unsigned long long)buf[2 * i + 1] * buf[2 * i + 1] < r2;
+    left -= n;
+  }
+  return NULL;
+}
+
+int streams(struct lcg_rand master, int threads, unsigned long long pairs) {
+  static struct pi_job job[MAX_STREAMS];
+  pthread_t id[MAX_STREAMS];
+  struct pi_job all;
+  unsigned long long hits = 0;
+  double t0, t1, t2;
+  int i;
+  if (threads < 1 || threads > MAX_STREAMS || pairs == 0) {
+    printf("Use 1 to %d threads and at least one pair\n", MAX_STREAMS);
+    return 1;
+  }
+  t0 = now();
+  for (i = 0; i < threads; i++) {
+    job[i].rng = lcg_stream(&master, i, 2 * pairs);
+    job[i].pairs = pairs;
+    if (pthread_create(&id[i], NULL, pi_count, &job[i]) != 0) {
+      printf("Cannot start thread %d\n", i);
+      return 1;
+    }
+  }
+  for (i = 0; i < threads; i++) {
+    pthread_join(id[i], NULL);
+    hits += job[i].hits;
+  }
+  t1 = now();
+  all.rng = master;
+  all.pairs = pairs * threads;
+  pi_count(&all);
+  t2 = now();
+  printf("pi ~ %.6f from %llu pairs: %d streams %.3f s, one generator %.3f s%s\n",
+         4.0 * hits / (pairs * threads), pairs * threads, threads, t1 - t0, t2 - t1,
+         hits == all.hits ? "" : " (MISMATCH)");
+  return hits != all.hits;
+}
+
+#define BENCH_WORDS (1 << 16)
+
+// bytes of 32- or 64-bit values per second, the best of enough runs to
+// fill 100 ms
+#define BENCH(name, bytes, body)                                  \
+  do {                                                            \
+    double best = 1e30, start = now(), t0, t1;                    \
+    do {                                                          \
+      t0 = now();                                                 \
+      body;                                                       \
+      t1 = now();                                                 \
+      if (t1 - t0 < best)                                         \
+        best = t1 - t0;                                           \
+    } while (t1 - start < 0.1);                                   \
+    printf("%-28s %6.2f GB/s\n", name, (bytes) / best / 1e9);     \
+  } while (0)
+
+int bench(struct lcg_rand rng) {
+  static uint64_t buf[BENCH_WORDS];
+  static uint32_t out[2 * BENCH_WORDS];
+  unsigned int *small = (unsigned int *)buf;
+  Xoshiro256 x;
+  Xoshiro256x8 x8;
+  uint64_t sink = 0;
+  size_t i, got = 0;
+  int low = 0;
+  xoshiroSeed(&x, rng.seed);
+  xoshiroX8Seed(&x8, rng.seed);
+  for (i = 0; i < 64; i++) {
+    low |= (lcg_next(&rng) & 1) << (i % 8);
+    if (i % 8 == 7) {
+      printf("%s%02x", i == 7 ? "lowest bit of lcg_next(), 8 at a time: " : " ", low);
+      low = 0;
+    }
+  }
+  printf("\n");
+  BENCH("lcg_next()", 4.0 * BENCH_WORDS, for (i = 0; i < BENCH_WORDS; i++) small[i] = lcg_next(&rng));
+  BENCH("lcg_fill()", 8.0 * BENCH_WORDS, lcg_fill(&rng, small, 2 * BENCH_WORDS));
+  BENCH("xoshiroNext()", 8.0 * BENCH_WORDS, for (i = 0; i < BENCH_WORDS; i++) buf[i] = xoshiroNext(&x));
+#if defined(__SIZEOF_INT128__)
+  {
+    Pcg64 p;
+    pcgSeed(&p, rng.seed, 0);
+    BENCH("pcgNext()", 8.0 * BENCH_WORDS, for (i = 0; i < BENCH_WORDS; i++) buf[i] = pcgNext(&p));
+  }
+#endif
+  BENCH("xoshiroX8Fill()", 8.0 * BENCH_WORDS, xoshiroX8Fill(&x8, buf, BENCH_WORDS));
+  BENCH("xoshiroNext() % 6", 4.0 * BENCH_WORDS, for (i = 0; i < BENCH_WORDS; i++) out[i] = (uint32_t)(xoshiroNext(&x) % 6));
+  BENCH("xoshiroBelow(6)", 4.0 * BENCH_WORDS, for (i = 0; i < BENCH_WORDS; i++) out[i] = xoshiroBelow(&x, 6));
+  BENCH("fill + boundedFill(6)", 4.0 * got, xoshiroX8Fill(&x8, buf, BENCH_WORDS); got = boundedFill(buf, BENCH_WORDS, 6, out, 2 * BENCH_WORDS));
+  for (i = 0; i < got; i++)
+    sink += out[i];
+  // the mean of a die's faces 0 .. 5 is 2.5
+  printf("mean of the last %zu rolls below 6: %.4f\n", got, (double)sink / got);
+  return 0;
+}
+
+int main(int argc, char * argv[]) {
+  struct lcg_rand rng = new_generator(1u << 31, 1103515245, 12345);
+  if (argc > 3 && strcmp(argv[1], "--streams") == 0) {
+    int threads = 0;
+    unsigned long long pairs = 0;
+    sscanf(argv[2], "%d", &threads);
+    sscanf(argv[3], "%llu", &pairs);
+    return streams(rng, threads, pairs);
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    return bench(rng);
   for (int i = 0; i < 10; i++) {
-    printf("%d\n", random( & rng));
+    printf("%d\n", lcg_next( & rng));
   }
   return 0;
 }
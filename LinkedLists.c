@@ -1,323 +1,722 @@
 //Normal LL with all fns
 //kinda incomplete - work in progress
-//TO ADD - fn to reverse the LL
+//Reverse and Sort relink the nodes in place; Sort is a bottom-up merge sort,
+//O(n log n) with no memory besides 32 run pointers
+//Run with --unrolled for an unrolled LL: every node holds up to UNROLLED_ITEMS
+//elements, so walking the list touches a cache line per ~14 elements, not per element
+//Display and UDisplay format into an OutBuffer.h buffer and write it out in big
+//pieces, not a printf per element
 
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include "NodePool.h"
+#include "OutBuffer.h"
 
 struct node
 {
 	int info;
 	struct node* link;
+	struct node* prev;	//doubly linked, so Edelete needs no walk
 };
 
 typedef struct node node;
 
-node *head=NULL, *head2=NULL;
+//a list knows its last node and its length, so appending and len() are O(1)
+//and each list takes its nodes from its own pool, so DeleteLL frees it chunk by chunk
+struct list
+{
+	node *head, *tail;
+	int count;
+	NodePool pool;
+};
+
+typedef struct list list;
 
-//*head=NULL;
-//*head2=NULL;
+list l1={NULL,NULL,0,NODE_POOL_INITIALIZER(sizeof(node))};
+list l2={NULL,NULL,0,NODE_POOL_INITIALIZER(sizeof(node))};
 
-void Binsert(int);
-void Einsert(int,node*);
-void Minsert(int);
-void Display(node*);
-void Bdelete();
-void Edelete();
-void Mdelete(int);
-void DeleteLL(node*);
-//void copy();
-//node* locate(node*, int);
-//void reverse(node*);
-//void swaplink(node*);
-//void len(node*);
+void Binsert(list*,int);
+void Einsert(list*,int);
+void Minsert(list*,int);
+void Display(list*);
+void Bdelete(list*);
+void Edelete(list*);
+void Mdelete(list*,int);
+void DeleteLL(list*);
+int len(list*);
+void copy();
+void reverse(list*);
+void sort(list*);
 
+#define UNROLLED_ITEMS 27	//prev, next and count take the rest of two cache lines
 
-int main()
+struct unode
 {
+	struct unode *link, *prev;
+	int count;
+	int items[UNROLLED_ITEMS];
+};
+
+typedef struct unode unode;
+
+struct ulist
+{
+	unode *head, *tail;
+	int count;	//elements, not nodes
+	NodePool pool;
+};
+
+typedef struct ulist ulist;
+
+ulist u1={NULL,NULL,0,NODE_POOL_INITIALIZER(sizeof(unode))};
+ulist u2={NULL,NULL,0,NODE_POOL_INITIALIZER(sizeof(unode))};
+
+void UBinsert(ulist*,int);
+void UEinsert(ulist*,int);
+void UMinsert(ulist*,int);
+void UDisplay(ulist*);
+void UBdelete(ulist*);
+void UEdelete(ulist*);
+void UMdelete(ulist*,int);
+void UDeleteLL(ulist*);
+void Ucopy();
+void UReverse(ulist*);
+void USort(ulist*);
+
+
+int main(int argc, char* argv[])
+{
+	int unrolled=argc>1 && strcmp(argv[1],"--unrolled")==0;
 	while(1)
 	{
 		int opt,ele;
-		printf("\nEnter what you wanna do:\n1.Binsert\n2.Einsert\n3.Minsert\n4.Display\n5.Bdelete\n6.Edelete\n7.Mdelete\n8.Copy\n9.DeleteLL\n10.Reverse\n11.Quit\n");
-		scanf("%d",&opt);
+		printf("\nEnter what you wanna do:\n1.Binsert\n2.Einsert\n3.Minsert\n4.Display\n5.Bdelete\n6.Edelete\n7.Mdelete\n8.Copy\n9.DeleteLL\n10.Reverse\n11.Quit\n12.Sort\n");
+		if(scanf("%d",&opt)!=1)
+			opt=11;	//end of input
 		switch(opt)
 		{
 			case 1:
 				{
 					printf("\nEnter the element");
 					scanf("%d",&ele);
-					Binsert(ele);
+					if(unrolled)
+						UBinsert(&u1,ele);
+					else
+						Binsert(&l1,ele);
 					break;
 				}
 			case 2:
 				{
 					printf("\nEnter the element");
 					scanf("%d",&ele);
-					Einsert(ele,head);
+					if(unrolled)
+						UEinsert(&u1,ele);
+					else
+						Einsert(&l1,ele);
 					break;
 				}
 			case 3:
 				{
 					printf("\nEnter the element");
 					scanf("%d",&ele);
-					Minsert(ele);
+					if(unrolled)
+						UMinsert(&u1,ele);
+					else
+						Minsert(&l1,ele);
 					break;
 				}
 			case 4:
 				{
 					printf("\nEnter the LL(1/2)");
 					scanf("%d",&ele);
-					if(ele==1)
-						Display(head);
+					if(unrolled)
+						UDisplay(ele==1 ? &u1 : &u2);
+					else if(ele==1)
+						Display(&l1);
 					else
-						Display(head2);
+						Display(&l2);
 					break;
 				}
 			case 5:
 				{
-					Bdelete();
+					if(unrolled)
+						UBdelete(&u1);
+					else
+						Bdelete(&l1);
 					break;
 				}
 			case 6:
 				{
-					Edelete();
+					if(unrolled)
+						UEdelete(&u1);
+					else
+						Edelete(&l1);
 					break;
 				}
 			case 7:
 				{
 					printf("\nEnter the element you wanna delete:");
 					scanf("%d",&ele);
-					Mdelete(ele);
+					if(unrolled)
+						UMdelete(&u1,ele);
+					else
+						Mdelete(&l1,ele);
 					break;
 				}
-			/*case 8:
+			case 8:
 				{
-					copy();
+					if(unrolled)
+						Ucopy();
+					else
+						copy();
 					break;
 				}
 			case 9:
 				{
 					printf("\nEnter the LL(1/2)");
 					scanf("%d",&ele);
-					if(ele==1)
-						DeleteLL(head);
+					if(unrolled)
+						UDeleteLL(ele==1 ? &u1 : &u2);
+					else if(ele==1)
+						DeleteLL(&l1);
 					else
-						DeleteLL(head2);
+						DeleteLL(&l2);
 					break;
 				}
 			case 10:
 				{
-					reverse(head);
+					if(unrolled)
+						UReverse(&u1);
+					else
+						reverse(&l1);
 					break;
 				}
-			case 11:
+			case 12:
 				{
-					swaplink(head);	
+					if(unrolled)
+						USort(&u1);
+					else
+						sort(&l1);
+					break;
 				}
-
-			case 12:
+			case 11:
 				{
+					if(unrolled)
+						printf("\nLength of LL1: %d, LL2: %d\n",u1.count,u2.count);
+					else
+						printf("\nLength of LL1: %d, LL2: %d\n",len(&l1),len(&l2));
 					exit(0);
-				}*/
+				}
 		}
 	}
 	return 0;
 }
 
-void Binsert(int ele)
+node* newnode(list* l,int ele)
 {
-//	if (head==NULL)
-//		return;
-	node* p=head;
-	node* temp=(node*)malloc(sizeof(node));
+	node* temp=(node*)nodePoolAlloc(&l->pool);
 	temp->info=ele;
-	temp->link=head;
-	head=temp;
+	temp->link=temp->prev=NULL;
+	return temp;
 }
 
-void Einsert(int ele,node* temph)
+void Binsert(list* l,int ele)
 {
-	node* temp=(node*)malloc(sizeof(node));
-	temp->info=ele;
-	node* p;
-	p=temph;
-	while(p->link!=NULL)
-		p=p->link;
-	temp->link=NULL;
-	p->link=temp;
+	node* temp=newnode(l,ele);
+	temp->link=l->head;
+	if(l->head!=NULL)
+		l->head->prev=temp;
+	else
+		l->tail=temp;
+	l->head=temp;
+	l->count++;
 }
 
-void Minsert(int ele)
+void Einsert(list* l,int ele)
 {
-	if(head==NULL)
+	node* temp=newnode(l,ele);
+	if(l->tail==NULL)
 	{
-		Binsert(ele);
+		l->head=l->tail=temp;
+		l->count++;
 		return;
 	}
-	if (head->info>ele)
+	temp->prev=l->tail;
+	l->tail->link=temp;
+	l->tail=temp;
+	l->count++;
+}
+
+//keeps a sorted list sorted
+void Minsert(list* l,int ele)
+{
+	node *q,*temp;
+	if(l->head==NULL || l->head->info>ele)
 	{
-		Binsert(ele);
+		Binsert(l,ele);
 		return;
-	}	
-	node *p,*q,*temp=(node*)malloc(sizeof(node));
-	temp->info=ele;
-	p=head;
-	q=head->link;
-	while(q!=NULL)											//q->link!=null?????????????????????????????????????????? works??????????????????????????????????
+	}
+	if(l->tail->info<=ele)	//also a one-node list holding ele
 	{
-		if(q->info>=ele)
-		{
-			p->link=temp;
-			temp->link=q;
-			return;
-		}		
-		p=p->link;
-		q=q->link;
+		Einsert(l,ele);
+		return;
 	}
-	Einsert(ele,head);
+	q=l->head->link;
+	while(q->info<ele)	//stops before the tail at the latest
+		q=q->link;
+	temp=newnode(l,ele);
+	temp->prev=q->prev;
+	temp->link=q;
+	q->prev->link=temp;
+	q->prev=temp;
+	l->count++;
+}
+
+//asks for the node after next while p is worked on, so a walk does not
+//wait on one cache miss per node
+void prefetch_next(node* p)
+{
+	if(p->link!=NULL)
+		NODE_PREFETCH(p->link->link);
 }
 
-void Display(node* temph)
+void Display(list* l)
 {
-	node* p=temph;
+	node* p=l->head;
+	OutBuffer out;
+	if(outInit(&out,stdout,0)!=0)
+	{
+		printf("\nOut of memory\n");
+		return;
+	}
 	while(p!=NULL)
 	{
-		printf("%d->",p->info);
+		prefetch_next(p);
+		outInt(&out,p->info);
+		outText(&out,"->",2);
 		p=p->link;
 	}
-	printf("\n");
-}				
+	outChar(&out,'\n');
+	outClose(&out);
+}
+
+//takes node p out of the list and frees it
+void unlink_node(list* l,node* p)
+{
+	if(p->prev!=NULL)
+		p->prev->link=p->link;
+	else
+		l->head=p->link;
+	if(p->link!=NULL)
+		p->link->prev=p->prev;
+	else
+		l->tail=p->prev;
+	nodePoolFree(&l->pool,p);
+	l->count--;
+}
 				
-void Bdelete()
+void Bdelete(list* l)
+{
+	if(l->head!=NULL)
+		unlink_node(l,l->head);
+}
+
+void Edelete(list* l)
 {
-	node* p=head;
-	head=head->link;
-	free(p);
+	if(l->tail!=NULL)
+		unlink_node(l,l->tail);
 }
 
-void Edelete()
+void Mdelete(list* l,int ele)
 {
-	node *p,*q;
-	p=head;
-	while(p->link->link!=NULL)
+	node *p=l->head;
+	while(p!=NULL && p->info!=ele)
+	{
+		prefetch_next(p);
 		p=p->link;
-	q=p->link;
-	p->link=NULL;
-	free(q);
+	}
+	if(p!=NULL)
+		unlink_node(l,p);
+}
+
+void DeleteLL(list* l)
+{
+	//the whole pool goes at once, without walking the list
+	nodePoolRelease(&l->pool);
+	l->head=l->tail=NULL;
+	l->count=0;
 }
 
-void Mdelete(int ele)
+int len(list* l)
 {
-	if (head->info==ele)
+	return l->count;
+}
+
+void copy()
+{
+	node *p;
+	DeleteLL(&l2);
+	for(p=l1.head;p!=NULL;p=p->link)
 	{
-		Bdelete();
-		return;
+		prefetch_next(p);
+		Einsert(&l2,p->info);
+	}
+}
+
+//swaps every node's link and prev, then the ends
+void reverse(list* l)
+{
+	node *p=l->head,*next;
+	while(p!=NULL)
+	{
+		prefetch_next(p);
+		next=p->link;
+		p->link=p->prev;
+		p->prev=next;
+		p=next;
 	}
-	node *p=head,*q=head->link;
-	while(q->link!=NULL)										//q->link!=null?????????????????????????????????????????? doesnt work 
+	p=l->head;
+	l->head=l->tail;
+	l->tail=p;
+}
+
+//merges the sorted lists a and b by their links. Equal elements of a go
+//first, so the sort is stable.
+node* merge(node* a,node* b)
+{
+	node dummy,*tail=&dummy;
+	while(a!=NULL && b!=NULL)
 	{
-		if(q->info==ele)
+		if(a->info<=b->info)
 		{
-			p->link=q->link;
-			free(q);
-			return;
+			tail->link=a;
+			a=a->link;
 		}
+		else
+		{
+			tail->link=b;
+			b=b->link;
+		}
+		tail=tail->link;
 	}
+	tail->link=a!=NULL ? a : b;
+	return dummy.link;
 }
 
-void DeleteLL(node* temph)
+//bottom-up merge sort, by the link pointers only. The runs are merged like
+//a binary counter: bin i holds a sorted run of 2^i nodes, and each new node
+//carries into the bins above it, so runs are merged while they are still
+//in cache rather than in passes over the whole list. 32 bins are enough for
+//2^32 nodes. One last walk puts back prev and tail.
+void sort(list* l)
 {
-	node *p=temph,*q=temph->link;
-	while(q!=NULL)
+	node *bins[32]={NULL},*p=l->head,*c,*prev;
+	int i;
+	while(p!=NULL)
 	{
-		free(p);
-		p=q;
-		q=q->link;
+		node* next=p->link;
+		prefetch_next(p);
+		p->link=NULL;
+		c=p;
+		for(i=0;bins[i]!=NULL;i++)
+		{
+			c=merge(bins[i],c);	//the bin holds the earlier elements
+			bins[i]=NULL;
+		}
+		bins[i]=c;
+		p=next;
+	}
+	c=NULL;
+	for(i=0;i<32;i++)
+		if(bins[i]!=NULL)
+			c=merge(bins[i],c);
+	l->head=c;
+	prev=NULL;
+	for(p=l->head;p!=NULL;p=p->link)
+	{
+		prefetch_next(p);
+		p->prev=prev;
+		prev=p;
 	}
-	free(p);
-	temph=NULL;
+	l->tail=prev;
 }
 
-void copy()
+//new empty node linked in after p (at the front when p is NULL)
+unode* unewnode(ulist* l,unode* p)
 {
-	DeleteLL(head2);
-	node *p,*q;
-	p=head;
-	q=head2;
-	while(p!=NULL)
-		Einsert(p->info,head2);
+	unode* n=(unode*)nodePoolAlloc(&l->pool);
+	n->count=0;
+	n->prev=p;
+	n->link=p!=NULL ? p->link : l->head;
+	if(n->link!=NULL)
+		n->link->prev=n;
+	else
+		l->tail=n;
+	if(p!=NULL)
+		p->link=n;
+	else
+		l->head=n;
+	return n;
 }
 
-node* locate(node* head, int ind)
+//puts ele at position i of node p; a full node is split in two first
+void uinsert_at(ulist* l,unode* p,int i,int ele)
 {
-	node *p;
-	int x;
-	p= head->link;
-	x=0;
-	while(x!=ind||p!=NULL)
+	if(p->count==UNROLLED_ITEMS)
 	{
+		unode* n=unewnode(l,p);
+		int half=UNROLLED_ITEMS/2;
+		n->count=UNROLLED_ITEMS-half;
+		memcpy(n->items,p->items+half,n->count*sizeof(int));
+		p->count=half;
+		if(i>half)
+		{
+			p=n;
+			i-=half;
+		}
+	}
+	memmove(p->items+i+1,p->items+i,(p->count-i)*sizeof(int));
+	p->items[i]=ele;
+	p->count++;
+	l->count++;
+}
+
+void UBinsert(ulist* l,int ele)
+{
+	if(l->head==NULL)
+		unewnode(l,NULL);
+	uinsert_at(l,l->head,0,ele);
+}
+
+void UEinsert(ulist* l,int ele)
+{
+	if(l->tail==NULL || l->tail->count==UNROLLED_ITEMS)
+		unewnode(l,l->tail);	//a new node rather than a split, so appends fill nodes
+	uinsert_at(l,l->tail,l->tail->count,ele);
+}
+
+//keeps a sorted list sorted; whole nodes are skipped by their last element
+void UMinsert(ulist* l,int ele)
+{
+	unode* p=l->head;
+	int i=0;
+	if(p==NULL)
+	{
+		UBinsert(l,ele);
+		return;
+	}
+	while(p->link!=NULL && p->items[p->count-1]<ele)
 		p=p->link;
-		x++;
+	while(i<p->count && p->items[i]<ele)
+		i++;
+	uinsert_at(l,p,i,ele);
+}
+
+void UDisplay(ulist* l)
+{
+	unode* p;
+	OutBuffer out;
+	if(outInit(&out,stdout,0)!=0)
+	{
+		printf("\nOut of memory\n");
+		return;
+	}
+	for(p=l->head;p!=NULL;p=p->link)
+		outInts(&out,p->items,p->count,"->");
+	outChar(&out,'\n');
+	outClose(&out);
+}
+
+//takes item i out of node p. A node less than half full takes in its
+//next node if both fit in one, or else borrows from it; an empty one goes.
+void uremove_at(ulist* l,unode* p,int i)
+{
+	unode* n=p->link;
+	memmove(p->items+i,p->items+i+1,(p->count-i-1)*sizeof(int));
+	p->count--;
+	l->count--;
+	if(n!=NULL && p->count<UNROLLED_ITEMS/2)
+	{
+		if(p->count+n->count<=UNROLLED_ITEMS)
+		{
+			memcpy(p->items+p->count,n->items,n->count*sizeof(int));
+			p->count+=n->count;
+			n->count=0;
+			p=n;	//now empty
+		}
+		else
+		{
+			int take=UNROLLED_ITEMS/2-p->count;
+			memcpy(p->items+p->count,n->items,take*sizeof(int));
+			p->count+=take;
+			memmove(n->items,n->items+take,(n->count-take)*sizeof(int));
+			n->count-=take;
+		}
 	}
-	return p;
-}
-/*
-void reverse(node* head)
-{	
-	printf("111111111111111111111111111111111111");
-	node *x = head, *p, *q; 
-	int n=0, temp=0,i;
-	for (i=0;x!=NULL;i++)
-		n++;
-	printf("222222222222222222222222222222222222");
-	for(i=0;i<n/2;i++)
+	if(p->count==0)
 	{
-		p=locate(head,i);
-		q=locate(head,n/2-i);
-	printf("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
-		temp = p->info;
-		p->info=q->info;
-		q->info = temp;//mind fucked
+		if(p->prev!=NULL)
+			p->prev->link=p->link;
+		else
+			l->head=p->link;
+		if(p->link!=NULL)
+			p->link->prev=p->prev;
+		else
+			l->tail=p->prev;
+		nodePoolFree(&l->pool,p);
 	}
 }
-	
-				
-void swaplink(node* head)
-{
-	node *p,*q;
-	q=head;
-	int leng=len(head);
-	int count=leng-1,i,n=0;
-	for(i=0;i<leng-1;i++)
-	{				{
-		while( n<count)
+
+void UBdelete(ulist* l)
+{
+	if(l->head!=NULL)
+		uremove_at(l,l->head,0);
+}
+
+void UEdelete(ulist* l)
+{
+	if(l->tail!=NULL)
+		uremove_at(l,l->tail,l->tail->count-1);
+}
+
+void UMdelete(ulist* l,int ele)
+{
+	unode* p;
+	for(p=l->head;p!=NULL;p=p->link)
+		for(int i=0;i<p->count;i++)
+			if(p->items[i]==ele)
+			{
+				uremove_at(l,p,i);
+				return;
+			}
+}
+
+void UDeleteLL(ulist* l)
+{
+	nodePoolRelease(&l->pool);
+	l->head=l->tail=NULL;
+	l->count=0;
+}
+
+void Ucopy()
+{
+	unode* p;
+	UDeleteLL(&u2);
+	for(p=u1.head;p!=NULL;p=p->link)
+		for(int i=0;i<p->count;i++)
+			UEinsert(&u2,p->items[i]);
+}
+
+//reverses the order of the nodes and of the elements in each
+void UReverse(ulist* l)
+{
+	unode *p=l->head,*next;
+	while(p!=NULL)
+	{
+		for(int i=0,j=p->count-1;i<j;i++,j--)
 		{
-			p=q;
-			q=q->link;
+			int t=p->items[i];
+			p->items[i]=p->items[j];
+			p->items[j]=t;
 		}
-		q->link=p;
-		n++;
+		next=p->link;
+		p->link=p->prev;
+		p->prev=next;
+		p=next;
 	}
+	p=l->head;
+	l->head=l->tail;
+	l->tail=p;
 }
 
-int len(node* head)
+//merges two sorted chains of nodes (linked by link only) into new full
+//nodes, freeing each input node once it is used up, so at most one node
+//more than the list is ever allocated
+unode* umerge(ulist* l,unode* a,unode* b)
 {
-	node* p=head;
-	int x=1;
-	while (p->link!=NULL)
+	unode *head=NULL,*tail=NULL;
+	int i=0,j=0;
+	if(a==NULL)
+		return b;
+	if(b==NULL)
+		return a;
+	while(a!=NULL || b!=NULL)
 	{
-		p=p->link;
-		x++;
+		int ele;
+		if(b==NULL || (a!=NULL && a->items[i]<=b->items[j]))
+		{
+			ele=a->items[i];
+			if(++i==a->count)
+			{
+				unode* next=a->link;
+				nodePoolFree(&l->pool,a);
+				a=next;
+				i=0;
+			}
+		}
+		else
+		{
+			ele=b->items[j];
+			if(++j==b->count)
+			{
+				unode* next=b->link;
+				nodePoolFree(&l->pool,b);
+				b=next;
+				j=0;
+			}
+		}
+		if(tail==NULL || tail->count==UNROLLED_ITEMS)
+		{
+			unode* n=(unode*)nodePoolAlloc(&l->pool);
+			n->count=0;
+			n->link=NULL;
+			if(tail!=NULL)
+				tail->link=n;
+			else
+				head=n;
+			tail=n;
+		}
+		tail->items[tail->count++]=ele;
 	}
-	return x;
+	return head;
+}
+
+//sorts each node by insertion, then merges the nodes in bins like sort()
+void USort(ulist* l)
+{
+	unode *bins[32]={NULL},*p=l->head,*c,*prev;
+	int i;
+	while(p!=NULL)
+	{
+		unode* next=p->link;
+		for(int k=1;k<p->count;k++)
+		{
+			int ele=p->items[k],m=k;
+			for(;m>0 && p->items[m-1]>ele;m--)
+				p->items[m]=p->items[m-1];
+			p->items[m]=ele;
+		}
+		p->link=NULL;
+		c=p;
+		for(i=0;bins[i]!=NULL;i++)
+		{
+			c=umerge(l,bins[i],c);	//the bin holds the earlier elements
+			bins[i]=NULL;
+		}
+		bins[i]=c;
+		p=next;
+	}
+	c=NULL;
+	for(i=0;i<32;i++)
+		c=umerge(l,bins[i],c);
+	l->head=c;
+	prev=NULL;
+	for(p=l->head;p!=NULL;p=p->link)
+	{
+		p->prev=prev;
+		prev=p;
+	}
+	l->tail=prev;
 }
-				
-				
-				
-		*/		
-					
-				
-				
-				
-				
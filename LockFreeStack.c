@@ -0,0 +1,422 @@
+// A stack of ints shared between threads without a lock (Treiber's stack),
+// timed against the same stack behind a mutex.
+//
+//   LockFreeStack [--threads T,T,...] [--ops N]
+//
+// Each thread pushes a value and pops one, N times, first on the lock-free
+// stack, then on a mutex-wrapped linked stack whose nodes come from a free
+// list, then on one that mallocs a node per push like stack_using_linklist.
+// The default thread counts are 1, 2, 4, ... 64. Every run checks that the
+// values popped plus the values left add up to the values pushed.
+//
+// Pushing and popping are each a compare-and-swap on the head. The classic
+// danger is ABA: a thread reads head A and its next B, sleeps, and in the
+// meantime A is popped, B is popped and freed, and A is pushed back; the
+// CAS still sees A and installs the stale B. Here the head is a tagged
+// pointer: a 32-bit node index and a 32-bit count of changes, swapped as
+// one 64-bit word, so a head that went away and came back no longer
+// matches. (The count wraps after 2^32 changes; a thread would have to
+// sleep through all of them between its read and its CAS.)
+//
+// The nodes never go back to malloc while the stack exists. Popped nodes
+// go on a second lock-free stack, the free list, and pushes take nodes from
+// there first. That is what makes it safe for a thread to read the next
+// field of a node that was popped under it: the memory is still a node.
+// New nodes are cut from chunks of a pool, like NodePool.h, but the chunks
+// sit in a fixed table so that an index finds its node without a lock.
+// Build with -pthread.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#define LF_NIL UINT32_MAX
+#define LF_CHUNK_BITS 12 // 4096 nodes a chunk
+#define LF_CHUNK (1u << LF_CHUNK_BITS)
+#define LF_MAX_CHUNKS 4096 // up to 16M nodes
+#define CACHE_LINE 64
+
+// ---------- the lock-free stack ----------
+
+typedef struct
+{
+    _Atomic uint32_t next; // read by poppers racing with a push of the node
+    int value;
+} LfNode;
+
+// a head word: tag << 32 | index of the top node
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint64_t head;
+} LfStack;
+
+typedef struct
+{
+    LfNode *_Atomic chunks[LF_MAX_CHUNKS];
+    _Alignas(CACHE_LINE) _Atomic uint32_t used; // nodes handed out so far
+    pthread_mutex_t grow;                       // only to add a chunk
+    LfStack free;                               // nodes popped and not reused yet
+} LfPool;
+
+static uint64_t lfWord(uint64_t tag, uint32_t index)
+{
+    return tag << 32 | index;
+}
+
+static uint32_t lfIndex(uint64_t word)
+{
+    return (uint32_t)word;
+}
+
+static LfNode *lfNode(LfPool *pool, uint32_t index)
+{
+    LfNode *chunk = atomic_load_explicit(&pool->chunks[index >> LF_CHUNK_BITS], memory_order_acquire);
+    return &chunk[index & (LF_CHUNK - 1)];
+}
+
+static void lfStackInit(LfStack *s)
+{
+    atomic_init(&s->head, lfWord(0, LF_NIL));
+}
+
+static void lfPush(LfPool *pool, LfStack *s, uint32_t index)
+{
+    LfNode *n = lfNode(pool, index);
+    uint64_t old = atomic_load_explicit(&s->head, memory_order_relaxed);
+
+    do
+        atomic_store_explicit(&n->next, lfIndex(old), memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&s->head, &old, lfWord((old >> 32) + 1, index),
+                                                  memory_order_release, memory_order_relaxed));
+}
+
+// the index of the node taken off, or LF_NIL when empty
+static uint32_t lfPop(LfPool *pool, LfStack *s)
+{
+    uint64_t old = atomic_load_explicit(&s->head, memory_order_acquire);
+
+    for (;;)
+    {
+        uint32_t top = lfIndex(old), next;
+        if (top == LF_NIL)
+            return LF_NIL;
+        // top may be popped and pushed again by now; then the tag has
+        // moved on, and the CAS below fails whatever next we read
+        next = atomic_load_explicit(&lfNode(pool, top)->next, memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&s->head, &old, lfWord((old >> 32) + 1, next),
+                                                  memory_order_acquire, memory_order_acquire))
+            return top;
+    }
+}
+
+static int lfPoolInit(LfPool *pool)
+{
+    int i;
+
+    for (i = 0; i < LF_MAX_CHUNKS; i++)
+        atomic_init(&pool->chunks[i], NULL);
+    atomic_init(&pool->used, 0);
+    lfStackInit(&pool->free);
+    return pthread_mutex_init(&pool->grow, NULL) == 0 ? 0 : -1;
+}
+
+static void lfPoolFree(LfPool *pool)
+{
+    int i;
+
+    for (i = 0; i < LF_MAX_CHUNKS; i++)
+        free(atomic_load(&pool->chunks[i]));
+    pthread_mutex_destroy(&pool->grow);
+}
+
+// a node from the free list, or a fresh one; LF_NIL when out of memory
+static uint32_t lfAlloc(LfPool *pool)
+{
+    uint32_t index = lfPop(pool, &pool->free), chunk;
+
+    if (index != LF_NIL)
+        return index;
+    index = atomic_fetch_add(&pool->used, 1);
+    chunk = index >> LF_CHUNK_BITS;
+    if (chunk >= LF_MAX_CHUNKS)
+        return LF_NIL;
+    if (atomic_load_explicit(&pool->chunks[chunk], memory_order_acquire) == NULL)
+    {
+        pthread_mutex_lock(&pool->grow);
+        if (atomic_load_explicit(&pool->chunks[chunk], memory_order_relaxed) == NULL)
+        {
+            LfNode *nodes = aligned_alloc(CACHE_LINE, LF_CHUNK * sizeof(LfNode));
+            if (nodes == NULL)
+            {
+                pthread_mutex_unlock(&pool->grow);
+                return LF_NIL;
+            }
+            atomic_store_explicit(&pool->chunks[chunk], nodes, memory_order_release);
+        }
+        pthread_mutex_unlock(&pool->grow);
+    }
+    return index;
+}
+
+static int lfStackPush(LfPool *pool, LfStack *s, int value)
+{
+    uint32_t index = lfAlloc(pool);
+
+    if (index == LF_NIL)
+        return -1;
+    lfNode(pool, index)->value = value;
+    lfPush(pool, s, index);
+    return 0;
+}
+
+// 1 and the value in *value, or 0 when empty
+static int lfStackPop(LfPool *pool, LfStack *s, int *value)
+{
+    uint32_t index = lfPop(pool, s);
+
+    if (index == LF_NIL)
+        return 0;
+    *value = lfNode(pool, index)->value;
+    lfPush(pool, &pool->free, index);
+    return 1;
+}
+
+// ---------- the same stack behind a mutex ----------
+
+typedef struct MutexNode
+{
+    struct MutexNode *link;
+    int value;
+} MutexNode;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    MutexNode *top;
+    MutexNode *free; // popped nodes, when pooled
+    int pooled;      // otherwise malloc and free every node
+} MutexStack;
+
+static int mutexStackPush(MutexStack *s, int value)
+{
+    MutexNode *n;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->pooled && s->free != NULL)
+    {
+        n = s->free;
+        s->free = n->link;
+    }
+    else if ((n = malloc(sizeof *n)) == NULL)
+    {
+        pthread_mutex_unlock(&s->lock);
+        return -1;
+    }
+    n->value = value;
+    n->link = s->top;
+    s->top = n;
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+static int mutexStackPop(MutexStack *s, int *value)
+{
+    MutexNode *n;
+
+    pthread_mutex_lock(&s->lock);
+    n = s->top;
+    if (n == NULL)
+    {
+        pthread_mutex_unlock(&s->lock);
+        return 0;
+    }
+    s->top = n->link;
+    *value = n->value;
+    if (s->pooled)
+    {
+        n->link = s->free;
+        s->free = n;
+    }
+    else
+        free(n);
+    pthread_mutex_unlock(&s->lock);
+    return 1;
+}
+
+static void mutexStackFree(MutexStack *s)
+{
+    MutexNode *lists[2] = { s->top, s->free };
+    int i;
+
+    for (i = 0; i < 2; i++)
+        while (lists[i] != NULL)
+        {
+            MutexNode *next = lists[i]->link;
+            free(lists[i]);
+            lists[i] = next;
+        }
+    pthread_mutex_destroy(&s->lock);
+}
+
+// ---------- the benchmark ----------
+
+enum { LOCK_FREE, MUTEX_POOLED, MUTEX_MALLOC };
+
+typedef struct
+{
+    pthread_t tid;
+    int kind, id;
+    long ops;
+    LfPool *pool;
+    LfStack *lf;
+    MutexStack *ms;
+    pthread_barrier_t *start;
+    long long pushed, popped; // sums of the values
+    int failed;
+} Worker;
+
+static void *workerMain(void *arg)
+{
+    Worker *w = arg;
+    long i;
+
+    pthread_barrier_wait(w->start);
+    for (i = 0; i < w->ops; i++)
+    {
+        int v = (int)(w->id * w->ops + i), got;
+        int pushedOk = w->kind == LOCK_FREE ? lfStackPush(w->pool, w->lf, v) : mutexStackPush(w->ms, v);
+        if (pushedOk != 0)
+        {
+            w->failed = 1;
+            break;
+        }
+        w->pushed += v;
+        if (w->kind == LOCK_FREE ? lfStackPop(w->pool, w->lf, &got) : mutexStackPop(w->ms, &got))
+            w->popped += got;
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// M push + pop pairs a second, or a negative number if a check failed
+static double run(int kind, int threads, long ops)
+{
+    Worker *w = calloc(threads, sizeof *w);
+    LfPool *pool = aligned_alloc(CACHE_LINE, sizeof *pool);
+    LfStack lf;
+    MutexStack ms;
+    pthread_barrier_t start;
+    long long pushed = 0, popped = 0;
+    double t;
+    int i, v, failed = 0;
+
+    if (w == NULL || pool == NULL || lfPoolInit(pool) != 0)
+    {
+        printf("Out of memory\n");
+        exit(1);
+    }
+    lfStackInit(&lf);
+    pthread_mutex_init(&ms.lock, NULL);
+    ms.top = ms.free = NULL;
+    ms.pooled = kind == MUTEX_POOLED;
+    pthread_barrier_init(&start, NULL, threads + 1);
+    for (i = 0; i < threads; i++)
+    {
+        w[i].kind = kind;
+        w[i].id = i;
+        w[i].ops = ops;
+        w[i].pool = pool;
+        w[i].lf = &lf;
+        w[i].ms = &ms;
+        w[i].start = &start;
+        pthread_create(&w[i].tid, NULL, workerMain, &w[i]);
+    }
+    pthread_barrier_wait(&start);
+    t = now();
+    for (i = 0; i < threads; i++)
+    {
+        pthread_join(w[i].tid, NULL);
+        pushed += w[i].pushed;
+        popped += w[i].popped;
+        failed |= w[i].failed;
+    }
+    t = now() - t;
+
+    while (kind == LOCK_FREE ? lfStackPop(pool, &lf, &v) : mutexStackPop(&ms, &v))
+        popped += v;
+    pthread_barrier_destroy(&start);
+    mutexStackFree(&ms);
+    lfPoolFree(pool);
+    free(pool);
+    free(w);
+    if (failed)
+        printf("Out of nodes\n");
+    return failed || pushed != popped ? -1 : threads * ops / t / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *names[] = { "lock-free", "mutex+pool", "mutex+malloc" };
+    int threads[64], counts = 0, i, k;
+    long ops = 1000000;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            ops = atol(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            char *p = argv[++i];
+            while (counts < 64 && *p != '\0')
+            {
+                threads[counts] = (int)strtol(p, &p, 10);
+                if (threads[counts] < 1)
+                    break;
+                counts++;
+                if (*p == ',')
+                    p++;
+            }
+            if (*p != '\0')
+                ops = -1;
+        }
+        else
+            ops = -1;
+    }
+    if (ops < 1)
+    {
+        printf("Usage: %s [--threads T,T,...] [--ops N]\n", argv[0]);
+        return 1;
+    }
+    if (counts == 0)
+        for (k = 1; k <= 64; k *= 2)
+            threads[counts++] = k;
+
+    printf("%ld push + pop pairs a thread, M pairs/s\n", ops);
+    printf("%8s %12s %12s %12s\n", "threads", names[0], names[1], names[2]);
+    for (i = 0; i < counts; i++)
+    {
+        printf("%8d", threads[i]);
+        for (k = LOCK_FREE; k <= MUTEX_MALLOC; k++)
+        {
+            double rate = run(k, threads[i], ops);
+            if (rate < 0)
+            {
+                printf("\n%s: the values popped do not match the values pushed\n", names[k]);
+                return 1;
+            }
+            printf(" %12.2f", rate);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    return 0;
+}
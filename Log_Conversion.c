@@ -1,14 +1,161 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <math.h>
+#include "Logarithm.h"
+#include "FloatText.h"
 
-int main(int argc, const char * argv[], value)
+/*
+ * Run with --stream BASE [fast] [DECIMALS] to take the logarithm, BASE
+ * one of ln, log2 or log10, of every number on stdin, separated by any
+ * white space, and write them one to a line; fast is the division-free
+ * polynomial, good to 6e-5. Anything that is not a number gives nan.
+ * --bench N times log() against logArray() on N values.
+ */
+
+#define BLOCK (1 << 20)
+#define BATCH 4096
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void flush_batch(OutBuffer *out, double *v, size_t n, int base, int accuracy, int decimals)
+{
+    size_t i;
+    logArray(v, v, n, base, accuracy);
+    for (i = 0; i < n; i++)
+    {
+        outFixed(out, v[i], decimals);
+        outChar(out, '\n');
+    }
+}
+
+static int stream(int base, int accuracy, int decimals)
+{
+    char *buf = malloc(BLOCK);
+    double *v = malloc(BATCH * sizeof *v);
+    size_t len = 0, got, k = 0;
+    OutBuffer out;
+    int eof = 0;
+    if (buf == NULL || v == NULL || outInit(&out, stdout, 0) != 0)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    while (!eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, BLOCK - len, stdin);
+        len += got;
+        eof = got == 0;
+        for (;;)
+        {
+            size_t start, end;
+            while (pos < len && is_space(buf[pos]))
+                pos++;
+            for (start = end = pos; end < len && !is_space(buf[end]); end++)
+                ;
+            // a number may go on into the next block
+            if (start == len || (end == len && !eof && !(start == 0 && len == BLOCK)))
+                break;
+            if (k == BATCH)
+            {
+                flush_batch(&out, v, k, base, accuracy, decimals);
+                k = 0;
+            }
+            if (end - start >= BLOCK / 2 || parseDouble(buf + start, buf + end, &v[k]) != 0)
+                v[k] = NAN;
+            k++;
+            pos = end;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+    flush_batch(&out, v, k, base, accuracy, decimals);
+    free(buf);
+    free(v);
+    if (outClose(&out) != 0 || ferror(stdin))
+    {
+        fprintf(stderr, "Read or write error\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int bench(size_t n)
+{
+    double *x = malloc(n * sizeof *x), *y = malloc(n * sizeof *y), t0, t1, t2, t3, sum = 0;
+    uint64_t seed = 88172645463325252ULL;
+    size_t i;
+    if (x == NULL || y == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    // positive values over many orders of magnitude
+    for (i = 0; i < n; i++)
+    {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        x[i] = ldexp((double)(seed >> 11) * 0x1p-53 + 0.5, (int)(seed % 64) - 32);
+    }
+    memset(y, 0, n * sizeof *y);
+    t0 = now();
+    for (i = 0; i < n; i++)
+        y[i] = log(x[i]);
+    t1 = now();
+    for (i = 0; i < n; i++)
+        sum += y[i];
+    logArray(x, y, n, LOG_E, LOG_EXACT);
+    t2 = now();
+    for (i = 0; i < n; i++)
+        sum -= y[i];
+    logArray(x, y, n, LOG_E, LOG_FAST);
+    t3 = now();
+    printf("%zu logs: log() %.3f s, logArray exact %.3f s (%.0f M/s), fast %.3f s (%.0f M/s); "
+           "exact - log() summed %.3g\n", n, t1 - t0, t2 - t1, n / (t2 - t1) / 1e6, t3 - t2, n / (t3 - t2) / 1e6, sum);
+    free(x);
+    free(y);
+    return 0;
+}
+
+int main(int argc, const char *argv[])
 {
     /* Define temporary variables */
     double value;
     double result;
 
+    if (argc >= 3 && argc <= 5 && strcmp(argv[1], "--stream") == 0)
+    {
+        int base = strcmp(argv[2], "ln") == 0 ? LOG_E : strcmp(argv[2], "log2") == 0 ? LOG_2 :
+                   strcmp(argv[2], "log10") == 0 ? LOG_10 : -1;
+        int fast = argc > 3 && strcmp(argv[3], "fast") == 0;
+        const char *decimals = argc > 3 + fast ? argv[3 + fast] : "6";
+        if (base < 0)
+        {
+            fprintf(stderr, "The base is ln, log2 or log10\n");
+            return 1;
+        }
+        return stream(base, fast ? LOG_FAST : LOG_EXACT, atoi(decimals));
+    }
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10));
+
+    printf("Enter a value: ");
+    if (scanf("%lf", &value) != 1)
+        return 1;
+
     /* Calculate the log of the value */
-    result = log(value);
+    result = logScalar(value, LOG_E, LOG_EXACT);
 
     /* Display the result of the calculation */
     printf("The Natural Logarithm of %f is %f\n", value, result);
@@ -0,0 +1,237 @@
+// Logarithms of whole arrays, for Log_Conversion.c and anything that
+// log-transforms columns of data.
+//
+// x = 2^k m with m in [sqrt(1/2), sqrt(2)), so log(x) = k ln 2 + log(m)
+// and only log(m) needs a polynomial; k and m come straight from the
+// bits of x. Two accuracies:
+//
+//   LOG_EXACT  log(1 + f) for f = m - 1 as fdlibm does it: s = f / (2 + f),
+//              log(1 + f) = 2 atanh(s), a degree 14 polynomial in s, with
+//              f^2 / 2 split off and ln 2 in two parts so that nothing is
+//              lost in the sum. For log2 and log10 log(m) is split in a
+//              high part of 21 bits and the rest, as fdlibm does, so that
+//              the high part times 1 / ln 2 or 1 / ln 10 is exact. Within
+//              1 ulp of glibc's log() and log2() and 2 of its log10().
+//   LOG_FAST   log(1 + f) = f P(f), P of degree 4 near minimax on the
+//              range of f, so no division: relative error below 6e-5.
+//
+// logArray() takes the base as LOG_E, LOG_2 or LOG_10. With AVX2 and FMA
+// four doubles go at a time through the same steps, the last few padded
+// to four, and any four with a value that is not a positive normal
+// double among them one at a time through logScalar(). Subnormals are
+// scaled by 2^54 first; log(0) is -infinity, log of a negative or NaN is
+// NaN and log(infinity) infinity, as with log(). Header-only.
+
+#ifndef LOGARITHM_H
+#define LOGARITHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+enum
+{
+    LOG_EXACT,
+    LOG_FAST
+};
+
+enum
+{
+    LOG_E,
+    LOG_2,
+    LOG_10
+};
+
+#define LOG_LN2_HI 6.93147180369123816490e-01
+#define LOG_LN2_LO 1.90821492927058770002e-10
+#define LOG_SQRT_HALF_BITS 0x3fe6a09e667f3bcdULL
+
+// fdlibm's odd series for 2 atanh(s) - 2s, in powers of s^2
+#define LOG_LG1 6.666666666666735130e-01
+#define LOG_LG2 3.999999999940941908e-01
+#define LOG_LG3 2.857142874366239149e-01
+#define LOG_LG4 2.222219843214978396e-01
+#define LOG_LG5 1.818357216161805012e-01
+#define LOG_LG6 1.531383769920937332e-01
+#define LOG_LG7 1.479819860511658591e-01
+
+// log(1 + f) / f for LOG_FAST, on [sqrt(1/2) - 1, sqrt(2) - 1]
+#define LOG_P0 0.9999621703796009
+#define LOG_P1 -0.4995021092024253
+#define LOG_P2 0.33668781598038144
+#define LOG_P3 -0.27010228270533315
+#define LOG_P4 0.17348631544939608
+
+// 1 / ln(base) and log_base(2), each also in two parts, the high one
+// with few enough bits that its products with the high part of log(m)
+// are exact
+static const double logScale[3] = {1.0, 1.4426950408889634, 0.43429448190325176};
+static const double logScaleHi[3] = {1.0, 1.44269504072144627571e+00, 4.34294481878168880939e-01};
+static const double logScaleLo[3] = {0.0, 1.67517131648865118353e-10, 2.50829467116452752298e-11};
+static const double logBaseOf2Hi[3] = {LOG_LN2_HI, 1.0, 3.01029995663611771306e-01};
+static const double logBaseOf2Lo[3] = {LOG_LN2_LO, 0.0, 3.69423907715893078616e-13};
+
+// x with the low 32 bits of its mantissa cleared
+static inline double logHighPart(double x)
+{
+    uint64_t u;
+    memcpy(&u, &x, sizeof u);
+    u &= 0xffffffff00000000ULL;
+    memcpy(&x, &u, sizeof x);
+    return x;
+}
+
+static inline double logScalar(double x, int base, int accuracy)
+{
+    uint64_t u;
+    double m, f, k, y, scale = logScale[base];
+    int64_t e;
+    if (!(x > 0) || x > 0x1.fffffffffffffp1023)
+        return x == 0 ? -1.0 / 0.0 : x > 0 ? x : (x - x) / (x - x);
+    k = 0;
+    if (x < 0x1p-1022)
+    {
+        x *= 0x1p54;
+        k = -54;
+    }
+    memcpy(&u, &x, sizeof u);
+    // the bits from those of sqrt(1/2) up are k 2^52 and then m's; with
+    // the exponent bias added k + 0x3ff is 1 to 2047
+    u = u - LOG_SQRT_HALF_BITS + (0x3ffULL << 52);
+    e = (int64_t)(u >> 52) - 0x3ff;
+    u = (u & 0x000fffffffffffffULL) + LOG_SQRT_HALF_BITS;
+    memcpy(&m, &u, sizeof m);
+    k += (double)e;
+    f = m - 1;
+    if (accuracy == LOG_FAST)
+    {
+        double p = f * LOG_P4 + LOG_P3;
+        p = p * f + LOG_P2;
+        p = p * f + LOG_P1;
+        p = p * f + LOG_P0;
+        y = f * p;
+        return k * (logBaseOf2Hi[base] + logBaseOf2Lo[base]) + y * scale;
+    }
+    {
+        double s = f / (2 + f), z = s * s, w = z * z, hfsq = 0.5 * f * f;
+        double t1 = w * (LOG_LG2 + w * (LOG_LG4 + w * LOG_LG6));
+        double t2 = z * (LOG_LG1 + w * (LOG_LG3 + w * (LOG_LG5 + w * LOG_LG7)));
+        double r = t2 + t1;
+        double hi, lo, vhi, vlo, sum;
+        if (base == LOG_E)
+            return k * LOG_LN2_HI - ((hfsq - (s * (hfsq + r) + k * LOG_LN2_LO)) - f);
+        // log(m) = hi + lo, and hi / ln(base) exactly in vhi
+        hi = logHighPart(f - hfsq);
+        lo = (f - hi) - hfsq + s * (hfsq + r);
+        vhi = hi * logScaleHi[base];
+        vlo = (lo + hi) * logScaleLo[base] + lo * logScaleHi[base] + k * logBaseOf2Lo[base];
+        y = k * logBaseOf2Hi[base];
+        sum = y + vhi;
+        vlo += (y - sum) + vhi;
+        return vlo + sum;
+    }
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+// logScalar() on four positive, normal doubles, with the polynomials in
+// FMAs
+static inline __m256d logVector(__m256d x, int base, int accuracy)
+{
+    const __m256i sqrtHalf = _mm256_set1_epi64x((long long)LOG_SQRT_HALF_BITS);
+    __m256i u = _mm256_add_epi64(_mm256_sub_epi64(_mm256_castpd_si256(x), sqrtHalf),
+                                 _mm256_set1_epi64x(0x3ffLL << 52));
+    // k + 0x3ff as a double: its 11 bits under the exponent of 2^52, less
+    // 2^52 and the bias
+    __m256i eBits = _mm256_or_si256(_mm256_srli_epi64(u, 52), _mm256_set1_epi64x(0x4330000000000000LL));
+    __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(eBits), _mm256_set1_pd(0x1p52 + 0x3ff));
+    __m256d m = _mm256_castsi256_pd(
+        _mm256_add_epi64(_mm256_and_si256(u, _mm256_set1_epi64x(0x000fffffffffffffLL)), sqrtHalf));
+    __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0)), y;
+    __m256d scale = _mm256_set1_pd(logScale[base]);
+    if (accuracy == LOG_FAST)
+    {
+        __m256d p = _mm256_fmadd_pd(f, _mm256_set1_pd(LOG_P4), _mm256_set1_pd(LOG_P3));
+        p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(LOG_P2));
+        p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(LOG_P1));
+        p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(LOG_P0));
+        y = _mm256_mul_pd(f, p);
+        return _mm256_add_pd(_mm256_mul_pd(k, _mm256_set1_pd(logBaseOf2Hi[base] + logBaseOf2Lo[base])),
+                             _mm256_mul_pd(y, scale));
+    }
+    {
+        __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+        __m256d z = _mm256_mul_pd(s, s), w = _mm256_mul_pd(z, z);
+        __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+        __m256d t1 = _mm256_fmadd_pd(w, _mm256_set1_pd(LOG_LG6), _mm256_set1_pd(LOG_LG4));
+        __m256d t2 = _mm256_fmadd_pd(w, _mm256_set1_pd(LOG_LG7), _mm256_set1_pd(LOG_LG5));
+        t1 = _mm256_mul_pd(w, _mm256_fmadd_pd(w, t1, _mm256_set1_pd(LOG_LG2)));
+        t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(LOG_LG3));
+        t2 = _mm256_mul_pd(z, _mm256_fmadd_pd(w, t2, _mm256_set1_pd(LOG_LG1)));
+        __m256d r = _mm256_add_pd(t2, t1), sr = _mm256_mul_pd(s, _mm256_add_pd(hfsq, r));
+        if (base == LOG_E)
+        {
+            __m256d lo = _mm256_add_pd(sr, _mm256_mul_pd(k, _mm256_set1_pd(LOG_LN2_LO)));
+            return _mm256_sub_pd(_mm256_mul_pd(k, _mm256_set1_pd(LOG_LN2_HI)),
+                                 _mm256_sub_pd(_mm256_sub_pd(hfsq, lo), f));
+        }
+        {
+            __m256d scaleHi = _mm256_set1_pd(logScaleHi[base]);
+            __m256d hi = _mm256_and_pd(_mm256_sub_pd(f, hfsq), _mm256_castsi256_pd(_mm256_set1_epi64x(-(1LL << 32))));
+            __m256d lo = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(f, hi), hfsq), sr);
+            __m256d vhi = _mm256_mul_pd(hi, scaleHi), vlo, sum;
+            vlo = _mm256_fmadd_pd(_mm256_add_pd(lo, hi), _mm256_set1_pd(logScaleLo[base]), _mm256_mul_pd(lo, scaleHi));
+            vlo = _mm256_fmadd_pd(k, _mm256_set1_pd(logBaseOf2Lo[base]), vlo);
+            y = _mm256_mul_pd(k, _mm256_set1_pd(logBaseOf2Hi[base]));
+            sum = _mm256_add_pd(y, vhi);
+            vlo = _mm256_add_pd(vlo, _mm256_add_pd(_mm256_sub_pd(y, sum), vhi));
+            return _mm256_add_pd(vlo, sum);
+        }
+    }
+}
+#endif
+
+// Four logarithms at a time when they are all of positive normal
+// doubles, otherwise one by one
+#if defined(__AVX2__) && defined(__FMA__)
+static inline void logFour(const double *in, double *out, int base, int accuracy)
+{
+    __m256d x = _mm256_loadu_pd(in);
+    __m256d ok = _mm256_and_pd(_mm256_cmp_pd(x, _mm256_set1_pd(0x1p-1022), _CMP_GE_OQ),
+                               _mm256_cmp_pd(x, _mm256_set1_pd(0x1.fffffffffffffp1023), _CMP_LE_OQ));
+    if (_mm256_movemask_pd(ok) == 15)
+        _mm256_storeu_pd(out, logVector(x, base, accuracy));
+    else
+    {
+        int j;
+        for (j = 0; j < 4; j++)
+            out[j] = logScalar(in[j], base, accuracy);
+    }
+}
+#endif
+
+// out[i] = log_base(in[i]) for i < n, at the given accuracy; in may be
+// out. The last n % 4 go through a vector of four too, padded with ones.
+static inline void logArray(const double *in, double *out, size_t n, int base, int accuracy)
+{
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    double t[4] = {1, 1, 1, 1};
+    for (; n - i >= 4; i += 4)
+        logFour(in + i, out + i, base, accuracy);
+    if (i < n)
+    {
+        memcpy(t, in + i, (n - i) * sizeof *t);
+        logFour(t, t, base, accuracy);
+        memcpy(out + i, t, (n - i) * sizeof *t);
+    }
+#else
+    for (; i < n; i++)
+        out[i] = logScalar(in[i], base, accuracy);
+#endif
+}
+
+#endif
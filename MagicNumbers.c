@@ -3,8 +3,15 @@
 //if the product of the sum and the reverse number of the sum is the given number then the number is the magic number.
 //Ex:1729 is a magic number 
 //Code:
+//  MagicNumbers                               asks for a number
+//  MagicNumbers --range LO HI [--threads N]   every magic number in [LO, HI]; there
+//                                             are none past 180000, where nine a digit
+//                                             times its reverse falls behind the number
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Digits.h"
   /* sum of digits of a number */
 int sumOfDigits(int num) {
 	int sum = 0;
@@ -25,9 +32,12 @@ int sumOfDigits(int num) {
         return rev;
   }
  
-int main () {
+int main (int argc, char **argv) {
         int num, sum, rev;
  
+        if (argc >= 4 && strcmp(argv[1], "--range") == 0)
+                return digitReport(DIGIT_MAGIC, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10),
+                                   argc > 5 && strcmp(argv[4], "--threads") == 0 ? atoi(argv[5]) : 1, "magic numbers") != 0;
         printf("Enter the value for a number:");
         scanf("%d", &num);
  
@@ -0,0 +1,282 @@
+// A 2-D matrix of int in one allocation, for the matrix programs
+// (DynamicTwoDArrayUsing*.c, SpiralMatrix.c, Diagonal-Difference.c,
+// SparseMatrix_017.c, transposeOfMatrix.c).
+//
+// An array of row pointers costs a malloc() and a pointer load per row,
+// and the rows land wherever the allocator puts them. Here the rows are
+// back to back in one block aligned to MATRIX_ALIGN bytes, each stride
+// elements apart: cols rounded up to a whole number of cache lines, so
+// every row starts on a line of its own, and one more line when a row
+// would then be a multiple of MATRIX_CRITICAL_STRIDE bytes. At such a
+// stride the same column of consecutive rows falls in the same cache set
+// and walking down a column thrashes a few sets while the rest sit idle.
+// Blocks of at least MATRIX_HUGE bytes are aligned to a 2 MB huge page
+// and marked MADV_HUGEPAGE, so a big matrix needs a few TLB entries
+// rather than one per 4 KB.
+//
+// matrixAt() is the element, matrixRow() the start of a row, and
+// matrixRowView() / matrixColView() / matrixDiagonal() / matrixAntiDiagonal()
+// give a MatrixView, a pointer, a length and a step, into the same memory
+// with nothing copied; viewSum() adds one up. matrixSpiral() and
+// matrixZigzag() copy the matrix out in those orders. The padding at the
+// end of each row is zeroed and not part of the matrix. matrixInit()
+// returns 0, or -1 when out of memory or when rows x stride does not fit
+// in a size_t. Header-only.
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define MATRIX_ALIGN 64
+#define MATRIX_CRITICAL_STRIDE 4096
+#define MATRIX_HUGE_PAGE (2u << 20)
+#define MATRIX_HUGE (4u << 20)
+
+typedef struct
+{
+    int *data;
+    size_t rows, cols, stride; // stride: elements from one row to the next
+} Matrix;
+
+typedef struct
+{
+    int *p;
+    size_t n, step;
+} MatrixView;
+
+static inline int matrixInit(Matrix *m, size_t rows, size_t cols)
+{
+    size_t line = MATRIX_ALIGN / sizeof(int), stride = (cols + line - 1) / line * line, bytes;
+    void *p;
+    memset(m, 0, sizeof *m);
+    if (stride == 0)
+        stride = line;
+    if (stride * sizeof(int) % MATRIX_CRITICAL_STRIDE == 0)
+        stride += line;
+    if (rows != 0 && stride > SIZE_MAX / sizeof(int) / rows)
+        return -1;
+    bytes = rows * stride * sizeof(int);
+    if (bytes == 0)
+        bytes = MATRIX_ALIGN;
+    if (posix_memalign(&p, bytes >= MATRIX_HUGE ? MATRIX_HUGE_PAGE : MATRIX_ALIGN, bytes) != 0)
+        return -1;
+#if defined(MADV_HUGEPAGE)
+    if (bytes >= MATRIX_HUGE)
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    memset(p, 0, bytes);
+    m->data = (int *)p;
+    m->rows = rows;
+    m->cols = cols;
+    m->stride = stride;
+    return 0;
+}
+
+static inline void matrixFree(Matrix *m)
+{
+    free(m->data);
+    m->data = NULL;
+    m->rows = m->cols = m->stride = 0;
+}
+
+static inline int *matrixRow(const Matrix *m, size_t i)
+{
+    return m->data + i * m->stride;
+}
+
+static inline int *matrixAt(const Matrix *m, size_t i, size_t j)
+{
+    return m->data + i * m->stride + j;
+}
+
+static inline int *viewAt(MatrixView v, size_t k)
+{
+    return v.p + k * v.step;
+}
+
+static inline MatrixView matrixRowView(const Matrix *m, size_t i)
+{
+    MatrixView v = {matrixRow(m, i), m->cols, 1};
+    return v;
+}
+
+static inline MatrixView matrixColView(const Matrix *m, size_t j)
+{
+    MatrixView v = {m->data + j, m->rows, m->stride};
+    return v;
+}
+
+// (0, 0), (1, 1), ... as far as the shorter side goes
+static inline MatrixView matrixDiagonal(const Matrix *m)
+{
+    MatrixView v = {m->data, m->rows < m->cols ? m->rows : m->cols, m->stride + 1};
+    return v;
+}
+
+// (0, cols - 1), (1, cols - 2), ...
+static inline MatrixView matrixAntiDiagonal(const Matrix *m)
+{
+    MatrixView v = {m->data + (m->cols ? m->cols - 1 : 0), m->rows < m->cols ? m->rows : m->cols, m->stride - 1};
+    return v;
+}
+
+// The sum of the elements of v. With AVX2 eight at a time with one
+// vpgatherdd, widened to 64 bits to add up; the loads are still one cache
+// line each for a column or diagonal, but all eight are in flight at once.
+static inline long long viewSum(MatrixView v)
+{
+    size_t k = 0;
+    long long sum = 0;
+#if defined(__AVX2__)
+    // the offsets of a gather are 32-bit
+    if (v.step <= INT32_MAX / 8)
+    {
+        __m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)v.step));
+        __m256i lo = _mm256_setzero_si256(), hi = lo;
+        long long part[4];
+        for (; k + 8 <= v.n; k += 8)
+        {
+            __m256i x = _mm256_i32gather_epi32(viewAt(v, k), idx, 4);
+            lo = _mm256_add_epi64(lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+            hi = _mm256_add_epi64(hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+        }
+        _mm256_storeu_si256((__m256i *)part, _mm256_add_epi64(lo, hi));
+        sum = part[0] + part[1] + part[2] + part[3];
+    }
+#endif
+    for (; k < v.n; k++)
+        sum += *viewAt(v, k);
+    return sum;
+}
+
+// Where (i, j) comes in the clockwise spiral of an r x c matrix: ring t
+// is the border of the (r - 2t) x (c - 2t) rectangle left inside the
+// rings before it, which take r c - (r - 2t)(c - 2t) places; each ring
+// is its top row left to right, right column down, bottom row right to
+// left and left column up
+static inline size_t spiralPos(size_t r, size_t c, size_t i, size_t j)
+{
+    size_t t = i, h, w, off;
+    t = r - 1 - i < t ? r - 1 - i : t;
+    t = j < t ? j : t;
+    t = c - 1 - j < t ? c - 1 - j : t;
+    h = r - 2 * t;
+    w = c - 2 * t;
+    off = r * c - h * w;
+    if (i == t)
+        return off + (j - t);
+    if (j == c - 1 - t)
+        return off + w + (i - t - 1);
+    if (i == r - 1 - t)
+        return off + w + (h - 1) + (c - 2 - t - j);
+    return off + w + (h - 1) + (w - 1) + (r - 2 - t - i);
+}
+
+// out[0 .. rows cols) = m in spiral order. Walking the spiral reads every
+// column side one cache line per element, and a big matrix is back in
+// memory for each ring. Here the rings go MATRIX_SPIRAL_RINGS at a time:
+// their top and bottom sides are one memcpy() and one reversed copy each,
+// and their columns, which are side by side, are read a row at a time,
+// one cache line on the left and one on the right, each element going
+// through a pointer into its ring's part of out that moves by one place
+// a row, up for a left column and down for a right one. The rows are
+// prefetched MATRIX_PREFETCH ahead, and the places in out a few lines
+// ahead of each pointer too: that is 2 MATRIX_SPIRAL_RINGS streams of
+// stores, more than the hardware follows on its own.
+#define MATRIX_SPIRAL_RINGS 16
+#define MATRIX_PREFETCH 8
+
+static inline size_t matrixSpiral(const Matrix *m, int *out)
+{
+    size_t r = m->rows, c = m->cols, rings = (r < c ? r + 1 : c + 1) / 2, t0, t, i, k;
+    for (t0 = 0; t0 < rings; t0 += MATRIX_SPIRAL_RINGS)
+    {
+        size_t t1 = t0 + MATRIX_SPIRAL_RINGS < rings ? t0 + MATRIX_SPIRAL_RINGS : rings;
+        // rings of two or more columns have a left one
+        size_t tl1 = t1 < c / 2 ? t1 : c / 2;
+        int *down[MATRIX_SPIRAL_RINGS], *up[MATRIX_SPIRAL_RINGS];
+        for (t = t0; t < t1; t++)
+        {
+            // ring t: the top row, the right column down to the bottom
+            // corner, the bottom row back and the left column up, which
+            // start at off, off + w, off + w + h - 1 and off + 2w + h - 2
+            size_t h = r - 2 * t, w = c - 2 * t, off = r * c - h * w;
+            const int *bottom = matrixRow(m, r - 1 - t);
+            memcpy(out + off, matrixAt(m, t, t), w * sizeof *out);
+            for (k = 0; h > 1 && k + 1 < w; k++)
+                out[off + w + h - 1 + k] = bottom[c - 2 - t - k];
+            // row t + 1 of each column, which is the last place of the
+            // left one
+            down[t - t0] = out + off + w;
+            up[t - t0] = h > 2 ? out + off + 2 * w + h - 2 + (h - 3) : NULL;
+        }
+        for (i = t0 + 1; i < r - t0; i++)
+        {
+            const int *row = matrixRow(m, i);
+            // the rings whose columns reach row i, from t0
+            size_t tr = i - 1 < r - 1 - i ? i - 1 : r - 1 - i, tl = i - 1 < r - 2 - i ? i - 1 : r - 2 - i;
+            if (i + MATRIX_PREFETCH < r)
+            {
+                __builtin_prefetch(row + MATRIX_PREFETCH * m->stride + t0);
+                __builtin_prefetch(row + MATRIX_PREFETCH * m->stride + c - t1);
+            }
+            for (t = t0; t < t1 && t <= tr; t++)
+            {
+                __builtin_prefetch(down[t - t0] + 4 * MATRIX_ALIGN / sizeof *out, 1);
+                *down[t - t0]++ = row[c - 1 - t];
+            }
+            for (t = t0; t < tl1 && i + 1 < r && t <= tl; t++)
+            {
+                __builtin_prefetch(up[t - t0] - 4 * MATRIX_ALIGN / sizeof *out, 1);
+                *up[t - t0]-- = row[t];
+            }
+        }
+    }
+    return r * c;
+}
+
+// out[0 .. rows cols) = m in zigzag order, as JPEG orders a block: the
+// antidiagonals i + j = d in turn, even ones from the bottom up and odd
+// ones from the top down. Each antidiagonal is read with a step of
+// stride - 1, prefetching MATRIX_PREFETCH elements ahead.
+static inline size_t matrixZigzag(const Matrix *m, int *out)
+{
+    size_t r = m->rows, c = m->cols, d, k = 0;
+    for (d = 0; r > 0 && c > 0 && d < r + c - 1; d++)
+    {
+        // the antidiagonal runs from (first, d - first) down to (last, d - last)
+        size_t first = d < c ? 0 : d - (c - 1), last = d < r ? d : r - 1, n = last - first + 1, e;
+        if (d % 2 == 1)
+        {
+            const int *p = matrixAt(m, first, d - first);
+            size_t step = m->stride - 1;
+            for (e = 0; e < n; e++, p += step)
+            {
+                __builtin_prefetch(p + MATRIX_PREFETCH * step);
+                out[k++] = *p;
+            }
+        }
+        else
+        {
+            const int *p = matrixAt(m, last, d - last);
+            size_t step = m->stride - 1;
+            for (e = 0; e < n; e++, p -= step)
+            {
+                __builtin_prefetch(p - MATRIX_PREFETCH * step);
+                out[k++] = *p;
+            }
+        }
+    }
+    return k;
+}
+
+#endif
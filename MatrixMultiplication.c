@@ -0,0 +1,205 @@
+//C program to multiply two matrices
+//
+//Run with --bench N THREADS [--counters] to compare the triple loop with Gemm.h on
+//N x N matrices of float, double and int, in GFLOP/s (a multiply and an
+//add counted as two operations). Add --counters for the hardware counters
+//of each (PerfCounters.h), per element of the product: cycles, IPC, cache,
+//branch and TLB misses. They count the calling thread only, so all of gemm
+//with THREADS 1, its share of the work otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "Matrix.h"
+#include "Gemm.h"
+#include "PerfCounters.h"
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int read_matrix(Matrix *m, const char *which)
+{
+    int row, col, i, j;
+    printf("Enter the order of the %s matrix \n", which);
+    if (scanf("%d %d", &row, &col) != 2 || row <= 0 || col <= 0 || matrixInit(m, row, col) != 0)
+    {
+        printf("Invalid order\n");
+        return -1;
+    }
+    printf("Enter the coefficients of the %s matrix\n", which);
+    for (i = 0; i < row; ++i)
+    {
+        for (j = 0; j < col; ++j)
+        {
+            if (scanf("%d", matrixAt(m, i, j)) != 1)
+            {
+                printf("Invalid coefficient\n");
+                matrixFree(m);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// One line of the counters of pc, per element of an n x n product; "-"
+// for a counter the machine does not have
+static void print_counters(const char *what, const PerfCounters *pc, size_t n)
+{
+    double elems = (double)n * n;
+    int e;
+    printf("  %-12s", what);
+    for (e = 0; e < PERF_EVENTS; e++)
+    {
+        if (perfHas(pc, e))
+            printf(" %s %.2f", perfName(e), pc->value[e] / elems);
+        else
+            printf(" %s -", perfName(e));
+        if (e == PERF_INSTRUCTIONS && perfHas(pc, PERF_CYCLES) && perfHas(pc, e) && pc->value[PERF_CYCLES] > 0)
+            printf(" ipc %.2f", (double)pc->value[e] / pc->value[PERF_CYCLES]);
+    }
+    printf("\n");
+}
+
+// The triple loop and gemm_<suffix> on the same n x n matrices; prints
+// both rates, and the counters of each when pc is not NULL, and returns 1
+// if the results differ by more than rounding
+#define BENCH(suffix, type, tolerance)                                         \
+static int bench_##suffix(TaskPool *pool, size_t n, PerfCounters *pc)          \
+{                                                                              \
+    type *a = malloc(n * n * sizeof *a), *b = malloc(n * n * sizeof *b);       \
+    type *c1 = malloc(n * n * sizeof *c1), *c2 = malloc(n * n * sizeof *c2);   \
+    size_t i, j, k;                                                            \
+    double t0, t1, t2, t3, flops = 2.0 * n * n * n, worst = 0;                 \
+    int bad = 0;                                                               \
+    PerfCounters loop; /* the triple loop's counts */                          \
+    if (a == NULL || b == NULL || c1 == NULL || c2 == NULL)                    \
+    {                                                                          \
+        printf("Out of memory\n");                                             \
+        free(a); free(b); free(c1); free(c2);                                  \
+        return 1;                                                              \
+    }                                                                          \
+    for (i = 0; i < n * n; i++)                                                \
+    {                                                                          \
+        a[i] = (type)((int)(i * 7 % 13) - 6);                                  \
+        b[i] = (type)((int)(i * 5 % 11) - 5);                                  \
+    }                                                                          \
+    memset(c2, 0, n * n * sizeof *c2);                                         \
+    if (pc != NULL)                                                            \
+    {                                                                          \
+        perfReset(pc);                                                         \
+        perfStart(pc);                                                         \
+    }                                                                          \
+    t0 = now();                                                                \
+    for (i = 0; i < n; i++)                                                    \
+        for (j = 0; j < n; j++)                                                \
+        {                                                                      \
+            type sum = 0;                                                      \
+            for (k = 0; k < n; k++)                                            \
+                sum += a[i * n + k] * b[k * n + j];                            \
+            c1[i * n + j] = sum;                                               \
+        }                                                                      \
+    t1 = now();                                                                \
+    if (pc != NULL)                                                            \
+    {                                                                          \
+        perfStop(pc);                                                          \
+        loop = *pc;                                                            \
+        perfReset(pc);                                                         \
+        perfStart(pc);                                                         \
+    }                                                                          \
+    t2 = now();                                                                \
+    if (gemm_##suffix(pool, n, n, n, a, n, b, n, c2, n) != 0)                  \
+        bad = 1;                                                               \
+    t3 = now();                                                                \
+    if (pc != NULL)                                                            \
+        perfStop(pc);                                                          \
+    for (i = 0; i < n * n; i++)                                                \
+    {                                                                          \
+        double d = fabs((double)c1[i] - (double)c2[i]);                        \
+        worst = d > worst ? d : worst;                                         \
+    }                                                                          \
+    bad |= worst > tolerance * n;                                              \
+    printf(#suffix ": %zu x %zu, triple loop %.2f GFLOP/s, gemm %.2f GFLOP/s%s\n", \
+           n, n, flops / (t1 - t0) / 1e9, flops / (t3 - t2) / 1e9,             \
+           bad ? " MISMATCH" : "");                                            \
+    if (pc != NULL)                                                            \
+    {                                                                          \
+        print_counters("triple loop", &loop, n);                               \
+        print_counters("gemm", pc, n);                                         \
+    }                                                                          \
+    free(a); free(b); free(c1); free(c2);                                      \
+    return bad;                                                                \
+}
+
+BENCH(f32, float, 1e-3)
+BENCH(f64, double, 1e-9)
+BENCH(i32, int32_t, 0.0)
+
+int main(int argc, char *argv[])
+{
+    Matrix a, b, c;
+    size_t i, j;
+
+    if ((argc == 4 || (argc == 5 && strcmp(argv[4], "--counters") == 0)) && strcmp(argv[1], "--bench") == 0)
+    {
+        TaskPool pool;
+        PerfCounters pc, *counters = NULL;
+        size_t n = strtoul(argv[2], NULL, 10);
+        int bad;
+        if (argc == 5)
+        {
+            if (perfOpen(&pc) != 0)
+                printf("No hardware counters here (perf_event_paranoid, or no PMU)\n");
+            counters = &pc;
+        }
+        if (poolCreate(&pool, atoi(argv[3])) != 0)
+            return 1;
+        bad = bench_f32(&pool, n, counters) | bench_f64(&pool, n, counters) | bench_i32(&pool, n, counters);
+        poolDestroy(&pool);
+        if (counters != NULL)
+            perfClose(counters);
+        return bad;
+    }
+
+    if (read_matrix(&a, "first") != 0)
+        return 1;
+    if (read_matrix(&b, "second") != 0)
+    {
+        matrixFree(&a);
+        return 1;
+    }
+    if (a.cols != b.rows)
+    {
+        printf("The columns of the first matrix must match the rows of the second\n");
+        matrixFree(&a);
+        matrixFree(&b);
+        return 1;
+    }
+    if (matrixInit(&c, a.rows, b.cols) != 0 || gemm_matrix(NULL, &a, &b, &c) != 0)
+    {
+        printf("Out of memory\n");
+        matrixFree(&a);
+        matrixFree(&b);
+        return 1;
+    }
+    printf("Product of the matrices is \n");
+    for (i = 0; i < c.rows; ++i)
+    {
+        for (j = 0; j < c.cols; ++j)
+        {
+            printf(" %d", *matrixAt(&c, i, j));
+        }
+        printf("\n");
+    }
+
+    matrixFree(&a);
+    matrixFree(&b);
+    matrixFree(&c);
+    return 0;
+}
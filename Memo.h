@@ -0,0 +1,263 @@
+// A memo cache for functions of one or two integers, for
+// FibonacciGeneration.c, Recursion.c and RecursiveFactorial.c: a query
+// that was answered before is answered again from the cache instead of
+// being worked out.
+//
+// The cache keeps at most capacity answers and drops the least recently
+// used when it is full, so a service that is asked the same few thousand
+// questions over and over keeps exactly those. It is cut into
+// MEMO_SHARDS shards by the hash of the key, each with its own lock,
+// table and LRU list, so threads that look up different keys seldom wait
+// for each other. A shard is a fixed array of nodes made by memoInit();
+// a bucket heads a chain of nodes through their chain index and the LRU
+// list runs through prev and next, most recent first, so a lookup or an
+// insert allocates nothing and an eviction reuses the tail node.
+//
+// A function is memoized by a wrapper with its own signature around the
+// body, so callers (and its own recursive calls, which then fill the
+// cache with every step) do not change:
+//
+//     static MemoCache memo;                  // memoInit(&memo, 4096) first
+//     uint64_t f(uint64_t n)
+//     {
+//         uint64_t v;
+//         if (memoGet(&memo, n, 0, &v))
+//             return v;
+//         v = fBody(n);
+//         memoPut(&memo, n, 0, v);
+//         return v;
+//     }
+//
+// Each shard counts its hits and misses; memoReport() prints them added
+// up. memoInit() returns 0, or -1 when out of memory; memoGet() returns 1
+// and sets *value on a hit, 0 on a miss. Header-only; build with -pthread.
+// It compiles as C++ too.
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MEMO_SHARDS 16
+#define MEMO_NONE UINT32_MAX
+
+typedef struct
+{
+    uint64_t a, b, value;
+    uint32_t prev, next; // LRU list, most recent at head
+    uint32_t chain;      // next node in the same bucket
+} MemoNode;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    MemoNode *node;
+    uint32_t *bucket;
+    uint32_t mask, capacity, used, head, tail;
+    uint64_t hits, misses;
+    char pad[64]; // keeps two shards' locks off one cache line
+} MemoShard;
+
+typedef struct
+{
+    MemoShard *shard;
+    size_t capacity;
+} MemoCache;
+
+static inline uint64_t memoHash(uint64_t a, uint64_t b)
+{
+    uint64_t h = (a ^ (b * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+    return h ^ h >> 31;
+}
+
+static inline void memoFree(MemoCache *c)
+{
+    int i;
+    if (c->shard == NULL)
+        return;
+    for (i = 0; i < MEMO_SHARDS; i++)
+    {
+        pthread_mutex_destroy(&c->shard[i].lock);
+        free(c->shard[i].node);
+        free(c->shard[i].bucket);
+    }
+    free(c->shard);
+    c->shard = NULL;
+}
+
+// Room for about capacity answers, capacity / MEMO_SHARDS to a shard
+static inline int memoInit(MemoCache *c, size_t capacity)
+{
+    uint32_t per = (uint32_t)((capacity + MEMO_SHARDS - 1) / MEMO_SHARDS), buckets = 1, i;
+    int s;
+    if (capacity > (size_t)MEMO_SHARDS << 28)
+        return -1;
+    if (per == 0)
+        per = 1;
+    while (buckets < 2 * per)
+        buckets *= 2;
+    c->capacity = (size_t)per * MEMO_SHARDS;
+    c->shard = (MemoShard *)calloc(MEMO_SHARDS, sizeof *c->shard);
+    if (c->shard == NULL)
+        return -1;
+    for (s = 0; s < MEMO_SHARDS; s++)
+    {
+        MemoShard *sh = &c->shard[s];
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->node = (MemoNode *)malloc(per * sizeof *sh->node);
+        sh->bucket = (uint32_t *)malloc(buckets * sizeof *sh->bucket);
+        if (sh->node == NULL || sh->bucket == NULL)
+        {
+            memoFree(c);
+            return -1;
+        }
+        for (i = 0; i < buckets; i++)
+            sh->bucket[i] = MEMO_NONE;
+        sh->mask = buckets - 1;
+        sh->capacity = per;
+        sh->head = sh->tail = MEMO_NONE;
+    }
+    return 0;
+}
+
+// ---------- one shard, under its lock ----------
+
+static inline void memoUnlink(MemoShard *sh, uint32_t i)
+{
+    MemoNode *n = &sh->node[i];
+    if (n->prev != MEMO_NONE)
+        sh->node[n->prev].next = n->next;
+    else
+        sh->head = n->next;
+    if (n->next != MEMO_NONE)
+        sh->node[n->next].prev = n->prev;
+    else
+        sh->tail = n->prev;
+}
+
+static inline void memoPushFront(MemoShard *sh, uint32_t i)
+{
+    MemoNode *n = &sh->node[i];
+    n->prev = MEMO_NONE;
+    n->next = sh->head;
+    if (sh->head != MEMO_NONE)
+        sh->node[sh->head].prev = i;
+    else
+        sh->tail = i;
+    sh->head = i;
+}
+
+static inline uint32_t memoFind(const MemoShard *sh, uint64_t h, uint64_t a, uint64_t b)
+{
+    uint32_t i = sh->bucket[h & sh->mask];
+    while (i != MEMO_NONE && (sh->node[i].a != a || sh->node[i].b != b))
+        i = sh->node[i].chain;
+    return i;
+}
+
+// Takes node i out of its bucket's chain
+static inline void memoUnchain(MemoShard *sh, uint32_t i)
+{
+    uint32_t *at = &sh->bucket[memoHash(sh->node[i].a, sh->node[i].b) & sh->mask];
+    while (*at != i)
+        at = &sh->node[*at].chain;
+    *at = sh->node[i].chain;
+}
+
+// ---------- the cache ----------
+
+static inline MemoShard *memoShard(MemoCache *c, uint64_t h)
+{
+    return &c->shard[h >> 60 & (MEMO_SHARDS - 1)];
+}
+
+static inline int memoGet(MemoCache *c, uint64_t a, uint64_t b, uint64_t *value)
+{
+    uint64_t h = memoHash(a, b);
+    MemoShard *sh = memoShard(c, h);
+    uint32_t i;
+    pthread_mutex_lock(&sh->lock);
+    i = memoFind(sh, h, a, b);
+    if (i == MEMO_NONE)
+    {
+        sh->misses++;
+        pthread_mutex_unlock(&sh->lock);
+        return 0;
+    }
+    sh->hits++;
+    *value = sh->node[i].value;
+    if (sh->head != i)
+    {
+        memoUnlink(sh, i);
+        memoPushFront(sh, i);
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return 1;
+}
+
+// Stores the answer for (a, b), dropping the least recently used one
+// when the shard is full
+static inline void memoPut(MemoCache *c, uint64_t a, uint64_t b, uint64_t value)
+{
+    uint64_t h = memoHash(a, b);
+    MemoShard *sh = memoShard(c, h);
+    uint32_t i, *bucket;
+    pthread_mutex_lock(&sh->lock);
+    i = memoFind(sh, h, a, b);
+    if (i != MEMO_NONE)
+    {
+        memoUnlink(sh, i);
+    }
+    else
+    {
+        if (sh->used < sh->capacity)
+        {
+            i = sh->used++;
+        }
+        else
+        {
+            i = sh->tail;
+            memoUnlink(sh, i);
+            memoUnchain(sh, i);
+        }
+        bucket = &sh->bucket[h & sh->mask];
+        sh->node[i].a = a;
+        sh->node[i].b = b;
+        sh->node[i].chain = *bucket;
+        *bucket = i;
+    }
+    sh->node[i].value = value;
+    memoPushFront(sh, i);
+    pthread_mutex_unlock(&sh->lock);
+}
+
+static inline void memoStats(MemoCache *c, uint64_t *hits, uint64_t *misses, size_t *entries)
+{
+    int s;
+    *hits = *misses = 0;
+    *entries = 0;
+    for (s = 0; s < MEMO_SHARDS; s++)
+    {
+        MemoShard *sh = &c->shard[s];
+        pthread_mutex_lock(&sh->lock);
+        *hits += sh->hits;
+        *misses += sh->misses;
+        *entries += sh->used;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+static inline void memoReport(MemoCache *c, FILE *f)
+{
+    uint64_t hits, misses;
+    size_t entries;
+    memoStats(c, &hits, &misses, &entries);
+    fprintf(f, "memo: %llu hits, %llu misses (%.1f%% hit), %zu of %zu entries\n", (unsigned long long)hits,
+            (unsigned long long)misses, hits + misses ? 100.0 * hits / (hits + misses) : 0.0, entries, c->capacity);
+}
+
+#endif
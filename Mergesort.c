@@ -1,24 +1,95 @@
 // Merge sort Algorithm
+//
+// Run with --parallel N to sort on N threads with the work-stealing pool
+// in TaskPool.h (build with -pthread). Both halves are sorted as
+// separate tasks, and big merges are cut into independent pieces by
+// co-ranking, so the merge steps run in parallel too.
+// Run with --bottom-up for an iterative merge sort that allocates one
+// scratch buffer for the whole sort.
+// Add --fast-input to read the numbers through FastInput.h instead of
+// one scanf() each, and --fast-output to print them through OutBuffer.h
+// instead of one printf() each (--async-output: from a writer thread).
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FastInput.h"
+#include "OutBuffer.h"
+#include "SortNetwork.h"
+#include "TaskPool.h"
+
+// arrays this small are sorted by one thread, without spawning tasks
+#define PARALLEL_CUTOFF (1 << 15)
+
+// and arrays this small by the sorting network in SortNetwork.h
+#define NETWORK_CUTOFF SORT_NETWORK_MAX
+
+// each parallel merge piece writes about this many elements
+#define MERGE_GRAIN (1 << 16)
 
 void mergesort(int a[], int i, int j);
 void merge(int a[], int i1, int j1, int i2, int j2);
+int parallel_mergesort(int a[], int n, int threads);
+int bottom_up_mergesort(int a[], int n);
+
+int main(int argc, char * argv[]) {
+  int * a, n, i, threads = 0, bottom_up = 0, fast_input = 0, fast_output = 0;
+  FastInput in;
+  OutBuffer out;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc && !bottom_up)
+      threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--bottom-up") == 0 && threads == 0)
+      bottom_up = 1;
+    else if (strcmp(argv[i], "--fast-input") == 0)
+      fast_input = 1;
+    else if (strcmp(argv[i], "--fast-output") == 0 || strcmp(argv[i], "--async-output") == 0)
+      fast_output = argv[i][2] == 'f' ? 1 : 2;
+    else {
+      printf("Usage: %s [--parallel THREADS | --bottom-up] [--fast-input] [--fast-output | --async-output]\n", argv[0]);
+      return 1;
+    }
+  }
 
-int main() {
-  int a[30], n, i;
+  if (fast_input && fastInputOpen( & in, stdin) != 0) {
+    printf("Out of memory");
+    return 1;
+  }
   printf("Enter no of elements:");
-  scanf("%d", & n);
+  if ((fast_input ? fastReadInt( & in, & n) != 0 : scanf("%d", & n) != 1) || n < 0)
+    return 1;
+  a = malloc((n ? n : 1) * sizeof * a);
+  if (a == NULL) {
+    printf("Out of memory");
+    return 1;
+  }
   printf("Enter array elements:");
 
-  for (i = 0; i < n; i++)
-    scanf("%d", & a[i]);
+  if (fast_input) {
+    fastReadInts( & in, a, n);
+    fastInputClose( & in);
+  } else
+    for (i = 0; i < n; i++)
+      scanf("%d", & a[i]);
 
-  mergesort(a, 0, n - 1);
+  if (threads > 0 || bottom_up) {
+    if ((bottom_up ? bottom_up_mergesort(a, n) : parallel_mergesort(a, n, threads)) != 0) {
+      printf("Out of memory");
+      return 1;
+    }
+  } else
+    mergesort(a, 0, n - 1);
 
   printf("\nSorted array is :");
-  for (i = 0; i < n; i++)
-    printf("%d ", a[i]);
+  if (fast_output && outInit( & out, stdout, fast_output == 2) == 0) {
+    outInts( & out, a, n, " ");
+    outClose( & out);
+  } else
+    for (i = 0; i < n; i++)
+      printf("%d ", a[i]);
 
+  free(a);
   return 0;
 }
 
@@ -34,8 +105,11 @@ void mergesort(int a[], int i, int j) {
 }
 
 void merge(int a[], int i1, int j1, int i2, int j2) {
-  int temp[50]; //array used for merging
+  int * temp; //array used for merging
   int i, j, k;
+  temp = malloc((j2 - i1 + 1) * sizeof * temp);
+  if (temp == NULL)
+    return;
   i = i1; //beginning of the first list
   j = i2; //beginning of the second list
   k = 0;
@@ -57,4 +131,202 @@ void merge(int a[], int i1, int j1, int i2, int j2) {
   //Transfer elements from temp[] back to a[]
   for (i = i1, j = 0; i <= j2; i++, j++)
     a[i] = temp[j];
+  free(temp);
+}
+
+// Co-ranking: how many of the first k merged elements come from x.
+// It is the smallest i for which y[k - i - 1] < x[i], found by binary
+// search. Ties go to x first, as in merge(), so the result is stable.
+static int co_rank(int k, const int * x, int nx, const int * y, int ny) {
+  int lo = k > ny ? k - ny : 0, hi = k < nx ? k : nx;
+  while (lo < hi) {
+    int i = lo + (hi - lo) / 2, j = k - i;
+    if (j > 0 && x[i] <= y[j - 1])
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  return lo;
+}
+
+// merges x[0..nx) and y[0..ny) into out
+static void merge_into(const int * x, int nx, const int * y, int ny, int * out) {
+  int i = 0, j = 0, k = 0;
+  while (i < nx && j < ny) {
+    if (y[j] < x[i])
+      out[k++] = y[j++];
+    else
+      out[k++] = x[i++];
+  }
+  while (i < nx)
+    out[k++] = x[i++];
+  while (j < ny)
+    out[k++] = y[j++];
+}
+
+typedef struct {
+  const int * x, * y;
+  int nx, ny;
+  int * out;
+  int k0, k1; // this piece writes out[k0..k1)
+} MergeTask;
+
+static void merge_piece(void * arg) {
+  MergeTask * m = arg;
+  int i0 = co_rank(m -> k0, m -> x, m -> nx, m -> y, m -> ny);
+  int i1 = co_rank(m -> k1, m -> x, m -> nx, m -> y, m -> ny);
+  merge_into(m -> x + i0, i1 - i0, m -> y + (m -> k0 - i0), (m -> k1 - i1) - (m -> k0 - i0), m -> out + m -> k0);
+}
+
+// Cuts the output into pieces of about MERGE_GRAIN elements. Each piece
+// finds where it starts in x and y by co-ranking, so the pieces share
+// nothing and merge in parallel.
+static void parallel_merge(TaskPool * pool, const int * x, int nx, const int * y, int ny, int * out) {
+  int n = nx + ny, pieces = (n + MERGE_GRAIN - 1) / MERGE_GRAIN, p;
+  MergeTask * m;
+  TaskGroup group;
+
+  m = pieces > 1 ? malloc(pieces * sizeof * m) : NULL;
+  if (m == NULL) {
+    merge_into(x, nx, y, ny, out);
+    return;
+  }
+
+  groupInit( & group);
+  for (p = 0; p < pieces; p++) {
+    m[p].x = x;
+    m[p].nx = nx;
+    m[p].y = y;
+    m[p].ny = ny;
+    m[p].out = out;
+    m[p].k0 = (int)((long long) n * p / pieces);
+    m[p].k1 = (int)((long long) n * (p + 1) / pieces);
+    if (p > 0)
+      poolSpawn(pool, & group, merge_piece, & m[p]);
+  }
+  merge_piece( & m[0]);
+  poolWait(pool, & group);
+  free(m);
+}
+
+typedef struct {
+  TaskPool * pool;
+  int * a, * b;
+  int n, into_b;
+} SortTask;
+
+static void sort_task(void * arg);
+
+// Sorts a[0..n), with b[0..n) as scratch. The result ends up in b when
+// into_b is set and in a otherwise. Both halves sort into the other
+// array, so each level merges from one array to the other and nothing
+// is copied back.
+static void parallel_sort_range(SortTask * t) {
+  int * a = t -> a, * b = t -> b, n = t -> n, h = n / 2;
+  int * src = t -> into_b ? a : b, * dst = t -> into_b ? b : a;
+  SortTask left, right;
+  TaskGroup group;
+
+  if (n <= NETWORK_CUTOFF) {
+    sortNetwork(a, n);
+    if (t -> into_b)
+      memcpy(b, a, n * sizeof * a);
+    return;
+  }
+
+  left = * t;
+  left.n = h;
+  left.into_b = !t -> into_b;
+  right = left;
+  right.a = a + h;
+  right.b = b + h;
+  right.n = n - h;
+
+  if (n <= PARALLEL_CUTOFF) {
+    parallel_sort_range( & left);
+    parallel_sort_range( & right);
+    merge_into(src, h, src + h, n - h, dst);
+    return;
+  }
+
+  groupInit( & group);
+  poolSpawn(t -> pool, & group, sort_task, & left);
+  parallel_sort_range( & right);
+  poolWait(t -> pool, & group);
+
+  parallel_merge(t -> pool, src, h, src + h, n - h, dst);
+}
+
+static void sort_task(void * arg) {
+  parallel_sort_range(arg);
+}
+
+// Returns 0 when sorted, -1 when out of memory. With one thread every
+// task simply runs inline.
+int parallel_mergesort(int a[], int n, int threads) {
+  TaskPool pool;
+  SortTask top;
+  int * b;
+
+  if (n < 2)
+    return 0;
+  b = malloc(n * sizeof * b);
+  if (b == NULL)
+    return -1;
+  if (poolCreate( & pool, threads) != 0) {
+    free(b);
+    return -1;
+  }
+
+  top.pool = & pool;
+  top.a = a;
+  top.b = b;
+  top.n = n;
+  top.into_b = 0;
+  parallel_sort_range( & top);
+
+  poolDestroy( & pool);
+  free(b);
+  return 0;
+}
+
+// Iterative merge sort. Runs of NETWORK_CUTOFF are sorted by the network
+// first, then runs of width w are merged into runs of 2w, alternating
+// between a and one scratch buffer so nothing is copied back after a
+// pass. When the last element of a run is not bigger than the first
+// of the next, the pair is already in order and is copied instead of
+// merged. No recursion, and the only allocation is the buffer.
+// Returns 0 when sorted, -1 when out of memory.
+int bottom_up_mergesort(int a[], int n) {
+  int * b, * src, * dst, * t, w, lo;
+
+  if (n < 2)
+    return 0;
+  b = malloc(n * sizeof * b);
+  if (b == NULL)
+    return -1;
+
+  for (lo = 0; lo < n; lo += NETWORK_CUTOFF)
+    sortNetwork(a + lo, n - lo < NETWORK_CUTOFF ? n - lo : NETWORK_CUTOFF);
+
+  src = a;
+  dst = b;
+  for (w = NETWORK_CUTOFF; w < n; w *= 2) {
+    for (lo = 0; lo < n; lo += 2 * w) {
+      int mid = lo + w < n ? lo + w : n;
+      int hi = lo + 2 * w < n ? lo + 2 * w : n;
+      if (mid == hi || src[mid - 1] <= src[mid])
+        memcpy(dst + lo, src + lo, (hi - lo) * sizeof * src);
+      else
+        merge_into(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+    }
+    t = src;
+    src = dst;
+    dst = t;
+  }
+
+  if (src != a)
+    memcpy(a, src, n * sizeof * a);
+  free(b);
+  return 0;
 }
@@ -1,10 +1,18 @@
 // Program to find if a number is mirror number or not
+//   MirrorNumber                               asks for a number
+//   MirrorNumber --range LO HI [--threads N]   every mirror number in [LO, HI]
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
-  int main() {
+#include "Digits.h"
+  int main(int argc, char **argv) {
     int num, reverse1, reverse2, remainder1, remainder2, square, sqroot;
     reverse1 = 0;
     reverse2 = 0;
+    if (argc >= 4 && strcmp(argv[1], "--range") == 0)
+      return digitReport(DIGIT_MIRROR, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10),
+        argc > 5 && strcmp(argv[4], "--threads") == 0 ? atoi(argv[5]) : 1, "mirror numbers") != 0;
 /*If we don't initialize than without a initial value,reverse1 and
 reverse2 will contain garbage values so that run time error will occur.
 */
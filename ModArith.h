@@ -0,0 +1,341 @@
+// Modular arithmetic on unsigned 64-bit values, for fastModuloExponentiation.c
+// and the number-theoretic transform in Polynomial_linklist.c.
+//
+// Every function takes values already reduced mod m (except modReduce) and
+// works for any modulus 1 <= m < 2^63: products go through 128 bits where
+// the compiler has them, so (a * b) % m never overflows the way it does in
+// 64 bits once m passes about 3e9.
+//
+//     uint64_t r = modPow(x, y, m);           // x^y mod m
+//     uint64_t inv = modInverse(a, p);        // 1/a mod a prime p
+//
+// modInverseEuclid() inverts mod any m, and says so when a has no
+// inverse. modInverseBatch() inverts a whole array for three multiplies
+// per value and one inverse in all, and modInverseTable() lists 1/i mod p
+// for every i up to n with one multiply each.
+//
+// For many products with one odd modulus, Montgomery form avoids the
+// division: montInit(n) once, values go in with montIn(), montMul()
+// multiplies them with two extra multiplies instead of a 128-by-64 divide,
+// and montOut() brings the result back. It works for every odd n < 2^64.
+// montPow() raises to a power in Montgomery form, and montPowBatch()
+// raises many bases to one power.
+//
+// Header-only.
+
+#ifndef MOD_ARITH_H
+#define MOD_ARITH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MONT_WINDOW 4 // sliding window bits in montPowBatch
+#define MONT_LANES 4  // bases side by side in montPowBatch
+
+// x mod m for any signed x, in 0 .. m-1
+static inline uint64_t modReduce(int64_t x, uint64_t m)
+{
+    int64_t r = x % (int64_t)m;
+    return (uint64_t)(r < 0 ? r + (int64_t)m : r);
+}
+
+static inline uint64_t modAdd(uint64_t a, uint64_t b, uint64_t m)
+{
+    uint64_t s = a + b; // no overflow, since a, b < 2^63
+    return s >= m ? s - m : s;
+}
+
+static inline uint64_t modSub(uint64_t a, uint64_t b, uint64_t m)
+{
+    return a >= b ? a - b : a + m - b;
+}
+
+static inline uint64_t modMul(uint64_t a, uint64_t b, uint64_t m)
+{
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)((unsigned __int128)a * b % m);
+#else
+    // double and add: a bit of b a step, every value stays below 2m
+    uint64_t r = 0;
+    while (b != 0)
+    {
+        if (b & 1)
+            r = modAdd(r, a, m);
+        a = modAdd(a, a, m);
+        b >>= 1;
+    }
+    return r;
+#endif
+}
+
+// the high and low halves of the 128-bit product a * b
+static inline uint64_t mulFull(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    *hi = (uint64_t)(p >> 64);
+    return (uint64_t)p;
+#else
+    uint64_t aL = (uint32_t)a, aH = a >> 32, bL = (uint32_t)b, bH = b >> 32;
+    uint64_t ll = aL * bL, lh = aL * bH, hl = aH * bL, hh = aH * bH;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (uint32_t)ll | mid << 32;
+#endif
+}
+
+typedef struct
+{
+    uint64_t n;   // the odd modulus
+    uint64_t inv; // 1/n mod 2^64
+    uint64_t one; // 2^64 mod n: 1 in Montgomery form
+    uint64_t r2;  // 2^128 mod n, for montIn
+} Montgomery;
+
+// (hi * 2^64 + lo) / 2^64 mod n, for hi < n
+static inline uint64_t montReduce(const Montgomery *mt, uint64_t hi, uint64_t lo)
+{
+    // m * n has the same low half as the input, so the difference is
+    // exactly (hi - high half of m * n) * 2^64, and that is in (-n, n)
+    uint64_t mh, m = lo * mt->inv;
+    mulFull(m, mt->n, &mh);
+    return hi >= mh ? hi - mh : hi - mh + mt->n;
+}
+
+static inline uint64_t montMul(const Montgomery *mt, uint64_t a, uint64_t b)
+{
+    uint64_t hi, lo = mulFull(a, b, &hi);
+    return montReduce(mt, hi, lo);
+}
+
+static inline Montgomery montInit(uint64_t n)
+{
+    Montgomery mt;
+    int i;
+
+    mt.n = n;
+    // Newton's iteration doubles the correct low bits: 3, 6, ..., 96
+    mt.inv = n;
+    for (i = 0; i < 5; i++)
+        mt.inv *= 2 - n * mt.inv;
+    mt.one = (0 - n) % n;
+#if defined(__SIZEOF_INT128__)
+    mt.r2 = (uint64_t)((unsigned __int128)mt.one * mt.one % n);
+#else
+    // double 2^64 mod n another 64 times, without overflowing
+    mt.r2 = mt.one;
+    for (i = 0; i < 64; i++)
+        mt.r2 = mt.r2 >= n - mt.r2 ? mt.r2 - (n - mt.r2) : mt.r2 + mt.r2;
+#endif
+    return mt;
+}
+
+// a < n into Montgomery form, a * 2^64 mod n
+static inline uint64_t montIn(const Montgomery *mt, uint64_t a)
+{
+    return montMul(mt, a, mt->r2);
+}
+
+static inline uint64_t montOut(const Montgomery *mt, uint64_t a)
+{
+    return montReduce(mt, 0, a);
+}
+
+// a^e, a and the result in Montgomery form. Right to left, bit by bit:
+// the squarings of a form one chain and the multiplies into r a second one
+// that trails it, so the two overlap and a 64-bit exponent costs about 64
+// multiply latencies. Left to right, even with a sliding window that
+// saves multiplies, every step waits for the one before, which measured
+// slower for a single power; montPowBatch() is where the window pays.
+static inline uint64_t montPow(const Montgomery *mt, uint64_t a, uint64_t e)
+{
+    uint64_t r = mt->one;
+
+    for (; e != 0; e >>= 1)
+    {
+        if (e & 1)
+            r = montMul(mt, r, a);
+        a = montMul(mt, a, a);
+    }
+    return r;
+}
+
+// out[i] = bases[i]^e mod mt->n for i < n, with ordinary (not Montgomery)
+// values in and out. MONT_LANES bases at a time go through the same
+// steps side by side, so their chains overlap and what counts is the
+// number of multiplies rather than their latency. That makes a sliding
+// window worth it: the exponent is read from the top in windows of up to
+// MONT_WINDOW bits ending in a 1, each window value v a multiply by a^v
+// from a table of a, a^3, ..., a^(2^MONT_WINDOW - 1). A 64-bit exponent
+// then takes 63 squarings and about 13 multiplies plus 8 for the table,
+// where bit by bit it is 63 squarings and a multiply per set bit.
+static inline void montPowBatch(const Montgomery *mt, const uint64_t *bases, uint64_t e,
+                                uint64_t *out, size_t n)
+{
+    size_t i = 0, full = e < (1u << MONT_WINDOW) ? 0 : n - n % MONT_LANES;
+    int bit, low, j, l;
+
+    for (; i < full; i += MONT_LANES)
+    {
+        uint64_t table[1 << (MONT_WINDOW - 1)][MONT_LANES], a2[MONT_LANES], r[MONT_LANES];
+        int started = 0;
+
+        for (l = 0; l < MONT_LANES; l++)
+        {
+            table[0][l] = montIn(mt, bases[i + l] % mt->n);
+            a2[l] = montMul(mt, table[0][l], table[0][l]);
+            r[l] = mt->one;
+        }
+        for (j = 1; j < 1 << (MONT_WINDOW - 1); j++)
+            for (l = 0; l < MONT_LANES; l++)
+                table[j][l] = montMul(mt, table[j - 1][l], a2[l]);
+        for (bit = 63 - __builtin_clzll(e); bit >= 0; bit = low - 1)
+        {
+            int v;
+            if ((e >> bit & 1) == 0)
+            {
+                for (l = 0; l < MONT_LANES; l++)
+                    r[l] = montMul(mt, r[l], r[l]);
+                low = bit;
+                continue;
+            }
+            // the longest window from bit down that ends in a 1
+            low = bit - MONT_WINDOW + 1 < 0 ? 0 : bit - MONT_WINDOW + 1;
+            while ((e >> low & 1) == 0)
+                low++;
+            v = (int)((e >> low & ((2ULL << (bit - low)) - 1)) >> 1);
+            // r is 1 before the first window, so that one is just a copy
+            for (l = 0; l < MONT_LANES; l++)
+            {
+                if (started)
+                {
+                    for (j = low; j <= bit; j++)
+                        r[l] = montMul(mt, r[l], r[l]);
+                    r[l] = montMul(mt, r[l], table[v][l]);
+                }
+                else
+                    r[l] = table[v][l];
+            }
+            started = 1;
+        }
+        for (l = 0; l < MONT_LANES; l++)
+            out[i + l] = montOut(mt, r[l]);
+    }
+    for (; i < n; i++)
+        out[i] = montOut(mt, montPow(mt, montIn(mt, bases[i] % mt->n), e));
+}
+
+// base^exp by squaring: a multiply per bit of exp, and no recursion. An
+// odd m goes through montPow() instead.
+static inline uint64_t modPow(uint64_t base, uint64_t exp, uint64_t m)
+{
+    uint64_t r = 1 % m;
+
+    base %= m;
+    if (m & 1 && m > 1)
+    {
+        Montgomery mt = montInit(m);
+        return montOut(&mt, montPow(&mt, montIn(&mt, base), exp));
+    }
+    while (exp != 0)
+    {
+        if (exp & 1)
+            r = modMul(r, base, m);
+        base = modMul(base, base, m);
+        exp >>= 1;
+    }
+    return r;
+}
+
+// 1/a mod p by Fermat's little theorem; p must be prime and a nonzero mod p
+static inline uint64_t modInverse(uint64_t a, uint64_t p)
+{
+    return modPow(a, p - 2, p);
+}
+
+// 1/a mod m for any modulus m >= 1 by the extended Euclidean algorithm.
+// Returns 0 and the inverse in *inv, or -1 when gcd(a, m) is not 1.
+static inline int modInverseEuclid(uint64_t a, uint64_t m, uint64_t *inv)
+{
+    // r0 = t0 a and r1 = t1 a mod m throughout. The t alternate in sign
+    // and never grow past m, so only their sizes are kept, and odd tells
+    // which of the two is negative.
+    uint64_t r0 = m, r1 = a % m, t0 = 0, t1 = 1;
+    int odd = 0;
+
+    while (r1 != 0)
+    {
+        uint64_t q = r0 / r1, r = r0 - q * r1, t = t0 + q * t1;
+        r0 = r1;
+        r1 = r;
+        t0 = t1;
+        t1 = t;
+        odd = !odd;
+    }
+    if (r0 != 1)
+        return -1;
+    *inv = odd && t0 != 0 ? t0 : (m - t0) % m;
+    return 0;
+}
+
+// out[i] = 1/a[i] mod m for i < n, for any m >= 1; out must not overlap a.
+// Montgomery's trick: out[] first holds the running products
+// a[0] ... a[i], one inverse of the last gives 1/(a[0] ... a[n-1]), and
+// going back down, 1/a[i] = (a[0] ... a[i-1]) / (a[0] ... a[i]) and the
+// inverse of the shorter product is the longer one's times a[i]. That is
+// 3 (n - 1) multiplies and one modInverseEuclid(). For an odd m they are
+// montMul(), on plain values: then the running products pick up a 1/2^64
+// per step, but each quotient taken on the way down gets back exactly one.
+// Returns 0, or -1 when some a[i] has no inverse, and then out is garbage.
+static inline int modInverseBatch(const uint64_t *a, uint64_t *out, size_t n, uint64_t m)
+{
+    uint64_t inv;
+    size_t i;
+
+    if (n == 0)
+        return 0;
+    out[0] = a[0] % m;
+    if (m & 1 && m > 1)
+    {
+        Montgomery mt = montInit(m);
+        for (i = 1; i < n; i++)
+            out[i] = montMul(&mt, out[i - 1], a[i] % m);
+        if (modInverseEuclid(out[n - 1], m, &inv) != 0)
+            return -1;
+        for (i = n - 1; i > 0; i--)
+        {
+            out[i] = montMul(&mt, out[i - 1], inv);
+            inv = montMul(&mt, inv, a[i] % m);
+        }
+    }
+    else
+    {
+        for (i = 1; i < n; i++)
+            out[i] = modMul(out[i - 1], a[i] % m, m);
+        if (modInverseEuclid(out[n - 1], m, &inv) != 0)
+            return -1;
+        for (i = n - 1; i > 0; i--)
+        {
+            out[i] = modMul(out[i - 1], inv, m);
+            inv = modMul(inv, a[i] % m, m);
+        }
+    }
+    out[0] = inv;
+    return 0;
+}
+
+// inv[i] = 1/i mod p for 1 <= i <= n, and inv[0] = 0; p prime and n < p.
+// p = (p / i) i + p % i, so 0 = (p / i) + (p % i) / i mod p, and
+// 1/i = -(p / i) / (p % i), where p % i < i is already in the table.
+static inline void modInverseTable(uint64_t *inv, size_t n, uint64_t p)
+{
+    size_t i;
+
+    inv[0] = 0;
+    if (n >= 1)
+        inv[1] = 1 % p;
+    for (i = 2; i <= n; i++)
+        inv[i] = p - modMul(p / i, inv[p % i], p);
+}
+
+#endif
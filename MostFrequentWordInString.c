@@ -1,65 +1,576 @@
+// Finds the most frequent word(s) in the input.
+//
+// Words are counted in a single pass with an open-addressing hash table.
+// The table stores string_views that point into the input buffer, so no
+// word is ever copied or allocated on its own.
+//
+// With --file, a whole file is read into memory and counted on several
+// threads at once, as a pipeline (Pipeline.h): blocks are counted while
+// the ones after them are still being read. The top-k words are printed;
+// --stats also prints what each stage of the pipeline did to stderr.
+//
+// With --approx CAPACITY, words are streamed and tracked with the
+// Space-Saving algorithm in a fixed number of counters, so memory does
+// not grow with the vocabulary. Counts are then estimates with bounds.
+//
+// This is a C++17 program: g++ -std=c++17 -pthread -x c++ MostFrequentWordInString.c
+
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AsyncRead.h"
+#include "Pipeline.h"
 
 using namespace std;
 
-int main()
+static const size_t WORD_BLOCK = 16 << 20; // bytes of the file a batch counts
+static const int WORD_READS = 4;           // blocks being read at once
+
+// Open-addressing (linear probing) word counter.
+// entries keeps the words in order of first appearance; slots maps a
+// hash position to an index in entries (-1 = empty). Growing the table
+// only rebuilds slots, never moves the words.
+class WordCounter
 {
-    cout << "Value of inputs in your array?" << endl;
-    int arraysize;
-    cin >> arraysize;
-    
-    cout << "Input array elements:" << endl;
-    
-    string array[arraysize];
-    
-    for(int i=0; i<arraysize; i++)
+public:
+    struct Entry
     {
-        cin >> array[i];
+        string_view word;
+        uint64_t hash;
+        long count;
+    };
+
+    WordCounter() : slots(1024, -1), mask(1023) {}
+
+    void add(string_view word)
+    {
+        add(word, hashWord(word), 1);
     }
-    
-    int most_occur = 1; 
-    
-    for(int i=0; i<arraysize-1; i++)
+
+    // Used when merging: the hash is already known
+    void add(string_view word, uint64_t h, long count)
     {
-        int times_occur = 1;
-        
-        for(int j=i+1; j<arraysize; j++)
-        {
-            if(array[i]==array[j])
-            times_occur = times_occur + 1;
-        }
-            
-        if(times_occur>most_occur)
+        size_t i = h & mask;
+
+        while (slots[i] >= 0)
         {
-            most_occur = times_occur;
+            Entry &e = entries[slots[i]];
+            if (e.hash == h && e.word == word)
+            {
+                e.count += count;
+                return;
+            }
+            i = (i + 1) & mask;
         }
-        
+
+        slots[i] = (int64_t) entries.size();
+        entries.push_back({word, h, count});
+        if (entries.size() * 2 > slots.size()) // keep load factor <= 0.5
+            grow();
     }
-    
-    if(most_occur>1)
+
+    const vector<Entry> &words() const
     {
-        cout << "Most occuring: ";
-        for(int i=0; i<arraysize-1; i++)
+        return entries;
+    }
+
+    // All words sharing the highest count, in order of first appearance
+    vector<string_view> mostFrequent(long &bestCount) const
+    {
+        vector<string_view> best;
+        bestCount = 0;
+        for (const Entry &e : entries)
         {
-            int times_occur = 1;
-        
-            for(int j=i+1; j<arraysize; j++)
+            if (e.count > bestCount)
             {
-                if(array[i]==array[j])
-                times_occur = times_occur + 1;
-            }
-            
-            if(times_occur==most_occur)
-            {
-                cout << array[i] << " ";
+                bestCount = e.count;
+                best.clear();
             }
+            if (e.count == bestCount)
+                best.push_back(e.word);
+        }
+        return best;
+    }
+
+    // The k most frequent words, highest count first; ties keep
+    // first-appearance order
+    vector<Entry> top(size_t k) const
+    {
+        vector<size_t> order(entries.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        k = min(k, order.size());
+        partial_sort(order.begin(), order.begin() + k, order.end(),
+                     [this](size_t a, size_t b)
+                     {
+                         if (entries[a].count != entries[b].count)
+                             return entries[a].count > entries[b].count;
+                         return a < b;
+                     });
+
+        vector<Entry> result;
+        for (size_t i = 0; i < k; i++)
+            result.push_back(entries[order[i]]);
+        return result;
+    }
+
+private:
+    vector<Entry> entries;
+    vector<int64_t> slots;
+    size_t mask;
+
+    // FNV-1a
+    static uint64_t hashWord(string_view word)
+    {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : word)
+        {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    void grow()
+    {
+        slots.assign(slots.size() * 2, -1);
+        mask = slots.size() - 1;
+        for (size_t k = 0; k < entries.size(); k++)
+        {
+            size_t i = entries[k].hash & mask;
+            while (slots[i] >= 0)
+                i = (i + 1) & mask;
+            slots[i] = (int64_t) k;
+        }
+    }
+};
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Counts up to maxWords whitespace-separated words of text (all if < 0)
+void countWords(string_view text, WordCounter &counter, long maxWords)
+{
+    size_t i = 0, n = text.size();
+    long seen = 0;
+
+    while (i < n && (maxWords < 0 || seen < maxWords))
+    {
+        while (i < n && isSpace(text[i]))
+            i++;
+        size_t start = i;
+        while (i < n && !isSpace(text[i]))
+            i++;
+        if (i > start)
+        {
+            counter.add(text.substr(start, i - start));
+            seen++;
+        }
+    }
+}
+
+// countFile() is a pipeline (Pipeline.h): read workers read blocks of
+// the file straight to their place in one buffer, count workers count
+// the words of each block into a table of its own, and a merge stage adds
+// the tables up in file order. A block's table only has the words that
+// lie wholly inside it, between its first and last whitespace; the merge
+// stage counts the word that runs across each boundary (the block before
+// is in by then) ahead of the block's table, which keeps the global
+// first-appearance order of a single pass.
+struct BlockCount
+{
+    WordCounter words;
+    bool spaced;        // the block has any whitespace
+    size_t first, last; // its first and last whitespace, from the start of the file
+};
+
+struct FileCount
+{
+    int fd;
+    unsigned char *data;
+    size_t size;
+    WordCounter counter;
+    size_t tail; // where the word still running at the last merged block starts
+};
+
+static int readBlock(void *ctx, PipeBatch *b, int)
+{
+    FileCount *f = (FileCount *) ctx;
+    size_t at = (size_t) b->seq * WORD_BLOCK;
+    if (at >= f->size)
+        return 0;
+    b->data = f->data + at;
+    b->len = min(WORD_BLOCK, f->size - at);
+    return asyncPread(f->fd, b->data, b->len, (off_t) at, (off_t) f->size) == (ssize_t) b->len ? 1 : -1;
+}
+
+static int countBlock(void *ctx, PipeBatch *b, int)
+{
+    FileCount *f = (FileCount *) ctx;
+    BlockCount &c = *(BlockCount *) b->user;
+    size_t first = 0, last = b->len;
+    const char *text = (const char *) b->data;
+
+    c.words = WordCounter();
+    while (first < b->len && !isSpace(text[first]))
+        first++;
+    c.spaced = first < b->len;
+    if (!c.spaced)
+        return 0;
+    while (!isSpace(text[last - 1]))
+        last--;
+    countWords(string_view(text + first, last - first), c.words, -1);
+    c.first = (size_t) (b->data - f->data) + first;
+    c.last = (size_t) (b->data - f->data) + last - 1;
+    return 0;
+}
+
+static int mergeBlock(void *ctx, PipeBatch *b, int)
+{
+    FileCount *f = (FileCount *) ctx;
+    BlockCount &c = *(BlockCount *) b->user;
+    if (!c.spaced)
+        return 0;
+    if (c.first > f->tail)
+        f->counter.add(string_view((const char *) f->data + f->tail, c.first - f->tail));
+    for (const WordCounter::Entry &e : c.words.words())
+        f->counter.add(e.word, e.hash, e.count);
+    c.words = WordCounter();
+    f->tail = c.last + 1;
+    return 0;
+}
+
+// Prints the top-k words of a whole file, counted on `threads` threads
+int countFile(const char *path, unsigned threads, size_t k, bool stats)
+{
+    FileCount f;
+    struct stat st;
+    Pipeline p;
+    void *data;
+    int status = 0;
+
+    f.fd = open(path, O_RDONLY);
+    if (f.fd < 0 || fstat(f.fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        if (f.fd >= 0)
+            errno = EINVAL;
+        cerr << "Cannot read " << path << ": " << strerror(errno) << endl;
+        if (f.fd >= 0)
+            close(f.fd);
+        return 1;
+    }
+    f.size = (size_t) st.st_size;
+    f.tail = 0;
+    if (posix_memalign(&data, ASYNC_ALIGN, f.size + 1) != 0 || pipeInit(&p, (int) threads + WORD_READS + 1, 0) != 0)
+    {
+        cerr << "Cannot read " << path << ": " << strerror(ENOMEM) << endl;
+        close(f.fd);
+        return 1;
+    }
+    f.data = (unsigned char *) data;
+
+    {
+        // one table per batch, for the block in it; the counter's views
+        // point into the buffer, so all of them go before it is freed
+        vector<BlockCount> blocks(p.batches);
+        for (int i = 0; i < p.batches; i++)
+            p.batch[i].user = &blocks[i];
+
+        if (pipeStage(&p, "read", readBlock, &f, WORD_READS, 0) != 0 ||
+            pipeStage(&p, "count", countBlock, &f, (int) threads, 0) != 0 ||
+            pipeStage(&p, "merge", mergeBlock, &f, 1, PIPE_ORDERED) != 0 || pipeRun(&p) != 0)
+        {
+            cerr << "Cannot read " << path << ": " << strerror(errno) << endl;
+            status = 1;
+        }
+        if (stats)
+            pipeReport(&p, stderr);
+
+        if (status == 0)
+        {
+            // the last word, if the file does not end in whitespace
+            if (f.tail < f.size)
+                f.counter.add(string_view((const char *) f.data + f.tail, f.size - f.tail));
+
+            long total = 0;
+            for (const WordCounter::Entry &e : f.counter.words())
+                total += e.count;
+
+            cout << total << " words, " << f.counter.words().size() << " distinct" << endl;
+            for (const WordCounter::Entry &e : f.counter.top(k))
+                cout << e.count << "\t" << e.word << "\n";
+        }
+        f.counter = WordCounter();
+    }
+
+    pipeFree(&p);
+    free(f.data);
+    close(f.fd);
+    return status;
+}
+
+// Space-Saving heavy hitters (Metwally, Agrawal, El Abbadi).
+// Keeps at most `capacity` counters. An unseen word takes over the
+// counter with the smallest count c and starts at c + 1 with error c,
+// so every estimate over-counts by at most its error, and by at most
+// N / capacity in general. The smallest counter is found with a
+// min-heap of counter indices.
+class SpaceSaving
+{
+public:
+    struct Counter
+    {
+        string word;
+        long count;
+        long error;
+    };
+
+    explicit SpaceSaving(size_t capacity) : capacity(capacity), seen(0)
+    {
+        // No reallocation ever happens, so the index may keep views into
+        // the counters' strings
+        counters.reserve(capacity);
+        heap.reserve(capacity);
+        heapPos.reserve(capacity);
+        index.reserve(capacity * 2);
+    }
+
+    void offer(string_view word)
+    {
+        seen++;
+
+        auto it = index.find(word);
+        if (it != index.end())
+        {
+            counters[it->second].count++;
+            siftDown(heapPos[it->second]);
+            return;
+        }
+
+        if (counters.size() < capacity)
+        {
+            size_t c = counters.size();
+            counters.push_back({string(word), 1, 0});
+            heap.push_back(c);
+            heapPos.push_back(c);
+            index.emplace(counters[c].word, c);
+            siftUp(c);
+            return;
+        }
+
+        size_t c = heap[0];
+        long min = counters[c].count;
+        index.erase(counters[c].word);
+        counters[c].word.assign(word.data(), word.size());
+        counters[c].count = min + 1;
+        counters[c].error = min;
+        index.emplace(counters[c].word, c);
+        siftDown(0);
+    }
+
+    long total() const
+    {
+        return seen;
+    }
+
+    // Largest possible over-count of any word
+    long maxError() const
+    {
+        return counters.size() < capacity ? 0 : counters[heap[0]].count;
+    }
+
+    vector<Counter> top(size_t k) const
+    {
+        vector<Counter> result(counters);
+        k = min(k, result.size());
+        partial_sort(result.begin(), result.begin() + k, result.end(),
+                     [](const Counter &a, const Counter &b) { return a.count > b.count; });
+        result.resize(k);
+        return result;
+    }
+
+private:
+    size_t capacity;
+    long seen;
+    vector<Counter> counters;
+    vector<size_t> heap;    // counter indices, min count at heap[0]
+    vector<size_t> heapPos; // heapPos[c] = position of counter c in heap
+    unordered_map<string_view, size_t> index;
+
+    long key(size_t pos) const
+    {
+        return counters[heap[pos]].count;
+    }
+
+    void swapNodes(size_t a, size_t b)
+    {
+        swap(heap[a], heap[b]);
+        heapPos[heap[a]] = a;
+        heapPos[heap[b]] = b;
+    }
+
+    void siftUp(size_t pos)
+    {
+        while (pos > 0 && key((pos - 1) / 2) > key(pos))
+        {
+            swapNodes(pos, (pos - 1) / 2);
+            pos = (pos - 1) / 2;
+        }
+    }
+
+    void siftDown(size_t pos)
+    {
+        for (;;)
+        {
+            size_t l = 2 * pos + 1, r = l + 1, smallest = pos;
+            if (l < heap.size() && key(l) < key(smallest))
+                smallest = l;
+            if (r < heap.size() && key(r) < key(smallest))
+                smallest = r;
+            if (smallest == pos)
+                return;
+            swapNodes(pos, smallest);
+            pos = smallest;
         }
     }
-    
+};
+
+void printHeavyHitters(const SpaceSaving &ss, size_t k)
+{
+    vector<SpaceSaving::Counter> best = ss.top(k + 1);
+    long next = best.size() > k ? best[k].count : 0;
+    if (best.size() > k)
+        best.resize(k);
+
+    cout << ss.total() << " words, every count is at most " << ss.maxError() << " too high" << endl;
+    for (const SpaceSaving::Counter &c : best)
+    {
+        // true count lies in [count - error, count]; the word is surely
+        // in the top k if even its lower bound beats the next estimate
+        cout << c.count << "\t" << c.word << "\t(" << c.count - c.error << ".." << c.count << ")";
+        if (c.count - c.error >= next)
+            cout << " guaranteed";
+        cout << "\n";
+    }
+    cout.flush();
+}
+
+// Streams words from `in` with a fixed number of counters, printing the
+// heavy hitters every `every` words (0 = only at the end)
+int countApprox(istream &in, size_t capacity, size_t k, long every)
+{
+    SpaceSaving ss(capacity);
+    string word;
+
+    while (in >> word)
+    {
+        ss.offer(word);
+        if (every > 0 && ss.total() % every == 0)
+            printHeavyHitters(ss, k);
+    }
+
+    if (every <= 0 || ss.total() % every != 0 || ss.total() == 0)
+        printHeavyHitters(ss, k);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    ios::sync_with_stdio(false);
+
+    // MostFrequentWordInString --file PATH [--threads N] [--top K] [--stats]
+    // MostFrequentWordInString --approx CAPACITY [--file PATH] [--top K] [--every N]
+    const char *path = NULL;
+    unsigned threads = thread::hardware_concurrency();
+    size_t k = 10;
+    size_t capacity = 0;
+    long every = 0;
+    bool stats = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            k = (size_t) atol(argv[++i]);
+        else if (strcmp(argv[i], "--approx") == 0 && i + 1 < argc)
+            capacity = (size_t) atol(argv[++i]);
+        else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc)
+            every = atol(argv[++i]);
+        else if (strcmp(argv[i], "--stats") == 0)
+            stats = true;
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--file PATH [--threads N] [--top K] [--stats]]" << endl;
+            cerr << "       " << argv[0] << " --approx CAPACITY [--file PATH] [--top K] [--every N]" << endl;
+            return 1;
+        }
+    }
+
+    if (capacity > 0)
+    {
+        if (path == NULL)
+            return countApprox(cin, capacity, k, every);
+
+        ifstream in(path);
+        if (!in)
+        {
+            cerr << "Cannot open " << path << endl;
+            return 1;
+        }
+        return countApprox(in, capacity, k, every);
+    }
+
+    if (path != NULL)
+        return countFile(path, threads == 0 ? 1 : threads, k, stats);
+
+    cout << "Value of inputs in your array?" << endl;
+    long arraysize;
+    if (!(cin >> arraysize))
+        return 1;
+
+    cout << "Input array elements:" << endl;
+
+    // Read the rest of the input into one buffer; the counter's
+    // string_views point into it, so it must outlive the counter
+    string buffer((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+
+    WordCounter counter;
+    countWords(buffer, counter, arraysize);
+
+    long most_occur;
+    vector<string_view> best = counter.mostFrequent(most_occur);
+
+    if (most_occur > 1)
+    {
+        cout << "Most occuring: ";
+        for (string_view w : best)
+            cout << w << " ";
+    }
+
     else
     {
         cout << "No specific array elements are repeating.";
     }
-    
+
     return 0;
+}
@@ -1,23 +1,108 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ModArith.h"
 
-int naiveModInv(int x, int y)
+// 1/a mod m is the x with a * x = 1 mod m. Trying every x < m is O(m); the
+// extended Euclidean algorithm finds it in O(log m) steps, for any m, and
+// tells when there is none (a and m share a factor): modInverseEuclid()
+// from ModArith.h.
+//
+// Run with --bench N to time N inverses mod a 64-bit odd modulus, one
+// Euclid or one Fermat power each against modInverseBatch(), which needs
+// three multiplies per value and a single inverse, and modInverseTable(),
+// all of 1/1 .. 1/N mod the prime 1e9+7.
+
+double now()
 {
-	// If there is an immediate value reduction
-	x %= y; 
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-	for(int i = 1; i < y; i++)
-		if((x * i) % y == 1)
-			return i;
+int bench(size_t n)
+{
+	uint64_t *a = malloc(n * sizeof(uint64_t)), *out = malloc((n + 1) * sizeof(uint64_t));
+	uint64_t seed = 88172645463325252ULL, m = (1ULL << 63) - 25, p = 1000000007;
+	uint64_t sum[3] = {0, 0, 0}, x;
+	double t[6];
+	size_t i;
+	if (a == NULL || out == NULL || n == 0 || n >= p)
+	{
+		printf("Cannot set up %zu values\n", n);
+		return 1;
+	}
+	// m is odd, so the batch runs in Montgomery form; a value that shares
+	// a factor with m is drawn again
+	for (i = 0; i < n; i++)
+	{
+		do
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			a[i] = seed % m;
+		} while (modInverseEuclid(a[i], m, &x) != 0);
+	}
+	t[0] = now();
+	for (i = 0; i < n; i++)
+	{
+		modInverseEuclid(a[i], m, &x);
+		sum[0] += x;
+	}
+	t[1] = now();
+	// Fermat needs a prime, so it runs mod p
+	for (i = 0; i < n; i++)
+		sum[1] += modInverse(a[i] % (p - 1) + 1, p);
+	t[2] = now();
+	if (modInverseBatch(a, out, n, m) != 0)
+	{
+		printf("No inverse\n");
+		return 1;
+	}
+	t[3] = now();
+	for (i = 0; i < n; i++)
+		sum[2] += out[i];
+	if (sum[2] != sum[0])
+	{
+		printf("Mismatch\n");
+		return 1;
+	}
+	t[4] = now();
+	modInverseTable(out, n, p);
+	t[5] = now();
+	for (i = 1; i <= n; i++)
+		if (modMul(out[i], i, p) != 1)
+		{
+			printf("Mismatch at %zu\n", i);
+			return 1;
+		}
+	printf("%zu inverses\n", n);
+	printf("Euclid per value  %.1f ns (%llu)\n", (t[1] - t[0]) * 1e9 / n, (unsigned long long)sum[0]);
+	printf("Fermat per value  %.1f ns, mod 1e9+7 (%llu)\n", (t[2] - t[1]) * 1e9 / n, (unsigned long long)sum[1]);
+	printf("batch             %.1f ns\n", (t[3] - t[2]) * 1e9 / n);
+	printf("table 1..N        %.1f ns, mod 1e9+7\n", (t[5] - t[4]) * 1e9 / n);
+	free(a);
+	free(out);
+	return 0;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	unsigned long long a, m;
+	uint64_t ans;
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+		return bench((size_t)strtod(argv[2], NULL));
 	printf("Enter a and m: ");
-	int a, m;
-	scanf("%d%d", &a, &m);
-	
-	int ans = naiveModInv(a, m);
-	printf("%d\n", ans);	
-	
+	if (scanf("%llu%llu", &a, &m) != 2 || m == 0)
+		return 1;
+
+	if (modInverseEuclid(a, m, &ans) != 0)
+		printf("No inverse: %llu and %llu have a common factor\n", a, m);
+	else
+		printf("%llu\n", (unsigned long long)ans);
+
 	return 0;
 }
@@ -0,0 +1,142 @@
+// A pool allocator for the fixed-size nodes of the linked list programs:
+// LinkedLists.c, Polynomial_linklist.c, "Linked List Creation" and
+// linkedlist.cpp.
+//
+// Nodes are cut out of chunks of NODE_POOL_CHUNK nodes, so building a
+// list of n nodes calls malloc n / NODE_POOL_CHUNK times instead of n.
+// A freed node goes on a free list and is handed out again first.
+// nodePoolRelease() frees every node of the pool at once, one free() per
+// chunk: a list that has a pool to itself is deleted that way without
+// walking it.
+//
+//     NodePool pool = NODE_POOL_INITIALIZER(sizeof(struct node));
+//     struct node *p = (struct node *)nodePoolAlloc(&pool);
+//
+// Built with -DGUARD_ALLOC, a sample of the nodes come from GuardAlloc.h
+// instead, each against a guard page. Header-only; it compiles as C++ too.
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(GUARD_ALLOC)
+#include "GuardAlloc.h"
+#endif
+
+#define NODE_POOL_CHUNK 4096
+
+// what malloc guarantees on common targets, so any node type fits
+#define NODE_POOL_ALIGN (2 * sizeof(void *))
+
+// chunks start on a cache line, so nodes whose size is a multiple of
+// it do not straddle lines
+#define NODE_POOL_CACHE_LINE 64
+
+// a hint to start loading the node at p, which may be NULL; list walks
+// give it the node after next
+#if defined(__GNUC__)
+#define NODE_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define NODE_PREFETCH(p) ((void)(p))
+#endif
+
+typedef struct NodeChunk
+{
+    struct NodeChunk *next;
+} NodeChunk;
+
+typedef struct
+{
+    size_t nodeSize;
+    NodeChunk *chunks;         // every chunk, newest first
+    void *freeList;            // freed nodes; each holds a pointer to the next
+    unsigned char *fresh;      // nodes of the newest chunk never handed out
+    unsigned char *freshEnd;
+} NodePool;
+
+#define NODE_POOL_INITIALIZER(size) { (size), NULL, NULL, NULL, NULL }
+
+static inline void nodePoolInit(NodePool *pool, size_t nodeSize)
+{
+    pool->nodeSize = nodeSize;
+    pool->chunks = NULL;
+    pool->freeList = NULL;
+    pool->fresh = pool->freshEnd = NULL;
+}
+
+// room for each node: at least a free list pointer, and aligned
+static inline size_t nodePoolStride(const NodePool *pool)
+{
+    size_t size = pool->nodeSize < sizeof(void *) ? sizeof(void *) : pool->nodeSize;
+    return (size + NODE_POOL_ALIGN - 1) / NODE_POOL_ALIGN * NODE_POOL_ALIGN;
+}
+
+// Returns NULL when out of memory
+static inline void *nodePoolAlloc(NodePool *pool)
+{
+    size_t stride = nodePoolStride(pool);
+    void *node;
+
+#if defined(GUARD_ALLOC)
+    if (guardSampleNow() && (node = guardSlotAlloc(pool->nodeSize, guardAlignFor(pool->nodeSize), pool)) != NULL)
+        return node;
+#endif
+    if (pool->freeList != NULL)
+    {
+        node = pool->freeList;
+        pool->freeList = *(void **)node;
+        return node;
+    }
+    if (pool->fresh == pool->freshEnd)
+    {
+        size_t header = NODE_POOL_CACHE_LINE;
+        size_t bytes = (header + NODE_POOL_CHUNK * stride + NODE_POOL_CACHE_LINE - 1) /
+                       NODE_POOL_CACHE_LINE * NODE_POOL_CACHE_LINE;
+        NodeChunk *chunk = (NodeChunk *)aligned_alloc(NODE_POOL_CACHE_LINE, bytes);
+        if (chunk == NULL)
+            return NULL;
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->fresh = (unsigned char *)chunk + header;
+        pool->freshEnd = pool->fresh + NODE_POOL_CHUNK * stride;
+    }
+    node = pool->fresh;
+    pool->fresh += stride;
+    return node;
+}
+
+// node must have come from this pool; NULL is ignored
+static inline void nodePoolFree(NodePool *pool, void *node)
+{
+    if (node == NULL)
+        return;
+#if defined(GUARD_ALLOC)
+    if (guardOwns(node))
+    {
+        guardFree(node);
+        return;
+    }
+#endif
+    *(void **)node = pool->freeList;
+    pool->freeList = node;
+}
+
+// Frees every node of the pool. The pool can be used again afterwards.
+static inline void nodePoolRelease(NodePool *pool)
+{
+#if defined(GUARD_ALLOC)
+    guardFreeOwned(pool);
+#endif
+    while (pool->chunks != NULL)
+    {
+        NodeChunk *next = pool->chunks->next;
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+    pool->freeList = NULL;
+    pool->fresh = pool->freshEnd = NULL;
+}
+
+#endif
@@ -0,0 +1,157 @@
+// The number-theoretic transform, for Polynomial_linklist.c and the
+// factorials of Factorial.h.
+//
+// nttTransform() is the FFT over the integers mod a prime p = c 2^k + 1,
+// with a root of unity mod p in place of e^(2 pi i / n): in place, for
+// n = 2^j <= 2^k values, iterative, bit-reversed input first. The root
+// powers are made once a transform, each level's in a row of its own, so
+// that a level reads them in order. They are kept in Montgomery form
+// (ModArith.h), so a butterfly's product is montMul() of a plain value and
+// a root, which comes out a plain value again, with no division; making
+// the roots takes none either. Values stay in 0 .. p-1 and the output
+// matches a transform done with %. p must be an odd prime.
+//
+// nttMultiplyMod() multiplies polynomials with coefficients mod any m
+// below 2^32. A coefficient of the product can be as large as
+// n m^2, more than one NTT prime holds, so it is computed mod three of
+// them, NTT_P1 NTT_P2 NTT_P3 ~ 2^86, and put back together by Garner's
+// form of the Chinese remainder theorem before it is reduced mod m. That
+// is exact while the shorter factor has at most 2^21 coefficients. With
+// cyclic != 0 the product wraps around mod x^cyclic - 1 instead, for
+// callers that want only the middle of a product, as Factorial.h does;
+// neither factor may then be longer than cyclic.
+//
+// Header-only; returns 0, or -1 on a length over NTT_MAX_LOG bits or out of
+// memory.
+
+#ifndef NTT_H
+#define NTT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ModArith.h"
+
+#define NTT_P1 998244353ULL // 119 2^23 + 1
+#define NTT_P2 167772161ULL // 5 2^25 + 1
+#define NTT_P3 469762049ULL // 7 2^26 + 1
+#define NTT_ROOT 3          // a generator mod each of the three
+#define NTT_MAX_LOG 23
+
+// a[0 .. n) to its transform mod p, or back with invert; n = 2^j
+static inline int nttTransform(uint64_t *a, size_t n, uint64_t p, uint64_t root, int invert)
+{
+    size_t i, j, h, half = n / 2;
+    uint64_t *w, step;
+    Montgomery mt;
+    if (n < 2)
+        return 0;
+    w = (uint64_t *)malloc(n * sizeof *w);
+    if (w == NULL)
+        return -1;
+    for (i = 1, j = 0; i < n; i++) // bit-reversed order first
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            uint64_t t = a[i];
+            a[i] = a[j];
+            a[j] = t;
+        }
+    }
+    mt = montInit(p);
+    step = modPow(root, (p - 1) / n, p);
+    if (invert)
+        step = modInverse(step, p);
+    step = montIn(&mt, step);
+    // the roots of the butterflies of half h at w[h .. 2h), every other
+    // one of the next level's
+    w[half] = mt.one;
+    for (i = 1; i < half; i++)
+        w[half + i] = montMul(&mt, w[half + i - 1], step);
+    for (h = half / 2; h >= 1; h /= 2)
+        for (i = 0; i < h; i++)
+            w[h + i] = w[2 * h + 2 * i];
+    for (h = 1; h < n; h *= 2)
+        for (i = 0; i < n; i += 2 * h)
+            for (j = 0; j < h; j++) // the butterfly
+            {
+                uint64_t u = a[i + j], v = montMul(&mt, a[i + j + h], w[h + j]);
+                a[i + j] = u + v < p ? u + v : u + v - p;
+                a[i + j + h] = u >= v ? u - v : u + p - v;
+            }
+    if (invert)
+    {
+        uint64_t inv = montIn(&mt, modInverse(n % p, p));
+        for (i = 0; i < n; i++)
+            a[i] = montMul(&mt, a[i], inv);
+    }
+    free(w);
+    return 0;
+}
+
+// out = a b mod p through size-n transforms, fa and fb n values of scratch
+static inline int nttConvolve(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, size_t n, uint64_t p,
+                              uint64_t *fa, uint64_t *fb)
+{
+    size_t i;
+    memset(fa, 0, n * sizeof *fa);
+    memset(fb, 0, n * sizeof *fb);
+    for (i = 0; i < na; i++)
+        fa[i] = a[i] % p;
+    for (i = 0; i < nb; i++)
+        fb[i] = b[i] % p;
+    if (nttTransform(fa, n, p, NTT_ROOT, 0) != 0 || nttTransform(fb, n, p, NTT_ROOT, 0) != 0)
+        return -1;
+    for (i = 0; i < n; i++)
+        fa[i] = modMul(fa[i], fb[i], p);
+    return nttTransform(fa, n, p, NTT_ROOT, 1);
+}
+
+// out[0 .. na + nb - 1) = a b mod m, or out[0 .. cyclic) = a b mod
+// (m, x^cyclic - 1) when cyclic, a power of two, is not 0; m < 2^32
+static inline int nttMultiplyMod(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out, uint64_t m,
+                                 size_t cyclic)
+{
+    const uint64_t i12 = modInverse(NTT_P1 % NTT_P2, NTT_P2), i123 = modInverse(NTT_P1 * NTT_P2 % NTT_P3, NTT_P3);
+    const uint64_t p12m = NTT_P1 * NTT_P2 % m;
+    size_t n = 1, len = cyclic ? cyclic : na + nb - 1, i;
+    uint64_t *f;
+    if (na == 0 || nb == 0)
+    {
+        memset(out, 0, (cyclic ? cyclic : 0) * sizeof *out);
+        return 0;
+    }
+    while (n < len)
+        n <<= 1;
+    if (n > (size_t)1 << NTT_MAX_LOG || (cyclic && (n != cyclic || na > n || nb > n)))
+        return -1;
+    f = (uint64_t *)malloc(4 * n * sizeof *f);
+    if (f == NULL)
+        return -1;
+    // f: the product mod P1, mod P2, mod P3 and scratch, n values each
+    if (nttConvolve(a, na, b, nb, n, NTT_P2, f + n, f + 3 * n) != 0 ||
+        nttConvolve(a, na, b, nb, n, NTT_P3, f + 2 * n, f + 3 * n) != 0 ||
+        nttConvolve(a, na, b, nb, n, NTT_P1, f, f + 3 * n) != 0)
+    {
+        free(f);
+        return -1;
+    }
+    for (i = 0; i < len; i++)
+    {
+        uint64_t x1 = f[i], x2 = f[n + i], x3 = f[2 * n + i];
+        uint64_t t2 = modMul((x2 + NTT_P2 - x1 % NTT_P2) % NTT_P2, i12, NTT_P2);
+        uint64_t t3 = (x3 + 2 * NTT_P3 - x1 % NTT_P3 - t2 * NTT_P1 % NTT_P3) % NTT_P3;
+        t3 = modMul(t3, i123, NTT_P3);
+        // x1 + t2 P1 + t3 P1 P2, reduced mod m as it goes
+        out[i] = (x1 % m + (t2 * NTT_P1) % m + modMul(t3 % m, p12m, m)) % m;
+    }
+    free(f);
+    return 0;
+}
+
+#endif
@@ -4,23 +4,31 @@
 4 5 6
 7 8 9 10
 .
+The numbers go into one OutBuffer, right-aligned by patternNumber()
+(Pattern.h) instead of printf("%3d ").
 */
 #include <stdio.h>
+#include "Pattern.h"
 int main()
 {
-    int i, j, rows ,num=1;
+    int i, j, rows;
+    long long num=1;
+    OutBuffer out;
 
     printf("Enter number of rows: ");
-    scanf("%d",&rows);
+    if (scanf("%d",&rows) != 1 || outInit(&out, stdout, 0) != 0)
+        return 1;
 
     for(i=1; i<=rows; i++)
     {
         for(j=1; j<=i; j++)
         {
-            printf("%3d ",num);
+            patternNumber(&out, num, 3);
+            outChar(&out, ' ');
             num++;
         }
-        printf("\n");
+        outChar(&out, '\n');
     }
+    outClose(&out);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,152 @@
+// Numbers as English words, written into the caller's buffer, for
+// Number_to_Character.c and anything that prints amounts in words.
+//
+//   - numberDigitWords() says each digit: 1024 is "one zero two four".
+//     The digits come from u64ToDec() (IntText.h), two at a time out of
+//     its 100-entry table and already in order, so there is nothing to
+//     reverse (reversing a number arithmetically loses its trailing
+//     zeros). Every digit word sits in an 8-byte slot with its space, so
+//     each is one fixed-size copy, and the write moves on by its length.
+//   - numberToWords() says the number: 1024 is "one thousand
+//     twenty-four". The words for 0 .. 99 are one packed string with an
+//     offset table, so a group of three digits is at most three copies:
+//     the hundreds word, " hundred" and the word for the last two digits,
+//     each 16 bytes whatever its length, which then moves the write on.
+//     Groups of 0 are left out, and then comes the scale, up to
+//     quintillion for 64 bits. It is American style: no "and", and
+//     hyphens from twenty-one to ninety-nine.
+//
+// Negative numbers start with "minus". Each call writes a 0 after the
+// words and returns how many characters it wrote before it. The buffer
+// must have NUMBER_DIGITS_MAX or NUMBER_WORDS_MAX bytes, which covers the
+// bytes the fixed-size copies may write past the 0. Header-only.
+
+#ifndef NUMBER_WORDS_H
+#define NUMBER_WORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "IntText.h"
+
+#define NUMBER_DIGITS_MAX 136 // "minus ", 20 digit words of up to 6 bytes, and slack
+#define NUMBER_WORDS_MAX 256  // the longest is 236 bytes, with the sign
+
+static const char numberWordText[] =
+    "zeroonetwothreefourfivesixseveneightnineteneleventwelvethirteen"
+    "fourteenfifteensixteenseventeeneighteennineteentwentytwenty-one"
+    "twenty-twotwenty-threetwenty-fourtwenty-fivetwenty-sixtwenty-seven"
+    "twenty-eighttwenty-ninethirtythirty-onethirty-twothirty-three"
+    "thirty-fourthirty-fivethirty-sixthirty-seventhirty-eightthirty-nine"
+    "fortyforty-oneforty-twoforty-threeforty-fourforty-fiveforty-six"
+    "forty-sevenforty-eightforty-ninefiftyfifty-onefifty-twofifty-three"
+    "fifty-fourfifty-fivefifty-sixfifty-sevenfifty-eightfifty-ninesixty"
+    "sixty-onesixty-twosixty-threesixty-foursixty-fivesixty-six"
+    "sixty-sevensixty-eightsixty-nineseventyseventy-oneseventy-two"
+    "seventy-threeseventy-fourseventy-fiveseventy-sixseventy-seven"
+    "seventy-eightseventy-nineeightyeighty-oneeighty-twoeighty-three"
+    "eighty-foureighty-fiveeighty-sixeighty-seveneighty-eighteighty-nine"
+    "ninetyninety-oneninety-twoninety-threeninety-fourninety-five"
+    "ninety-sixninety-sevenninety-eightninety-nine"
+    "                "; // so that every word can be copied 16 bytes at once
+
+// word i is numberWordText[numberWordAt[i] .. numberWordAt[i + 1])
+static const uint16_t numberWordAt[101] = {
+    0, 4, 7, 10, 15, 19, 23, 26, 31, 36, 40, 43, 49, 55, 63, 71, 78, 85, 94, 102, 110, 116, 126,
+    136, 148, 159, 170, 180, 192, 204, 215, 221, 231, 241, 253, 264, 275, 285, 297, 309, 320, 325,
+    334, 343, 354, 364, 374, 383, 394, 405, 415, 420, 429, 438, 449, 459, 469, 478, 489, 500, 510,
+    515, 524, 533, 544, 554, 564, 573, 584, 595, 605, 612, 623, 634, 647, 659, 671, 682, 695, 708,
+    720, 726, 736, 746, 758, 769, 780, 790, 802, 814, 825, 831, 841, 851, 863, 874, 885, 895, 907,
+    919, 930,
+};
+
+// the words of the scales, each with the space before it
+static const char numberScaleText[] = " thousand million billion trillion quadrillion quintillion    ";
+// scale g, for group g of three digits, runs from numberScaleAt[g - 1]
+static const uint8_t numberScaleAt[7] = {0, 9, 17, 25, 34, 46, 58};
+
+static const char numberDigitSlot[10][8] = {
+    "zero ", "one ", "two ", "three ", "four ", "five ", "six ", "seven ", "eight ", "nine ",
+};
+static const uint8_t numberDigitLen[10] = {5, 4, 4, 6, 5, 5, 4, 6, 6, 5};
+
+static inline size_t numberDigitWords(uint64_t x, char *out)
+{
+    char dec[INT_TEXT_MAX];
+    size_t len = u64ToDec(x, dec), i;
+    char *p = out;
+    for (i = 0; i < len; i++)
+    {
+        int d = dec[i] - '0';
+        memcpy(p, numberDigitSlot[d], 8);
+        p += numberDigitLen[d];
+    }
+    // the space after the last word
+    *--p = '\0';
+    return (size_t)(p - out);
+}
+
+static inline size_t numberDigitWordsSigned(int64_t x, char *out)
+{
+    if (x >= 0)
+        return numberDigitWords((uint64_t)x, out);
+    memcpy(out, "minus ", 6);
+    return 6 + numberDigitWords(0 - (uint64_t)x, out + 6);
+}
+
+// word i of the table at p; returns the end. It is copied 16 bytes at a
+// time (none is longer), a fixed-size copy rather than a call to memcpy.
+static inline char *numberWord(char *p, unsigned i)
+{
+    memcpy(p, numberWordText + numberWordAt[i], 16);
+    return p + (numberWordAt[i + 1] - numberWordAt[i]);
+}
+
+static inline size_t numberToWords(uint64_t x, char *out)
+{
+    unsigned group[7];
+    int groups = 0, g;
+    char *p = out;
+    if (x == 0)
+    {
+        memcpy(out, "zero", 5);
+        return 4;
+    }
+    for (; x > 0; x /= 1000)
+        group[groups++] = (unsigned)(x % 1000);
+    for (g = groups - 1; g >= 0; g--)
+    {
+        unsigned v = group[g];
+        if (v == 0)
+            continue;
+        if (p != out)
+            *p++ = ' ';
+        if (v >= 100)
+        {
+            p = numberWord(p, v / 100);
+            memcpy(p, " hundred", 8);
+            p += 8;
+            if ((v %= 100) != 0)
+                *p++ = ' ';
+        }
+        if (v != 0)
+            p = numberWord(p, v);
+        if (g > 0)
+        {
+            memcpy(p, numberScaleText + numberScaleAt[g - 1], 16);
+            p += numberScaleAt[g] - numberScaleAt[g - 1];
+        }
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+static inline size_t numberToWordsSigned(int64_t x, char *out)
+{
+    if (x >= 0)
+        return numberToWords((uint64_t)x, out);
+    memcpy(out, "minus ", 6);
+    return 6 + numberToWords(0 - (uint64_t)x, out + 6);
+}
+
+#endif
@@ -1,64 +1,139 @@
-#include<stdio.h>    
-#include<stdlib.h>  
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "NumberWords.h"
+#include "FastInput.h"
+#include "OutBuffer.h"
 
 //This program convert numbers into their corresponding characters
+//
+//The digits are written out by numberDigitWords() (NumberWords.h), in
+//order, into a buffer that is printed once: the number used to be
+//reversed arithmetically first, which lost its trailing zeros (100 came
+//out as "one"), and 0 and negative numbers printed nothing.
+//
+//    Number_to_Character --digits   every number on stdin, one per line
+//    Number_to_Character --words    the same in words: 1024 is "one
+//                                   thousand twenty-four"
+//    Number_to_Character --bench N  timings for N numbers
+//
+//The bulk modes read with FastInput.h and write through OutBuffer.h.
 
 void convertNumbertoChar(long int n);
+int convertAll(int words);
+int bench(size_t n);
 
-int main(){  
-    long int n; 
-    printf("Please Enter the Number = ");    
+int main(int argc, char *argv[]){
+    long int n;
+    if(argc > 1 && strcmp(argv[1], "--digits") == 0)
+        return convertAll(0);
+    if(argc > 1 && strcmp(argv[1], "--words") == 0)
+        return convertAll(1);
+    if(argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtod(argv[2], NULL));
+    printf("Please Enter the Number = ");
     scanf("%ld",&n);
     convertNumbertoChar(n); /* It's important to break your code in bloks,
     So let's make a function that solve our problem*/
 }
 
-void convertNumbertoChar(long int n){   
+void convertNumbertoChar(long int n){
+    char text[NUMBER_DIGITS_MAX];
+    size_t len = numberDigitWordsSigned(n, text);
+    fwrite(text, 1, len, stdout);
+    printf(" \n");
+}
+
+//Every number of stdin, a line each, until the input ends
+int convertAll(int words){
+    char text[NUMBER_WORDS_MAX];
+    long long x;
+    FastInput in;
+    OutBuffer out;
+    if(fastInputOpen(&in, stdin) != 0 || outInit(&out, stdout, 0) != 0){
+        printf("Out of memory\n");
+        return 1;
+    }
+    while(fastReadLongLong(&in, &x) == 0){
+        size_t len = words ? numberToWordsSigned(x, text) : numberDigitWordsSigned(x, text);
+        text[len] = '\n';
+        outText(&out, text, len + 1);
+    }
+    fastInputClose(&in);
+    return outClose(&out) == 0 ? 0 : 1;
+}
+
+double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//The old way into a buffer, for the benchmark: reversed, then a word
+//per digit out of a switch
+size_t oldDigitWords(long int n, char *out){
     long int r,sum = 0;
-    while(n > 0){               // This loop change the position of number so we can print in the righ order
-        r = (n % 10);           // Decompose the number
-        sum = (sum * 10) + r;   // To compose the number     
-        n = n / 10;             // n decrement
-    }    
-    n = sum;                   
-    while(n > 0){               // Now we can print the characters
-        r = n % 10;             // Selecting one number to print
-        switch(r){              // Print the corresponding character for each case    
-        case 1:    
-        printf("one ");    
-        break;    
-        case 2:    
-        printf("two ");    
-        break;    
-        case 3:    
-        printf("three ");    
-        break;    
-        case 4:    
-        printf("four ");    
-        break;    
-        case 5:    
-        printf("five ");    
-        break;    
-        case 6:    
-        printf("six ");    
-        break;    
-        case 7:    
-        printf("seven ");    
-        break;    
-        case 8:    
-        printf("eight ");    
-        break;    
-        case 9:    
-        printf("nine ");    
-        break;    
-        case 0:    
-        printf("zero ");    
-        break;    
-        default:    
-        printf("undefined");    
-        break;    
-        }  
-        n = n / 10;             //Decrementing n, ensuring the condition to the loop break
+    char *p = out;
+    while(n > 0){
+        r = (n % 10);
+        sum = (sum * 10) + r;
+        n = n / 10;
+    }
+    n = sum;
+    while(n > 0){
+        const char *w;
+        switch(n % 10){
+        case 1: w = "one "; break;
+        case 2: w = "two "; break;
+        case 3: w = "three "; break;
+        case 4: w = "four "; break;
+        case 5: w = "five "; break;
+        case 6: w = "six "; break;
+        case 7: w = "seven "; break;
+        case 8: w = "eight "; break;
+        case 9: w = "nine "; break;
+        default: w = "zero "; break;
         }
-        printf("\n");       
-}  
\ No newline at end of file
+        strcpy(p, w);
+        p += strlen(w);
+        n = n / 10;
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+int bench(size_t n){
+    long int *x = malloc((n ? n : 1) * sizeof *x);
+    unsigned long long s = 88172645463325252ULL;
+    char text[NUMBER_WORDS_MAX];
+    size_t i, total = 0;
+    double t0, t1, t2, t3;
+
+    if(x == NULL){
+        printf("Out of memory\n");
+        return 1;
+    }
+    //invoice-sized amounts, 1 to 10 digits, none ending in 0 so that the
+    //old way gets them right
+    for(i = 0; i < n; i++){
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        x[i] = (long int)((s >> 30) % 10000000000ULL / 10 * 10 + 1 + s % 9);
+    }
+    t0 = now();
+    for(i = 0; i < n; i++)
+        total += oldDigitWords(x[i], text);
+    t1 = now();
+    for(i = 0; i < n; i++)
+        total += numberDigitWordsSigned(x[i], text);
+    t2 = now();
+    for(i = 0; i < n; i++)
+        total += numberToWordsSigned(x[i], text);
+    t3 = now();
+    printf("digits: old %.1f ns, numberDigitWords() %.1f ns; numberToWords() %.1f ns per number (%zu bytes)\n",
+           (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n, (t3 - t2) * 1e9 / n, total);
+    free(x);
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Buffered bulk output, for programs that print a lot of small pieces:
+// the sorts with --fast-output, Display() in LinkedLists.c,
+// DisplayLinuxEnvirmentVariables.c, Pattern Combos and the traversals.
+//
+// printf() parses its format and takes the FILE lock for every element.
+// An OutBuffer collects text in OUT_BUFFER_BYTES of memory; integers go
+// in through IntText.h, two digits at a time, and a full buffer goes out
+// with one write() on the file descriptor. A piece of text too big to be
+// worth copying goes out together with what is buffered by one writev().
+//
+// With async set, a writer thread does the writing: a full buffer is
+// handed to it and the program carries on filling a second one, so
+// formatting and a slow pipe or disk overlap. Build with -pthread then.
+//
+// outInit() flushes the FILE first, so anything printed before comes
+// out first, but nothing should go to the FILE itself while the
+// OutBuffer is open. outClose() writes what is left and returns 0, or
+// -1 if any write failed. Header-only.
+
+#ifndef OUT_BUFFER_H
+#define OUT_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "IntText.h"
+
+#define OUT_BUFFER_BYTES (1 << 17)
+
+typedef struct
+{
+    char *buf;
+    size_t len;
+    int fd, error;
+    // for the writer thread: pending is the buffer it has to write, spare
+    // the one it has finished with
+    int async, stop;
+    char *pending, *spare;
+    size_t pendingLen;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} OutBuffer;
+
+// 0, or -1 if a write failed; retries after a signal and on short writes
+static inline int outWriteAll(int fd, const char *p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static inline void *outWriter(void *arg)
+{
+    OutBuffer *o = (OutBuffer *)arg;
+    pthread_mutex_lock(&o->lock);
+    for (;;)
+    {
+        while (o->pending == NULL && !o->stop)
+            pthread_cond_wait(&o->cond, &o->lock);
+        if (o->pending == NULL)
+            break;
+        {
+            char *p = o->pending;
+            size_t n = o->pendingLen;
+            int failed;
+            pthread_mutex_unlock(&o->lock);
+            failed = outWriteAll(o->fd, p, n);
+            pthread_mutex_lock(&o->lock);
+            o->error |= failed;
+            o->spare = p;
+            o->pending = NULL;
+            pthread_cond_broadcast(&o->cond);
+        }
+    }
+    pthread_mutex_unlock(&o->lock);
+    return NULL;
+}
+
+// 0, or -1 when out of memory
+static inline int outInit(OutBuffer *o, FILE *f, int async)
+{
+    memset(o, 0, sizeof *o);
+    fflush(f);
+    o->fd = fileno(f);
+    o->buf = (char *)malloc(OUT_BUFFER_BYTES);
+    if (o->buf == NULL)
+        return -1;
+    if (async)
+    {
+        o->spare = (char *)malloc(OUT_BUFFER_BYTES);
+        pthread_mutex_init(&o->lock, NULL);
+        pthread_cond_init(&o->cond, NULL);
+        if (o->spare != NULL && pthread_create(&o->thread, NULL, outWriter, o) == 0)
+            o->async = 1;
+        else
+        {
+            // without the thread it still works, writing in place
+            free(o->spare);
+            o->spare = NULL;
+            pthread_mutex_destroy(&o->lock);
+            pthread_cond_destroy(&o->cond);
+        }
+    }
+    return 0;
+}
+
+// Writes out or hands over what is buffered
+static inline void outFlush(OutBuffer *o)
+{
+    if (o->len == 0)
+        return;
+    if (!o->async)
+    {
+        o->error |= outWriteAll(o->fd, o->buf, o->len);
+        o->len = 0;
+        return;
+    }
+    pthread_mutex_lock(&o->lock);
+    while (o->pending != NULL)
+        pthread_cond_wait(&o->cond, &o->lock);
+    o->pending = o->buf;
+    o->pendingLen = o->len;
+    o->buf = o->spare;
+    o->spare = NULL;
+    pthread_cond_broadcast(&o->cond);
+    pthread_mutex_unlock(&o->lock);
+    o->len = 0;
+}
+
+static inline int outClose(OutBuffer *o)
+{
+    outFlush(o);
+    if (o->async)
+    {
+        pthread_mutex_lock(&o->lock);
+        o->stop = 1;
+        pthread_cond_broadcast(&o->cond);
+        pthread_mutex_unlock(&o->lock);
+        pthread_join(o->thread, NULL);
+        pthread_mutex_destroy(&o->lock);
+        pthread_cond_destroy(&o->cond);
+        free(o->spare);
+    }
+    free(o->buf);
+    o->buf = o->spare = NULL;
+    return o->error ? -1 : 0;
+}
+
+static inline void outText(OutBuffer *o, const char *s, size_t n)
+{
+    if (o->len + n <= OUT_BUFFER_BYTES)
+    {
+        memcpy(o->buf + o->len, s, n);
+        o->len += n;
+        return;
+    }
+    // big enough that copying it costs more than a second iovec
+    if (!o->async && n >= OUT_BUFFER_BYTES / 2)
+    {
+        struct iovec v[2];
+        ssize_t w;
+        v[0].iov_base = o->buf;
+        v[0].iov_len = o->len;
+        v[1].iov_base = (void *)s;
+        v[1].iov_len = n;
+        do
+            w = writev(o->fd, v, 2);
+        while (w < 0 && errno == EINTR);
+        if (w < 0)
+            w = 0;
+        // what a short write left
+        if ((size_t)w < o->len)
+        {
+            o->error |= outWriteAll(o->fd, o->buf + w, o->len - (size_t)w);
+            w = (ssize_t)o->len;
+        }
+        o->error |= outWriteAll(o->fd, s + ((size_t)w - o->len), n - ((size_t)w - o->len));
+        o->len = 0;
+        return;
+    }
+    while (n > 0)
+    {
+        size_t k = OUT_BUFFER_BYTES - o->len < n ? OUT_BUFFER_BYTES - o->len : n;
+        memcpy(o->buf + o->len, s, k);
+        o->len += k;
+        s += k;
+        n -= k;
+        if (o->len == OUT_BUFFER_BYTES)
+            outFlush(o);
+    }
+}
+
+static inline void outStr(OutBuffer *o, const char *s)
+{
+    outText(o, s, strlen(s));
+}
+
+static inline void outChar(OutBuffer *o, char c)
+{
+    if (o->len == OUT_BUFFER_BYTES)
+        outFlush(o);
+    o->buf[o->len++] = c;
+}
+
+// c, count times
+static inline void outRepeat(OutBuffer *o, char c, size_t count)
+{
+    while (count > 0)
+    {
+        size_t k;
+        if (o->len == OUT_BUFFER_BYTES)
+            outFlush(o);
+        k = OUT_BUFFER_BYTES - o->len < count ? OUT_BUFFER_BYTES - o->len : count;
+        memset(o->buf + o->len, c, k);
+        o->len += k;
+        count -= k;
+    }
+}
+
+static inline void outInt(OutBuffer *o, long long x)
+{
+    if (o->len + INT_TEXT_MAX > OUT_BUFFER_BYTES)
+        outFlush(o);
+    o->len += i64ToDec(x, o->buf + o->len);
+}
+
+// a[0 .. n), each followed by sep
+static inline void outInts(OutBuffer *o, const int *a, size_t n, const char *sep)
+{
+    size_t i, k = strlen(sep);
+    for (i = 0; i < n; i++)
+    {
+        if (o->len + INT_TEXT_MAX + k > OUT_BUFFER_BYTES)
+            outFlush(o);
+        o->len += i64ToDec(a[i], o->buf + o->len);
+        memcpy(o->buf + o->len, sep, k);
+        o->len += k;
+    }
+}
+
+static inline void outLongLongs(OutBuffer *o, const long long *a, size_t n, const char *sep)
+{
+    size_t i, k = strlen(sep);
+    for (i = 0; i < n; i++)
+    {
+        if (o->len + INT_TEXT_MAX + k > OUT_BUFFER_BYTES)
+            outFlush(o);
+        o->len += i64ToDec(a[i], o->buf + o->len);
+        memcpy(o->buf + o->len, sep, k);
+        o->len += k;
+    }
+}
+
+#endif
@@ -1,12 +1,217 @@
 #include<stdio.h>
 #include<string.h>
+#include<limits.h>
+
+#include "StringKernels.h"
+
 long long int max=1e6 +5;
-int main()
+
+//Bulk mode: prints every line of the file that is a palindrome, checked
+//with skIsPalindrome from StringKernels.h
+int palindromeLines(const char *path)
+{
+	size_t size,start,i,found=0,lines=0;
+	char *text=skReadFile(path,&size);
+
+	if(text==NULL)
+	{
+		printf("Cannot read %s\n",path);
+		return 1;
+	}
+
+	for(start=0,i=0;i<=size;i++)
+	{
+		if(i==size || text[i]=='\n')
+		{
+			if(i>start)
+			{
+				lines++;
+				if(skIsPalindrome(text+start,i-start))
+				{
+					found++;
+					printf("%.*s\n",(int)(i-start),text+start);
+				}
+			}
+			start=i+1;
+		}
+	}
+	printf("%zu of %zu lines are palindromes\n",found,lines);
+
+	free(text);
+	return 0;
+}
+
+//Manacher's algorithm: for every center the radius of the longest
+//palindrome around it, in O(n) over the whole text. A palindrome of
+//radius k at a center holds k-1 smaller ones around the same center,
+//so the radii also count every palindromic substring. Inside a
+//palindrome the radius at a position is at least that at its mirror
+//(as far as the palindrome reaches), which is where the comparison
+//starts, so each text byte is compared O(1) times in all.
+//Odd centers (a byte) and even ones (between two bytes) take one pass
+//each over the same array of n ints: 4n bytes beyond the text.
+//
+//With dna set a palindrome is a site that equals its reverse complement
+//(GAATTC reversed and complemented is GAATTC), as restriction enzymes
+//see it: there are only even ones, and any byte other than ACGT never
+//matches. The mirror argument holds the same way.
+typedef struct
+{
+	size_t start,len;	//the longest palindrome (the leftmost one)
+	long long count;	//palindromic substrings, counted by position
+	long long sites;	//maximal ones of at least minSite bytes
+} PalindromeStats;
+
+static char complementOf(char c)
+{
+	switch(c)
+	{
+		case 'A': return 'T';
+		case 'T': return 'A';
+		case 'C': return 'G';
+		case 'G': return 'C';
+		case 'a': return 't';
+		case 't': return 'a';
+		case 'c': return 'g';
+		case 'g': return 'c';
+	}
+	return 0;
+}
+
+//1 if a, on the left of a center, mirrors b on its right
+static int mirrors(char a,char b,int dna)
 {
+	return dna ? complementOf(b)==a && a!=0 : a==b;
+}
+
+static void noteSite(PalindromeStats *st,const char *s,size_t start,size_t len,size_t minSite)
+{
+	if(len>st->len || (len==st->len && start<st->start))
+	{
+		st->start=start;
+		st->len=len;
+	}
+	if(minSite>0 && len>=minSite)
+	{
+		st->sites++;
+		printf("%zu %zu %.*s%s\n",start,len,len<60 ? (int)len : 60,s+start,len<60 ? "" : "...");
+	}
+}
+
+//Radii of every center of s[0..n); sites of at least minSite bytes
+//(0 = none) are printed as "start length text", odd centers first.
+//Returns 0, or -1 if out of memory or n does not fit the radii.
+int manacher(const char *s,size_t n,int dna,size_t minSite,PalindromeStats *st)
+{
+	long i,l,r,k,len=(long)n;
+	int *rad;
+
+	memset(st,0,sizeof(*st));
+	if(n>=INT_MAX || (rad=malloc((n>0 ? n : 1)*sizeof(int)))==NULL)
+		return -1;
+
+	//Odd palindromes s[i-k+1..i+k-1]: rad[i]=k
+	if(!dna)
+		for(i=0,l=0,r=-1;i<len;i++)
+		{
+			k=i>r ? 1 : (rad[l+r-i]<r-i+1 ? rad[l+r-i] : r-i+1);
+			while(i-k>=0 && i+k<len && s[i-k]==s[i+k])
+				k++;
+			rad[i]=(int)k;
+			st->count+=k;
+			noteSite(st,s,i-k+1,2*k-1,minSite);
+			if(i+k-1>r)
+			{
+				l=i-k+1;
+				r=i+k-1;
+			}
+		}
+
+	//Even palindromes s[i-k..i+k-1]: rad[i]=k
+	for(i=0,l=0,r=-1;i<len;i++)
+	{
+		k=i>r ? 0 : (rad[l+r-i+1]<r-i+1 ? rad[l+r-i+1] : r-i+1);
+		while(i+k<len && i-k-1>=0 && mirrors(s[i-k-1],s[i+k],dna))
+			k++;
+		rad[i]=(int)k;
+		st->count+=k;
+		if(k>0)
+			noteSite(st,s,i-k,2*k,minSite);
+		if(i+k-1>r)
+		{
+			l=i-k;
+			r=i+k-1;
+		}
+	}
+
+	free(rad);
+	return 0;
+}
+
+//"-m FILE [-dna] [-sites L]": the longest palindrome of a sequence file,
+//with line breaks and FASTA header lines (">...") left out
+int palindromeScan(const char *path,int dna,size_t minSite)
+{
+	size_t size,i,j,lineStart=1;
+	char *text=skReadFile(path,&size);
+	PalindromeStats st;
+
+	if(text==NULL)
+	{
+		printf("Cannot read %s\n",path);
+		return 1;
+	}
+	//Squeeze the sequence together in place
+	for(i=0,j=0;i<size;i++)
+	{
+		if(lineStart && text[i]=='>')
+		{
+			while(i<size && text[i]!='\n')
+				i++;
+			continue;
+		}
+		lineStart=text[i]=='\n';
+		if(text[i]!='\n' && text[i]!='\r')
+			text[j++]=text[i];
+	}
+	text[j]='\0';
+
+	if(manacher(text,j,dna,minSite,&st)!=0)
+	{
+		printf("Sequence too large\n");
+		free(text);
+		return 1;
+	}
+	printf("%zu bytes, %lld palindromic substrings%s\n",j,st.count,dna ? " (reverse-complement)" : "");
+	if(minSite>0)
+		printf("%lld maximal palindromes of at least %zu bytes\n",st.sites,minSite);
+	printf("Longest: %zu bytes at %zu: %.*s%s\n",st.len,st.start,st.len<200 ? (int)st.len : 200,text+st.start,st.len<200 ? "" : "...");
+	free(text);
+	return 0;
+}
+
+int main(int argc,char *argv[])
+{
+	if(argc>=3 && strcmp(argv[1],"-m")==0)
+	{
+		int dna=0,a;
+		size_t minSite=0;
+		for(a=3;a<argc;a++)
+		{
+			if(strcmp(argv[a],"-dna")==0)
+				dna=1;
+			else if(strcmp(argv[a],"-sites")==0 && a+1<argc)
+				minSite=strtoul(argv[++a],NULL,10);
+		}
+		return palindromeScan(argv[2],dna,minSite);
+	}
+	if(argc==2)
+		return palindromeLines(argv[1]);
+
 	//Defining a string to take input of the number
 	char number[max];
 
-	long long int len,i,count=0;
+	long long int len;
 
 	//Taking the inputin form of a string
 	printf("Enter a Number: ");
@@ -15,13 +220,9 @@ int main()
 	//Finding the number of digits by calculating the lenght of the string
 	len=strlen(number);
 
-	//Checking if the number is a palindrome or not
-	for(i=0;i<len/2;i++)
-	{
-		if(number[i]==number[len-i-1])
-				count++;
-	}
-	if(count==len/2)
+	//Checking if the number is a palindrome or not: blocks from both ends
+	//are compared at once, and the first mismatch ends the check
+	if(skIsPalindrome(number,len))
 		printf("The entered number %s is a palindrome\n",number);
 	else
 		printf("The entered number %s is not a palindrome\n",number);
@@ -1,13 +1,24 @@
 #include <stdio.h>
-int main()
+#include <stdlib.h>
+#include <string.h>
+#include "Digits.h"
+
+// PalindromeNumber                               asks for a number
+// PalindromeNumber --range LO HI [--threads N]   every palindrome in [LO, HI]
+int main(int argc, char **argv)
 {
 
 
-	/* A no. is said to be palindrome if the number when reversed equals to the same no.  eg: 121*
+	/* A no. is said to be palindrome if the number when reversed equals to the same no.  eg: 121 */
   
     int n, reversedInteger = 0, remainder, originalInteger;
+
+    if (argc >= 4 && strcmp(argv[1], "--range") == 0)
+        return digitReport(DIGIT_PALINDROME, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10),
+                           argc > 5 && strcmp(argv[4], "--threads") == 0 ? atoi(argv[5]) : 1, "palindromes") != 0;
     printf("Enter an integer: ");
-    scanf("%d", &n);
+    if (scanf("%d", &n) != 1)
+        return 1;
     originalInteger = n;
 
     // reversed integer is stored in variable
@@ -27,4 +38,4 @@ int main()
         printf("%d is not a palindrome.", originalInteger);
     
     return 0;
-}
\ No newline at end of file
+}
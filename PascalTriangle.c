@@ -1,31 +1,350 @@
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<time.h>
+#include "BigNum.h"
+#include "Primality.h"
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+// Pascal's triangle a whole row at a time, into buffers:
+//   - exactly, as BigNums (BigNum.h): C(n, k) = C(n, k - 1) (n - k + 1) / k,
+//     the division exact, for half the row and the other half mirrored.
+//     coeff*(i-k+1)/k in a long long overflowed past row 60 or so;
+//   - mod a prime p > n: C(n, k) = n! / (k! (n - k)!) from tables of i!
+//     and 1/i! mod p, one power for the lot, O(n) for the row;
+//   - mod any m below 2^31, every row from the one before by
+//     row[k] += row[k - 1] from the right, in place. Going from the right,
+//     a block of lanes reads only entries not yet updated, so it runs 8
+//     lanes at a time with AVX2 (4 with SSE4.1), the mod a compare-free
+//     min(s, s - m) on unsigned lanes.
+// Output is formatted into a buffer and written in large pieces.
+//
+//     PascalTriangle                 reads r, prints r rows exactly
+//     PascalTriangle --row N [M]     row N, exactly or mod M
+//     PascalTriangle --rows R M      rows 0 .. R-1 mod M
+//     PascalTriangle --bench N M     row N mod the prime M both ways
+
+#define OUT_BUFFER (1 << 16)
+
+static char out[OUT_BUFFER];
+static size_t outLen;
+
+void flushOut()
+{
+    fwrite(out, 1, outLen, stdout);
+    outLen = 0;
+}
+
+void putText(const char *s)
+{
+    size_t n = strlen(s);
+    if (outLen + n > OUT_BUFFER)
+        flushOut();
+    memcpy(out + outLen, s, n);
+    outLen += n;
+}
+
+// n blanks
+void putBlanks(size_t n)
+{
+    while (n > 0)
+    {
+        size_t k;
+        if (outLen == OUT_BUFFER)
+            flushOut();
+        k = OUT_BUFFER - outLen < n ? OUT_BUFFER - outLen : n;
+        memset(out + outLen, ' ', k);
+        outLen += k;
+        n -= k;
+    }
+}
+
+// x right-aligned in width characters
+void putU32(uint32_t x, int width)
+{
+    char digits[10];
+    int n = 0;
+    if (outLen + 16 > OUT_BUFFER)
+        flushOut();
+    do
+    {
+        digits[n++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x != 0);
+    for (; width > n; width--)
+        out[outLen++] = ' ';
+    while (n > 0)
+        out[outLen++] = digits[--n];
+}
+
+// Every limb of b, the top one as it is and the rest padded to 9 digits
+void putBig(const BigNum *b, int width)
+{
+    size_t i, digits = bigDigits(b);
+    for (; (size_t)width > digits; width--)
+        putText(" ");
+    if (b->len == 0)
+    {
+        putU32(0, 0);
+        return;
+    }
+    putU32(b->limb[b->len - 1], 0);
+    for (i = b->len - 1; i > 0; i--)
+    {
+        uint32_t x = b->limb[i - 1];
+        int k;
+        if (outLen + 16 > OUT_BUFFER)
+            flushOut();
+        for (k = BIG_DIGITS - 1; k >= 0; k--, x /= 10)
+            out[outLen + k] = (char)('0' + x % 10);
+        outLen += BIG_DIGITS;
+    }
+}
+
+// row[0 .. n] = C(n, k), each an initialized BigNum; 0, or -1 when out of
+// memory
+int rowExact(uint32_t n, BigNum *row)
+{
+    uint32_t k;
+    if (bigSetU64(&row[0], 1) != 0)
+        return -1;
+    for (k = 1; k <= n / 2; k++)
+    {
+        if (bigCopy(&row[k], &row[k - 1]) != 0 || bigMulSmall(&row[k], n - k + 1) != 0)
+            return -1;
+        bigDivSmall(&row[k], k);
+    }
+    for (; k <= n; k++)
+        if (bigCopy(&row[k], &row[n - k]) != 0)
+            return -1;
+    return 0;
+}
+
+// row[0 .. n] = C(n, k) mod the prime p > n, p < 2^32; 0, or -1 when out
+// of memory
+int rowModPrime(uint32_t n, uint32_t p, uint32_t *row)
+{
+    uint32_t *fact = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    uint32_t *invFact = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    uint32_t k;
+    if (fact == NULL || invFact == NULL)
+    {
+        free(fact);
+        free(invFact);
+        return -1;
+    }
+    fact[0] = 1;
+    for (k = 1; k <= n; k++)
+        fact[k] = (uint32_t)((uint64_t)fact[k - 1] * k % p);
+    // one power for the top, then 1/(k-1)! = k / k! on the way down
+    invFact[n] = (uint32_t)modInverse(fact[n], p);
+    for (k = n; k > 0; k--)
+        invFact[k - 1] = (uint32_t)((uint64_t)invFact[k] * k % p);
+    for (k = 0; k <= n; k++)
+        row[k] = (uint32_t)((uint64_t)fact[n] * invFact[k] % p * invFact[n - k] % p);
+    free(fact);
+    free(invFact);
+    return 0;
+}
+
+// The row after row[0 .. n], mod m < 2^31, into row[0 .. n + 1]
+void rowStep(uint32_t *row, uint32_t n, uint32_t m)
 {
-    long long int r,k,j,i,coeff;
+    size_t k = (size_t)n + 1;
+    row[k] = row[k - 1];
+    // row[k] + row[k - 1] for k = n down to 1, a block of lanes at a time
+#if defined(__AVX2__)
+    {
+        __m256i vm = _mm256_set1_epi32((int)m);
+        for (; k >= 9; k -= 8)
+        {
+            __m256i s = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(row + k - 8)),
+                                         _mm256_loadu_si256((const __m256i *)(row + k - 9)));
+            _mm256_storeu_si256((__m256i *)(row + k - 8), _mm256_min_epu32(s, _mm256_sub_epi32(s, vm)));
+        }
+    }
+#elif defined(__SSE4_1__)
+    {
+        __m128i vm = _mm_set1_epi32((int)m);
+        for (; k >= 5; k -= 4)
+        {
+            __m128i s = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(row + k - 4)),
+                                      _mm_loadu_si128((const __m128i *)(row + k - 5)));
+            _mm_storeu_si128((__m128i *)(row + k - 4), _mm_min_epu32(s, _mm_sub_epi32(s, vm)));
+        }
+    }
+#endif
+    for (k--; k >= 1; k--)
+    {
+        uint32_t s = row[k] + row[k - 1];
+        row[k] = s >= m ? s - m : s;
+    }
+}
+
+// row[0 .. n] = C(n, k) mod m < 2^31 by n steps from row 0, O(n^2)
+void rowModAny(uint32_t n, uint32_t m, uint32_t *row)
+{
+    uint32_t i;
+    row[0] = 1 % m;
+    for (i = 0; i < n; i++)
+        rowStep(row, i, m);
+}
+
+// row n mod m, by the tables when m is a prime above n
+int printRowMod(uint32_t n, uint32_t m)
+{
+    uint32_t *row = malloc(((size_t)n + 2) * sizeof(uint32_t)), k;
+    if (row == NULL || (m > n && isPrime64(m) ? rowModPrime(n, m, row) : (rowModAny(n, m, row), 0)) != 0)
+    {
+        printf("Out of memory\n");
+        free(row);
+        return 1;
+    }
+    for (k = 0; k <= n; k++)
+    {
+        putU32(row[k], 0);
+        putText(k < n ? " " : "\n");
+    }
+    flushOut();
+    free(row);
+    return 0;
+}
+
+int printRowExact(uint32_t n)
+{
+    BigNum *row = malloc(((size_t)n + 1) * sizeof(BigNum));
+    uint32_t k;
+    int rc = 0;
+    if (row == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (k = 0; k <= n; k++)
+        bigInit(&row[k]);
+    if (rowExact(n, row) != 0)
+    {
+        printf("Out of memory\n");
+        rc = 1;
+    }
+    for (k = 0; k <= n && rc == 0; k++)
+    {
+        putBig(&row[k], 0);
+        putText(k < n ? " " : "\n");
+    }
+    flushOut();
+    for (k = 0; k <= n; k++)
+        bigFree(&row[k]);
+    free(row);
+    return rc;
+}
+
+// rows 0 .. r-1 mod m, each from the one before
+int printRowsMod(uint32_t r, uint32_t m)
+{
+    uint32_t *row = malloc(((size_t)r + 1) * sizeof(uint32_t)), i, k;
+    if (row == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    row[0] = 1 % m;
+    for (i = 0; i < r; i++)
+    {
+        if (i > 0)
+            rowStep(row, i - 1, m);
+        for (k = 0; k <= i; k++)
+        {
+            putU32(row[k], 0);
+            putText(k < i ? " " : "\n");
+        }
+    }
+    flushOut();
+    free(row);
+    return 0;
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(uint32_t n, uint32_t p)
+{
+    uint32_t *a = malloc(((size_t)n + 2) * sizeof(uint32_t)), *b = malloc(((size_t)n + 2) * sizeof(uint32_t));
+    double t0, t1, t2;
+    if (a == NULL || b == NULL || p <= n || !isPrime64(p))
+    {
+        printf("Needs memory and a prime modulus above n, below 2^31\n");
+        return 1;
+    }
+    t0 = now();
+    rowModPrime(n, p, a);
+    t1 = now();
+    rowModAny(n, p, b);
+    t2 = now();
+    printf("row %u mod %u: tables %.3f ms, %u row steps %.3f ms (%.3f ns per entry)%s\n", n, p, (t1 - t0) * 1e3, n,
+           (t2 - t1) * 1e3, (t2 - t1) * 1e9 / ((double)n * (n + 1) / 2),
+           memcmp(a, b, ((size_t)n + 1) * sizeof(uint32_t)) == 0 ? "" : " MISMATCH");
+    free(a);
+    free(b);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long long int r,k,i;
+    BigNum *row;
+    if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+        return bench((uint32_t)strtoul(argv[2], NULL, 10), (uint32_t)strtoul(argv[3], NULL, 10));
+    if (argc > 2 && (strcmp(argv[1], "--row") == 0 || (argc > 3 && strcmp(argv[1], "--rows") == 0)))
+    {
+        unsigned long n = strtoul(argv[2], NULL, 10), m = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+        if (n >= UINT32_MAX || (argc > 3 && (m == 0 || m >= 1UL << 31)))
+        {
+            printf("The row must be below 2^32 - 1 and the modulus between 1 and 2^31 - 1\n");
+            return 1;
+        }
+        if (strcmp(argv[1], "--rows") == 0)
+            return printRowsMod((uint32_t)n, (uint32_t)m);
+        return argc > 3 ? printRowMod((uint32_t)n, (uint32_t)m) : printRowExact((uint32_t)n);
+    }
  // input nuber of rows
-    scanf("%lld",&r);
+    if (scanf("%lld",&r) != 1 || r < 0 || r >= UINT32_MAX)
+        return 1;
+    row = malloc(((size_t)r + 1) * sizeof(BigNum));
+    if (row == NULL)
+        return 1;
+    for (k = 0; k <= r; k++)
+        bigInit(&row[k]);
 
-    
     for(i=0;i<r;i++)
     {
-      printf("\n");
+      putText("\n");
 
- // for maintaing the space in initial par
-        for(j=0;j<r-1-i;j++)
+ // for maintaing the space in initial par, in one piece
+        putBlanks(2 * (size_t)(r - 1 - i));
+
+// algorithm
+        if (rowExact((uint32_t)i, row) != 0)
         {
-            printf("  ");
+            flushOut();
+            printf("Out of memory\n");
+            return 1;
         }
-
-// algorithm 
         for(k=0;k<=i;k++){
-            if(i==0 || k==0)
-                coeff=1;
-            else
-                coeff=coeff*(i-k+1)/k;
-            printf("%4lld",coeff);
+            putBig(&row[k], 4);
         }
-        printf("\n");
+        putText("\n");
 
     }
+    flushOut();
+    for (k = 0; k <= r; k++)
+        bigFree(&row[k]);
+    free(row);
     return 0;
 }
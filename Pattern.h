@@ -0,0 +1,129 @@
+// Row templates, for the pattern and table printers: Pattern Combos,
+// Pattern1.c, Star_Pattern.c, NumberPattern.c, pattern.c,
+// alphabetTriangle.cpp, SimpleMultiplicationTable.c and PascalTriangle.c.
+//
+// The rows of a triangle or a pyramid are all cut from one line: some
+// blanks, then the longest run of stars, "* " units, digits or letters
+// any row has. A row with s blanks and b characters of the run is the
+// slice that starts s blanks before the run and is s + b long, so the
+// whole row goes into the OutBuffer with one memcpy instead of a printf()
+// per character, and the OutBuffer goes out in writes of OUT_BUFFER_BYTES.
+//
+//     PatternTemplate t;
+//     patternOpen(&t, n - 1, 2 * n - 1);      // n - 1 blanks, then the run
+//     patternRepeat(&t, "*");                 // of stars
+//     for (i = 1; i <= n; i++)
+//         patternRow(&out, &t, n - i, 2 * i - 1);
+//
+// patternRepeat() fills the run with copies of a unit, patternCount() with
+// the numbers from 1 up written one after another, whose prefixes are the
+// "1234..." rows, and patternCountLength() says how long the prefix up to
+// k is. patternNumber() is a number right-aligned in a field, for the
+// rows that are not slices of anything, like NumberPattern's.
+//
+// patternOpen() returns 0, or -1 when out of memory. Header-only.
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IntText.h"
+#include "OutBuffer.h"
+
+typedef struct
+{
+    char *text;
+    size_t pad, len; // pad blanks, then len characters of the run
+} PatternTemplate;
+
+static inline int patternOpen(PatternTemplate *t, size_t pad, size_t len)
+{
+    t->text = (char *)malloc(pad + len + 1);
+    if (t->text == NULL)
+        return -1;
+    memset(t->text, ' ', pad + len);
+    t->text[pad + len] = '\0';
+    t->pad = pad;
+    t->len = len;
+    return 0;
+}
+
+static inline void patternClose(PatternTemplate *t)
+{
+    free(t->text);
+    t->text = NULL;
+}
+
+// The run: unit over and over, the last copy cut short if it does not fit
+static inline void patternRepeat(PatternTemplate *t, const char *unit)
+{
+    size_t k = strlen(unit), i;
+    char *run = t->text + t->pad;
+    if (k == 0 || t->len == 0)
+        return;
+    memcpy(run, unit, k < t->len ? k : t->len);
+    // doubling copies: the run so far is the source of the next piece
+    for (i = k; i < t->len; i *= 2)
+        memcpy(run + i, run, i < t->len - i ? i : t->len - i);
+}
+
+// The characters "1 2 3 ... k" take without the separators
+static inline size_t patternCountLength(uint64_t k)
+{
+    size_t n = 0;
+    uint64_t p = 1;
+    int d;
+    for (d = 1; p <= k; d++, p *= 10)
+        n += (size_t)d * ((k < p * 10 - 1 ? k : p * 10 - 1) - p + 1);
+    return n;
+}
+
+// The run: 1, 2, 3, ... written one after another, the last one cut short
+static inline void patternCount(PatternTemplate *t)
+{
+    char digits[INT_TEXT_MAX];
+    char *run = t->text + t->pad;
+    size_t at = 0;
+    uint64_t x;
+    for (x = 1; at < t->len; x++)
+    {
+        size_t k = u64ToDec(x, digits);
+        memcpy(run + at, digits, k < t->len - at ? k : t->len - at);
+        at += k;
+    }
+}
+
+// len characters of the run, after blanks of them, and no newline
+static inline void patternSlice(OutBuffer *o, const PatternTemplate *t, size_t blanks, size_t len)
+{
+    outText(o, t->text + t->pad - blanks, blanks + len);
+}
+
+// A row: patternSlice() and a newline
+static inline void patternRow(OutBuffer *o, const PatternTemplate *t, size_t blanks, size_t len)
+{
+    size_t n = blanks + len;
+    if (o->len + n + 1 <= OUT_BUFFER_BYTES)
+    {
+        memcpy(o->buf + o->len, t->text + t->pad - blanks, n);
+        o->buf[o->len + n] = '\n';
+        o->len += n + 1;
+        return;
+    }
+    outText(o, t->text + t->pad - blanks, n);
+    outChar(o, '\n');
+}
+
+// x right-aligned in width characters, as printf("%*lld") does
+static inline void patternNumber(OutBuffer *o, long long x, int width)
+{
+    char digits[INT_TEXT_MAX];
+    size_t k = i64ToDec(x, digits);
+    if ((size_t)width > k)
+        outRepeat(o, ' ', (size_t)width - k);
+    outText(o, digits, k);
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <stdio.h>
-int main()
+#include <stdlib.h>
+#include "Pattern.h"
+int main(int argc, char *argv[])
 {
 
 	/** Program to print the following pattern:
@@ -10,14 +12,21 @@ int main()
 				****	
 				*****
 	**/
-	int i,j,k;//Declaration of variable
-	for(i=1;i<=5;i++)
+	// Run with a number N for patterns of N rows instead of 5. Each row
+	// is a slice of one template line (Pattern.h), and everything goes out
+	// through one OutBuffer.
+	int i,n = argc > 1 ? atoi(argv[1]) : 5;//Declaration of variable
+	PatternTemplate stars, digits;
+	OutBuffer out;
+	if (n < 1 || patternOpen(&stars, 0, n) != 0 ||
+	    patternOpen(&digits, n - 1, patternCountLength(2 * n - 1)) != 0 ||
+	    outInit(&out, stdout, 0) != 0)
+		return 1;
+	patternRepeat(&stars, "*");
+	patternCount(&digits);
+	for(i=1;i<=n;i++)
 	{
-		for(j=1;j<=i;j++)
-		{
-			printf("*");
-		}
-		printf("\n");
+		patternRow(&out, &stars, 0, i);
 	}
 	
 /** Program to print the following pattern:
@@ -33,34 +42,18 @@ int main()
     1
     
     **/
-	for (i=1;i<=5;i++)
+	for (i=1;i<=n;i++)
     	{
-		for (j=i;j<5;j++)
-		{
-		    printf(" ");
-		}
-		for (k=1;k<(i*2);k++)
-		{
-		    printf("%d",k);
-		}
-        printf("\n");
+		patternRow(&out, &digits, n - i, patternCountLength(2 * i - 1));
     }
 
-    for (i=4;i>=1;i--)
+    for (i=n-1;i>=1;i--)
     {
-		for (j=5;j>i;j--)
-		{
-		    printf(" ");
-		}
-		    for (k=1;k<(i*2);k++)
-		{
-		    printf("%d",k);
-		}
-        printf("\n");
+		patternRow(&out, &digits, n - i, patternCountLength(2 * i - 1));
     }
 	
-	
-	
+	outClose(&out);
+	patternClose(&stars);
+	patternClose(&digits);
 	return 0;
 }
-
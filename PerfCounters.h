@@ -0,0 +1,183 @@
+// Hardware performance counters around a measured region, for
+// SortBenchmark.c and the --bench modes of the kernel programs: cycles,
+// instructions, L1 data and last-level cache misses, branch misses and
+// data TLB misses, read through Linux's perf_event_open().
+//
+//   PerfCounters pc;
+//   perfOpen(&pc);            // once; -1 when no counter can be had
+//   perfStart(&pc);           // zero and start them
+//   ... the region ...
+//   perfStop(&pc);            // stop them and add the counts to pc.value
+//
+// Every counter is an event of its own, not a group, so an event the
+// machine lacks (a virtual machine often has no cache events, or none at
+// all) is left out and the rest still count; perfHas() says which were
+// opened. There are fewer counter registers than events on most cores,
+// so the kernel may take turns: a count is then scaled by the time the
+// event was enabled over the time it ran, an estimate, as perf stat does.
+// Only this thread is counted, in user space (kernel counting needs
+// perf_event_paranoid below 2), so the workers of a TaskPool are not.
+//
+// The values accumulate over perfStart()/perfStop() pairs until
+// perfReset(); divide by the runs and the elements for per-element rates,
+// and instructions by cycles for the IPC. perfOpen() returns 0 when at
+// least one event was opened, -1 when none was (then perfStart() and
+// perfStop() do nothing), which is always the case outside Linux.
+// Header-only.
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_EVENTS
+};
+
+typedef struct
+{
+    int fd[PERF_EVENTS]; // -1 for an event that could not be opened
+    uint64_t value[PERF_EVENTS];
+    int opened; // how many events were
+} PerfCounters;
+
+// The column each event is reported under
+static inline const char *perfName(int event)
+{
+    static const char *const names[PERF_EVENTS] = {"cycles",      "instructions",  "l1d_misses",
+                                                   "llc_misses",  "branch_misses", "dtlb_misses"};
+    return event >= 0 && event < PERF_EVENTS ? names[event] : "";
+}
+
+static inline int perfHas(const PerfCounters *pc, int event)
+{
+    return pc->fd[event] >= 0;
+}
+
+static inline void perfReset(PerfCounters *pc)
+{
+    memset(pc->value, 0, sizeof pc->value);
+}
+
+#if defined(__linux__)
+
+static inline int perfOpenEvent(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static inline uint64_t perfCacheMiss(uint64_t cache)
+{
+    return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+}
+
+static inline int perfOpen(PerfCounters *pc)
+{
+    int e;
+    pc->fd[PERF_CYCLES] = perfOpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    pc->fd[PERF_INSTRUCTIONS] = perfOpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    pc->fd[PERF_L1D_MISSES] = perfOpenEvent(PERF_TYPE_HW_CACHE, perfCacheMiss(PERF_COUNT_HW_CACHE_L1D));
+    pc->fd[PERF_LLC_MISSES] = perfOpenEvent(PERF_TYPE_HW_CACHE, perfCacheMiss(PERF_COUNT_HW_CACHE_LL));
+    pc->fd[PERF_BRANCH_MISSES] = perfOpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    pc->fd[PERF_DTLB_MISSES] = perfOpenEvent(PERF_TYPE_HW_CACHE, perfCacheMiss(PERF_COUNT_HW_CACHE_DTLB));
+    pc->opened = 0;
+    for (e = 0; e < PERF_EVENTS; e++)
+        pc->opened += pc->fd[e] >= 0;
+    perfReset(pc);
+    return pc->opened > 0 ? 0 : -1;
+}
+
+static inline void perfStart(PerfCounters *pc)
+{
+    int e;
+    for (e = 0; e < PERF_EVENTS; e++)
+        if (pc->fd[e] >= 0)
+            ioctl(pc->fd[e], PERF_EVENT_IOC_RESET, 0);
+    for (e = 0; e < PERF_EVENTS; e++)
+        if (pc->fd[e] >= 0)
+            ioctl(pc->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static inline void perfStop(PerfCounters *pc)
+{
+    int e;
+    for (e = 0; e < PERF_EVENTS; e++)
+        if (pc->fd[e] >= 0)
+            ioctl(pc->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    for (e = 0; e < PERF_EVENTS; e++)
+    {
+        uint64_t v[3]; // the count, the time enabled, the time running
+        if (pc->fd[e] < 0 || read(pc->fd[e], v, sizeof v) != (ssize_t)sizeof v || v[2] == 0)
+            continue;
+        if (v[2] < v[1]) // multiplexed: scale up to the whole time
+            v[0] = (uint64_t)((double)v[0] * v[1] / v[2]);
+        pc->value[e] += v[0];
+    }
+}
+
+static inline void perfClose(PerfCounters *pc)
+{
+    int e;
+    for (e = 0; e < PERF_EVENTS; e++)
+    {
+        if (pc->fd[e] >= 0)
+            close(pc->fd[e]);
+        pc->fd[e] = -1;
+    }
+    pc->opened = 0;
+}
+
+#else
+
+static inline int perfOpen(PerfCounters *pc)
+{
+    int e;
+    for (e = 0; e < PERF_EVENTS; e++)
+        pc->fd[e] = -1;
+    pc->opened = 0;
+    perfReset(pc);
+    return -1;
+}
+
+static inline void perfStart(PerfCounters *pc)
+{
+    (void)pc;
+}
+
+static inline void perfStop(PerfCounters *pc)
+{
+    (void)pc;
+}
+
+static inline void perfClose(PerfCounters *pc)
+{
+    (void)pc;
+}
+
+#endif
+
+#endif
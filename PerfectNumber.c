@@ -1,19 +1,183 @@
 #include<stdio.h>
-#include<conio.h>
-int main ()
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<time.h>
+#include "Factor.h"
+//n is perfect when its divisors below n add up to n, that is when
+//sigma(n), the sum of all its divisors, is 2n; it is abundant when
+//sigma(n) > 2n and deficient when sigma(n) < 2n. factorSigma() gets sigma
+//from the prime factorization (Factor.h), so this works for any 64-bit n
+//instead of trying every i < n.
+//
+//For every n up to N at once, run with --range N: sigmaSieve() fills in
+//sigma one segment of SIGMA_SEGMENT numbers at a time. sigma is
+//multiplicative, so for each prime p <= sqrt(N) and each k, the numbers
+//with exactly p^k in them get their sigma multiplied by 1 + p + ... + p^k
+//and their found part by p^k; every number gets one such update per prime
+//power, N log log N in all. What the small primes leave, n / found, is 1
+//or a single prime q > sqrt(N), which adds a factor q + 1. Add --list to
+//print every number's class, not just the counts and the perfect numbers.
+
+#define SIGMA_SEGMENT 32768
+
+typedef void (*SigmaFn)(uint64_t lo, const uint64_t *sigma, size_t count, void *arg);
+
+//the primes up to max, in *count entries; NULL when out of memory
+uint32_t *smallPrimes(uint64_t max, size_t *count)
 {
-	int n,i,sum=0;
-	printf("enter n\n");
-	scanf("%d",&n);
-	for (i=1;i<n;i++)
+	unsigned char *composite = calloc(max + 1, 1);
+	uint32_t *primes = malloc((max / 2 + 2) * sizeof(uint32_t));
+	uint64_t i, j;
+	size_t n = 0;
+	if (composite == NULL || primes == NULL)
+	{
+		free(composite);
+		free(primes);
+		return NULL;
+	}
+	for (i = 2; i <= max; i++)
+	{
+		if (composite[i])
+			continue;
+		primes[n++] = (uint32_t)i;
+		for (j = i * i; j <= max; j += i)
+			composite[j] = 1;
+	}
+	free(composite);
+	*count = n;
+	return primes;
+}
+
+//Calls fn(lo, sigma, count, arg) with sigma(lo) .. sigma(lo + count - 1)
+//for consecutive segments covering 1 .. n. Returns 0, or -1 when out of
+//memory. n up to 1e12 or so; sigma(n) < 8n must fit in 64 bits.
+int sigmaSieve(uint64_t n, SigmaFn fn, void *arg)
+{
+	uint64_t *sigma = malloc(SIGMA_SEGMENT * sizeof(uint64_t));
+	uint64_t *found = malloc(SIGMA_SEGMENT * sizeof(uint64_t));
+	uint64_t root = 1, lo, i;
+	uint32_t *primes;
+	size_t nprimes = 0, k;
+	while ((root + 1) * (root + 1) <= n)
+		root++;
+	primes = smallPrimes(root, &nprimes);
+	if (sigma == NULL || found == NULL || primes == NULL)
+	{
+		free(sigma);
+		free(found);
+		free(primes);
+		return -1;
+	}
+	for (lo = 1; lo <= n; lo += SIGMA_SEGMENT)
 	{
-		if (n%i==0)
-		sum=sum+i;
+		uint64_t hi = n - lo + 1 < SIGMA_SEGMENT ? n + 1 : lo + SIGMA_SEGMENT;
+		for (i = 0; i < hi - lo; i++)
+		{
+			sigma[i] = 1;
+			found[i] = 1;
+		}
+		for (k = 0; k < nprimes && (uint64_t)primes[k] * primes[k] < hi; k++)
+		{
+			uint64_t p = primes[k], pk = p, term = 1 + p;
+			for (;;)
+			{
+				//the multiples j * p^k in the segment; those with p | j
+				//have a higher power of p and are left to the next k
+				uint64_t j = (lo + pk - 1) / pk, m = j * pk, left = j % p == 0 ? 0 : p - j % p;
+				for (; m < hi; m += pk)
+				{
+					if (left == 0)
+					{
+						left = p - 1;
+						continue;
+					}
+					left--;
+					sigma[m - lo] *= term;
+					found[m - lo] *= pk;
+				}
+				if (pk > (hi - 1) / p)
+					break;
+				pk *= p;
+				term += pk;
+			}
+		}
+		for (i = 0; i < hi - lo; i++)
+			if (found[i] != lo + i)
+				sigma[i] *= (lo + i) / found[i] + 1;
+		fn(lo, sigma, (size_t)(hi - lo), arg);
 	}
-	if (n==sum)
+	free(sigma);
+	free(found);
+	free(primes);
+	return 0;
+}
+
+typedef struct
+{
+	uint64_t perfect, abundant, deficient;
+	int list;
+} Classes;
+
+void classify(uint64_t lo, const uint64_t *sigma, size_t count, void *arg)
+{
+	Classes *c = arg;
+	size_t i;
+	for (i = 0; i < count; i++)
+	{
+		uint64_t n = lo + i;
+		if (sigma[i] == 2 * n)
+		{
+			c->perfect++;
+			printf("%llu perfect\n", (unsigned long long)n);
+		}
+		else if (sigma[i] > 2 * n)
+		{
+			c->abundant++;
+			if (c->list)
+				printf("%llu abundant\n", (unsigned long long)n);
+		}
+		else
+		{
+			c->deficient++;
+			if (c->list)
+				printf("%llu deficient\n", (unsigned long long)n);
+		}
+	}
+}
+
+int classifyRange(uint64_t n, int list)
+{
+	Classes c = {0, 0, 0, 0};
+	struct timespec t0, t1;
+	c.list = list;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (sigmaSieve(n, classify, &c) != 0)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("1 to %llu: %llu perfect, %llu abundant, %llu deficient, %.3f s\n", (unsigned long long)n,
+	       (unsigned long long)c.perfect, (unsigned long long)c.abundant, (unsigned long long)c.deficient,
+	       t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+	return 0;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned long long n;
+	uint64_t sigma;
+	Factorization f;
+	if (argc > 2 && strcmp(argv[1], "--range") == 0)
+		return classifyRange((uint64_t)strtod(argv[2], NULL), argc > 3 && strcmp(argv[3], "--list") == 0);
+	printf("enter n\n");
+	if (scanf("%llu",&n) != 1)
+		return 1;
+	factor64(n, &f);
+	if (n > 0 && factorSigma(&f, &sigma) == 0 && sigma - n == n)
 	printf("Entered no. is a perfect no. ");
 	else
 	printf("Entered no. is not a perfect no.");
-	getch();
 	return 0;
 	}
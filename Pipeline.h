@@ -0,0 +1,441 @@
+// A small pipeline of stages joined by bounded queues, for the file modes
+// of EncryptDecryptXOR.c, ExternalSort.c and MostFrequentWordInString.c.
+//
+// A program that reads everything, then works on it, then writes it all
+// out uses one resource at a time: the disk is idle while it computes
+// and the CPU while it waits for the disk. Here the work is cut into
+// batches, a stage is a function that does one step to one batch (read
+// it, parse it, sort it, write it), and every stage runs on threads of
+// its own, so the reads for batch k + 2 go on while batch k + 1 is being
+// worked on and batch k written out.
+//
+// The pipeline owns a fixed number of batches, made once by pipeInit():
+// unsigned char buffers of batchBytes each, aligned to PIPE_ALIGN (or no
+// buffer at all when batchBytes is 0, for batches that point into memory
+// of the caller's). They go round and round: the first stage takes a
+// free batch and fills it, each stage passes it on through a PipeQueue
+// to the next, and the last stage's batches go back to be filled again.
+// That bounds the memory however big the input is, and it is the
+// backpressure: when a later stage falls behind, the batches pile up in
+// front of it, none come back, and the first stage waits until one does.
+//
+// A PipeQueue is a ring of batch pointers under a mutex, with a condition
+// variable for each side; any number of threads may push and pop. The
+// batches are megabytes, so one lock per batch costs nothing that shows.
+//
+// Stages are added in order with pipeStage(p, name, fn, ctx, workers,
+// flags) and run by pipeRun(), which returns when all the batches are
+// through. fn(ctx, batch, worker) does the stage's step; worker is
+// 0 .. workers - 1. A stage with several workers handles several batches
+// at once, so they may come out of it out of order; every batch carries
+// its seq, 0, 1, 2, ... from the first stage, and a PIPE_ORDERED stage
+// (which has one worker) gets them back in that order.
+//
+// The first stage gets a free batch with its seq set and len 0, and
+// returns 1 when it has filled it, 0 when the input is done (the batch
+// is then not passed on; with several workers, each stops at its first 0,
+// and every seq before the first 0 must be filled), or -1. The other
+// stages return 0, or -1. A -1 anywhere stops the whole pipeline and
+// makes pipeRun() return -1; the stages' own state (and anything batches
+// point to through user) is the caller's to clean up.
+//
+// Every stage counts its batches and bytes (len as the batch leaves it),
+// the time spent in fn, the time waiting for a batch to come in, and the
+// time the first stage waited for a free one (the rest of the pipeline
+// holding it back); pipeReport() prints them with each stage's MB/s.
+// A stage that is busy all the time is the one that sets the pace.
+//
+//     Pipeline p;
+//     pipeInit(&p, 4, 8 << 20);
+//     pipeStage(&p, "read", readStep, &in, 1, 0);
+//     pipeStage(&p, "work", workStep, &job, 2, 0);
+//     pipeStage(&p, "write", writeStep, &out, 1, PIPE_ORDERED);
+//     if (pipeRun(&p) != 0)
+//         ...
+//     pipeReport(&p, stderr);
+//     pipeFree(&p);
+//
+// Stages run on threads of their own rather than on a TaskPool: a stage
+// spends its time blocked on a queue or a read, and a pool worker that
+// blocks holds up every task queued behind it (with a pool of one thread,
+// which runs tasks inline, it would never return). A stage that has a lot
+// of computing to do hands it to a pool from inside fn, as the XOR stage
+// does. pipeInit() and pipeStage() return 0, or -1 when out of memory or
+// past PIPE_MAX_STAGES. Header-only; build with -pthread. It compiles as
+// C++ too.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PIPE_MAX_STAGES 8
+#define PIPE_ALIGN 4096
+
+enum
+{
+    PIPE_ORDERED = 1
+};
+
+typedef struct
+{
+    unsigned char *data; // batchBytes of the pipeline's, or the caller's
+    size_t len, cap;     // bytes in use, bytes at data
+    long seq;            // 0, 1, 2, ... in the order the first stage filled them
+    void *user;          // the caller's; the pipeline never touches it
+} PipeBatch;
+
+typedef int (*PipeFn)(void *ctx, PipeBatch *b, int worker);
+
+typedef struct
+{
+    PipeBatch **ring;
+    size_t cap, head, count;
+    int closed;  // no more pushes; pops drain what is left
+    int aborted; // pushes and pops fail at once
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+} PipeQueue;
+
+typedef struct
+{
+    const char *name;
+    PipeFn fn;
+    void *ctx;
+    int workers, flags, running;
+    long seq;         // next seq, in a first stage; next one due, in an ordered one
+    PipeBatch **held; // an ordered stage's early batches, by seq % batches
+    long batches;
+    uint64_t bytes;
+    double busy, starved, blocked; // seconds, summed over workers
+    pthread_mutex_t lock;
+} PipeStage;
+
+typedef struct
+{
+    PipeStage stage[PIPE_MAX_STAGES];
+    PipeQueue queue[PIPE_MAX_STAGES]; // queue[0] free batches, queue[i] into stage i
+    int stages, failed;
+    PipeBatch *batch;
+    int batches;
+    unsigned char *memory;
+    double seconds; // of the last pipeRun()
+} Pipeline;
+
+static inline double pipeNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------- bounded queue ----------
+
+static inline int pipeQueueInit(PipeQueue *q, size_t cap)
+{
+    q->ring = (PipeBatch **)malloc((cap ? cap : 1) * sizeof *q->ring);
+    if (q->ring == NULL)
+        return -1;
+    q->cap = cap ? cap : 1;
+    q->head = q->count = 0;
+    q->closed = q->aborted = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    return 0;
+}
+
+static inline void pipeQueueFree(PipeQueue *q)
+{
+    if (q->ring == NULL)
+        return;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+    free(q->ring);
+    q->ring = NULL;
+}
+
+// Waits for room; -1 if the queue was aborted
+static inline int pipeQueuePush(PipeQueue *q, PipeBatch *b)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->cap && !q->aborted)
+        pthread_cond_wait(&q->notFull, &q->lock);
+    if (q->aborted)
+    {
+        pthread_mutex_unlock(&q->lock);
+        return -1;
+    }
+    q->ring[(q->head + q->count++) % q->cap] = b;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+// Waits for a batch; NULL once the queue is closed and empty, or aborted
+static inline PipeBatch *pipeQueuePop(PipeQueue *q)
+{
+    PipeBatch *b = NULL;
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed && !q->aborted)
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    if (q->count > 0 && !q->aborted)
+    {
+        b = q->ring[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return b;
+}
+
+static inline void pipeQueueClose(PipeQueue *q, int abort)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    if (abort)
+        q->aborted = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_cond_broadcast(&q->notFull);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// ---------- pipeline ----------
+
+static inline int pipeInit(Pipeline *p, int batches, size_t batchBytes)
+{
+    size_t stride = (batchBytes + PIPE_ALIGN - 1) / PIPE_ALIGN * PIPE_ALIGN;
+    void *memory = NULL;
+    int i;
+    memset(p, 0, sizeof *p);
+    if (batches < 1)
+        batches = 1;
+    p->batch = (PipeBatch *)calloc(batches, sizeof *p->batch);
+    if (p->batch == NULL || (stride > 0 && posix_memalign(&memory, PIPE_ALIGN, stride * batches) != 0) ||
+        pipeQueueInit(&p->queue[0], batches) != 0)
+    {
+        free(p->batch);
+        free(memory);
+        return -1;
+    }
+    p->memory = (unsigned char *)memory;
+    p->batches = batches;
+    for (i = 0; i < batches; i++)
+    {
+        p->batch[i].data = p->memory != NULL ? p->memory + stride * i : NULL;
+        p->batch[i].cap = batchBytes;
+        pipeQueuePush(&p->queue[0], &p->batch[i]);
+    }
+    return 0;
+}
+
+static inline int pipeStage(Pipeline *p, const char *name, PipeFn fn, void *ctx, int workers, int flags)
+{
+    PipeStage *s;
+    if (p->stages == PIPE_MAX_STAGES)
+        return -1;
+    s = &p->stage[p->stages];
+    memset(s, 0, sizeof *s);
+    s->name = name;
+    s->fn = fn;
+    s->ctx = ctx;
+    s->flags = flags;
+    s->workers = (flags & PIPE_ORDERED) || workers < 1 ? 1 : workers;
+    if (flags & PIPE_ORDERED)
+    {
+        s->held = (PipeBatch **)calloc(p->batches, sizeof *s->held);
+        if (s->held == NULL)
+            return -1;
+    }
+    // the queue into the stage holds every batch, so a push never waits
+    // for long: room runs out among the free batches, not here
+    if (p->stages > 0 && pipeQueueInit(&p->queue[p->stages], p->batches) != 0)
+    {
+        free(s->held);
+        return -1;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    p->stages++;
+    return 0;
+}
+
+static inline void pipeAbort(Pipeline *p)
+{
+    int i;
+    p->failed = 1;
+    for (i = 0; i < p->stages; i++)
+        pipeQueueClose(&p->queue[i], 1);
+}
+
+// The next batch for an ordered stage: early ones wait in held[]
+static inline PipeBatch *pipeNextInOrder(Pipeline *p, PipeStage *s, PipeQueue *in)
+{
+    PipeBatch *b;
+    while ((b = s->held[s->seq % p->batches]) == NULL)
+    {
+        if ((b = pipeQueuePop(in)) == NULL)
+            return NULL;
+        s->held[b->seq % p->batches] = b;
+    }
+    s->held[s->seq++ % p->batches] = NULL;
+    return b;
+}
+
+typedef struct
+{
+    Pipeline *p;
+    int stage, worker;
+} PipeWorker;
+
+static inline void *pipeWorkerMain(void *arg)
+{
+    PipeWorker *w = (PipeWorker *)arg;
+    Pipeline *p = w->p;
+    PipeStage *s = &p->stage[w->stage];
+    PipeQueue *in = &p->queue[w->stage];
+    PipeQueue *out = &p->queue[w->stage + 1 < p->stages ? w->stage + 1 : 0];
+    long batches = 0;
+    uint64_t bytes = 0;
+    double busy = 0, starved = 0, blocked = 0, t0, t1, t2;
+
+    for (;;)
+    {
+        PipeBatch *b;
+        int rc;
+        t0 = pipeNow();
+        b = s->held != NULL ? pipeNextInOrder(p, s, in) : pipeQueuePop(in);
+        t1 = pipeNow();
+        if (w->stage == 0)
+            blocked += t1 - t0;
+        else
+            starved += t1 - t0;
+        if (b == NULL)
+            break;
+        if (w->stage == 0)
+        {
+            pthread_mutex_lock(&s->lock);
+            b->seq = s->seq++;
+            pthread_mutex_unlock(&s->lock);
+            b->len = 0;
+        }
+        rc = s->fn(s->ctx, b, w->worker);
+        t2 = pipeNow();
+        busy += t2 - t1;
+        if (rc < 0)
+        {
+            pipeAbort(p);
+            break;
+        }
+        if (w->stage == 0 && rc == 0)
+        {
+            pipeQueuePush(in, b);
+            break;
+        }
+        batches++;
+        bytes += b->len;
+        if (pipeQueuePush(out, b) != 0)
+            break;
+        blocked += pipeNow() - t2;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->batches += batches;
+    s->bytes += bytes;
+    s->busy += busy;
+    s->starved += starved;
+    s->blocked += blocked;
+    // the last worker out tells the next stage there is no more
+    if (--s->running == 0 && w->stage + 1 < p->stages)
+        pipeQueueClose(&p->queue[w->stage + 1], 0);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+// Runs every stage until the first one runs out of input; -1 if a stage
+// failed (or a thread could not be started)
+static inline int pipeRun(Pipeline *p)
+{
+    PipeWorker *w;
+    pthread_t *threads;
+    int i, k, n = 0, started = 0;
+    double t0 = pipeNow();
+
+    for (i = 0; i < p->stages; i++)
+        n += p->stage[i].workers;
+    w = (PipeWorker *)malloc((n ? n : 1) * sizeof *w);
+    threads = (pthread_t *)malloc((n ? n : 1) * sizeof *threads);
+    if (w == NULL || threads == NULL)
+    {
+        free(w);
+        free(threads);
+        return -1;
+    }
+    for (i = 0, n = 0; i < p->stages; i++)
+    {
+        p->stage[i].running = p->stage[i].workers;
+        for (k = 0; k < p->stage[i].workers; k++, n++)
+        {
+            w[n].p = p;
+            w[n].stage = i;
+            w[n].worker = k;
+        }
+    }
+    for (i = 0; i < n; i++, started++)
+    {
+        if (pthread_create(&threads[i], NULL, pipeWorkerMain, &w[i]) != 0)
+        {
+            pipeAbort(p);
+            break;
+        }
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(w);
+    free(threads);
+    p->seconds = pipeNow() - t0;
+    return p->failed || started < n ? -1 : 0;
+}
+
+static inline void pipeReport(const Pipeline *p, FILE *f)
+{
+    int i;
+    fprintf(f, "%-10s %7s %8s %10s %9s %8s %8s %8s\n", "stage", "workers", "batches", "MB", "MB/s", "busy s",
+            "starved", "blocked");
+    for (i = 0; i < p->stages; i++)
+    {
+        const PipeStage *s = &p->stage[i];
+        double mb = s->bytes / 1048576.0;
+        fprintf(f, "%-10s %7d %8ld %10.1f %9.1f %8.3f %8.3f %8.3f\n", s->name, s->workers, s->batches, mb,
+                s->busy > 0 ? mb / s->busy * s->workers : 0.0, s->busy, s->starved, s->blocked);
+    }
+    if (p->memory != NULL)
+        fprintf(f, "%d batches of %.1f MB, %.3f s\n", p->batches, p->batch[0].cap / 1048576.0, p->seconds);
+    else
+        fprintf(f, "%d batches, %.3f s\n", p->batches, p->seconds);
+}
+
+static inline void pipeFree(Pipeline *p)
+{
+    int i;
+    for (i = 0; i < p->stages; i++)
+    {
+        free(p->stage[i].held);
+        pthread_mutex_destroy(&p->stage[i].lock);
+        if (i > 0)
+            pipeQueueFree(&p->queue[i]);
+    }
+    pipeQueueFree(&p->queue[0]);
+    free(p->memory);
+    free(p->batch);
+    p->stages = p->batches = 0;
+}
+
+#endif
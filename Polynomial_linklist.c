@@ -1,21 +1,51 @@
+// A polynomial as a linked list of terms, with addition and multiplication,
+// and two flat copies of it that evaluate faster:
+//   dense  - one coefficient per power, evaluated by Horner's rule, one
+//            multiply and one add per power
+//   sparse - only the nonzero terms, highest power first; Horner's rule
+//            again, with x^gap by squaring to step over missing powers
+// All arithmetic is in long and wraps like unsigned (mod 2^64); none of
+// it goes through pow() and double any more.
+//
+// Add merges two lists sorted by exponent in one pass. Multiply works on
+// dense coefficients mod the prime 998244353 and picks its method by size:
+// schoolbook for short factors, Karatsuba (n^1.58) for medium ones and the
+// number-theoretic transform (n log n) above that. Coefficients of the
+// product are exact as long as they stay within +-499122176.
+//
+// Run with --add or --mul to read a second polynomial and print the sum or
+// product; --mulbench N times the three multiplications on degree-N factors.
+// Run with --bench N [lo hi] to evaluate the polynomial at N points from
+// lo to hi with each form and check they agree. EvalBatch takes its x
+// values in blocks and runs Horner's rule across the whole block at once,
+// which the compiler turns into SIMD code at -O3 (gcc -O3 -march=native).
 #include<stdio.h>
 #include<stdlib.h>
-#include<math.h>
+#include<string.h>
+#include<time.h>
+#include "NodePool.h"
+#include "ModArith.h"
+#include "Ntt.h"
 struct Node {			//node structure for polynomial
     int coeff;
     int exp;			//exponent
     struct Node *next;		//pointing to next node
-} *poly = NULL;			//type pointer polynomial 
-void create(void)
+};
+NodePool pool = NODE_POOL_INITIALIZER(sizeof(struct Node));	//where the nodes come from
+struct Node *create(void)
 {				//creating  polyno mial
+    struct Node *poly = NULL;
     struct Node *t, *last = NULL;	//temporary pointer, last pointer
     int num, i;
     printf("Enter number of terms");
     scanf("%d", &num);
     printf("Enter each term with coeff and exp\n");
     for (i = 0; i < num; i++) {	//loop
-	t = (struct Node *) malloc(sizeof(struct Node));	//create new node
-	scanf("%d%d", &t->coeff, &t->exp);	//reading  2 data 
+	t = (struct Node *) nodePoolAlloc(&pool);	//create new node
+	if (scanf("%d%d", &t->coeff, &t->exp) != 2 || t->exp < 0) {	//reading  2 data 
+	    printf("Each term needs a coeff and an exp >= 0\n");
+	    exit(1);
+	}
 	t->next = NULL;		//linking each node into linklist
 	if (poly == NULL) {	//first node check
 	    poly = last = t;
@@ -24,6 +54,7 @@ void create(void)
 	    last = t;
 	}
     }
+    return poly;
 }
 
 void Display(struct Node *p)
@@ -35,23 +66,476 @@ void Display(struct Node *p)
     printf("\n");
 }
 
+unsigned long Power(unsigned long x, unsigned e)
+{				//x^e by squaring: log2(e) multiplies
+    unsigned long r = 1;
+    while (e) {
+	if (e & 1)
+	    r *= x;
+	x *= x;
+	e >>= 1;
+    }
+    return r;
+}
+
 long Eval(struct Node *p, int x)
 {				//evalution
-    long val = 0;
+    unsigned long val = 0;
     while (p) {			//scanning through polynomial
-	val += p->coeff * pow(x, p->exp);
+	val += (unsigned long) (long) p->coeff * Power(x, p->exp);
 	p = p->next;
     }
-    return val;
+    return (long) val;
+}
+
+struct Dense {			//coeff[i] goes with x^i
+    long *coeff;
+    int degree;
+};
+
+struct Term {			//a term of the sparse form
+    long coeff;
+    int exp;
+};
+
+struct Sparse {			//nonzero terms, highest exp first
+    struct Term *terms;
+    int count;
+};
+
+struct Dense ToDense(struct Node *p)
+{				//terms with the same exp add up
+    struct Dense d = { NULL, 0 };
+    struct Node *q;
+    for (q = p; q; q = q->next)
+	if (q->exp > d.degree)
+	    d.degree = q->exp;
+    d.coeff = calloc(d.degree + 1, sizeof(long));
+    if (d.coeff == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    for (q = p; q; q = q->next)
+	d.coeff[q->exp] = (long) ((unsigned long) d.coeff[q->exp] + (unsigned long) (long) q->coeff);
+    return d;
 }
 
-// TODO insert
-// TODO delete
+struct Sparse ToSparse(const struct Dense *d)
+{				//the nonzero coefficients, from the top
+    struct Sparse s = { NULL, 0 };
+    int i;
+    s.terms = malloc((d->degree + 1) * sizeof(struct Term));
+    if (s.terms == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    for (i = d->degree; i >= 0; i--)
+	if (d->coeff[i] != 0) {
+	    s.terms[s.count].coeff = d->coeff[i];
+	    s.terms[s.count].exp = i;
+	    s.count++;
+	}
+    return s;
+}
+
+long EvalDense(const struct Dense *d, long x)
+{				//Horner: (((c_n x + c_n-1) x + ...) x + c_0
+    unsigned long val = 0;
+    int i;
+    for (i = d->degree; i >= 0; i--)
+	val = val * x + d->coeff[i];
+    return (long) val;
+}
+
+long EvalSparse(const struct Sparse *s, long x)
+{				//Horner over the terms; a gap of g powers is one x^g
+    unsigned long val = 0;
+    int i;
+    for (i = 0; i < s->count; i++) {
+	int gap = i + 1 < s->count ? s->terms[i].exp - s->terms[i + 1].exp : s->terms[i].exp;
+	val = (val + s->terms[i].coeff) * Power(x, gap);
+    }
+    return (long) val;
+}
+
+#define BATCH 256		//x values evaluated together; their sums stay in cache
+
+void EvalBatch(const struct Dense *d, const long *x, long *out, int n)
+{				//Horner for a block of x values at once: the inner
+    unsigned long val[BATCH];	//loop has no dependency between lanes, so it vectorizes
+    int i, j, k, m;
+    for (j = 0; j < n; j += BATCH) {
+	m = n - j < BATCH ? n - j : BATCH;
+	for (k = 0; k < m; k++)
+	    val[k] = 0;
+	for (i = d->degree; i >= 0; i--) {
+	    unsigned long c = d->coeff[i];
+	    for (k = 0; k < m; k++)
+		val[k] = val[k] * x[j + k] + c;
+	}
+	memcpy(out + j, val, m * sizeof(long));
+    }
+}
 
-int main(void)
+double Now(void)
 {
-    create();
-    Display(poly);
-    printf("%ld\n", Eval(poly, 1));
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int Bench(struct Node *poly, int n, long lo, long hi)
+{				//every form at n points, timed and checked against Eval
+    struct Dense d = ToDense(poly);
+    struct Sparse s = ToSparse(&d);
+    long *x = malloc(n * sizeof(long)), *out = malloc(n * sizeof(long));
+    unsigned long sum;
+    int i, bad = 0;
+    double t;
+    if (n < 1 || x == NULL || out == NULL) {
+	printf(n < 1 ? "Need at least one point\n" : "Out of memory\n");
+	return 1;
+    }
+    for (i = 0; i < n; i++)
+	x[i] = lo + (long) ((double) (hi - lo) * i / (n > 1 ? n - 1 : 1));
+    printf("degree %d, %d nonzero terms, %d points\n", d.degree, s.count, n);
+
+    t = Now();
+    for (i = 0, sum = 0; i < n; i++)
+	sum += (unsigned long) (out[i] = Eval(poly, x[i]));
+    t = Now() - t;
+    printf("list   %8.2f M points/s\n", n / t / 1e6);
+
+    t = Now();
+    for (i = 0; i < n; i++)
+	bad += EvalDense(&d, x[i]) != out[i];
+    t = Now() - t;
+    printf("dense  %8.2f M points/s\n", n / t / 1e6);
+
+    t = Now();
+    for (i = 0; i < n; i++)
+	bad += EvalSparse(&s, x[i]) != out[i];
+    t = Now() - t;
+    printf("sparse %8.2f M points/s\n", n / t / 1e6);
+
+    t = Now();
+    EvalBatch(&d, x, out, n);
+    t = Now() - t;
+    printf("batch  %8.2f M points/s\n", n / t / 1e6);
+    for (i = 0; i < n; i++)
+	sum -= (unsigned long) out[i];
+    if (bad || sum) {
+	printf("The forms disagree\n");
+	return 1;
+    }
+    free(x);
+    free(out);
+    free(d.coeff);
+    free(s.terms);
     return 0;
 }
+
+struct Node *NewTerm(int coeff, int exp)
+{
+    struct Node *t = (struct Node *) nodePoolAlloc(&pool);
+    if (t == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    t->coeff = coeff;
+    t->exp = exp;
+    t->next = NULL;
+    return t;
+}
+
+struct Node *MergeTerms(struct Node *a, struct Node *b)
+{				//two lists sorted by falling exp into one
+    struct Node head, *tail = &head;
+    while (a && b) {
+	if (a->exp >= b->exp) {
+	    tail->next = a;
+	    a = a->next;
+	} else {
+	    tail->next = b;
+	    b = b->next;
+	}
+	tail = tail->next;
+    }
+    tail->next = a ? a : b;
+    return head.next;
+}
+
+struct Node *Normalize(struct Node *p)
+{				//sorts the terms by falling exp (merge sort, as in
+    struct Node *bins[32] = { NULL }, *c, *q;	//LinkedLists.c), adds up equal
+    int i;			//exps and drops zero terms
+    while (p) {
+	struct Node *next = p->next;
+	p->next = NULL;
+	c = p;
+	for (i = 0; bins[i]; i++) {
+	    c = MergeTerms(bins[i], c);
+	    bins[i] = NULL;
+	}
+	bins[i] = c;
+	p = next;
+    }
+    for (c = NULL, i = 0; i < 32; i++)
+	if (bins[i])
+	    c = MergeTerms(bins[i], c);
+    for (q = c; q && q->next;)
+	if (q->next->exp == q->exp) {
+	    struct Node *dup = q->next;
+	    q->coeff += dup->coeff;
+	    q->next = dup->next;
+	    nodePoolFree(&pool, dup);
+	} else
+	    q = q->next;
+    while (c && c->coeff == 0) {
+	q = c->next;
+	nodePoolFree(&pool, c);
+	c = q;
+    }
+    for (q = c; q && q->next;)
+	if (q->next->coeff == 0) {
+	    struct Node *zero = q->next;
+	    q->next = zero->next;
+	    nodePoolFree(&pool, zero);
+	} else
+	    q = q->next;
+    return c;
+}
+
+struct Node *Add(struct Node *a, struct Node *b)
+{				//a + b as a new list; both sorted by Normalize
+    struct Node head, *tail = &head;
+    while (a || b) {
+	int coeff, exp;
+	if (b == NULL || (a && a->exp > b->exp)) {
+	    coeff = a->coeff;
+	    exp = a->exp;
+	    a = a->next;
+	} else if (a == NULL || b->exp > a->exp) {
+	    coeff = b->coeff;
+	    exp = b->exp;
+	    b = b->next;
+	} else {
+	    coeff = a->coeff + b->coeff;
+	    exp = a->exp;
+	    a = a->next;
+	    b = b->next;
+	}
+	if (coeff != 0) {
+	    tail->next = NewTerm(coeff, exp);
+	    tail = tail->next;
+	}
+    }
+    tail->next = NULL;
+    return head.next;
+}
+
+#define MOD 998244353		//119 * 2^23 + 1: transforms of up to 2^23 points
+#define MOD_ROOT 3		//generates the multiplicative group mod MOD
+#define KARATSUBA_MIN 32	//shorter factors go schoolbook
+#define NTT_MIN 512		//longer ones go through the transform
+
+void MulSchool(const long *a, int na, const long *b, int nb, long *out)
+{				//out[0 .. na+nb-1) = a * b, all mod MOD
+    int i, j;
+    for (i = 0; i < na + nb - 1; i++)
+	out[i] = 0;
+    for (i = 0; i < na; i++)
+	for (j = 0; j < nb; j++)
+	    out[i + j] = (out[i + j] + a[i] * b[j]) % MOD;
+}
+
+void MulKaratsuba(const long *a, const long *b, int n, long *out)
+{				//out[0 .. 2n-1) = a * b for two factors of n coefficients:
+    int lo = n / 2, hi = n - lo, i;	//three half-size products instead of four
+    long *sa, *sb, *mid;
+    if (n < KARATSUBA_MIN) {
+	MulSchool(a, n, b, n, out);
+	return;
+    }
+    sa = malloc((4 * hi - 1) * sizeof(long));
+    if (sa == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    sb = sa + hi;
+    mid = sb + hi;
+    for (i = 0; i < hi; i++) {	//(a0 + a1)(b0 + b1), a1 and b1 the top halves
+	sa[i] = ((i < lo ? a[i] : 0) + a[lo + i]) % MOD;
+	sb[i] = ((i < lo ? b[i] : 0) + b[lo + i]) % MOD;
+    }
+    MulKaratsuba(sa, sb, hi, mid);
+    MulKaratsuba(a, b, lo, out);	//a0 b0 into the bottom of out
+    MulKaratsuba(a + lo, b + lo, hi, out + 2 * lo);	//a1 b1 into the top
+    out[2 * lo - 1] = 0;	//the gap between them
+    for (i = 0; i < 2 * lo - 1; i++)
+	mid[i] = (mid[i] + 2 * MOD - out[i]) % MOD;
+    for (i = 0; i < 2 * hi - 1; i++)
+	mid[i] = (mid[i] + MOD - out[2 * lo + i]) % MOD;
+    for (i = 0; i < 2 * hi - 1; i++)	//out += x^lo (mid - a0 b0 - a1 b1)
+	out[lo + i] = (out[lo + i] + mid[i]) % MOD;
+    free(sa);
+}
+
+void Transform(long *a, int n, int invert)
+{				//in-place NTT of n = 2^k values mod MOD (Ntt.h)
+    if (nttTransform((uint64_t *) a, n, MOD, MOD_ROOT, invert) != 0) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+}
+
+void MulNTT(const long *a, int na, const long *b, int nb, long *out)
+{				//transform both, multiply pointwise, transform back
+    int n = 1, i;
+    long *fa, *fb;
+    while (n < na + nb - 1)
+	n <<= 1;
+    if (n > 1 << 23) {
+	printf("The product is too long for one transform mod %d\n", MOD);
+	exit(1);
+    }
+    fa = calloc(2 * (size_t) n, sizeof(long));
+    if (fa == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    fb = fa + n;
+    memcpy(fa, a, na * sizeof(long));
+    memcpy(fb, b, nb * sizeof(long));
+    Transform(fa, n, 0);
+    Transform(fb, n, 0);
+    for (i = 0; i < n; i++)
+	fa[i] = fa[i] * fb[i] % MOD;
+    Transform(fa, n, 1);
+    memcpy(out, fa, (na + nb - 1) * sizeof(long));
+    free(fa);
+}
+
+void MulMod(const long *a, int na, const long *b, int nb, long *out)
+{				//out[0 .. na+nb-1) = a * b mod MOD, by what is fastest there
+    int small = na < nb ? na : nb;
+    if (small < KARATSUBA_MIN)
+	MulSchool(a, na, b, nb, out);
+    else if (na + nb > NTT_MIN)
+	MulNTT(a, na, b, nb, out);
+    else {			//Karatsuba wants equal lengths: pad the shorter
+	int n = na > nb ? na : nb, i;
+	long *pa = calloc(4 * (size_t) n, sizeof(long)), *pb = pa + n, *prod = pb + n;
+	if (pa == NULL) {
+	    printf("Out of memory\n");
+	    exit(1);
+	}
+	for (i = 0; i < na; i++)
+	    pa[i] = a[i];
+	for (i = 0; i < nb; i++)
+	    pb[i] = b[i];
+	MulKaratsuba(pa, pb, n, prod);
+	memcpy(out, prod, (na + nb - 1) * sizeof(long));
+	free(pa);
+    }
+}
+
+long *ModCoeffs(struct Node *p, int *n)
+{				//dense coefficients mod MOD, lowest power first
+    struct Dense d = ToDense(p);
+    int i;
+    for (i = 0; i <= d.degree; i++)
+	d.coeff[i] = modReduce(d.coeff[i], MOD);
+    *n = d.degree + 1;
+    return d.coeff;
+}
+
+struct Node *Multiply(struct Node *a, struct Node *b)
+{				//a * b as a new list, highest exp first
+    struct Node head, *tail = &head;
+    int na, nb, i;
+    long *ca = ModCoeffs(a, &na), *cb = ModCoeffs(b, &nb);
+    long *prod = malloc((na + nb - 1) * sizeof(long));
+    if (prod == NULL) {
+	printf("Out of memory\n");
+	exit(1);
+    }
+    MulMod(ca, na, cb, nb, prod);
+    for (i = na + nb - 2; i >= 0; i--)
+	if (prod[i] != 0) {	//back to signed: above MOD/2 counts as negative
+	    tail->next = NewTerm(prod[i] > MOD / 2 ? prod[i] - MOD : prod[i], i);
+	    tail = tail->next;
+	}
+    tail->next = NULL;
+    free(ca);
+    free(cb);
+    free(prod);
+    return head.next;
+}
+
+int MulBench(int degree)
+{				//the three multiplications on random factors, timed
+    int n = degree + 1, i, bad = 0;
+    long *a = malloc(n * sizeof(long)), *b = malloc(n * sizeof(long));
+    long *p1 = malloc(2 * n * sizeof(long)), *p2 = malloc(2 * n * sizeof(long));
+    double t;
+    if (degree < 1 || a == NULL || b == NULL || p1 == NULL || p2 == NULL) {
+	printf(degree < 1 ? "Need a degree of at least 1\n" : "Out of memory\n");
+	return 1;
+    }
+    srand(1);
+    for (i = 0; i < n; i++) {
+	a[i] = ((long) rand() << 16 ^ rand()) % MOD;
+	b[i] = ((long) rand() << 16 ^ rand()) % MOD;
+    }
+    t = Now();
+    MulNTT(a, n, b, n, p1);
+    printf("degree %d: NTT %.4f s", degree, Now() - t);
+    if (degree <= 200000) {
+	t = Now();
+	MulKaratsuba(a, b, n, p2);
+	printf(", Karatsuba %.4f s", Now() - t);
+	for (i = 0; i < 2 * n - 1; i++)
+	    bad += p1[i] != p2[i];
+    }
+    if (degree <= 20000) {
+	t = Now();
+	MulSchool(a, n, b, n, p2);
+	printf(", schoolbook %.4f s", Now() - t);
+	for (i = 0; i < 2 * n - 1; i++)
+	    bad += p1[i] != p2[i];
+    }
+    printf("\n");
+    if (bad) {
+	printf("The products disagree\n");
+	return 1;
+    }
+    free(a);
+    free(b);
+    free(p1);
+    free(p2);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct Node *poly;
+    int ret = 0;
+    if (argc > 2 && strcmp(argv[1], "--mulbench") == 0)
+	return MulBench(atoi(argv[2]));
+    poly = create();
+    Display(poly);
+    if (argc > 1 && (strcmp(argv[1], "--add") == 0 || strcmp(argv[1], "--mul") == 0)) {
+	struct Node *other = create();
+	Display(other);
+	if (argv[1][2] == 'a')
+	    Display(Add(Normalize(poly), Normalize(other)));
+	else
+	    Display(Multiply(poly, other));
+    } else if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+	ret = Bench(poly, atoi(argv[2]), argc > 3 ? atol(argv[3]) : -1000, argc > 4 ? atol(argv[4]) : 1000);
+    else
+	printf("%ld\n", Eval(poly, 1));
+    nodePoolRelease(&pool);		//frees the whole polynomial
+    return ret;
+}
@@ -0,0 +1,180 @@
+// Primality of any 64-bit number in O(log n), for Prime.c and Prime_No.c.
+//
+// isPrime64(n) tries, cheapest first:
+//   - a bit table of the odd primes below PRIME_TABLE_LIMIT;
+//   - trial division by the odd primes up to 53, which throws out about
+//     72% of the odd numbers; each check is a multiply by the inverse of
+//     the prime mod 2^64 and a compare: x is a multiple of p exactly when
+//     x * (1/p) mod 2^64 <= (2^64 - 1) / p;
+//   - the deterministic Miller-Rabin test. A strong pseudoprime to all of
+//     the bases 2, 325, 9375, 28178, 450775, 9780504 and 1795265022 would
+//     have to be above 2^64 (Jim Sinclair's set), and below 2^32 the bases
+//     2, 7 and 61 are enough. The modular squarings are Montgomery
+//     multiplications (ModArith.h), so no test divides.
+//
+// A prime takes all the bases (7 x 64 squarings at most); most composites
+// fail the first. Header-only.
+
+#ifndef PRIMALITY_H
+#define PRIMALITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ModArith.h"
+
+#define PRIME_TABLE_LIMIT 16384
+
+// bit i of word w: whether 2 * (64w + i) + 1 is prime
+static const uint64_t primeTable[PRIME_TABLE_LIMIT / 128] = {
+    0x816d129a64b4cb6eULL, 0x2196820d864a4c32ULL, 0xa48961205a0434c9ULL, 0x4a2882d129861144ULL,
+    0x0834992132424030ULL, 0x148a48844225064bULL, 0x0b40b4086c304205ULL, 0x65048928125108a0ULL,
+    0x80124496804c3098ULL, 0xc02104c941124221ULL, 0x0804490000982d32ULL, 0x220825b082689681ULL,
+    0x9004265940a28948ULL, 0x6900924430434006ULL, 0x12410da408088210ULL, 0x086122d22400c060ULL,
+    0x0110d301821b0484ULL, 0x14916022c044a002ULL, 0x092094d204a6400cULL, 0x4ca2100800522094ULL,
+    0xa48b081051018200ULL, 0x034c108144309a25ULL, 0x2084490880522502ULL, 0x241140a218003250ULL,
+    0x0a41a00101840128ULL, 0x2926000836004512ULL, 0x10100480c0618283ULL, 0xc20c26584822006dULL,
+    0x4520582024894810ULL, 0x10c0250219002488ULL, 0x802832ca01140868ULL, 0x60901300264b0400ULL,
+    0x32100100d0258082ULL, 0x430800112186430cULL, 0x0092900c10480424ULL, 0x24880906002d2043ULL,
+    0x530082090932c040ULL, 0x4000814196800880ULL, 0x2058489608481048ULL, 0x926094022080c329ULL,
+    0x05a0104422812000ULL, 0x000a042049019040ULL, 0xc02c801348348924ULL, 0x0800084524002982ULL,
+    0x04d0048452043698ULL, 0x1865328244908a00ULL, 0x28024001020a0090ULL, 0x861104309204a440ULL,
+    0xc90804522c004208ULL, 0x4424990912486084ULL, 0x1000211403002400ULL, 0x4040208805321a01ULL,
+    0x6030014084c30906ULL, 0xa2020c9011680218ULL, 0x8224148929860004ULL, 0x0880190480084102ULL,
+    0x020004a442681210ULL, 0x120100100c061061ULL, 0x6512422194032010ULL, 0x140128040a0c9418ULL,
+    0x014000d040a40a29ULL, 0x4882402d20410490ULL, 0x24080130100020c1ULL, 0x8229020024845904ULL,
+    0x4816814802586100ULL, 0xa0ca000611210010ULL, 0x4200b09104000240ULL, 0x2514480906810c04ULL,
+    0x860a00a011252092ULL, 0x084520004802c10cULL, 0x0022130406980032ULL, 0x1282441481480482ULL,
+    0xd028804340101824ULL, 0x2c00d86424812004ULL, 0x020000a241081209ULL, 0x180110c04120ca41ULL,
+    0x20941220a41804a4ULL, 0x048044320240a083ULL, 0x8a6086400c001800ULL, 0x0082010512886400ULL,
+    0x04096110c101a24aULL, 0x0840b40160008801ULL, 0x0494400880030106ULL, 0x02520c028029208aULL,
+    0x0264848000844201ULL, 0x2122404430004832ULL, 0x20d004a0c3080200ULL, 0x5228004040161840ULL,
+    0x0810180114820890ULL, 0x809320a00a408209ULL, 0x010500522000c008ULL, 0x0000820c06114010ULL,
+    0x908028009a44904bULL, 0x0028024309064a04ULL, 0x4480096500180134ULL, 0x1448618202240003ULL,
+    0x5108340028120041ULL, 0x6084892890120504ULL, 0x8249402610491012ULL, 0x8840240a01109100ULL,
+    0x2ca2500004104c10ULL, 0x125001b00a489040ULL, 0x9228a00904a40008ULL, 0x4120022110430002ULL,
+    0x00520c0408003281ULL, 0x8101021020844921ULL, 0x6984010122404810ULL, 0x00884402c80130c1ULL,
+    0x006112c02d02010cULL, 0x0812014030c000a0ULL, 0x840140948000200bULL, 0x0b00841000320040ULL,
+    0x41848a2906010024ULL, 0x80034c9408081080ULL, 0x5020204140964001ULL, 0x20a44040a2892522ULL,
+    0x104a212001288602ULL, 0x4225044008140008ULL, 0x2100920410432102ULL, 0x84030922184ca011ULL,
+    0x0124228204108941ULL, 0x0900c10884080814ULL, 0x368000028a41b042ULL, 0x0200009124a04904ULL,
+    0x0806080102924194ULL, 0x80892816d0010009ULL, 0x500c900168000060ULL, 0x4130424080400120ULL,
+};
+
+// {p, 1/p mod 2^64, (2^64 - 1) / p} for the odd primes below 256. When p
+// divides x, x * (1/p) mod 2^64 is also the quotient x / p.
+static const uint64_t primeDivisors[][3] = {
+    {3, 0xaaaaaaaaaaaaaaabULL, 0x5555555555555555ULL},
+    {5, 0xcccccccccccccccdULL, 0x3333333333333333ULL},
+    {7, 0x6db6db6db6db6db7ULL, 0x2492492492492492ULL},
+    {11, 0x2e8ba2e8ba2e8ba3ULL, 0x1745d1745d1745d1ULL},
+    {13, 0x4ec4ec4ec4ec4ec5ULL, 0x13b13b13b13b13b1ULL},
+    {17, 0xf0f0f0f0f0f0f0f1ULL, 0x0f0f0f0f0f0f0f0fULL},
+    {19, 0x86bca1af286bca1bULL, 0x0d79435e50d79435ULL},
+    {23, 0xd37a6f4de9bd37a7ULL, 0x0b21642c8590b216ULL},
+    {29, 0x34f72c234f72c235ULL, 0x08d3dcb08d3dcb08ULL},
+    {31, 0xef7bdef7bdef7bdfULL, 0x0842108421084210ULL},
+    {37, 0x14c1bacf914c1badULL, 0x06eb3e45306eb3e4ULL},
+    {41, 0x8f9c18f9c18f9c19ULL, 0x063e7063e7063e70ULL},
+    {43, 0x82fa0be82fa0be83ULL, 0x05f417d05f417d05ULL},
+    {47, 0x51b3bea3677d46cfULL, 0x0572620ae4c415c9ULL},
+    {53, 0x21cfb2b78c13521dULL, 0x04d4873ecade304dULL},
+    {59, 0xcbeea4e1a08ad8f3ULL, 0x0456c797dd49c341ULL},
+    {61, 0x4fbcda3ac10c9715ULL, 0x04325c53ef368eb0ULL},
+    {67, 0xf0b7672a07a44c6bULL, 0x03d226357e16ece5ULL},
+    {71, 0x193d4bb7e327a977ULL, 0x039b0ad12073615aULL},
+    {73, 0x7e3f1f8fc7e3f1f9ULL, 0x0381c0e070381c0eULL},
+    {79, 0x9b8b577e613716afULL, 0x033d91d2a2067b23ULL},
+    {83, 0xa3784a062b2e43dbULL, 0x03159721ed7e7534ULL},
+    {89, 0xf47e8fd1fa3f47e9ULL, 0x02e05c0b81702e05ULL},
+    {97, 0xa3a0fd5c5f02a3a1ULL, 0x02a3a0fd5c5f02a3ULL},
+    {101, 0x3a4c0a237c32b16dULL, 0x0288df0cac5b3f5dULL},
+    {103, 0xdab7ec1dd3431b57ULL, 0x027c45979c95204fULL},
+    {107, 0x77a04c8f8d28ac43ULL, 0x02647c69456217ecULL},
+    {109, 0xa6c0964fda6c0965ULL, 0x02593f69b02593f6ULL},
+    {113, 0x90fdbc090fdbc091ULL, 0x0243f6f0243f6f02ULL},
+    {127, 0x7efdfbf7efdfbf7fULL, 0x0204081020408102ULL},
+    {131, 0x03e88cb3c9484e2bULL, 0x01f44659e4a42715ULL},
+    {137, 0xe21a291c077975b9ULL, 0x01de5d6e3f8868a4ULL},
+    {139, 0x3aef6ca970586723ULL, 0x01d77b654b82c339ULL},
+    {149, 0xdf5b0f768ce2cabdULL, 0x01b7d6c3dda338b2ULL},
+    {151, 0x6fe4dfc9bf937f27ULL, 0x01b2036406c80d90ULL},
+    {157, 0x5b4fe5e92c0685b5ULL, 0x01a16d3f97a4b01aULL},
+    {163, 0x1f693a1c451ab30bULL, 0x01920fb49d0e228dULL},
+    {167, 0x8d07aa27db35a717ULL, 0x01886e5f0abb0499ULL},
+    {173, 0x882383b30d516325ULL, 0x017ad2208e0ecc35ULL},
+    {179, 0xed6866f8d962ae7bULL, 0x016e1f76b4337c6cULL},
+    {181, 0x3454dca410f8ed9dULL, 0x016a13cd15372904ULL},
+    {191, 0x1d7ca632ee936f3fULL, 0x01571ed3c506b39aULL},
+    {193, 0x70bf015390948f41ULL, 0x015390948f40feacULL},
+    {197, 0xc96bdb9d3d137e0dULL, 0x014cab88725af6e7ULL},
+    {199, 0x2697cc8aef46c0f7ULL, 0x0149539e3b2d066eULL},
+    {211, 0xc0e8f2a76e68575bULL, 0x013698df3de07479ULL},
+    {223, 0x687763dfdb43bb1fULL, 0x0125e22708092f11ULL},
+    {227, 0x1b10ea929ba144cbULL, 0x0120b470c67c0d88ULL},
+    {229, 0x1d10c4c0478bbcedULL, 0x011e2ef3b3fb8744ULL},
+    {233, 0x63fb9aeb1fdcd759ULL, 0x0119453808ca29c0ULL},
+    {239, 0x64afaa4f437b2e0fULL, 0x0112358e75d30336ULL},
+    {241, 0xf010fef010fef011ULL, 0x010fef010fef010fULL},
+    {251, 0x28cbfbeb9a020a33ULL, 0x0105197f7d734041ULL},
+};
+
+#define PRIME_DIVISORS (sizeof primeDivisors / sizeof primeDivisors[0])
+#define PRIME_TRIAL_DIVISORS 15 // isPrime64 tries 3 .. 53
+
+static inline int primeDivides(size_t k, uint64_t x)
+{
+    return x * primeDivisors[k][1] <= primeDivisors[k][2];
+}
+
+// n odd and above 1, n - 1 = d * 2^s: one round of Miller-Rabin with base
+// a; 1 when n is a strong probable prime to base a
+static inline int millerRabinRound(const Montgomery *mt, uint64_t a, uint64_t d, int s)
+{
+    uint64_t x, minusOne = mt->n - mt->one;
+    int r;
+
+    a %= mt->n;
+    if (a == 0)
+        return 1; // the base says nothing about a divisor of itself
+    // x = a^d, in Montgomery form
+    x = montPow(mt, montIn(mt, a), d);
+    if (x == mt->one || x == minusOne)
+        return 1;
+    for (r = 1; r < s; r++)
+    {
+        x = montMul(mt, x, x);
+        if (x == minusOne)
+            return 1;
+        if (x == mt->one)
+            return 0; // a square root of 1 other than +-1: composite
+    }
+    return 0;
+}
+
+static inline int isPrime64(uint64_t n)
+{
+    static const uint64_t small[] = {2, 7, 61};
+    static const uint64_t large[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    const uint64_t *bases = n < (1ULL << 32) ? small : large;
+    int nbases = n < (1ULL << 32) ? 3 : 7, s = 0, i;
+    uint64_t d;
+    Montgomery mt;
+    size_t k;
+
+    if (n < PRIME_TABLE_LIMIT)
+        return n == 2 || (n & 1 && (primeTable[n / 128] >> (n / 2 % 64) & 1));
+    if ((n & 1) == 0)
+        return 0;
+    for (k = 0; k < PRIME_TRIAL_DIVISORS; k++)
+        if (primeDivides(k, n))
+            return 0;
+    for (d = n - 1; (d & 1) == 0; d >>= 1)
+        s++;
+    mt = montInit(n);
+    for (i = 0; i < nbases; i++)
+        if (!millerRabinRound(&mt, bases[i], d, s))
+            return 0;
+    return 1;
+}
+
+#endif
@@ -1,29 +1,24 @@
 //A c program to print prime numbers from 1 to n
 
 #include<stdio.h>
-#include<math.h>
-void main(){
-    int num, i, j,check;
+#include<stdint.h>
+#include "Primality.h"
+
+//isPrime64() (Primality.h) answers for each number in O(log n), instead
+//of trying every smaller divisor
+int main(){
+    unsigned long long num, i;
     printf("Enter number: ");
-    scanf("%d",&num);
+    if(scanf("%llu",&num) != 1)
+        return 1;
     printf("Prime numbers are:\n");
     //traversing all numbers from 2 to entered integer num
     for(i=2; i<num; i++)
     {
-        //loop to check divisibility
-        for(j=2; j<i; j++)
-        {
-            //checking if it is divisible by any smaller number
-            check=sqrt(i);
-            if(check%j == 0)
-            {
-                //if it is divisible exiting from loop
-                break;
-            }
-        }
-        //printing the number if it is never divisible by numbers smaller than itself
-        if(i == j){
-            printf("%d\n", i);
+        //printing the number if nothing smaller divides it
+        if(isPrime64(i)){
+            printf("%llu\n", i);
         }
     }
+    return 0;
 }
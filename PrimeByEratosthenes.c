@@ -1,28 +1,470 @@
 #include <stdio.h>
 #include <stdlib.h>
- 
-#define limit 100 /*size of integers array*/
- 
-int main(){
-    unsigned long long int i,j;
-    int *primes;				//pointer created for prime
-    int z = 1;
- 
-    primes = malloc(sizeof(int) * limit);	//allocating 100 spaces in memory with the starting address to prime pointer
- 
-    for (i = 2;i < limit; i++)			//initializing the 100 memory spaces
-        primes[i] = 1;
- 
-    for (i = 2;i < limit; i++)			//Filling the array with prime numbers as per the method proposed by seive of eratosthenes
-        if (primes[i])
-            for (j = i;i * j < limit; j++)
-                primes[i * j] = 0;
- 
-    printf("\nPrime numbers in range 1 to 100 are: \n");
-
-    for (i = 2;i < limit; i++)			//Printing the prime numbers in the range from 1 to 100
-        if (primes[i])
-            printf("%d\n", i);
- 
-return 0;
-}
\ No newline at end of file
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "Bitset.h"
+#include "TaskPool.h"
+
+/*
+ * Sieve of Eratosthenes, segmented.
+ *
+ * Only odd numbers are kept, one bit each: bit g stands for 2g + 1. The
+ * range is sieved one segment of SEGMENT_BYTES (the size of a typical L1
+ * data cache) at a time, so the crossing off stays in cache and memory is
+ * only the segment plus the primes up to sqrt(hi) and where each stopped:
+ * about 1 MB to reach 1e12, where one int per number would take 4 TB.
+ *
+ * Each segment starts as a copy of a precomputed pattern with the
+ * multiples of 3, 5, 7, 11 and 13 already crossed off; the pattern repeats
+ * every 3*5*7*11*13 words, so copying it is a memcpy. The other primes p
+ * then cross off their odd multiples from p*p on, p bits apart, and
+ * remember where they stopped for the next segment. Counting is
+ * bitsetCountRange() of Bitset.h over the segment, a Harley-Seal popcount
+ * with AVX2; listing jumps from prime to prime with tzcnt.
+ *
+ * sievePrimesParallel() hands chunks of segments to the workers of a
+ * TaskPool; see there.
+ *
+ *     ./a.out                     the primes below 100
+ *     ./a.out count HI            how many primes are below HI
+ *     ./a.out count LO HI         ... in LO <= p < HI
+ *     ./a.out enumerate LO HI     print them
+ *
+ * Numbers may be written like 1e11. count and enumerate use every CPU;
+ * add --threads T to choose. Build with -pthread, and -march=native for
+ * the AVX2 count.
+ */
+
+#define SEGMENT_BYTES 32768
+#define SEGMENT_BITS (SEGMENT_BYTES * 8)
+#define SEGMENT_WORDS (SEGMENT_BYTES / 8)
+#define PRESIEVE_WORDS (3 * 5 * 7 * 11 * 13)
+#define PRESIEVE_LAST 13
+#define CHUNK_SEGMENTS 16 /* a chunk is at least 16 segments, 8M numbers */
+#define ROUND_CHUNKS 4    /* chunks per worker held back for ordering */
+
+typedef void (*PrimeFn)(uint64_t p, void *arg);
+
+/* floor(sqrt(n)) by Newton's method, so no libm is needed */
+static uint64_t isqrt(uint64_t n)
+{
+    uint64_t r = n, s;
+    if (n < 2)
+        return n;
+    for (s = (r + n / r) / 2; s < r; s = (r + n / r) / 2)
+        r = s;
+    return r;
+}
+
+/*
+ * More than the number of primes up to x: pi(x) < 1.26 x / ln x, and
+ * ln x > (bits - 1) ln 2 for x of that many bits, so 2x / (bits - 1)
+ * is above it; no libm is needed
+ */
+static size_t primeCountBound(uint64_t x)
+{
+    int bits = 0;
+    while (bits < 64 && x >> bits)
+        bits++;
+    return bits < 3 ? 32 : (size_t)(2 * x / (uint64_t)(bits - 1)) + 32;
+}
+
+/* The odd primes from 3 up to max, in *count entries; NULL when out of memory */
+static uint32_t *basePrimes(uint64_t max, size_t *count)
+{
+    size_t half = max / 2 + 1, i, j, n = 0;
+    Bitset composite; /* bit i for the number 2i + 1 */
+    uint32_t *primes = malloc(primeCountBound(max) * sizeof(uint32_t));
+    if (bitsetInit(&composite, half) != 0 || primes == NULL)
+    {
+        bitsetFree(&composite);
+        free(primes);
+        return NULL;
+    }
+    for (i = 1; i < half; i++)
+    {
+        uint64_t p = 2 * i + 1;
+        if (p > max)
+            break;
+        if (bitsetTest(&composite, i))
+            continue;
+        primes[n++] = (uint32_t)p;
+        for (j = (p * p) / 2; j < half; j += p)
+            bitsetSet(&composite, j);
+    }
+    bitsetFree(&composite);
+    *count = n;
+    return primes;
+}
+
+/* What every segment of one sieving run shares */
+typedef struct
+{
+    uint32_t *primes;  /* odd primes up to sqrt(hi) */
+    size_t first;      /* primes[first] is the first one not presieved */
+    size_t nprimes;
+    uint64_t *pattern; /* PRESIEVE_WORDS words */
+    uint64_t gLo, gHi; /* bits gLo .. gHi: the odd numbers in [lo, hi) */
+} Sieve;
+
+/* Returns 0, or -1 when out of memory */
+static int sieveSetup(Sieve *s, uint64_t lo, uint64_t hi)
+{
+    size_t i;
+
+    s->nprimes = 0;
+    s->gLo = lo / 2 < 1 ? 1 : lo / 2;
+    s->gHi = hi / 2;
+    s->primes = basePrimes(isqrt(hi - 1), &s->nprimes);
+    s->pattern = malloc(PRESIEVE_WORDS * sizeof(uint64_t));
+    if (s->primes == NULL || s->pattern == NULL)
+    {
+        free(s->primes);
+        free(s->pattern);
+        return -1;
+    }
+    for (i = 0; i < PRESIEVE_WORDS; i++)
+    {
+        uint64_t w = 0;
+        int b;
+        for (b = 0; b < 64; b++)
+        {
+            uint64_t v = 2 * (64 * (uint64_t)i + b) + 1;
+            if (v % 3 && v % 5 && v % 7 && v % 11 && v % 13)
+                w |= 1ULL << b;
+        }
+        s->pattern[i] = w;
+    }
+    for (s->first = 0; s->first < s->nprimes && s->primes[s->first] <= PRESIEVE_LAST; s->first++)
+        ;
+    return 0;
+}
+
+static void sieveRelease(Sieve *s)
+{
+    free(s->primes);
+    free(s->pattern);
+}
+
+/*
+ * next[i]: the first bit from g on that primes[i] crosses off. Worked out
+ * in bits, as the numbers themselves may not fit in 64 bits near 2^64:
+ * the first odd multiple q p >= 2g + 1 is bit (q p - 1) / 2 = (q / 2) p +
+ * (p - 1) / 2 for odd q
+ */
+static void sieveStart(const Sieve *s, uint64_t *next, uint64_t g)
+{
+    size_t i;
+    for (i = s->first; i < s->nprimes; i++)
+    {
+        uint64_t p = s->primes[i], n = 2 * g + 1, q = n / p + (n % p != 0), first = (p * p - 1) / 2;
+        q |= 1;
+        next[i] = q / 2 * p + (p - 1) / 2;
+        if (next[i] < first)
+            next[i] = first;
+    }
+}
+
+/* Sieves bits g .. g + SEGMENT_BITS into segment and moves next[] on */
+static void sieveSegment(const Sieve *s, uint64_t *segment, uint64_t *next, uint64_t g)
+{
+    uint64_t end = g + SEGMENT_BITS;
+    size_t w, i, off = (size_t)((g / 64) % PRESIEVE_WORDS), part;
+
+    part = PRESIEVE_WORDS - off < SEGMENT_WORDS ? PRESIEVE_WORDS - off : SEGMENT_WORDS;
+    memcpy(segment, s->pattern + off, part * sizeof(uint64_t));
+    for (w = part; w < SEGMENT_WORDS; w += part)
+    {
+        part = SEGMENT_WORDS - w < PRESIEVE_WORDS ? SEGMENT_WORDS - w : PRESIEVE_WORDS;
+        memcpy(segment + w, s->pattern, part * sizeof(uint64_t));
+    }
+    for (i = s->first; i < s->nprimes; i++)
+    {
+        uint64_t p = s->primes[i], j;
+        if ((p * p - 1) / 2 >= end) /* p * p is past the segment */
+            break;
+        j = next[i] - g;
+        /* four at a time: independent stores the CPU can overlap */
+        for (; j + 3 * p < SEGMENT_BITS; j += 4 * p)
+        {
+            segment[j / 64] &= ~(1ULL << (j % 64));
+            segment[(j + p) / 64] &= ~(1ULL << ((j + p) % 64));
+            segment[(j + 2 * p) / 64] &= ~(1ULL << ((j + 2 * p) % 64));
+            segment[(j + 3 * p) / 64] &= ~(1ULL << ((j + 3 * p) % 64));
+        }
+        for (; j < SEGMENT_BITS; j += p)
+            segment[j / 64] &= ~(1ULL << (j % 64));
+        next[i] = g + j;
+    }
+    /* the presieved primes themselves are in the first words */
+    if (g == 0)
+        segment[0] |= 1ULL << 1 | 1ULL << 2 | 1ULL << 3 | 1ULL << 5 | 1ULL << 6;
+}
+
+/* Counts the primes of a sieved segment in [lo, hi), calling fn on each */
+static uint64_t scanSegment(const Sieve *s, const uint64_t *segment, uint64_t g, PrimeFn fn, void *arg)
+{
+    uint64_t count = 0, end = g + SEGMENT_BITS, from, to;
+    size_t w;
+
+    from = s->gLo > g ? s->gLo - g : 0;
+    to = s->gHi < end ? s->gHi - g : SEGMENT_BITS;
+    if (fn == NULL)
+        return bitsetCountRange(segment, (size_t)from, (size_t)to);
+    for (w = (size_t)(from / 64); w * 64 < to; w++)
+    {
+        uint64_t bits = segment[w];
+        if (w * 64 < from)
+            bits &= ~0ULL << (from % 64);
+        if (w * 64 + 64 > to)
+            bits &= ~(~0ULL << (to % 64));
+        for (; bits; bits &= bits - 1)
+        {
+            fn(2 * (g + w * 64 + (uint64_t)bitCtz(bits)) + 1, arg);
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Counts the primes p with lo <= p < hi, and calls fn(p, arg) for each
+ * in increasing order unless fn is NULL. hi may be up to about 1e15.
+ * Returns UINT64_MAX when out of memory.
+ */
+uint64_t sievePrimes(uint64_t lo, uint64_t hi, PrimeFn fn, void *arg)
+{
+    uint64_t count = 0, g, *segment, *next;
+    Sieve s;
+
+    if (lo < 2)
+        lo = 2;
+    if (lo >= hi)
+        return 0;
+    if (sieveSetup(&s, lo, hi) != 0)
+        return UINT64_MAX;
+    segment = malloc(SEGMENT_BYTES);
+    next = malloc((s.nprimes + 1) * sizeof(uint64_t));
+    if (segment == NULL || next == NULL)
+    {
+        sieveRelease(&s);
+        free(segment);
+        free(next);
+        return UINT64_MAX;
+    }
+    if (lo == 2)
+    {
+        count++;
+        if (fn)
+            fn(2, arg);
+    }
+    g = s.gLo / SEGMENT_BITS * SEGMENT_BITS;
+    sieveStart(&s, next, g);
+    for (; g < s.gHi; g += SEGMENT_BITS)
+    {
+        sieveSegment(&s, segment, next, g);
+        count += scanSegment(&s, segment, g, fn, arg);
+    }
+    sieveRelease(&s);
+    free(segment);
+    free(next);
+    return count;
+}
+
+typedef struct
+{
+    Sieve s;
+    uint64_t base;          /* bit where segment 0 starts */
+    uint64_t nsegments, chunkSegments;
+    uint64_t **segment;     /* per worker */
+    uint64_t **next;        /* per worker */
+    uint64_t *counts;       /* per chunk, when counting */
+    uint64_t *window;       /* the sieved segments of a round, when enumerating */
+    uint64_t firstChunk;    /* of the round */
+} SieveJob;
+
+/* Sieves chunks firstChunk + begin .. firstChunk + end, each from fresh offsets */
+static void sieveChunks(size_t begin, size_t end, void *arg)
+{
+    SieveJob *job = arg;
+    int id = poolWorkerId();
+    size_t c;
+
+    for (c = begin; c < end; c++)
+    {
+        uint64_t chunk = job->firstChunk + c, k = chunk * job->chunkSegments;
+        uint64_t stop = k + job->chunkSegments, count = 0;
+        if (stop > job->nsegments)
+            stop = job->nsegments;
+        sieveStart(&job->s, job->next[id], job->base + k * SEGMENT_BITS);
+        for (; k < stop; k++)
+        {
+            uint64_t g = job->base + k * SEGMENT_BITS, *segment = job->segment[id];
+            if (job->window != NULL)
+                segment = job->window + (c * job->chunkSegments + k % job->chunkSegments) * SEGMENT_WORDS;
+            sieveSegment(&job->s, segment, job->next[id], g);
+            if (job->window == NULL)
+                count += scanSegment(&job->s, segment, g, NULL, NULL);
+        }
+        if (job->window == NULL)
+            job->counts[chunk] = count;
+    }
+}
+
+/*
+ * sievePrimes() on the workers of pool. The segments are cut into chunks
+ * and every chunk is one task, sieved by whichever worker takes it with
+ * that worker's own segment buffer and next[] offsets, so workers share
+ * only the base primes, which they read. When counting, each chunk keeps
+ * its count and they are added up at the end. When fn is given, the
+ * chunks are sieved ROUND_CHUNKS per worker at a time into a window of
+ * segments, which is then scanned in order: fn still sees the primes in
+ * increasing order, from the calling thread.
+ */
+uint64_t sievePrimesParallel(TaskPool *pool, uint64_t lo, uint64_t hi, PrimeFn fn, void *arg)
+{
+    uint64_t count = 0, nchunks, round, c, k;
+    SieveJob job;
+    int t, w = pool->nthreads, failed = 0;
+
+    if (lo < 2)
+        lo = 2;
+    if (lo >= hi)
+        return 0;
+    memset(&job, 0, sizeof job);
+    if (sieveSetup(&job.s, lo, hi) != 0)
+        return UINT64_MAX;
+    job.base = job.s.gLo / SEGMENT_BITS * SEGMENT_BITS;
+    job.nsegments = (job.s.gHi - job.base + SEGMENT_BITS - 1) / SEGMENT_BITS;
+    /*
+     * Every chunk starts by working out next[] afresh, a division per base
+     * prime, so chunks are at least CHUNK_SEGMENTS long. When counting
+     * they grow to give each worker about 16, enough to even out the load.
+     */
+    job.chunkSegments = CHUNK_SEGMENTS;
+    if (fn == NULL && job.nsegments / ((uint64_t)w * 16) > CHUNK_SEGMENTS)
+        job.chunkSegments = job.nsegments / ((uint64_t)w * 16);
+    nchunks = (job.nsegments + job.chunkSegments - 1) / job.chunkSegments;
+    round = fn == NULL ? nchunks : (uint64_t)w * ROUND_CHUNKS;
+
+    job.segment = calloc(w, sizeof(uint64_t *));
+    job.next = calloc(w, sizeof(uint64_t *));
+    if (fn == NULL)
+        job.counts = calloc(nchunks, sizeof(uint64_t));
+    else
+        job.window = malloc(round * job.chunkSegments * SEGMENT_BYTES);
+    failed = job.segment == NULL || job.next == NULL || (fn == NULL ? job.counts == NULL : job.window == NULL);
+    for (t = 0; !failed && t < w; t++)
+    {
+        job.segment[t] = malloc(SEGMENT_BYTES);
+        job.next[t] = malloc((job.s.nprimes + 1) * sizeof(uint64_t));
+        failed = job.segment[t] == NULL || job.next[t] == NULL;
+    }
+
+    if (!failed)
+    {
+        if (lo == 2)
+        {
+            count++;
+            if (fn)
+                fn(2, arg);
+        }
+        for (job.firstChunk = 0; job.firstChunk < nchunks; job.firstChunk += round)
+        {
+            uint64_t n = nchunks - job.firstChunk < round ? nchunks - job.firstChunk : round;
+            poolParallelFor(pool, 0, n, 1, sieveChunks, &job);
+            if (fn == NULL)
+                continue;
+            /* the round's segments, in order */
+            for (c = 0; c < n; c++)
+                for (k = 0; k < job.chunkSegments; k++)
+                {
+                    uint64_t s = (job.firstChunk + c) * job.chunkSegments + k;
+                    if (s >= job.nsegments)
+                        break;
+                    count += scanSegment(&job.s, job.window + (c * job.chunkSegments + k) * SEGMENT_WORDS,
+                                         job.base + s * SEGMENT_BITS, fn, arg);
+                }
+        }
+        for (c = 0; fn == NULL && c < nchunks; c++)
+            count += job.counts[c];
+    }
+
+    for (t = 0; job.segment != NULL && job.next != NULL && t < w; t++)
+    {
+        free(job.segment[t]);
+        free(job.next[t]);
+    }
+    free(job.segment);
+    free(job.next);
+    free(job.counts);
+    free(job.window);
+    sieveRelease(&job.s);
+    return failed ? UINT64_MAX : count;
+}
+
+static void printPrime(uint64_t p, void *arg)
+{
+    (void)arg;
+    printf("%llu\n", (unsigned long long)p);
+}
+
+static uint64_t parseNumber(const char *s)
+{
+    if (strpbrk(s, "eE.") != NULL)
+        return (uint64_t)strtod(s, NULL);
+    return strtoull(s, NULL, 10);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t lo = 0, hi, count;
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double start;
+    struct timespec ts;
+    TaskPool pool;
+
+    if (argc == 1)
+    {
+        printf("\nPrime numbers in range 1 to 100 are: \n");
+        sievePrimes(0, 100, printPrime, NULL);
+        return 0;
+    }
+    if (argc > 3 && strcmp(argv[argc - 2], "--threads") == 0)
+    {
+        nthreads = atoi(argv[argc - 1]);
+        argc -= 2;
+    }
+    if (argc < 3 || argc > 4 || (strcmp(argv[1], "count") != 0 && strcmp(argv[1], "enumerate") != 0))
+    {
+        printf("Usage: %s [count|enumerate] [LO] HI [--threads T]\n", argv[0]);
+        return 1;
+    }
+    hi = parseNumber(argv[argc - 1]);
+    if (argc == 4)
+        lo = parseNumber(argv[2]);
+    if (nthreads < 1)
+        nthreads = 1;
+    if (poolCreate(&pool, nthreads) != 0)
+    {
+        printf("Cannot start %d threads\n", nthreads);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    start = ts.tv_sec + ts.tv_nsec / 1e9;
+    count = sievePrimesParallel(&pool, lo, hi, strcmp(argv[1], "enumerate") == 0 ? printPrime : NULL, NULL);
+    poolDestroy(&pool);
+    if (count == UINT64_MAX)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    if (strcmp(argv[1], "enumerate") == 0)
+        return 0;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    printf("%llu primes in [%llu, %llu), %.3f s, %d threads\n", (unsigned long long)count,
+           (unsigned long long)lo, (unsigned long long)hi, ts.tv_sec + ts.tv_nsec / 1e9 - start, nthreads);
+    return 0;
+}
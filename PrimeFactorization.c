@@ -0,0 +1,94 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<time.h>
+#include "Factor.h"
+
+//Prime factorization of a 64-bit number with factor64() from Factor.h:
+//small primes by trial division, then Miller-Rabin and Pollard's rho, so
+//even the hardest case, a product of two 32-bit primes, takes about 2 ms.
+//Prints the factors, the divisors in order and their sum.
+//
+//Run with --bench N to time factoring N consecutive numbers from 1e9 and
+//N random 64-bit numbers.
+
+static uint64_t divisors[FACTOR_MAX_DIVISORS];
+
+int compareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(uint64_t n)
+{
+    uint64_t seed = 88172645463325252ULL, i, primes = 0;
+    Factorization f;
+    double t = now();
+
+    for (i = 0; i < n; i++)
+    {
+        factor64(1000000000ULL + i, &f);
+        primes += (uint64_t)f.count;
+    }
+    t = now() - t;
+    printf("from 1e9  %llu numbers, %llu distinct primes, %.0f ns each\n",
+           (unsigned long long)n, (unsigned long long)primes, t * 1e9 / n);
+    primes = 0;
+    t = now();
+    for (i = 0; i < n; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        factor64(seed, &f);
+        primes += (uint64_t)f.count;
+    }
+    t = now() - t;
+    printf("random    %llu numbers, %llu distinct primes, %.0f ns each\n",
+           (unsigned long long)n, (unsigned long long)primes, t * 1e9 / n);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long n;
+    uint64_t sigma;
+    size_t count, i;
+    Factorization f;
+    int j;
+
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoull(argv[2], NULL, 10));
+    printf("Enter a number: ");
+    if (scanf("%llu", &n) != 1 || n == 0)
+        return 1;
+    factor64(n, &f);
+    printf("%llu =", n);
+    for (j = 0; j < f.count; j++)
+    {
+        printf("%s %llu", j == 0 ? "" : " *", (unsigned long long)f.prime[j]);
+        if (f.exponent[j] > 1)
+            printf("^%d", f.exponent[j]);
+    }
+    if (f.count == 0)
+        printf(" 1");
+    count = factorDivisors(&f, divisors);
+    qsort(divisors, count, sizeof divisors[0], compareU64);
+    printf("\n%zu divisors:", count);
+    for (i = 0; i < count; i++)
+        printf(" %llu", (unsigned long long)divisors[i]);
+    if (factorSigma(&f, &sigma) != 0)
+        printf("\nsum of divisors: more than 2^64\n");
+    else
+        printf("\nsum of divisors: %llu\n", (unsigned long long)sigma);
+    return 0;
+}
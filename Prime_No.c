@@ -1,18 +1,60 @@
 #include<stdio.h>
-void main()
-{ 
-int i,n,c=0;
-printf("Enter a Number : ");
-scanf("%d",&n);
-for(i=2;i<n;i++)
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<time.h>
+#include "Primality.h"
+
+//Tells whether a number is prime with isPrime64() from Primality.h: a
+//table lookup for small numbers, trial division by the primes up to 53,
+//then the deterministic Miller-Rabin test, which is O(log n) for any
+//number below 2^64 where dividing by every i < n would take years.
+//
+//Run with --bench N to time N tests on random 64-bit numbers.
+
+double now()
 {
-  if(n%i==0)
-  {
-    printf("NOT a prime number");
-    c++;
-    break;
-  }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
-if(c==0)
-printf("%d is a prime number",n);
+
+int bench(uint64_t n)
+{
+    static const char *names[] = {"random", "random odd", "from 1e18"};
+    uint64_t seed = 88172645463325252ULL, i, primes, x;
+    int form;
+
+    for (form = 0; form < 3; form++)
+    {
+        double t = now();
+        primes = 0;
+        for (i = 0; i < n; i++)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            x = form == 0 ? seed : form == 1 ? seed | 1 : 1000000000000000000ULL + i;
+            primes += isPrime64(x);
+        }
+        t = now() - t;
+        printf("%-11s %llu tests, %llu primes, %.1f ns per test\n", names[form],
+               (unsigned long long)n, (unsigned long long)primes, t * 1e9 / n);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long n;
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoull(argv[2], NULL, 10));
+    printf("Enter a Number : ");
+    if (scanf("%llu", &n) != 1)
+        return 1;
+    if (isPrime64(n))
+        printf("%llu is a prime number", n);
+    else
+        printf("NOT a prime number");
+    return 0;
 }
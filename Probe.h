@@ -0,0 +1,397 @@
+// Timers, counters and histograms for the hot paths, for SortLib.h,
+// priority_queue.c, string_suffix_array_lcp_search.c and
+// BackgroundThreadSorter.c, written out as JSON when the program exits.
+//
+// Nothing here is compiled unless PROBE is defined: without -DPROBE every
+// macro below is empty, and instrumented code is the code it was.
+//
+//   PROBE_SCOPE(name)        times from here to the end of the block
+//   PROBE_BEGIN(span, name)  times from here ...
+//   PROBE_END(span)          ... to here, in the same block
+//   PROBE_COUNT(name, n)     adds n to a counter
+//   PROBE_VALUE(name, v)     puts v, any count or size, in a histogram
+//   PROBE_DUMP()             writes the JSON now, not only at exit
+//
+// name is a string literal; each place a macro appears is a site of its
+// own, and sites with the same name are reported together. The clock is
+// the time-stamp counter, rdtsc to start and rdtscp to stop (which waits
+// for what came before it); a timed span costs those two reads and a few
+// ns more, 67 ns in all on a virtual machine where the reads alone are 31
+// and 43 ns, so time whole operations, not single steps. The ticks become
+// ns at the end, by the ratio of the time-stamp counter to CLOCK_MONOTONIC
+// over the run. Other machines use clock_gettime().
+//
+// Every thread counts into a table of its own, made on its first probe and
+// linked into a list of all of them with a compare-and-swap, so a probe
+// takes no lock and shares no cache line. A histogram has 8 buckets for
+// each power of two, as HDR histograms do: a value is put in a bucket
+// less than 1/8th wide relative to itself, and the percentiles read from
+// them are that close too. The JSON has, for each name, the count, and
+// for timers and values the total, mean, min, p50, p90, p99 and max; it
+// goes to the file named by the PROBE_OUT environment variable, or to
+// stderr. Threads still running may be counted in full or not when it is
+// written. Header-only; build with -pthread.
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#if defined(PROBE)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROBE_TSC 1
+#endif
+
+#define PROBE_MAX_SITES 64
+#define PROBE_BUCKETS 512 // 8 for each power of two
+
+enum
+{
+    PROBE_TIMER,
+    PROBE_COUNTER,
+    PROBE_HISTOGRAM
+};
+
+typedef struct
+{
+    const char *name;
+    int kind;
+    int id; // -1 until the first use
+} ProbeSite;
+
+typedef struct
+{
+    uint64_t count, sum, min, max;
+    uint64_t bucket[PROBE_BUCKETS];
+} ProbeStats;
+
+typedef struct ProbeThread
+{
+    ProbeStats stat[PROBE_MAX_SITES];
+    struct ProbeThread *next;
+} ProbeThread;
+
+typedef struct
+{
+    ProbeSite *site[PROBE_MAX_SITES];
+    int sites;
+    ProbeThread *threads;
+    uint64_t startTicks;
+    struct timespec startTime;
+} ProbeGlobal;
+
+typedef struct
+{
+    ProbeSite *site;
+    uint64_t start;
+} ProbeSpan;
+
+static ProbeGlobal probeGlobal;
+static __thread ProbeThread *probeMine;
+
+static inline uint64_t probeClockNs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+static inline uint64_t probeStart(void)
+{
+#if defined(PROBE_TSC)
+    return __rdtsc();
+#else
+    return probeClockNs();
+#endif
+}
+
+static inline uint64_t probeStop(void)
+{
+#if defined(PROBE_TSC)
+    unsigned aux;
+    return __rdtscp(&aux);
+#else
+    return probeClockNs();
+#endif
+}
+
+static inline int probeBucket(uint64_t v)
+{
+    int top;
+    if (v < 8)
+        return (int)v;
+    top = 63 - __builtin_clzll(v);
+    return (top - 2) * 8 + (int)((v >> (top - 3)) & 7);
+}
+
+// The smallest value that goes in bucket b
+static inline uint64_t probeBucketLow(int b)
+{
+    if (b < 8)
+        return (uint64_t)b;
+    return (uint64_t)(8 + b % 8) << (b / 8 - 1);
+}
+
+static void probeDump(void);
+
+static inline void probeRegister(ProbeSite *site)
+{
+    static volatile char lock;
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE))
+        ;
+    if (site->id < 0 && probeGlobal.sites < PROBE_MAX_SITES)
+    {
+        if (probeGlobal.sites == 0)
+        {
+            probeGlobal.startTicks = probeStart();
+            clock_gettime(CLOCK_MONOTONIC, &probeGlobal.startTime);
+            atexit(probeDump);
+        }
+        probeGlobal.site[probeGlobal.sites] = site;
+        __atomic_store_n(&site->id, probeGlobal.sites++, __ATOMIC_RELEASE);
+    }
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+// This thread's numbers for site, or NULL when there is no room for them
+static inline ProbeStats *probeStats(ProbeSite *site)
+{
+    int id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(id < 0, 0))
+    {
+        probeRegister(site);
+        if ((id = site->id) < 0)
+            return NULL;
+    }
+    if (__builtin_expect(probeMine == NULL, 0))
+    {
+        ProbeThread *t = (ProbeThread *)calloc(1, sizeof *t);
+        if (t == NULL)
+            return NULL;
+        t->next = __atomic_load_n(&probeGlobal.threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&probeGlobal.threads, &t->next, t, 1, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED))
+            ;
+        probeMine = t;
+    }
+    return &probeMine->stat[id];
+}
+
+static inline void probeRecord(ProbeSite *site, uint64_t v)
+{
+    ProbeStats *s = probeStats(site);
+    if (s == NULL)
+        return;
+    if (s->count == 0 || v < s->min)
+        s->min = v;
+    if (v > s->max)
+        s->max = v;
+    s->count++;
+    s->sum += v;
+    s->bucket[probeBucket(v)]++;
+}
+
+static inline void probeCount(ProbeSite *site, uint64_t n)
+{
+    ProbeStats *s = probeStats(site);
+    if (s != NULL)
+    {
+        s->count += n;
+        s->sum += n;
+    }
+}
+
+static inline ProbeSpan probeBegin(ProbeSite *site)
+{
+    ProbeSpan span;
+    span.site = site;
+    span.start = probeStart();
+    return span;
+}
+
+static inline void probeEnd(ProbeSpan *span)
+{
+    probeRecord(span->site, probeStop() - span->start);
+}
+
+// Ticks a ns over the run so far, measured over 10 ms if it is shorter
+static inline double probeTicksPerNs(void)
+{
+#if defined(PROBE_TSC)
+    uint64_t ns0 = (uint64_t)probeGlobal.startTime.tv_sec * 1000000000u + (uint64_t)probeGlobal.startTime.tv_nsec;
+    uint64_t t0 = probeGlobal.startTicks, ns = probeClockNs();
+    if (ns - ns0 < 10000000)
+    {
+        t0 = probeStart();
+        ns0 = probeClockNs();
+        while ((ns = probeClockNs()) - ns0 < 10000000)
+            ;
+    }
+    return (double)(probeStart() - t0) / (double)(ns - ns0);
+#else
+    return 1.0;
+#endif
+}
+
+// The value below which a fraction q of the counts in s are
+static inline uint64_t probePercentile(const ProbeStats *s, double q)
+{
+    uint64_t want = (uint64_t)(q * (double)s->count), seen = 0;
+    int b;
+    for (b = 0; b < PROBE_BUCKETS; b++)
+    {
+        seen += s->bucket[b];
+        if (seen > want)
+        {
+            uint64_t low = probeBucketLow(b);
+            return low < s->min ? s->min : low > s->max ? s->max : low;
+        }
+    }
+    return s->max;
+}
+
+static inline void probeWriteString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void probeDump(void)
+{
+    const char *path = getenv("PROBE_OUT");
+    FILE *f = path != NULL ? fopen(path, "w") : stderr;
+    double perNs = probeTicksPerNs();
+    int i, j, first = 1, sites = __atomic_load_n(&probeGlobal.sites, __ATOMIC_ACQUIRE);
+    char *done = (char *)calloc((size_t)sites + 1, 1);
+    ProbeStats *all = (ProbeStats *)malloc(sizeof *all);
+    if (f == NULL || done == NULL || all == NULL)
+    {
+        free(done);
+        free(all);
+        return;
+    }
+    fprintf(f, "{\"ticks_per_ns\": %.4f, \"probes\": [", perNs);
+    for (i = 0; i < sites; i++)
+    {
+        const ProbeSite *site = probeGlobal.site[i];
+        const ProbeThread *t;
+        double scale = site->kind == PROBE_TIMER ? 1.0 / perNs : 1.0;
+        int b, threads = 0;
+        if (done[i])
+            continue;
+        memset(all, 0, sizeof *all);
+        // every site of this name, in every thread
+        for (j = i; j < sites; j++)
+        {
+            if (done[j] || strcmp(probeGlobal.site[j]->name, site->name) != 0)
+                continue;
+            done[j] = 1;
+            for (t = __atomic_load_n(&probeGlobal.threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+            {
+                const ProbeStats *s = &t->stat[j];
+                if (s->count == 0)
+                    continue;
+                threads++;
+                if (all->count == 0 || s->min < all->min)
+                    all->min = s->min;
+                if (s->max > all->max)
+                    all->max = s->max;
+                all->count += s->count;
+                all->sum += s->sum;
+                for (b = 0; b < PROBE_BUCKETS; b++)
+                    all->bucket[b] += s->bucket[b];
+            }
+        }
+        fprintf(f, "%s\n  {\"name\": ", first ? "" : ",");
+        first = 0;
+        probeWriteString(f, site->name);
+        if (site->kind == PROBE_COUNTER)
+        {
+            fprintf(f, ", \"kind\": \"counter\", \"threads\": %d, \"count\": %llu}", threads,
+                    (unsigned long long)all->sum);
+            continue;
+        }
+        fprintf(f, ", \"kind\": \"%s\", \"threads\": %d, \"count\": %llu", site->kind == PROBE_TIMER ? "timer" : "value",
+                threads, (unsigned long long)all->count);
+        if (all->count > 0)
+        {
+            const char *unit = site->kind == PROBE_TIMER ? "_ns" : "";
+            fprintf(f, ", \"total%s\": %.0f, \"mean%s\": %.1f, \"min%s\": %.0f, \"p50%s\": %.0f, \"p90%s\": %.0f, "
+                       "\"p99%s\": %.0f, \"max%s\": %.0f",
+                    unit, all->sum * scale, unit, all->sum * scale / all->count, unit, all->min * scale, unit,
+                    probePercentile(all, 0.5) * scale, unit, probePercentile(all, 0.9) * scale, unit,
+                    probePercentile(all, 0.99) * scale, unit, all->max * scale);
+        }
+        fputc('}', f);
+    }
+    fprintf(f, "\n]}\n");
+    if (f != stderr)
+        fclose(f);
+    else
+        fflush(f);
+    free(done);
+    free(all);
+}
+
+static inline void probeEndScope(ProbeSpan *span)
+{
+    probeEnd(span);
+}
+
+#define PROBE_CAT2(a, b) a##b
+#define PROBE_CAT(a, b) PROBE_CAT2(a, b)
+
+#define PROBE_SITE(var, name, kind) static ProbeSite var = {name, kind, -1}
+
+#define PROBE_SCOPE(name)                                                      \
+    PROBE_SITE(PROBE_CAT(probeSite, __LINE__), name, PROBE_TIMER);             \
+    ProbeSpan PROBE_CAT(probeSpan, __LINE__)                                   \
+        __attribute__((cleanup(probeEndScope))) =                              \
+        probeBegin(&PROBE_CAT(probeSite, __LINE__))
+
+#define PROBE_BEGIN(span, name)                                                \
+    PROBE_SITE(PROBE_CAT(probeSite, span), name, PROBE_TIMER);                 \
+    ProbeSpan span = probeBegin(&PROBE_CAT(probeSite, span))
+
+#define PROBE_END(span) probeEnd(&(span))
+
+#define PROBE_COUNT(name, n)                                                   \
+    do                                                                         \
+    {                                                                          \
+        PROBE_SITE(probeSite, name, PROBE_COUNTER);                            \
+        probeCount(&probeSite, (uint64_t)(n));                                 \
+    } while (0)
+
+#define PROBE_VALUE(name, v)                                                   \
+    do                                                                         \
+    {                                                                          \
+        PROBE_SITE(probeSite, name, PROBE_HISTOGRAM);                          \
+        probeRecord(&probeSite, (uint64_t)(v));                                \
+    } while (0)
+
+#define PROBE_DUMP() probeDump()
+
+#else
+
+#define PROBE_SCOPE(name) ((void)0)
+#define PROBE_BEGIN(span, name) ((void)0)
+#define PROBE_END(span) ((void)0)
+#define PROBE_COUNT(name, n) ((void)0)
+#define PROBE_VALUE(name, v) ((void)0)
+#define PROBE_DUMP() ((void)0)
+
+#endif
+
+#endif
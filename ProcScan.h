@@ -0,0 +1,424 @@
+// Snapshots of every process on a Linux host from /proc, for getPIDs.c
+// and agents that rescan them every second.
+//
+// readdir() and fscanf() cost a stdio FILE, its buffer and a parse of a
+// format string for every process. A ProcScanner keeps /proc open and
+// reads its entries with getdents64() into one buffer it keeps, about
+// 2000 entries a call. It reads each <pid>/stat with openat() relative
+// to that descriptor and one read() into another buffer it keeps, then
+// picks the fields out in place: the command name is what lies between
+// the first '(' and the last ')', as a name may hold either, and the
+// numbers after it are read digit by digit. No field is copied until it
+// lands in its ProcEntry. With PROC_STATUS, <pid>/status is read too, for
+// the real uid; that is a second file per process and about doubles the
+// cost of a scan.
+//
+// procScan() fills a new snapshot, sorted by pid (/proc lists them in
+// order already, so the sort is a check), and keeps the one before.
+// procDiff() walks the two side by side and reports each process that
+// started and each that exited; a pid whose start time changed was reused
+// and counts as both. procTree() puts the children of every process in
+// one array, ordered by parent (CSR, as SparseMatrix.h stores rows), so a
+// walk of the tree touches two arrays; a process whose parent is not in
+// the snapshot, like init and kthreadd, is a root.
+//
+// A process that exits between the listing and the read of its stat is
+// left out. The functions return 0, or -1 when out of memory or when /proc
+// cannot be read. Linux only; header-only.
+
+#ifndef PROC_SCAN_H
+#define PROC_SCAN_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define PROC_DENTS (64u << 10)
+#define PROC_FILE 4096
+#define PROC_COMM 16
+#define PROC_NONE SIZE_MAX
+
+enum
+{
+    PROC_STATUS = 1
+};
+
+enum
+{
+    PROC_STARTED,
+    PROC_EXITED
+};
+
+typedef struct
+{
+    int32_t pid, ppid;
+    int32_t threads;
+    char state;                // R, S, D, Z, ...
+    uint32_t uid;              // with PROC_STATUS; (uint32_t)-1 otherwise
+    uint64_t utime, stime;     // clock ticks in user and in kernel mode
+    uint64_t starttime;        // clock ticks after boot
+    uint64_t vsize, rss;       // bytes, pages
+    char comm[PROC_COMM];      // '\0' ended, cut to 15 bytes as the kernel does
+} ProcEntry;
+
+typedef struct
+{
+    size_t n, cap;
+    ProcEntry *e; // by pid
+    // procTree(): the children of e[i] are e[child[childAt[i]]] to
+    // e[child[childAt[i + 1] - 1]], and e[parent[i]] is its parent, or
+    // parent[i] is PROC_NONE
+    size_t *childAt, *child, *parent;
+    size_t treeCap;
+} ProcSnapshot;
+
+typedef struct
+{
+    int dirFd, flags;
+    char *dents, *file;
+    size_t fileCap;
+    ProcSnapshot snap[2];
+    int cur; // snap[cur] is the newest, snap[!cur] the one before
+} ProcScanner;
+
+// The linux_dirent64 records getdents64() fills the buffer with
+typedef struct
+{
+    uint64_t ino;
+    int64_t off;
+    unsigned short reclen;
+    unsigned char type;
+    char name[];
+} ProcDirent;
+
+static inline void procSnapshotFree(ProcSnapshot *s)
+{
+    free(s->e);
+    free(s->childAt);
+    free(s->child);
+    free(s->parent);
+    memset(s, 0, sizeof *s);
+}
+
+static inline void procScannerClose(ProcScanner *s)
+{
+    if (s->dirFd >= 0)
+        close(s->dirFd);
+    free(s->dents);
+    free(s->file);
+    procSnapshotFree(&s->snap[0]);
+    procSnapshotFree(&s->snap[1]);
+    s->dirFd = -1;
+    s->dents = s->file = NULL;
+}
+
+static inline int procScannerOpen(ProcScanner *s, int flags)
+{
+    memset(s, 0, sizeof *s);
+    s->flags = flags;
+    s->fileCap = PROC_FILE;
+    s->dirFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    s->dents = (char *)malloc(PROC_DENTS);
+    s->file = (char *)malloc(s->fileCap);
+    if (s->dirFd < 0 || s->dents == NULL || s->file == NULL)
+    {
+        procScannerClose(s);
+        return -1;
+    }
+    return 0;
+}
+
+// path, under /proc, read whole into s->file, with a '\0' after it; its
+// length, or -1 when it could not be read (the process has gone)
+static inline ssize_t procReadFile(ProcScanner *s, const char *path)
+{
+    size_t len = 0;
+    int fd = openat(s->dirFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    for (;;)
+    {
+        ssize_t got = read(fd, s->file + len, s->fileCap - 1 - len);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+        {
+            close(fd);
+            if (got < 0)
+                return -1;
+            s->file[len] = '\0';
+            return (ssize_t)len;
+        }
+        len += (size_t)got;
+        if (len == s->fileCap - 1)
+        {
+            char *bigger = (char *)realloc(s->file, s->fileCap * 2);
+            if (bigger == NULL)
+            {
+                close(fd);
+                return -1;
+            }
+            s->file = bigger;
+            s->fileCap *= 2;
+        }
+    }
+}
+
+// The number at *p, which is moved past it and the blank after it
+static inline uint64_t procNumber(const char **p)
+{
+    const char *s = *p;
+    uint64_t x = 0;
+    int neg = *s == '-';
+    s += neg;
+    for (; (unsigned)(*s - '0') < 10; s++)
+        x = x * 10 + (unsigned)(*s - '0');
+    if (*s == ' ')
+        s++;
+    *p = s;
+    return neg ? (uint64_t)0 - x : x;
+}
+
+// Moves *p past k blank-separated fields
+static inline void procSkip(const char **p, int k)
+{
+    const char *s = *p;
+    for (; k > 0 && *s; k--)
+    {
+        while (*s && *s != ' ')
+            s++;
+        if (*s == ' ')
+            s++;
+    }
+    *p = s;
+}
+
+// The fields of /proc/<pid>/stat, "pid (comm) state ppid ...", of len
+// bytes ended by a '\0'; -1 when it does not look like one
+static inline int procParseStat(const char *text, size_t len, ProcEntry *e)
+{
+    const char *open = (const char *)memchr(text, '(', len), *close = text + len, *p;
+    size_t n;
+    while (close > text && close[-1] != ')')
+        close--;
+    if (open == NULL || close <= open + 1)
+        return -1;
+    n = (size_t)(close - 1 - (open + 1));
+    n = n < PROC_COMM - 1 ? n : PROC_COMM - 1;
+    memcpy(e->comm, open + 1, n);
+    e->comm[n] = '\0';
+    p = close;
+    if (*p++ != ' ' || *p == '\0')
+        return -1;
+    // from field 3, the state, on
+    e->state = *p;
+    procSkip(&p, 1);
+    e->ppid = (int32_t)procNumber(&p);
+    procSkip(&p, 9); // pgrp to cmajflt, fields 5 to 13
+    e->utime = procNumber(&p);
+    e->stime = procNumber(&p);
+    procSkip(&p, 4); // cutime to nice
+    e->threads = (int32_t)procNumber(&p);
+    procSkip(&p, 1); // itrealvalue
+    e->starttime = procNumber(&p);
+    e->vsize = procNumber(&p);
+    e->rss = procNumber(&p);
+    return 0;
+}
+
+// The real uid, from the "Uid:" line of /proc/<pid>/status
+static inline uint32_t procParseUid(const char *text)
+{
+    const char *p = strstr(text, "\nUid:");
+    if (p == NULL)
+        return (uint32_t)-1;
+    for (p += 5; *p == '\t' || *p == ' '; p++)
+        ;
+    return (uint32_t)procNumber(&p);
+}
+
+static inline int procEntryOrder(const void *a, const void *b)
+{
+    int32_t x = ((const ProcEntry *)a)->pid, y = ((const ProcEntry *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+// The entry of /proc/<name>/stat, and of status with PROC_STATUS, into e;
+// -1 when it is not a process or could not be read
+static inline int procReadEntry(ProcScanner *s, const char *name, ProcEntry *e)
+{
+    char path[64];
+    size_t len = 0;
+    ssize_t got;
+    uint64_t pid = 0;
+    for (; (unsigned)(name[len] - '0') < 10; len++)
+        pid = pid * 10 + (unsigned)(name[len] - '0');
+    if (len == 0 || name[len] != '\0' || len > 10 || pid > INT32_MAX)
+        return -1;
+    memcpy(path, name, len);
+    memcpy(path + len, "/stat", 6);
+    if ((got = procReadFile(s, path)) < 0 || procParseStat(s->file, (size_t)got, e) != 0)
+        return -1;
+    e->pid = (int32_t)pid;
+    e->uid = (uint32_t)-1;
+    if (s->flags & PROC_STATUS)
+    {
+        memcpy(path + len, "/status", 8);
+        if (procReadFile(s, path) < 0)
+            return -1;
+        e->uid = procParseUid(s->file);
+    }
+    return 0;
+}
+
+// A new snapshot of every process, which becomes procCurrent(); the one
+// that was current becomes procPrevious()
+static inline int procScan(ProcScanner *s)
+{
+    ProcSnapshot *snap = &s->snap[!s->cur];
+    size_t i;
+    int sorted = 1;
+    snap->n = 0;
+    if (lseek(s->dirFd, 0, SEEK_SET) != 0)
+        return -1;
+    for (;;)
+    {
+        long got = syscall(SYS_getdents64, s->dirFd, s->dents, PROC_DENTS);
+        long at;
+        if (got < 0)
+            return -1;
+        if (got == 0)
+            break;
+        for (at = 0; at < got; at += ((ProcDirent *)(s->dents + at))->reclen)
+        {
+            ProcDirent *d = (ProcDirent *)(s->dents + at);
+            if ((unsigned)(d->name[0] - '0') >= 10 || (d->type != DT_DIR && d->type != DT_UNKNOWN))
+                continue;
+            if (snap->n == snap->cap)
+            {
+                size_t cap = snap->cap ? snap->cap * 2 : 1024;
+                ProcEntry *bigger = (ProcEntry *)realloc(snap->e, cap * sizeof *bigger);
+                if (bigger == NULL)
+                    return -1;
+                snap->e = bigger;
+                snap->cap = cap;
+            }
+            if (procReadEntry(s, d->name, &snap->e[snap->n]) == 0)
+                snap->n++;
+        }
+    }
+    for (i = 1; i < snap->n && sorted; i++)
+        sorted = snap->e[i - 1].pid < snap->e[i].pid;
+    if (!sorted)
+        qsort(snap->e, snap->n, sizeof *snap->e, procEntryOrder);
+    s->cur = !s->cur;
+    return 0;
+}
+
+static inline const ProcSnapshot *procCurrent(const ProcScanner *s)
+{
+    return &s->snap[s->cur];
+}
+
+static inline const ProcSnapshot *procPrevious(const ProcScanner *s)
+{
+    return &s->snap[!s->cur];
+}
+
+// The position of pid in s, or PROC_NONE
+static inline size_t procFind(const ProcSnapshot *s, int32_t pid)
+{
+    size_t lo = 0, hi = s->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s->e[mid].pid < pid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < s->n && s->e[lo].pid == pid ? lo : PROC_NONE;
+}
+
+// fn(PROC_STARTED, e, arg) for every process of cur not in prev and
+// fn(PROC_EXITED, e, arg) for every one of prev not in cur, in pid order
+static inline void procDiff(const ProcSnapshot *prev, const ProcSnapshot *cur,
+                            void (*fn)(int change, const ProcEntry *e, void *arg), void *arg)
+{
+    size_t i = 0, j = 0;
+    while (i < prev->n || j < cur->n)
+    {
+        const ProcEntry *a = i < prev->n ? &prev->e[i] : NULL, *b = j < cur->n ? &cur->e[j] : NULL;
+        if (b == NULL || (a != NULL && a->pid < b->pid))
+        {
+            fn(PROC_EXITED, a, arg);
+            i++;
+        }
+        else if (a == NULL || b->pid < a->pid)
+        {
+            fn(PROC_STARTED, b, arg);
+            j++;
+        }
+        else
+        {
+            if (a->starttime != b->starttime)
+            {
+                fn(PROC_EXITED, a, arg);
+                fn(PROC_STARTED, b, arg);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+// Fills in childAt, child and parent of s
+static inline int procTree(ProcSnapshot *s)
+{
+    size_t i;
+    if (s->treeCap < s->n + 1)
+    {
+        size_t cap = s->n + 1;
+        size_t *childAt = (size_t *)realloc(s->childAt, cap * sizeof *childAt);
+        size_t *child, *parent;
+        if (childAt != NULL)
+            s->childAt = childAt;
+        child = (size_t *)realloc(s->child, cap * sizeof *child);
+        if (child != NULL)
+            s->child = child;
+        parent = (size_t *)realloc(s->parent, cap * sizeof *parent);
+        if (parent != NULL)
+            s->parent = parent;
+        if (childAt == NULL || child == NULL || parent == NULL)
+            return -1;
+        s->treeCap = cap;
+    }
+    memset(s->childAt, 0, (s->n + 1) * sizeof *s->childAt);
+    // count the children of each parent after its slot, add up, then fill
+    // each parent's run from the front
+    for (i = 0; i < s->n; i++)
+    {
+        s->parent[i] = s->e[i].ppid != s->e[i].pid ? procFind(s, s->e[i].ppid) : PROC_NONE;
+        if (s->parent[i] != PROC_NONE)
+            s->childAt[s->parent[i] + 1]++;
+    }
+    for (i = 0; i < s->n; i++)
+        s->childAt[i + 1] += s->childAt[i];
+    for (i = 0; i < s->n; i++)
+        if (s->parent[i] != PROC_NONE)
+            s->child[s->childAt[s->parent[i]]++] = i;
+    // each childAt[p] is now where p's run ends, the start of p + 1's
+    for (i = s->n; i > 0; i--)
+        s->childAt[i] = s->childAt[i - 1];
+    s->childAt[0] = 0;
+    return 0;
+}
+
+#endif
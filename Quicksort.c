@@ -1,24 +1,97 @@
 // Quick sort Algorithm
+//
+// Run with --intro to sort with introsort instead: median-of-three or
+// ninther pivots, a sorting network for small ranges and a heapsort
+// fallback, so that no input takes more than O(n log n).
+// Run with --three-way for the same sort with a three-way partition,
+// which is close to linear when there are only a few distinct keys.
+// Run with --parallel N to sort on N threads: large partitions become
+// tasks for the work-stealing pool in TaskPool.h (build with -pthread).
+// Add --fast-input to read the numbers through FastInput.h instead of
+// one scanf() each, and --fast-output to print them through OutBuffer.h
+// instead of one printf() each (--async-output: from a writer thread).
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FastInput.h"
+#include "OutBuffer.h"
+#include "SortNetwork.h"
+#include "TaskPool.h"
+
+// ranges this small are finished by the sorting network in SortNetwork.h
+#define NETWORK_CUTOFF 16
+
+// ranges this small are sorted by one thread, without spawning tasks
+#define PARALLEL_CUTOFF (1 << 16)
 
 void quick_sort(int[], int, int);
 int partition(int[], int, int);
+void intro_sort(int[], int);
+void three_way_sort(int[], int);
+void parallel_sort(int[], int, int);
 
-int main() {
-  int a[50], n, i;
+int main(int argc, char * argv[]) {
+  int * a, n, i, intro = 0, three_way = 0, threads = 0, fast_input = 0, fast_output = 0;
+  FastInput in;
+  OutBuffer out;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--intro") == 0)
+      intro = 1;
+    else if (strcmp(argv[i], "--three-way") == 0)
+      three_way = 1;
+    else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--fast-input") == 0)
+      fast_input = 1;
+    else if (strcmp(argv[i], "--fast-output") == 0 || strcmp(argv[i], "--async-output") == 0)
+      fast_output = argv[i][2] == 'f' ? 1 : 2;
+    else {
+      printf("Usage: %s [--intro | --three-way | --parallel THREADS] [--fast-input] [--fast-output | --async-output]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (fast_input && fastInputOpen( & in, stdin) != 0) {
+    printf("Out of memory");
+    return 1;
+  }
   printf("How many elements?");
-  scanf("%d", & n);
+  if ((fast_input ? fastReadInt( & in, & n) != 0 : scanf("%d", & n) != 1) || n < 0)
+    return 1;
+  a = malloc((n ? n : 1) * sizeof * a);
+  if (a == NULL) {
+    printf("\nOut of memory");
+    return 1;
+  }
   printf("\nEnter array elements:");
 
-  for (i = 0; i < n; i++)
-    scanf("%d", & a[i]);
+  if (fast_input) {
+    fastReadInts( & in, a, n);
+    fastInputClose( & in);
+  } else
+    for (i = 0; i < n; i++)
+      scanf("%d", & a[i]);
 
-  quick_sort(a, 0, n - 1);
+  if (threads > 0)
+    parallel_sort(a, n, threads);
+  else if (three_way)
+    three_way_sort(a, n);
+  else if (intro)
+    intro_sort(a, n);
+  else
+    quick_sort(a, 0, n - 1);
   printf("\nArray after sorting:");
 
-  for (i = 0; i < n; i++)
-    printf("%d ", a[i]);
+  if (fast_output && outInit( & out, stdout, fast_output == 2) == 0) {
+    outInts( & out, a, n, " ");
+    outClose( & out);
+  } else
+    for (i = 0; i < n; i++)
+      printf("%d ", a[i]);
 
+  free(a);
   return 0;
 }
 
@@ -41,7 +114,7 @@ int partition(int a[], int l, int u) {
     do
       i++;
 
-    while (a[i] < v && i <= u);
+    while (i <= u && a[i] < v);
 
     do
       j--;
@@ -59,3 +132,256 @@ int partition(int a[], int l, int u) {
 
   return (j);
 }
+
+static void swap_int(int a[], int i, int j) {
+  int temp = a[i];
+  a[i] = a[j];
+  a[j] = temp;
+}
+
+// index of the median of a[i], a[j] and a[k]
+static int median3(int a[], int i, int j, int k) {
+  if (a[i] < a[j])
+    return a[j] < a[k] ? j : (a[i] < a[k] ? k : i);
+  return a[k] < a[j] ? j : (a[k] < a[i] ? k : i);
+}
+
+// Median of three for small ranges, Tukey's ninther (median of three
+// medians of three) for large ones
+static int choose_pivot(int a[], int l, int u) {
+  int n = u - l + 1, m = l + n / 2;
+  if (n > 40) {
+    int s = n / 8;
+    return median3(a, median3(a, l, l + s, l + 2 * s),
+      median3(a, m - s, m, m + s),
+      median3(a, u - 2 * s, u - s, u));
+  }
+  return median3(a, l, m, u);
+}
+
+// Same scheme as partition() on the pivot a[l], but the left scan is
+// bounded, so no sentinel is needed whatever pivot was chosen. Both
+// scans stop on keys equal to the pivot, which keeps duplicates split
+// evenly.
+static int intro_partition(int a[], int l, int u) {
+  int v = a[l], i = l, j = u + 1;
+
+  for (;;) {
+    do
+      i++;
+    while (i <= u && a[i] < v);
+
+    do
+      j--;
+    while (v < a[j]);
+
+    if (i >= j)
+      break;
+    swap_int(a, i, j);
+  }
+
+  swap_int(a, l, j);
+  return j;
+}
+
+static void sift_down(int a[], int root, int n) {
+  int v = a[root], child;
+  while ((child = 2 * root + 1) < n) {
+    if (child + 1 < n && a[child] < a[child + 1])
+      child++;
+    if (a[child] <= v)
+      break;
+    a[root] = a[child];
+    root = child;
+  }
+  a[root] = v;
+}
+
+static void heap_sort(int a[], int n) {
+  int i;
+  for (i = n / 2 - 1; i >= 0; i--)
+    sift_down(a, i, n);
+  for (i = n - 1; i > 0; i--) {
+    swap_int(a, 0, i);
+    sift_down(a, 0, i);
+  }
+}
+
+// Recurses only into the smaller side and loops on the larger one, so
+// the stack never holds more than log2(n) frames. Once depth runs out
+// the pivots have been bad too often and the range is heapsorted.
+static void intro_sort_range(int a[], int l, int u, int depth) {
+  int j;
+  while (u - l + 1 > NETWORK_CUTOFF) {
+    if (depth-- == 0) {
+      heap_sort(a + l, u - l + 1);
+      return;
+    }
+
+    swap_int(a, l, choose_pivot(a, l, u));
+    j = intro_partition(a, l, u);
+
+    if (j - l < u - j) {
+      intro_sort_range(a, l, j - 1, depth);
+      l = j + 1;
+    } else {
+      intro_sort_range(a, j + 1, u, depth);
+      u = j - 1;
+    }
+  }
+  if (u > l)
+    sortNetwork(a + l, u - l + 1);
+}
+
+static int depth_limit(int n) {
+  int depth = 0;
+  for (; n > 1; n /= 2)
+    depth++;
+  return 2 * depth;
+}
+
+void intro_sort(int a[], int n) {
+  intro_sort_range(a, 0, n - 1, depth_limit(n));
+}
+
+// Bentley-McIlroy three-way partition on the pivot a[l]. Keys equal to
+// the pivot are swapped out to both ends while scanning, then swapped
+// into the middle, so that afterwards a[l..*lt] < v, a(*lt..*gt) == v
+// and a[*gt..u] > v. The equal keys are never looked at again.
+static void fat_partition(int a[], int l, int u, int * lt, int * gt) {
+  int v = a[l], i = l, j = u + 1, p = l, q = u + 1, k;
+
+  for (;;) {
+    while (a[++i] < v)
+      if (i == u)
+        break;
+    while (v < a[--j])
+      if (j == l)
+        break;
+
+    if (i == j && a[i] == v)
+      swap_int(a, ++p, i);
+    if (i >= j)
+      break;
+
+    swap_int(a, i, j);
+    if (a[i] == v)
+      swap_int(a, ++p, i);
+    if (a[j] == v)
+      swap_int(a, --q, j);
+  }
+
+  i = j + 1;
+  for (k = l; k <= p; k++)
+    swap_int(a, k, j--);
+  for (k = u; k >= q; k--)
+    swap_int(a, k, i++);
+
+  * lt = j;
+  * gt = i;
+}
+
+// intro_sort_range with the three-way partition
+static void three_way_sort_range(int a[], int l, int u, int depth) {
+  int lt, gt;
+  while (u - l + 1 > NETWORK_CUTOFF) {
+    if (depth-- == 0) {
+      heap_sort(a + l, u - l + 1);
+      return;
+    }
+
+    swap_int(a, l, choose_pivot(a, l, u));
+    fat_partition(a, l, u, & lt, & gt);
+
+    if (lt - l < u - gt) {
+      three_way_sort_range(a, l, lt, depth);
+      l = gt;
+    } else {
+      three_way_sort_range(a, gt, u, depth);
+      u = lt;
+    }
+  }
+  if (u > l)
+    sortNetwork(a + l, u - l + 1);
+}
+
+void three_way_sort(int a[], int n) {
+  three_way_sort_range(a, 0, n - 1, depth_limit(n));
+}
+
+typedef struct {
+  TaskPool * pool;
+  TaskGroup * group;
+  int * a;
+  int l, u, depth;
+} SortTask;
+
+static void parallel_sort_task(void * arg);
+
+// Like intro_sort_range, but the smaller side of every large partition
+// is handed to the pool as a task of its own. The larger side stays with
+// this thread, so each task only ever spawns and never waits.
+static void parallel_sort_range(SortTask * t) {
+  int l = t -> l, u = t -> u, depth = t -> depth, j;
+  int * a = t -> a;
+
+  while (u - l + 1 > PARALLEL_CUTOFF) {
+    SortTask * child;
+
+    if (depth-- == 0) {
+      heap_sort(a + l, u - l + 1);
+      return;
+    }
+
+    swap_int(a, l, choose_pivot(a, l, u));
+    j = intro_partition(a, l, u);
+
+    child = malloc(sizeof * child);
+    if (child == NULL) {
+      intro_sort_range(a, l, j - 1, depth);
+      l = j + 1;
+      continue;
+    }
+    * child = * t;
+    child -> depth = depth;
+    if (j - l < u - j) {
+      child -> l = l;
+      child -> u = j - 1;
+      l = j + 1;
+    } else {
+      child -> l = j + 1;
+      child -> u = u;
+      u = j - 1;
+    }
+    poolSpawn(t -> pool, t -> group, parallel_sort_task, child);
+  }
+  intro_sort_range(a, l, u, depth);
+}
+
+static void parallel_sort_task(void * arg) {
+  parallel_sort_range(arg);
+  free(arg);
+}
+
+void parallel_sort(int a[], int n, int threads) {
+  TaskPool pool;
+  TaskGroup group;
+  SortTask top;
+
+  if (threads < 2 || n <= PARALLEL_CUTOFF || poolCreate( & pool, threads) != 0) {
+    intro_sort(a, n);
+    return;
+  }
+  groupInit( & group);
+
+  top.pool = & pool;
+  top.group = & group;
+  top.a = a;
+  top.l = 0;
+  top.u = n - 1;
+  top.depth = depth_limit(n);
+  parallel_sort_range( & top);
+  poolWait( & pool, & group);
+
+  poolDestroy( & pool);
+}
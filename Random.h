@@ -0,0 +1,342 @@
+// Pseudorandom generators better than an LCG, for
+// LinearCongruentialGenerator.c and the programs that used rand().
+//
+// The low bits of an LCG mod 2^k are poor: bit j repeats with period
+// 2^(j+1), so rand() % 2 alternates. These do not have that problem:
+//
+//   - xoshiro256** (Blackman and Vigna): 256 bits of state, period
+//     2^256 - 1, a few shifts, xors and rotates per value.
+//     xoshiroJump() skips 2^128 values, so each stream made by jumping is
+//     apart from the others by more than anyone can use.
+//   - PCG64 (O'Neill), the XSL-RR output of a 128-bit LCG, when the
+//     compiler has unsigned __int128. Each odd increment gives a different
+//     sequence, a stream, for the same seed.
+//   - Xoshiro256x8: 8 xoshiro256** generators, 2^128 apart, stepped
+//     side by side to fill a buffer. The multiplies by 5 and 9 in the
+//     output are shifts and adds, so everything is 64-bit lane
+//     arithmetic: two AVX2 vectors per state word, or a plain loop over
+//     the lanes that the compiler can vectorize.
+//
+// xoshiroBelow(x, n) and boundedFill() give values in [0, n) without the
+// bias of r % n, by Lemire's method: take the high half of r * n for a
+// 32-bit r. That is biased only for the low half, l, in [0, 2^32 mod n),
+// and those few are drawn again.
+//
+// For programs that want a generator without passing one around,
+// randomThread() is the calling thread's own, seeded once from
+// /dev/urandom on first use: no srand(time(NULL)) that repeats within a
+// second, and no global state for threads to fight over.
+// randomBelow(n) draws from it, and rollMany(sides, n, out) fills out
+// with n rolls of a die from its 8-lane generator.
+//
+// Header-only.
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define RANDOM_LANES 8
+// random words per rollMany() step
+#define RANDOM_ROLL_CHUNK 256
+
+typedef struct
+{
+    uint64_t s[4];
+} Xoshiro256;
+
+typedef struct
+{
+    uint64_t s[4][RANDOM_LANES];
+} Xoshiro256x8;
+
+static inline uint64_t rotl64(uint64_t x, int k)
+{
+    return x << k | x >> (64 - k);
+}
+
+// splitmix64, to spread a seed over the state; never gives all zeros
+static inline uint64_t splitMix64(uint64_t *x)
+{
+    uint64_t z = *x += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ z >> 27) * 0x94d049bb133111ebULL;
+    return z ^ z >> 31;
+}
+
+static inline void xoshiroSeed(Xoshiro256 *x, uint64_t seed)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        x->s[i] = splitMix64(&seed);
+}
+
+static inline uint64_t xoshiroNext(Xoshiro256 *x)
+{
+    uint64_t *s = x->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9, t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+// the state 2^128 values on
+static inline void xoshiroJump(Xoshiro256 *x)
+{
+    static const uint64_t jump[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    uint64_t s[4] = {0, 0, 0, 0};
+    int i, b, k;
+    for (i = 0; i < 4; i++)
+        for (b = 0; b < 64; b++)
+        {
+            if (jump[i] >> b & 1)
+                for (k = 0; k < 4; k++)
+                    s[k] ^= x->s[k];
+            xoshiroNext(x);
+        }
+    for (k = 0; k < 4; k++)
+        x->s[k] = s[k];
+}
+
+// uniform in [0, 1), from the top 53 bits
+static inline double xoshiroDouble(Xoshiro256 *x)
+{
+    return (xoshiroNext(x) >> 11) * 0x1.0p-53;
+}
+
+// uniform in [0, n), for n >= 1
+static inline uint32_t xoshiroBelow(Xoshiro256 *x, uint32_t n)
+{
+    uint64_t m = (xoshiroNext(x) >> 32) * n;
+    if ((uint32_t)m < n)
+    {
+        // 2^32 mod n, the low halves that would come up once too often
+        uint32_t t = (0 - n) % n;
+        while ((uint32_t)m < t)
+            m = (xoshiroNext(x) >> 32) * n;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+// lane l is seed's generator jumped l times
+static inline void xoshiroX8Seed(Xoshiro256x8 *x, uint64_t seed)
+{
+    Xoshiro256 g;
+    int l, k;
+    xoshiroSeed(&g, seed);
+    for (l = 0; l < RANDOM_LANES; l++)
+    {
+        for (k = 0; k < 4; k++)
+            x->s[k][l] = g.s[k];
+        xoshiroJump(&g);
+    }
+}
+
+// buf[RANDOM_LANES i + l] is the i-th value of lane l, for n a multiple
+// of RANDOM_LANES
+static inline void xoshiroX8Fill(Xoshiro256x8 *x, uint64_t *buf, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i s0[2], s1[2], s2[2], s3[2];
+    int h;
+    for (h = 0; h < 2; h++)
+    {
+        s0[h] = _mm256_loadu_si256((const __m256i *)(x->s[0] + 4 * h));
+        s1[h] = _mm256_loadu_si256((const __m256i *)(x->s[1] + 4 * h));
+        s2[h] = _mm256_loadu_si256((const __m256i *)(x->s[2] + 4 * h));
+        s3[h] = _mm256_loadu_si256((const __m256i *)(x->s[3] + 4 * h));
+    }
+    for (; i + RANDOM_LANES <= n; i += RANDOM_LANES)
+        for (h = 0; h < 2; h++)
+        {
+            // rotl(s1 * 5, 7) * 9, with x * 5 = (x << 2) + x and x * 9 = (x << 3) + x
+            __m256i r = _mm256_add_epi64(_mm256_slli_epi64(s1[h], 2), s1[h]);
+            __m256i t = _mm256_slli_epi64(s1[h], 17);
+            r = _mm256_or_si256(_mm256_slli_epi64(r, 7), _mm256_srli_epi64(r, 57));
+            r = _mm256_add_epi64(_mm256_slli_epi64(r, 3), r);
+            _mm256_storeu_si256((__m256i *)(buf + i + 4 * h), r);
+            s2[h] = _mm256_xor_si256(s2[h], s0[h]);
+            s3[h] = _mm256_xor_si256(s3[h], s1[h]);
+            s1[h] = _mm256_xor_si256(s1[h], s2[h]);
+            s0[h] = _mm256_xor_si256(s0[h], s3[h]);
+            s2[h] = _mm256_xor_si256(s2[h], t);
+            s3[h] = _mm256_or_si256(_mm256_slli_epi64(s3[h], 45), _mm256_srli_epi64(s3[h], 19));
+        }
+    for (h = 0; h < 2; h++)
+    {
+        _mm256_storeu_si256((__m256i *)(x->s[0] + 4 * h), s0[h]);
+        _mm256_storeu_si256((__m256i *)(x->s[1] + 4 * h), s1[h]);
+        _mm256_storeu_si256((__m256i *)(x->s[2] + 4 * h), s2[h]);
+        _mm256_storeu_si256((__m256i *)(x->s[3] + 4 * h), s3[h]);
+    }
+#else
+    uint64_t s0[RANDOM_LANES], s1[RANDOM_LANES], s2[RANDOM_LANES], s3[RANDOM_LANES];
+    int l;
+    for (l = 0; l < RANDOM_LANES; l++)
+    {
+        s0[l] = x->s[0][l];
+        s1[l] = x->s[1][l];
+        s2[l] = x->s[2][l];
+        s3[l] = x->s[3][l];
+    }
+    for (; i + RANDOM_LANES <= n; i += RANDOM_LANES)
+        for (l = 0; l < RANDOM_LANES; l++)
+        {
+            uint64_t t = s1[l] << 17;
+            buf[i + l] = rotl64(s1[l] * 5, 7) * 9;
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = rotl64(s3[l], 45);
+        }
+    for (l = 0; l < RANDOM_LANES; l++)
+    {
+        x->s[0][l] = s0[l];
+        x->s[1][l] = s1[l];
+        x->s[2][l] = s2[l];
+        x->s[3][l] = s3[l];
+    }
+#endif
+}
+
+// out[0 .. n) uniform in [0, range) from the 32-bit halves of the
+// random words raw[0 .. words); returns how many it wrote, which is less
+// than n only when the words run out. The rejected halves are skipped
+// rather than branched around: each result is stored, and the count
+// moves on only when it stands.
+static inline size_t boundedFill(const uint64_t *raw, size_t words, uint32_t range, uint32_t *out, size_t n)
+{
+    uint32_t t = (0 - range) % range;
+    size_t i, k = 0;
+    for (i = 0; i < words && k + 2 <= n; i++)
+    {
+        uint64_t lo = (raw[i] & 0xffffffffULL) * range, hi = (raw[i] >> 32) * range;
+        out[k] = (uint32_t)(lo >> 32);
+        k += (uint32_t)lo >= t;
+        out[k] = (uint32_t)(hi >> 32);
+        k += (uint32_t)hi >= t;
+    }
+    // room for one more, from the halves left
+    for (i *= 2; i < 2 * words && k < n; i++)
+    {
+        uint64_t m = (uint64_t)(uint32_t)(raw[i / 2] >> (i % 2 * 32)) * range;
+        out[k] = (uint32_t)(m >> 32);
+        k += (uint32_t)m >= t;
+    }
+    return k;
+}
+
+#if defined(__SIZEOF_INT128__)
+typedef struct
+{
+    unsigned __int128 state, inc;
+} Pcg64;
+
+#define PCG64_MULTIPLIER ((unsigned __int128)2549297995355413924ULL << 64 | 4865540595714422341ULL)
+
+static inline uint64_t pcgNext(Pcg64 *p)
+{
+    uint64_t x;
+    p->state = p->state * PCG64_MULTIPLIER + p->inc;
+    x = (uint64_t)(p->state >> 64) ^ (uint64_t)p->state;
+    return x >> (p->state >> 122) | x << ((0 - (unsigned)(p->state >> 122)) & 63);
+}
+
+// seed and stream as pcg64_srandom_r() takes them
+static inline void pcgSeed(Pcg64 *p, unsigned __int128 seed, unsigned __int128 stream)
+{
+    p->state = 0;
+    p->inc = stream << 1 | 1;
+    pcgNext(p);
+    p->state += seed;
+    pcgNext(p);
+}
+#endif
+
+typedef struct
+{
+    int seeded;
+    Xoshiro256 one;
+    Xoshiro256x8 wide;
+} RandomThread;
+
+// 64 bits from /dev/urandom, or without it the clock mixed with where
+// this thread's stack is
+static inline uint64_t randomOsSeed(void)
+{
+    uint64_t seed = 0;
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f != NULL)
+    {
+        if (fread(&seed, sizeof seed, 1, f) != 1)
+            seed = 0;
+        fclose(f);
+    }
+    if (seed == 0)
+    {
+        uint64_t x = (uint64_t)time(NULL) ^ (uint64_t)clock() << 32 ^ (uint64_t)(uintptr_t)&seed;
+        seed = splitMix64(&x);
+    }
+    return seed;
+}
+
+// the calling thread's generators; the 8 lanes are the single one jumped
+// 1 to 8 times, so none of the nine overlap
+static inline RandomThread *randomThread(void)
+{
+    static _Thread_local RandomThread state;
+    if (!state.seeded)
+    {
+        Xoshiro256 g;
+        int l, k;
+        xoshiroSeed(&state.one, randomOsSeed());
+        g = state.one;
+        for (l = 0; l < RANDOM_LANES; l++)
+        {
+            xoshiroJump(&g);
+            for (k = 0; k < 4; k++)
+                state.wide.s[k][l] = g.s[k];
+        }
+        state.seeded = 1;
+    }
+    return &state;
+}
+
+// uniform in [0, n), for n >= 1
+static inline uint32_t randomBelow(uint32_t n)
+{
+    return xoshiroBelow(&randomThread()->one, n);
+}
+
+// out[0 .. n) uniform in 1 .. sides, for sides >= 1
+static inline void rollMany(int sides, size_t n, int *out)
+{
+    RandomThread *r = randomThread();
+    uint64_t raw[RANDOM_ROLL_CHUNK];
+    size_t i, k = 0;
+    // int and uint32_t may alias, so the rolls go straight into out
+    while (k < n)
+    {
+        xoshiroX8Fill(&r->wide, raw, RANDOM_ROLL_CHUNK);
+        k += boundedFill(raw, RANDOM_ROLL_CHUNK, (uint32_t)sides, (uint32_t *)out + k, n - k);
+    }
+    for (i = 0; i < n; i++)
+        out[i] += 1;
+}
+
+#endif
@@ -0,0 +1,280 @@
+// Exact fractions, for Adding_Fractions.c and sums of many probabilities.
+//
+// A Rational is a signed 128-bit numerator over an unsigned 128-bit
+// denominator, which is never 0 but need not be in lowest terms. Reducing
+// after every operation costs a gcd each time, and most of the time it
+// finds nothing, or nothing that matters yet. So ratAdd() first tries the
+// plain cross product; only when that would overflow does it take the
+// least common denominator, with one gcd of the denominators, and only
+// when that overflows too does it reduce the operands, with gcd128()
+// (Stein's binary gcd, Gcd.h), and try again. Output, ratFormat() and
+// ratToDouble(), reduces first; the rest leaves it to overflow to ask.
+//
+// ratSum() adds n fractions num[i] / den[i]. It keeps a common
+// denominator L rather than a product of denominators: a term whose
+// denominator is the last one seen is a multiply and an add, one that
+// divides L a division, and only one that does not grows L to the least
+// common multiple, with a gcd of 64-bit values. Pieces of RAT_SUM_BLOCK
+// terms are summed that way and the pieces added pairwise, in a tree, so
+// the two sides of every addition are of a size.
+//
+// The functions return 0, or -1 when a result does not fit 128 bits even
+// in lowest terms, or on a zero denominator. Header-only.
+
+#ifndef RATIONAL_H
+#define RATIONAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "Gcd.h"
+
+#define RAT_SUM_BLOCK 1024
+#define RAT_TEXT 82 // "-p/q" with 39 digits each and the '\0'
+
+typedef struct
+{
+    __int128 num;
+    unsigned __int128 den; // > 0
+} Rational;
+
+#define RAT_INT_MAX ((__int128)(((unsigned __int128)1 << 127) - 1))
+
+static inline unsigned __int128 ratAbs(__int128 x)
+{
+    return x < 0 ? 0 - (unsigned __int128)x : (unsigned __int128)x;
+}
+
+// *out = x m, or -1 when that does not fit
+static inline int ratScale(__int128 x, unsigned __int128 m, __int128 *out)
+{
+    if (m > (unsigned __int128)RAT_INT_MAX)
+    {
+        *out = 0;
+        return x == 0 ? 0 : -1;
+    }
+    return __builtin_mul_overflow(x, (__int128)m, out) ? -1 : 0;
+}
+
+static inline int ratInit(Rational *r, int64_t num, int64_t den)
+{
+    if (den == 0)
+        return -1;
+    r->num = den < 0 ? -(__int128)num : num;
+    r->den = ratAbs(den);
+    return 0;
+}
+
+// num / den in lowest terms
+static inline void ratReduce(__int128 *num, unsigned __int128 *den)
+{
+    unsigned __int128 g = gcd128(ratAbs(*num), *den);
+    if (g > 1)
+    {
+        *num /= (__int128)g;
+        *den /= g;
+    }
+}
+
+static inline void ratNormalize(Rational *r)
+{
+    if (r->num == 0)
+        r->den = 1;
+    ratReduce(&r->num, &r->den);
+}
+
+// a + b with denominators lcm(a.den, b.den), or -1 when it does not fit
+static inline int ratAddLcm(Rational *out, const Rational *a, const Rational *b)
+{
+    unsigned __int128 g = gcd128(a->den, b->den), fa = b->den / g, fb = a->den / g, d;
+    __int128 x, y;
+    if (__builtin_mul_overflow(a->den, fa, &d) || ratScale(a->num, fa, &x) || ratScale(b->num, fb, &y) ||
+        __builtin_add_overflow(x, y, &out->num))
+        return -1;
+    out->den = d;
+    return 0;
+}
+
+static inline int ratAdd(Rational *out, const Rational *a, const Rational *b)
+{
+    Rational x = *a, y = *b;
+    __int128 p, q;
+    unsigned __int128 d;
+    if (x.den == y.den)
+    {
+        if (!__builtin_add_overflow(x.num, y.num, &out->num))
+        {
+            out->den = x.den;
+            return 0;
+        }
+    }
+    else if (!__builtin_mul_overflow(x.den, y.den, &d) && !ratScale(x.num, y.den, &p) && !ratScale(y.num, x.den, &q) &&
+             !__builtin_add_overflow(p, q, &out->num))
+    {
+        out->den = d;
+        return 0;
+    }
+    if (ratAddLcm(out, &x, &y) == 0)
+        return 0;
+    ratNormalize(&x);
+    ratNormalize(&y);
+    return ratAddLcm(out, &x, &y);
+}
+
+static inline int ratSub(Rational *out, const Rational *a, const Rational *b)
+{
+    Rational negated = *b;
+    if (negated.num == -RAT_INT_MAX - 1)
+        return -1;
+    negated.num = -negated.num;
+    return ratAdd(out, a, &negated);
+}
+
+static inline int ratMul(Rational *out, const Rational *a, const Rational *b)
+{
+    Rational x = *a, y = *b;
+    unsigned __int128 g1, g2, d;
+    __int128 n;
+    if (!__builtin_mul_overflow(x.den, y.den, &d) && !__builtin_mul_overflow(x.num, y.num, &n))
+    {
+        out->num = n;
+        out->den = d;
+        return 0;
+    }
+    // cancel across, numerator of each with the denominator of the other
+    g1 = gcd128(ratAbs(x.num), y.den);
+    g2 = gcd128(ratAbs(y.num), x.den);
+    if (g1 > 1)
+    {
+        x.num /= (__int128)g1;
+        y.den /= g1;
+    }
+    if (g2 > 1)
+    {
+        y.num /= (__int128)g2;
+        x.den /= g2;
+    }
+    if (__builtin_mul_overflow(x.den, y.den, &d) || __builtin_mul_overflow(x.num, y.num, &n))
+        return -1;
+    out->num = n;
+    out->den = d;
+    return 0;
+}
+
+static inline int ratDiv(Rational *out, const Rational *a, const Rational *b)
+{
+    Rational inverse;
+    if (b->num == 0 || b->den > (unsigned __int128)RAT_INT_MAX)
+        return -1;
+    inverse.num = b->num < 0 ? -(__int128)b->den : (__int128)b->den;
+    inverse.den = ratAbs(b->num);
+    return ratMul(out, a, &inverse);
+}
+
+static inline double ratToDouble(const Rational *r)
+{
+    Rational x = *r;
+    ratNormalize(&x);
+    return (double)x.num / (double)x.den;
+}
+
+static inline size_t ratU128ToDec(unsigned __int128 x, char *out)
+{
+    char digits[40];
+    size_t n = 0, i;
+    do
+    {
+        digits[n++] = (char)('0' + (int)(x % 10));
+        x /= 10;
+    } while (x != 0);
+    for (i = 0; i < n; i++)
+        out[i] = digits[n - 1 - i];
+    return n;
+}
+
+// "p/q" in lowest terms into out, RAT_TEXT bytes; returns the length
+static inline size_t ratFormat(const Rational *r, char *out)
+{
+    Rational x = *r;
+    size_t n = 0;
+    ratNormalize(&x);
+    if (x.num < 0)
+        out[n++] = '-';
+    n += ratU128ToDec(ratAbs(x.num), out + n);
+    out[n++] = '/';
+    n += ratU128ToDec(x.den, out + n);
+    out[n] = '\0';
+    return n;
+}
+
+// One piece of ratSum(), over a common denominator
+static inline int ratSumBlock(const int64_t *num, const uint64_t *den, size_t n, Rational *out)
+{
+    __int128 acc = 0, next, term;
+    unsigned __int128 l = 1, m = 1, grown; // m = l / last
+    uint64_t last = 1;
+    size_t i = 0;
+    int reduced = 0;
+    while (i < n)
+    {
+        uint64_t q = den[i];
+        unsigned __int128 mq = m;
+        if (q == 0)
+            return -1;
+        grown = l;
+        next = acc;
+        if (q != last)
+        {
+            uint64_t r = l >> 64 == 0 ? (uint64_t)l % q : (uint64_t)(l % q);
+            if (r != 0)
+            {
+                uint64_t f = q / gcd64(r, q); // l becomes lcm(l, q) = l f
+                if (__builtin_mul_overflow(l, (unsigned __int128)f, &grown) || ratScale(acc, f, &next))
+                    goto overflow;
+            }
+            mq = grown >> 64 == 0 ? (uint64_t)grown / q : grown / q;
+        }
+        if (ratScale(num[i], mq, &term) || __builtin_add_overflow(next, term, &next))
+            goto overflow;
+        acc = next;
+        l = grown;
+        m = mq;
+        last = q;
+        reduced = 0;
+        i++;
+        continue;
+    overflow:
+        // the sum so far in lowest terms, and the term again
+        if (reduced)
+            return -1;
+        ratReduce(&acc, &l);
+        last = 0;
+        reduced = 1;
+    }
+    out->num = acc;
+    out->den = l;
+    return 0;
+}
+
+// The sum of num[i] / den[i] for i < n, in lowest terms
+static inline int ratSum(const int64_t *num, const uint64_t *den, size_t n, Rational *out)
+{
+    Rational a, b;
+    size_t half;
+    if (n <= RAT_SUM_BLOCK)
+    {
+        if (ratSumBlock(num, den, n, out) != 0)
+            return -1;
+        ratNormalize(out);
+        return 0;
+    }
+    half = n / 2 / RAT_SUM_BLOCK * RAT_SUM_BLOCK;
+    if (half == 0)
+        half = RAT_SUM_BLOCK;
+    if (ratSum(num, den, half, &a) != 0 || ratSum(num + half, den + half, n - half, &b) != 0 || ratAdd(out, &a, &b) != 0)
+        return -1;
+    ratNormalize(out);
+    return 0;
+}
+
+#endif
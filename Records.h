@@ -0,0 +1,357 @@
+// A store of records by column, for the record programs (Structure.c,
+// StudentMarksPercentage.c, EmployeeGrade.c).
+//
+// An array of struct student { char name[50]; int roll; float marks; }
+// is 60 bytes a record, and a pass over the marks reads all of them to
+// use 4. A RecordStore keeps each field in an array of its own: the names
+// back to back in one arena of text, each ended by a '\0', with the
+// offset of each in nameAt; the rolls; and up to RECORD_MAX_SCORES
+// columns of float scores, the marks in each subject or a salary. The
+// arrays are aligned to RECORD_ALIGN bytes and grow by doubling. A pass
+// over one column reads 4 bytes a record, a cache line every 16.
+//
+// recordTotals() adds the score columns up per record, recordSum() and
+// recordMinMax() go down one column, all loops the compiler vectorizes.
+// recordGrades() puts each value of a column in a bucket: the number of
+// thresholds, in ascending order, it is at least, worked out as a sum of
+// comparisons with no branch, eight values to a vector with AVX2, a block
+// of RECORD_BLOCK at a time, so a grade table is a lookup into that (the
+// compiler left this loop scalar when the thresholds were constants it
+// could see); the buckets are counted into four histograms in turn, so
+// that a run of equal grades does not wait on the one count.
+//
+// recordsRead() loads a text file of records, one a line: a name if
+// RECORD_NAME is given, a roll number if RECORD_ROLL is, then the scores,
+// separated by blanks or commas. A line that does not have them all is
+// skipped and counted in skipped. The functions that allocate return 0,
+// or -1 when out of memory or when a read failed. Built with
+// -DGUARD_ALLOC, a sample of the allocations are checked by GuardAlloc.h.
+// Header-only.
+
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FloatText.h"
+
+#if defined(GUARD_ALLOC)
+#include "GuardAlloc.h"
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define RECORD_MAX_SCORES 8
+#define RECORD_MAX_GRADES 16
+#define RECORD_ALIGN 64
+#define RECORD_BLOCK 256
+#define RECORD_READ_BLOCK (1 << 20)
+
+enum
+{
+    RECORD_NAME = 1,
+    RECORD_ROLL = 2
+};
+
+typedef struct
+{
+    size_t n, cap, skipped;
+    int scores;
+    char *names;
+    size_t namesLen, namesCap;
+    size_t *nameAt;
+    int32_t *roll;
+    float *score[RECORD_MAX_SCORES];
+} RecordStore;
+
+// size bytes aligned, with size rounded up as aligned_alloc() wants
+static inline void *recordAlloc(size_t size)
+{
+    size = (size + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+    return aligned_alloc(RECORD_ALIGN, size ? size : RECORD_ALIGN);
+}
+
+// *p, of used elements of size bytes, in a new block of cap
+static inline int recordGrowArray(void **p, size_t used, size_t cap, size_t size)
+{
+    void *bigger = recordAlloc(cap * size);
+    if (bigger == NULL)
+        return -1;
+    if (used != 0)
+        memcpy(bigger, *p, used * size);
+    free(*p);
+    *p = bigger;
+    return 0;
+}
+
+static inline void recordsFree(RecordStore *s)
+{
+    int k;
+    free(s->names);
+    free(s->nameAt);
+    free(s->roll);
+    for (k = 0; k < RECORD_MAX_SCORES; k++)
+        free(s->score[k]);
+    memset(s, 0, sizeof *s);
+}
+
+static inline int recordsReserve(RecordStore *s, size_t cap)
+{
+    int k;
+    if (cap <= s->cap)
+        return 0;
+    if (cap > SIZE_MAX / sizeof(size_t))
+        return -1;
+    if (recordGrowArray((void **)&s->nameAt, s->n, cap, sizeof *s->nameAt) != 0 ||
+        recordGrowArray((void **)&s->roll, s->n, cap, sizeof *s->roll) != 0)
+        return -1;
+    for (k = 0; k < s->scores; k++)
+        if (recordGrowArray((void **)&s->score[k], s->n, cap, sizeof *s->score[k]) != 0)
+            return -1;
+    s->cap = cap;
+    return 0;
+}
+
+static inline int recordsInit(RecordStore *s, int scores, size_t cap)
+{
+    memset(s, 0, sizeof *s);
+    if (scores < 0 || scores > RECORD_MAX_SCORES)
+        return -1;
+    s->scores = scores;
+    if (recordsReserve(s, cap ? cap : 1) != 0)
+    {
+        recordsFree(s);
+        return -1;
+    }
+    return 0;
+}
+
+// Adds a record: a name of len bytes, a roll number and s->scores scores
+static inline int recordsAppend(RecordStore *s, const char *name, size_t len, int32_t roll, const float *scores)
+{
+    int k;
+    if (s->n == s->cap && recordsReserve(s, s->cap * 2) != 0)
+        return -1;
+    if (s->namesCap - s->namesLen < len + 1)
+    {
+        size_t cap = s->namesCap ? s->namesCap : RECORD_ALIGN;
+        char *bigger;
+        while (cap - s->namesLen < len + 1)
+            cap *= 2;
+        if ((bigger = (char *)realloc(s->names, cap)) == NULL)
+            return -1;
+        s->names = bigger;
+        s->namesCap = cap;
+    }
+    memcpy(s->names + s->namesLen, name, len);
+    s->names[s->namesLen + len] = '\0';
+    s->nameAt[s->n] = s->namesLen;
+    s->namesLen += len + 1;
+    s->roll[s->n] = roll;
+    for (k = 0; k < s->scores; k++)
+        s->score[k][s->n] = scores[k];
+    s->n++;
+    return 0;
+}
+
+static inline const char *recordName(const RecordStore *s, size_t i)
+{
+    return s->names + s->nameAt[i];
+}
+
+// total[i] = the sum of record i's scores, for every record
+static inline void recordTotals(const RecordStore *s, float *total)
+{
+    size_t i;
+    int k;
+    for (i = 0; i < s->n; i++)
+        total[i] = 0;
+    for (k = 0; k < s->scores; k++)
+    {
+        const float *c = s->score[k];
+        for (i = 0; i < s->n; i++)
+            total[i] += c[i];
+    }
+}
+
+// The sum of a column, in double, from RECORD_BLOCK partial sums in float
+// kept eight side by side
+static inline double recordSum(const float *c, size_t n)
+{
+    double sum = 0;
+    size_t i = 0, j, k;
+    for (; i < n; i += k)
+    {
+        float part[8] = {0};
+        k = n - i < RECORD_BLOCK ? n - i : RECORD_BLOCK;
+        for (j = 0; j + 8 <= k; j += 8)
+        {
+            int l;
+            for (l = 0; l < 8; l++)
+                part[l] += c[i + j + l];
+        }
+        for (; j < k; j++)
+            part[0] += c[i + j];
+        for (j = 0; j < 8; j++)
+            sum += part[j];
+    }
+    return sum;
+}
+
+static inline void recordMinMax(const float *c, size_t n, float *min, float *max)
+{
+    float lo = n ? c[0] : 0, hi = lo;
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        lo = c[i] < lo ? c[i] : lo;
+        hi = c[i] > hi ? c[i] : hi;
+    }
+    *min = lo;
+    *max = hi;
+}
+
+// Buckets of the values of c: grade[i], when grade is not NULL, is how
+// many of the t ascending thresholds c[i] is at least, and counts[b] for
+// b <= t how many values landed in bucket b
+static inline void recordGrades(const float *c, size_t n, const float *thresholds, int t, uint8_t *grade,
+                                size_t *counts)
+{
+    uint32_t b[RECORD_BLOCK];
+    size_t hist[4][RECORD_MAX_GRADES + 1] = {{0}}, i, j, k;
+    int g, h;
+    if (t > RECORD_MAX_GRADES)
+        t = RECORD_MAX_GRADES;
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < RECORD_BLOCK ? n - i : RECORD_BLOCK;
+        j = 0;
+#if defined(__AVX2__)
+        // the compares give -1 where true, taken off
+        for (; j + 8 <= k; j += 8)
+        {
+            __m256 x = _mm256_loadu_ps(c + i + j);
+            __m256i v = _mm256_setzero_si256();
+            for (g = 0; g < t; g++)
+                v = _mm256_sub_epi32(v, _mm256_castps_si256(_mm256_cmp_ps(x, _mm256_set1_ps(thresholds[g]), _CMP_GE_OQ)));
+            _mm256_storeu_si256((__m256i *)(b + j), v);
+        }
+#endif
+        for (; j < k; j++)
+        {
+            uint32_t v = 0;
+            for (g = 0; g < t; g++)
+                v += c[i + j] >= thresholds[g];
+            b[j] = v;
+        }
+        for (j = 0; j + 4 <= k; j += 4)
+        {
+            hist[0][b[j]]++;
+            hist[1][b[j + 1]]++;
+            hist[2][b[j + 2]]++;
+            hist[3][b[j + 3]]++;
+        }
+        for (; j < k; j++)
+            hist[0][b[j]]++;
+        if (grade != NULL)
+            for (j = 0; j < k; j++)
+                grade[i + j] = (uint8_t)b[j];
+    }
+    for (g = 0; g <= t; g++)
+        for (counts[g] = 0, h = 0; h < 4; h++)
+            counts[g] += hist[h][g];
+}
+
+// The next field of the line [*p, e), blanks and commas between; -1 at
+// its end
+static inline int recordField(const char **p, const char *e, const char **f, const char **fe)
+{
+    const char *s = *p;
+    while (s < e && (*s == ' ' || *s == '\t' || *s == ',' || *s == '\r'))
+        s++;
+    if (s == e)
+        return -1;
+    *f = s;
+    while (s < e && *s != ' ' && *s != '\t' && *s != ',' && *s != '\r')
+        s++;
+    *fe = s;
+    *p = s;
+    return 0;
+}
+
+// The records of in, one a line, with a name and a roll number as fields
+// says (RECORD_NAME, RECORD_ROLL), appended to s
+static inline int recordsRead(RecordStore *s, FILE *in, int fields)
+{
+    size_t cap = RECORD_READ_BLOCK, len = 0, got;
+    char *buf = (char *)malloc(cap);
+    int eof = 0, rc = buf != NULL ? 0 : -1;
+    while (rc == 0 && !eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, cap - len, in);
+        len += got;
+        if (got == 0)
+        {
+            eof = 1;
+            if (ferror(in))
+                rc = -1;
+        }
+        while (rc == 0 && pos < len)
+        {
+            const char *line = buf + pos, *nl = (const char *)memchr(line, '\n', len - pos), *e, *p, *f, *fe;
+            const char *name = "", *nameEnd = name;
+            double x;
+            float scores[RECORD_MAX_SCORES];
+            int32_t roll = 0;
+            int k, ok = 1;
+            if (nl == NULL && !eof)
+                break;
+            e = nl != NULL ? nl : buf + len;
+            pos = nl != NULL ? (size_t)(nl + 1 - buf) : len;
+            p = line;
+            if (recordField(&p, e, &f, &fe) != 0)
+                continue; // a blank line
+            p = line;
+            if (fields & RECORD_NAME)
+                ok = recordField(&p, e, &name, &nameEnd) == 0;
+            if (ok && (fields & RECORD_ROLL))
+            {
+                ok = recordField(&p, e, &f, &fe) == 0 && parseDouble(f, fe, &x) == 0 && x >= INT32_MIN &&
+                     x <= INT32_MAX && x == (int32_t)x;
+                roll = ok ? (int32_t)x : 0;
+            }
+            for (k = 0; ok && k < s->scores; k++)
+            {
+                ok = recordField(&p, e, &f, &fe) == 0 && parseDouble(f, fe, &x) == 0;
+                scores[k] = (float)x;
+            }
+            if (!ok)
+                s->skipped++;
+            else if (recordsAppend(s, name, (size_t)(nameEnd - name), roll, scores) != 0)
+                rc = -1;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+        if (len == cap)
+        {
+            char *bigger = (char *)realloc(buf, cap * 2);
+            if (bigger == NULL)
+                rc = -1;
+            else
+            {
+                buf = bigger;
+                cap *= 2;
+            }
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+#endif
@@ -1,11 +1,39 @@
 // Sum of natural numbers using recursion
+//
+// Run with --queries C to answer one n per line of stdin until it ends,
+// remembering the last C sums (Memo.h): a number asked before is answered
+// from the cache, and so is every smaller one the recursion went through.
+// Hits and misses go to stderr at the end. Build with -pthread.
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Memo.h"
 int sum(int n);
 
-int main() {
+static MemoCache memo;
+static int memoized; // memo is set up
+
+int main(int argc, char *argv[]) {
   int number, result;
 
+  if (argc == 3 && strcmp(argv[1], "--queries") == 0) {
+    if (memoInit(&memo, strtoull(argv[2], NULL, 10)) != 0) {
+      printf("Out of memory\n");
+      return 1;
+    }
+    memoized = 1;
+    while (scanf("%d", & number) == 1) {
+      if (number < 0)
+        printf("%d is not a positive integer\n", number);
+      else
+        printf("sum = %d\n", sum(number));
+    }
+    memoReport(&memo, stderr);
+    memoFree(&memo);
+    return 0;
+  }
+
   printf("Enter a positive integer: ");
   scanf("%d", & number);
 
@@ -16,8 +44,15 @@ int main() {
 }
 
 int sum(int num) {
+  uint64_t cached;
+  int result;
+  if (memoized && memoGet(&memo, (uint64_t)num, 0, &cached))
+    return (int)cached;
   if (num != 0)
-    return num + sum(num - 1); // sum() function calls itself
+    result = num + sum(num - 1); // sum() function calls itself
   else
-    return num;
+    result = num;
+  if (memoized)
+    memoPut(&memo, (uint64_t)num, 0, (uint64_t)result);
+  return result;
 }
@@ -1,19 +1,62 @@
+// Run with --queries C to answer one number per line of stdin until it
+// ends, remembering the last C factorials (Memo.h): a number asked before
+// is answered from the cache, and one bigger than a cached one only
+// recurses down to it. Hits and misses go to stderr at the end. Build
+// with -pthread.
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Memo.h"
 
-int factorial(int num) {
-  if (num == 1)
-    return 1;
+// 20! is the largest factorial that fits in 64 bits
+#define MAX_FACTORIAL 20
+
+static MemoCache memo;
+static int memoized; // memo is set up
+
+unsigned long long factorial(int num) {
+  uint64_t cached;
+  unsigned long long result;
+  if (memoized && memoGet(&memo, (uint64_t)num, 0, &cached))
+    return cached;
+  if (num <= 1)
+    result = 1;
   else
-    return num * factorial(num - 1);
+    result = num * factorial(num - 1);
+  if (memoized)
+    memoPut(&memo, (uint64_t)num, 0, result);
+  return result;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
   int number;
 
+  if (argc == 3 && strcmp(argv[1], "--queries") == 0) {
+    if (memoInit(&memo, strtoull(argv[2], NULL, 10)) != 0) {
+      printf("Out of memory\n");
+      return 1;
+    }
+    memoized = 1;
+    while (scanf("%d", & number) == 1) {
+      if (number < 0 || number > MAX_FACTORIAL)
+        printf("%d! is not between 0! and %d!\n", number, MAX_FACTORIAL);
+      else
+        printf("%d! is equal to %llu\n", number, factorial(number));
+    }
+    memoReport(&memo, stderr);
+    memoFree(&memo);
+    return 0;
+  }
+
   printf("Type a positive number: ");
   scanf("%d", & number);
 
-  printf("%d! is equal to %d", number, factorial(number));
+  if (number < 0 || number > MAX_FACTORIAL) {
+    printf("%d! is not between 0! and %d!; Factorial.c --mod N P takes any N", number, MAX_FACTORIAL);
+    return 1;
+  }
+  printf("%d! is equal to %llu", number, factorial(number));
 
   return 0;
 }
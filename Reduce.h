@@ -0,0 +1,274 @@
+// Min, max, argmax and minmax over arrays of numbers, for Largest.c.
+//
+// REDUCE_DEFINE(suffix, type, LOWEST, HIGHEST) writes, for one element
+// type:
+//
+//   type reduce_max_<suffix>(TaskPool *pool, const type *a, size_t n)
+//   type reduce_min_<suffix>(TaskPool *pool, const type *a, size_t n)
+//       LOWEST / HIGHEST when there is nothing to compare
+//   size_t reduce_argmax_<suffix>(TaskPool *pool, const type *a, size_t n)
+//       the first position of the maximum, or n
+//   void reduce_minmax_<suffix>(TaskPool *pool, const type *a, size_t n,
+//                               type *min, type *max)
+//
+// The inner loops keep REDUCE_LANES running results side by side, one per
+// element of a block, with no dependency from one element to the next and
+// no branch, so the compiler turns them into vector max/min instructions
+// (-O2 uses SSE2; build with -march=native for AVX2 or AVX-512). argmax
+// takes the maximum of a block of REDUCE_BLOCK elements that way and only
+// looks for its position when it beats the best so far, which after the
+// first blocks is rare.
+//
+// Arrays of at least REDUCE_PARALLEL elements are cut into pieces that
+// the workers of pool (TaskPool.h, the pool SumUsingThreads.c uses) reduce
+// in parallel, each into its own cache line; pool may be NULL to stay on
+// the calling thread. NaNs are skipped. Ready-made: i32, i64, f32, f64.
+// Header-only; build with -pthread.
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "TaskPool.h"
+
+#define REDUCE_LANES 16
+#define REDUCE_BLOCK 4096
+#define REDUCE_PARALLEL (1 << 20)
+#define REDUCE_LINE 64
+
+// what a worker's piece comes to; one cache line per worker
+#define REDUCE_PARTIAL(type)                                                   \
+    struct                                                                     \
+    {                                                                          \
+        _Alignas(REDUCE_LINE) type min, max;                                   \
+        size_t pos; /* of max, for argmax */                                   \
+        int seen;                                                              \
+    }
+
+#define REDUCE_DEFINE(suffix, type, LOWEST, HIGHEST)                           \
+                                                                               \
+typedef REDUCE_PARTIAL(type) ReducePartial_##suffix;                           \
+                                                                               \
+typedef struct                                                                 \
+{                                                                              \
+    const type *a;                                                             \
+    ReducePartial_##suffix *partials;                                          \
+} ReduceJob_##suffix;                                                          \
+                                                                               \
+static inline type reduce_block_max_##suffix(const type *a, size_t n)          \
+{                                                                              \
+    type acc[REDUCE_LANES], m = LOWEST;                                        \
+    size_t i, j;                                                               \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+        acc[j] = LOWEST;                                                       \
+    for (i = 0; i + REDUCE_LANES <= n; i += REDUCE_LANES)                      \
+        for (j = 0; j < REDUCE_LANES; j++)                                     \
+            acc[j] = a[i + j] > acc[j] ? a[i + j] : acc[j];                    \
+    for (; i < n; i++)                                                         \
+        m = a[i] > m ? a[i] : m;                                               \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+        m = acc[j] > m ? acc[j] : m;                                           \
+    return m;                                                                  \
+}                                                                              \
+                                                                               \
+static inline type reduce_block_min_##suffix(const type *a, size_t n)          \
+{                                                                              \
+    type acc[REDUCE_LANES], m = HIGHEST;                                       \
+    size_t i, j;                                                               \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+        acc[j] = HIGHEST;                                                      \
+    for (i = 0; i + REDUCE_LANES <= n; i += REDUCE_LANES)                      \
+        for (j = 0; j < REDUCE_LANES; j++)                                     \
+            acc[j] = a[i + j] < acc[j] ? a[i + j] : acc[j];                    \
+    for (; i < n; i++)                                                         \
+        m = a[i] < m ? a[i] : m;                                               \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+        m = acc[j] < m ? acc[j] : m;                                           \
+    return m;                                                                  \
+}                                                                              \
+                                                                               \
+static inline void reduce_block_minmax_##suffix(const type *a, size_t n,       \
+                                                type *min, type *max)          \
+{                                                                              \
+    type lo[REDUCE_LANES], hi[REDUCE_LANES], mn = HIGHEST, mx = LOWEST;        \
+    size_t i, j;                                                               \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+    {                                                                          \
+        lo[j] = HIGHEST;                                                       \
+        hi[j] = LOWEST;                                                        \
+    }                                                                          \
+    for (i = 0; i + REDUCE_LANES <= n; i += REDUCE_LANES)                      \
+        for (j = 0; j < REDUCE_LANES; j++)                                     \
+        {                                                                      \
+            lo[j] = a[i + j] < lo[j] ? a[i + j] : lo[j];                       \
+            hi[j] = a[i + j] > hi[j] ? a[i + j] : hi[j];                       \
+        }                                                                      \
+    for (; i < n; i++)                                                         \
+    {                                                                          \
+        mn = a[i] < mn ? a[i] : mn;                                            \
+        mx = a[i] > mx ? a[i] : mx;                                            \
+    }                                                                          \
+    for (j = 0; j < REDUCE_LANES; j++)                                         \
+    {                                                                          \
+        mn = lo[j] < mn ? lo[j] : mn;                                          \
+        mx = hi[j] > mx ? hi[j] : mx;                                          \
+    }                                                                          \
+    *min = mn;                                                                 \
+    *max = mx;                                                                 \
+}                                                                              \
+                                                                               \
+/* a[begin .. end) into p: min and max, and the first position of max */       \
+static inline void reduce_range_##suffix(const type *a, size_t begin,          \
+                                         size_t end, int argmax,               \
+                                         ReducePartial_##suffix *p)            \
+{                                                                              \
+    size_t b, i;                                                               \
+    p->seen = 0;                                                               \
+    p->pos = end;                                                              \
+    if (!argmax)                                                               \
+    {                                                                          \
+        reduce_block_minmax_##suffix(a + begin, end - begin, &p->min,          \
+                                     &p->max);                                 \
+        p->seen = 1;                                                           \
+        return;                                                                \
+    }                                                                          \
+    p->min = HIGHEST; /* not wanted; set so merging it is harmless */          \
+    p->max = LOWEST;                                                           \
+    for (b = begin; b < end; b += REDUCE_BLOCK)                                \
+    {                                                                          \
+        size_t e = end - b < REDUCE_BLOCK ? end : b + REDUCE_BLOCK;            \
+        type m = reduce_block_max_##suffix(a + b, e - b);                      \
+        if (p->seen && !(m > p->max))                                          \
+            continue;                                                          \
+        /* the block's maximum, unless it is all NaNs */                       \
+        for (i = b; i < e; i++)                                                \
+            if (a[i] == m)                                                     \
+            {                                                                  \
+                p->max = m;                                                    \
+                p->pos = i;                                                    \
+                p->seen = 1;                                                   \
+                break;                                                         \
+            }                                                                  \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline void reduce_piece_##suffix(size_t begin, size_t end,             \
+                                         void *arg, int argmax)                \
+{                                                                              \
+    ReduceJob_##suffix *job = (ReduceJob_##suffix *)arg;                       \
+    ReducePartial_##suffix *mine = &job->partials[poolWorkerId()], p;          \
+    reduce_range_##suffix(job->a, begin, end, argmax, &p);                     \
+    if (!p.seen)                                                               \
+        return;                                                                \
+    if (!mine->seen)                                                           \
+    {                                                                          \
+        *mine = p;                                                             \
+        return;                                                                \
+    }                                                                          \
+    mine->min = p.min < mine->min ? p.min : mine->min;                         \
+    /* pieces reach a worker in any order: ties go to the earlier one */       \
+    if (p.max > mine->max || (p.max == mine->max && p.pos < mine->pos))        \
+    {                                                                          \
+        mine->max = p.max;                                                     \
+        mine->pos = p.pos;                                                     \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline void reduce_piece_minmax_##suffix(size_t begin, size_t end,      \
+                                                void *arg)                     \
+{                                                                              \
+    reduce_piece_##suffix(begin, end, arg, 0);                                 \
+}                                                                              \
+                                                                               \
+static inline void reduce_piece_argmax_##suffix(size_t begin, size_t end,      \
+                                                void *arg)                     \
+{                                                                              \
+    reduce_piece_##suffix(begin, end, arg, 1);                                 \
+}                                                                              \
+                                                                               \
+/* the whole array into *out, on pool's workers when it is big */              \
+static inline void reduce_all_##suffix(TaskPool *pool, const type *a,          \
+                                       size_t n, int argmax,                   \
+                                       ReducePartial_##suffix *out)            \
+{                                                                              \
+    ReducePartial_##suffix *partials;                                          \
+    ReduceJob_##suffix job;                                                    \
+    int t, nthreads = pool != NULL ? pool->nthreads : 1;                       \
+                                                                               \
+    if (pool == NULL || nthreads < 2 || n < REDUCE_PARALLEL ||                 \
+        (partials = (ReducePartial_##suffix *)aligned_alloc(                   \
+             REDUCE_LINE, nthreads * sizeof *partials)) == NULL)               \
+    {                                                                          \
+        reduce_range_##suffix(a, 0, n, argmax, out);                           \
+        return;                                                                \
+    }                                                                          \
+    for (t = 0; t < nthreads; t++)                                             \
+        partials[t].seen = 0;                                                  \
+    job.a = a;                                                                 \
+    job.partials = partials;                                                   \
+    /* a few pieces per worker, so stealing can even out the load */           \
+    poolParallelFor(pool, 0, n, n / (nthreads * 8) + 1,                        \
+                    argmax ? reduce_piece_argmax_##suffix                      \
+                           : reduce_piece_minmax_##suffix,                     \
+                    &job);                                                     \
+    out->seen = 0;                                                             \
+    out->pos = n;                                                              \
+    for (t = 0; t < nthreads; t++)                                             \
+    {                                                                          \
+        ReducePartial_##suffix *p = &partials[t];                              \
+        if (!p->seen)                                                          \
+            continue;                                                          \
+        if (!out->seen)                                                        \
+            *out = *p;                                                         \
+        out->min = p->min < out->min ? p->min : out->min;                      \
+        if (p->max > out->max || (p->max == out->max && p->pos < out->pos))    \
+        {                                                                      \
+            out->max = p->max;                                                 \
+            out->pos = p->pos;                                                 \
+        }                                                                      \
+    }                                                                          \
+    free(partials);                                                            \
+}                                                                              \
+                                                                               \
+static inline void reduce_minmax_##suffix(TaskPool *pool, const type *a,       \
+                                          size_t n, type *min, type *max)      \
+{                                                                              \
+    ReducePartial_##suffix r;                                                  \
+    reduce_all_##suffix(pool, a, n, 0, &r);                                    \
+    *min = r.seen ? r.min : HIGHEST;                                           \
+    *max = r.seen ? r.max : LOWEST;                                            \
+}                                                                              \
+                                                                               \
+static inline type reduce_max_##suffix(TaskPool *pool, const type *a,          \
+                                       size_t n)                               \
+{                                                                              \
+    type min, max;                                                             \
+    reduce_minmax_##suffix(pool, a, n, &min, &max);                            \
+    return max;                                                                \
+}                                                                              \
+                                                                               \
+static inline type reduce_min_##suffix(TaskPool *pool, const type *a,          \
+                                       size_t n)                               \
+{                                                                              \
+    type min, max;                                                             \
+    reduce_minmax_##suffix(pool, a, n, &min, &max);                            \
+    return min;                                                                \
+}                                                                              \
+                                                                               \
+static inline size_t reduce_argmax_##suffix(TaskPool *pool, const type *a,     \
+                                            size_t n)                          \
+{                                                                              \
+    ReducePartial_##suffix r;                                                  \
+    reduce_all_##suffix(pool, a, n, 1, &r);                                    \
+    return r.seen ? r.pos : n;                                                 \
+}
+
+REDUCE_DEFINE(i32, int32_t, INT32_MIN, INT32_MAX)
+REDUCE_DEFINE(i64, int64_t, INT64_MIN, INT64_MAX)
+REDUCE_DEFINE(f32, float, -INFINITY, INFINITY)
+REDUCE_DEFINE(f64, double, -INFINITY, INFINITY)
+
+#endif
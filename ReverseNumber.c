@@ -1,11 +1,25 @@
 //program to find reverse of a number
+//  ReverseNumber                  asks for a number
+//  ReverseNumber --range LO HI    "n reverse" for every n in [LO, HI], the digits
+//                                 moved from n to n + 1 rather than divided out again
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Digits.h"
 
-int main()
+int main(int argc, char **argv)
 {
    int n, reverse = 0;
 
+   if (argc == 4 && strcmp(argv[1], "--range") == 0)
+   {
+      OutBuffer out;
+      if (outInit(&out, stdout, 0) != 0)
+         return 1;
+      digitWriteReverses(&out, strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10));
+      return outClose(&out) != 0;
+   }
    printf("Enter a number to reverse\n");
    scanf("%d", &n);
 
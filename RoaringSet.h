@@ -0,0 +1,539 @@
+// A compressed set of 32-bit unsigned numbers for dense sets, in the style
+// of Roaring bitmaps, for CommonElementsInTwoArrays.c.
+//
+// The numbers are split by their top 16 bits into chunks of 65536. Each
+// chunk that has any numbers gets a container for the low 16 bits, in one
+// of three forms:
+//
+//     array   the sorted low halves, 2 bytes each; for up to 4096 numbers
+//     bitmap  65536 bits in 1024 words, 8 KB whatever the count
+//     run     sorted ranges first .. last, 4 bytes each; for long
+//             stretches of consecutive numbers
+//
+// roaringFromSorted() picks the smallest form for each chunk. AND, OR and
+// ANDNOT go chunk by chunk: two bitmaps are combined a 64-bit word at a
+// time and counted with popcount, an array against a bitmap tests one bit
+// per number, two arrays or two run lists are merged. A result of up to
+// 4096 numbers becomes an array again. A set of 10M numbers in a range of
+// 40M is about 600 bitmaps, and ANDing two of them reads 10 MB; two runs
+// of 10M consecutive numbers are one range per chunk.
+//
+//     RoaringSet a, b, both;
+//     roaringFromSorted(&a, values, n);    // increasing, no repeats
+//     ...
+//     if (roaringAnd(&both, &a, &b) == 0)
+//         count = roaringCardinality(&both);
+//
+// Functions that allocate return 0, or -1 when out of memory. The word
+// loops, the count and the decoding of a bitmap are the kernels of
+// Bitset.h; build with -march=native (or -mavx2) for their AVX2 forms.
+// Header-only.
+
+#ifndef ROARING_SET_H
+#define ROARING_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Bitset.h"
+
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_WORDS 1024
+
+enum { ROARING_ARRAY, ROARING_BITMAP, ROARING_RUN };
+
+typedef struct
+{
+    int type;
+    uint32_t card; // how many numbers
+    uint32_t n;    // array: card; run: number of ranges; bitmap: unused
+    void *data;    // uint16_t[n], uint64_t[ROARING_WORDS], uint16_t[2n]
+} RoaringContainer;
+
+typedef struct
+{
+    uint16_t *keys; // the top halves, increasing
+    RoaringContainer *containers;
+    size_t n, capacity;
+} RoaringSet;
+
+static inline void roaringInit(RoaringSet *s)
+{
+    s->keys = NULL;
+    s->containers = NULL;
+    s->n = s->capacity = 0;
+}
+
+static inline void roaringFree(RoaringSet *s)
+{
+    size_t i;
+    for (i = 0; i < s->n; i++)
+        free(s->containers[i].data);
+    free(s->keys);
+    free(s->containers);
+    roaringInit(s);
+}
+
+static inline uint64_t roaringCardinality(const RoaringSet *s)
+{
+    uint64_t total = 0;
+    size_t i;
+    for (i = 0; i < s->n; i++)
+        total += s->containers[i].card;
+    return total;
+}
+
+// Takes over c, which the set frees from now on; a container with no
+// numbers is freed and left out
+static inline int roaringAppend(RoaringSet *s, uint16_t key, RoaringContainer c)
+{
+    if (c.card == 0)
+    {
+        free(c.data);
+        return 0;
+    }
+    if (s->n == s->capacity)
+    {
+        size_t capacity = s->capacity ? 2 * s->capacity : 16;
+        uint16_t *keys = (uint16_t *)realloc(s->keys, capacity * sizeof(uint16_t));
+        RoaringContainer *containers;
+        if (keys == NULL)
+        {
+            free(c.data);
+            return -1;
+        }
+        s->keys = keys;
+        containers = (RoaringContainer *)realloc(s->containers, capacity * sizeof(RoaringContainer));
+        if (containers == NULL)
+        {
+            free(c.data);
+            return -1;
+        }
+        s->containers = containers;
+        s->capacity = capacity;
+    }
+    s->keys[s->n] = key;
+    s->containers[s->n++] = c;
+    return 0;
+}
+
+// The bits of any container: a bitmap's own words, or the others filled in
+// to words
+static inline const uint64_t *roaringBits(const RoaringContainer *c, uint64_t *words)
+{
+    const uint16_t *runs = (const uint16_t *)c->data;
+    uint32_t r;
+    if (c->type == ROARING_BITMAP)
+        return (const uint64_t *)c->data;
+    memset(words, 0, ROARING_WORDS * sizeof(uint64_t));
+    if (c->type == ROARING_ARRAY)
+    {
+        for (r = 0; r < c->n; r++)
+            words[runs[r] >> 6] |= 1ULL << (runs[r] & 63);
+        return words;
+    }
+    for (r = 0; r < c->n; r++)
+    {
+        uint32_t first = runs[2 * r], last = runs[2 * r + 1];
+        uint32_t fw = first >> 6, lw = last >> 6;
+        uint64_t head = ~0ULL << (first & 63), tail = ~0ULL >> (63 - (last & 63));
+        if (fw == lw)
+            words[fw] |= head & tail;
+        else
+        {
+            words[fw] |= head;
+            for (fw++; fw < lw; fw++)
+                words[fw] = ~0ULL;
+            words[lw] |= tail;
+        }
+    }
+    return words;
+}
+
+static inline int roaringHasBit(const uint64_t *words, uint16_t x)
+{
+    return (int)(words[x >> 6] >> (x & 63)) & 1;
+}
+
+// A container for card numbers whose bits are in words: an array if they
+// are few, otherwise a copy of the words
+static inline int roaringFromBits(const uint64_t *words, uint32_t card, RoaringContainer *out)
+{
+    out->card = card;
+    if (card > ROARING_ARRAY_MAX)
+    {
+        out->type = ROARING_BITMAP;
+        out->n = 0;
+        out->data = malloc(ROARING_WORDS * sizeof(uint64_t));
+        if (out->data == NULL)
+            return -1;
+        memcpy(out->data, words, ROARING_WORDS * sizeof(uint64_t));
+    }
+    else
+    {
+        uint16_t *low = (uint16_t *)malloc((card ? card : 1) * sizeof(uint16_t));
+        uint32_t w, k = 0;
+        out->type = ROARING_ARRAY;
+        out->n = card;
+        out->data = low;
+        if (low == NULL)
+            return -1;
+        for (w = 0; w < ROARING_WORDS; w++)
+        {
+            uint64_t bits;
+            for (bits = words[w]; bits; bits &= bits - 1)
+                low[k++] = (uint16_t)(w * 64 + bitCtz(bits));
+        }
+    }
+    return 0;
+}
+
+static inline int roaringCopyContainer(const RoaringContainer *c, RoaringContainer *out)
+{
+    size_t bytes = c->type == ROARING_BITMAP ? ROARING_WORDS * sizeof(uint64_t)
+                 : c->type == ROARING_RUN ? 2 * c->n * sizeof(uint16_t)
+                 : c->n * sizeof(uint16_t);
+    *out = *c;
+    out->data = malloc(bytes ? bytes : 1);
+    if (out->data == NULL)
+        return -1;
+    memcpy(out->data, c->data, bytes);
+    return 0;
+}
+
+// Builds a set from values, which must be increasing
+static inline int roaringFromSorted(RoaringSet *s, const uint32_t *values, size_t n)
+{
+    size_t i = 0, j, k;
+    roaringInit(s);
+    for (; i < n; i = j)
+    {
+        uint16_t key = (uint16_t)(values[i] >> 16);
+        uint32_t card, runs = 1;
+        size_t arrayBytes, runBytes;
+        RoaringContainer c;
+        for (j = i + 1; j < n && (uint16_t)(values[j] >> 16) == key; j++)
+            runs += values[j] != values[j - 1] + 1;
+        card = (uint32_t)(j - i);
+        arrayBytes = card <= ROARING_ARRAY_MAX ? 2 * card : ROARING_WORDS * sizeof(uint64_t);
+        runBytes = 4 * (size_t)runs;
+        c.card = card;
+        if (runBytes < arrayBytes)
+        {
+            uint16_t *r = (uint16_t *)malloc(runBytes);
+            c.type = ROARING_RUN;
+            c.n = 0;
+            c.data = r;
+            if (r == NULL)
+                goto fail;
+            for (k = i; k < j; k++)
+            {
+                if (k == i || values[k] != values[k - 1] + 1)
+                    r[2 * c.n++] = (uint16_t)values[k];
+                r[2 * c.n - 1] = (uint16_t)values[k];
+            }
+        }
+        else if (card <= ROARING_ARRAY_MAX)
+        {
+            uint16_t *low = (uint16_t *)malloc(arrayBytes);
+            c.type = ROARING_ARRAY;
+            c.n = card;
+            c.data = low;
+            if (low == NULL)
+                goto fail;
+            for (k = i; k < j; k++)
+                low[k - i] = (uint16_t)values[k];
+        }
+        else
+        {
+            uint64_t *words = (uint64_t *)calloc(ROARING_WORDS, sizeof(uint64_t));
+            c.type = ROARING_BITMAP;
+            c.n = 0;
+            c.data = words;
+            if (words == NULL)
+                goto fail;
+            for (k = i; k < j; k++)
+                words[(values[k] >> 6) & (ROARING_WORDS - 1)] |= 1ULL << (values[k] & 63);
+        }
+        if (roaringAppend(s, key, c) != 0)
+            goto fail;
+    }
+    return 0;
+fail:
+    roaringFree(s);
+    return -1;
+}
+
+// Writes the numbers in increasing order to out, which has room for
+// roaringCardinality(s) of them; returns how many
+static inline size_t roaringToArray(const RoaringSet *s, uint32_t *out)
+{
+    size_t i, k = 0;
+    uint32_t j, v;
+    for (i = 0; i < s->n; i++)
+    {
+        const RoaringContainer *c = &s->containers[i];
+        uint32_t high = (uint32_t)s->keys[i] << 16;
+        const uint16_t *low = (const uint16_t *)c->data;
+        if (c->type == ROARING_ARRAY)
+            for (j = 0; j < c->n; j++)
+                out[k++] = high | low[j];
+        else if (c->type == ROARING_RUN)
+            for (j = 0; j < c->n; j++)
+                for (v = low[2 * j]; v <= low[2 * j + 1]; v++)
+                    out[k++] = high | v;
+        else
+            k += bitsetToIndexes((const uint64_t *)c->data, ROARING_WORDS, high, out + k);
+    }
+    return k;
+}
+
+static inline int roaringContains(const RoaringSet *s, uint32_t x)
+{
+    uint16_t key = (uint16_t)(x >> 16), low = (uint16_t)x;
+    size_t lo = 0, hi = s->n;
+    const RoaringContainer *c;
+    const uint16_t *v;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == s->n || s->keys[lo] != key)
+        return 0;
+    c = &s->containers[lo];
+    v = (const uint16_t *)c->data;
+    if (c->type == ROARING_BITMAP)
+        return roaringHasBit((const uint64_t *)c->data, low);
+    // the first array entry (or run end) >= low
+    lo = 0;
+    hi = c->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((c->type == ROARING_RUN ? v[2 * mid + 1] : v[mid]) < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == c->n)
+        return 0;
+    return c->type == ROARING_RUN ? v[2 * lo] <= low : v[lo] == low;
+}
+
+enum { ROARING_AND, ROARING_OR, ROARING_ANDNOT };
+
+// The ranges of two run containers combined: AND keeps where both have
+// a range, OR where either has one
+static inline int roaringRuns(const RoaringContainer *a, const RoaringContainer *b, int op,
+                              RoaringContainer *out)
+{
+    const uint16_t *ra = (const uint16_t *)a->data, *rb = (const uint16_t *)b->data;
+    uint16_t *r = (uint16_t *)malloc(2 * (a->n + b->n) * sizeof(uint16_t));
+    uint32_t i = 0, j = 0, n = 0;
+    out->type = ROARING_RUN;
+    out->card = 0;
+    out->data = r;
+    if (r == NULL)
+        return -1;
+    if (op == ROARING_AND)
+    {
+        while (i < a->n && j < b->n)
+        {
+            uint32_t first = ra[2 * i] > rb[2 * j] ? ra[2 * i] : rb[2 * j];
+            uint32_t last = ra[2 * i + 1] < rb[2 * j + 1] ? ra[2 * i + 1] : rb[2 * j + 1];
+            if (first <= last)
+            {
+                r[2 * n] = (uint16_t)first;
+                r[2 * n++ + 1] = (uint16_t)last;
+                out->card += last - first + 1;
+            }
+            // drop whichever range ends first
+            if (ra[2 * i + 1] < rb[2 * j + 1])
+                i++;
+            else
+                j++;
+        }
+    }
+    else
+    {
+        while (i < a->n || j < b->n)
+        {
+            const uint16_t *next = j == b->n || (i < a->n && ra[2 * i] <= rb[2 * j])
+                                 ? &ra[2 * i++] : &rb[2 * j++];
+            // join a range that touches or overlaps the previous one
+            if (n > 0 && (uint32_t)next[0] <= (uint32_t)r[2 * n - 1] + 1)
+            {
+                if (next[1] > r[2 * n - 1])
+                    r[2 * n - 1] = next[1];
+            }
+            else
+            {
+                r[2 * n] = next[0];
+                r[2 * n++ + 1] = next[1];
+            }
+        }
+        for (i = 0; i < n; i++)
+            out->card += (uint32_t)r[2 * i + 1] - r[2 * i] + 1;
+    }
+    out->n = n;
+    return 0;
+}
+
+static inline int roaringCombine(const RoaringContainer *a, const RoaringContainer *b, int op,
+                                 RoaringContainer *out)
+{
+    uint64_t spareA[ROARING_WORDS], spareB[ROARING_WORDS], result[ROARING_WORDS];
+    const uint64_t *wa, *wb;
+    uint64_t *words;
+    uint32_t i, j, card = 0;
+
+    if (a->type == ROARING_RUN && b->type == ROARING_RUN && op != ROARING_ANDNOT)
+        return roaringRuns(a, b, op, out);
+    if (a->type == ROARING_ARRAY && (op != ROARING_OR || b->type == ROARING_ARRAY))
+    {
+        // the result is part of a (or, for OR, a merge of two arrays)
+        const uint16_t *va = (const uint16_t *)a->data, *vb = (const uint16_t *)b->data;
+        uint16_t *low = (uint16_t *)malloc((a->n + (op == ROARING_OR ? b->n : 0) + 1) * sizeof(uint16_t));
+        out->type = ROARING_ARRAY;
+        out->data = low;
+        if (low == NULL)
+            return -1;
+        if (b->type == ROARING_ARRAY)
+        {
+            for (i = j = 0; i < a->n || (op == ROARING_OR && j < b->n);)
+            {
+                if (j == b->n || (i < a->n && va[i] < vb[j]))
+                {
+                    if (op != ROARING_AND)
+                        low[card++] = va[i];
+                    i++;
+                }
+                else if (i == a->n || vb[j] < va[i])
+                {
+                    if (op == ROARING_OR)
+                        low[card++] = vb[j];
+                    j++;
+                }
+                else
+                {
+                    if (op != ROARING_ANDNOT)
+                        low[card++] = va[i];
+                    i++;
+                    j++;
+                }
+            }
+            if (card > ROARING_ARRAY_MAX)
+            {
+                // an OR that outgrew the array form
+                memset(result, 0, sizeof result);
+                for (i = 0; i < card; i++)
+                    result[low[i] >> 6] |= 1ULL << (low[i] & 63);
+                free(low);
+                return roaringFromBits(result, card, out);
+            }
+        }
+        else
+        {
+            wb = roaringBits(b, spareB);
+            for (i = 0; i < a->n; i++)
+                if (roaringHasBit(wb, va[i]) == (op == ROARING_AND))
+                    low[card++] = va[i];
+        }
+        out->card = out->n = card;
+        return 0;
+    }
+    if (op == ROARING_AND && b->type == ROARING_ARRAY)
+        return roaringCombine(b, a, op, out);
+    // at least one bitmap or run that is not just filtered: whole words
+    // into a new bitmap, which is kept unless the result is small
+    words = (uint64_t *)malloc(ROARING_WORDS * sizeof(uint64_t));
+    if (words == NULL)
+        return -1;
+    wa = roaringBits(a, spareA);
+    wb = roaringBits(b, spareB);
+    if (op == ROARING_AND)
+        bitsetAndWords(words, wa, wb, ROARING_WORDS);
+    else if (op == ROARING_OR)
+        bitsetOrWords(words, wa, wb, ROARING_WORDS);
+    else
+        bitsetAndNotWords(words, wa, wb, ROARING_WORDS);
+    card = (uint32_t)bitsetCountWords(words, ROARING_WORDS);
+    if (card > ROARING_ARRAY_MAX)
+    {
+        out->type = ROARING_BITMAP;
+        out->card = card;
+        out->n = 0;
+        out->data = words;
+        return 0;
+    }
+    i = (uint32_t)roaringFromBits(words, card, out);
+    free(words);
+    return (int)i;
+}
+
+static inline int roaringOp(RoaringSet *out, const RoaringSet *a, const RoaringSet *b, int op)
+{
+    size_t i = 0, j = 0;
+    roaringInit(out);
+    while (i < a->n || (op == ROARING_OR && j < b->n))
+    {
+        RoaringContainer c;
+        uint16_t key;
+        int rc = 0;
+        if (j == b->n || (i < a->n && a->keys[i] < b->keys[j]))
+        {
+            // only in a
+            key = a->keys[i];
+            if (op == ROARING_AND)
+                c.card = 0, c.data = NULL;
+            else
+                rc = roaringCopyContainer(&a->containers[i], &c);
+            i++;
+        }
+        else if (i == a->n || b->keys[j] < a->keys[i])
+        {
+            // only in b
+            key = b->keys[j];
+            if (op == ROARING_OR)
+                rc = roaringCopyContainer(&b->containers[j], &c);
+            else
+                c.card = 0, c.data = NULL;
+            j++;
+        }
+        else
+        {
+            key = a->keys[i];
+            rc = roaringCombine(&a->containers[i++], &b->containers[j++], op, &c);
+        }
+        if (rc != 0 || roaringAppend(out, key, c) != 0)
+        {
+            if (rc != 0)
+                free(c.data);
+            roaringFree(out);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline int roaringAnd(RoaringSet *out, const RoaringSet *a, const RoaringSet *b)
+{
+    return roaringOp(out, a, b, ROARING_AND);
+}
+
+static inline int roaringOr(RoaringSet *out, const RoaringSet *a, const RoaringSet *b)
+{
+    return roaringOp(out, a, b, ROARING_OR);
+}
+
+static inline int roaringAndNot(RoaringSet *out, const RoaringSet *a, const RoaringSet *b)
+{
+    return roaringOp(out, a, b, ROARING_ANDNOT);
+}
+
+#endif
@@ -1,36 +1,194 @@
-/*Russian peasant multiplication is an interesting way to multiply 
+/*Russian peasant multiplication is an interesting way to multiply
 numbers that uses a process of halving and doubling. Like standard
  multiplication and division*/
 
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "BigNum.h"
 
-int main()
+/*The numbers are BigNums (BigNum.h), so they can have any number of
+digits and the product never overflows the way a long long did. The
+halving and doubling is kept as the demonstration; bigMul() checks it.
+
+Run with --bench [MAX] to time bigMul() on two random numbers of 16 up to
+MAX limbs (9 digits each, 65536 by default) with each algorithm on top:
+schoolbook, Karatsuba, Toom-3 and the NTT, the ones before it in that
+list still in use below their default thresholds. The fastest for each
+size shows where the thresholds in BigNum.h should be on this machine.*/
+
+#define MAX_DIGITS 100000
+
+// sum = a * b by halving a and doubling b
+int peasant(const BigNum *x, const BigNum *y, BigNum *sum)
+{
+	BigNum a, b;
+	int rc=0;
+	bigInit(&a);
+	bigInit(&b);
+	rc|=bigCopy(&a, x);
+	rc|=bigCopy(&b, y);
+	rc|=bigSetU64(sum, 0);
+	// the base is even, so a is odd when its lowest limb is
+	while(rc==0 && a.len>0)
+	{
+		if(a.limb[0]%2==1){
+			rc|=bigAdd(sum, sum, &b);
+		}
+			bigDivSmall(&a, 2);
+			rc|=bigAdd(&b, &b, &b);
+	}
+	bigFree(&a);
+	bigFree(&b);
+	return rc;
+}
+
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the best of enough runs to fill 50 ms
+double mulTime(const BigNum *a, const BigNum *b, BigNum *c, BigThresholds t)
+{
+	BigThresholds saved=bigThresholds;
+	double best=1e30, start=now(), t0, t1;
+	bigThresholds=t;
+	do
+	{
+		t0=now();
+		if(bigMul(c, a, b)!=0)
+		{
+			bigThresholds=saved;
+			return -1;
+		}
+		t1=now();
+		if(t1-t0<best)
+			best=t1-t0;
+	} while(t1-start<0.05);
+	bigThresholds=saved;
+	return best;
+}
+
+int bench(size_t max)
 {
+	const char *name[4]={"schoolbook", "Karatsuba", "Toom-3", "NTT"};
+	BigThresholds d=bigThresholds, never={(size_t)-1, (size_t)-1, (size_t)-1};
+	BigNum a, b, c, check;
+	uint64_t seed=88172645463325252ULL;
+	size_t n, i;
+	int k;
+	bigInit(&a);
+	bigInit(&b);
+	bigInit(&c);
+	bigInit(&check);
+	if(bigReserve(&a, max)!=0 || bigReserve(&b, max)!=0)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+	printf("defaults: Karatsuba from %zu limbs, Toom-3 from %zu, NTT from %zu\n", d.karatsuba, d.toom3, d.ntt);
+	printf("%8s %12s %12s %12s %12s   fastest\n", "limbs", name[0], name[1], name[2], name[3]);
+	// sizes 16, 24, 32, 48, ..., a power of two and 1.5 times it
+	for(n=16; n<=max; n=n%3==0 ? n/3*4 : n/2*3)
+	{
+		BigThresholds t[4];
+		double time[4];
+		int best=-1, checked=0;
+		// each one on top, the ones after it switched off and the ones
+		// before it at their defaults, but no higher than n
+		t[0]=never;
+		t[1]=never;
+		t[1].karatsuba=d.karatsuba<n ? d.karatsuba : n;
+		t[2]=t[1];
+		t[2].toom3=d.toom3<n ? d.toom3 : n;
+		t[3]=t[2];
+		t[3].ntt=1;
+		for(i=0; i<n; i++)
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			a.limb[i]=(uint32_t)(seed%BIG_BASE);
+			b.limb[i]=(uint32_t)((seed>>32)%BIG_BASE);
+		}
+		a.limb[n-1]=b.limb[n-1]=1;
+		a.len=b.len=n;
+		printf("%8zu", n);
+		for(k=0; k<4; k++)
+		{
+			// schoolbook gets slow; past 4096 limbs it drops out
+			time[k]=k==0 && n>4096 ? -1 : mulTime(&a, &b, &c, t[k]);
+			if(time[k]<0)
+				printf(" %12s", "-");
+			else
+				printf(" %9.3f ms", time[k]*1e3);
+			if(time[k]>=0 && (best<0 || time[k]<time[best]))
+				best=k;
+			if(time[k]<0)
+				continue;
+			if(!checked++)
+				bigCopy(&check, &c);
+			else if(bigCompare(&check, &c)!=0)
+			{
+				printf("\nMismatch\n");
+				return 1;
+			}
+		}
+		printf("   %s\n", name[best]);
+	}
+	bigFree(&a);
+	bigFree(&b);
+	bigFree(&c);
+	bigFree(&check);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static char x[MAX_DIGITS+1], y[MAX_DIGITS+1];
+	BigNum a, b, sum, check;
+	if(argc>1 && strcmp(argv[1], "--bench")==0)
+		return bench(argc>2 ? (size_t)strtoul(argv[2], NULL, 10) : 65536);
 
-	long long int a, b, k, l, sum=0, i=0;
+	bigInit(&a);
+	bigInit(&b);
+	bigInit(&sum);
+	bigInit(&check);
 
 // input variables
 	printf("ENTER TWO NUMBERS:\n");
-	scanf("%lld %lld", &a, &b);
-	k=a;
-	l=b;
+	if(scanf("%100000s %100000s", x, y)!=2 || bigFromString(&a, x)!=0 || bigFromString(&b, y)!=0)
+	{
+		printf("Enter two non-negative whole numbers of up to %d digits\n", MAX_DIGITS);
+		bigFree(&a);
+		bigFree(&b);
+		return 1;
+	}
 
 
 // working of algorithm
-	while(a>0)
+	if(peasant(&a, &b, &sum)!=0 || bigMul(&check, &a, &b)!=0)
 	{
-		if(a%2==1){
-			sum = sum + b;
-		}
-			a = a>>1;
-			b = b<<1; 
-			i++;
+		printf("Out of memory\n");
+		return 1;
 	}
 
 
 // output
-	printf("PRODUCT OF %lld AND %lld IS = %lld \n",k,l,sum);
+	printf("PRODUCT OF %s AND %s IS = ", x, y);
+	bigPrint(stdout, &sum);
+	printf(" \n");
+	if(bigCompare(&sum, &check)!=0)
+		printf("(bigMul() disagrees)\n");
 
+	bigFree(&a);
+	bigFree(&b);
+	bigFree(&sum);
+	bigFree(&check);
 	return 0;
-}
\ No newline at end of file
+}
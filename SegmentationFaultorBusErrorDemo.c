@@ -3,10 +3,106 @@
 // they are often associated with a file named core . Segfaults are caused by a program trying to
 // read or write an illegal memory location.
 
+//
+// With an argument it shows GuardAlloc.h catching the heap kind of bad access, which
+// unlike this one does not usually crash on the spot:
+//
+//     SegmentationFaultorBusErrorDemo overflow    writes one byte past a sampled allocation
+//     SegmentationFaultorBusErrorDemo after-free  reads a sampled allocation after free()
+//     SegmentationFaultorBusErrorDemo --bench N   N malloc/free pairs, plain and sampled
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "GuardAlloc.h"
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// An allocation that GuardAlloc.h sampled, however many it takes
+static char *
+sampled (size_t size)
+{
+  if (guardInit () != 0)
+    return NULL;
+  for (;;)
+    {
+      char *p = guardMalloc (size);
+      if (p == NULL || guardOwns (p))
+        return p;
+      guardFree (p);
+    }
+}
+
+static int
+bench (size_t n)
+{
+  double best[2] = { 1e30, 1e30 };
+  size_t i, sampledCount = 0;
+  int rep;
+
+  for (rep = 0; rep < 3; rep++)
+    {
+      double t = now ();
+      for (i = 0; i < n; i++)
+        {
+          char *volatile p = malloc (32 + (i & 63));
+          p[0] = 1;
+          free (p);
+        }
+      if ((t = now () - t) < best[0])
+        best[0] = t;
+      t = now ();
+      sampledCount = 0;
+      for (i = 0; i < n; i++)
+        {
+          char *volatile p = guardMalloc (32 + (i & 63));
+          p[0] = 1;
+          sampledCount += guardOwns (p);
+          guardFree (p);
+        }
+      if ((t = now () - t) < best[1])
+        best[1] = t;
+    }
+  printf ("%zu malloc/free pairs, best of 3, ns a pair\n", n);
+  printf ("  malloc/free              %.2f\n", best[0] / n * 1e9);
+  printf ("  guardMalloc/guardFree    %.2f   (%zu sampled, 1 in %llu)\n", best[1] / n * 1e9, sampledCount,
+          (unsigned long long) guardState.rate);
+  return 0;
+}
+
 int
-main ()
+main (int argc, char *argv[])
 {
+if (argc > 2 && strcmp (argv[1], "--bench") == 0)
+  return bench (strtoul (argv[2], NULL, 10));
+if (argc > 1)
+  {
+    char *p = sampled (13), c;
+    if (p == NULL)
+      {
+        printf ("Sampling is off\n");
+        return 1;
+      }
+    memset (p, 'x', 13);
+    if (strcmp (argv[1], "overflow") == 0)
+      p[13] = 'x';
+    else
+      {
+        guardFree (p);
+        c = *(volatile char *) p;
+        printf ("%c\n", c);
+      }
+    printf ("Not caught\n");
+    return 1;
+  }
+
 
 char *cards = "JQK";
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 //function for swapping two numbers
 void swap(int * xp, int * yp) {
@@ -30,7 +31,9 @@ int main() {
   int n, i; //n is size of array
   printf("Enter the number of elements ");
   scanf("%d",&n);
-  int a[n]; //array of n integers to be sorted
+  int * a = malloc((n > 0 ? n : 1) * sizeof * a); //array of n integers to be sorted
+  if (a == NULL)
+    return 1;
   printf("Enter the elements ");
   for (i = 0; i < n; i++)
     scanf("%d",&a[i]);
@@ -40,5 +43,6 @@ int main() {
   for (i = 0; i < n; i++)
     printf("%d ", a[i]);
 
+  free(a);
   return 0;
 }
@@ -0,0 +1,127 @@
+// Linear search on int arrays that compares many elements per step, for
+// linearsearch.c and ARRAY.c.
+//
+// simdFind(a, n, x) is the first i with a[i] == x, or n. Each step loads
+// 16 ints (two AVX2 vectors, or four SSE2 ones), compares them all with
+// x, and turns the compare results into a bit mask; the first set bit,
+// found with count-trailing-zeros, is the match. Without SSE2 it is a
+// plain loop.
+//
+// simdLowerBound(a, n, x) is lower_bound on a sorted array by counting:
+// the elements < x are exactly the ones before the answer, so it adds up
+// the compare results of all n elements, with no branch that depends on
+// the data. It reads every element, so it only pays on short arrays.
+//
+// searchSorted(a, n, x) picks: simdLowerBound up to SIMD_SEARCH_LINEAR
+// elements, and above that binary search down to a range of that size,
+// then simdLowerBound on the rest.
+// Build with -march=native (or -mavx2) to get the AVX2 versions; SSE2 is
+// always there on x86-64. Header-only.
+
+#ifndef SIMD_SEARCH_H
+#define SIMD_SEARCH_H
+
+#include <stddef.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// where linear counting stops beating binary search, measured with
+// linearsearch.c --bench
+#define SIMD_SEARCH_LINEAR 64
+
+static inline size_t simdFind(const int *a, size_t n, int x)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi32(x);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i lo = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), key);
+        __m256i hi = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + i + 8)), key);
+        unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lo)) |
+                        (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8;
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    __m128i key = _mm_set1_epi32(x);
+    for (; i + 16 <= n; i += 16)
+    {
+        unsigned mask = 0;
+        int k;
+        for (k = 0; k < 4; k++)
+        {
+            __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(a + i + 4 * k)), key);
+            mask |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)) << 4 * k;
+        }
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < n; i++)
+        if (a[i] == x)
+            return i;
+    return n;
+}
+
+static inline size_t simdLowerBound(const int *a, size_t n, int x)
+{
+    size_t i = 0, count = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi32(x), less = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8)
+    {
+        // a[i] < x gives -1, so subtracting the compare counts up
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        less = _mm256_sub_epi32(less, _mm256_cmpgt_epi32(key, v));
+    }
+    {
+        int lanes[8], k;
+        _mm256_storeu_si256((__m256i *)lanes, less);
+        for (k = 0; k < 8; k++)
+            count += (size_t)lanes[k];
+    }
+#elif defined(__SSE2__)
+    __m128i key = _mm_set1_epi32(x), less = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+        less = _mm_sub_epi32(less, _mm_cmpgt_epi32(key, v));
+    }
+    {
+        int lanes[4], k;
+        _mm_storeu_si128((__m128i *)lanes, less);
+        for (k = 0; k < 4; k++)
+            count += (size_t)lanes[k];
+    }
+#endif
+    for (; i < n; i++)
+        count += a[i] < x;
+    return count;
+}
+
+// lower_bound on a sorted array of any length
+static inline size_t searchSorted(const int *a, size_t n, int x)
+{
+    size_t lo = 0;
+
+    // a[0 .. lo) < x, and the answer is in lo .. lo + n
+    while (n > SIMD_SEARCH_LINEAR)
+    {
+        size_t half = n / 2;
+        if (a[lo + half] < x)
+        {
+            lo += half + 1;
+            n -= half + 1;
+        }
+        else
+            n = half;
+    }
+    return lo + simdLowerBound(a + lo, n, x);
+}
+
+#endif
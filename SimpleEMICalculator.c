@@ -1,25 +1,352 @@
 #include <stdio.h>
 #include <math.h>
- 
-int main() 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Amortization.h"
+#include "FloatText.h"
+#include "OutBuffer.h"
+#include "Random.h"
+
+/*
+ * With no arguments: one loan, read from the keyboard.
+ *   --schedule                also prints its month by month schedule
+ *   --portfolio FILE|- [--cashflows] [--threads N]
+ *                             a book of loans, one "principal rate years"
+ *                             per line, and the EMI of each, or with
+ *                             --cashflows the interest, principal and
+ *                             balance of the whole book month by month
+ *   --bench N THREADS         N random loans, the old pow() path against
+ *                             Amortization.h
+ */
+
+#define MAX_RATES 4096
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t toMonths(double years)
+{
+    double m = years * 12 + 0.5;
+    return m < 1 ? 0 : m > 4e9 ? 4000000000u : (uint32_t)m;
+}
+
+/* the whole of f in memory, with a '\0' after it */
+static char *readAll(FILE *f, size_t *len)
+{
+    size_t cap = 1 << 20, got;
+    char *buf = malloc(cap);
+    *len = 0;
+    while (buf != NULL && (got = fread(buf + *len, 1, cap - *len - 1, f)) > 0)
+    {
+        *len += got;
+        if (cap - *len - 1 == 0)
+        {
+            char *bigger = realloc(buf, cap * 2);
+            if (bigger == NULL)
+                free(buf);
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    if (buf != NULL)
+        buf[*len] = '\0';
+    return buf;
+}
+
+static int nextNumber(char **p, double *x)
 {
-    float principal, rate, time, emi;
+    char *s = *p, *e;
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r' || *s == ',')
+        s++;
+    for (e = s; *e != '\0' && *e != ' ' && *e != '\t' && *e != '\n' && *e != '\r' && *e != ','; e++)
+        ;
+    *p = e;
+    return e > s && parseDouble(s, e, x) == 0 ? 0 : -1;
+}
+
+static int portfolio(int argc, char *argv[])
+{
+    FILE *f = stdin;
+    char *text, *p;
+    size_t len, cap = 1024, n = 0, i;
+    int flows = 0, threads = 1, rc = 0;
+    double x[3];
+    LoanBook book;
+    LoanRateTable table = {0};
+    TaskPool pool;
+    OutBuffer o;
+    uint32_t longest = 0;
+    double *emi;
+
+    for (i = 3; i < (size_t)argc; i++)
+    {
+        if (strcmp(argv[i], "--cashflows") == 0)
+            flows = 1;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < (size_t)argc)
+            threads = atoi(argv[++i]);
+    }
+    if (strcmp(argv[2], "-") != 0 && (f = fopen(argv[2], "r")) == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    text = readAll(f, &len);
+    if (f != stdin)
+        fclose(f);
+    if (text == NULL || loanBookInit(&book, cap) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        free(text);
+        return 1;
+    }
+    for (p = text; nextNumber(&p, &x[0]) == 0 && nextNumber(&p, &x[1]) == 0 && nextNumber(&p, &x[2]) == 0; n++)
+    {
+        if (n == cap)
+        {
+            LoanBook bigger;
+            if (loanBookInit(&bigger, cap * 2) != 0)
+            {
+                fprintf(stderr, "out of memory\n");
+                loanBookFree(&book);
+                free(text);
+                return 1;
+            }
+            memcpy(bigger.principal, book.principal, n * sizeof *book.principal);
+            memcpy(bigger.rate, book.rate, n * sizeof *book.rate);
+            memcpy(bigger.months, book.months, n * sizeof *book.months);
+            loanBookFree(&book);
+            book = bigger;
+            cap *= 2;
+        }
+        book.principal[n] = x[0];
+        book.rate[n] = x[1] / (12 * 100); /*one month interest*/
+        book.months[n] = toMonths(x[2]);
+        longest = book.months[n] > longest ? book.months[n] : longest;
+    }
+    free(text);
+    book.n = n;
+    emi = malloc((n ? n : 1) * sizeof *emi);
+    if (emi == NULL || poolCreate(&pool, threads) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        loanBookFree(&book);
+        free(emi);
+        return 1;
+    }
+    /* a book with too many rates, or too long a loan, goes without the table */
+    if (longest <= 1200)
+        loanShareRates(&book, &table, MAX_RATES, longest);
+    loanEmis(&pool, &book, book.rateId != NULL ? &table : NULL, emi);
+    outInit(&o, stdout, 0);
+    if (!flows)
+        for (i = 0; i < n; i++)
+        {
+            outFixed(&o, emi[i], 2);
+            outChar(&o, '\n');
+        }
+    else
+    {
+        double *sums = malloc(3 * (longest ? longest : 1) * sizeof *sums);
+        if (sums == NULL || loanCashflows(&pool, &book, emi, longest, sums, sums + longest, sums + 2 * longest) != 0)
+        {
+            fprintf(stderr, "out of memory\n");
+            rc = 1;
+        }
+        for (i = 0; rc == 0 && i < longest; i++)
+        {
+            outInt(&o, (long long)i + 1);
+            outChar(&o, ' ');
+            outFixed(&o, sums[i], 2);
+            outChar(&o, ' ');
+            outFixed(&o, sums[longest + i], 2);
+            outChar(&o, ' ');
+            outFixed(&o, sums[2 * longest + i], 2);
+            outChar(&o, '\n');
+        }
+        free(sums);
+    }
+    if (outClose(&o) != 0)
+        rc = 1;
+    poolDestroy(&pool);
+    loanRateTableFree(&table);
+    loanBookFree(&book);
+    free(emi);
+    return rc;
+}
+
+static double relativeError(double a, double b)
+{
+    double d = fabs(a - b), m = fabs(b) > 1 ? fabs(b) : 1;
+    return d / m;
+}
+
+static int bench(size_t n, int threads)
+{
+    LoanBook book;
+    LoanRateTable table;
+    TaskPool pool;
+    Xoshiro256 rng;
+    double *emi = malloc((n ? n : 1) * sizeof *emi), *ref = malloc((n ? n : 1) * sizeof *ref);
+    double *sums = malloc(3 * 360 * sizeof *sums), *check = calloc(3 * 360, sizeof *check);
+    double *row = malloc(3 * 360 * sizeof *row);
+    double t, best, worst = 0, flowWorst = 0;
+    size_t i, k;
+    int round;
+
+    if (emi == NULL || ref == NULL || sums == NULL || check == NULL || row == NULL ||
+        loanBookInit(&book, n) != 0 || poolCreate(&pool, threads) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    xoshiroSeed(&rng, 111);
+    /* 6% to 17.75% a year in steps of a quarter, 1 to 30 years */
+    for (i = 0; i < n; i++)
+    {
+        book.principal[i] = 10000 + (double)xoshiroBelow(&rng, 990000);
+        book.rate[i] = (6 + 0.25 * xoshiroBelow(&rng, 48)) / (12 * 100);
+        book.months[i] = 12 * (uint32_t)(1 + xoshiroBelow(&rng, 30));
+    }
+
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        for (i = 0; i < n; i++)
+        {
+            double r = book.rate[i], m = book.months[i];
+            ref[i] = (book.principal[i] * r * pow(1 + r, m)) / (pow(1 + r, m) - 1);
+        }
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    printf("pow() twice a loan:       %.4f s\n", best);
+
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        loanEmis(NULL, &book, NULL, emi);
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    for (i = 0; i < n; i++)
+        worst = fmax(worst, fabs(emi[i] - ref[i]) / ref[i]);
+    printf("squarings, one thread:    %.4f s\n", best);
+
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        loanEmis(&pool, &book, NULL, emi);
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    printf("squarings, %d threads:    %.4f s\n", threads, best);
+
+    t = now();
+    if (loanShareRates(&book, &table, MAX_RATES, 360) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("rate table (%zu rates):   %.4f s to build\n", table.count, now() - t);
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        loanEmis(&pool, &book, &table, emi);
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    for (i = 0; i < n; i++)
+        worst = fmax(worst, fabs(emi[i] - ref[i]) / ref[i]);
+    printf("table, %d threads:        %.4f s\n", threads, best);
+    printf("largest difference from pow(): %.2g relative\n", worst);
+
+    t = now();
+    for (i = 0; i < n; i++)
+    {
+        loanSchedule(book.principal[i], book.rate[i], book.months[i], emi[i], row, row + 360, row + 720);
+        for (k = 0; k < book.months[i]; k++)
+        {
+            check[k] += row[k];
+            check[360 + k] += row[360 + k];
+            check[720 + k] += row[720 + k];
+        }
+    }
+    printf("schedules one by one:     %.4f s\n", now() - t);
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        if (loanCashflows(&pool, &book, emi, 360, sums, sums + 360, sums + 720) != 0)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    for (k = 0; k < 3 * 360; k++)
+        flowWorst = fmax(flowWorst, relativeError(sums[k], check[k]));
+    printf("book cashflows, %d threads: %.4f s (%.2g relative from the one by one sums)\n", threads, best,
+           flowWorst);
+
+    poolDestroy(&pool);
+    loanRateTableFree(&table);
+    loanBookFree(&book);
+    free(emi);
+    free(ref);
+    free(sums);
+    free(check);
+    free(row);
+    return 0;
+}
+
+static void schedule(double principal, double rate, uint32_t months, double emi)
+{
+    double *rows = malloc(3 * (months ? months : 1) * sizeof *rows);
+    uint32_t k;
+    if (rows == NULL)
+        return;
+    loanSchedule(principal, rate, months, emi, rows, rows + months, rows + 2 * months);
+    printf("Month    Interest   Principal     Balance\n");
+    for (k = 0; k < months; k++)
+        printf("%5u %11.2f %11.2f %11.2f\n", k + 1, rows[k], rows[months + k], rows[2 * months + k]);
+    free(rows);
+}
+
+int main(int argc, char *argv[])
+{
+    double principal, rate, time, emi;
+    uint32_t months;
+
+    if (argc > 2 && strcmp(argv[1], "--portfolio") == 0)
+        return portfolio(argc, argv);
+    if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtoull(argv[2], NULL, 10), atoi(argv[3]));
 
     printf("Enter principal amount: ");
-    scanf("%f",&principal);
- 
+    if (scanf("%lf",&principal) != 1)
+        return 1;
+
     printf("Enter rate of interest: ");
-    scanf("%f",&rate);
- 
+    if (scanf("%lf",&rate) != 1)
+        return 1;
+
     printf("Enter time in years: ");
-    scanf("%f",&time);
- 
+    if (scanf("%lf",&time) != 1)
+        return 1;
+
     rate=rate/(12*100); /*one month interest*/
-    time=time*12; /*one month period*/
- 
-    emi= (principal*rate*pow(1+rate,time))/(pow(1+rate,time)-1);
- 
+    months=toMonths(time); /*one month period*/
+
+    emi=loanEmi(principal,rate,months);
+
     printf("Monthly EMI is= %f\n",emi);
-     
+    if (argc > 1 && strcmp(argv[1], "--schedule") == 0)
+        schedule(principal, rate, months, emi);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,13 +1,140 @@
 //Program to calculate simple interest
+//
+//With no arguments it reads one principal, rate and time. Otherwise:
+//  --csv simple|compound [--periods K] [--columns P,R,T] [--decimals D]
+//      reads CSV lines from stdin and writes each with its interest added
+//      as a last field: simple, or compounded K times a year (12 when not
+//      given, 0 for continuously); the principal, rate (percent a year)
+//      and time (years) are fields P, R and T, from 0 (0,1,2 when not
+//      given)
+//  --bench N
+//      N random accounts, one formula at a time against Interest.h
 
 
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<time.h>
+#include "Interest.h"
+#include "Random.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int csv(int argc, char *argv[])
+{
+    size_t columns[3] = {0, 1, 2};
+    double periods = 12;
+    int decimals = 2, mode, i, rc;
+    OutBuffer o;
+    if (strcmp(argv[2], "simple") == 0)
+        mode = INTEREST_SIMPLE;
+    else if (strcmp(argv[2], "compound") == 0)
+        mode = INTEREST_COMPOUND;
+    else
+    {
+        fprintf(stderr, "%s: simple or compound, not %s\n", argv[0], argv[2]);
+        return 1;
+    }
+    for (i = 3; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--periods") == 0)
+            periods = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--decimals") == 0)
+            decimals = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--columns") == 0)
+        {
+            unsigned long long p, r, t;
+            if (sscanf(argv[i + 1], "%llu,%llu,%llu", &p, &r, &t) != 3)
+            {
+                fprintf(stderr, "%s: --columns P,R,T\n", argv[0]);
+                return 1;
+            }
+            columns[0] = (size_t)p;
+            columns[1] = (size_t)r;
+            columns[2] = (size_t)t;
+        }
+    }
+    outInit(&o, stdout, 1);
+    rc = interestCsv(stdin, &o, columns, mode, periods, decimals);
+    if (outClose(&o) != 0 || rc != 0)
+    {
+        fprintf(stderr, "%s: failed to convert\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
+
+static int bench(size_t n)
+{
+    InterestBook b;
+    Xoshiro256 rng;
+    double *out = malloc((n ? n : 1) * sizeof *out), *ref = malloc((n ? n : 1) * sizeof *ref);
+    double t, best, worst;
+    size_t i;
+    int round, mode;
+    if (out == NULL || ref == NULL || interestBookInit(&b, n) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    xoshiroSeed(&rng, 112);
+    /* one night to 30 years, at 0.5% to 25% */
+    for (i = 0; i < n; i++)
+    {
+        b.principal[i] = 100 + (double)xoshiroBelow(&rng, 10000000) / 10;
+        b.rate[i] = 0.5 + (double)xoshiroBelow(&rng, 2450) / 100;
+        b.years[i] = i % 2 ? 1.0 / 365 : (double)(1 + xoshiroBelow(&rng, 30 * 365)) / 365;
+    }
+    for (mode = INTEREST_SIMPLE; mode <= INTEREST_COMPOUND; mode++)
+    {
+        const char *name = mode == INTEREST_SIMPLE ? "simple" : "compound daily";
+        for (round = 0, best = 0; round < 3; round++)
+        {
+            t = now();
+            if (mode == INTEREST_SIMPLE)
+                for (i = 0; i < n; i++)
+                    ref[i] = simpleInterest(b.principal[i], b.rate[i], b.years[i]);
+            else
+                for (i = 0; i < n; i++)
+                    ref[i] = b.principal[i] * (pow(1 + b.rate[i] / (100 * 365.0), 365 * b.years[i]) - 1);
+            t = now() - t;
+            best = round == 0 || t < best ? t : best;
+        }
+        printf("%-15s one at a time: %.4f s\n", name, best);
+        for (round = 0, best = 0; round < 3; round++)
+        {
+            t = now();
+            interestArray(&b, mode, 365, out);
+            t = now() - t;
+            best = round == 0 || t < best ? t : best;
+        }
+        for (i = 0, worst = 0; i < n; i++)
+            worst = fmax(worst, fabs(out[i] - ref[i]) / ref[i]);
+        printf("%-15s interestArray: %.4f s, %.2g relative from the other\n", name, best, worst);
+    }
+    interestBookFree(&b);
+    free(out);
+    free(ref);
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
     float PrincipleAmount,Rate,Time, SimpleInterest;
+    if (argc > 2 && strcmp(argv[1], "--csv") == 0)
+        return csv(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtoull(argv[2], NULL, 10));
     printf("Enter Principal Amount, Rate of interest and Time Respectively\n");
-    scanf("%f%f%f", &PrincipleAmount, &Rate, &Time);
-    SimpleInterest = (PrincipleAmount * Rate * Time)/ 100;
+    if (scanf("%f%f%f", &PrincipleAmount, &Rate, &Time) != 3)
+        return 1;
+    SimpleInterest = (float)simpleInterest(PrincipleAmount, Rate, Time);
     printf("Simple Interest is :%f",SimpleInterest);
     return 0;
 
@@ -1,16 +1,30 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include "Pattern.h"
 
-int main(){
+// Run with a number ROWS for the table up to ROWS instead of 10. The
+// " x num = " in the middle of every line is made once, and the lines go
+// out through one OutBuffer.
+int main(int argc, char *argv[]){
 
-	int num, i = 1;
+	int num, i = 1, rows = argc > 1 ? atoi(argv[1]) : 10;
+	char middle[INT_TEXT_MAX + 8];
+	size_t k;
+	OutBuffer out;
 
-    printf("Enter a number to calculate the multiplication table up to 10:\n");
+    printf("Enter a number to calculate the multiplication table up to %d:\n", rows);
 
-	scanf("%d", &num);
+	if (scanf("%d", &num) != 1 || outInit(&out, stdout, 0) != 0)
+		return 1;
+	k = (size_t)snprintf(middle, sizeof middle, " x %d = ", num);
 
-	for(i = 1; i <= 10; i++){
-		printf("%d x %d = %d\n", i, num, num * i);
+	for(i = 1; i <= rows; i++){
+		outInt(&out, i);
+		outText(&out, middle, k);
+		outInt(&out, (long long)num * i);
+		outChar(&out, '\n');
 	}
 
+	outClose(&out);
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,583 @@
+// An ordered set of ints as a skip list.
+//
+//   SkipList                 menu: insert, delete, search, display
+//   SkipList --concurrent T [--ops N] [--range R]
+//
+// A skip list is a sorted linked list with express lanes: every node is
+// on level 0, and a node on level h is also on level h + 1 with
+// probability 1/4. A search starts on the top level and drops a level
+// whenever the next node would overshoot, so search, insert and delete
+// take O(log n) expected steps instead of the O(n) scan of LinkedLists.c.
+// Level 0 alone is the plain sorted list, which is what Display walks.
+//
+// A node is a key and a tower of next pointers, one per level it is on.
+// Towers come from a NodePool per height (NodePool.h), so building the
+// set makes a malloc per few thousand nodes, and deleting the whole set
+// is one free per chunk.
+//
+// --concurrent times a lazy skip list (Herlihy, Lev, Luchangco and
+// Shavit, 2006) shared by T threads: N random operations each, 80%
+// searches, 10% inserts and 10% deletes, on keys below R. Searches take
+// no lock at all. Inserts and deletes lock only the few nodes next to
+// the key, check that nothing changed under them, and retry otherwise, so
+// threads working on different keys do not wait for each other. Deleted
+// nodes are not freed while the threads run, since a search may still be
+// passing through them; each thread's pools go when the test ends.
+// Build with -pthread.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "NodePool.h"
+
+#define SKIP_MAX_LEVEL 16 // plenty for 4^16 = 4G keys
+
+// ---------- the skip list ----------
+
+typedef struct SkipNode
+{
+    int key;
+    int height;
+    struct SkipNode *next[]; // height of them
+} SkipNode;
+
+typedef struct
+{
+    SkipNode *head; // a full-height tower before every key
+    int level;      // levels in use
+    int count;
+    uint32_t seed;
+    NodePool pools[SKIP_MAX_LEVEL + 1]; // pools[h] holds towers of height h
+} SkipList;
+
+static uint32_t skipRandom(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+// 1 + the number of times a coin with p = 1/4 comes up: two bits a try
+static int skipHeight(uint32_t *seed)
+{
+    uint32_t r = skipRandom(seed);
+    int h = 1;
+
+    while (h < SKIP_MAX_LEVEL && (r & 3) == 0)
+    {
+        h++;
+        r >>= 2;
+    }
+    return h;
+}
+
+static SkipNode *skipNewNode(SkipList *s, int key, int height)
+{
+    SkipNode *n = nodePoolAlloc(&s->pools[height]);
+
+    if (n == NULL)
+        return NULL;
+    n->key = key;
+    n->height = height;
+    memset(n->next, 0, height * sizeof n->next[0]);
+    return n;
+}
+
+static int skipInit(SkipList *s)
+{
+    int h;
+
+    for (h = 0; h <= SKIP_MAX_LEVEL; h++)
+        nodePoolInit(&s->pools[h], sizeof(SkipNode) + h * sizeof(SkipNode *));
+    s->level = 1;
+    s->count = 0;
+    s->seed = 2463534242u;
+    s->head = skipNewNode(s, INT_MIN, SKIP_MAX_LEVEL);
+    return s->head == NULL ? -1 : 0;
+}
+
+static void skipFree(SkipList *s)
+{
+    int h;
+
+    for (h = 0; h <= SKIP_MAX_LEVEL; h++)
+        nodePoolRelease(&s->pools[h]);
+    s->head = NULL;
+    s->count = 0;
+}
+
+// Fills before[h] with the last node on level h whose key is < key
+static SkipNode *skipFind(const SkipList *s, int key, SkipNode **before)
+{
+    SkipNode *p = s->head;
+    int h;
+
+    for (h = s->level - 1; h >= 0; h--)
+    {
+        while (p->next[h] != NULL && p->next[h]->key < key)
+            p = p->next[h];
+        if (before != NULL)
+            before[h] = p;
+    }
+    p = p->next[0];
+    return p != NULL && p->key == key ? p : NULL;
+}
+
+static int skipContains(const SkipList *s, int key)
+{
+    return skipFind(s, key, NULL) != NULL;
+}
+
+// 1 if added, 0 if it was there already, -1 if out of memory
+static int skipInsert(SkipList *s, int key)
+{
+    SkipNode *before[SKIP_MAX_LEVEL], *n;
+    int h, height;
+
+    if (skipFind(s, key, before) != NULL)
+        return 0;
+    height = skipHeight(&s->seed);
+    for (h = s->level; h < height; h++)
+        before[h] = s->head;
+    if (height > s->level)
+        s->level = height;
+    n = skipNewNode(s, key, height);
+    if (n == NULL)
+        return -1;
+    for (h = 0; h < height; h++)
+    {
+        n->next[h] = before[h]->next[h];
+        before[h]->next[h] = n;
+    }
+    s->count++;
+    return 1;
+}
+
+// 1 if deleted, 0 if it was not there
+static int skipDelete(SkipList *s, int key)
+{
+    SkipNode *before[SKIP_MAX_LEVEL];
+    SkipNode *n = skipFind(s, key, before);
+    int h;
+
+    if (n == NULL)
+        return 0;
+    for (h = 0; h < n->height; h++)
+        before[h]->next[h] = n->next[h];
+    while (s->level > 1 && s->head->next[s->level - 1] == NULL)
+        s->level--;
+    nodePoolFree(&s->pools[n->height], n);
+    s->count--;
+    return 1;
+}
+
+// in order, like Display in LinkedLists.c
+static void skipDisplay(const SkipList *s)
+{
+    const SkipNode *p;
+
+    for (p = s->head->next[0]; p != NULL; p = p->next[0])
+        printf("%d->", p->key);
+    printf("\n");
+}
+
+// ---------- the lazy concurrent skip list ----------
+
+typedef struct LazyNode
+{
+    int key;
+    int height;
+    atomic_bool marked;      // being deleted
+    atomic_bool fullyLinked; // on every level of its tower
+    pthread_mutex_t lock;
+    _Atomic(struct LazyNode *) next[];
+} LazyNode;
+
+typedef struct
+{
+    LazyNode *head, *tail; // keys INT_MIN and INT_MAX, so real keys lie between
+} LazyList;
+
+// Each thread allocates from its own pools, so allocation needs no lock
+typedef struct
+{
+    NodePool pools[SKIP_MAX_LEVEL + 1];
+    uint32_t seed;
+} LazyAllocator;
+
+static void lazyAllocatorInit(LazyAllocator *a, uint32_t seed)
+{
+    int h;
+
+    for (h = 0; h <= SKIP_MAX_LEVEL; h++)
+        nodePoolInit(&a->pools[h], sizeof(LazyNode) + h * sizeof(LazyNode *));
+    a->seed = seed;
+}
+
+// Frees every node from a's pools; only once no thread can reach them.
+// (The node mutexes hold no resources on Linux, so they are not destroyed
+// one by one.)
+static void lazyAllocatorFree(LazyAllocator *a)
+{
+    int h;
+
+    for (h = 0; h <= SKIP_MAX_LEVEL; h++)
+        nodePoolRelease(&a->pools[h]);
+}
+
+static LazyNode *lazyNewNode(LazyAllocator *a, int key, int height)
+{
+    LazyNode *n = nodePoolAlloc(&a->pools[height]);
+    int h;
+
+    if (n == NULL)
+        return NULL;
+    n->key = key;
+    n->height = height;
+    atomic_init(&n->marked, 0);
+    atomic_init(&n->fullyLinked, 0);
+    pthread_mutex_init(&n->lock, NULL);
+    for (h = 0; h < height; h++)
+        atomic_init(&n->next[h], NULL);
+    return n;
+}
+
+static int lazyInit(LazyList *l, LazyAllocator *a)
+{
+    int h;
+
+    l->head = lazyNewNode(a, INT_MIN, SKIP_MAX_LEVEL);
+    l->tail = lazyNewNode(a, INT_MAX, SKIP_MAX_LEVEL);
+    if (l->head == NULL || l->tail == NULL)
+        return -1;
+    for (h = 0; h < SKIP_MAX_LEVEL; h++)
+        atomic_store(&l->head->next[h], l->tail);
+    atomic_store(&l->head->fullyLinked, 1);
+    atomic_store(&l->tail->fullyLinked, 1);
+    return 0;
+}
+
+// Takes no lock. Returns the highest level key was found on, or -1.
+static int lazyFind(LazyList *l, int key, LazyNode **before, LazyNode **after)
+{
+    LazyNode *pred = l->head;
+    int h, found = -1;
+
+    for (h = SKIP_MAX_LEVEL - 1; h >= 0; h--)
+    {
+        LazyNode *curr = atomic_load(&pred->next[h]);
+        while (key > curr->key)
+        {
+            pred = curr;
+            curr = atomic_load(&pred->next[h]);
+        }
+        if (found == -1 && key == curr->key)
+            found = h;
+        before[h] = pred;
+        after[h] = curr;
+    }
+    return found;
+}
+
+// wait-free: just a search
+static int lazyContains(LazyList *l, int key)
+{
+    LazyNode *before[SKIP_MAX_LEVEL], *after[SKIP_MAX_LEVEL];
+    int found = lazyFind(l, key, before, after);
+
+    return found != -1 && atomic_load(&after[found]->fullyLinked) && !atomic_load(&after[found]->marked);
+}
+
+// Unlocks before[0 .. levels), each node once
+static void lazyUnlock(LazyNode **before, int levels)
+{
+    LazyNode *prev = NULL;
+    int h;
+
+    for (h = 0; h < levels; h++)
+    {
+        if (before[h] != prev)
+            pthread_mutex_unlock(&before[h]->lock);
+        prev = before[h];
+    }
+}
+
+// Locks before[0 .. levels) and checks that each still links straight to
+// after[h] (or to victim when deleting) and is not being deleted.
+// Returns how many levels got locked, negated if a check failed.
+static int lazyLockAndCheck(LazyNode **before, LazyNode **after, LazyNode *victim, int levels)
+{
+    LazyNode *prev = NULL;
+    int h;
+
+    for (h = 0; h < levels; h++)
+    {
+        LazyNode *succ = victim != NULL ? victim : after[h];
+        // the same node is often the predecessor on several levels in a
+        // row: lock it once
+        if (before[h] != prev)
+            pthread_mutex_lock(&before[h]->lock);
+        prev = before[h];
+        if (atomic_load(&before[h]->marked) || atomic_load(&before[h]->next[h]) != succ ||
+            (victim == NULL && atomic_load(&succ->marked)))
+            return -(h + 1);
+    }
+    return levels;
+}
+
+// 1 if added, 0 if it was there already, -1 if out of memory
+static int lazyInsert(LazyList *l, LazyAllocator *a, int key)
+{
+    LazyNode *before[SKIP_MAX_LEVEL], *after[SKIP_MAX_LEVEL];
+    int height = skipHeight(&a->seed);
+
+    for (;;)
+    {
+        int found = lazyFind(l, key, before, after), locked, h;
+        LazyNode *n;
+
+        if (found != -1)
+        {
+            LazyNode *there = after[found];
+            if (!atomic_load(&there->marked))
+            {
+                // it is there, or about to be: wait for the insert to finish
+                while (!atomic_load(&there->fullyLinked))
+                    ;
+                return 0;
+            }
+            continue; // being deleted: look again once it is gone
+        }
+        locked = lazyLockAndCheck(before, after, NULL, height);
+        if (locked < 0)
+        {
+            lazyUnlock(before, -locked);
+            continue;
+        }
+        n = lazyNewNode(a, key, height);
+        if (n == NULL)
+        {
+            lazyUnlock(before, height);
+            return -1;
+        }
+        for (h = 0; h < height; h++)
+            atomic_store(&n->next[h], after[h]);
+        // from the bottom up, so a node is reachable on level 0 first
+        for (h = 0; h < height; h++)
+            atomic_store(&before[h]->next[h], n);
+        atomic_store(&n->fullyLinked, 1);
+        lazyUnlock(before, height);
+        return 1;
+    }
+}
+
+// 1 if deleted, 0 if it was not there. The node stays allocated.
+static int lazyDelete(LazyList *l, int key)
+{
+    LazyNode *before[SKIP_MAX_LEVEL], *after[SKIP_MAX_LEVEL], *victim = NULL;
+    int marked = 0;
+
+    for (;;)
+    {
+        int found = lazyFind(l, key, before, after), locked, h;
+
+        if (!marked)
+        {
+            // only a fully linked node found on its top level is a whole
+            // node we may delete
+            if (found == -1)
+                return 0;
+            victim = after[found];
+            if (!atomic_load(&victim->fullyLinked) || victim->height - 1 != found || atomic_load(&victim->marked))
+                return 0;
+            pthread_mutex_lock(&victim->lock);
+            if (atomic_load(&victim->marked))
+            {
+                pthread_mutex_unlock(&victim->lock);
+                return 0;
+            }
+            atomic_store(&victim->marked, 1); // from here on, it is ours to unlink
+            marked = 1;
+        }
+        locked = lazyLockAndCheck(before, after, victim, victim->height);
+        if (locked < 0)
+        {
+            lazyUnlock(before, -locked);
+            continue;
+        }
+        for (h = victim->height - 1; h >= 0; h--)
+            atomic_store(&before[h]->next[h], atomic_load(&victim->next[h]));
+        pthread_mutex_unlock(&victim->lock);
+        lazyUnlock(before, victim->height);
+        return 1;
+    }
+}
+
+// ---------- the concurrent test ----------
+
+typedef struct
+{
+    pthread_t tid;
+    LazyList *list;
+    LazyAllocator alloc;
+    long ops;
+    int range;
+    long inserted, deleted, found;
+} LazyWorker;
+
+static void *lazyWorkerMain(void *arg)
+{
+    LazyWorker *w = arg;
+    long i;
+
+    for (i = 0; i < w->ops; i++)
+    {
+        uint32_t r = skipRandom(&w->alloc.seed);
+        int key = (int)((r >> 8) % (uint32_t)w->range), op = r % 10;
+
+        if (op == 0)
+            w->inserted += lazyInsert(w->list, &w->alloc, key) == 1;
+        else if (op == 1)
+            w->deleted += lazyDelete(w->list, key);
+        else
+            w->found += lazyContains(w->list, key);
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int concurrentTest(int threads, long ops, int range)
+{
+    LazyWorker *w = calloc(threads, sizeof *w);
+    LazyAllocator setup;
+    LazyList list;
+    LazyNode *p;
+    long expected = 0, count = 0;
+    double start, t;
+    int i, ok = 1;
+
+    lazyAllocatorInit(&setup, 88675123u);
+    if (w == NULL || lazyInit(&list, &setup) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < range; i += 2) // half full to start with
+        expected += lazyInsert(&list, &setup, i) == 1;
+
+    for (i = 0; i < threads; i++)
+    {
+        w[i].list = &list;
+        w[i].ops = ops;
+        w[i].range = range;
+        lazyAllocatorInit(&w[i].alloc, 2463534242u + 7919u * (uint32_t)i);
+    }
+    start = now();
+    for (i = 0; i < threads; i++)
+        pthread_create(&w[i].tid, NULL, lazyWorkerMain, &w[i]);
+    for (i = 0; i < threads; i++)
+    {
+        pthread_join(w[i].tid, NULL);
+        expected += w[i].inserted - w[i].deleted;
+    }
+    t = now() - start;
+
+    // what is left must be sorted, and as many as went in and did not go
+    for (p = atomic_load(&list.head->next[0]); p != list.tail; p = atomic_load(&p->next[0]))
+    {
+        LazyNode *q = atomic_load(&p->next[0]);
+        count++;
+        if (q != list.tail && q->key <= p->key)
+            ok = 0;
+    }
+    printf("%d threads, %ld operations each, keys below %d\n", threads, ops, range);
+    printf("%.3f s, %.2f M operations/s, %ld keys left\n", t, threads * ops / t / 1e6, count);
+    if (!ok || count != expected)
+    {
+        printf("Wrong: %ld keys expected\n", expected);
+        return 1;
+    }
+    for (i = 0; i < threads; i++)
+        lazyAllocatorFree(&w[i].alloc);
+    lazyAllocatorFree(&setup);
+    free(w);
+    return 0;
+}
+
+// ---------- main ----------
+
+int main(int argc, char *argv[])
+{
+    SkipList s;
+    int threads = 0, range = 1 << 16, opt, key, i;
+    long ops = 1000000;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--concurrent") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            ops = atol(argv[++i]);
+        else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc)
+            range = atoi(argv[++i]);
+        else
+            threads = -1;
+    }
+    if (threads < 0 || range < 1 || ops < 0 || (i > 1 && threads == 0))
+    {
+        printf("Usage: %s [--concurrent THREADS [--ops N] [--range R]]\n", argv[0]);
+        return 1;
+    }
+    if (threads > 0)
+        return concurrentTest(threads, ops, range);
+
+    if (skipInit(&s) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (;;)
+    {
+        printf("\nEnter what you wanna do:\n1.Insert\n2.Delete\n3.Search\n4.Display\n5.Quit\n");
+        if (scanf("%d", &opt) != 1 || opt == 5)
+            break;
+        if (opt >= 1 && opt <= 3)
+        {
+            printf("\nEnter the element");
+            if (scanf("%d", &key) != 1)
+                break;
+        }
+        switch (opt)
+        {
+        case 1:
+            if (skipInsert(&s, key) == 0)
+                printf("\n%d is already in the set\n", key);
+            break;
+        case 2:
+            if (!skipDelete(&s, key))
+                printf("\n%d is not in the set\n", key);
+            break;
+        case 3:
+            printf("\n%d is %sin the set\n", key, skipContains(&s, key) ? "" : "not ");
+            break;
+        case 4:
+            skipDisplay(&s);
+            break;
+        }
+    }
+    printf("\n%d elements\n", s.count);
+    skipFree(&s);
+    return 0;
+}
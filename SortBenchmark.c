@@ -0,0 +1,569 @@
+// Sorting benchmark: times every sort engine of this repository on the
+// same inputs and prints one CSV line per engine, input and size.
+//
+//   SortBenchmark [--sizes 1000,10000,...] [--repeats R] [--seed S]
+//                 [--engines name,name,...] [--dists name,name,...]
+//                 [--max-quadratic N] [--counters]
+//
+// Every engine sorts a fresh copy of the input once as a warm-up and
+// then R more times. Columns: engine, distribution, n, repeats, the
+// best and mean time in ns per element, and the comparisons and swaps
+// (element moves for the sorts that do not swap) of one run. Each
+// engine counts those itself. The counting costs the same small amount
+// in every engine, so the times stay comparable. SortLib.h and qsort
+// only count comparisons: their swaps column is empty.
+// Sizes may be written as 1e6. The quadratic engines (and the original
+// first-element-pivot quicksort, which is quadratic on sorted input and
+// recurses n deep) skip sizes above --max-quadratic.
+//
+// --counters adds the hardware counters of PerfCounters.h, read around
+// the R timed runs of each engine: cycles, instructions, L1 data and
+// last-level cache misses, branch misses and data TLB misses, each per
+// element of one run, and the IPC (instructions per cycle). A counter
+// the machine does not have, or that perf_event_paranoid forbids, is
+// left empty. The counting of comparisons and swaps is among the
+// instructions counted, as it is in the times.
+//
+// The engines are copies of the sorts in the programs of this
+// repository, with counters added, since each program has its own main:
+//   bubble     BubbleSort.c, bubble_sort_algo in ARRAY.c
+//   selection  SelectionSort.c, selection_sort in ARRAY.c
+//   insertion  Insertionsort.c
+//   heap       heap sort.c
+//   heap4      heap sort.c --floyd
+//   merge      Mergesort.c, "kth smallest no in an array.c"
+//   bottomup   Mergesort.c --bottom-up
+//   quick      Quicksort.c
+//   intro3     Quicksort.c --three-way
+//   radix      counting_sort.c --radix
+//   sortlib    sort_i32 from SortLib.h
+//   stable     stable_sort_i32 from SortLib.h
+//   qsort      the C library qsort
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "PerfCounters.h"
+
+static unsigned long long cmps, swaps;
+
+#define LESS(x, y) (cmps++, (x) < (y))
+#define SWAP(a, i, j) do { \
+  long i_ = (i), j_ = (j); \
+  int t_ = (a)[i_]; \
+  (a)[i_] = (a)[j_]; \
+  (a)[j_] = t_; \
+  swaps++; \
+} while (0)
+
+#include "SortLib.h"
+SORTLIB_DEFINE(counted, int, LESS)
+
+typedef struct {
+  const char * name;
+  void( * sort)(int * a, size_t n, int * scratch);
+  int quadratic; // skipped above --max-quadratic
+  int counts_swaps; // 0: the swaps column is left empty
+} Engine;
+
+static void bubble(int * a, size_t n, int * scratch) {
+  size_t c, d;
+  (void) scratch;
+  for (c = 0; c + 1 < n; c++)
+    for (d = 0; d + 1 < n - c; d++)
+      if (LESS(a[d + 1], a[d]))
+        SWAP(a, d, d + 1);
+}
+
+static void selection(int * a, size_t n, int * scratch) {
+  size_t i, j, min;
+  (void) scratch;
+  for (i = 0; i + 1 < n; i++) {
+    min = i;
+    for (j = i + 1; j < n; j++)
+      if (LESS(a[j], a[min]))
+        min = j;
+    SWAP(a, min, i);
+  }
+}
+
+static void insertion(int * a, size_t n, int * scratch) {
+  size_t c, d;
+  (void) scratch;
+  for (c = 1; c < n; c++)
+    for (d = c; d > 0 && LESS(a[d], a[d - 1]); d--)
+      SWAP(a, d, d - 1);
+}
+
+static void heap_down(int * a, size_t i, size_t n) {
+  size_t j;
+  while (2 * i + 1 < n) {
+    j = 2 * i + 1;
+    if (j + 1 < n && LESS(a[j], a[j + 1]))
+      j++;
+    if (!LESS(a[i], a[j]))
+      break;
+    SWAP(a, i, j);
+    i = j;
+  }
+}
+
+static void heap(int * a, size_t n, int * scratch) {
+  size_t i;
+  (void) scratch;
+  for (i = n / 2; i-- > 0;)
+    heap_down(a, i, n);
+  for (i = n; i-- > 1;) {
+    SWAP(a, 0, i);
+    heap_down(a, 0, i);
+  }
+}
+
+// heap_sort from heap sort.c: 4-ary heap, Floyd's sift-down
+static void heap4_sift(int * a, size_t i, size_t n, int v) {
+  size_t top = i, c, k, best;
+  while ((c = 4 * i + 1) < n) {
+    best = c;
+    for (k = c + 1; k < c + 4 && k < n; k++)
+      if (LESS(a[best], a[k]))
+        best = k;
+    a[i] = a[best];
+    swaps++;
+    i = best;
+  }
+  while (i > top && LESS(a[(i - 1) / 4], v)) {
+    a[i] = a[(i - 1) / 4];
+    swaps++;
+    i = (i - 1) / 4;
+  }
+  a[i] = v;
+}
+
+static void heap4(int * a, size_t n, int * scratch) {
+  size_t i;
+  int v;
+  (void) scratch;
+  if (n < 2)
+    return;
+  for (i = (n - 2) / 4 + 1; i-- > 0;)
+    heap4_sift(a, i, n, a[i]);
+  for (i = n - 1; i > 0; i--) {
+    v = a[i];
+    a[i] = a[0];
+    heap4_sift(a, 0, i, v);
+  }
+}
+
+// merges a[lo..mid) and a[mid..hi) through scratch, as merge() does
+static void merge_runs(int * a, size_t lo, size_t mid, size_t hi, int * tmp) {
+  size_t i = lo, j = mid, k = 0;
+  while (i < mid && j < hi)
+    tmp[k++] = LESS(a[j], a[i]) ? a[j++] : a[i++];
+  while (i < mid)
+    tmp[k++] = a[i++];
+  while (j < hi)
+    tmp[k++] = a[j++];
+  memcpy(a + lo, tmp, k * sizeof * a);
+  swaps += k;
+}
+
+static void merge_range(int * a, size_t lo, size_t hi, int * tmp) {
+  size_t mid;
+  if (hi - lo < 2)
+    return;
+  mid = lo + (hi - lo) / 2;
+  merge_range(a, lo, mid, tmp);
+  merge_range(a, mid, hi, tmp);
+  merge_runs(a, lo, mid, hi, tmp);
+}
+
+static void merge(int * a, size_t n, int * scratch) {
+  merge_range(a, 0, n, scratch);
+}
+
+static void bottomup(int * a, size_t n, int * scratch) {
+  int * src = a, * dst = scratch, * t;
+  size_t w, lo;
+  for (w = 1; w < n; w *= 2) {
+    for (lo = 0; lo < n; lo += 2 * w) {
+      size_t mid = lo + w < n ? lo + w : n, hi = lo + 2 * w < n ? lo + 2 * w : n;
+      size_t i = lo, j = mid, k = lo;
+      if (mid == hi || !LESS(src[mid], src[mid - 1])) {
+        memcpy(dst + lo, src + lo, (hi - lo) * sizeof * src);
+      } else {
+        while (i < mid && j < hi)
+          dst[k++] = LESS(src[j], src[i]) ? src[j++] : src[i++];
+        while (i < mid)
+          dst[k++] = src[i++];
+        while (j < hi)
+          dst[k++] = src[j++];
+      }
+      swaps += hi - lo;
+    }
+    t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != a) {
+    memcpy(a, src, n * sizeof * a);
+    swaps += n;
+  }
+}
+
+// quick_sort from Quicksort.c: pivot a[l], sentinel-free scans
+static void quick_range(int * a, long l, long u) {
+  while (l < u) {
+    int v = a[l];
+    long i = l, j = u + 1;
+    for (;;) {
+      do
+        i++;
+      while (i <= u && LESS(a[i], v));
+      do
+        j--;
+      while (LESS(v, a[j]));
+      if (i >= j)
+        break;
+      SWAP(a, i, j);
+    }
+    SWAP(a, l, j);
+    quick_range(a, l, j - 1);
+    l = j + 1;
+  }
+}
+
+static void quick(int * a, size_t n, int * scratch) {
+  (void) scratch;
+  quick_range(a, 0, (long) n - 1);
+}
+
+// three_way_sort from Quicksort.c: median-of-three, Bentley-McIlroy partition
+static void intro3_range(int * a, long l, long u) {
+  while (u - l > 16) {
+    long m = l + (u - l) / 2, i = l, j = u + 1, p = l, q = u + 1, k;
+    int v;
+    if (LESS(a[m], a[l]))
+      SWAP(a, m, l);
+    if (LESS(a[u], a[m])) {
+      SWAP(a, u, m);
+      if (LESS(a[m], a[l]))
+        SWAP(a, m, l);
+    }
+    SWAP(a, l, m);
+    v = a[l];
+    for (;;) {
+      while (LESS(a[++i], v))
+        if (i == u)
+          break;
+      while (LESS(v, a[--j]))
+        if (j == l)
+          break;
+      if (i == j && !LESS(a[i], v) && !LESS(v, a[i]))
+        SWAP(a, ++p, i);
+      if (i >= j)
+        break;
+      SWAP(a, i, j);
+      if (!LESS(a[i], v) && !LESS(v, a[i]))
+        SWAP(a, ++p, i);
+      if (!LESS(a[j], v) && !LESS(v, a[j]))
+        SWAP(a, --q, j);
+    }
+    i = j + 1;
+    for (k = l; k <= p; k++)
+      SWAP(a, k, j--);
+    for (k = u; k >= q; k--)
+      SWAP(a, k, i++);
+    if (j - l < u - i) {
+      intro3_range(a, l, j);
+      l = i;
+    } else {
+      intro3_range(a, i, u);
+      u = j;
+    }
+  }
+  insertion(a + l, (size_t)(u - l + 1), NULL);
+}
+
+static void intro3(int * a, size_t n, int * scratch) {
+  (void) scratch;
+  if (n > 1)
+    intro3_range(a, 0, (long) n - 1);
+}
+
+// LSD radix sort with 11-bit digits on the sign-flipped keys,
+// skipping digits that are the same for every key
+static void radix(int * a, size_t n, int * scratch) {
+  static size_t count[3][2048];
+  int * src = a, * dst = scratch, * t;
+  size_t i;
+  int p;
+
+  memset(count, 0, sizeof count);
+  for (i = 0; i < n; i++) {
+    uint32_t k = (uint32_t) a[i] ^ 0x80000000u;
+    count[0][k & 2047]++;
+    count[1][(k >> 11) & 2047]++;
+    count[2][k >> 22]++;
+  }
+  for (p = 0; p < 3; p++) {
+    size_t sum = 0, c;
+    int b;
+    if (n == 0 || count[p][(((uint32_t) src[0] ^ 0x80000000u) >> (11 * p)) & 2047] == n)
+      continue;
+    for (b = 0; b < 2048; b++) {
+      c = count[p][b];
+      count[p][b] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++)
+      dst[count[p][(((uint32_t) src[i] ^ 0x80000000u) >> (11 * p)) & 2047]++] = src[i];
+    swaps += n;
+    t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != a) {
+    memcpy(a, src, n * sizeof * a);
+    swaps += n;
+  }
+}
+
+static void sortlib(int * a, size_t n, int * scratch) {
+  (void) scratch;
+  sort_counted(a, n);
+}
+
+static void stable(int * a, size_t n, int * scratch) {
+  (void) scratch;
+  stable_sort_counted(a, n);
+}
+
+static int qsort_cmp(const void * x, const void * y) {
+  int a = * (const int * ) x, b = * (const int * ) y;
+  cmps++;
+  return (a > b) - (a < b);
+}
+
+static void qsort_engine(int * a, size_t n, int * scratch) {
+  (void) scratch;
+  qsort(a, n, sizeof * a, qsort_cmp);
+}
+
+static const Engine engines[] = {
+  { "bubble", bubble, 1, 1 },
+  { "selection", selection, 1, 1 },
+  { "insertion", insertion, 1, 1 },
+  { "heap", heap, 0, 1 },
+  { "heap4", heap4, 0, 1 },
+  { "merge", merge, 0, 1 },
+  { "bottomup", bottomup, 0, 1 },
+  { "quick", quick, 1, 1 },
+  { "intro3", intro3, 0, 1 },
+  { "radix", radix, 0, 1 },
+  { "sortlib", sortlib, 0, 0 },
+  { "stable", stable, 0, 0 },
+  { "qsort", qsort_engine, 0, 0 },
+};
+
+#define NENGINES (sizeof engines / sizeof engines[0])
+
+// xorshift64*: fast, and the same inputs for a given --seed everywhere
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ULL;
+}
+
+static const char * dists[] = { "random", "sorted", "reversed", "fewunique", "organpipe", "zipf" };
+
+#define NDISTS (sizeof dists / sizeof dists[0])
+
+static void generate(int * a, size_t n, int dist) {
+  size_t i;
+  double logk = log(1e6);
+  for (i = 0; i < n; i++) {
+    switch (dist) {
+    case 0:
+      a[i] = (int)(uint32_t) rng();
+      break;
+    case 1:
+      a[i] = (int) i;
+      break;
+    case 2:
+      a[i] = (int)(n - i);
+      break;
+    case 3:
+      a[i] = (int)(rng() % 16);
+      break;
+    case 4:
+      a[i] = (int)(i < n / 2 ? i : n - i);
+      break;
+    default:
+      // keys 1..1e6 with density proportional to 1/key: a continuous
+      // stand-in for Zipf's law with exponent 1
+      a[i] = (int) exp((double)(rng() >> 11) / 9007199254740992.0 * logk);
+      break;
+    }
+  }
+}
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, & t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// The counters per element, and the IPC after the instructions; a
+// counter that is not there is an empty field
+static void print_counters(const PerfCounters * pc, double elems) {
+  int c;
+  for (c = 0; c < PERF_EVENTS; c++) {
+    putchar(',');
+    if (perfHas(pc, c))
+      printf("%.3f", pc -> value[c] / elems);
+    if (c == PERF_INSTRUCTIONS) {
+      putchar(',');
+      if (perfHas(pc, PERF_CYCLES) && perfHas(pc, PERF_INSTRUCTIONS) && pc -> value[PERF_CYCLES] > 0)
+        printf("%.3f", (double) pc -> value[PERF_INSTRUCTIONS] / pc -> value[PERF_CYCLES]);
+    }
+  }
+}
+
+// 1 if name is one of the comma-separated names in list, or list is NULL
+static int selected(const char * list, const char * name) {
+  size_t len = strlen(name);
+  const char * p = list;
+  if (list == NULL)
+    return 1;
+  while ((p = strstr(p, name)) != NULL) {
+    if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+      return 1;
+    p += len;
+  }
+  return 0;
+}
+
+int main(int argc, char * argv[]) {
+  const char * sizes = "1000,10000,100000,1000000", * only = NULL, * only_dists = NULL, * p;
+  int repeats = 5, i, counters = 0;
+  PerfCounters pc;
+  size_t max_quadratic = 20000, e, d;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+      sizes = argv[++i];
+    else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+      repeats = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      rng_state = strtoull(argv[++i], NULL, 10) | 1;
+    else if (strcmp(argv[i], "--engines") == 0 && i + 1 < argc)
+      only = argv[++i];
+    else if (strcmp(argv[i], "--dists") == 0 && i + 1 < argc)
+      only_dists = argv[++i];
+    else if (strcmp(argv[i], "--max-quadratic") == 0 && i + 1 < argc)
+      max_quadratic = (size_t) strtod(argv[++i], NULL);
+    else if (strcmp(argv[i], "--counters") == 0)
+      counters = 1;
+    else {
+      printf("Usage: %s [--sizes N,N,...] [--repeats R] [--seed S] [--engines a,b] [--dists a,b] [--max-quadratic N] [--counters]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (repeats < 1)
+    repeats = 1;
+
+  if (counters && perfOpen( & pc) != 0)
+    fprintf(stderr, "No hardware counters here (perf_event_paranoid, or no PMU): their columns are empty\n");
+
+  printf("engine,distribution,n,repeats,ns_per_elem_best,ns_per_elem_mean,comparisons,swaps");
+  if (counters) {
+    int c;
+    for (c = 0; c < PERF_EVENTS; c++)
+      printf(",%s%s", perfName(c), c == PERF_INSTRUCTIONS ? ",ipc" : "");
+  }
+  printf("\n");
+
+  for (p = sizes; * p != '\0';) {
+    char * end;
+    size_t n = (size_t) strtod(p, & end);
+    int * input, * work, * scratch;
+
+    if (end == p)
+      break;
+    p = * end == ',' ? end + 1 : end;
+
+    input = malloc((n ? n : 1) * sizeof * input);
+    work = malloc((n ? n : 1) * sizeof * work);
+    scratch = malloc((n ? n : 1) * sizeof * scratch);
+    if (input == NULL || work == NULL || scratch == NULL) {
+      fprintf(stderr, "Out of memory for n = %zu\n", n);
+      free(input);
+      free(work);
+      free(scratch);
+      continue;
+    }
+
+    for (d = 0; d < NDISTS; d++) {
+      if (!selected(only_dists, dists[d]))
+        continue;
+      generate(input, n, (int) d);
+
+      for (e = 0; e < NENGINES; e++) {
+        double best = 1e300, total = 0;
+        size_t k;
+        int r;
+
+        if (!selected(only, engines[e].name) || (engines[e].quadratic && n > max_quadratic))
+          continue;
+
+        if (counters)
+          perfReset( & pc);
+        for (r = -1; r < repeats; r++) { // r = -1 is the warm-up
+          double t;
+          memcpy(work, input, n * sizeof * work);
+          cmps = swaps = 0;
+          if (counters && r >= 0)
+            perfStart( & pc);
+          t = now();
+          engines[e].sort(work, n, scratch);
+          t = now() - t;
+          if (counters && r >= 0)
+            perfStop( & pc);
+          if (r >= 0) {
+            total += t;
+            if (t < best)
+              best = t;
+          }
+        }
+
+        for (k = 1; k < n; k++) {
+          if (work[k] < work[k - 1]) {
+            fprintf(stderr, "%s left %s n = %zu unsorted\n", engines[e].name, dists[d], n);
+            break;
+          }
+        }
+
+        printf("%s,%s,%zu,%d,%.3f,%.3f,%llu,", engines[e].name, dists[d], n, repeats,
+          n ? best * 1e9 / n : 0.0, n ? total / repeats * 1e9 / n : 0.0, cmps);
+        if (engines[e].counts_swaps)
+          printf("%llu", swaps);
+        if (counters)
+          print_counters( & pc, (double) repeats * (n ? n : 1));
+        printf("\n");
+        fflush(stdout);
+      }
+    }
+
+    free(input);
+    free(work);
+    free(scratch);
+  }
+  if (counters)
+    perfClose( & pc);
+  return 0;
+}
@@ -0,0 +1,218 @@
+// Type-specialized sorting for heap buffers of any length.
+//
+// SORTLIB_DEFINE(suffix, type, LESS) writes two functions for one
+// element type, with the comparison LESS(x, y) inlined into them
+// instead of called through a pointer as with qsort:
+//
+//   void sort_<suffix>(type *a, size_t n)
+//       introsort: median-of-three or ninther pivots, insertion sort
+//       below SORTLIB_INSERTION elements, heapsort once the recursion
+//       gets too deep; O(n log n) always, not stable
+//   int stable_sort_<suffix>(type *a, size_t n)
+//       bottom-up merge sort with one n-sized scratch buffer; stable,
+//       returns 0, or -1 when the buffer cannot be allocated
+//
+// Ready-made: i32, i64, u64, f32, f64, and kv (SortKV key + payload
+// pairs, ordered by key). Floats are ordered with NaNs last.
+// Built with -DPROBE, every sort is timed under its name (Probe.h).
+// Header-only: #include "SortLib.h" and call e.g. sort_i64(a, n).
+
+#ifndef SORT_LIB_H
+#define SORT_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Probe.h"
+
+#define SORTLIB_INSERTION 16
+
+#define SORTLIB_DEFINE(suffix, type, LESS)                                     \
+                                                                               \
+static inline void sortlib_insertion_##suffix(type *a, size_t n)               \
+{                                                                              \
+    size_t i, j;                                                               \
+    for (i = 1; i < n; i++)                                                    \
+    {                                                                          \
+        type v = a[i];                                                         \
+        for (j = i; j > 0 && LESS(v, a[j - 1]); j--)                           \
+            a[j] = a[j - 1];                                                   \
+        a[j] = v;                                                              \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline void sortlib_sift_##suffix(type *a, size_t root, size_t n)       \
+{                                                                              \
+    type v = a[root];                                                          \
+    size_t child;                                                              \
+    while ((child = 2 * root + 1) < n)                                         \
+    {                                                                          \
+        if (child + 1 < n && LESS(a[child], a[child + 1]))                     \
+            child++;                                                           \
+        if (!LESS(v, a[child]))                                                \
+            break;                                                             \
+        a[root] = a[child];                                                    \
+        root = child;                                                          \
+    }                                                                          \
+    a[root] = v;                                                               \
+}                                                                              \
+                                                                               \
+static inline void sortlib_heap_##suffix(type *a, size_t n)                    \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = n / 2; i-- > 0;)                                                  \
+        sortlib_sift_##suffix(a, i, n);                                        \
+    for (i = n; i-- > 1;)                                                      \
+    {                                                                          \
+        type t = a[0];                                                         \
+        a[0] = a[i];                                                           \
+        a[i] = t;                                                              \
+        sortlib_sift_##suffix(a, 0, i);                                        \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline size_t sortlib_med3_##suffix(type *a, size_t i, size_t j,        \
+                                           size_t k)                           \
+{                                                                              \
+    if (LESS(a[i], a[j]))                                                      \
+        return LESS(a[j], a[k]) ? j : (LESS(a[i], a[k]) ? k : i);              \
+    return LESS(a[k], a[j]) ? j : (LESS(a[k], a[i]) ? k : i);                  \
+}                                                                              \
+                                                                               \
+static inline void sortlib_intro_##suffix(type *a, size_t n, int depth)        \
+{                                                                              \
+    while (n > SORTLIB_INSERTION)                                              \
+    {                                                                          \
+        size_t m = n / 2, p, i, j;                                             \
+        type v, t;                                                             \
+                                                                               \
+        if (depth-- == 0)                                                      \
+        {                                                                      \
+            sortlib_heap_##suffix(a, n);                                       \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        if (n > 40)                                                            \
+        {                                                                      \
+            size_t s = n / 8;                                                  \
+            p = sortlib_med3_##suffix(a,                                       \
+                    sortlib_med3_##suffix(a, 0, s, 2 * s),                     \
+                    sortlib_med3_##suffix(a, m - s, m, m + s),                 \
+                    sortlib_med3_##suffix(a, n - 1 - 2 * s, n - 1 - s, n - 1));\
+        }                                                                      \
+        else                                                                   \
+            p = sortlib_med3_##suffix(a, 0, m, n - 1);                         \
+                                                                               \
+        /* Hoare partition on v = a[0]; the scans stop on equal keys */        \
+        t = a[0]; a[0] = a[p]; a[p] = t;                                       \
+        v = a[0];                                                              \
+        i = 0;                                                                 \
+        j = n;                                                                 \
+        for (;;)                                                               \
+        {                                                                      \
+            do                                                                 \
+                i++;                                                           \
+            while (i < n && LESS(a[i], v));                                    \
+            do                                                                 \
+                j--;                                                           \
+            while (LESS(v, a[j]));                                             \
+            if (i >= j)                                                        \
+                break;                                                         \
+            t = a[i]; a[i] = a[j]; a[j] = t;                                   \
+        }                                                                      \
+        t = a[0]; a[0] = a[j]; a[j] = t;                                       \
+                                                                               \
+        /* recurse into the smaller side, loop on the larger one */            \
+        if (j < n - 1 - j)                                                     \
+        {                                                                      \
+            sortlib_intro_##suffix(a, j, depth);                               \
+            a += j + 1;                                                        \
+            n -= j + 1;                                                        \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            sortlib_intro_##suffix(a + j + 1, n - 1 - j, depth);               \
+            n = j;                                                             \
+        }                                                                      \
+    }                                                                          \
+    sortlib_insertion_##suffix(a, n);                                          \
+}                                                                              \
+                                                                               \
+static inline void sort_##suffix(type *a, size_t n)                            \
+{                                                                              \
+    int depth = 0;                                                             \
+    size_t m;                                                                  \
+    PROBE_SCOPE("sort_" #suffix);                                              \
+    for (m = n; m > 1; m /= 2)                                                 \
+        depth += 2;                                                            \
+    sortlib_intro_##suffix(a, n, depth);                                       \
+}                                                                              \
+                                                                               \
+static inline int stable_sort_##suffix(type *a, size_t n)                      \
+{                                                                              \
+    type *b, *src = a, *dst, *t;                                               \
+    size_t w, lo;                                                              \
+    PROBE_SCOPE("stable_sort_" #suffix);                                       \
+                                                                               \
+    if (n < 2)                                                                 \
+        return 0;                                                              \
+    b = (type *)malloc(n * sizeof *b);                                         \
+    if (b == NULL)                                                             \
+        return -1;                                                             \
+    dst = b;                                                                   \
+                                                                               \
+    for (lo = 0; lo < n; lo += SORTLIB_INSERTION)                              \
+        sortlib_insertion_##suffix(a + lo, n - lo < SORTLIB_INSERTION ?        \
+                                   n - lo : SORTLIB_INSERTION);                \
+                                                                               \
+    for (w = SORTLIB_INSERTION; w < n; w *= 2)                                 \
+    {                                                                          \
+        for (lo = 0; lo < n; lo += 2 * w)                                      \
+        {                                                                      \
+            size_t mid = lo + w < n ? lo + w : n;                              \
+            size_t hi = lo + 2 * w < n ? lo + 2 * w : n;                       \
+            size_t i = lo, j = mid, k = lo;                                    \
+            if (mid == hi || !LESS(src[mid], src[mid - 1]))                    \
+            {                                                                  \
+                memcpy(dst + lo, src + lo, (hi - lo) * sizeof *src);           \
+                continue;                                                      \
+            }                                                                  \
+            while (i < mid && j < hi)                                          \
+                dst[k++] = LESS(src[j], src[i]) ? src[j++] : src[i++];         \
+            while (i < mid)                                                    \
+                dst[k++] = src[i++];                                           \
+            while (j < hi)                                                     \
+                dst[k++] = src[j++];                                           \
+        }                                                                      \
+        t = src;                                                               \
+        src = dst;                                                             \
+        dst = t;                                                               \
+    }                                                                          \
+                                                                               \
+    if (src != a)                                                              \
+        memcpy(a, src, n * sizeof *a);                                         \
+    free(b);                                                                   \
+    return 0;                                                                  \
+}
+
+// key + payload pair, sorted by key only
+typedef struct
+{
+    uint64_t key;
+    uint64_t value;
+} SortKV;
+
+#define SORTLIB_LESS(x, y) ((x) < (y))
+// NaNs compare greater than every number, so they gather at the end
+#define SORTLIB_LESS_FLOAT(x, y) ((x) < (y) || ((y) != (y) && (x) == (x)))
+#define SORTLIB_LESS_KV(x, y) ((x).key < (y).key)
+
+SORTLIB_DEFINE(i32, int32_t, SORTLIB_LESS)
+SORTLIB_DEFINE(i64, int64_t, SORTLIB_LESS)
+SORTLIB_DEFINE(u64, uint64_t, SORTLIB_LESS)
+SORTLIB_DEFINE(f32, float, SORTLIB_LESS_FLOAT)
+SORTLIB_DEFINE(f64, double, SORTLIB_LESS_FLOAT)
+SORTLIB_DEFINE(kv, SortKV, SORTLIB_LESS_KV)
+
+#endif
@@ -0,0 +1,174 @@
+// Sorting networks for the small subarrays at the bottom of Quicksort.c
+// and Mergesort.c.
+//
+// sortNetwork(a, n) sorts up to SORT_NETWORK_MAX ints. The n values are
+// padded with INT_MAX to a power of two and run through a bitonic
+// network. A network always does the same compare-exchanges in the same
+// order, whatever the data, so unlike insertion sort it has no branches
+// to mispredict. Each compare-exchange is a min and a max: with AVX2 (8
+// lanes) or SSE4.1 (4 lanes) a whole vector of them runs at once,
+// otherwise it is plain branch-free C.
+// Build with -march=native (or -mavx2 / -msse4.1) to get the vector versions.
+
+#ifndef SORT_NETWORK_H
+#define SORT_NETWORK_H
+
+#include <limits.h>
+#include <stddef.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#define SORT_NETWORK_MAX 32
+
+#if defined(__AVX2__)
+
+#define SN_LANES 8
+typedef __m256i SnVec;
+
+static inline SnVec snLoad(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline void snStore(int *p, SnVec v) { _mm256_storeu_si256((__m256i *)p, v); }
+static inline SnVec snMin(SnVec a, SnVec b) { return _mm256_min_epi32(a, b); }
+static inline SnVec snMax(SnVec a, SnVec b) { return _mm256_max_epi32(a, b); }
+static inline SnVec snPick(SnVec a, SnVec b, SnVec mask) { return _mm256_blendv_epi8(a, b, mask); }
+
+// lane i of the result is lane i ^ j of v
+static inline SnVec snPartner(SnVec v, int j)
+{
+    if (j == 4)
+        return _mm256_permute2x128_si256(v, v, 1);
+    if (j == 2)
+        return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline SnVec snMask(const int *m) { return snLoad(m); }
+
+#elif defined(__SSE4_1__)
+
+#define SN_LANES 4
+typedef __m128i SnVec;
+
+static inline SnVec snLoad(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void snStore(int *p, SnVec v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline SnVec snMin(SnVec a, SnVec b) { return _mm_min_epi32(a, b); }
+static inline SnVec snMax(SnVec a, SnVec b) { return _mm_max_epi32(a, b); }
+static inline SnVec snPick(SnVec a, SnVec b, SnVec mask) { return _mm_blendv_epi8(a, b, mask); }
+
+static inline SnVec snPartner(SnVec v, int j)
+{
+    if (j == 2)
+        return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline SnVec snMask(const int *m) { return snLoad(m); }
+
+#endif
+
+#if defined(SN_LANES)
+
+// One step (k, j) of the bitonic network over v[0..n): element i is
+// compared with element i ^ j, and keeps the larger of the two when
+// bit j of i differs from bit k of i (the block of 2k is sorted
+// ascending when bit k is 0).
+static inline void snStep(SnVec *v, int n, int k, int j)
+{
+    int r, i;
+
+    if (j >= SN_LANES)
+    {
+        int stride = j / SN_LANES;
+        for (r = 0; r < n / SN_LANES; r++)
+        {
+            SnVec lo, hi;
+            if (r & stride)
+                continue;
+            lo = snMin(v[r], v[r + stride]);
+            hi = snMax(v[r], v[r + stride]);
+            if ((r * SN_LANES) & k)
+            {
+                v[r] = hi;
+                v[r + stride] = lo;
+            }
+            else
+            {
+                v[r] = lo;
+                v[r + stride] = hi;
+            }
+        }
+        return;
+    }
+
+    for (r = 0; r < n / SN_LANES; r++)
+    {
+        int m[SN_LANES];
+        SnVec other = snPartner(v[r], j);
+        for (i = 0; i < SN_LANES; i++)
+        {
+            int e = r * SN_LANES + i;
+            m[i] = ((e & j) != 0) != ((e & k) != 0) ? -1 : 0;
+        }
+        v[r] = snPick(snMin(v[r], other), snMax(v[r], other), snMask(m));
+    }
+}
+
+static inline void snBitonic(int *buf, int n)
+{
+    SnVec v[SORT_NETWORK_MAX / SN_LANES];
+    int k, j, r;
+
+    for (r = 0; r < n / SN_LANES; r++)
+        v[r] = snLoad(buf + r * SN_LANES);
+    for (k = 2; k <= n; k *= 2)
+        for (j = k / 2; j > 0; j /= 2)
+            snStep(v, n, k, j);
+    for (r = 0; r < n / SN_LANES; r++)
+        snStore(buf + r * SN_LANES, v[r]);
+}
+
+#else
+
+#define SN_LANES 1
+
+// the ternaries compile to conditional moves, not branches
+static inline void snBitonic(int *buf, int n)
+{
+    int k, j, b, i;
+
+    for (k = 2; k <= n; k *= 2)
+        for (j = k / 2; j > 0; j /= 2)
+            for (b = 0; b < n; b += 2 * j)
+                for (i = b; i < b + j; i++)
+                {
+                    int x = buf[i], y = buf[i + j];
+                    int lo = x < y ? x : y, hi = x < y ? y : x;
+                    buf[i] = (i & k) ? hi : lo;
+                    buf[i + j] = (i & k) ? lo : hi;
+                }
+}
+
+#endif
+
+// Sorts a[0..n), n <= SORT_NETWORK_MAX
+static inline void sortNetwork(int *a, size_t n)
+{
+    int buf[SORT_NETWORK_MAX];
+    int size = SN_LANES < 2 ? 2 : SN_LANES;
+    size_t i;
+
+    if (n < 2)
+        return;
+    while ((size_t)size < n)
+        size *= 2;
+    for (i = 0; i < n; i++)
+        buf[i] = a[i];
+    for (; i < (size_t)size; i++)
+        buf[i] = INT_MAX;
+    snBitonic(buf, size);
+    for (i = 0; i < n; i++)
+        a[i] = buf[i];
+}
+
+#endif
@@ -0,0 +1,402 @@
+// Sparse matrices, for SparseMatrix_017.c: only the nonzero entries are
+// stored, so a matrix with 1e8 of them takes about 1.2 GB however many
+// rows and columns it has.
+//
+// A CooMatrix is a list of (row, col, value) triplets in any order, the
+// easy form to build or read; a CsrMatrix (compressed sparse row) keeps
+// the entries of row i at rowStart[i] .. rowStart[i + 1] in increasing
+// column order, the form to compute with:
+//
+//   cooInit / cooAdd / cooFree       the triplet list, grown as needed
+//   csrFromCoo(coo, a)               duplicates added together
+//   csrFromDense(m, a)               from a Matrix (Matrix.h)
+//   csrSpmv(a, x, y)                 y = A x
+//   csrSpmvParallel(pool, a, x, y)   the same on a TaskPool (TaskPool.h)
+//   csrTranspose(a, t)               t = A^T
+//   csrAdd(a, b, c)                  c = A + B
+//
+// csrFromCoo() is two counting sorts: the triplets by column into the
+// transpose, then that transpose by row, which puts every row in column
+// order with no comparison sort. csrTranspose() is the second half of
+// that. Both go through buckets of rows first when the matrix is big
+// (csrScatter()). The parallel SpMV cuts the rows into pieces of about the same
+// number of nonzeros, not the same number of rows, so a few dense rows
+// don't leave one worker with most of the work; every piece writes its
+// own rows of y and nothing is shared.
+//
+// The builders return 0, or -1 when out of memory or when the shapes do
+// not match. Header-only; build with -pthread.
+
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Matrix.h"
+#include "TaskPool.h"
+
+#define SPARSE_PIECES_PER_WORKER 8
+#define SPARSE_BUCKET_ROWS 16384
+#define SPARSE_BUCKETED (1 << 18) // entries worth going through the buckets
+
+typedef struct
+{
+    size_t rows, cols, nnz, cap;
+    uint32_t *row, *col;
+    double *val;
+} CooMatrix;
+
+typedef struct
+{
+    size_t rows, cols, nnz;
+    size_t *rowStart;  // rows + 1 entries
+    uint32_t *col;
+    double *val;
+} CsrMatrix;
+
+static inline void cooInit(CooMatrix *c, size_t rows, size_t cols)
+{
+    memset(c, 0, sizeof *c);
+    c->rows = rows;
+    c->cols = cols;
+}
+
+static inline void cooFree(CooMatrix *c)
+{
+    free(c->row);
+    free(c->col);
+    free(c->val);
+    c->row = c->col = NULL;
+    c->val = NULL;
+    c->nnz = c->cap = 0;
+}
+
+// 0, or -1 when out of memory or (i, j) is outside the matrix
+static inline int cooAdd(CooMatrix *c, size_t i, size_t j, double v)
+{
+    if (i >= c->rows || j >= c->cols || j > UINT32_MAX || i > UINT32_MAX)
+        return -1;
+    if (c->nnz == c->cap)
+    {
+        size_t cap = c->cap ? 2 * c->cap : 1024;
+        uint32_t *row = (uint32_t *)realloc(c->row, cap * sizeof *row);
+        uint32_t *col;
+        double *val;
+        if (row == NULL)
+            return -1;
+        c->row = row;
+        col = (uint32_t *)realloc(c->col, cap * sizeof *col);
+        if (col == NULL)
+            return -1;
+        c->col = col;
+        val = (double *)realloc(c->val, cap * sizeof *val);
+        if (val == NULL)
+            return -1;
+        c->val = val;
+        c->cap = cap;
+    }
+    c->row[c->nnz] = (uint32_t)i;
+    c->col[c->nnz] = (uint32_t)j;
+    c->val[c->nnz] = v;
+    c->nnz++;
+    return 0;
+}
+
+static inline void csrFree(CsrMatrix *a)
+{
+    free(a->rowStart);
+    free(a->col);
+    free(a->val);
+    memset(a, 0, sizeof *a);
+}
+
+static inline int csrAlloc(CsrMatrix *a, size_t rows, size_t cols, size_t nnz)
+{
+    memset(a, 0, sizeof *a);
+    a->rows = rows;
+    a->cols = cols;
+    a->nnz = nnz;
+    a->rowStart = (size_t *)calloc(rows + 1, sizeof *a->rowStart);
+    a->col = (uint32_t *)malloc((nnz ? nnz : 1) * sizeof *a->col);
+    a->val = (double *)malloc((nnz ? nnz : 1) * sizeof *a->val);
+    if (a->rowStart == NULL || a->col == NULL || a->val == NULL)
+    {
+        csrFree(a);
+        return -1;
+    }
+    return 0;
+}
+
+// count[k] = how many keys before k, over keys[0 .. n) of values below
+// size; count needs size + 1 entries, the last ending up n
+static inline void csrCount(const uint32_t *keys, size_t n, size_t size, size_t *count)
+{
+    size_t k, sum = 0;
+    for (k = 0; k < n; k++)
+        count[keys[k] + 1]++;
+    for (k = 0; k <= size; k++)
+    {
+        sum += count[k];
+        count[k] = sum;
+    }
+}
+
+// out (allocated, size rows) = the entries (key[k], other[k], val[k]),
+// k < n, as (row, col, value), each row in the order the entries come.
+// Straight into place, every entry is a cache miss, and a TLB miss too
+// once the rows span more than the TLB covers; so with many rows they go
+// first to buckets of SPARSE_BUCKET_ROWS rows, in order, and then from
+// one bucket at a time, whose rows are close enough to stay in cache.
+static inline int csrScatter(const uint32_t *key, const uint32_t *other, const double *val, size_t n, CsrMatrix *out)
+{
+    size_t *next, k, size = out->rows;
+    next = (size_t *)malloc((size + 1) * sizeof *next);
+    if (next == NULL)
+        return -1;
+    csrCount(key, n, size, out->rowStart);
+    memcpy(next, out->rowStart, (size + 1) * sizeof *next);
+    if (size > SPARSE_BUCKET_ROWS && n >= SPARSE_BUCKETED)
+    {
+        size_t buckets = size / SPARSE_BUCKET_ROWS + 1, *fill = (size_t *)calloc(buckets + 1, sizeof *fill), b;
+        uint32_t *bucketKey = (uint32_t *)malloc(n * sizeof *bucketKey);
+        uint32_t *bucketOther = (uint32_t *)malloc(n * sizeof *bucketOther);
+        double *bucketVal = (double *)malloc(n * sizeof *bucketVal);
+        if (fill != NULL && bucketKey != NULL && bucketOther != NULL && bucketVal != NULL)
+        {
+            // where each bucket starts, from the row counts
+            for (b = 0; b <= buckets; b++)
+                fill[b] = out->rowStart[b * SPARSE_BUCKET_ROWS < size ? b * SPARSE_BUCKET_ROWS : size];
+            for (k = 0; k < n; k++)
+            {
+                size_t at = fill[key[k] / SPARSE_BUCKET_ROWS]++;
+                bucketKey[at] = key[k];
+                bucketOther[at] = other[k];
+                bucketVal[at] = val[k];
+            }
+            key = bucketKey;
+            other = bucketOther;
+            val = bucketVal;
+            for (k = 0; k < n; k++)
+            {
+                size_t at = next[key[k]]++;
+                out->col[at] = other[k];
+                out->val[at] = val[k];
+            }
+            n = 0;
+        }
+        free(fill);
+        free(bucketKey);
+        free(bucketOther);
+        free(bucketVal);
+    }
+    // small, or no memory for the buckets
+    for (k = 0; k < n; k++)
+    {
+        size_t at = next[key[k]]++;
+        out->col[at] = other[k];
+        out->val[at] = val[k];
+    }
+    free(next);
+    return 0;
+}
+
+static inline int csrTranspose(const CsrMatrix *a, CsrMatrix *t)
+{
+    uint32_t *row;
+    size_t i, k;
+    int rc;
+    if (csrAlloc(t, a->cols, a->rows, a->nnz) != 0)
+        return -1;
+    row = (uint32_t *)malloc((a->nnz ? a->nnz : 1) * sizeof *row);
+    if (row == NULL)
+    {
+        csrFree(t);
+        return -1;
+    }
+    for (i = 0; i < a->rows; i++)
+        for (k = a->rowStart[i]; k < a->rowStart[i + 1]; k++)
+            row[k] = (uint32_t)i;
+    // rows in order, so every row of t comes out in column order
+    rc = csrScatter(a->col, row, a->val, a->nnz, t);
+    free(row);
+    if (rc != 0)
+        csrFree(t);
+    return rc;
+}
+
+// Adds up entries with the same column, which are next to each other in
+// a sorted row, and closes up the gaps
+static inline void csrMergeDuplicates(CsrMatrix *a)
+{
+    size_t i, k, out = 0, begin = 0;
+    for (i = 0; i < a->rows; i++)
+    {
+        size_t end = a->rowStart[i + 1];
+        a->rowStart[i] = out;
+        for (k = begin; k < end; k++)
+        {
+            if (out > a->rowStart[i] && a->col[out - 1] == a->col[k])
+                a->val[out - 1] += a->val[k];
+            else
+            {
+                a->col[out] = a->col[k];
+                a->val[out] = a->val[k];
+                out++;
+            }
+        }
+        begin = end;
+    }
+    a->rowStart[a->rows] = out;
+    a->nnz = out;
+}
+
+static inline int csrFromCoo(const CooMatrix *c, CsrMatrix *a)
+{
+    CsrMatrix t;
+    int rc;
+    // the transpose first: row j of t holds column j, in input order
+    if (csrAlloc(&t, c->cols, c->rows, c->nnz) != 0)
+        return -1;
+    rc = csrScatter(c->col, c->row, c->val, c->nnz, &t);
+    if (rc == 0)
+        rc = csrTranspose(&t, a);
+    csrFree(&t);
+    if (rc != 0)
+        return -1;
+    csrMergeDuplicates(a);
+    return 0;
+}
+
+// The nonzero entries of m
+static inline int csrFromDense(const Matrix *m, CsrMatrix *a)
+{
+    size_t nnz = 0, i, j, k = 0;
+    for (i = 0; i < m->rows; i++)
+    {
+        const int *row = matrixRow(m, i);
+        for (j = 0; j < m->cols; j++)
+            nnz += row[j] != 0;
+    }
+    if (csrAlloc(a, m->rows, m->cols, nnz) != 0)
+        return -1;
+    for (i = 0; i < m->rows; i++)
+    {
+        const int *row = matrixRow(m, i);
+        a->rowStart[i] = k;
+        for (j = 0; j < m->cols; j++)
+            if (row[j] != 0)
+            {
+                a->col[k] = (uint32_t)j;
+                a->val[k] = row[j];
+                k++;
+            }
+    }
+    a->rowStart[m->rows] = k;
+    return 0;
+}
+
+// y[i] = row i of A times x, for rows begin .. end
+static inline void csrSpmvRows(const CsrMatrix *a, const double *x, double *y, size_t begin, size_t end)
+{
+    size_t i, k;
+    for (i = begin; i < end; i++)
+    {
+        double sum = 0;
+        for (k = a->rowStart[i]; k < a->rowStart[i + 1]; k++)
+            sum += a->val[k] * x[a->col[k]];
+        y[i] = sum;
+    }
+}
+
+static inline void csrSpmv(const CsrMatrix *a, const double *x, double *y)
+{
+    csrSpmvRows(a, x, y, 0, a->rows);
+}
+
+typedef struct
+{
+    const CsrMatrix *a;
+    const double *x;
+    double *y;
+    size_t pieces;
+} CsrSpmvJob;
+
+// The first row whose entries start at or after nonzero number k
+static inline size_t csrRowOfNonzero(const CsrMatrix *a, size_t k)
+{
+    size_t lo = 0, hi = a->rows;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a->rowStart[mid] < k)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static inline void csrSpmvPieces(size_t begin, size_t end, void *arg)
+{
+    CsrSpmvJob *job = (CsrSpmvJob *)arg;
+    size_t p;
+    for (p = begin; p < end; p++)
+    {
+        // piece p is the rows from nonzero nnz p / pieces on
+        size_t first = p == 0 ? 0 : csrRowOfNonzero(job->a, (size_t)((unsigned __int128)job->a->nnz * p / job->pieces));
+        size_t last = p + 1 == job->pieces ? job->a->rows
+                                           : csrRowOfNonzero(job->a, (size_t)((unsigned __int128)job->a->nnz * (p + 1) / job->pieces));
+        csrSpmvRows(job->a, job->x, job->y, first, last);
+    }
+}
+
+static inline void csrSpmvParallel(TaskPool *pool, const CsrMatrix *a, const double *x, double *y)
+{
+    CsrSpmvJob job;
+    job.a = a;
+    job.x = x;
+    job.y = y;
+    job.pieces = (size_t)pool->nthreads * SPARSE_PIECES_PER_WORKER;
+    poolParallelFor(pool, 0, job.pieces, 1, csrSpmvPieces, &job);
+}
+
+static inline int csrAdd(const CsrMatrix *a, const CsrMatrix *b, CsrMatrix *c)
+{
+    size_t i, out = 0;
+    if (a->rows != b->rows || a->cols != b->cols)
+        return -1;
+    if (csrAlloc(c, a->rows, a->cols, a->nnz + b->nnz) != 0)
+        return -1;
+    // both rows are in column order, so one merge each
+    for (i = 0; i < a->rows; i++)
+    {
+        size_t p = a->rowStart[i], pe = a->rowStart[i + 1];
+        size_t q = b->rowStart[i], qe = b->rowStart[i + 1];
+        c->rowStart[i] = out;
+        while (p < pe || q < qe)
+        {
+            if (q == qe || (p < pe && a->col[p] < b->col[q]))
+            {
+                c->col[out] = a->col[p];
+                c->val[out++] = a->val[p++];
+            }
+            else if (p == pe || b->col[q] < a->col[p])
+            {
+                c->col[out] = b->col[q];
+                c->val[out++] = b->val[q++];
+            }
+            else
+            {
+                c->col[out] = a->col[p];
+                c->val[out++] = a->val[p++] + b->val[q++];
+            }
+        }
+    }
+    c->rowStart[a->rows] = out;
+    c->nnz = out;
+    return 0;
+}
+
+#endif
@@ -1,20 +1,184 @@
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "Matrix.h"
+#include "SparseMatrix.h"
 
-int main()
+// Run with --triplets FILE for a matrix too big to enter: a line with
+// the number of rows and columns, then one "row column value" line per
+// nonzero entry, counting from 0. --bench ROWS PER_ROW THREADS times the
+// sparse operations on a random matrix.
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int read_triplets(const char *path)
+{
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    size_t rows, cols, i, j;
+    double v, sum = 0, t0, t1, t2;
+    CooMatrix coo;
+    CsrMatrix a;
+    double *x, *y;
+    int rc = 0;
+    if(f == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    if(fscanf(f, "%zu %zu", &rows, &cols) != 2)
+    {
+        printf("No matrix size in %s\n", path);
+        return 1;
+    }
+    t0 = now();
+    cooInit(&coo, rows, cols);
+    while(fscanf(f, "%zu %zu %lf", &i, &j, &v) == 3)
+    {
+        if(cooAdd(&coo, i, j, v) != 0)
+        {
+            printf("Bad entry (%zu, %zu) or out of memory\n", i, j);
+            rc = 1;
+            break;
+        }
+    }
+    if(f != stdin)
+        fclose(f);
+    if(rc != 0 || csrFromCoo(&coo, &a) != 0)
+    {
+        if(rc == 0)
+            printf("Out of memory\n");
+        cooFree(&coo);
+        return 1;
+    }
+    cooFree(&coo);
+    t1 = now();
+    x = malloc((cols ? cols : 1) * sizeof *x);
+    y = malloc((rows ? rows : 1) * sizeof *y);
+    if(x == NULL || y == NULL)
+    {
+        printf("Out of memory\n");
+        free(x); free(y); csrFree(&a);
+        return 1;
+    }
+    for(j = 0; j < cols; j++)
+        x[j] = 1;
+    csrSpmv(&a, x, y);
+    t2 = now();
+    for(i = 0; i < rows; i++)
+        sum += y[i];
+    printf("%zu x %zu, %zu nonzero entries (%.3g%%), read in %.3f s\n", rows, cols, a.nnz,
+           rows && cols ? 100.0 * a.nnz / ((double)rows * cols) : 0.0, t1 - t0);
+    printf("Sum of all entries, from A times ones: %g (%.3f s)\n", sum, t2 - t1);
+    free(x); free(y); csrFree(&a);
+    return 0;
+}
+
+static int bench(size_t rows, size_t per_row, int threads)
 {
+    CooMatrix coo;
+    CsrMatrix a, t, tt, s;
+    TaskPool pool;
+    double *x, *y1, *y2, t0, t1, t2, t3, t4, t5;
+    uint64_t seed = 88172645463325252ULL;
+    size_t i, k;
+    int bad = 0;
+    cooInit(&coo, rows, rows);
+    for(i = 0; i < rows; i++)
+        for(k = 0; k < per_row; k++)
+        {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            if(cooAdd(&coo, i, seed % rows, (double)(seed >> 40 & 15) - 7) != 0)
+            {
+                printf("Out of memory\n");
+                cooFree(&coo);
+                return 1;
+            }
+        }
+    x = malloc(rows * sizeof *x);
+    y1 = malloc(rows * sizeof *y1);
+    y2 = malloc(rows * sizeof *y2);
+    if(x == NULL || y1 == NULL || y2 == NULL || poolCreate(&pool, threads) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for(i = 0; i < rows; i++)
+        x[i] = (double)(i % 7) - 3;
+    t0 = now();
+    if(csrFromCoo(&coo, &a) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    cooFree(&coo);
+    t1 = now();
+    csrSpmv(&a, x, y1);
+    t2 = now();
+    csrSpmvParallel(&pool, &a, x, y2);
+    t3 = now();
+    bad |= memcmp(y1, y2, rows * sizeof *y1) != 0;
+    if(csrTranspose(&a, &t) != 0 || csrTranspose(&t, &tt) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    t4 = now();
+    bad |= tt.nnz != a.nnz || memcmp(tt.rowStart, a.rowStart, (rows + 1) * sizeof *a.rowStart) != 0 ||
+           memcmp(tt.col, a.col, a.nnz * sizeof *a.col) != 0 || memcmp(tt.val, a.val, a.nnz * sizeof *a.val) != 0;
+    if(csrAdd(&a, &t, &s) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    t5 = now();
+    // (A + A^T) x = A x + A^T x
+    csrSpmv(&t, x, y2);
+    for(i = 0; i < rows; i++)
+        y1[i] += y2[i];
+    csrSpmv(&s, x, y2);
+    for(i = 0; i < rows; i++)
+        bad |= y1[i] != y2[i];
+    printf("%zu rows, %zu nonzero: build %.3f s, SpMV %.3f s (%.2f GFLOP/s), on %d threads %.3f s, "
+           "2 transposes %.3f s, A + A^T %.3f s%s\n", rows, a.nnz, t1 - t0, t2 - t1, 2.0 * a.nnz / (t2 - t1) / 1e9,
+           threads, t3 - t2, t4 - t3, t5 - t4, bad ? " MISMATCH" : "");
+    poolDestroy(&pool);
+    csrFree(&a); csrFree(&t); csrFree(&tt); csrFree(&s);
+    free(x); free(y1); free(y2);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc == 3 && strcmp(argv[1], "--triplets") == 0)
+        return read_triplets(argv[2]);
+    if(argc == 5 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10), atoi(argv[4]));
+
     printf("\n\n\t\tStudytonight - Best place to learn\n\n\n");
-    int n, m, c, d, matrix[10][10];
+    int n, m, c, d;
+    Matrix matrix;
+    CsrMatrix sparse;
     int counter = 0;
     printf("\nEnter the number of rows and columns of the matrix \n\n");
-    scanf("%d%d",&m,&n);
+    if(scanf("%d%d",&m,&n) != 2 || m <= 0 || n <= 0 || matrixInit(&matrix, m, n) != 0)
+    {
+        printf("\nInvalid order\n");
+        return 1;
+    }
 
     printf("\nEnter the %d elements of the matrix \n\n", m*n);
     for(c = 0; c < m; c++)   // to iterate the rows
     {
         for(d = 0; d < n; d++)   // to iterate the columns
         {
-            scanf("%d", &matrix[c][d]);
-            if(matrix[c][d] == 0)
+            scanf("%d", matrixAt(&matrix, c, d));
+            if(*matrixAt(&matrix, c, d) == 0)
             counter++;  // same as counter=counter +1
         }
     }
@@ -25,11 +189,28 @@ int main()
     {
         for(d = 0; d < n; d++)   // to iterate the columns
         {
-            printf("%d\t", matrix[c][d]);
+            printf("%d\t", *matrixAt(&matrix, c, d));
         }
     printf("\n"); // to take the control to the next row
     }
 
+    // the same matrix keeping only the nonzero entries
+    if(csrFromDense(&matrix, &sparse) == 0)
+    {
+        printf("\n\nIn compressed sparse row form:\n\nRow starts:");
+        for(c = 0; c <= m; c++)
+            printf(" %zu", sparse.rowStart[c]);
+        printf("\nColumns:   ");
+        for(c = 0; c < (int)sparse.nnz; c++)
+            printf(" %u", sparse.col[c]);
+        printf("\nValues:    ");
+        for(c = 0; c < (int)sparse.nnz; c++)
+            printf(" %g", sparse.val[c]);
+        printf("\n");
+        csrFree(&sparse);
+    }
+    matrixFree(&matrix);
+
     // checking if the matrix is sparse or not
     if(counter > (m*n)/2)
         printf("\n\nThe entered matrix is a sparse matrix\n\n");
@@ -1,41 +1,118 @@
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "Matrix.h"
+#include "OutBuffer.h"
 #define Row 4
 #define Col 3
-void spiral_matrix(int r, int c, int arr[Row][Col])
+void spiral_matrix(const Matrix *m)
 {
 	int i;
+	int r = m->rows, c = m->cols;
 	int k = 0, l = 0;
 	while (k < r && l < c)
 	{
 		for (i = l; i < c ; ++i) {
-			printf("%d\t", arr[k][i]);
+			printf("%d\t", *matrixAt(m, k, i));
 		}
 		k++;
 		
 		for (i = k; i < r; ++i) {
-			printf("%d\t", arr[i][c - 1]);
+			printf("%d\t", *matrixAt(m, i, c - 1));
 		}
 		c--;
 		if (k < r) {
 			for (i = c - 1; i >= l; --i) {
-				printf("%d\t", arr[r - 1][i]);
+				printf("%d\t", *matrixAt(m, r - 1, i));
 			}
 		r--;
 	    }
 	    if (l < c) {
 	    	for (i = r - 1 ; i >= k; --i) {
-	    		printf("%d\t", arr[i][l]);
+	    		printf("%d\t", *matrixAt(m, i, l));
 			}
 			l++;
 		}
 	}
 }
 
-int main()
+// --bench R C times spiral_matrix() against matrixSpiral() and an
+// OutBuffer on an R x C matrix; both print it, so send stdout to a file
+// or /dev/null. --zigzag prints the example in zigzag order instead.
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int print_order(const Matrix *m, size_t (*order)(const Matrix *, int *))
+{
+	OutBuffer o;
+	int *out = malloc((m->rows * m->cols + 1) * sizeof *out);
+	size_t n;
+	if (out == NULL || outInit(&o, stdout, 0) != 0)
+	{
+		free(out);
+		return -1;
+	}
+	n = order(m, out);
+	outInts(&o, out, n, "\t");
+	free(out);
+	return outClose(&o);
+}
+
+static int bench(size_t r, size_t c)
+{
+	Matrix m;
+	OutBuffer o;
+	int *out;
+	size_t i, j;
+	double t0, t1, t2, t3;
+	if (matrixInit(&m, r, c) != 0 || (out = malloc((r * c + 1) * sizeof *out)) == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < r; i++)
+		for (j = 0; j < c; j++)
+			*matrixAt(&m, i, j) = (int)(i * c + j);
+	t0 = now();
+	spiral_matrix(&m);
+	printf("\n");
+	fflush(stdout);
+	t1 = now();
+	matrixSpiral(&m, out);
+	t2 = now();
+	outInit(&o, stdout, 0);
+	outInts(&o, out, r * c, "\t");
+	outChar(&o, '\n');
+	outClose(&o);
+	t3 = now();
+	fprintf(stderr, "%zu x %zu: printf walk %.3f s, matrixSpiral %.3f s + OutBuffer %.3f s\n",
+		r, c, t1 - t0, t2 - t1, t3 - t2);
+	free(out);
+	matrixFree(&m);
+	return 0;
+}
+
+int main(int argc, char *argv[])
 {
 	  int a[Row][Col] = {{1, 2, 3}, {10, 20, 30}, {110, 220, 330}, {1100, 2200, 3300}};
+	  Matrix m;
+	  int i, j, rc;
      
-    spiral_matrix (Row, Col, a);
-    return (0);
+	  if (argc == 4 && strcmp(argv[1], "--bench") == 0)
+		  return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10));
+	  if (matrixInit(&m, Row, Col) != 0)
+		  return (1);
+	  for (i = 0; i < Row; i++)
+		  for (j = 0; j < Col; j++)
+			  *matrixAt(&m, i, j) = a[i][j];
+	  // the whole spiral into a buffer, then out in one write
+	  rc = print_order(&m, argc == 2 && strcmp(argv[1], "--zigzag") == 0 ? matrixZigzag : matrixSpiral);
+	  matrixFree(&m);
+    return (rc != 0);
 }
 	
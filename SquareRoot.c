@@ -1,33 +1,108 @@
 /* Program to find the square root of a number
  * - the current implementation uses the Newton-Raphson method
  * - mathematical explanation can be found online, and requires basic calculus knowledge
+ * - run with --isqrt N for the integer square root of N (up to 2^64 - 1),
+ *   or with --bench N to time the ways of taking N square roots
  */
 
 #include <stdio.h>
-#include <math.h> // for 'fabs' - returns unsigned absolute value
-
-const double MAX_ERROR = 1e-7; // equivalent to 10^-7 -> accurate upto 7 decimal places
-							   // can be set according to need or even taken in as input 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "SquareRoot.h"
 
 double squareRoot(int x)
 {
-	double r = 1; // initial guess for the root
-	while (fabs(r*r - x) > MAX_ERROR)
+	// starting from 1 took dozens of steps for a large x, and checking
+	// |r^2 - x| against a fixed 1e-7 never ended for some x, where r^2
+	// cannot get that close; newtonSqrt() starts from x's exponent halved
+	// and stops on a relative change
+	return newtonSqrt(x);
+}
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Newton's method as it was, from 1, but with a relative tolerance so
+// that it ends
+static double fromOne(double x)
+{
+	double r = 1, next;
+	if (x <= 0)
+		return 0;
+	for (;;)
 	{
-		r = (r + x/r) / 2; 
-		// value of 'r' moves closer and closer to the actual root value
+		next = (r + x / r) / 2;
+		if (fabs(next - r) <= SQRT_TOLERANCE * next)
+			return next;
+		r = next;
 	}
+}
 
-	return r;
+static int bench(size_t n)
+{
+	double *x = malloc(n * sizeof *x), *y = malloc(n * sizeof *y), t[5], sum[4] = {0};
+	float *xf = malloc(n * sizeof *xf), *yf = malloc(n * sizeof *yf);
+	size_t i, bad = 0;
+	uint64_t seed = 88172645463325252ULL;
+	if (x == NULL || y == NULL || xf == NULL || yf == NULL)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+	// squared distances, from a few units up to a few million
+	for (i = 0; i < n; i++)
+	{
+		seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+		x[i] = (double)(seed >> 11) * 0x1p-53 * 1e13;
+		xf[i] = (float)x[i];
+	}
+	memset(y, 0, n * sizeof *y);
+	memset(yf, 0, n * sizeof *yf);
+	t[0] = now();
+	for (i = 0; i < n; i++)
+		sum[0] += fromOne(x[i]);
+	t[1] = now();
+	for (i = 0; i < n; i++)
+		sum[1] += newtonSqrt(x[i]);
+	t[2] = now();
+	sqrtArray(x, y, n);
+	t[3] = now();
+	sqrtArrayFloats(xf, yf, n);
+	t[4] = now();
+	for (i = 0; i < n; i++)
+	{
+		bad += y[i] != sqrt(x[i]);
+		sum[2] += y[i];
+		sum[3] += yf[i];
+	}
+	printf("%zu roots: Newton from 1 %.3f s, newtonSqrt %.3f s, sqrtArray %.3f s, sqrtArrayFloats %.3f s\n",
+	       n, t[1] - t[0], t[2] - t[1], t[3] - t[2], t[4] - t[3]);
+	printf("sums %.17g %.17g %.17g %.9g%s\n", sum[0], sum[1], sum[2], sum[3], bad ? " MISMATCH" : "");
+	free(x); free(y); free(xf); free(yf);
+	return bad != 0;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
 	// the number for which we expect to compute the root
 	int num;
+	if (argc == 3 && strcmp(argv[1], "--isqrt") == 0)
+	{
+		printf("%llu\n", (unsigned long long)isqrt64(strtoull(argv[2], NULL, 10)));
+		return 0;
+	}
+	if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoul(argv[2], NULL, 10));
+
 	scanf("%d", &num);
 
 	printf("%lf \n", squareRoot(num));
 
 	return 0;
-}
\ No newline at end of file
+}
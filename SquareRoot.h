@@ -0,0 +1,149 @@
+// Square roots, for SquareRoot.c and the distance computations that need
+// them in bulk.
+//
+// newtonSqrt() is Newton's method, r = (r + x / r) / 2, started from an
+// estimate that is already within 5% instead of from 1: x's exponent
+// halved, which is the bits of the double shifted right by one with half
+// the exponent bias added back, and a constant that balances the error
+// over the mantissa. Each step squares the relative error, so
+// SQRT_NEWTON_STEPS steps reach full precision for any x, and the loop
+// stops early once a step changes r by less than a relative
+// SQRT_TOLERANCE. Subnormal x are scaled up by 2^54 first, as the
+// estimate needs a normal exponent. The result is within one ulp of
+// sqrt(), and with FMA, where a last step takes the exact r^2 - x, it
+// is almost always sqrt() to the bit; 0, infinity and NaN come back as
+// they are and a negative x gives NaN.
+//
+// isqrt64() is the exact floor(sqrt(n)) of a 64-bit n: the double root,
+// then moved by one where rounding n to a double put it on the wrong
+// side.
+//
+// sqrtArray() and sqrtArrayFloats() do whole arrays. A vector Newton step
+// costs a division, which is as dear as the square root instruction
+// itself, so the doubles go four at a time through vsqrtpd with AVX, two
+// through sqrtpd with SSE2, correctly rounded like sqrt(). The floats,
+// where an answer good to about 2^-22 is usually enough for a distance,
+// take vrsqrtps, an estimate of 1 / sqrt(x) good to 12 bits, one Newton
+// step on that and a multiply by x: no division at all. Header-only.
+
+#ifndef SQUARE_ROOT_H
+#define SQUARE_ROOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SQRT_NEWTON_STEPS 4
+#define SQRT_TOLERANCE 0x1p-52
+#define SQRT_MAGIC 0x1FF7A3BEA91D9B1BULL
+
+static inline double sqrtEstimate(double x)
+{
+    uint64_t i;
+    memcpy(&i, &x, sizeof i);
+    i = (i >> 1) + SQRT_MAGIC;
+    memcpy(&x, &i, sizeof x);
+    return x;
+}
+
+static inline double newtonSqrt(double x)
+{
+    double r, scale = 1;
+    int k;
+    // 0, NaN and infinity, and the negatives
+    if (!(x > 0) || x > 0x1.fffffffffffffp1023)
+        return x == 0 || x != x || x > 0 ? x : (x - x) / (x - x);
+    if (x < 0x1p-1022)
+    {
+        x *= 0x1p54;
+        scale = 0x1p-27;
+    }
+    r = sqrtEstimate(x);
+    for (k = 0; k < SQRT_NEWTON_STEPS; k++)
+    {
+        double next = (r + x / r) / 2, d = next - r;
+        r = next;
+        if (d <= SQRT_TOLERANCE * r && -d <= SQRT_TOLERANCE * r)
+            break;
+    }
+#if defined(__FMA__)
+    // r r - x exactly, for one last step that rounds r correctly
+    r -= __builtin_fma(r, r, -x) / (2 * r);
+#endif
+    return r * scale;
+}
+
+// floor(sqrt(n)), exactly
+static inline uint64_t isqrt64(uint64_t n)
+{
+    uint64_t r = (uint64_t)newtonSqrt((double)n);
+    // the root of 2^64 - 1 is just under 2^32, but n rounds up to 2^64
+    if (r > 0xFFFFFFFFu)
+        r = 0xFFFFFFFFu;
+    while (r * r > n)
+        r--;
+    while (r < 0xFFFFFFFFu && (r + 1) * (r + 1) <= n)
+        r++;
+    return r;
+}
+
+// out[i] = sqrt(in[i]) for i < n; in may be out
+static inline void sqrtArray(const double *in, double *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(in + i), x1 = _mm256_loadu_pd(in + i + 4);
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(x0));
+        _mm256_storeu_pd(out + i + 4, _mm256_sqrt_pd(x1));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128d x0 = _mm_loadu_pd(in + i), x1 = _mm_loadu_pd(in + i + 2);
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(x0));
+        _mm_storeu_pd(out + i + 2, _mm_sqrt_pd(x1));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = __builtin_sqrt(in[i]);
+}
+
+#if defined(__AVX__)
+// sqrt(x) = x / sqrt(x): y = rsqrt(x), refined once to y (3 - x y^2) / 2,
+// times x; a zero x would give 0 times infinity, so those stay 0
+static inline __m256 sqrtApprox8(__m256 x)
+{
+    __m256 y = _mm256_rsqrt_ps(x), xy = _mm256_mul_ps(x, y);
+    __m256 r = _mm256_mul_ps(_mm256_mul_ps(xy, _mm256_set1_ps(0.5f)),
+                             _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(xy, y)));
+    return _mm256_and_ps(r, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+}
+#endif
+
+// out[i] close to sqrtf(in[i]), to about 2^-22 relative, for i < n; in may
+// be out. For x zero or a normal, finite float; a subnormal or an
+// infinity comes out as NaN.
+static inline void sqrtArrayFloats(const float *in, float *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 x0 = _mm256_loadu_ps(in + i), x1 = _mm256_loadu_ps(in + i + 8);
+        _mm256_storeu_ps(out + i, sqrtApprox8(x0));
+        _mm256_storeu_ps(out + i + 8, sqrtApprox8(x1));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = __builtin_sqrtf(in[i]);
+}
+
+#endif
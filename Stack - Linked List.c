@@ -1,5 +1,11 @@
+/* A stack of chars as a linked list: a malloc per push and a free per pop.
+   Run with --bench N to time N pushes and pops on it and on the array and
+   chunked stacks of Stack.h, which do neither. */
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "Stack.h"
 #define SIZE 11
 
 typedef struct node{
@@ -11,13 +17,16 @@ void push(LinkStack * L, char elem);
 void pop(LinkStack *L);
 char top(LinkStack L);
 void display(LinkStack L);
+int bench(long n);
 
-int main() {
+int main(int argc, char *argv[]) {
 	LinkStack A = NULL;
 	int i;
 	char word[SIZE] = {'P', 'R', 'O','G','R','A','M','M','I','N','G'};
 	char first;
 	
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+		return bench(atol(argv[2]));
 	
 	for (i = 0; i < SIZE; i++) {
 		push(&A, word[i]); /* INSERTING THE CHARACTER IN LINK LIST*/
@@ -86,3 +95,96 @@ void display(LinkStack L) {
 }
 
 
+
+/* FOR TIMING THE THREE STACKS
+
+	Each one gets n pushes and then n pops, and then n operations that
+	keep the stack shallow the way an expression evaluator does: two
+	pushes, a pop, a read of the top, a pop. The sums of what came off
+	must agree.
+*/
+
+double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(long n) {
+	LinkStack L = NULL;
+	ArrayStack_c a;
+	ChunkStack_c c;
+	long i, sum[3] = {0, 0, 0};
+	double t[3][2];
+	int k;
+
+	if (n < 1) {
+		printf("Need at least one push\n");
+		return 1;
+	}
+	array_stack_init_c(&a);
+	chunk_stack_init_c(&c);
+
+	t[0][0] = now();
+	for (i = 0; i < n; i++)
+		push(&L, (char)i);
+	for (i = 0; i < n; i++) {
+		sum[0] += top(L);
+		pop(&L);
+	}
+	t[0][0] = now() - t[0][0];
+	t[0][1] = now();
+	for (i = 0; i < n; i += 5) {
+		push(&L, (char)i);
+		push(&L, (char)(i + 1));
+		pop(&L);
+		sum[0] += top(L);
+		pop(&L);
+	}
+	t[0][1] = now() - t[0][1];
+
+	t[1][0] = now();
+	for (i = 0; i < n; i++)
+		if (array_stack_push_c(&a, (char)i) != 0)
+			return 1;
+	for (i = 0; i < n; i++)
+		sum[1] += array_stack_pop_c(&a);
+	t[1][0] = now() - t[1][0];
+	t[1][1] = now();
+	for (i = 0; i < n; i += 5) {
+		array_stack_push_c(&a, (char)i);
+		array_stack_push_c(&a, (char)(i + 1));
+		array_stack_pop_c(&a);
+		sum[1] += array_stack_top_c(&a);
+		array_stack_pop_c(&a);
+	}
+	t[1][1] = now() - t[1][1];
+
+	t[2][0] = now();
+	for (i = 0; i < n; i++)
+		if (chunk_stack_push_c(&c, (char)i) != 0)
+			return 1;
+	for (i = 0; i < n; i++)
+		sum[2] += chunk_stack_pop_c(&c);
+	t[2][0] = now() - t[2][0];
+	t[2][1] = now();
+	for (i = 0; i < n; i += 5) {
+		chunk_stack_push_c(&c, (char)i);
+		chunk_stack_push_c(&c, (char)(i + 1));
+		chunk_stack_pop_c(&c);
+		sum[2] += chunk_stack_top_c(&c);
+		chunk_stack_pop_c(&c);
+	}
+	t[2][1] = now() - t[2][1];
+
+	for (k = 0; k < 3; k++)
+		printf("%-8s push/pop %ld: %.3f s, shallow: %.3f s\n",
+			k == 0 ? "linked" : k == 1 ? "array" : "chunked", n, t[k][0], t[k][1]);
+	array_stack_free_c(&a);
+	chunk_stack_free_c(&c);
+	if (sum[0] != sum[1] || sum[0] != sum[2]) {
+		printf("The stacks disagree\n");
+		return 1;
+	}
+	return 0;
+}
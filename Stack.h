@@ -0,0 +1,212 @@
+// Stacks that do not malloc a node per push, for "Stack - Linked List.c",
+// stack_using_linklist and anything else that pushes a lot.
+//
+// STACK_DEFINE(suffix, type) writes two stacks of one element type:
+//
+//   ArrayStack_<suffix>  one growable array that doubles when it is
+//                        full: a push is a store and an increment
+//   ChunkStack_<suffix>  a linked list of STACK_CHUNK_BYTES segments:
+//                        growing never copies what is already pushed,
+//                        and popped segments are kept for reuse
+//
+// Both have the same calls, with array_stack_ or chunk_stack_ in front:
+//
+//   init(s)        an empty stack
+//   reserve(s, n)  room for n items in all, allocated now
+//   push(s, x)     0, or -1 when out of memory
+//   pop(s)         removes and returns the top; not on an empty stack
+//   top(s)         returns the top; not on an empty stack
+//   free(s)        frees everything; s is empty again
+//
+// The item count is s.size. Ready-made: c (char) and i (int).
+// Built with -DGUARD_ALLOC, a sample of the allocations are checked by
+// GuardAlloc.h. Header-only: #include "Stack.h" and call e.g.
+// array_stack_push_i(&s, 42).
+
+#ifndef STACK_H
+#define STACK_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(GUARD_ALLOC)
+#include "GuardAlloc.h"
+#endif
+
+#define STACK_MIN_CAPACITY 16
+#define STACK_CHUNK_BYTES 4096
+
+#define STACK_DEFINE(suffix, type)                                             \
+                                                                               \
+typedef struct                                                                 \
+{                                                                              \
+    type *items;                                                               \
+    size_t size, capacity;                                                     \
+} ArrayStack_##suffix;                                                         \
+                                                                               \
+static inline void array_stack_init_##suffix(ArrayStack_##suffix *s)           \
+{                                                                              \
+    s->items = NULL;                                                           \
+    s->size = s->capacity = 0;                                                 \
+}                                                                              \
+                                                                               \
+/* room for n items in all, so that many pushes never reallocate */            \
+static inline int array_stack_reserve_##suffix(ArrayStack_##suffix *s,         \
+                                               size_t n)                       \
+{                                                                              \
+    type *items;                                                               \
+    if (n <= s->capacity)                                                      \
+        return 0;                                                              \
+    items = (type *)realloc(s->items, n * sizeof *items);                      \
+    if (items == NULL)                                                         \
+        return -1;                                                             \
+    s->items = items;                                                          \
+    s->capacity = n;                                                           \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int array_stack_push_##suffix(ArrayStack_##suffix *s, type x)    \
+{                                                                              \
+    size_t grown = s->capacity ? 2 * s->capacity : STACK_MIN_CAPACITY;         \
+    if (s->size == s->capacity &&                                              \
+        array_stack_reserve_##suffix(s, grown) != 0)                           \
+        return -1;                                                             \
+    s->items[s->size++] = x;                                                   \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* the stack must not be empty */                                              \
+static inline type array_stack_pop_##suffix(ArrayStack_##suffix *s)            \
+{                                                                              \
+    return s->items[--s->size];                                                \
+}                                                                              \
+                                                                               \
+static inline type array_stack_top_##suffix(const ArrayStack_##suffix *s)      \
+{                                                                              \
+    return s->items[s->size - 1];                                              \
+}                                                                              \
+                                                                               \
+static inline void array_stack_free_##suffix(ArrayStack_##suffix *s)           \
+{                                                                              \
+    free(s->items);                                                            \
+    array_stack_init_##suffix(s);                                              \
+}                                                                              \
+                                                                               \
+typedef struct StackSegment_##suffix                                           \
+{                                                                              \
+    struct StackSegment_##suffix *prev;                                        \
+    type items[];                                                              \
+} StackSegment_##suffix;                                                       \
+                                                                               \
+typedef struct                                                                 \
+{                                                                              \
+    StackSegment_##suffix *seg;   /* the top segment */                        \
+    StackSegment_##suffix *spare; /* emptied or reserved segments, by prev */  \
+    size_t count;                 /* items in the top segment */               \
+    size_t size;                  /* items in all */                           \
+    size_t segments;              /* allocated, spares included */             \
+} ChunkStack_##suffix;                                                         \
+                                                                               \
+static inline size_t chunk_stack_per_segment_##suffix(void)                    \
+{                                                                              \
+    return (STACK_CHUNK_BYTES - offsetof(StackSegment_##suffix, items)) /      \
+           sizeof(type);                                                       \
+}                                                                              \
+                                                                               \
+static inline void chunk_stack_init_##suffix(ChunkStack_##suffix *s)           \
+{                                                                              \
+    s->seg = s->spare = NULL;                                                  \
+    s->count = s->size = s->segments = 0;                                      \
+}                                                                              \
+                                                                               \
+static inline StackSegment_##suffix *                                          \
+chunk_stack_segment_##suffix(ChunkStack_##suffix *s)                           \
+{                                                                              \
+    StackSegment_##suffix *seg = s->spare;                                     \
+    if (seg != NULL)                                                           \
+    {                                                                          \
+        s->spare = seg->prev;                                                  \
+        return seg;                                                            \
+    }                                                                          \
+    seg = (StackSegment_##suffix *)malloc(STACK_CHUNK_BYTES);                  \
+    if (seg != NULL)                                                           \
+        s->segments++;                                                         \
+    return seg;                                                                \
+}                                                                              \
+                                                                               \
+/* allocates spare segments until n items fit in all */                        \
+static inline int chunk_stack_reserve_##suffix(ChunkStack_##suffix *s,         \
+                                               size_t n)                       \
+{                                                                              \
+    size_t per = chunk_stack_per_segment_##suffix();                           \
+    while (s->segments * per < n)                                              \
+    {                                                                          \
+        StackSegment_##suffix *seg =                                           \
+            (StackSegment_##suffix *)malloc(STACK_CHUNK_BYTES);                \
+        if (seg == NULL)                                                       \
+            return -1;                                                         \
+        seg->prev = s->spare;                                                  \
+        s->spare = seg;                                                        \
+        s->segments++;                                                         \
+    }                                                                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int chunk_stack_push_##suffix(ChunkStack_##suffix *s, type x)    \
+{                                                                              \
+    if (s->seg == NULL || s->count == chunk_stack_per_segment_##suffix())      \
+    {                                                                          \
+        StackSegment_##suffix *seg = chunk_stack_segment_##suffix(s);          \
+        if (seg == NULL)                                                       \
+            return -1;                                                         \
+        seg->prev = s->seg;                                                    \
+        s->seg = seg;                                                          \
+        s->count = 0;                                                          \
+    }                                                                          \
+    s->seg->items[s->count++] = x;                                             \
+    s->size++;                                                                 \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* the stack must not be empty. A segment emptied by pop() is kept as          \
+   the top until the next pop() needs the one below, so pushing and            \
+   popping across a boundary does not move segments every time. */             \
+static inline type chunk_stack_pop_##suffix(ChunkStack_##suffix *s)            \
+{                                                                              \
+    if (s->count == 0)                                                         \
+    {                                                                          \
+        StackSegment_##suffix *seg = s->seg;                                   \
+        s->seg = seg->prev;                                                    \
+        seg->prev = s->spare;                                                  \
+        s->spare = seg;                                                        \
+        s->count = chunk_stack_per_segment_##suffix();                         \
+    }                                                                          \
+    s->size--;                                                                 \
+    return s->seg->items[--s->count];                                          \
+}                                                                              \
+                                                                               \
+static inline type chunk_stack_top_##suffix(const ChunkStack_##suffix *s)      \
+{                                                                              \
+    if (s->count == 0)                                                         \
+        return s->seg->prev->items[chunk_stack_per_segment_##suffix() - 1];    \
+    return s->seg->items[s->count - 1];                                        \
+}                                                                              \
+                                                                               \
+static inline void chunk_stack_free_##suffix(ChunkStack_##suffix *s)           \
+{                                                                              \
+    StackSegment_##suffix *lists[2] = { s->seg, s->spare };                    \
+    int i;                                                                     \
+    for (i = 0; i < 2; i++)                                                    \
+        while (lists[i] != NULL)                                               \
+        {                                                                      \
+            StackSegment_##suffix *prev = lists[i]->prev;                      \
+            free(lists[i]);                                                    \
+            lists[i] = prev;                                                   \
+        }                                                                      \
+    chunk_stack_init_##suffix(s);                                              \
+}
+
+STACK_DEFINE(c, char)
+STACK_DEFINE(i, int)
+
+#endif
@@ -1,17 +1,26 @@
 #include <stdio.h>
+#include "Pattern.h"
 
+// Row i is the first i "* " of one template line (Pattern.h), and the rows
+// go out through one OutBuffer.
 int main(){
 
-    int n, i,j;
+    int n, i;
+    PatternTemplate stars;
+    OutBuffer out;
 
     printf("Enter number of rows : ");
-    scanf("%d" , &n);
+    if (scanf("%d" , &n) != 1)
+        return 1;
+    if (n < 0)
+        n = 0;
+    if (patternOpen(&stars, 0, 2 * (size_t)n) != 0 || outInit(&out, stdout, 0) != 0)
+        return 1;
+    patternRepeat(&stars, "* ");
 
-    for(i=1;i<=n;i++){
-        for(j=1;j<=i;j++)
-            printf("* ");
-        printf("\n");
-    }
+    for(i=1;i<=n;i++)
+        patternRow(&out, &stars, 0, 2 * (size_t)i);
+    outClose(&out);
+    patternClose(&stars);
     return 0;
 }
-
@@ -0,0 +1,303 @@
+// One-pass statistics of a stream of numbers (the count, sum, mean,
+// variance, min and max), for SimpleArithmeticAverage and the other
+// averaging programs.
+//
+// The textbook variance, sum(x^2) / n - mean^2, takes the difference of
+// two big numbers that are nearly equal and loses every digit when the
+// spread is small next to the mean. Welford's update, statsAdd(), moves
+// the mean by (x - mean) / n and adds (x - mean_old)(x - mean_new) to m2,
+// the sum of squared deviations, so nothing large is ever cancelled.
+// Two states merge the same way (Chan, Golub and LeVeque): statsMerge()
+// shifts m2 by d^2 na nb / n, d the difference of the two means. That is
+// what makes the state mergeable: pieces of a stream can be summarised on
+// their own, by other threads or other machines, and put together after.
+//
+// statsAdd() costs a division a number. statsArray() does an array a
+// block of STATS_BLOCK at a time, which stays in L1: a pass for the sum,
+// the min and the max, then a pass for the squared deviations from the
+// block's mean, both in STATS_LANES accumulators side by side that the
+// compiler turns into vector adds and FMAs; the block's state is merged
+// into the running one. The deviations are exact to a rounding, so this
+// is as stable as Welford's update and runs at the speed of the loads.
+//
+// statsParallel() cuts an array into pieces of STATS_CHUNK that the
+// workers of pool (TaskPool.h) summarise, and merges the pieces in order,
+// so the answer is the same to the bit for any number of threads; pool
+// may be NULL. statsRead() streams numbers from a text file through it,
+// a block at a time, separated by blanks, commas or new lines.
+//
+// A NaN makes the sum, mean and variance NaN; min and max pass over it.
+// The functions that read return 0, or -1 when out of memory or when a
+// read failed. Header-only; build with -pthread.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FloatText.h"
+#include "SquareRoot.h"
+#include "TaskPool.h"
+
+#define STATS_LANES 8
+#define STATS_BLOCK 2048
+#define STATS_CHUNK (1 << 16)
+#define STATS_READ_BLOCK (1 << 20)
+
+typedef struct
+{
+    uint64_t n;
+    double sum, mean;
+    double m2; // the sum of squared deviations from the mean
+    double min, max;
+} Stats;
+
+static inline void statsInit(Stats *s)
+{
+    s->n = 0;
+    s->sum = s->mean = s->m2 = 0;
+    s->min = INFINITY;
+    s->max = -INFINITY;
+}
+
+static inline void statsAdd(Stats *s, double x)
+{
+    double d = x - s->mean;
+    s->n++;
+    s->sum += x;
+    s->mean += d / (double)s->n;
+    s->m2 += d * (x - s->mean);
+    s->min = x < s->min ? x : s->min;
+    s->max = x > s->max ? x : s->max;
+}
+
+// b folded into a, as if a's numbers had been followed by b's
+static inline void statsMerge(Stats *a, const Stats *b)
+{
+    double n, d;
+    if (b->n == 0)
+        return;
+    if (a->n == 0)
+    {
+        *a = *b;
+        return;
+    }
+    n = (double)(a->n + b->n);
+    d = b->mean - a->mean;
+    a->mean += d * ((double)b->n / n);
+    a->m2 += b->m2 + d * d * ((double)a->n * (double)b->n / n);
+    a->sum += b->sum;
+    a->n += b->n;
+    a->min = b->min < a->min ? b->min : a->min;
+    a->max = b->max > a->max ? b->max : a->max;
+}
+
+static inline double statsMean(const Stats *s)
+{
+    return s->n ? s->mean : 0;
+}
+
+// The population variance, m2 / n
+static inline double statsVariance(const Stats *s)
+{
+    return s->n ? s->m2 / (double)s->n : 0;
+}
+
+// The sample variance, m2 / (n - 1)
+static inline double statsSampleVariance(const Stats *s)
+{
+    return s->n > 1 ? s->m2 / (double)(s->n - 1) : 0;
+}
+
+static inline double statsStddev(const Stats *s)
+{
+    return newtonSqrt(statsVariance(s));
+}
+
+static inline double statsSampleStddev(const Stats *s)
+{
+    return newtonSqrt(statsSampleVariance(s));
+}
+
+// The state of x[0 .. n), n at most STATS_BLOCK, in two passes
+static inline void statsBlock(const double *x, size_t n, Stats *out)
+{
+    double sum[STATS_LANES] = {0}, dev[STATS_LANES] = {0}, sq[STATS_LANES] = {0};
+    double lo[STATS_LANES], hi[STATS_LANES], mean, s = 0, ds = 0, q = 0;
+    size_t i, j;
+    statsInit(out);
+    if (n == 0)
+        return;
+    for (j = 0; j < STATS_LANES; j++)
+    {
+        lo[j] = INFINITY;
+        hi[j] = -INFINITY;
+    }
+    for (i = 0; i + STATS_LANES <= n; i += STATS_LANES)
+        for (j = 0; j < STATS_LANES; j++)
+        {
+            sum[j] += x[i + j];
+            lo[j] = x[i + j] < lo[j] ? x[i + j] : lo[j];
+            hi[j] = x[i + j] > hi[j] ? x[i + j] : hi[j];
+        }
+    for (; i < n; i++)
+    {
+        s += x[i];
+        lo[0] = x[i] < lo[0] ? x[i] : lo[0];
+        hi[0] = x[i] > hi[0] ? x[i] : hi[0];
+    }
+    for (j = 0; j < STATS_LANES; j++)
+    {
+        s += sum[j];
+        out->min = lo[j] < out->min ? lo[j] : out->min;
+        out->max = hi[j] > out->max ? hi[j] : out->max;
+    }
+    mean = s / (double)n;
+    // the deviations add up to the rounding error of mean, taken back off
+    for (i = 0; i + STATS_LANES <= n; i += STATS_LANES)
+        for (j = 0; j < STATS_LANES; j++)
+        {
+            double d = x[i + j] - mean;
+            dev[j] += d;
+            sq[j] += d * d;
+        }
+    for (; i < n; i++)
+    {
+        double d = x[i] - mean;
+        ds += d;
+        q += d * d;
+    }
+    for (j = 0; j < STATS_LANES; j++)
+    {
+        ds += dev[j];
+        q += sq[j];
+    }
+    out->n = n;
+    out->sum = s;
+    out->mean = mean + ds / (double)n;
+    out->m2 = q - ds * ds / (double)n;
+    out->m2 = out->m2 > 0 ? out->m2 : 0;
+}
+
+// x[0 .. n) folded into s, a block at a time
+static inline void statsArray(Stats *s, const double *x, size_t n)
+{
+    size_t i, k;
+    for (i = 0; i < n; i += k)
+    {
+        Stats b;
+        k = n - i < STATS_BLOCK ? n - i : STATS_BLOCK;
+        statsBlock(x + i, k, &b);
+        statsMerge(s, &b);
+    }
+}
+
+typedef struct
+{
+    const double *x;
+    size_t n;
+    Stats *pieces;
+} StatsJob;
+
+static inline void statsPieces(size_t begin, size_t end, void *arg)
+{
+    StatsJob *job = (StatsJob *)arg;
+    size_t c;
+    for (c = begin; c < end; c++)
+    {
+        size_t at = c * STATS_CHUNK, k = job->n - at < STATS_CHUNK ? job->n - at : STATS_CHUNK;
+        statsInit(&job->pieces[c]);
+        statsArray(&job->pieces[c], job->x + at, k);
+    }
+}
+
+// x[0 .. n) folded into s, a piece of STATS_CHUNK per task on pool's
+// workers, merged in order
+static inline int statsParallel(TaskPool *pool, Stats *s, const double *x, size_t n)
+{
+    size_t chunks = (n + STATS_CHUNK - 1) / STATS_CHUNK, c;
+    StatsJob job;
+    if (chunks == 0)
+        return 0;
+    job.x = x;
+    job.n = n;
+    if ((job.pieces = (Stats *)malloc(chunks * sizeof *job.pieces)) == NULL)
+        return -1;
+    if (pool != NULL && pool->nthreads > 1 && chunks > 1)
+        poolParallelFor(pool, 0, chunks, 1, statsPieces, &job);
+    else
+        statsPieces(0, chunks, &job);
+    for (c = 0; c < chunks; c++)
+        statsMerge(s, &job.pieces[c]);
+    free(job.pieces);
+    return 0;
+}
+
+// The numbers of in, separated by blanks, commas or new lines, folded
+// into s STATS_READ_BLOCK at a time; a field that is not a number is
+// counted in *skipped
+static inline int statsRead(TaskPool *pool, Stats *s, FILE *in, size_t *skipped)
+{
+    size_t cap = STATS_READ_BLOCK, len = 0, got, count = 0;
+    char *buf = (char *)malloc(cap);
+    double *x = (double *)malloc(STATS_READ_BLOCK * sizeof *x);
+    int eof = 0, rc = buf != NULL && x != NULL ? 0 : -1;
+    *skipped = 0;
+    while (rc == 0 && !eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, cap - len, in);
+        len += got;
+        if (got == 0)
+        {
+            eof = 1;
+            if (ferror(in))
+                rc = -1;
+        }
+        while (rc == 0 && pos < len)
+        {
+            const char *p = buf + pos, *e = buf + len, *f;
+            while (p < e && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r' || *p == '\n'))
+                p++;
+            f = p;
+            while (p < e && *p != ' ' && *p != '\t' && *p != ',' && *p != '\r' && *p != '\n')
+                p++;
+            if (p == e && !eof)
+                break; // the field may go on in the next read
+            pos = (size_t)(p - buf);
+            if (f == p)
+                continue;
+            if (parseDouble(f, p, &x[count]) != 0)
+                ++*skipped;
+            else if (++count == STATS_READ_BLOCK)
+            {
+                rc = statsParallel(pool, s, x, count);
+                count = 0;
+            }
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+        if (len == cap)
+        {
+            char *bigger = (char *)realloc(buf, cap * 2);
+            if (bigger == NULL)
+                rc = -1;
+            else
+            {
+                buf = bigger;
+                cap *= 2;
+            }
+        }
+    }
+    if (rc == 0)
+        rc = statsParallel(pool, s, x, count);
+    free(buf);
+    free(x);
+    return rc;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// Views of strings, a pointer and a length, for Slicestring,
+// Anagram-Program-in-C and the CSV readers of TempScale.h and Interest.h.
+//
+// A StrView points into text that someone else owns: a slice, a trimmed
+// word, a field or a line of a buffer is a new pointer and length,
+// made in O(1) or by scanning only what it covers, and the text itself is
+// never copied, moved or changed. No function here allocates, and none
+// needs a NUL: the text may be any bytes, a file read whole or mmap'd
+// included, and printf("%.*s", (int)v.n, v.p) prints a view.
+//
+// svSplitNext() takes the piece up to the next separator off the front of
+// a view; called until it returns 0 it gives every piece, empty ones
+// included, so "a,,b" is three fields. svNextToken() does the same for runs
+// of white space, which it skips, so it gives only the words. Both find the
+// next separator with memchr() or a test per byte and resume from there,
+// so a whole buffer is tokenized in one pass. svField() is field column,
+// from 0, of a line.
+//
+// The views stay good as long as the text does. Header-only.
+
+#ifndef STR_VIEW_H
+#define STR_VIEW_H
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct
+{
+    const char *p;
+    size_t n;
+} StrView;
+
+static inline StrView svMake(const char *p, size_t n)
+{
+    StrView v;
+    v.p = p;
+    v.n = n;
+    return v;
+}
+
+static inline StrView svFromC(const char *s)
+{
+    return svMake(s, strlen(s));
+}
+
+// Characters from .. to - 1, both clamped to the view
+static inline StrView svSlice(StrView v, size_t from, size_t to)
+{
+    if (to > v.n)
+        to = v.n;
+    if (from > to)
+        from = to;
+    return svMake(v.p + from, to - from);
+}
+
+static inline int svEqual(StrView a, StrView b)
+{
+    return a.n == b.n && (a.n == 0 || memcmp(a.p, b.p, a.n) == 0);
+}
+
+static inline int svIsSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline StrView svTrimLeft(StrView v)
+{
+    while (v.n > 0 && svIsSpace(*v.p))
+    {
+        v.p++;
+        v.n--;
+    }
+    return v;
+}
+
+static inline StrView svTrimRight(StrView v)
+{
+    while (v.n > 0 && svIsSpace(v.p[v.n - 1]))
+        v.n--;
+    return v;
+}
+
+static inline StrView svTrim(StrView v)
+{
+    return svTrimRight(svTrimLeft(v));
+}
+
+// Where c first is in v, or v.n
+static inline size_t svFind(StrView v, char c)
+{
+    const char *at = v.n > 0 ? (const char *)memchr(v.p, c, v.n) : NULL;
+    return at != NULL ? (size_t)(at - v.p) : v.n;
+}
+
+// The piece of *rest before the next sep, into *piece, and *rest past the
+// sep; 0 once the last piece, the one with no sep after it, is taken. A
+// view with p NULL is what is left after that.
+static inline int svSplitNext(StrView *rest, char sep, StrView *piece)
+{
+    size_t i;
+    if (rest->p == NULL)
+        return 0;
+    i = svFind(*rest, sep);
+    *piece = svMake(rest->p, i);
+    if (i == rest->n)
+        *rest = svMake(NULL, 0);
+    else
+        *rest = svMake(rest->p + i + 1, rest->n - i - 1);
+    return 1;
+}
+
+// The next word of *rest, a run of anything but white space, into *word,
+// and *rest past it; 0 when there are no more
+static inline int svNextToken(StrView *rest, StrView *word)
+{
+    const char *p = rest->p, *e = rest->p + rest->n, *start;
+    while (p < e && svIsSpace(*p))
+        p++;
+    if (p == e)
+    {
+        *rest = svMake(e, 0);
+        return 0;
+    }
+    start = p;
+    while (p < e && !svIsSpace(*p))
+        p++;
+    *word = svMake(start, (size_t)(p - start));
+    *rest = svMake(p, (size_t)(e - p));
+    return 1;
+}
+
+// Field column (from 0) of line, its fields separated by sep, into *field;
+// -1 when the line has fewer fields
+static inline int svField(StrView line, char sep, size_t column, StrView *field)
+{
+    size_t c;
+    for (c = 0; c < column; c++)
+    {
+        size_t i = svFind(line, sep);
+        if (i == line.n)
+            return -1;
+        line = svMake(line.p + i + 1, line.n - i - 1);
+    }
+    *field = svMake(line.p, svFind(line, sep));
+    return 0;
+}
+
+#endif
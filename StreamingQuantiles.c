@@ -0,0 +1,567 @@
+// Quantiles and top-k of a stream of numbers too long to keep in memory.
+//
+//   StreamingQuantiles [--k K] [--quantiles Q,Q,...] [--top N]
+//                      [--save FILE] [--load FILE]... [FILE...]
+//
+// Reads numbers from stdin, or from each FILE on a thread of its own.
+// Every thread fills its own sketch, and the sketches are merged at the
+// end. Prints the count, min and max, the approximate quantiles
+// (default 0.5,0.9,0.99) and the exact N smallest and largest values.
+//
+// The quantiles come from a KLL sketch: the values are kept in levels,
+// and a value on level h stands for 2^h values of the input. When the
+// sketch is full, the lowest full level is sorted and every other value
+// (odd or even positions, picked at random) moves up a level. Memory is
+// about 3K values whatever the length of the stream. The rank error
+// shrinks as 1/K, to roughly 1.7% of n at K = 200.
+// The top-k lists are exact: each is a bounded heap of N values.
+//
+// --save writes the merged sketch to FILE as text, and --load merges a
+// saved sketch in, so sketches from several machines can be combined:
+//   host1$ ./StreamingQuantiles --save a.txt < part1
+//   host2$ ./StreamingQuantiles --save b.txt < part2
+//   host1$ ./StreamingQuantiles --load a.txt --load b.txt < /dev/null
+// Build with -pthread.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// ---------- exact top-k ----------
+
+// The N best values seen so far, as a heap with the worst of them at
+// the root: a new value only has to beat the root to get in.
+typedef struct
+{
+    int k, size;
+    int largest; // keeps the largest values, otherwise the smallest
+    double *v;
+} TopK;
+
+static int topkBetter(const TopK *t, double a, double b)
+{
+    return t->largest ? a > b : a < b;
+}
+
+static int topkInit(TopK *t, int k, int largest)
+{
+    t->k = k;
+    t->size = 0;
+    t->largest = largest;
+    t->v = malloc((k > 0 ? k : 1) * sizeof *t->v);
+    return t->v == NULL ? -1 : 0;
+}
+
+static void topkAdd(TopK *t, double x)
+{
+    int i, c;
+
+    if (t->k <= 0)
+        return;
+    if (t->size < t->k)
+    {
+        // sift up: better values sink away from the root
+        for (i = t->size++; i > 0 && topkBetter(t, t->v[(i - 1) / 2], x); i = (i - 1) / 2)
+            t->v[i] = t->v[(i - 1) / 2];
+        t->v[i] = x;
+        return;
+    }
+    if (!topkBetter(t, x, t->v[0]))
+        return;
+
+    // x replaces the root and sifts down
+    for (i = 0; (c = 2 * i + 1) < t->size; i = c)
+    {
+        if (c + 1 < t->size && topkBetter(t, t->v[c], t->v[c + 1]))
+            c++;
+        if (!topkBetter(t, x, t->v[c]))
+            break;
+        t->v[i] = t->v[c];
+    }
+    t->v[i] = x;
+}
+
+static void topkMerge(TopK *dst, const TopK *src)
+{
+    int i;
+    for (i = 0; i < src->size; i++)
+        topkAdd(dst, src->v[i]);
+}
+
+// ---------- KLL quantile sketch ----------
+
+typedef struct
+{
+    int k;
+    int levels;
+    double **items; // items[h][0..size[h]) each stand for 2^h values
+    int *size, *alloc;
+    int total, capacity; // values held, and the sum of the level capacities
+    uint64_t n;
+    double min, max;
+    uint64_t rng;
+} Kll;
+
+static int kllCapacity(const Kll *s, int h)
+{
+    // the top level holds k values, each level below 2/3 of the one above
+    double c = s->k;
+    int i;
+    for (i = h; i < s->levels - 1; i++)
+        c = c * 2 / 3;
+    return c < 2 ? 2 : (int)(c + 0.999);
+}
+
+static int kllAddLevel(Kll *s)
+{
+    int h = s->levels;
+    double **items = realloc(s->items, (h + 1) * sizeof *items);
+    int *size, *alloc;
+
+    if (items == NULL)
+        return -1;
+    s->items = items;
+    size = realloc(s->size, (h + 1) * sizeof *size);
+    if (size == NULL)
+        return -1;
+    s->size = size;
+    alloc = realloc(s->alloc, (h + 1) * sizeof *alloc);
+    if (alloc == NULL)
+        return -1;
+    s->alloc = alloc;
+
+    s->items[h] = NULL;
+    s->size[h] = 0;
+    s->alloc[h] = 0;
+    s->levels++;
+    // every level's capacity grows by one step
+    for (s->capacity = 0, h = 0; h < s->levels; h++)
+        s->capacity += kllCapacity(s, h);
+    return 0;
+}
+
+static int kllInit(Kll *s, int k, uint64_t seed)
+{
+    memset(s, 0, sizeof *s);
+    s->k = k < 8 ? 8 : k;
+    s->rng = seed | 1;
+    return kllAddLevel(s);
+}
+
+static void kllFree(Kll *s)
+{
+    int h;
+    for (h = 0; h < s->levels; h++)
+        free(s->items[h]);
+    free(s->items);
+    free(s->size);
+    free(s->alloc);
+}
+
+static int kllPush(Kll *s, int h, double x)
+{
+    if (s->size[h] == s->alloc[h])
+    {
+        int alloc = s->alloc[h] ? 2 * s->alloc[h] : 16;
+        double *bigger = realloc(s->items[h], alloc * sizeof *bigger);
+        if (bigger == NULL)
+            return -1;
+        s->items[h] = bigger;
+        s->alloc[h] = alloc;
+    }
+    s->items[h][s->size[h]++] = x;
+    s->total++;
+    return 0;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Compacts levels until the sketch fits in its capacity again
+static int kllCompress(Kll *s)
+{
+    while (s->total > s->capacity)
+    {
+        int h;
+
+        for (h = 0; s->size[h] < kllCapacity(s, h); h++)
+            ;
+        if (h == s->levels - 1 && kllAddLevel(s) != 0)
+            return -1;
+
+        {
+            double *v = s->items[h];
+            int n = s->size[h], keep = n % 2, i;
+
+            // with an odd count the smallest value stays on this level
+            qsort(v, n, sizeof *v, cmpDouble);
+            s->rng ^= s->rng << 13;
+            s->rng ^= s->rng >> 7;
+            s->rng ^= s->rng << 17;
+            for (i = keep + (int)(s->rng & 1); i < n; i += 2)
+                if (kllPush(s, h + 1, v[i]) != 0)
+                    return -1;
+            s->total -= n - keep;
+            s->size[h] = keep;
+        }
+    }
+    return 0;
+}
+
+static int kllAdd(Kll *s, double x)
+{
+    if (s->n == 0 || x < s->min)
+        s->min = x;
+    if (s->n == 0 || x > s->max)
+        s->max = x;
+    s->n++;
+    if (kllPush(s, 0, x) != 0)
+        return -1;
+    return kllCompress(s);
+}
+
+// Adds every value of src to dst, level by level
+static int kllMerge(Kll *dst, const Kll *src)
+{
+    int h, i;
+
+    if (src->n == 0)
+        return 0;
+    while (dst->levels < src->levels)
+        if (kllAddLevel(dst) != 0)
+            return -1;
+    for (h = 0; h < src->levels; h++)
+        for (i = 0; i < src->size[h]; i++)
+            if (kllPush(dst, h, src->items[h][i]) != 0)
+                return -1;
+    if (dst->n == 0 || src->min < dst->min)
+        dst->min = src->min;
+    if (dst->n == 0 || src->max > dst->max)
+        dst->max = src->max;
+    dst->n += src->n;
+    return kllCompress(dst);
+}
+
+typedef struct
+{
+    double value;
+    uint64_t weight;
+} Weighted;
+
+static int cmpWeighted(const void *a, const void *b)
+{
+    return cmpDouble(&((const Weighted *)a)->value, &((const Weighted *)b)->value);
+}
+
+// Approximate q-quantiles (0 <= q <= 1) of everything added, for each
+// of qs[0..nq), written to out. Returns -1 when out of memory.
+static int kllQuantiles(const Kll *s, const double *qs, int nq, double *out)
+{
+    Weighted *w;
+    int h, i, m = 0, j;
+    uint64_t total = 0;
+
+    for (h = 0; h < s->levels; h++)
+        m += s->size[h];
+    w = malloc((m ? m : 1) * sizeof *w);
+    if (w == NULL)
+        return -1;
+    for (h = 0, m = 0; h < s->levels; h++)
+        for (i = 0; i < s->size[h]; i++)
+        {
+            w[m].value = s->items[h][i];
+            w[m++].weight = (uint64_t)1 << h;
+            total += (uint64_t)1 << h;
+        }
+    qsort(w, m, sizeof *w, cmpWeighted);
+
+    for (j = 0; j < nq; j++)
+    {
+        uint64_t want = (uint64_t)(qs[j] * total + 0.5), seen = 0;
+        if (qs[j] <= 0 || m == 0)
+        {
+            out[j] = s->min;
+            continue;
+        }
+        if (qs[j] >= 1)
+        {
+            out[j] = s->max;
+            continue;
+        }
+        for (i = 0; i < m - 1 && seen + w[i].weight < want; i++)
+            seen += w[i].weight;
+        out[j] = w[i].value;
+    }
+    free(w);
+    return 0;
+}
+
+// ---------- one sketch per thread ----------
+
+typedef struct
+{
+    Kll kll;
+    TopK smallest, largest;
+} Sketch;
+
+static int sketchInit(Sketch *s, int k, int top, uint64_t seed)
+{
+    if (kllInit(&s->kll, k, seed) != 0)
+        return -1;
+    if (topkInit(&s->smallest, top, 0) != 0 || topkInit(&s->largest, top, 1) != 0)
+        return -1;
+    return 0;
+}
+
+static void sketchFree(Sketch *s)
+{
+    kllFree(&s->kll);
+    free(s->smallest.v);
+    free(s->largest.v);
+}
+
+static int sketchAdd(Sketch *s, double x)
+{
+    topkAdd(&s->smallest, x);
+    topkAdd(&s->largest, x);
+    return kllAdd(&s->kll, x);
+}
+
+static int sketchMerge(Sketch *dst, const Sketch *src)
+{
+    topkMerge(&dst->smallest, &src->smallest);
+    topkMerge(&dst->largest, &src->largest);
+    return kllMerge(&dst->kll, &src->kll);
+}
+
+// Text format: "kll K N MIN MAX LEVELS", one "level H COUNT v..." line
+// per level, then "top N v..." for the smallest and the largest values
+static int sketchSave(const Sketch *s, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    int h, i;
+
+    if (f == NULL)
+        return -1;
+    fprintf(f, "kll %d %llu %.17g %.17g %d\n", s->kll.k, (unsigned long long)s->kll.n,
+            s->kll.min, s->kll.max, s->kll.levels);
+    for (h = 0; h < s->kll.levels; h++)
+    {
+        fprintf(f, "level %d %d", h, s->kll.size[h]);
+        for (i = 0; i < s->kll.size[h]; i++)
+            fprintf(f, " %.17g", s->kll.items[h][i]);
+        fprintf(f, "\n");
+    }
+    fprintf(f, "top %d", s->smallest.size);
+    for (i = 0; i < s->smallest.size; i++)
+        fprintf(f, " %.17g", s->smallest.v[i]);
+    fprintf(f, "\ntop %d", s->largest.size);
+    for (i = 0; i < s->largest.size; i++)
+        fprintf(f, " %.17g", s->largest.v[i]);
+    fprintf(f, "\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Merges the sketch saved in path into s
+static int sketchLoad(Sketch *s, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    Kll saved;
+    unsigned long long n;
+    int k, levels, h, level, count, i, ok = 0;
+    double x, min, max;
+
+    if (f == NULL)
+        return -1;
+    if (fscanf(f, "kll %d %llu %lf %lf %d", &k, &n, &min, &max, &levels) != 5 ||
+        kllInit(&saved, k, 1) != 0)
+    {
+        fclose(f);
+        return -1;
+    }
+    saved.n = n;
+    saved.min = min;
+    saved.max = max;
+    for (h = 0; h < levels; h++)
+    {
+        if (h > 0 && kllAddLevel(&saved) != 0)
+            goto done;
+        if (fscanf(f, " level %d %d", &level, &count) != 2 || level != h)
+            goto done;
+        for (i = 0; i < count; i++)
+            if (fscanf(f, "%lf", &x) != 1 || kllPush(&saved, h, x) != 0)
+                goto done;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        int j;
+        if (fscanf(f, " top %d", &count) != 1)
+            goto done;
+        for (j = 0; j < count; j++)
+        {
+            if (fscanf(f, "%lf", &x) != 1)
+                goto done;
+            topkAdd(i == 0 ? &s->smallest : &s->largest, x);
+        }
+    }
+    ok = kllMerge(&s->kll, &saved) == 0;
+done:
+    kllFree(&saved);
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+typedef struct
+{
+    Sketch sketch;
+    FILE *in;
+    const char *name;
+    int failed;
+} Reader;
+
+static void *readStream(void *arg)
+{
+    Reader *r = arg;
+    double x;
+
+    while (fscanf(r->in, "%lf", &x) == 1)
+    {
+        if (sketchAdd(&r->sketch, x) != 0)
+        {
+            r->failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void printTop(const char *label, TopK *t)
+{
+    int i;
+    qsort(t->v, t->size, sizeof *t->v, cmpDouble);
+    printf("%s %d:", label, t->size);
+    for (i = 0; i < t->size; i++)
+        printf(" %g", t->largest ? t->v[t->size - 1 - i] : t->v[i]);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *quantiles = "0.5,0.9,0.99", *save = NULL, *p;
+    const char *loads[64];
+    int k = 200, top = 10, nloads = 0, nfiles = 0, i, nq = 0, status = 0;
+    double qs[64], out[64];
+    char *end;
+    Reader *readers;
+    pthread_t *threads;
+    Sketch all;
+
+    readers = calloc(argc > 1 ? argc : 1, sizeof *readers);
+    threads = calloc(argc > 1 ? argc : 1, sizeof *threads);
+    if (readers == NULL || threads == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--k") == 0 && i + 1 < argc)
+            k = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quantiles") == 0 && i + 1 < argc)
+            quantiles = argv[++i];
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            save = argv[++i];
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc && nloads < 64)
+            loads[nloads++] = argv[++i];
+        else
+            readers[nfiles++].name = argv[i];
+    }
+    for (p = quantiles; nq < 64; p = *end == ',' ? end + 1 : end)
+    {
+        qs[nq] = strtod(p, &end);
+        if (end == p)
+            break;
+        nq++;
+    }
+
+    if (nfiles == 0)
+    {
+        readers[0].name = "-";
+        nfiles = 1;
+    }
+    for (i = 0; i < nfiles; i++)
+    {
+        readers[i].in = strcmp(readers[i].name, "-") == 0 ? stdin : fopen(readers[i].name, "r");
+        if (readers[i].in == NULL)
+        {
+            printf("Cannot open %s\n", readers[i].name);
+            return 1;
+        }
+        if (sketchInit(&readers[i].sketch, k, top, 0x9E3779B97F4A7C15ULL * (i + 1)) != 0)
+        {
+            printf("Out of memory\n");
+            return 1;
+        }
+        // a file that cannot get its own thread is read on this one
+        if (pthread_create(&threads[i], NULL, readStream, &readers[i]) != 0)
+        {
+            readStream(&readers[i]);
+            threads[i] = pthread_self();
+        }
+    }
+
+    if (sketchInit(&all, k, top, 12345) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < nfiles; i++)
+    {
+        if (!pthread_equal(threads[i], pthread_self()))
+            pthread_join(threads[i], NULL);
+        if (readers[i].failed || sketchMerge(&all, &readers[i].sketch) != 0)
+        {
+            printf("Out of memory reading %s\n", readers[i].name);
+            status = 1;
+        }
+        if (readers[i].in != stdin)
+            fclose(readers[i].in);
+        sketchFree(&readers[i].sketch);
+    }
+    for (i = 0; i < nloads; i++)
+    {
+        if (sketchLoad(&all, loads[i]) != 0)
+        {
+            printf("Cannot load sketch %s\n", loads[i]);
+            status = 1;
+        }
+    }
+
+    printf("count %llu\n", (unsigned long long)all.kll.n);
+    if (all.kll.n > 0)
+    {
+        printf("min %g\nmax %g\n", all.kll.min, all.kll.max);
+        if (kllQuantiles(&all.kll, qs, nq, out) == 0)
+            for (i = 0; i < nq; i++)
+                printf("q%g ~%g\n", qs[i], out[i]);
+        if (save != NULL && sketchSave(&all, save) != 0)
+        {
+            printf("Cannot save sketch to %s\n", save);
+            status = 1;
+        }
+        printTop("smallest", &all.smallest);
+        printTop("largest", &all.largest);
+    }
+
+    sketchFree(&all);
+    free(readers);
+    free(threads);
+    return status;
+}
@@ -0,0 +1,347 @@
+// String kernels shared by StringLength.c, StringReverse.c, Palindrome.c,
+// LowercaseToUppercase.c, UppercaseToLowercase.c and camelcase.
+//
+// They work on 8 bytes at a time (or 16 with SSE2/SSSE3) instead of one
+// character at a time. Everything is static inline, so each program still
+// compiles on its own: gcc -O2 StringLength.c
+// Build with -march=native (or -mssse3) to get the 16-byte versions.
+
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+// skLength reads whole aligned words, which can go past the terminator
+// (never past the page it is in). That is safe, but AddressSanitizer
+// would report it, so it is left out of instrumentation like glibc's strlen.
+#if defined(__GNUC__)
+#define SK_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define SK_NO_ASAN
+#endif
+
+#define SK_ONES  0x0101010101010101ULL
+#define SK_HIGHS 0x8080808080808080ULL
+
+static inline uint64_t skLoad64(const char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline void skStore64(char *p, uint64_t v)
+{
+    memcpy(p, &v, 8);
+}
+
+// compilers turn this into a single bswap instruction
+static inline uint64_t skBswap64(uint64_t v)
+{
+    v = ((v & 0x00FF00FF00FF00FFULL) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFULL);
+    v = ((v & 0x0000FFFF0000FFFFULL) << 16) | ((v >> 16) & 0x0000FFFF0000FFFFULL);
+    return (v << 32) | (v >> 32);
+}
+
+// Length of a NUL-terminated string. A word v holds a zero byte exactly
+// when (v - 0x01..01) & ~v & 0x80..80 is not zero.
+SK_NO_ASAN static inline size_t skLength(const char *s)
+{
+    const char *p = s;
+
+    // byte by byte up to an 8-byte boundary, so word loads never cross
+    // into the next page
+    while ((uintptr_t)p % 8 != 0)
+    {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+
+    // each word is read with memcpy, like skLoad64(), so the char buffer
+    // is never accessed through a uint64_t pointer; it is written out
+    // here because a call to skLoad64() would be instrumented by ASan
+    for (;; p += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        if ((v - SK_ONES) & ~v & SK_HIGHS)
+            break;
+    }
+
+    while (*p != '\0')
+        p++;
+    return p - s;
+}
+
+// Reverses s[0..n) in place, swapping blocks from both ends
+static inline void skReverse(char *s, size_t n)
+{
+    size_t i = 0, j = n;
+
+#if defined(__SSSE3__)
+    const __m128i rev = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    while (j - i >= 32)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + j - 16));
+        _mm_storeu_si128((__m128i *)(s + i), _mm_shuffle_epi8(b, rev));
+        _mm_storeu_si128((__m128i *)(s + j - 16), _mm_shuffle_epi8(a, rev));
+        i += 16;
+        j -= 16;
+    }
+#endif
+    while (j - i >= 16)
+    {
+        uint64_t a = skLoad64(s + i);
+        uint64_t b = skLoad64(s + j - 8);
+        skStore64(s + i, skBswap64(b));
+        skStore64(s + j - 8, skBswap64(a));
+        i += 8;
+        j -= 8;
+    }
+    while (j - i >= 2)
+    {
+        char t = s[i];
+        s[i++] = s[--j];
+        s[j] = t;
+    }
+}
+
+// 1 if s[0..n) reads the same both ways: each block from the front is
+// compared with the mirrored block from the back
+static inline int skIsPalindrome(const char *s, size_t n)
+{
+    size_t i = 0, j = n;
+
+#if defined(__SSSE3__)
+    const __m128i rev = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    while (j - i >= 32)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + j - 16)), rev);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF)
+            return 0;
+        i += 16;
+        j -= 16;
+    }
+#endif
+    while (j - i >= 16)
+    {
+        if (skLoad64(s + i) != skBswap64(skLoad64(s + j - 8)))
+            return 0;
+        i += 8;
+        j -= 8;
+    }
+    while (j - i >= 2)
+    {
+        if (s[i++] != s[--j])
+            return 0;
+    }
+    return 1;
+}
+
+// Flips the 0x20 bit of every ASCII byte in [lo, hi] of v; bytes of
+// 128 and above are left alone
+static inline uint64_t skFlipRange64(uint64_t v, unsigned char lo, unsigned char hi)
+{
+    uint64_t heptets = v & ~SK_HIGHS;
+    uint64_t aboveHi = heptets + (0x7F - hi) * SK_ONES;
+    uint64_t atLeastLo = heptets + (0x80 - lo) * SK_ONES;
+    uint64_t inRange = ~v & (atLeastLo ^ aboveHi) & SK_HIGHS;
+    return v ^ (inRange >> 2);
+}
+
+static inline void skFlipRange(char *s, size_t n, unsigned char lo, unsigned char hi)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // signed compares: bytes of 128 and above are negative, so never in range
+    const __m128i below = _mm_set1_epi8((char)(lo - 1));
+    const __m128i above = _mm_set1_epi8((char)(hi + 1));
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        _mm_storeu_si128((__m128i *)(s + i), _mm_xor_si128(v, _mm_and_si128(in, bit)));
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+        skStore64(s + i, skFlipRange64(skLoad64(s + i), lo, hi));
+    for (; i < n; i++)
+    {
+        if ((unsigned char)s[i] >= lo && (unsigned char)s[i] <= hi)
+            s[i] ^= 0x20;
+    }
+}
+
+// ASCII case conversion of s[0..n) in place
+static inline void skToUpper(char *s, size_t n)
+{
+    skFlipRange(s, n, 'a', 'z');
+}
+
+static inline void skToLower(char *s, size_t n)
+{
+    skFlipRange(s, n, 'A', 'Z');
+}
+
+static inline int skIsAlnum(unsigned char c)
+{
+    return (unsigned)((c | 0x20) - 'a') < 26 || (unsigned)(c - '0') < 10;
+}
+
+// snake_case to camelCase: an '_' between a letter or digit and a letter
+// goes, and the letter after it becomes upper case; any other '_', such as
+// a leading one or one before a digit, stays. Writes at most n bytes to
+// out and returns how many. Blocks with no '_' are copied as they are:
+// each block is stored whole at the output position, and the position
+// then moves only up to its first '_', which is handled on its own.
+static inline size_t skSnakeToCamel(const char *in, size_t n, char *out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < n)
+    {
+#if defined(__SSE2__)
+        const __m128i under = _mm_set1_epi8('_');
+        int found = 0;
+        while (i + 16 <= n)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, under));
+            // o <= i, so the 16 bytes fit in the n bytes of out
+            _mm_storeu_si128((__m128i *)(out + o), v);
+            if (mask != 0)
+            {
+                unsigned k = (unsigned)__builtin_ctz(mask);
+                i += k;
+                o += k;
+                found = 1;
+                break;
+            }
+            i += 16;
+            o += 16;
+        }
+        if (!found)
+#endif
+            while (i < n && in[i] != '_')
+                out[o++] = in[i++];
+        if (i == n)
+            break;
+        // in[i] is '_'
+        if (i > 0 && skIsAlnum((unsigned char)in[i - 1]) && i + 1 < n &&
+            (unsigned)(((unsigned char)in[i + 1] | 0x20) - 'a') < 26)
+        {
+            out[o++] = (char)(in[i + 1] & ~0x20);
+            i += 2;
+        }
+        else
+            out[o++] = in[i++];
+    }
+    return o;
+}
+
+// camelCase to snake_case: every upper case letter becomes lower case, with
+// an '_' before it when it follows a lower case letter or digit, or it ends
+// a run of capitals before a lower case letter, so "parseHTTPRequest" is
+// "parse_http_request". Writes at most 2n bytes to out and returns how
+// many; blocks with no capitals go through as skSnakeToCamel() does.
+static inline size_t skCamelToSnake(const char *in, size_t n, char *out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < n)
+    {
+        unsigned char c, prev;
+#if defined(__SSE2__)
+        const __m128i below = _mm_set1_epi8('A' - 1), above = _mm_set1_epi8('Z' + 1);
+        int found = 0;
+        while (i + 16 <= n)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above)));
+            // o <= 2i, so the 16 bytes fit in the 2n bytes of out
+            _mm_storeu_si128((__m128i *)(out + o), v);
+            if (mask != 0)
+            {
+                unsigned k = (unsigned)__builtin_ctz(mask);
+                i += k;
+                o += k;
+                found = 1;
+                break;
+            }
+            i += 16;
+            o += 16;
+        }
+        if (!found)
+#endif
+            while (i < n && (unsigned)((unsigned char)in[i] - 'A') >= 26)
+                out[o++] = in[i++];
+        if (i == n)
+            break;
+        // in[i] is a capital
+        c = (unsigned char)in[i];
+        prev = i > 0 ? (unsigned char)in[i - 1] : 0;
+        if ((unsigned)(prev - 'a') < 26 || (unsigned)(prev - '0') < 10 ||
+            ((unsigned)(prev - 'A') < 26 && i + 1 < n && (unsigned)((unsigned char)in[i + 1] - 'a') < 26))
+            out[o++] = '_';
+        out[o++] = (char)(c | 0x20);
+        i++;
+    }
+    return o;
+}
+
+// Reads a whole file (or stdin for "-") into a NUL-terminated buffer.
+// Returns NULL on error; the caller frees the buffer.
+static inline char *skReadFile(const char *path, size_t *size)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    char *buf = NULL;
+    size_t len = 0, cap = 0, got;
+
+    if (fp == NULL)
+        return NULL;
+
+    do
+    {
+        if (len + 65536 + 1 > cap)
+        {
+            char *bigger;
+            cap = cap ? cap * 2 : 1 << 20;
+            bigger = realloc(buf, cap);
+            if (bigger == NULL)
+            {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = bigger;
+        }
+        got = fread(buf + len, 1, cap - len - 1, fp);
+        len += got;
+    } while (got > 0);
+
+    if (fp != stdin)
+        fclose(fp);
+    if (buf != NULL)
+    {
+        buf[len] = '\0';
+        *size = len;
+    }
+    return buf;
+}
+
+#endif
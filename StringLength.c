@@ -1,7 +1,12 @@
 // Implementation of the strlen function (for standard C strings)
+//
+// stringLength FILE (or - for stdin) prints the length of every line of
+// the file, measured with the word-at-a-time skLength from StringKernels.h
 
 #include <stdio.h>
 
+#include "StringKernels.h"
+
 int stringLength(char * word) {
     int count = 0;
 
@@ -12,10 +17,37 @@ int stringLength(char * word) {
     return (count);
 }
 
-int main() {
+// Bulk mode: every line becomes its own C string
+int lineLengths(const char * path) {
+  size_t size, i;
+  char * text = skReadFile(path, &size);
+  char * line;
+
+  if (text == NULL) {
+    printf("Cannot read %s\n", path);
+    return (1);
+  }
+
+  for (i = 0; i < size; i++) {
+    if (text[i] == '\n')
+      text[i] = '\0';
+  }
+
+  for (line = text; line < text + size; line += skLength(line) + 1) {
+    printf("%zu\n", skLength(line));
+  }
+
+  free(text);
+  return (0);
+}
+
+int main(int argc, char * argv[]) {
   int   index = 0;
   char  word[100];
 
+  if (argc == 2)
+    return (lineLengths(argv[1]));
+
   // Gets single word as input
   printf("Please enter a word to get its length (< 100 characters): ");
   scanf("%s", word);
@@ -24,4 +56,4 @@ int main() {
   printf("\"%s\" has a length of %d\n", word, stringLength(word));
 
   return (0);
-}
\ No newline at end of file
+}
@@ -1,10 +1,46 @@
+// stringReverse FILE (or - for stdin) reverses every line of the file
+// in place with skReverse from StringKernels.h
+
 #include<stdio.h>
+#ifdef _WIN32
 #include<conio.h>
-void main()
+#endif
+
+#include "StringKernels.h"
+
+// Bulk mode: reverse each line of the file and print it
+int reverseLines(const char *path)
+{
+    size_t size, start, i;
+    char *text = skReadFile(path, &size);
+
+    if(text == NULL)
+    {
+        printf("Cannot read %s\n", path);
+        return 1;
+    }
+
+    for(start = 0, i = 0; i <= size; i++)
+    {
+        if(i == size || text[i] == '\n')
+        {
+            skReverse(text + start, i - start);
+            start = i + 1;
+        }
+    }
+    fwrite(text, 1, size, stdout);
+
+    free(text);
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
     int i, j, k;
     char str[100];
     char rev[100];
+    if(argc == 2)
+        return reverseLines(argv[1]);
     printf("Enter a string:\t");
     scanf("%s", str);
     printf("The original string is %s\n", str);
@@ -17,6 +53,10 @@ void main()
         rev[j] = str[k];
         k--;
     }
+    rev[j] = '\0';
     printf("The reverse string is %s\n", rev);
+#ifdef _WIN32
     getch();
+#endif
+    return 0;
 }
@@ -1,4 +1,19 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Records.h"
+#include "Random.h"
+
+/*
+ * With no arguments: one student, read from the keyboard.
+ *   --bulk      "name roll marks" lines from stdin, and the count, the
+ *               average, lowest and highest marks and how many got each
+ *               grade, from a RecordStore (Records.h)
+ *   --bench N   N random students: an array of struct student against
+ *               the columns of a RecordStore
+ */
+
 struct student
 {
     char name[50];
@@ -6,12 +21,115 @@ struct student
     float marks;
 } s;
 
-int main()
+/* F below 40, C from 40, B from 60, A from 80 */
+static const float gradeFrom[] = {40, 60, 80};
+static const char gradeNames[] = "FCBA";
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bulk(void)
 {
+    RecordStore r;
+    size_t counts[4];
+    float lo, hi;
+    int g;
+    if (recordsInit(&r, 1, 1024) != 0 || recordsRead(&r, stdin, RECORD_NAME | RECORD_ROLL) != 0)
+    {
+        fprintf(stderr, "out of memory or failed to read\n");
+        recordsFree(&r);
+        return 1;
+    }
+    recordMinMax(r.score[0], r.n, &lo, &hi);
+    recordGrades(r.score[0], r.n, gradeFrom, 3, NULL, counts);
+    printf("Students: %zu", r.n);
+    if (r.skipped)
+        printf(" (%zu lines skipped)", r.skipped);
+    printf("\nAverage marks: %.2f\n", r.n ? recordSum(r.score[0], r.n) / r.n : 0.0);
+    printf("Lowest: %.1f\nHighest: %.1f\n", lo, hi);
+    for (g = 3; g >= 0; g--)
+        printf("%c: %zu\n", gradeNames[g], counts[g]);
+    recordsFree(&r);
+    return 0;
+}
+
+static int bench(size_t n)
+{
+    struct student *all = malloc((n ? n : 1) * sizeof *all);
+    RecordStore r;
+    Xoshiro256 rng;
+    size_t i, counts[4], aosCounts[4];
+    double t, best, sum = 0;
+    int round, g;
+    if (all == NULL || recordsInit(&r, 1, n) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    xoshiroSeed(&rng, 113);
+    for (i = 0; i < n; i++)
+    {
+        float marks = (float)xoshiroBelow(&rng, 1001) / 10;
+        int len = snprintf(all[i].name, sizeof all[i].name, "student%zu", i);
+        all[i].roll = (int)i + 1;
+        all[i].marks = marks;
+        recordsAppend(&r, all[i].name, (size_t)len, all[i].roll, &marks);
+    }
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        sum = 0;
+        memset(aosCounts, 0, sizeof aosCounts);
+        for (i = 0; i < n; i++)
+        {
+            float m = all[i].marks;
+            sum += m;
+            if (m >= 80)
+                aosCounts[3]++;
+            else if (m >= 60)
+                aosCounts[2]++;
+            else if (m >= 40)
+                aosCounts[1]++;
+            else
+                aosCounts[0]++;
+        }
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    printf("struct student, if chain: %.4f s, %zu bytes a record, average %.4f\n", best, sizeof *all, sum / n);
+    for (round = 0, best = 0; round < 3; round++)
+    {
+        t = now();
+        sum = recordSum(r.score[0], r.n);
+        recordGrades(r.score[0], r.n, gradeFrom, 3, NULL, counts);
+        t = now() - t;
+        best = round == 0 || t < best ? t : best;
+    }
+    printf("RecordStore column:       %.4f s, %zu bytes a record, average %.4f\n", best, sizeof *r.score[0],
+           sum / n);
+    for (g = 0; g < 4; g++)
+        if (counts[g] != aosCounts[g])
+            printf("grade %c: %zu against %zu\n", gradeNames[g], counts[g], aosCounts[g]);
+    recordsFree(&r);
+    free(all);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bulk") == 0)
+        return bulk();
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtoull(argv[2], NULL, 10));
+
     printf("Enter information:\n");
 
     printf("Enter name: ");
-    scanf("%s", s.name);
+    scanf("%49s", s.name);
 
     printf("Enter roll number: ");
     scanf("%d", &s.roll);
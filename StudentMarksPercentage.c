@@ -1,10 +1,77 @@
 // Evaluate total, average and percentage of a student
+//
+// With --bulk it reads one student a line from stdin, the 5 marks
+// separated by blanks or commas, into a RecordStore (Records.h) and
+// writes "total average percentage" for each, and with --grades after
+// it how many students got each grade instead.
 
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include "OutBuffer.h"
+#include "Records.h"
+
+#define SUBJECTS 5
+
+/* by percentage: F below 40, C from 40, B from 60, A from 75, O from 90 */
+static const float gradeFrom[] = {40, 60, 75, 90};
+static const char gradeNames[] = "FCBAO";
+
+static int bulk(int grades)
+{
+    RecordStore r;
+    float *total;
+    size_t i, counts[5];
+    OutBuffer o;
+    int g, rc;
+    if (recordsInit(&r, SUBJECTS, 1024) != 0 || recordsRead(&r, stdin, 0) != 0 ||
+        (total = malloc((r.n ? r.n : 1) * sizeof *total)) == NULL)
+    {
+        fprintf(stderr, "out of memory or failed to read\n");
+        recordsFree(&r);
+        return 1;
+    }
+    recordTotals(&r, total);
+    outInit(&o, stdout, 0);
+    if (!grades)
+        for (i = 0; i < r.n; i++)
+        {
+            outFixed(&o, total[i], 2);
+            outChar(&o, ' ');
+            outFixed(&o, total[i] / SUBJECTS, 2);
+            outChar(&o, ' ');
+            outFixed(&o, (total[i] / (SUBJECTS * 100)) * 100, 2);
+            outChar(&o, '\n');
+        }
+    else
+    {
+        /* the percentage is total / 5, so the thresholds can be on the total */
+        float from[4];
+        for (g = 0; g < 4; g++)
+            from[g] = gradeFrom[g] * SUBJECTS;
+        recordGrades(total, r.n, from, 4, NULL, counts);
+        for (g = 4; g >= 0; g--)
+        {
+            outChar(&o, gradeNames[g]);
+            outText(&o, ": ", 2);
+            outInt(&o, (long long)counts[g]);
+            outChar(&o, '\n');
+        }
+    }
+    rc = outClose(&o);
+    if (r.skipped)
+        fprintf(stderr, "%zu lines skipped\n", r.skipped);
+    free(total);
+    recordsFree(&r);
+    return rc != 0;
+}
+
+int main(int argc, char *argv[])
 {
     int a,b,c,d,e;
     float total,average,percentage;
+    if (argc > 1 && strcmp(argv[1], "--bulk") == 0)
+        return bulk(argc > 2 && strcmp(argv[2], "--grades") == 0);
     printf("Enter marks of 5 subjects : \n");
     scanf("%d%d%d%d%d",&a,&b,&c,&d,&e);
     total  = a+b+c+d+e;
@@ -1,5 +1,15 @@
+#define _GNU_SOURCE //for --pin, see TaskPool.h
 #include<stdio.h>
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<unistd.h>
 #include<pthread.h>
+#include<sched.h>
+#include<sys/syscall.h>
+
+#include "TaskPool.h"
 
 pthread_t tids[3]; //creating three threads using pthread library
 int numbers[10] = {1,2,3,4,5,6,7,8,9,10}; //decleration of numbers array with 10 elements
@@ -15,7 +25,7 @@ void*  first5(void* arg){
 	num[0] = ans;
 }
 
-diving second five numbers into another array
+//dividing second five numbers into another array
 void*  second5(void* arg){
 	int ans = 0;
 	for(int i=5;i<10;i++){
@@ -33,7 +43,359 @@ void* sum(void* arg){
 	printf("%d\n",ans);
 }
 
-int main (void){
+/*
+ * General parallel reduce: run with
+ *	--reduce sum|min|max|xor [--threads N] [--count N] [--grain N] [--pin | --numa]
+ * to fill a buffer of N pseudo-random int64 values and reduce it on the
+ * work-stealing pool in TaskPool.h. The buffer is cut into pieces of
+ * --grain numbers. Each worker reduces the pieces it runs into its own
+ * cache line, so no two threads write to the same line the way first5
+ * and second5 share num[]. The result is checked against one thread
+ * doing all of it. --pin pins each worker to a CPU.
+ * Add --numa for machines with more than one memory node: instead of the
+ * pool, every thread is pinned to a core, spread over the nodes, and
+ * first-touches and reduces one fixed slice, so its data sits on its own
+ * node. The bandwidth of each node is printed as well.
+ * --count 536870912 is 4 GB. Build with -O2 -pthread; add -march=native
+ * to get vector min and max as well (64-bit compares need SSE4.2).
+ */
+#define CACHE_LINE 64
+#define LANES 8 //independent accumulators, so the compiler can vectorize the loop
+
+typedef int64_t (*reduce_fn)(const int64_t *a, size_t n);
+
+//sum wraps around instead of overflowing
+#define OP_SUM(x, y) ((int64_t)((uint64_t)(x) + (uint64_t)(y)))
+#define OP_MIN(x, y) ((y) < (x) ? (y) : (x))
+#define OP_MAX(x, y) ((y) > (x) ? (y) : (x))
+#define OP_XOR(x, y) ((x) ^ (y))
+
+#define REDUCE_KERNEL(name, OP, IDENTITY) \
+int64_t reduce_##name(const int64_t *a, size_t n){ \
+	int64_t acc[LANES], ans = IDENTITY; \
+	size_t i = 0; \
+	for(int j=0;j<LANES;j++) \
+		acc[j] = IDENTITY; \
+	for(;i+LANES<=n;i+=LANES) \
+		for(int j=0;j<LANES;j++) \
+			acc[j] = OP(acc[j], a[i+j]); \
+	for(;i<n;i++) \
+		ans = OP(ans, a[i]); \
+	for(int j=0;j<LANES;j++) \
+		ans = OP(ans, acc[j]); \
+	return ans; \
+}
+
+REDUCE_KERNEL(sum, OP_SUM, 0)
+REDUCE_KERNEL(min, OP_MIN, INT64_MAX)
+REDUCE_KERNEL(max, OP_MAX, INT64_MIN)
+REDUCE_KERNEL(xor, OP_XOR, 0)
+
+//an operator has to be associative, since every worker reduces some pieces
+struct reduce_op{
+	const char *name;
+	int64_t identity;
+	reduce_fn reduce;
+};
+
+struct reduce_op ops[] = {
+	{"sum", 0, reduce_sum},
+	{"min", INT64_MAX, reduce_min},
+	{"max", INT64_MIN, reduce_max},
+	{"xor", 0, reduce_xor},
+};
+
+//one per worker, a cache line each
+struct partial{
+	_Alignas(CACHE_LINE) int64_t value;
+};
+
+struct reduce_job{
+	int64_t *data;
+	reduce_fn reduce;
+	struct partial *partials;
+};
+
+uint64_t value_at(uint64_t i){ //splitmix64, so any thread can make any value
+	uint64_t z = i + 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+//the worker that fills a piece first touches its pages
+void fill_piece(size_t begin, size_t end, void* arg){
+	struct reduce_job *job = arg;
+	for(size_t i=begin;i<end;i++)
+		job->data[i] = (int64_t)value_at(i);
+}
+
+void reduce_piece(size_t begin, size_t end, void* arg){
+	struct reduce_job *job = arg;
+	int64_t *mine = &job->partials[poolWorkerId()].value;
+	int64_t both[2];
+
+	both[0] = *mine;
+	both[1] = job->reduce(job->data + begin, end - begin);
+	*mine = job->reduce(both, 2);
+}
+
+double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define MAX_NODES 64
+
+//CPUs of every memory node, from /sys; one node with every CPU without it
+int numa_nodes(int (*cpus)[256], int *ncpus){
+	int nodes = 0;
+
+	for(int node=0;node<MAX_NODES;node++){
+		char path[64], list[4096], *p = list;
+		FILE *f;
+
+		snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+		if((f = fopen(path, "r")) == NULL)
+			continue;
+		if(fgets(list, sizeof list, f) == NULL)
+			list[0] = '\0';
+		fclose(f);
+		ncpus[nodes] = 0;
+		while(*p >= '0' && *p <= '9'){ //"0-3,8-11"
+			long lo = strtol(p, &p, 10), hi = lo;
+			if(*p == '-')
+				hi = strtol(p + 1, &p, 10);
+			for(long c=lo;c<=hi && ncpus[nodes]<256;c++)
+				cpus[nodes][ncpus[nodes]++] = (int)c;
+			if(*p == ',')
+				p++;
+		}
+		if(ncpus[nodes] > 0) //memory-only nodes have no CPUs to run on
+			nodes++;
+	}
+	if(nodes == 0){
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		for(ncpus[0]=0;ncpus[0]<n && ncpus[0]<256;ncpus[0]++)
+			cpus[0][ncpus[0]] = ncpus[0];
+		nodes = 1;
+	}
+	return nodes;
+}
+
+struct numa_thread{
+	_Alignas(CACHE_LINE) pthread_t tid;
+	int cpu, node;
+	struct reduce_job *job;
+	size_t begin, end;
+	pthread_barrier_t *start, *done;
+	int64_t partial;
+	double seconds; //best of the rounds
+	int local_pages, pages; //of a sample of the slice
+};
+
+#define NUMA_ROUNDS 3
+
+void* numa_worker(void* arg){
+	struct numa_thread *t = arg;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(t->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+	fill_piece(t->begin, t->end, t->job); //first touch, after pinning
+
+#ifdef SYS_move_pages
+	{
+		//with no target nodes, move_pages only says where each page is
+		void *page[64];
+		int status[64];
+		size_t step = (t->end - t->begin) / 64 + 1, n = 0;
+		for(size_t i=t->begin;i<t->end && n<64;i+=step)
+			page[n++] = (void *)((uintptr_t)(t->job->data + i) & ~(uintptr_t)4095);
+		if(syscall(SYS_move_pages, 0, n, page, NULL, status, 0) == 0)
+			for(size_t i=0;i<n;i++){
+				t->pages++;
+				t->local_pages += status[i] == t->node;
+			}
+	}
+#endif
+
+	for(int round=0;round<NUMA_ROUNDS;round++){
+		double start;
+		pthread_barrier_wait(t->start);
+		start = now();
+		t->partial = t->job->reduce(t->job->data + t->begin, t->end - t->begin);
+		if(round == 0 || now() - start < t->seconds)
+			t->seconds = now() - start;
+		pthread_barrier_wait(t->done);
+	}
+	return NULL;
+}
+
+int numa_reduce(struct reduce_op *op, long nthreads, size_t count){
+	static int cpus[MAX_NODES][256];
+	int ncpus[MAX_NODES], used[MAX_NODES] = {0};
+	int nodes = numa_nodes(cpus, ncpus);
+	size_t bytes = (count * sizeof(int64_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	struct numa_thread *t = aligned_alloc(CACHE_LINE, nthreads * sizeof *t);
+	int64_t values[256], ans, check;
+	pthread_barrier_t start_barrier, done_barrier;
+	struct reduce_job job;
+	double best = 0, begin;
+
+	job.data = aligned_alloc(CACHE_LINE, bytes);
+	job.reduce = op->reduce;
+	if(t == NULL || job.data == NULL){
+		printf("Not enough memory for %zu numbers\n", count);
+		return 1;
+	}
+	pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+	pthread_barrier_init(&done_barrier, NULL, nthreads + 1);
+
+	//thread i goes to node i % nodes, so every node gets its share
+	for(long i=0;i<nthreads;i++){
+		int node = i % nodes;
+		memset(&t[i], 0, sizeof t[i]);
+		t[i].node = node;
+		t[i].cpu = cpus[node][used[node]++ % ncpus[node]];
+		t[i].job = &job;
+		t[i].begin = count * i / nthreads;
+		t[i].end = count * (i + 1) / nthreads;
+		t[i].start = &start_barrier;
+		t[i].done = &done_barrier;
+		pthread_create(&t[i].tid, NULL, numa_worker, &t[i]);
+	}
+	for(int round=0;round<NUMA_ROUNDS;round++){
+		pthread_barrier_wait(&start_barrier);
+		begin = now();
+		pthread_barrier_wait(&done_barrier);
+		if(round == 0 || now() - begin < best)
+			best = now() - begin;
+	}
+	for(long i=0;i<nthreads;i++){
+		pthread_join(t[i].tid, NULL);
+		values[i] = t[i].partial;
+	}
+	ans = op->reduce(values, nthreads);
+
+	printf("%s of %zu numbers with %ld threads on %d nodes: %lld\n", op->name, count, nthreads, nodes, (long long)ans);
+	printf("%.3f s, %.2f GB/s\n", best, count * sizeof(int64_t) / best / 1e9);
+	for(int node=0;node<nodes;node++){
+		size_t node_bytes = 0;
+		int threads = 0, local = 0, pages = 0;
+		double slowest = 0;
+		for(long i=0;i<nthreads;i++){
+			if(t[i].node != node)
+				continue;
+			threads++;
+			node_bytes += (t[i].end - t[i].begin) * sizeof(int64_t);
+			if(t[i].seconds > slowest)
+				slowest = t[i].seconds;
+			local += t[i].local_pages;
+			pages += t[i].pages;
+		}
+		if(threads == 0)
+			continue;
+		printf("node %d: %d threads, %.2f GB/s", node, threads, node_bytes / slowest / 1e9);
+		if(pages > 0)
+			printf(", %d%% of sampled pages local", 100 * local / pages);
+		printf("\n");
+	}
+
+	check = op->reduce(job.data, count);
+	pthread_barrier_destroy(&start_barrier);
+	pthread_barrier_destroy(&done_barrier);
+	free(job.data);
+	free(t);
+	if(ans != check){
+		printf("Wrong: one thread gets %lld\n", (long long)check);
+		return 1;
+	}
+	return 0;
+}
+
+int reduce_main(int argc, char *argv[]){
+	struct reduce_op *op = NULL;
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t count = (size_t)1 << 24, grain = 0, bytes;
+	int64_t *data, values[256], ans = 0, check;
+	struct partial *partials;
+	struct reduce_job job;
+	TaskPool pool;
+	int pin = 0, numa = 0, bad = 0;
+	double best = 0, start;
+
+	for(size_t i=0;i<sizeof ops/sizeof ops[0];i++)
+		if(strcmp(argv[2], ops[i].name) == 0)
+			op = &ops[i];
+	for(int i=3;i<argc;i++){
+		if(strcmp(argv[i], "--pin") == 0)
+			pin = 1;
+		else if(strcmp(argv[i], "--numa") == 0)
+			numa = 1;
+		else if(i+1 == argc)
+			bad = 1;
+		else if(strcmp(argv[i], "--threads") == 0)
+			nthreads = atol(argv[++i]);
+		else if(strcmp(argv[i], "--count") == 0)
+			count = (size_t)strtoull(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--grain") == 0)
+			grain = (size_t)strtoull(argv[++i], NULL, 10);
+		else
+			bad = 1;
+	}
+	if(op == NULL || bad || nthreads < 1 || nthreads > 256 || count == 0){
+		printf("Usage: %s --reduce sum|min|max|xor [--threads N] [--count N] [--grain N] [--pin | --numa]\n", argv[0]);
+		return 1;
+	}
+	if(numa)
+		return numa_reduce(op, nthreads, count);
+	if(grain == 0) //a few pieces per worker, so stealing can even out the load
+		grain = count / (nthreads * 8) + 1;
+
+	bytes = (count * sizeof *data + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	data = aligned_alloc(CACHE_LINE, bytes);
+	partials = aligned_alloc(CACHE_LINE, nthreads * sizeof *partials);
+	if(data == NULL || partials == NULL || poolCreatePinned(&pool, (int)nthreads, pin) != 0){
+		printf("Not enough memory for %zu numbers\n", count);
+		return 1;
+	}
+	job.data = data;
+	job.reduce = op->reduce;
+	job.partials = partials;
+	poolParallelFor(&pool, 0, count, grain, fill_piece, &job);
+
+	for(int rep=0;rep<3;rep++){ //best of three
+		start = now();
+		for(long t=0;t<nthreads;t++)
+			partials[t].value = op->identity;
+		poolParallelFor(&pool, 0, count, grain, reduce_piece, &job);
+		for(long t=0;t<nthreads;t++)
+			values[t] = partials[t].value;
+		ans = op->reduce(values, nthreads);
+		if(rep == 0 || now() - start < best)
+			best = now() - start;
+	}
+	poolDestroy(&pool);
+
+	start = now();
+	check = op->reduce(data, count);
+	printf("%s of %zu numbers with %ld threads: %lld\n", op->name, count, nthreads, (long long)ans);
+	printf("%.3f s, %.2f GB/s (one thread: %.3f s)\n", best, count * sizeof *data / best / 1e9, now() - start);
+	if(ans != check){
+		printf("Wrong: one thread gets %lld\n", (long long)check);
+		return 1;
+	}
+	free(partials);
+	free(data);
+	return 0;
+}
+
+int main (int argc, char *argv[]){
+	if(argc > 2 && strcmp(argv[1], "--reduce") == 0)
+		return reduce_main(argc, argv);
 	
 	pthread_create(&tids[0],NULL,first5,(void*)NULL); //creating one thread to calculate sum of first five numbers
 	pthread_create(&tids[1],NULL,second5,(void*)NULL); //creating second thread to calculate sum of last five numbers
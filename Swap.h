@@ -0,0 +1,185 @@
+// Swapping in bulk, for SwapByRefandCopy.c and the other swap programs:
+// two buffers, a rotation, or a whole permutation of an array of records.
+//
+// swapBlocks() exchanges n bytes of a and b a vector at a time, 32 bytes
+// with AVX2 or 16 with SSE2: two loads and two stores, and no temporary
+// buffer, where the + - and ^ tricks of the other programs are three
+// dependent steps a value (and + - overflows).
+//
+// swapRotate() rotates an array of n elements of size bytes left by k, so
+// that element k comes first, by the Gries-Mills block swaps: of the two
+// parts, the shorter one is swapped with the end of the longer, where it
+// belongs, and what is left is the same problem, smaller; each element is
+// moved once or twice, always in runs that swapBlocks() takes a vector at
+// a time. swapRotateReversal() is the other classic, three reversals, which
+// moves every element twice but reads memory front to back.
+//
+// swapPermute() applies a permutation in place: afterwards a[i] is what
+// a[perm[i]] was, so perm can be the order a sort produced, to carry other
+// columns along. It follows each cycle of perm once, moving every element
+// once through one temporary, and marks the places it has filled in a
+// bitset of n bits, so a cycle is started only at a place that is not yet
+// done. Memory is n / 8 bytes beyond the array, not a second copy of it.
+// The price is that a cycle is a chain of dependent random reads, one
+// miss after another once the array is past the caches, where gathering
+// into a second array has many misses in flight; when that copy fits,
+// it is the faster way.
+//
+// swapPermute() returns 0, or -1 when out of memory or when perm is not a
+// permutation of 0 .. n-1 (the array then holds its elements in some
+// other order).
+// Header-only.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define SWAP_TEMP 256 // records up to this size are moved through the stack
+
+static inline void swapBlocks(void *a, void *b, size_t n)
+{
+    unsigned char *p = (unsigned char *)a, *q = (unsigned char *)b;
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(q + i));
+        _mm256_storeu_si256((__m256i *)(p + i), y);
+        _mm256_storeu_si256((__m256i *)(q + i), x);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(q + i));
+        _mm_storeu_si128((__m128i *)(p + i), y);
+        _mm_storeu_si128((__m128i *)(q + i), x);
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, p + i, 8);
+        memcpy(&y, q + i, 8);
+        memcpy(p + i, &y, 8);
+        memcpy(q + i, &x, 8);
+    }
+    for (; i < n; i++)
+    {
+        unsigned char t = p[i];
+        p[i] = q[i];
+        q[i] = t;
+    }
+}
+
+// Reverses the order of n elements of size bytes
+static inline void swapReverse(void *base, size_t n, size_t size)
+{
+    unsigned char *lo = (unsigned char *)base, *hi = lo + (n > 0 ? (n - 1) * size : 0);
+    while (lo < hi)
+    {
+        swapBlocks(lo, hi, size);
+        lo += size;
+        hi -= size;
+    }
+}
+
+// Rotates n elements of size bytes left by k, k <= n, by block swaps
+static inline void swapRotate(void *base, size_t n, size_t size, size_t k)
+{
+    unsigned char *a = (unsigned char *)base;
+    size_t i = k, j = n - k; // the parts [k - i, k) and [k, k + j) left to swap
+    if (k == 0 || k >= n)
+        return;
+    while (i != j)
+    {
+        if (i > j)
+        {
+            swapBlocks(a + (k - i) * size, a + k * size, j * size);
+            i -= j;
+        }
+        else
+        {
+            swapBlocks(a + (k - i) * size, a + (k + j - i) * size, i * size);
+            j -= i;
+        }
+    }
+    swapBlocks(a + (k - i) * size, a + k * size, i * size);
+}
+
+// The same by three reversals
+static inline void swapRotateReversal(void *base, size_t n, size_t size, size_t k)
+{
+    unsigned char *a = (unsigned char *)base;
+    if (k == 0 || k >= n)
+        return;
+    swapReverse(a, k, size);
+    swapReverse(a + k * size, n - k, size);
+    swapReverse(a, n, size);
+}
+
+// a[i] = the old a[perm[i]] for every i < n, elements of size bytes
+static inline int swapPermute(void *base, size_t n, size_t size, const size_t *perm)
+{
+    unsigned char *a = (unsigned char *)base, stack[SWAP_TEMP], *temp = stack;
+    uint64_t *done = (uint64_t *)calloc(n / 64 + 1, sizeof *done);
+    size_t start;
+    int status = 0;
+    if (done == NULL)
+        return -1;
+    if (size > SWAP_TEMP && (temp = (unsigned char *)malloc(size)) == NULL)
+    {
+        free(done);
+        return -1;
+    }
+    for (start = 0; start < n && status == 0; start++)
+    {
+        size_t j = start;
+        if (done[start / 64] >> (start % 64) & 1)
+            continue;
+        if (perm[start] == start) // fixed points are common in nearly sorted data
+        {
+            done[start / 64] |= (uint64_t)1 << (start % 64);
+            continue;
+        }
+        // the cycle start <- perm[start] <- perm[perm[start]] ... <- start
+        memcpy(temp, a + start * size, size);
+        for (;;)
+        {
+            size_t from = perm[j];
+            done[j / 64] |= (uint64_t)1 << (j % 64);
+            if (from == start)
+            {
+                memcpy(a + j * size, temp, size);
+                break;
+            }
+            if (from >= n || done[from / 64] >> (from % 64) & 1)
+            {
+                memcpy(a + j * size, temp, size); // nothing is lost
+                status = -1;
+                break;
+            }
+            memcpy(a + j * size, a + from * size, size);
+            j = from;
+        }
+    }
+    if (temp != stack)
+        free(temp);
+    free(done);
+    return status;
+}
+
+#endif
@@ -1,4 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Swap.h"
+
+// SwapByRefandCopy           the two kinds of swap function below
+// SwapByRefandCopy --bench N swapping in bulk with Swap.h: two arrays of N
+//                            ints, a rotation of N, and N 64-byte records
+//                            put in a random order, each against the
+//                            plain way
 
 // Swap_ref creates a temporary variable temp and dereffrences the address that was sent to it(this is done to get the actual
 // value of the int in the memory space). the dereffrencing allows us to change the actual values.
@@ -17,7 +27,97 @@ void swap(int a, int b)
  b = temp;
 }
 
-int main(void) {
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct
+{
+  long key;
+  char payload[56];
+} Record64;
+
+#define BEST_OF_3(best, setup, work) \
+  do { \
+    int rep_; \
+    (best) = 1e30; \
+    for (rep_ = 0; rep_ < 3; rep_++) { \
+      double t_; \
+      setup; \
+      t_ = now(); \
+      work; \
+      if ((t_ = now() - t_) < (best)) \
+        (best) = t_; \
+    } \
+  } while (0)
+
+static int bench(size_t n)
+{
+  int *x = malloc(n * sizeof *x), *y = malloc(n * sizeof *y);
+  long *r = malloc(n * sizeof *r), *r2 = malloc(n * sizeof *r2), *tmp = malloc(n * sizeof *tmp);
+  Record64 *rec = malloc(n * sizeof *rec), *rec2 = malloc(n * sizeof *rec2), *orig = malloc(n * sizeof *orig);
+  size_t *perm = malloc(n * sizeof *perm), i, k = n / 3;
+  unsigned long long seed = 1;
+  double t1, t2, t3;
+  int ok = 1;
+
+  if (n == 0 || !x || !y || !r || !r2 || !tmp || !rec || !rec2 || !orig || !perm) {
+    printf("Need N > 0 and the memory for it\n");
+    return 1;
+  }
+  for (i = 0; i < n; i++) {
+    x[i] = (int)i;
+    y[i] = -(int)i;
+    orig[i].key = (long)i;
+    memset(orig[i].payload, (int)(i & 0x7f), sizeof orig[i].payload);
+    perm[i] = i;
+  }
+  for (i = n - 1; i > 0; i--) { // a random order, as a sort would give
+    size_t j, t;
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    j = (size_t)((seed >> 33) % (i + 1));
+    t = perm[i];
+    perm[i] = perm[j];
+    perm[j] = t;
+  }
+  printf("N = %zu, best of 3, ns an element\n", n);
+
+  BEST_OF_3(t1, (void)0, for (i = 0; i < n; i++) swap_ref(&x[i], &y[i]));
+  BEST_OF_3(t2, (void)0, swapBlocks(x, y, n * sizeof *x));
+  printf("  two int arrays   swap_ref %.3f   swapBlocks %.3f\n", t1 / n * 1e9, t2 / n * 1e9);
+  ok &= x[n - 1] == (int)(n - 1) && y[n - 1] == -(int)(n - 1); // swapped six times
+
+  for (i = 0; i < n; i++)
+    r2[i] = (long)((i + k) % n);
+  BEST_OF_3(t1, for (i = 0; i < n; i++) r[i] = (long)i,
+            { memcpy(tmp, r, k * sizeof *r); memmove(r, r + k, (n - k) * sizeof *r); memcpy(r + n - k, tmp, k * sizeof *r); });
+  BEST_OF_3(t2, for (i = 0; i < n; i++) r[i] = (long)i, swapRotateReversal(r, n, sizeof *r, k));
+  ok &= memcmp(r, r2, n * sizeof *r) == 0;
+  BEST_OF_3(t3, for (i = 0; i < n; i++) r[i] = (long)i, swapRotate(r, n, sizeof *r, k));
+  ok &= memcmp(r, r2, n * sizeof *r) == 0;
+  printf("  rotate by N/3    copy out %.3f   reversal %.3f   Gries-Mills %.3f\n", t1 / n * 1e9, t2 / n * 1e9,
+         t3 / n * 1e9);
+
+  BEST_OF_3(t1, memcpy(rec, orig, n * sizeof *rec),
+            { for (i = 0; i < n; i++) rec2[i] = rec[perm[i]]; memcpy(rec, rec2, n * sizeof *rec); });
+  BEST_OF_3(t2, memcpy(rec, orig, n * sizeof *rec), ok &= swapPermute(rec, n, sizeof *rec, perm) == 0);
+  for (i = 0; i < n; i++)
+    ok &= memcmp(&rec[i], &orig[perm[i]], sizeof *rec) == 0;
+  printf("  permute records  gather and copy back %.3f   swapPermute %.3f\n", t1 / n * 1e9, t2 / n * 1e9);
+
+  if (!ok)
+    printf("The results differ\n");
+  free(x); free(y); free(r); free(r2); free(tmp); free(rec); free(rec2); free(orig); free(perm);
+  return !ok;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+    return bench(strtoul(argv[2], NULL, 10));
+
   //Declare 2 int variables that are going to be swapped by reference
   int a = 1;
   int b = 2;
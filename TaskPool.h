@@ -0,0 +1,467 @@
+// A small work-stealing task pool shared by Quicksort.c, Mergesort.c and
+// SumUsingThreads.c.
+//
+// Every thread has its own deque of tasks. A thread pushes and pops
+// tasks at the back of its own deque, newest first, which keeps its
+// work cache-hot. An idle thread steals the oldest task from the front
+// of another deque, which is usually the biggest piece of work left.
+// The deques are Chase-Lev deques: the owner's push and pop touch no
+// lock and, unless they race a thief for the last task, no atomic
+// read-modify-write either.
+//
+// Tasks belong to a TaskGroup; poolSpawn() forks a task and poolWait()
+// joins the group, running tasks itself until every task of the group
+// has finished, so waiting inside a task never deadlocks the pool.
+// poolParallelFor() splits a range into tasks of at most grain items.
+//
+// The thread that creates the pool is worker 0; poolCreate(pool, n)
+// starts n - 1 more. poolCreatePinned() also pins worker i to CPU
+// i % CPUs; that needs _GNU_SOURCE defined before the first #include,
+// and does nothing outside Linux. Header-only; build with -pthread. It
+// compiles as C++ too, with std::atomic standing in for C11 atomics.
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <pthread.h>
+#include <sched.h>
+#ifdef __cplusplus
+#include <atomic>
+#define _Atomic(T) std::atomic<T>
+#define _Alignas(n) alignas(n)
+using std::atomic_compare_exchange_strong_explicit;
+using std::atomic_fetch_add;
+using std::atomic_fetch_sub;
+using std::atomic_init;
+using std::atomic_int;
+using std::atomic_int_fast64_t;
+using std::atomic_load;
+using std::atomic_load_explicit;
+using std::atomic_long;
+using std::atomic_store;
+using std::atomic_store_explicit;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+using std::memory_order_seq_cst;
+#else
+#include <stdatomic.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef void (*TaskFn)(void *arg);
+
+typedef struct
+{
+    atomic_long pending; // spawned tasks of the group not finished yet
+} TaskGroup;
+
+typedef struct
+{
+    TaskFn fn;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+// A thief may read a slot while the owner writes it (the thief then
+// loses the race on top and drops what it read), so the fields are atomic.
+typedef struct
+{
+    _Atomic(TaskFn) fn;
+    _Atomic(void *) arg;
+    _Atomic(TaskGroup *) group;
+} TaskSlot;
+
+typedef struct TaskArray
+{
+    int64_t size; // a power of two
+    struct TaskArray *retired; // older, smaller arrays thieves may still read
+    TaskSlot slots[];
+} TaskArray;
+
+// tasks[top..bottom); the owner works at bottom, thieves at top
+typedef struct
+{
+    _Alignas(64) atomic_int_fast64_t top;
+    _Alignas(64) atomic_int_fast64_t bottom;
+    _Atomic(TaskArray *) tasks;
+} TaskDeque;
+
+typedef struct TaskPool TaskPool;
+
+typedef struct
+{
+    TaskPool *pool;
+    int id;
+} TaskWorker;
+
+struct TaskPool
+{
+    int nthreads;
+    int started; // worker threads actually running
+    int pin;
+    pthread_t *threads;
+    TaskWorker *workers;
+    TaskDeque *deques;
+    atomic_long queued; // tasks in all deques
+    atomic_int stop;
+    pthread_mutex_t idleLock;
+    pthread_cond_t idleCond;
+};
+
+// index of the calling thread's deque; 0 for the thread that created the pool
+static __thread int poolSelf = 0;
+
+static inline int poolWorkerId(void)
+{
+    return poolSelf;
+}
+
+static inline void groupInit(TaskGroup *group)
+{
+    atomic_init(&group->pending, 0);
+}
+
+static inline TaskArray *taskArrayNew(int64_t size)
+{
+    TaskArray *a = (TaskArray *)malloc(sizeof *a + size * sizeof a->slots[0]);
+    if (a != NULL)
+    {
+        a->size = size;
+        a->retired = NULL;
+    }
+    return a;
+}
+
+static inline void slotStore(TaskArray *a, int64_t i, Task t)
+{
+    TaskSlot *s = &a->slots[i & (a->size - 1)];
+    atomic_store_explicit(&s->fn, t.fn, memory_order_relaxed);
+    atomic_store_explicit(&s->arg, t.arg, memory_order_relaxed);
+    atomic_store_explicit(&s->group, t.group, memory_order_relaxed);
+}
+
+static inline Task slotLoad(TaskArray *a, int64_t i)
+{
+    TaskSlot *s = &a->slots[i & (a->size - 1)];
+    Task t;
+    t.fn = atomic_load_explicit(&s->fn, memory_order_relaxed);
+    t.arg = atomic_load_explicit(&s->arg, memory_order_relaxed);
+    t.group = atomic_load_explicit(&s->group, memory_order_relaxed);
+    return t;
+}
+
+// Owner only. This is the deque of Le, Pop, Cohen and Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (2013),
+// with their fences folded into seq_cst and release accesses of top and
+// bottom (the same instructions on x86, and ThreadSanitizer understands
+// them, which it does not fences).
+static inline int dequePush(TaskDeque *d, Task t)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&d->top, memory_order_acquire);
+    TaskArray *a = atomic_load_explicit(&d->tasks, memory_order_relaxed);
+
+    if (b - top >= a->size)
+    {
+        // full: copy into an array twice the size; the old one stays
+        // readable until the pool is destroyed
+        TaskArray *bigger = taskArrayNew(a->size * 2);
+        int64_t i;
+        if (bigger == NULL)
+            return -1;
+        for (i = top; i < b; i++)
+            slotStore(bigger, i, slotLoad(a, i));
+        bigger->retired = a;
+        atomic_store_explicit(&d->tasks, bigger, memory_order_release);
+        a = bigger;
+    }
+    slotStore(a, b, t);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return 0;
+}
+
+// Owner only: the newest task
+static inline int dequePop(TaskDeque *d, Task *t)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    TaskArray *a = atomic_load_explicit(&d->tasks, memory_order_relaxed);
+    int64_t top;
+    int found = 1;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_seq_cst);
+    top = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    if (top > b)
+    {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+    *t = slotLoad(a, b);
+    if (top == b)
+    {
+        // the last task: whoever moves top first gets it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed))
+            found = 0;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return found;
+}
+
+// Any thread: the oldest task. Fails when the deque is empty or another
+// thread got the task first.
+static inline int dequeSteal(TaskDeque *d, Task *t)
+{
+    int64_t top = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_seq_cst);
+
+    if (top >= b)
+        return 0;
+    // acquire pairs with the release store of a grown array
+    *t = slotLoad(atomic_load_explicit(&d->tasks, memory_order_acquire), top);
+    return atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+// Runs one task: the newest of our own, else the oldest one we can steal
+static inline int poolTryRun(TaskPool *pool)
+{
+    Task t = { NULL, NULL, NULL };
+    int self = poolSelf, k, found;
+
+    found = dequePop(&pool->deques[self], &t);
+    for (k = 1; !found && k < pool->nthreads; k++)
+        found = dequeSteal(&pool->deques[(self + k) % pool->nthreads], &t);
+    if (!found)
+        return 0;
+
+    atomic_fetch_sub(&pool->queued, 1);
+    t.fn(t.arg);
+    atomic_fetch_sub(&t.group->pending, 1);
+    return 1;
+}
+
+// Queues fn(arg) as part of group. If the task cannot be queued it is
+// run right away instead, so spawning never fails.
+static inline void poolSpawn(TaskPool *pool, TaskGroup *group, TaskFn fn, void *arg)
+{
+    Task t;
+    t.fn = fn;
+    t.arg = arg;
+    t.group = group;
+
+    atomic_fetch_add(&group->pending, 1);
+    if (pool->nthreads == 1 || dequePush(&pool->deques[poolSelf], t) != 0)
+    {
+        fn(arg);
+        atomic_fetch_sub(&group->pending, 1);
+        return;
+    }
+
+    atomic_fetch_add(&pool->queued, 1);
+    pthread_mutex_lock(&pool->idleLock);
+    pthread_cond_signal(&pool->idleCond);
+    pthread_mutex_unlock(&pool->idleLock);
+}
+
+// Helps out with queued tasks until every task of group has finished
+static inline void poolWait(TaskPool *pool, TaskGroup *group)
+{
+    while (atomic_load(&group->pending) > 0)
+    {
+        if (!poolTryRun(pool))
+            sched_yield();
+    }
+}
+
+typedef void (*RangeFn)(size_t begin, size_t end, void *arg);
+
+typedef struct
+{
+    TaskPool *pool;
+    size_t begin, end, grain;
+    RangeFn body;
+    void *arg;
+} PoolRange;
+
+// Splits off the upper half of the range as a task until what is left is
+// at most grain items, runs that, then waits for the halves it split off.
+// Each PoolRange lives on the stack of the call that waits for it.
+static inline void poolRangeTask(void *arg)
+{
+    PoolRange *r = (PoolRange *)arg;
+    PoolRange upper;
+    TaskGroup group;
+
+    if (r->end - r->begin <= r->grain)
+    {
+        r->body(r->begin, r->end, r->arg);
+        return;
+    }
+    upper = *r;
+    upper.begin = r->begin + (r->end - r->begin) / 2;
+    groupInit(&group);
+    poolSpawn(r->pool, &group, poolRangeTask, &upper);
+    {
+        PoolRange lower = *r;
+        lower.end = upper.begin;
+        poolRangeTask(&lower);
+    }
+    poolWait(r->pool, &group);
+}
+
+// Calls body(begin, end, arg) over pieces of [begin, end) of at most grain
+// items (at least 1) in parallel, and returns when all of them are done.
+// poolWorkerId() inside body says which worker runs the piece.
+static inline void poolParallelFor(TaskPool *pool, size_t begin, size_t end, size_t grain,
+                                   RangeFn body, void *arg)
+{
+    PoolRange r;
+
+    if (begin >= end)
+        return;
+    r.pool = pool;
+    r.begin = begin;
+    r.end = end;
+    r.grain = grain < 1 ? 1 : grain;
+    r.body = body;
+    r.arg = arg;
+    poolRangeTask(&r);
+}
+
+static inline void poolPinSelf(int id)
+{
+#if defined(__linux__) && defined(CPU_SET)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+
+    if (cpus < 1)
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(id % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+#else
+    (void)id;
+#endif
+}
+
+static inline void *poolWorkerMain(void *arg)
+{
+    TaskWorker *w = (TaskWorker *)arg;
+    TaskPool *pool = w->pool;
+
+    poolSelf = w->id;
+    if (pool->pin)
+        poolPinSelf(w->id);
+    while (!atomic_load(&pool->stop))
+    {
+        if (poolTryRun(pool))
+            continue;
+
+        // the spawner signals under idleLock after bumping queued, so
+        // checking queued under the same lock cannot miss a wake-up
+        pthread_mutex_lock(&pool->idleLock);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop))
+            pthread_cond_wait(&pool->idleCond, &pool->idleLock);
+        pthread_mutex_unlock(&pool->idleLock);
+    }
+    return NULL;
+}
+
+// Returns 0 on success. With nthreads <= 1 no thread is started and
+// every task runs inline.
+static inline int poolCreatePinned(TaskPool *pool, int nthreads, int pin)
+{
+    int i;
+
+    memset((void *)pool, 0, sizeof *pool);
+    pool->nthreads = nthreads < 1 ? 1 : nthreads;
+    pool->pin = pin;
+    pool->threads = (pthread_t *)calloc(pool->nthreads, sizeof *pool->threads);
+    pool->workers = (TaskWorker *)calloc(pool->nthreads, sizeof *pool->workers);
+    // aligned, so that top and bottom really get a cache line each
+    pool->deques = (TaskDeque *)aligned_alloc(64, pool->nthreads * sizeof *pool->deques);
+    if (pool->threads == NULL || pool->workers == NULL || pool->deques == NULL)
+    {
+        free(pool->threads);
+        free(pool->workers);
+        free(pool->deques);
+        return -1;
+    }
+    memset((void *)pool->deques, 0, pool->nthreads * sizeof *pool->deques);
+
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->stop, 0);
+    pthread_mutex_init(&pool->idleLock, NULL);
+    pthread_cond_init(&pool->idleCond, NULL);
+    for (i = 0; i < pool->nthreads; i++)
+    {
+        TaskArray *a = taskArrayNew(64);
+        if (a == NULL)
+        {
+            while (i-- > 0)
+                free(atomic_load(&pool->deques[i].tasks));
+            free(pool->threads);
+            free(pool->workers);
+            free(pool->deques);
+            return -1;
+        }
+        atomic_init(&pool->deques[i].top, 0);
+        atomic_init(&pool->deques[i].bottom, 0);
+        atomic_init(&pool->deques[i].tasks, a);
+    }
+
+    poolSelf = 0;
+    if (pin)
+        poolPinSelf(0);
+    for (i = 1; i < pool->nthreads; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        // a worker that fails to start is not fatal: only its own thread
+        // would push to its deque, and the others steal from every deque
+        if (pthread_create(&pool->threads[i], NULL, poolWorkerMain, &pool->workers[i]) != 0)
+            break;
+        pool->started = i;
+    }
+    return 0;
+}
+
+static inline int poolCreate(TaskPool *pool, int nthreads)
+{
+    return poolCreatePinned(pool, nthreads, 0);
+}
+
+static inline void poolDestroy(TaskPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->idleLock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->idleCond);
+    pthread_mutex_unlock(&pool->idleLock);
+
+    for (i = 1; i <= pool->started; i++)
+        pthread_join(pool->threads[i], NULL);
+    for (i = 0; i < pool->nthreads; i++)
+    {
+        TaskArray *a = atomic_load(&pool->deques[i].tasks);
+        while (a != NULL)
+        {
+            TaskArray *older = a->retired;
+            free(a);
+            a = older;
+        }
+    }
+    pthread_mutex_destroy(&pool->idleLock);
+    pthread_cond_destroy(&pool->idleCond);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool->deques);
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Temperature conversion in bulk, for AllTempScalesConv.c and the single
+// value converters (FahrenheitToCelciusConv.c, CelciusToKelvinConv.c,
+// Temperature.c, TemperatureSwitch.c).
+//
+// Every conversion between Celsius, Kelvin, Fahrenheit and Rankine is
+// y = a x + b. tempTransform() works out a and b for a pair of scales
+// once, through Kelvin, and then there is no switch on the scales per
+// value: tempConvert() and tempConvertFloats() apply one transform to a
+// whole array, with FMA four doubles or eight floats to an instruction
+// and four of those to a loop, with SSE2 a multiply and an add, and the
+// last few values the same way one at a time, so a value comes out the
+// same wherever it sits in the array.
+//
+// tempConvertCsv() streams a CSV file, converting one column and copying
+// the rest: the input is read in blocks, each field is found as a view of
+// its line (StrView.h), the numbers of up to TEMP_CSV_BATCH lines are
+// parsed into an array, converted together and written back with the
+// given number of decimals, rounded to nearest as printf() would but for
+// ties (FloatText.h). A line whose field is missing or is not a number,
+// such as a header, goes out unchanged.
+//
+// tempTransform() returns 0, or -1 for an unknown scale, with the
+// identity in *t; tempConvertCsv() returns 0, or -1 when out of memory
+// or when a read or write failed. Header-only.
+
+#ifndef TEMP_SCALE_H
+#define TEMP_SCALE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FloatText.h"
+#include "OutBuffer.h"
+#include "StrView.h"
+
+#if defined(__AVX__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum
+{
+    TEMP_CELSIUS,
+    TEMP_KELVIN,
+    TEMP_FAHRENHEIT,
+    TEMP_RANKINE,
+    TEMP_SCALES
+};
+
+typedef struct
+{
+    double a, b;
+} TempTransform;
+
+// kelvin = scale x + offset
+static const long double tempToKelvin[TEMP_SCALES][2] = {
+    {1.0L, 273.15L},
+    {1.0L, 0.0L},
+    {5.0L / 9.0L, 459.67L * 5.0L / 9.0L},
+    {5.0L / 9.0L, 0.0L},
+};
+
+static const char tempScaleNames[TEMP_SCALES] = {'C', 'K', 'F', 'R'};
+
+// 'C', 'K', 'F' or 'R', either case, to TEMP_CELSIUS and so on; -1 for
+// anything else
+static inline int tempScaleFromName(const char *s)
+{
+    int i;
+    for (i = 0; i < TEMP_SCALES; i++)
+        if ((s[0] | 0x20) == (tempScaleNames[i] | 0x20) && s[1] == '\0')
+            return i;
+    return -1;
+}
+
+// The transform from one scale to another: into Kelvin with the first
+// and out of it with the second, in long double so that the ones with
+// round numbers (32, 273.15, 1.8) come out exact
+static inline int tempTransform(int from, int to, TempTransform *t)
+{
+    long double a, b;
+    t->a = 1;
+    t->b = 0;
+    if (from < 0 || from >= TEMP_SCALES || to < 0 || to >= TEMP_SCALES)
+        return -1;
+    a = tempToKelvin[from][0] / tempToKelvin[to][0];
+    b = (tempToKelvin[from][1] - tempToKelvin[to][1]) / tempToKelvin[to][0];
+    t->a = (double)a;
+    t->b = (double)b;
+    return 0;
+}
+
+static inline double tempApply(TempTransform t, double x)
+{
+#if defined(__FMA__)
+    return __builtin_fma(x, t.a, t.b);
+#else
+    return x * t.a + t.b;
+#endif
+}
+
+static inline float tempApplyFloat(float a, float b, float x)
+{
+#if defined(__FMA__)
+    return __builtin_fmaf(x, a, b);
+#else
+    return x * a + b;
+#endif
+}
+
+// out[i] = a in[i] + b for i < n; in may be out
+static inline void tempConvert(TempTransform t, const double *in, double *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX__) && defined(__FMA__)
+    __m256d a = _mm256_set1_pd(t.a), b = _mm256_set1_pd(t.b);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256d x0 = _mm256_loadu_pd(in + i), x1 = _mm256_loadu_pd(in + i + 4);
+        __m256d x2 = _mm256_loadu_pd(in + i + 8), x3 = _mm256_loadu_pd(in + i + 12);
+        _mm256_storeu_pd(out + i, _mm256_fmadd_pd(x0, a, b));
+        _mm256_storeu_pd(out + i + 4, _mm256_fmadd_pd(x1, a, b));
+        _mm256_storeu_pd(out + i + 8, _mm256_fmadd_pd(x2, a, b));
+        _mm256_storeu_pd(out + i + 12, _mm256_fmadd_pd(x3, a, b));
+    }
+#elif defined(__SSE2__)
+    __m128d a = _mm_set1_pd(t.a), b = _mm_set1_pd(t.b);
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128d x0 = _mm_loadu_pd(in + i), x1 = _mm_loadu_pd(in + i + 2);
+        __m128d x2 = _mm_loadu_pd(in + i + 4), x3 = _mm_loadu_pd(in + i + 6);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(x0, a), b));
+        _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(x1, a), b));
+        _mm_storeu_pd(out + i + 4, _mm_add_pd(_mm_mul_pd(x2, a), b));
+        _mm_storeu_pd(out + i + 6, _mm_add_pd(_mm_mul_pd(x3, a), b));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = tempApply(t, in[i]);
+}
+
+static inline void tempConvertFloats(TempTransform t, const float *in, float *out, size_t n)
+{
+    size_t i = 0;
+    float fa = (float)t.a, fb = (float)t.b;
+#if defined(__AVX__) && defined(__FMA__)
+    __m256 a = _mm256_set1_ps(fa), b = _mm256_set1_ps(fb);
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256 x0 = _mm256_loadu_ps(in + i), x1 = _mm256_loadu_ps(in + i + 8);
+        __m256 x2 = _mm256_loadu_ps(in + i + 16), x3 = _mm256_loadu_ps(in + i + 24);
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(x0, a, b));
+        _mm256_storeu_ps(out + i + 8, _mm256_fmadd_ps(x1, a, b));
+        _mm256_storeu_ps(out + i + 16, _mm256_fmadd_ps(x2, a, b));
+        _mm256_storeu_ps(out + i + 24, _mm256_fmadd_ps(x3, a, b));
+    }
+#elif defined(__SSE2__)
+    __m128 a = _mm_set1_ps(fa), b = _mm_set1_ps(fb);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128 x0 = _mm_loadu_ps(in + i), x1 = _mm_loadu_ps(in + i + 4);
+        __m128 x2 = _mm_loadu_ps(in + i + 8), x3 = _mm_loadu_ps(in + i + 12);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(x0, a), b));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(x1, a), b));
+        _mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_mul_ps(x2, a), b));
+        _mm_storeu_ps(out + i + 12, _mm_add_ps(_mm_mul_ps(x3, a), b));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = tempApplyFloat(fa, fb, in[i]);
+}
+
+#define TEMP_CSV_BLOCK (1 << 20)
+#define TEMP_CSV_BATCH 4096
+
+// Field column (from 0) of every line of in converted with t and written
+// to out with decimals digits after the point
+static inline int tempConvertCsv(FILE *in, OutBuffer *out, size_t column, TempTransform t, int decimals)
+{
+    size_t cap = TEMP_CSV_BLOCK, len = 0, got;
+    char *buf = (char *)malloc(cap);
+    // per line of a batch: where it starts, where its field starts and
+    // ends (both 0 when it has none) and where it ends, past the newline
+    size_t *at = (size_t *)malloc(TEMP_CSV_BATCH * 4 * sizeof *at);
+    double *v = (double *)malloc(TEMP_CSV_BATCH * sizeof *v);
+    int eof = 0, rc = 0;
+    if (decimals < 0)
+        decimals = 0;
+    if (decimals > 9)
+        decimals = 9;
+    if (buf == NULL || at == NULL || v == NULL)
+        rc = -1;
+    while (rc == 0 && !eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, cap - len, in);
+        len += got;
+        if (got == 0)
+        {
+            eof = 1;
+            if (ferror(in))
+                rc = -1;
+        }
+        while (pos < len)
+        {
+            size_t k = 0, i;
+            // the whole lines from pos, and at the end of input the last
+            // one even without a newline
+            while (k < TEMP_CSV_BATCH && pos < len)
+            {
+                const char *line = buf + pos, *nl = (const char *)memchr(line, '\n', len - pos), *e;
+                size_t *l = at + 4 * k;
+                StrView f;
+                if (nl == NULL && !eof)
+                    break;
+                e = nl != NULL ? nl : buf + len;
+                if (e > line && e[-1] == '\r')
+                    e--;
+                l[0] = pos;
+                l[1] = l[2] = 0;
+                l[3] = nl != NULL ? (size_t)(nl + 1 - buf) : len;
+                if (svField(svMake(line, (size_t)(e - line)), ',', column, &f) == 0 &&
+                    parseDouble(f.p, f.p + f.n, &v[k]) == 0)
+                {
+                    l[1] = (size_t)(f.p - buf);
+                    l[2] = (size_t)(f.p + f.n - buf);
+                }
+                pos = l[3];
+                k++;
+            }
+            if (k == 0)
+                break;
+            tempConvert(t, v, v, k);
+            for (i = 0; i < k; i++)
+            {
+                const size_t *l = at + 4 * i;
+                if (l[2] == 0)
+                    outText(out, buf + l[0], l[3] - l[0]);
+                else
+                {
+                    outText(out, buf + l[0], l[1] - l[0]);
+                    outFixed(out, v[i], decimals);
+                    outText(out, buf + l[2], l[3] - l[2]);
+                }
+            }
+        }
+        // the part line left goes to the front, and a line longer than
+        // the buffer makes it bigger
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+        if (len == cap)
+        {
+            char *bigger = (char *)realloc(buf, cap * 2);
+            if (bigger == NULL)
+                rc = -1;
+            else
+            {
+                buf = bigger;
+                cap *= 2;
+            }
+        }
+    }
+    free(buf);
+    free(at);
+    free(v);
+    return rc;
+}
+
+#endif
@@ -1,8 +1,11 @@
 #include<stdio.h>
+#include "TempScale.h"
 void main()
 { float a,c,f;
+TempTransform t;
+tempTransform(TEMP_CELSIUS,TEMP_FAHRENHEIT,&t);
 printf("Enter the Temperature in Celcius : ");
 scanf("%f",&c);
-f=c*(9/5)+32;
+f=(float)tempApply(t,c);
 printf("Temperature in Fahernheit is %f",f);
 }
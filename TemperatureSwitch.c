@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include "TempScale.h"
 
 int main()
 {
 	// The resultant temperatures can be in decimals as well, so we use double
-	double c, f, result;
+	double c, f, result = 0;
+	TempTransform t;
 	// We use an integer type data to run the switch statement
 	int choice;
 	printf("Select your choice: \n");
@@ -19,12 +21,14 @@ int main()
 		case 1:
 			printf("Enter the temperature in Celcius: ");
 			scanf("%lf", &c);
-			result = (9 / 5) * c + 32;
+			tempTransform(TEMP_CELSIUS, TEMP_FAHRENHEIT, &t);
+			result = tempApply(t, c);
 			break;
 		case 2:
 			printf("Enter the temperature in Fahrenheit: ");
 			scanf("%lf", &f);
-			result = (5 / 9) * (f - 32);
+			tempTransform(TEMP_FAHRENHEIT, TEMP_CELSIUS, &t);
+			result = tempApply(t, f);
 			break;
 
 		// This case gets activated when the user inputs anything othrer than 1 or 2
@@ -0,0 +1,474 @@
+// Timsort: an adaptive merge sort for nearly sorted data
+//
+// The array is cut into natural runs, stretches that are already
+// ascending or strictly descending (those are reversed in place).
+// Runs shorter than minrun are extended with binary insertion sort.
+// Runs are kept on a stack and merged so that their lengths grow
+// roughly like Fibonacci numbers, which keeps merges balanced. When
+// one run keeps winning during a merge, the merge switches to galloping
+// (exponential search) and copies whole blocks at once.
+// Sorted or reverse-sorted input is one run: O(n). Worst case O(n log n).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// arrays shorter than this are just binary insertion sorted
+#define MIN_MERGE 64
+
+// a merge starts to gallop after this many wins in a row by one side
+#define MIN_GALLOP 7
+
+// enough for any int length, since run lengths grow at least like Fibonacci numbers
+#define MAX_RUNS 85
+
+typedef struct {
+  int * a;
+  int * tmp; // scratch for the smaller run of a merge, n / 2 + 1 ints
+  int min_gallop;
+  int run_base[MAX_RUNS], run_len[MAX_RUNS];
+  int stack_size;
+} TimSort;
+
+int timsort(int a[], int n);
+
+int main() {
+  int * a, n, i;
+  printf("Enter no of elements:");
+  if (scanf("%d", & n) != 1 || n < 0)
+    return 1;
+  a = malloc((n ? n : 1) * sizeof * a);
+  if (a == NULL) {
+    printf("Out of memory");
+    return 1;
+  }
+  printf("Enter array elements:");
+
+  for (i = 0; i < n; i++)
+    scanf("%d", & a[i]);
+
+  if (timsort(a, n) != 0) {
+    printf("Out of memory");
+    return 1;
+  }
+
+  printf("\nSorted array is :");
+  for (i = 0; i < n; i++)
+    printf("%d ", a[i]);
+
+  free(a);
+  return 0;
+}
+
+// Position in a[base..base+len) to insert key before any equal
+// elements. The search starts at base + hint and gallops outwards
+// with steps 1, 3, 7, 15, ... before the final binary search, so a key
+// that lands near the hint costs only a few comparisons.
+static int gallop_left(int key, const int * a, int base, int len, int hint) {
+  int last_ofs = 0, ofs = 1, max_ofs, t;
+
+  if (key > a[base + hint]) {
+    max_ofs = len - hint;
+    while (ofs < max_ofs && key > a[base + hint + ofs]) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+      if (ofs <= 0) // overflow
+        ofs = max_ofs;
+    }
+    if (ofs > max_ofs)
+      ofs = max_ofs;
+    last_ofs += hint;
+    ofs += hint;
+  } else {
+    max_ofs = hint + 1;
+    while (ofs < max_ofs && key <= a[base + hint - ofs]) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+      if (ofs <= 0)
+        ofs = max_ofs;
+    }
+    if (ofs > max_ofs)
+      ofs = max_ofs;
+    t = last_ofs;
+    last_ofs = hint - ofs;
+    ofs = hint - t;
+  }
+
+  // now a[base + last_ofs] < key <= a[base + ofs]
+  last_ofs++;
+  while (last_ofs < ofs) {
+    int m = last_ofs + ((ofs - last_ofs) >> 1);
+    if (key > a[base + m])
+      last_ofs = m + 1;
+    else
+      ofs = m;
+  }
+  return ofs;
+}
+
+// Like gallop_left, but the position is after any equal elements
+static int gallop_right(int key, const int * a, int base, int len, int hint) {
+  int last_ofs = 0, ofs = 1, max_ofs, t;
+
+  if (key < a[base + hint]) {
+    max_ofs = hint + 1;
+    while (ofs < max_ofs && key < a[base + hint - ofs]) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+      if (ofs <= 0)
+        ofs = max_ofs;
+    }
+    if (ofs > max_ofs)
+      ofs = max_ofs;
+    t = last_ofs;
+    last_ofs = hint - ofs;
+    ofs = hint - t;
+  } else {
+    max_ofs = len - hint;
+    while (ofs < max_ofs && key >= a[base + hint + ofs]) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+      if (ofs <= 0)
+        ofs = max_ofs;
+    }
+    if (ofs > max_ofs)
+      ofs = max_ofs;
+    last_ofs += hint;
+    ofs += hint;
+  }
+
+  // now a[base + last_ofs] <= key < a[base + ofs]
+  last_ofs++;
+  while (last_ofs < ofs) {
+    int m = last_ofs + ((ofs - last_ofs) >> 1);
+    if (key < a[base + m])
+      ofs = m;
+    else
+      last_ofs = m + 1;
+  }
+  return ofs;
+}
+
+// Sorts a[lo..hi) by binary insertion, given that a[lo..start) is sorted
+static void binary_sort(int * a, int lo, int hi, int start) {
+  for (; start < hi; start++) {
+    int pivot = a[start], left = lo, right = start;
+    while (left < right) {
+      int mid = (left + right) >> 1;
+      if (pivot < a[mid])
+        right = mid;
+      else
+        left = mid + 1;
+    }
+    memmove(a + left + 1, a + left, (start - left) * sizeof * a);
+    a[left] = pivot;
+  }
+}
+
+// Length of the run starting at lo. A strictly descending run is
+// reversed so that every run ends up ascending; it has to be strict,
+// or reversing would break stability.
+static int count_run(int * a, int lo, int hi) {
+  int run_hi = lo + 1;
+
+  if (run_hi == hi)
+    return 1;
+
+  if (a[run_hi++] < a[lo]) {
+    int i, j;
+    while (run_hi < hi && a[run_hi] < a[run_hi - 1])
+      run_hi++;
+    for (i = lo, j = run_hi - 1; i < j; i++, j--) {
+      int t = a[i];
+      a[i] = a[j];
+      a[j] = t;
+    }
+  } else {
+    while (run_hi < hi && a[run_hi] >= a[run_hi - 1])
+      run_hi++;
+  }
+  return run_hi - lo;
+}
+
+// A minimum run length in [32, 64] such that n / minrun is a power of
+// two or just below one, so that the final merges are balanced
+static int min_run_length(int n) {
+  int r = 0;
+  while (n >= MIN_MERGE) {
+    r |= n & 1;
+    n >>= 1;
+  }
+  return n + r;
+}
+
+// Merges the run a[base1..+len1) with the run right after it, when
+// len1 <= len2: the first run is copied to tmp and merged forwards
+static void merge_lo(TimSort * ts, int base1, int len1, int base2, int len2) {
+  int * a = ts -> a, * tmp = ts -> tmp;
+  int cursor1 = 0, cursor2 = base2, dest = base1, min_gallop = ts -> min_gallop;
+
+  memcpy(tmp, a + base1, len1 * sizeof * a);
+
+  a[dest++] = a[cursor2++];
+  if (--len2 == 0) {
+    memcpy(a + dest, tmp + cursor1, len1 * sizeof * a);
+    return;
+  }
+  if (len1 == 1) {
+    memmove(a + dest, a + cursor2, len2 * sizeof * a);
+    a[dest + len2] = tmp[cursor1];
+    return;
+  }
+
+  for (;;) {
+    int count1 = 0, count2 = 0; // wins in a row by each run
+
+    // one element at a time until one run starts winning consistently
+    do {
+      if (a[cursor2] < tmp[cursor1]) {
+        a[dest++] = a[cursor2++];
+        count2++;
+        count1 = 0;
+        if (--len2 == 0)
+          goto done;
+      } else {
+        a[dest++] = tmp[cursor1++];
+        count1++;
+        count2 = 0;
+        if (--len1 == 1)
+          goto done;
+      }
+    } while ((count1 | count2) < min_gallop);
+
+    // galloping: find how far each run wins and copy that block at once
+    do {
+      count1 = gallop_right(a[cursor2], tmp, cursor1, len1, 0);
+      if (count1 != 0) {
+        memcpy(a + dest, tmp + cursor1, count1 * sizeof * a);
+        dest += count1;
+        cursor1 += count1;
+        len1 -= count1;
+        if (len1 <= 1)
+          goto done;
+      }
+      a[dest++] = a[cursor2++];
+      if (--len2 == 0)
+        goto done;
+
+      count2 = gallop_left(tmp[cursor1], a, cursor2, len2, 0);
+      if (count2 != 0) {
+        memmove(a + dest, a + cursor2, count2 * sizeof * a);
+        dest += count2;
+        cursor2 += count2;
+        len2 -= count2;
+        if (len2 == 0)
+          goto done;
+      }
+      a[dest++] = tmp[cursor1++];
+      if (--len1 == 1)
+        goto done;
+      min_gallop--;
+    } while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+
+    // galloping stopped paying off: make it harder to start again
+    if (min_gallop < 0)
+      min_gallop = 0;
+    min_gallop += 2;
+  }
+
+done:
+  ts -> min_gallop = min_gallop < 1 ? 1 : min_gallop;
+  if (len1 == 1) {
+    memmove(a + dest, a + cursor2, len2 * sizeof * a);
+    a[dest + len2] = tmp[cursor1]; // the last element of run 1 is the largest
+  } else
+    memcpy(a + dest, tmp + cursor1, len1 * sizeof * a);
+}
+
+// The mirror image of merge_lo for len1 > len2: the second run is
+// copied to tmp and the merge runs backwards from the end
+static void merge_hi(TimSort * ts, int base1, int len1, int base2, int len2) {
+  int * a = ts -> a, * tmp = ts -> tmp;
+  int cursor1 = base1 + len1 - 1, cursor2 = len2 - 1, dest = base2 + len2 - 1;
+  int min_gallop = ts -> min_gallop;
+
+  memcpy(tmp, a + base2, len2 * sizeof * a);
+
+  a[dest--] = a[cursor1--];
+  if (--len1 == 0) {
+    memcpy(a + dest - (len2 - 1), tmp, len2 * sizeof * a);
+    return;
+  }
+  if (len2 == 1) {
+    dest -= len1;
+    cursor1 -= len1;
+    memmove(a + dest + 1, a + cursor1 + 1, len1 * sizeof * a);
+    a[dest] = tmp[cursor2];
+    return;
+  }
+
+  for (;;) {
+    int count1 = 0, count2 = 0;
+
+    do {
+      if (tmp[cursor2] < a[cursor1]) {
+        a[dest--] = a[cursor1--];
+        count1++;
+        count2 = 0;
+        if (--len1 == 0)
+          goto done;
+      } else {
+        a[dest--] = tmp[cursor2--];
+        count2++;
+        count1 = 0;
+        if (--len2 == 1)
+          goto done;
+      }
+    } while ((count1 | count2) < min_gallop);
+
+    do {
+      count1 = len1 - gallop_right(tmp[cursor2], a, base1, len1, len1 - 1);
+      if (count1 != 0) {
+        dest -= count1;
+        cursor1 -= count1;
+        len1 -= count1;
+        memmove(a + dest + 1, a + cursor1 + 1, count1 * sizeof * a);
+        if (len1 == 0)
+          goto done;
+      }
+      a[dest--] = tmp[cursor2--];
+      if (--len2 == 1)
+        goto done;
+
+      count2 = len2 - gallop_left(a[cursor1], tmp, 0, len2, len2 - 1);
+      if (count2 != 0) {
+        dest -= count2;
+        cursor2 -= count2;
+        len2 -= count2;
+        memcpy(a + dest + 1, tmp + cursor2 + 1, count2 * sizeof * a);
+        if (len2 <= 1)
+          goto done;
+      }
+      a[dest--] = a[cursor1--];
+      if (--len1 == 0)
+        goto done;
+      min_gallop--;
+    } while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+
+    if (min_gallop < 0)
+      min_gallop = 0;
+    min_gallop += 2;
+  }
+
+done:
+  ts -> min_gallop = min_gallop < 1 ? 1 : min_gallop;
+  if (len2 == 1) {
+    dest -= len1;
+    cursor1 -= len1;
+    memmove(a + dest + 1, a + cursor1 + 1, len1 * sizeof * a);
+    a[dest] = tmp[cursor2]; // the first element of run 2 is the smallest
+  } else
+    memcpy(a + dest - (len2 - 1), tmp, len2 * sizeof * a);
+}
+
+// Merges runs i and i + 1 of the stack
+static void merge_at(TimSort * ts, int i) {
+  int * a = ts -> a;
+  int base1 = ts -> run_base[i], len1 = ts -> run_len[i];
+  int base2 = ts -> run_base[i + 1], len2 = ts -> run_len[i + 1];
+  int k;
+
+  ts -> run_len[i] = len1 + len2;
+  if (i == ts -> stack_size - 3) {
+    ts -> run_base[i + 1] = ts -> run_base[i + 2];
+    ts -> run_len[i + 1] = ts -> run_len[i + 2];
+  }
+  ts -> stack_size--;
+
+  // elements of run 1 that are not bigger than run 2's first are
+  // already in place, and so are the elements of run 2 not smaller
+  // than run 1's last
+  k = gallop_right(a[base2], a, base1, len1, 0);
+  base1 += k;
+  len1 -= k;
+  if (len1 == 0)
+    return;
+
+  len2 = gallop_left(a[base1 + len1 - 1], a, base2, len2, len2 - 1);
+  if (len2 == 0)
+    return;
+
+  if (len1 <= len2)
+    merge_lo(ts, base1, len1, base2, len2);
+  else
+    merge_hi(ts, base1, len1, base2, len2);
+}
+
+// Merges until the top three run lengths X, Y, Z (Z on top) satisfy
+// X > Y + Z and Y > Z. The check reaches one run further down than the
+// original Timsort did, which is needed for the invariant to really hold.
+static void merge_collapse(TimSort * ts) {
+  int * len = ts -> run_len;
+  while (ts -> stack_size > 1) {
+    int n = ts -> stack_size - 2;
+    if ((n > 0 && len[n - 1] <= len[n] + len[n + 1]) ||
+      (n > 1 && len[n - 2] <= len[n] + len[n - 1])) {
+      if (len[n - 1] < len[n + 1])
+        n--;
+    } else if (len[n] > len[n + 1])
+      break;
+    merge_at(ts, n);
+  }
+}
+
+static void merge_force_collapse(TimSort * ts) {
+  while (ts -> stack_size > 1) {
+    int n = ts -> stack_size - 2;
+    if (n > 0 && ts -> run_len[n - 1] < ts -> run_len[n + 1])
+      n--;
+    merge_at(ts, n);
+  }
+}
+
+// Sorts a[0..n) stably. Returns 0 when sorted, -1 when out of memory.
+int timsort(int a[], int n) {
+  TimSort ts;
+  int lo = 0, remaining = n, min_run;
+
+  if (n < 2)
+    return 0;
+
+  if (n < MIN_MERGE) {
+    binary_sort(a, 0, n, count_run(a, 0, n));
+    return 0;
+  }
+
+  ts.a = a;
+  ts.tmp = malloc((n / 2 + 1) * sizeof * ts.tmp);
+  if (ts.tmp == NULL)
+    return -1;
+  ts.min_gallop = MIN_GALLOP;
+  ts.stack_size = 0;
+
+  min_run = min_run_length(n);
+  do {
+    int run = count_run(a, lo, n);
+
+    if (run < min_run) {
+      int force = remaining <= min_run ? remaining : min_run;
+      binary_sort(a, lo, lo + force, lo + run);
+      run = force;
+    }
+
+    ts.run_base[ts.stack_size] = lo;
+    ts.run_len[ts.stack_size] = run;
+    ts.stack_size++;
+    merge_collapse( & ts);
+
+    lo += run;
+    remaining -= run;
+  } while (remaining != 0);
+
+  merge_force_collapse( & ts);
+  free(ts.tmp);
+  return 0;
+}
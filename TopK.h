@@ -0,0 +1,238 @@
+// The largest values of an int array and where they are, in one pass, for
+// Largest.c and the two "Position of First'n'Second maximum" programs.
+//
+// topTwo(a, n, &t) finds the maximum and the largest value below it (the
+// second maximum), each at its first position. With SSE2 or AVX2 every
+// vector lane keeps its own maximum and second maximum with their
+// positions, updated by compares and blends instead of branches, and a
+// block that beats no lane's second maximum is passed over after one
+// compare. At the end the lanes are merged: the second maximum of the
+// array is the first or second value of some lane.
+//
+// topK(a, n, k, values, positions) finds the k largest elements, repeats
+// included, largest first and ties by position. Only elements above the
+// k-th best so far can matter, and after the first few blocks that is
+// almost none of them: a vector compare skips whole blocks. The few that
+// pass are collected with the current best k and run through a bitonic
+// sorting network of TOPK_BUFFER entries, which keeps the top k.
+//
+// Positions are 0-based and n must be below 2^31. Build with -march=native
+// (or -mavx2) to get the 8-lane versions. Header-only.
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define TOPK_MAX 16
+#define TOPK_BUFFER 32
+
+typedef struct
+{
+    int first, second;
+    size_t firstPos, secondPos;
+    int hasSecond; // 0 when every element equals the maximum
+} TopTwo;
+
+#if defined(__AVX2__)
+#define TK_LANES 8
+typedef __m256i TkVec;
+static inline TkVec tkLoad(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline void tkStore(int *p, TkVec v) { _mm256_storeu_si256((__m256i *)p, v); }
+static inline TkVec tkSet(int x) { return _mm256_set1_epi32(x); }
+static inline TkVec tkGt(TkVec a, TkVec b) { return _mm256_cmpgt_epi32(a, b); }
+static inline TkVec tkAnd(TkVec a, TkVec b) { return _mm256_and_si256(a, b); }
+static inline TkVec tkOr(TkVec a, TkVec b) { return _mm256_or_si256(a, b); }
+static inline TkVec tkAdd(TkVec a, TkVec b) { return _mm256_add_epi32(a, b); }
+static inline TkVec tkPick(TkVec a, TkVec b, TkVec mask) { return _mm256_blendv_epi8(a, b, mask); }
+static inline int tkAny(TkVec mask) { return !_mm256_testz_si256(mask, mask); }
+static inline TkVec tkLanes(void) { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+#elif defined(__SSE2__)
+#define TK_LANES 4
+typedef __m128i TkVec;
+static inline TkVec tkLoad(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void tkStore(int *p, TkVec v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline TkVec tkSet(int x) { return _mm_set1_epi32(x); }
+static inline TkVec tkGt(TkVec a, TkVec b) { return _mm_cmpgt_epi32(a, b); }
+static inline TkVec tkAnd(TkVec a, TkVec b) { return _mm_and_si128(a, b); }
+static inline TkVec tkOr(TkVec a, TkVec b) { return _mm_or_si128(a, b); }
+static inline TkVec tkAdd(TkVec a, TkVec b) { return _mm_add_epi32(a, b); }
+// SSE2 has no blend; the compare masks are all ones or all zeros
+static inline TkVec tkPick(TkVec a, TkVec b, TkVec mask)
+{
+    return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+static inline int tkAny(TkVec mask) { return _mm_movemask_epi8(mask) != 0; }
+static inline TkVec tkLanes(void) { return _mm_setr_epi32(0, 1, 2, 3); }
+#endif
+
+// folds value v at position p into t, which holds positions so far
+static inline void topTwoAdd(TopTwo *t, int v, size_t p, int *seen)
+{
+    if (!*seen)
+    {
+        t->first = v;
+        t->firstPos = p;
+        t->hasSecond = 0;
+        *seen = 1;
+    }
+    else if (v > t->first || (v == t->first && p < t->firstPos))
+    {
+        if (v != t->first)
+        {
+            t->second = t->first;
+            t->secondPos = t->firstPos;
+            t->hasSecond = 1;
+        }
+        t->first = v;
+        t->firstPos = p;
+    }
+    else if (v != t->first &&
+             (!t->hasSecond || v > t->second || (v == t->second && p < t->secondPos)))
+    {
+        t->second = v;
+        t->secondPos = p;
+        t->hasSecond = 1;
+    }
+}
+
+// Returns 0, or -1 when n is 0
+static inline int topTwo(const int *a, size_t n, TopTwo *t)
+{
+    size_t i = 0;
+    int seen = 0;
+
+    t->first = t->second = 0;
+    t->firstPos = t->secondPos = 0;
+    t->hasSecond = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    if (n >= 2 * TK_LANES)
+    {
+        // lane l starts with a[l]; p2 < 0 means the lane has no second yet
+        TkVec m1 = tkLoad(a), p1 = tkLanes(), m2 = m1, p2 = tkSet(-1);
+        TkVec idx = p1, step = tkSet(TK_LANES), zero = tkSet(0);
+        int v1[TK_LANES], q1[TK_LANES], v2[TK_LANES], q2[TK_LANES], l;
+        for (i = TK_LANES; i + TK_LANES <= n; i += TK_LANES)
+        {
+            TkVec v = tkLoad(a + i), above, below, better;
+            idx = tkAdd(idx, step);
+            // above the lane's second, or the lane has none; on most
+            // blocks no lane is, and nothing changes
+            better = tkOr(tkGt(v, m2), tkGt(zero, p2));
+            if (!tkAny(better))
+                continue;
+            above = tkGt(v, m1);
+            below = tkGt(m1, v);
+            better = tkAnd(below, better);
+            m2 = tkPick(tkPick(m2, v, better), m1, above);
+            p2 = tkPick(tkPick(p2, idx, better), p1, above);
+            m1 = tkPick(m1, v, above);
+            p1 = tkPick(p1, idx, above);
+        }
+        tkStore(v1, m1);
+        tkStore(q1, p1);
+        tkStore(v2, m2);
+        tkStore(q2, p2);
+        for (l = 0; l < TK_LANES; l++)
+        {
+            topTwoAdd(t, v1[l], (size_t)q1[l], &seen);
+            if (q2[l] >= 0)
+                topTwoAdd(t, v2[l], (size_t)q2[l], &seen);
+        }
+    }
+#endif
+    for (; i < n; i++)
+        topTwoAdd(t, a[i], i, &seen);
+    return seen ? 0 : -1;
+}
+
+// a value and a position as one key: larger value first, then smaller
+// position
+static inline uint64_t topKKey(int v, size_t p)
+{
+    return (uint64_t)((uint32_t)v ^ 0x80000000u) << 32 | (uint32_t)~(uint32_t)p;
+}
+
+// sorts keys[0 .. TOPK_BUFFER) largest first; the same compare-exchanges
+// whatever the data, and each one a pair of conditional moves
+static inline void topKNetwork(uint64_t *keys)
+{
+    int k, j, i;
+    for (k = 2; k <= TOPK_BUFFER; k *= 2)
+        for (j = k / 2; j > 0; j /= 2)
+            for (i = 0; i < TOPK_BUFFER; i++)
+            {
+                int partner = i ^ j;
+                if (partner > i)
+                {
+                    uint64_t x = keys[i], y = keys[partner];
+                    int down = (i & k) == 0; // this block sorts largest first
+                    uint64_t hi = x > y ? x : y, lo = x > y ? y : x;
+                    keys[i] = down ? hi : lo;
+                    keys[partner] = down ? lo : hi;
+                }
+            }
+}
+
+// sorts the collected keys and keeps the best k of them
+static inline void topKFlush(uint64_t *keys, int *used, int *kept, int k, int *threshold)
+{
+    int j;
+    // pad with the smallest key, which no element has and which sorts last
+    for (j = *used; j < TOPK_BUFFER; j++)
+        keys[j] = 0;
+    topKNetwork(keys);
+    *kept = *used < k ? *used : k;
+    *used = *kept;
+    if (*kept == k)
+        *threshold = (int)((uint32_t)(keys[k - 1] >> 32) ^ 0x80000000u);
+}
+
+// Returns how many were found: min(k, n), or -1 if k > TOPK_MAX
+static inline int topK(const int *a, size_t n, int k, int *values, size_t *positions)
+{
+    uint64_t keys[TOPK_BUFFER];
+    int used = 0, kept = 0, j;
+    int threshold = 0; // the k-th best value, once kept == k
+    size_t i = 0;
+
+    if (k < 0 || k > TOPK_MAX)
+        return -1;
+    if (k == 0)
+        return 0;
+    while (i < n)
+    {
+        size_t end = n;
+#if defined(__AVX2__) || defined(__SSE2__)
+        // with k kept, a block needs a value above the k-th to matter
+        if (kept == k && i + TK_LANES <= n && !tkAny(tkGt(tkLoad(a + i), tkSet(threshold))))
+        {
+            i += TK_LANES;
+            continue;
+        }
+        end = i + TK_LANES < n ? i + TK_LANES : n;
+#endif
+        for (; i < end; i++)
+            if (kept < k || a[i] > threshold)
+            {
+                keys[used++] = topKKey(a[i], i);
+                if (used == TOPK_BUFFER)
+                    topKFlush(keys, &used, &kept, k, &threshold);
+            }
+    }
+    topKFlush(keys, &used, &kept, k, &threshold);
+    for (j = 0; j < kept; j++)
+    {
+        values[j] = (int)((uint32_t)(keys[j] >> 32) ^ 0x80000000u);
+        positions[j] = (uint32_t)~(uint32_t)keys[j];
+    }
+    return kept;
+}
+
+
+#endif
@@ -0,0 +1,211 @@
+// Transposing row-major matrices of int, for transposeOfMatrix.c.
+//
+// Walking the source down its columns touches a new cache line, and for
+// big matrices a new page, for every element. Here the work goes in
+// TRANSPOSE_BLOCK x TRANSPOSE_BLOCK blocks, small enough that the rows
+// of one block of the source and of the destination stay in cache and in
+// the TLB, and each block in tiles that are transposed in registers:
+// 8 x 8 with AVX2, three rounds of unpacks (32-bit, 64-bit, then 128-bit
+// halves), or 4 x 4 with SSE2 in two rounds. The ragged edges go one
+// element at a time.
+//
+//   transpose(a, b, rows, cols)     b (cols x rows) = a (rows x cols)
+//   transposeStrided(a, lda, b, ldb, rows, cols)
+//                                   the same with rows lda and ldb apart,
+//                                   as in a Matrix (Matrix.h)
+//   transposeSquare(a, n)           a = a transposed, in place
+//   transposeInPlace(a, rows, cols) a becomes its cols x rows transpose
+//
+// The square one swaps mirrored tiles through a tile on the stack. A
+// rectangle moves each element along the cycle of positions k -> k rows
+// mod (rows cols - 1) it belongs to, with one bit per element to mark
+// those done; that is one pass but with no locality, so when the memory
+// for a second copy is there, transpose() into it is much faster.
+// transposeInPlace() returns 0, or -1 when out of memory for the bits.
+// Header-only.
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSPOSE_TILE 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TRANSPOSE_TILE 4
+#else
+#define TRANSPOSE_TILE 4
+#endif
+
+#define TRANSPOSE_BLOCK 64
+
+// The TRANSPOSE_TILE square at a, rows lda apart, transposed to b, rows
+// ldb apart; all of it is loaded before anything is stored
+static inline void transposeTile(const int *a, size_t lda, int *b, size_t ldb)
+{
+#if defined(__AVX2__)
+    __m256i r0 = _mm256_loadu_si256((const __m256i *)(a + 0 * lda));
+    __m256i r1 = _mm256_loadu_si256((const __m256i *)(a + 1 * lda));
+    __m256i r2 = _mm256_loadu_si256((const __m256i *)(a + 2 * lda));
+    __m256i r3 = _mm256_loadu_si256((const __m256i *)(a + 3 * lda));
+    __m256i r4 = _mm256_loadu_si256((const __m256i *)(a + 4 * lda));
+    __m256i r5 = _mm256_loadu_si256((const __m256i *)(a + 5 * lda));
+    __m256i r6 = _mm256_loadu_si256((const __m256i *)(a + 6 * lda));
+    __m256i r7 = _mm256_loadu_si256((const __m256i *)(a + 7 * lda));
+    // pairs of rows interleaved, within each 128-bit half
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1), t1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi32(r2, r3), t3 = _mm256_unpackhi_epi32(r2, r3);
+    __m256i t4 = _mm256_unpacklo_epi32(r4, r5), t5 = _mm256_unpackhi_epi32(r4, r5);
+    __m256i t6 = _mm256_unpacklo_epi32(r6, r7), t7 = _mm256_unpackhi_epi32(r6, r7);
+    // four rows' worth of one column in each half
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+    _mm256_storeu_si256((__m256i *)(b + 0 * ldb), _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 1 * ldb), _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 2 * ldb), _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 3 * ldb), _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 4 * ldb), _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 5 * ldb), _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 6 * ldb), _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 7 * ldb), _mm256_permute2x128_si256(u3, u7, 0x31));
+#elif defined(__SSE2__)
+    __m128i r0 = _mm_loadu_si128((const __m128i *)(a + 0 * lda));
+    __m128i r1 = _mm_loadu_si128((const __m128i *)(a + 1 * lda));
+    __m128i r2 = _mm_loadu_si128((const __m128i *)(a + 2 * lda));
+    __m128i r3 = _mm_loadu_si128((const __m128i *)(a + 3 * lda));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128((__m128i *)(b + 0 * ldb), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(b + 1 * ldb), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(b + 2 * ldb), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(b + 3 * ldb), _mm_unpackhi_epi64(t2, t3));
+#else
+    int t[TRANSPOSE_TILE][TRANSPOSE_TILE];
+    size_t i, j;
+    for (i = 0; i < TRANSPOSE_TILE; i++)
+        for (j = 0; j < TRANSPOSE_TILE; j++)
+            t[j][i] = a[i * lda + j];
+    for (i = 0; i < TRANSPOSE_TILE; i++)
+        for (j = 0; j < TRANSPOSE_TILE; j++)
+            b[i * ldb + j] = t[i][j];
+#endif
+}
+
+// One block of rows x cols at a into b, with strides lda and ldb
+static inline void transposeBlock(const int *a, size_t lda, int *b, size_t ldb, size_t rows, size_t cols)
+{
+    size_t i, j, fullRows = rows - rows % TRANSPOSE_TILE, fullCols = cols - cols % TRANSPOSE_TILE;
+    for (i = 0; i < fullRows; i += TRANSPOSE_TILE)
+        for (j = 0; j < fullCols; j += TRANSPOSE_TILE)
+            transposeTile(a + i * lda + j, lda, b + j * ldb + i, ldb);
+    // the right edge, then the bottom one
+    for (i = 0; i < fullRows; i++)
+        for (j = fullCols; j < cols; j++)
+            b[j * ldb + i] = a[i * lda + j];
+    for (i = fullRows; i < rows; i++)
+        for (j = 0; j < cols; j++)
+            b[j * ldb + i] = a[i * lda + j];
+}
+
+// b[j * ldb + i] = a[i * lda + j] for the rows x cols at a; a and b must
+// not overlap
+static inline void transposeStrided(const int *a, size_t lda, int *b, size_t ldb, size_t rows, size_t cols)
+{
+    size_t i, j;
+    for (i = 0; i < rows; i += TRANSPOSE_BLOCK)
+        for (j = 0; j < cols; j += TRANSPOSE_BLOCK)
+            transposeBlock(a + i * lda + j, lda, b + j * ldb + i, ldb,
+                           rows - i < TRANSPOSE_BLOCK ? rows - i : TRANSPOSE_BLOCK,
+                           cols - j < TRANSPOSE_BLOCK ? cols - j : TRANSPOSE_BLOCK);
+}
+
+static inline void transpose(const int *a, int *b, size_t rows, size_t cols)
+{
+    transposeStrided(a, cols, b, rows, rows, cols);
+}
+
+// Tiles (ti, tj) and (tj, ti) of the n x n matrix at a swapped and
+// transposed, or the one tile transposed when ti == tj
+static inline void transposeTilePair(int *a, size_t n, size_t ti, size_t tj)
+{
+    int t[TRANSPOSE_TILE * TRANSPOSE_TILE];
+    size_t i;
+    transposeTile(a + tj * n + ti, n, t, TRANSPOSE_TILE);
+    if (ti != tj)
+        transposeTile(a + ti * n + tj, n, a + tj * n + ti, n);
+    for (i = 0; i < TRANSPOSE_TILE; i++)
+    {
+        size_t j;
+        for (j = 0; j < TRANSPOSE_TILE; j++)
+            a[(ti + i) * n + tj + j] = t[i * TRANSPOSE_TILE + j];
+    }
+}
+
+static inline void transposeSquare(int *a, size_t n)
+{
+    size_t full = n - n % TRANSPOSE_TILE, bi, bj, i, j;
+    for (bi = 0; bi < full; bi += TRANSPOSE_BLOCK)
+        for (bj = bi; bj < full; bj += TRANSPOSE_BLOCK)
+        {
+            size_t iEnd = bi + TRANSPOSE_BLOCK < full ? bi + TRANSPOSE_BLOCK : full;
+            size_t jEnd = bj + TRANSPOSE_BLOCK < full ? bj + TRANSPOSE_BLOCK : full;
+            for (i = bi; i < iEnd; i += TRANSPOSE_TILE)
+                for (j = bi == bj ? i : bj; j < jEnd; j += TRANSPOSE_TILE)
+                    transposeTilePair(a, n, i, j);
+        }
+    // the last n % TRANSPOSE_TILE columns against the same rows
+    for (i = 0; i < n; i++)
+        for (j = i < full ? full : i + 1; j < n; j++)
+        {
+            int x = a[i * n + j];
+            a[i * n + j] = a[j * n + i];
+            a[j * n + i] = x;
+        }
+}
+
+static inline int transposeInPlace(int *a, size_t rows, size_t cols)
+{
+    size_t n = rows * cols, start;
+    unsigned char *done;
+    if (rows == cols)
+    {
+        transposeSquare(a, rows);
+        return 0;
+    }
+    if (rows <= 1 || cols <= 1)
+        return 0;
+    done = (unsigned char *)calloc(n / 8 + 1, 1);
+    if (done == NULL)
+        return -1;
+    // element k = i cols + j belongs at j rows + i = k rows mod (n - 1);
+    // the first and last stay put
+    for (start = 1; start < n - 1; start++)
+    {
+        size_t k = start;
+        int carried;
+        if (done[start / 8] & (1 << start % 8))
+            continue;
+        carried = a[start];
+        // follow the cycle from start, moving each element to where it
+        // goes until back at start
+        do
+        {
+            size_t next = (size_t)((unsigned __int128)k * rows % (n - 1));
+            int x = a[next];
+            a[next] = carried;
+            carried = x;
+            done[next / 8] |= (unsigned char)(1 << next % 8);
+            k = next;
+        } while (k != start);
+    }
+    free(done);
+    return 0;
+}
+
+#endif
@@ -1,10 +1,177 @@
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
 #include<math.h>
-void main()
-{ double a,b;
+#include "Trig.h"
+#include "FloatText.h"
+
+/*
+ * Run with --stream UNIT [ACCURACY] [DECIMALS] to write the sine and the
+ * cosine of every angle on stdin, separated by any white space, as
+ * "sin cos" lines; UNIT is degrees or radians, ACCURACY exact, fast or
+ * table (see Trig.h). Anything that is not a number gives nan.
+ * --bench N times sin() and cos() against trigSinCosArray() on N angles.
+ */
+
+#define BLOCK (1 << 20)
+#define BATCH 4096
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void flush_batch(OutBuffer *out, const double *v, double *s, double *c, size_t n, int unit, int accuracy, int decimals)
+{
+    size_t i;
+    trigSinCosArray(v, s, c, n, unit, accuracy);
+    for (i = 0; i < n; i++)
+    {
+        outFixed(out, s[i], decimals);
+        outChar(out, ' ');
+        outFixed(out, c[i], decimals);
+        outChar(out, '\n');
+    }
+}
+
+static int stream(int unit, int accuracy, int decimals)
+{
+    char *buf = malloc(BLOCK);
+    double *v = malloc(3 * BATCH * sizeof *v);
+    size_t len = 0, got, k = 0;
+    OutBuffer out;
+    int eof = 0;
+    if (buf == NULL || v == NULL || outInit(&out, stdout, 0) != 0)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    while (!eof)
+    {
+        size_t pos = 0;
+        got = fread(buf + len, 1, BLOCK - len, stdin);
+        len += got;
+        eof = got == 0;
+        for (;;)
+        {
+            size_t start, end;
+            while (pos < len && is_space(buf[pos]))
+                pos++;
+            for (start = end = pos; end < len && !is_space(buf[end]); end++)
+                ;
+            // a number may go on into the next block
+            if (start == len || (end == len && !eof && !(start == 0 && len == BLOCK)))
+                break;
+            if (k == BATCH)
+            {
+                flush_batch(&out, v, v + BATCH, v + 2 * BATCH, k, unit, accuracy, decimals);
+                k = 0;
+            }
+            if (end - start >= BLOCK / 2 || parseDouble(buf + start, buf + end, &v[k]) != 0)
+                v[k] = NAN;
+            k++;
+            pos = end;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+    flush_batch(&out, v, v + BATCH, v + 2 * BATCH, k, unit, accuracy, decimals);
+    free(buf);
+    free(v);
+    if (outClose(&out) != 0 || ferror(stdin))
+    {
+        fprintf(stderr, "Read or write error\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int bench(size_t n)
+{
+    static const char *names[3] = {"exact", "fast", "table"};
+    double *x = malloc(n * sizeof *x), *s = malloc(n * sizeof *s), *c = malloc(n * sizeof *c);
+    double *ws = malloc(n * sizeof *ws), *wc = malloc(n * sizeof *wc), t, best, err;
+    uint64_t seed = 88172645463325252ULL;
+    size_t i;
+    int accuracy, k;
+    if (x == NULL || s == NULL || c == NULL || ws == NULL || wc == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    // angles of up to a few turns either way, in degrees
+    for (i = 0; i < n; i++)
+    {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        x[i] = ((double)(seed >> 11) * 0x1p-53 - 0.5) * 2000;
+    }
+    for (best = 1e30, k = 0; k < 3; k++)
+    {
+        t = now();
+        for (i = 0; i < n; i++)
+        {
+            double a = x[i] * (M_PI / 180);
+            ws[i] = sin(a);
+            wc[i] = cos(a);
+        }
+        if ((t = now() - t) < best)
+            best = t;
+    }
+    printf("%zu angles in degrees, the sine and the cosine of each, best of 3\n", n);
+    printf("  sin(), cos()          %6.2f ns an angle\n", best / n * 1e9);
+    for (accuracy = TRIG_EXACT; accuracy <= TRIG_TABLE; accuracy++)
+    {
+        for (best = 1e30, k = 0; k < 3; k++)
+        {
+            t = now();
+            trigSinCosArray(x, s, c, n, TRIG_DEGREES, accuracy);
+            if ((t = now() - t) < best)
+                best = t;
+        }
+        for (err = 0, i = 0; i < n; i++)
+            err = fmax(err, fmax(fabs(s[i] - ws[i]), fabs(c[i] - wc[i])));
+        printf("  trigSinCosArray %-5s %6.2f ns an angle, at most %.2g from sin(), cos()\n", names[accuracy], best / n * 1e9, err);
+    }
+    free(x);
+    free(s);
+    free(c);
+    free(ws);
+    free(wc);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{ double a,b,c;
+if (argc >= 3 && argc <= 5 && strcmp(argv[1], "--stream") == 0)
+{
+    int unit = strcmp(argv[2], "degrees") == 0 ? TRIG_DEGREES : strcmp(argv[2], "radians") == 0 ? TRIG_RADIANS : -1;
+    int accuracy = argc < 4 || strcmp(argv[3], "exact") == 0 ? TRIG_EXACT : strcmp(argv[3], "fast") == 0 ? TRIG_FAST :
+                   strcmp(argv[3], "table") == 0 ? TRIG_TABLE : -1;
+    const char *decimals = argc > 4 ? argv[4] : argc > 3 && accuracy < 0 ? argv[3] : "9";
+    if (accuracy < 0 && argc == 4)
+        accuracy = TRIG_EXACT; // the third argument was the decimals
+    if (unit < 0 || accuracy < 0)
+    {
+        fprintf(stderr, "The unit is degrees or radians, the accuracy exact, fast or table\n");
+        return 1;
+    }
+    return stream(unit, accuracy, atoi(decimals));
+}
+if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+    return bench(strtoul(argv[2], NULL, 10));
 printf("Enter the degree : ");
-scanf("%lf",&a);
-a=(a*3.14)/180;
-b=sin(a);
+if (scanf("%lf",&a) != 1)
+    return 1;
+//reduced to a quarter turn in degrees, exactly, before pi / 180 comes in
+trigSinCos(a, TRIG_DEGREES, TRIG_EXACT, &b, &c);
 printf("Sine is %lf",b);
+return 0;
 }
@@ -0,0 +1,311 @@
+// Sines and cosines of whole arrays, in degrees or radians, for Trif.c
+// and anything that runs trigonometry over columns of angles.
+//
+// An angle is reduced to r in [-pi/4, pi/4] and a quadrant k, and then
+// sin(r) and cos(r) are polynomials, swapped and negated by k. For
+// degrees the reduction is exact: k = round(x / 90), and x - 90 k can be
+// written in a double whatever x is, so FMA gets it without rounding;
+// only then are degrees turned into radians, by pi / 180 in two parts.
+// sin(180) is 0 and sin(30) 0.5 to the last bit, which x * 3.14 / 180
+// never was. Radians are reduced Cody-Waite style by pi / 2 in three
+// parts, enough to TRIG_RADIANS_MAX; bigger angles go to libm's sin() and
+// cos(), which do the full reduction. Three accuracies:
+//
+//   TRIG_EXACT  fdlibm's degree 13 and 14 minimax polynomials, with its
+//               split of 1 - r^2 / 2 for the cosine: within 1 ulp or so
+//               of glibc, about 1e-16.
+//   TRIG_FAST   Cephes' single precision polynomials, of degree 7 and 8:
+//               error below 3e-9, with half the terms.
+//   TRIG_TABLE  linear interpolation in a table of TRIG_TABLE_SIZE sines
+//               over a turn, the cosine a quarter turn on: error below
+//               3e-7. Degrees are first reduced exactly to a turn;
+//               radians are not, so their error grows by about 1e-16
+//               times the angle.
+//
+// trigSinCosArray() makes both at once, which costs little more than
+// one; either output may be NULL. With AVX2 and FMA four doubles go at a
+// time, and any four with an angle past the vector reduction among them
+// one at a time through trigSinCos(). NaN and infinity give NaN, as with
+// sin(). Header-only; build with -pthread, which the table's one-time
+// setup uses, and -lm.
+
+#ifndef TRIG_H
+#define TRIG_H
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+enum
+{
+    TRIG_EXACT,
+    TRIG_FAST,
+    TRIG_TABLE
+};
+
+enum
+{
+    TRIG_RADIANS,
+    TRIG_DEGREES
+};
+
+#define TRIG_DEGREES_MAX 1e15 // 90 k stays exact and k fits 53 bits
+#define TRIG_RADIANS_MAX 1e8  // pi / 2 in three parts is still enough
+#define TRIG_TABLE_SIZE 4096  // a power of two
+
+#define TRIG_PIO180_HI 1.7453292519943295e-02 // pi / 180 in two parts
+#define TRIG_PIO180_LO 2.9486522708701687e-19
+#define TRIG_PIO2_1 1.5707963267948966e+00 // pi / 2 in three parts
+#define TRIG_PIO2_2 6.123233995736766e-17
+#define TRIG_PIO2_3 -1.4973849048591698e-33
+#define TRIG_2OPI 6.36619772367581382433e-01
+
+// fdlibm's __kernel_sin and __kernel_cos
+#define TRIG_S1 -1.66666666666666324348e-01
+#define TRIG_S2 8.33333333332248946124e-03
+#define TRIG_S3 -1.98412698298579493134e-04
+#define TRIG_S4 2.75573137070700676789e-06
+#define TRIG_S5 -2.50507602534068634195e-08
+#define TRIG_S6 1.58969099521155010221e-10
+#define TRIG_C1 4.16666666666666019037e-02
+#define TRIG_C2 -1.38888888888741095749e-03
+#define TRIG_C3 2.48015872894767294178e-05
+#define TRIG_C4 -2.75573143513906633035e-07
+#define TRIG_C5 2.08757232129817482790e-09
+#define TRIG_C6 -1.13596475577881948265e-11
+
+// Cephes' sinf() and cosf()
+#define TRIG_FS1 -1.6666654611e-1
+#define TRIG_FS2 8.3321608736e-3
+#define TRIG_FS3 -1.9515295891e-4
+#define TRIG_FC1 4.166664568298827e-2
+#define TRIG_FC2 -1.388731625493765e-3
+#define TRIG_FC3 2.443315711809948e-5
+
+// sin(2 pi i / TRIG_TABLE_SIZE), for a turn and a quarter and one more,
+// so that the cosine and the next entry need no wrap
+static double trigTable[TRIG_TABLE_SIZE + TRIG_TABLE_SIZE / 4 + 1];
+static pthread_once_t trigTableOnce = PTHREAD_ONCE_INIT;
+
+static inline void trigTableFill(void)
+{
+    int i;
+    for (i = 0; i < TRIG_TABLE_SIZE + TRIG_TABLE_SIZE / 4 + 1; i++)
+        trigTable[i] = sin(2 * M_PI * i / TRIG_TABLE_SIZE);
+}
+
+static inline void trigTableInit(void)
+{
+    pthread_once(&trigTableOnce, trigTableFill);
+}
+
+static inline void trigKernel(double r, int accuracy, double *s, double *c)
+{
+    double z = r * r;
+    if (accuracy == TRIG_FAST)
+    {
+        *s = r + r * z * (TRIG_FS1 + z * (TRIG_FS2 + z * TRIG_FS3));
+        *c = 1 - 0.5 * z + z * z * (TRIG_FC1 + z * (TRIG_FC2 + z * TRIG_FC3));
+    }
+    else
+    {
+        double ps = TRIG_S2 + z * (TRIG_S3 + z * (TRIG_S4 + z * (TRIG_S5 + z * TRIG_S6)));
+        double pc = TRIG_C1 + z * (TRIG_C2 + z * (TRIG_C3 + z * (TRIG_C4 + z * (TRIG_C5 + z * TRIG_C6))));
+        double hz = 0.5 * z, w = 1 - hz;
+        *s = r + r * z * (TRIG_S1 + z * ps);
+        *c = w + (((1 - w) - hz) + z * z * pc);
+    }
+}
+
+// Table lookup of the angle p, in table steps
+static inline void trigLookup(double p, double *s, double *c)
+{
+    double i = floor(p), f = p - i;
+    int at = (int)(i - TRIG_TABLE_SIZE * floor(i / TRIG_TABLE_SIZE));
+    *s = trigTable[at] + f * (trigTable[at + 1] - trigTable[at]);
+    at += TRIG_TABLE_SIZE / 4;
+    *c = trigTable[at] + f * (trigTable[at + 1] - trigTable[at]);
+}
+
+static inline void trigSinCos(double x, int unit, int accuracy, double *s, double *c)
+{
+    double k, r, sr, cr;
+    int q;
+    if (!(fabs(x) <= (unit == TRIG_DEGREES ? TRIG_DEGREES_MAX : TRIG_RADIANS_MAX)))
+    {
+        if (unit == TRIG_DEGREES && isfinite(x))
+            x = fmod(x, 360); // exact, and small
+        else
+        {
+            *s = sin(x);
+            *c = cos(x);
+            return;
+        }
+    }
+    if (accuracy == TRIG_TABLE)
+    {
+        trigTableInit();
+        if (unit == TRIG_DEGREES)
+            x = fma(-nearbyint(x * (1 / 360.0)), 360, x);
+        trigLookup(x * (unit == TRIG_DEGREES ? TRIG_TABLE_SIZE / 360.0 : TRIG_TABLE_SIZE / (2 * M_PI)), s, c);
+        return;
+    }
+    if (unit == TRIG_DEGREES)
+    {
+        k = nearbyint(x * (1 / 90.0));
+        r = fma(-k, 90, x);
+        r = fma(r, TRIG_PIO180_HI, r * TRIG_PIO180_LO);
+    }
+    else
+    {
+        k = nearbyint(x * TRIG_2OPI);
+        r = fma(-k, TRIG_PIO2_1, x);
+        r = fma(-k, TRIG_PIO2_2, r);
+        r = fma(-k, TRIG_PIO2_3, r);
+    }
+    q = (int)(k - 4 * floor(k * 0.25));
+    trigKernel(r, accuracy, &sr, &cr);
+    *s = q & 1 ? cr : sr;
+    *c = q & 1 ? sr : cr;
+    *s = q & 2 ? 0 - *s : *s; // 0 - 0 is +0: sin(180) is not -0
+    *c = (q + 1) & 2 ? 0 - *c : *c;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+// Four angles, none of them past the vector reduction
+static inline void trigSinCos4(__m256d x, int unit, int accuracy, __m256d *s, __m256d *c)
+{
+    const __m256d one = _mm256_set1_pd(1);
+    __m256d k, r, z, sr, cr, q, swap, sinNeg, cosNeg;
+    if (accuracy == TRIG_TABLE)
+    {
+        __m256d p;
+        if (unit == TRIG_DEGREES)
+        {
+            k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1 / 360.0)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            x = _mm256_fnmadd_pd(k, _mm256_set1_pd(360), x);
+        }
+        p = _mm256_mul_pd(x, _mm256_set1_pd(unit == TRIG_DEGREES ? TRIG_TABLE_SIZE / 360.0 : TRIG_TABLE_SIZE / (2 * M_PI)));
+        __m256d i = _mm256_floor_pd(p), f = _mm256_sub_pd(p, i);
+        __m256d wrapped = _mm256_fnmadd_pd(_mm256_floor_pd(_mm256_mul_pd(i, _mm256_set1_pd(1.0 / TRIG_TABLE_SIZE))),
+                                           _mm256_set1_pd(TRIG_TABLE_SIZE), i);
+        __m128i at = _mm256_cvtpd_epi32(wrapped), at4 = _mm_add_epi32(at, _mm_set1_epi32(TRIG_TABLE_SIZE / 4));
+        __m256d s0 = _mm256_i32gather_pd(trigTable, at, 8), s1 = _mm256_i32gather_pd(trigTable + 1, at, 8);
+        __m256d c0 = _mm256_i32gather_pd(trigTable, at4, 8), c1 = _mm256_i32gather_pd(trigTable + 1, at4, 8);
+        *s = _mm256_fmadd_pd(f, _mm256_sub_pd(s1, s0), s0);
+        *c = _mm256_fmadd_pd(f, _mm256_sub_pd(c1, c0), c0);
+        return;
+    }
+    if (unit == TRIG_DEGREES)
+    {
+        k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1 / 90.0)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(90), x);
+        r = _mm256_fmadd_pd(r, _mm256_set1_pd(TRIG_PIO180_HI), _mm256_mul_pd(r, _mm256_set1_pd(TRIG_PIO180_LO)));
+    }
+    else
+    {
+        k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(TRIG_2OPI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_1), x);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_2), r);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_3), r);
+    }
+    z = _mm256_mul_pd(r, r);
+    if (accuracy == TRIG_FAST)
+    {
+        __m256d ps = _mm256_fmadd_pd(z, _mm256_set1_pd(TRIG_FS3), _mm256_set1_pd(TRIG_FS2));
+        __m256d pc = _mm256_fmadd_pd(z, _mm256_set1_pd(TRIG_FC3), _mm256_set1_pd(TRIG_FC2));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(TRIG_FS1));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(TRIG_FC1));
+        sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+        cr = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, one));
+    }
+    else
+    {
+        __m256d ps = _mm256_fmadd_pd(z, _mm256_set1_pd(TRIG_S6), _mm256_set1_pd(TRIG_S5));
+        __m256d pc = _mm256_fmadd_pd(z, _mm256_set1_pd(TRIG_C6), _mm256_set1_pd(TRIG_C5));
+        __m256d hz = _mm256_mul_pd(_mm256_set1_pd(0.5), z), w = _mm256_sub_pd(one, hz);
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(TRIG_S4));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(TRIG_C4));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(TRIG_S3));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(TRIG_C3));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(TRIG_S2));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(TRIG_C2));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(TRIG_S1));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(TRIG_C1));
+        sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+        cr = _mm256_add_pd(w, _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc, _mm256_sub_pd(_mm256_sub_pd(one, w), hz)));
+    }
+    q = _mm256_fnmadd_pd(_mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.25))), _mm256_set1_pd(4), k); // 0 .. 3
+    swap = _mm256_or_pd(_mm256_cmp_pd(q, one, _CMP_EQ_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(3), _CMP_EQ_OQ));
+    sinNeg = _mm256_cmp_pd(q, _mm256_set1_pd(2), _CMP_GE_OQ);
+    cosNeg = _mm256_or_pd(_mm256_cmp_pd(q, one, _CMP_EQ_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(2), _CMP_EQ_OQ));
+    z = _mm256_blendv_pd(sr, cr, swap);
+    cr = _mm256_blendv_pd(cr, sr, swap);
+    *s = _mm256_blendv_pd(z, _mm256_sub_pd(_mm256_setzero_pd(), z), sinNeg); // 0 - 0 is +0
+    *c = _mm256_blendv_pd(cr, _mm256_sub_pd(_mm256_setzero_pd(), cr), cosNeg);
+}
+#endif
+
+// sines[i] and cosines[i] of in[i], i < n, either of them NULL when not
+// wanted; unit is TRIG_DEGREES or TRIG_RADIANS
+static inline void trigSinCosArray(const double *in, double *sines, double *cosines, size_t n, int unit, int accuracy)
+{
+    size_t i = 0;
+    double s, c;
+    if (accuracy == TRIG_TABLE)
+        trigTableInit();
+#if defined(__AVX2__) && defined(__FMA__)
+    {
+        const __m256d limit = _mm256_set1_pd(unit == TRIG_DEGREES ? TRIG_DEGREES_MAX : TRIG_RADIANS_MAX);
+        const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d x = _mm256_loadu_pd(in + i), vs, vc;
+            // NaN compares false, so it goes the slow way too
+            if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(x, mask), limit, _CMP_LE_OQ)) != 0xf)
+            {
+                size_t j;
+                for (j = i; j < i + 4; j++)
+                {
+                    trigSinCos(in[j], unit, accuracy, &s, &c);
+                    if (sines != NULL)
+                        sines[j] = s;
+                    if (cosines != NULL)
+                        cosines[j] = c;
+                }
+                continue;
+            }
+            trigSinCos4(x, unit, accuracy, &vs, &vc);
+            if (sines != NULL)
+                _mm256_storeu_pd(sines + i, vs);
+            if (cosines != NULL)
+                _mm256_storeu_pd(cosines + i, vc);
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        trigSinCos(in[i], unit, accuracy, &s, &c);
+        if (sines != NULL)
+            sines[i] = s;
+        if (cosines != NULL)
+            cosines[i] = c;
+    }
+}
+
+static inline void trigSinArray(const double *in, double *out, size_t n, int unit, int accuracy)
+{
+    trigSinCosArray(in, out, NULL, n, unit, accuracy);
+}
+
+static inline void trigCosArray(const double *in, double *out, size_t n, int unit, int accuracy)
+{
+    trigSinCosArray(in, NULL, out, n, unit, accuracy);
+}
+
+#endif
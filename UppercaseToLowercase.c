@@ -2,9 +2,31 @@
 
 
 #include<stdio.h>
-int main()
+
+#include "StringKernels.h"
+
+// Bulk mode: converts a whole file (or stdin for -) to lowercase, 16 bytes
+// at a time, and writes it to stdout
+int convertFile(const char *path)
+{
+    size_t size;
+    char *text = skReadFile(path, &size);
+    if (text == NULL)
+    {
+        printf("Cannot read %s\n", path);
+        return 1;
+    }
+    skToLower(text, size);
+    fwrite(text, 1, size, stdout);
+    free(text);
+    return 0;
+}
+
+int main (int argc, char *argv[])
 {
     char a,u;
+    if (argc == 2)
+        return convertFile(argv[1]);
     printf("Enter Uppercase letter :\n");
     scanf("%c", &a);
     u = a + 32;
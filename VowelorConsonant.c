@@ -1,7 +1,57 @@
 // Program to input a character and check whether it is vowel or consonant using switch case
 #include <stdio.h>
-int main(){
+
+#include "CharClass.h"
+#include "StringKernels.h"
+
+// Bulk mode: counts vowels and consonants in a whole file (or stdin for -)
+// and prints the longest run of letters, found by skipping from run to
+// run over the CC_ALPHA position bitmap
+int countFile(const char *path)
+{
+    size_t size, counts[CC_NFLAGS], pos, bestPos = 0, bestLen = 0;
+    uint64_t *letters;
+    char *text = skReadFile(path, &size);
+    if (text == NULL)
+    {
+        printf("Cannot read %s\n", path);
+        return 1;
+    }
+
+    ccCount(text, size, counts);
+    printf("Vowels     : %zu\n", counts[2]);
+    printf("Consonants : %zu\n", counts[0] - counts[2]);
+
+    letters = malloc(((size + 63) / 64 + 1) * sizeof *letters);
+    if (letters != NULL)
+    {
+        ccMask(text, size, CC_ALPHA, letters);
+        for (pos = 0; pos < size; pos++)
+        {
+            size_t end;
+            if (!(ccClass(text[pos]) & CC_ALPHA))
+                continue;
+            end = ccRunEnd(letters, size, pos);
+            if (end - pos > bestLen)
+            {
+                bestPos = pos;
+                bestLen = end - pos;
+            }
+            pos = end;
+        }
+        if (bestLen > 0)
+            printf("Longest word : %.*s\n", (int)bestLen, text + bestPos);
+        free(letters);
+    }
+
+    free(text);
+    return 0;
+}
+
+int main(int argc, char *argv[]){
     char ch;
+    if(argc == 2)
+        return countFile(argv[1]);
     printf("Enter a character\n");
     scanf("%c", &ch);
     switch(ch)
@@ -1,5 +1,6 @@
 #include<stdio.h>    
 #include<stdlib.h>  
+#include "Pattern.h"
 
 /*
      A                                                                                                                                                        
@@ -8,21 +9,25 @@
   ABCDCBA                                                                                                                                                     
  ABCDEDCBA 
  
+ Run with a number N up to 26 for N rows instead of 5. A row is a slice
+ of "ABC..." after blanks and one of "...CBA" (Pattern.h), into one
+ OutBuffer.
 */
-int main(){  
-  int ch=65;    
-    int i,j,k,m;    
-    for(i=1;i<=5;i++)    
+int main(int argc, char *argv[]){  
+    const char *down = "ZYXWVUTSRQPONMLKJIHGFEDCBA";
+    int i, n = argc > 1 ? atoi(argv[1]) : 5;
+    PatternTemplate up;
+    OutBuffer out;
+    if (n < 1 || n > 26 || patternOpen(&up, n, n) != 0 || outInit(&out, stdout, 0) != 0)
+        return 1;
+    patternRepeat(&up, "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    for(i=1;i<=n;i++)    
     {    
-        for(j=5;j>=i;j--)    
-            printf(" ");    
-        for(k=1;k<=i;k++)    
-            printf("%c",ch++);    
-            ch--;    
-        for(m=1;m<i;m++)    
-            printf("%c",--ch);    
-        printf("\n");    
-        ch=65;    
+        patternSlice(&out, &up, n + 1 - i, i); // A .. the i-th letter
+        outText(&out, down + 27 - i, i - 1);    // and back down to A
+        outChar(&out, '\n');
     }    
+    outClose(&out);
+    patternClose(&up);
 return 0;  
-} 
\ No newline at end of file
+} 
@@ -1,35 +1,112 @@
-#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "BitString.h"
 
-int convert_to_octal(long long binary);
+// The binary number used to be read as a decimal long long, so 19 bits
+// at most, and converted with pow(2, i). Now it is read as a string of any
+// length, packed into 64-bit words eight characters at a time
+// (BitString.h), and written out in octal and hex 3 and 4 bits a digit.
+// Run with --bench BITS to time that on a random string of BITS bits.
 
-int main() {
-    long long binary;
-    printf("Enter a binary number: ");
-    scanf("%lld", &binary);
-    printf("%lld in binary = %d in octal", binary, convert(binary));
-    return 0;
+// The next word on stdin, of any length, into *n characters; NULL at the
+// end of input or when out of memory
+char *read_word(size_t *n) {
+    size_t cap = 64, len = 0;
+    char *s = malloc(cap), *t;
+    int c;
+    while ((c = getchar()) == ' ' || c == '\t' || c == '\n' || c == '\r')
+        ;
+    for (; c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r'; c = getchar()) {
+        if (s == NULL)
+            return NULL;
+        if (len == cap) {
+            t = realloc(s, cap *= 2);
+            if (t == NULL) {
+                free(s);
+                return NULL;
+            }
+            s = t;
+        }
+        s[len++] = (char)c;
+    }
+    if (len == 0) {
+        free(s);
+        return NULL;
+    }
+    *n = len;
+    return s;
+}
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-int convert_to_octal(long long binary) {
-    int octal = 0, decimal = 0, i = 0;
-    
-    //Step 1> convert binary to decimal
-    //Step 2> convert decimal to octal
-    
-    // converting binary to decimal
-    while (binary != 0) {
-        decimal += (binary % 10) * pow(2, i);
-        ++i;
-        binary /= 10;
+int bench(size_t bits) {
+    size_t nw = (bits + 63) / 64, i;
+    char *s = malloc(bits + 1), *oct = malloc(bits / 3 + 3), *hex = malloc(bits / 4 + 3);
+    uint64_t *w = malloc(nw * sizeof(uint64_t)), *check = malloc(nw * sizeof(uint64_t)), x = 88172645463325252ULL;
+    double t0, t1, t2, t3;
+    if (bits == 0 || s == NULL || oct == NULL || hex == NULL || w == NULL || check == NULL) {
+        printf("Needs at least one bit and the memory for them\n");
+        return 1;
+    }
+    for (i = 0; i < bits; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        s[i] = (char)('0' + (x >> 32 & 1));
     }
-    i = 1;
+    // a character at a time, from the end
+    t0 = now();
+    memset(check, 0, nw * sizeof(uint64_t));
+    for (i = 0; i < bits; i++)
+        check[i / 64] |= (uint64_t)(s[bits - 1 - i] - '0') << (i % 64);
+    t1 = now();
+    bitsParse(s, bits, w);
+    t2 = now();
+    bitsToPow2Text(w, nw, 3, oct);
+    bitsToPow2Text(w, nw, 4, hex);
+    t3 = now();
+    printf("%zu bits: a character at a time %.3f ms, bitsParse() %.3f ms, octal and hex %.3f ms%s\n", bits,
+           (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t3 - t2) * 1e3,
+           memcmp(w, check, nw * sizeof(uint64_t)) == 0 ? "" : " (MISMATCH)");
+    free(s);
+    free(oct);
+    free(hex);
+    free(w);
+    free(check);
+    return 0;
+}
 
-    // converting to decimal to octal
-    while (decimal != 0) {
-        octal += (decimal % 8) * i;
-        decimal /= 8;
-        i *= 10;
+int main(int argc, char *argv[]) {
+    size_t n;
+    char *binary, *text;
+    uint64_t *words;
+    int rc = -1;
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtod(argv[2], NULL));
+    printf("Enter a binary number: ");
+    binary = read_word(&n);
+    if (binary == NULL)
+        return 1;
+    words = malloc((n + 63) / 64 * sizeof(uint64_t));
+    text = malloc(n + 2);
+    if (words == NULL || text == NULL)
+        printf("Out of memory\n");
+    else if ((rc = bitsParse(binary, n, words)) != 0)
+        printf("A binary number has only 0s and 1s\n");
+    else {
+        bitsToPow2Text(words, (n + 63) / 64, 3, text);
+        printf("in octal: %s\n", text);
+        bitsToPow2Text(words, (n + 63) / 64, 4, text);
+        printf("in hex: %s\n", text);
     }
-    return octal;
+    free(binary);
+    free(words);
+    free(text);
+    return rc != 0;
 }
@@ -1,12 +1,66 @@
 //Program for printing closest of 2 of a number.
+//
+//The closest power of 2 here is the highest one that is not above the
+//number. It used to be found by clearing every set bit below the highest
+//in a loop over bits 31..0, each through pow(); bitFloorPow2() of
+//Bitset.h keeps just the highest set bit, found by one leading zero count
+//(lzcnt), and works for 64-bit numbers. A negative number has no such
+//power and says so, where the loop gave a wrong answer.
+//
+//    closestpowerof2 --many     every number on stdin, one per line (0 for
+//                               a number below 1)
+//    closestpowerof2 --bench N  timings for N numbers
+//
+//--many reads with FastInput.h and converts a batch at a time with
+//bitFloorPow2Many(), which has no branch.
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
 #include<math.h>
+#include<time.h>
+#include "Bitset.h"
+#include "FastInput.h"
+#include "OutBuffer.h"
 
-int main()
+#define BATCH 4096
+
+int closestAll(void)
+{
+    long long x[BATCH];
+    uint64_t p[BATCH];
+    size_t i, n;
+    FastInput in;
+    OutBuffer out;
+    if (fastInputOpen(&in, stdin) != 0 || outInit(&out, stdout, 0) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    while ((n = fastReadLongLongs(&in, x, BATCH)) > 0)
+    {
+        for (i = 0; i < n; i++)
+            p[i] = x[i] > 0 ? (uint64_t)x[i] : 0;
+        bitFloorPow2Many(p, p, n);
+        for (i = 0; i < n; i++)
+            x[i] = (long long)p[i];
+        outLongLongs(&out, x, n, "\n");
+    }
+    fastInputClose(&in);
+    return outClose(&out) == 0 ? 0 : 1;
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//The old way, for the benchmark
+int oldClosest(int num)
 {
-    int num,a,b,c,d=0;
-    scanf("%d",&num);
+    int b,c,d=0;
     for(b=31;b>=0;--b)
     {
         c=num>>b;
@@ -19,7 +73,64 @@ int main()
             }
         }
     }
-    printf("%d",num);
+    return num;
+}
+
+int bench(size_t n)
+{
+    uint64_t *x = malloc((n ? n : 1) * sizeof *x), p[BATCH];
+    unsigned long long s = 88172645463325252ULL, total = 0;
+    size_t i, j, k;
+    double t0, t1, t2, t3;
+
+    if (x == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    //positive ints of every length
+    for (i = 0; i < n; i++)
+    {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        x[i] = (s >> 33) >> (s % 31);
+    }
+    t0 = now();
+    for (i = 0; i < n; i++)
+        total += (unsigned long long)oldClosest((int)x[i]);
+    t1 = now();
+    for (i = 0; i < n; i++)
+        total += bitFloorPow2(x[i]);
+    t2 = now();
+    //a batch at a time, as --many does
+    for (i = 0; i < n; i += k)
+    {
+        k = n - i < BATCH ? n - i : BATCH;
+        bitFloorPow2Many(x + i, p, k);
+        for (j = 0; j < k; j++)
+            total += p[j];
+    }
+    t3 = now();
+    printf("old %.2f ns, bitFloorPow2() %.2f ns, bitFloorPow2Many() %.2f ns per number (%llu)\n",
+           (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n, (t3 - t2) * 1e9 / n, total);
+    free(x);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long long num = 0;
+    if (argc > 1 && strcmp(argv[1], "--many") == 0)
+        return closestAll();
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtod(argv[2], NULL));
+    scanf("%lld",&num);
+    if (num < 0)
+    {
+        printf("No power of 2 is at most %lld\n", num);
+        return 1;
+    }
+    printf("%llu",(unsigned long long)bitFloorPow2((uint64_t)num));
     return 0;
 }
-//not working for negative no.
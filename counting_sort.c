@@ -1,9 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <limits.h>
+#include "FastInput.h"
+#include "OutBuffer.h"
 
+/* digit width of the radix sort: 6 passes cover a 64-bit key */
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+/* keys per write-combining buffer: one 64-byte cache line */
+#define WC_KEYS 8
+
+/* O(n * m): kept to show why the histogram version below is better */
 long long* count_sort_naive(long long *arr, long n, long m)
 {
-	long long *count_arr = malloc((m + 1) * sizeof(long long));
+	long long *count_arr = calloc(m + 1, sizeof(long long));
 	long long *sorted_arr = malloc(n * sizeof(long long));
 
 	long i_arr = 0;
@@ -21,34 +36,375 @@ long long* count_sort_naive(long long *arr, long n, long m)
 			i_arr += 1;
 		}
 	}
+	free(count_arr);
 	free(arr);
 
 	return sorted_arr;
 }
 
-int main()
+/*
+ * O(n + m) counting sort of values in [0 .. m]: one pass to count every
+ * value, a prefix sum that turns the counts into the first output slot
+ * of each value, and one pass that moves every element to its slot.
+ * Equal values keep their order (the sort is stable). Values outside
+ * the range are dropped. Frees arr like count_sort_naive; returns NULL
+ * when out of memory.
+ */
+long long* count_sort(long long *arr, long n, long m)
 {
+	long *count_arr = calloc(m + 1, sizeof(long));
+	long long *sorted_arr = malloc((n ? n : 1) * sizeof(long long));
+	long sum = 0;
+
+	if (count_arr == NULL || sorted_arr == NULL) {
+		free(count_arr);
+		free(sorted_arr);
+		free(arr);
+		return NULL;
+	}
+
+	for (long j = 0; j < n; ++j) {
+		if (arr[j] >= 0 && arr[j] <= m)
+			count_arr[arr[j]] += 1;
+	}
+
+	for (long i = 0; i <= m; ++i) {
+		long c = count_arr[i];
+		count_arr[i] = sum;
+		sum += c;
+	}
+
+	for (long j = 0; j < n; ++j) {
+		if (arr[j] >= 0 && arr[j] <= m)
+			sorted_arr[count_arr[arr[j]]++] = arr[j];
+	}
+	free(count_arr);
+	free(arr);
+
+	return sorted_arr;
+}
+
+/* the key as unsigned with the sign bit flipped, so negatives come first */
+static uint64_t radix_key(long long x)
+{
+	return (uint64_t)x ^ (UINT64_C(1) << 63);
+}
+
+/*
+ * LSD radix sort of any 64-bit values: a stable counting sort on each
+ * RADIX_BITS-bit digit, lowest digit first. The histograms of all
+ * digits are built in a single pass up front. A digit that is the same
+ * for every key (a single bucket holds all n) is skipped, so small or
+ * clustered ranges take fewer passes. The passes alternate between arr
+ * and one scratch buffer. Returns 0, or -1 when out of memory.
+ */
+int radix_sort(long long *arr, long n)
+{
+	static long hist[RADIX_PASSES][RADIX_SIZE];
+	long long *tmp, *src = arr, *dst;
+
+	if (n < 2)
+		return 0;
+	tmp = malloc(n * sizeof(long long));
+	if (tmp == NULL)
+		return -1;
+	dst = tmp;
+
+	memset(hist, 0, sizeof hist);
+	for (long j = 0; j < n; ++j) {
+		uint64_t k = radix_key(arr[j]);
+		for (int p = 0; p < RADIX_PASSES; ++p)
+			hist[p][(k >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)] += 1;
+	}
+
+	for (int p = 0; p < RADIX_PASSES; ++p) {
+		long *count_arr = hist[p];
+		int shift = p * RADIX_BITS;
+		long sum = 0;
+
+		if (count_arr[(radix_key(src[0]) >> shift) & (RADIX_SIZE - 1)] == n)
+			continue;
+
+		for (int i = 0; i < RADIX_SIZE; ++i) {
+			long c = count_arr[i];
+			count_arr[i] = sum;
+			sum += c;
+		}
+
+		for (long j = 0; j < n; ++j) {
+			long long x = src[j];
+			dst[count_arr[(radix_key(x) >> shift) & (RADIX_SIZE - 1)]++] = x;
+		}
+
+		long long *t = src;
+		src = dst;
+		dst = t;
+	}
+
+	if (src != arr)
+		memcpy(arr, src, n * sizeof(long long));
+	free(tmp);
+	return 0;
+}
+
+/* state shared by the threads of radix_sort_parallel */
+struct radix_shared {
+	long long *arr, *tmp;
+	long n;
+	int threads;
+	long (*hist)[RADIX_SIZE]; /* hist[t]: digit counts of thread t's chunk */
+	pthread_barrier_t barrier;
+	/* workers wait here until it is known how many threads started */
+	pthread_mutex_t gate_lock;
+	pthread_cond_t gate_cond;
+	int gate_open;
+};
+
+struct radix_worker {
+	struct radix_shared *sh;
+	int t;
+	pthread_t thread;
+	long *pos;                   /* next output slot of each bucket */
+	long long (*wc)[WC_KEYS];    /* write-combining buffer of each bucket */
+	unsigned char *wc_n;         /* keys waiting in each buffer */
+	long long *result;           /* where the sorted keys ended up */
+};
+
+/*
+ * One thread of the parallel radix sort. For every digit the thread
+ * counts the digits of its own chunk of the array, then waits until
+ * all threads have counted. Its first output slot for bucket b is the
+ * number of keys in smaller buckets, plus the keys in bucket b that
+ * belong to the chunks before its own. Every thread works this out from
+ * the shared counts by itself, so the result is the same stable order
+ * as the single-threaded sort, whatever the number of threads.
+ * Keys are staged per bucket in cache-line-sized buffers and written
+ * out a full line at a time. That turns many scattered single stores
+ * into few line-sized ones and touches fewer pages at a time.
+ */
+static void *radix_worker_main(void *arg)
+{
+	struct radix_worker *w = arg;
+	struct radix_shared *sh = w->sh;
+	long long *src = sh->arr, *dst = sh->tmp;
+	long lo, hi;
+
+	pthread_mutex_lock(&sh->gate_lock);
+	while (!sh->gate_open)
+		pthread_cond_wait(&sh->gate_cond, &sh->gate_lock);
+	pthread_mutex_unlock(&sh->gate_lock);
+
+	lo = sh->n * w->t / sh->threads;
+	hi = sh->n * (w->t + 1) / sh->threads;
+
+	for (int p = 0; p < RADIX_PASSES; ++p) {
+		int shift = p * RADIX_BITS, skip = 0;
+		long *mine = sh->hist[w->t], sum = 0;
+
+		memset(mine, 0, RADIX_SIZE * sizeof(long));
+		for (long j = lo; j < hi; ++j)
+			mine[(radix_key(src[j]) >> shift) & (RADIX_SIZE - 1)] += 1;
+
+		pthread_barrier_wait(&sh->barrier);
+
+		for (int b = 0; b < RADIX_SIZE; ++b) {
+			long total = 0, before = 0;
+			for (int t = 0; t < sh->threads; ++t) {
+				if (t == w->t)
+					before = total;
+				total += sh->hist[t][b];
+			}
+			if (total == sh->n)
+				skip = 1; /* every key has this digit */
+			w->pos[b] = sum + before;
+			sum += total;
+		}
+
+		if (!skip) {
+			memset(w->wc_n, 0, RADIX_SIZE);
+			for (long j = lo; j < hi; ++j) {
+				long long x = src[j];
+				int b = (radix_key(x) >> shift) & (RADIX_SIZE - 1);
+				w->wc[b][w->wc_n[b]++] = x;
+				if (w->wc_n[b] == WC_KEYS) {
+					memcpy(dst + w->pos[b], w->wc[b], sizeof w->wc[b]);
+					w->pos[b] += WC_KEYS;
+					w->wc_n[b] = 0;
+				}
+			}
+			for (int b = 0; b < RADIX_SIZE; ++b)
+				memcpy(dst + w->pos[b], w->wc[b], w->wc_n[b] * sizeof(long long));
+
+			long long *t = src;
+			src = dst;
+			dst = t;
+		}
+
+		/* nobody may count the next digit before everyone has scattered */
+		pthread_barrier_wait(&sh->barrier);
+	}
+
+	w->result = src;
+	return NULL;
+}
+
+/*
+ * radix_sort on several threads: each takes one contiguous chunk of
+ * the array. Falls back to radix_sort when the buffers can not be
+ * allocated, and runs on fewer threads if some do not start.
+ * Returns 0, or -1 when out of memory.
+ */
+int radix_sort_parallel(long long *arr, long n, int threads)
+{
+	struct radix_shared sh;
+	struct radix_worker *w;
+	int t, started = 0, ok;
+
+	/* need a few keys per bucket and thread for the buffers to pay off */
+	if (threads < 2 || n < (long)threads * RADIX_SIZE)
+		return radix_sort(arr, n);
+
+	sh.arr = arr;
+	sh.n = n;
+	sh.threads = threads;
+	sh.tmp = malloc(n * sizeof(long long));
+	sh.hist = malloc(threads * sizeof *sh.hist);
+	w = calloc(threads, sizeof *w);
+	ok = sh.tmp != NULL && sh.hist != NULL && w != NULL;
+	for (t = 0; ok && t < threads; ++t) {
+		w[t].sh = &sh;
+		w[t].t = t;
+		w[t].pos = malloc(RADIX_SIZE * sizeof(long));
+		w[t].wc = malloc(RADIX_SIZE * sizeof *w[t].wc);
+		w[t].wc_n = malloc(RADIX_SIZE);
+		ok = w[t].pos != NULL && w[t].wc != NULL && w[t].wc_n != NULL;
+	}
+
+	if (ok) {
+		pthread_mutex_init(&sh.gate_lock, NULL);
+		pthread_cond_init(&sh.gate_cond, NULL);
+		sh.gate_open = 0;
+
+		/* the chunks and the barrier depend on how many threads really
+		   run, so the workers are held at the gate until that is known */
+		for (t = 1; t < threads; ++t) {
+			if (pthread_create(&w[t].thread, NULL, radix_worker_main, &w[t]) != 0)
+				break;
+			started++;
+		}
+		sh.threads = started + 1;
+		pthread_barrier_init(&sh.barrier, NULL, sh.threads);
+
+		pthread_mutex_lock(&sh.gate_lock);
+		sh.gate_open = 1;
+		pthread_cond_broadcast(&sh.gate_cond);
+		pthread_mutex_unlock(&sh.gate_lock);
+
+		radix_worker_main(&w[0]);
+		for (t = 1; t <= started; ++t)
+			pthread_join(w[t].thread, NULL);
+		if (w[0].result != arr)
+			memcpy(arr, w[0].result, n * sizeof(long long));
+
+		pthread_barrier_destroy(&sh.barrier);
+		pthread_cond_destroy(&sh.gate_cond);
+		pthread_mutex_destroy(&sh.gate_lock);
+	}
+
+	for (t = 0; w != NULL && t < threads; ++t) {
+		free(w[t].pos);
+		free(w[t].wc);
+		free(w[t].wc_n);
+	}
+	free(w);
+	free(sh.hist);
+	free(sh.tmp);
+
+	return ok ? 0 : radix_sort(arr, n);
+}
+
+int main(int argc, char *argv[])
+{
+	/* --radix: sort any 64-bit values, no range needed;
+	   --threads N: radix sort on N threads;
+	   --fast-input: read the numbers through FastInput.h;
+	   --fast-output, --async-output: print them through OutBuffer.h,
+	   the second from a writer thread */
+	int radix = 0, threads = 1, fast_input = 0, fast_output = 0;
+	FastInput in;
+	OutBuffer out;
+	long long v;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--radix") == 0)
+			radix = 1;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--fast-input") == 0)
+			fast_input = 1;
+		else if (strcmp(argv[i], "--fast-output") == 0 || strcmp(argv[i], "--async-output") == 0)
+			fast_output = argv[i][2] == 'f' ? 1 : 2;
+		else {
+			printf("Usage: %s [--radix [--threads N]] [--fast-input] [--fast-output | --async-output]\n", argv[0]);
+			return 1;
+		}
+	}
+
 	/* Enter the size of the array */
+	if (fast_input && fastInputOpen(&in, stdin) != 0)
+		return 1;
 	long n = 0;
 	printf("Enter the number of elements to be sorted: ");
-	scanf("%ld", &n);
+	if (fast_input ? fastReadLongLong(&in, &v) != 0 || v > LONG_MAX : scanf("%ld", &n) != 1)
+		return 1;
+	if (fast_input)
+		n = (long)v;
+	if (n < 0)
+		return 1;
 
 	/* Enter the range of the array [0 .. m] */
 	long m = 0;
-	printf("Enter the maximum value of the numbers to be sorted: ");
-	scanf("%ld", &m);
+	if (!radix) {
+		printf("Enter the maximum value of the numbers to be sorted: ");
+		if (fast_input ? fastReadLongLong(&in, &v) != 0 || v > LONG_MAX : scanf("%ld", &m) != 1)
+			return 1;
+		if (fast_input)
+			m = (long)v;
+		if (m < 0)
+			return 1;
+	}
 
 	/* Enter the values of the array */
 	printf("Enter the values to be sorted: ");
-	long long *arr = malloc(n * sizeof(long long));
-	for (long i = 0; i < n; ++i) {
-		scanf("%lld", &arr[i]);
+	long long *arr = malloc((n ? n : 1) * sizeof(long long));
+	if (arr == NULL)
+		return 1;
+	if (fast_input) {
+		fastReadLongLongs(&in, arr, (size_t)n);
+		fastInputClose(&in);
+	} else {
+		for (long i = 0; i < n; ++i) {
+			scanf("%lld", &arr[i]);
+		}
 	}
 
-	arr = count_sort_naive(arr, n, m);
+	if (radix) {
+		if (radix_sort_parallel(arr, n, threads) != 0)
+			return 1;
+	} else {
+		arr = count_sort(arr, n, m);
+		if (arr == NULL)
+			return 1;
+	}
 
 	printf("After sorting\n");
-	for (long i = 0; i < n; ++i) {
-		printf("%lld ", arr[i]);
+	if (fast_output && outInit(&out, stdout, fast_output == 2) == 0) {
+		outLongLongs(&out, arr, (size_t)n, " ");
+		outClose(&out);
+	} else {
+		for (long i = 0; i < n; ++i) {
+			printf("%lld ", arr[i]);
+		}
 	}
-}
\ No newline at end of file
+	free(arr);
+	return 0;
+}
@@ -1,41 +1,99 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ModArith.h"
 
-// Declaring a golbal variable as its going to be used again and again in the function
-long long m;
+// x^y mod m by squaring, without recursion or a global modulus: modPow()
+// from ModArith.h, which for an odd m works in Montgomery form (no
+// division per step) and otherwise multiplies in 128 bits, so any m up to
+// 2^63 and any odd m below 2^64 is safe from overflow.
+//
+// Run with --bench N to time N powers with a 64-bit odd modulus and
+// exponent: the plain 128-bit remainder loop, montPow() per base, and
+// montPowBatch() for all bases with one exponent, the shape of the
+// Miller-Rabin and Diffie-Hellman loops.
 
-long long modder(long long x, long long y)
+long long modder(long long x, long long y, long long m)
 {
-	// x to the power zero is 1
-	if(y == 0)
-		return 1;
-	// x to the power one is x
-	else if(y == 1)
-		return x;
-		
-	// We now split the problem in two parts
-	// solve one of them and use its resultant for the second part
-	else
+	// x to the power zero is 1, and everything is 0 mod 1
+	return (long long)modPow(modReduce(x, (uint64_t)m), (uint64_t)y, (uint64_t)m);
+}
+
+// the same powers, a remainder per multiply
+uint64_t powDivide(uint64_t x, uint64_t y, uint64_t m)
+{
+	uint64_t r = 1 % m;
+	x %= m;
+	for (; y != 0; y >>= 1)
 	{
-		long long ans = modder(x, y/2);
-		// If the power is not divisible by 2, we simply multiply by x
-		// Using the concept: (a * b) % m = (a % m * b % m) % m
-		// This concept is used repeatedly when y % 2 != 0
+		if (y & 1)
+			r = modMul(r, x, m);
+		x = modMul(x, x, m);
+	}
+	return r;
+}
+
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-		if(y % 2 == 0)
-			return (ans % m) * (ans % m);
-		else
-			return (((ans % m) * (ans % m)) % m * (x % m)) % m; 
+int bench(size_t n)
+{
+	uint64_t *bases = malloc(n * sizeof(uint64_t)), *out = malloc(n * sizeof(uint64_t));
+	uint64_t seed = 88172645463325252ULL, m = 0xffffffffffffffc5ULL, e = 0xdeadbeefcafebabeULL;
+	uint64_t sum[3] = {0, 0, 0};
+	Montgomery mt = montInit(m);
+	double t[4];
+	size_t i;
+	if (bases == NULL || out == NULL)
+	{
+		printf("Cannot allocate %zu bases\n", n);
+		return 1;
+	}
+	for (i = 0; i < n; i++)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		bases[i] = seed;
 	}
+	t[0] = now();
+	for (i = 0; i < n; i++)
+		sum[0] += powDivide(bases[i], e, m);
+	t[1] = now();
+	for (i = 0; i < n; i++)
+		sum[1] += montOut(&mt, montPow(&mt, montIn(&mt, bases[i] % m), e));
+	t[2] = now();
+	montPowBatch(&mt, bases, e, out, n);
+	t[3] = now();
+	for (i = 0; i < n; i++)
+		sum[2] += out[i];
+	printf("remainder     %.0f ns per power\n", (t[1] - t[0]) * 1e9 / n);
+	printf("montPow       %.0f ns per power\n", (t[2] - t[1]) * 1e9 / n);
+	printf("montPowBatch  %.0f ns per power\n", (t[3] - t[2]) * 1e9 / n);
+	free(bases);
+	free(out);
+	return sum[0] != sum[1] || sum[1] != sum[2];
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	long long x, y, m, result;
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoull(argv[2], NULL, 10));
 	printf("Enter three numbers, x to the power of y modulo m: ");
-	long long x, y, result;
-	scanf("%lld%lld%lld", &x, &y, &m);
+	if (scanf("%lld%lld%lld", &x, &y, &m) != 3 || y < 0 || m <= 0)
+	{
+		printf("Need y >= 0 and m > 0\n");
+		return 1;
+	}
 
-	// We don't need to send m here now
-	result = modder(x, y);
+	result = modder(x, y, m);
 	
 	printf("The resultant is: %lld\n", result);	
 	return 0;
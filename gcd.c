@@ -1,37 +1,82 @@
     #include <stdio.h>
     #include <string.h>
     #include <stdlib.h>
+    #include <stdint.h>
+    #include <time.h>
+    #include "Gcd.h"
 
-    int gcd(int x, int y) {
-        int r = 0, a, b;
-        a = (x > y) ? x : y; // a is greater number
-        b = (x < y) ? x : y; // b is smaller number
-        r = b;
+    // gcd64() and lcm64() come from Gcd.h: a binary gcd with no division,
+    // and an lcm that says when it overflows. Negative numbers count by
+    // their absolute value.
+    //
+    // Run with --bench N to compare Euclid's remainders, gcd64() and
+    // gcdBatch() on N random pairs.
 
-        while (a % b != 0) {
-            r = a % b;
+    uint64_t gcd_euclid(uint64_t a, uint64_t b) {
+        while (b != 0) {
+            uint64_t r = a % b;
             a = b;
             b = r;
         }
-        return r;
-    }     
+        return a;
+    }
+
+    double now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
 
-    int lcm(int x, int y) {
-        int a;
-        a = (x > y) ? x : y; // a is greater number
-        while (1) {
-            if (a % x == 0 && a % y == 0)
-                return a;
-            ++a;
+    int bench(size_t n) {
+        uint64_t *a = malloc(n * sizeof(uint64_t)), *b = malloc(n * sizeof(uint64_t));
+        uint64_t *g = malloc(n * sizeof(uint64_t)), seed = 88172645463325252ULL, sum[3] = {0, 0, 0};
+        double t[3];
+        size_t i;
+        if (a == NULL || b == NULL || g == NULL) {
+            printf("Cannot allocate %zu pairs\n", n);
+            return 1;
         }
-    }     
+        for (i = 0; i < 2 * n; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            if (i < n)
+                a[i] = seed;
+            else
+                b[i - n] = seed;
+        }
+        t[0] = now();
+        for (i = 0; i < n; i++)
+            sum[0] += gcd_euclid(a[i], b[i]);
+        t[1] = now();
+        for (i = 0; i < n; i++)
+            sum[1] += gcd64(a[i], b[i]);
+        t[2] = now();
+        gcdBatch(a, b, g, n);
+        for (i = 0; i < n; i++)
+            sum[2] += g[i];
+        printf("euclid    %.1f ns per pair\n", (t[1] - t[0]) * 1e9 / n);
+        printf("gcd64     %.1f ns per pair\n", (t[2] - t[1]) * 1e9 / n);
+        printf("gcdBatch  %.1f ns per pair\n", (now() - t[2]) * 1e9 / n);
+        free(a);
+        free(b);
+        free(g);
+        return sum[0] != sum[1] || sum[1] != sum[2];
+    }
 
     int main(int argc, char **argv) {
+        long long x, y;
+        uint64_t l;
+        if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+            return bench(strtoull(argv[2], NULL, 10));
         printf("Enter the two numbers: ");
-        int x, y;
-        scanf("%d", &x);
-        scanf("%d", &y);
-        printf("The GCD of two numbers is: %d", gcd(x, y));
-        printf("The LCM of two numbers is: %d", lcm(x, y));
+        if (scanf("%lld", &x) != 1 || scanf("%lld", &y) != 1)
+            return 1;
+        uint64_t ux = x < 0 ? 0 - (uint64_t)x : (uint64_t)x, uy = y < 0 ? 0 - (uint64_t)y : (uint64_t)y;
+        printf("The GCD of two numbers is: %llu", (unsigned long long)gcd64(ux, uy));
+        if (lcm64(ux, uy, &l) != 0)
+            printf("The LCM of two numbers is above 2^64");
+        else
+            printf("The LCM of two numbers is: %llu", (unsigned long long)l);
         return 0;
     }
@@ -1,21 +1,42 @@
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+//children per node in heap_sort; 4 children of an int sit in one cache line
+#define HEAP_ARITY 4
  
 void create(int []);
 void down_adjust(int [],int);
+void heap_sort(int [],int);
  
-void main()
+//Run with --floyd to sort with heap_sort instead: a 0-based 4-ary heap
+//with Floyd's sift-down, in place on a buffer of any length
+int main(int argc,char *argv[])
 {
-	int heap[30],n,i,last,temp;
+	int *heap,n,i,last,temp,floyd;
+	floyd=argc>1 && strcmp(argv[1],"--floyd")==0;
 	printf("Enter no. of elements:");
 	scanf("%d",&n);
+	//heap[0] holds the size, the elements go in heap[1..n]
+	heap=malloc((n > 0 ? n + 1 : 1)*sizeof(int));
+	if(heap==NULL)
+		return 1;
 	printf("\nEnter elements:");
 	for(i=1;i<=n;i++)
 		scanf("%d",&heap[i]);
 	
-	//create a heap
-	heap[0]=n;
-	create(heap);
+	if(floyd)
+	{
+		heap_sort(heap+1,n);
+		heap[0]=0;
+	}
+	else
+	{
+		//create a heap
+		heap[0]=n;
+		create(heap);
+	}
 	
 	//sorting
 	while(heap[0] > 1)
@@ -33,6 +54,8 @@ void main()
 	printf("\nArray after sorting:\n");
 	for(i=1;i<=n;i++)
 		printf("%d ",heap[i]);
+	free(heap);
+	return 0;
 }
  
 void create(int heap[])
@@ -63,4 +86,45 @@ void down_adjust(int heap[],int i)
 			i=j;
 		}
 	}
-}
\ No newline at end of file
+}
+
+//Floyd's sift-down: the hole at i goes all the way down to a leaf,
+//always to the biggest child, without comparing against v. Then v
+//moves back up from the leaf to its place, which is usually only a
+//level or two, so this takes about half the comparisons of down_adjust.
+static void floyd_sift(int a[],int i,int n,int v)
+{
+	int top=i,c,k,best;
+	while((c=HEAP_ARITY*i+1)<n)
+	{
+		best=c;
+		for(k=c+1;k<c+HEAP_ARITY && k<n;k++)
+			if(a[k]>a[best])
+				best=k;
+		a[i]=a[best];
+		i=best;
+	}
+	while(i>top && a[(i-1)/HEAP_ARITY]<v)
+	{
+		a[i]=a[(i-1)/HEAP_ARITY];
+		i=(i-1)/HEAP_ARITY;
+	}
+	a[i]=v;
+}
+
+//sorts a[0..n) in place: the children of a[i] are a[4i+1..4i+4]
+void heap_sort(int a[],int n)
+{
+	int i,last,v;
+	if(n<2)
+		return;
+	//bottom-up heap construction, O(n)
+	for(i=(n-2)/HEAP_ARITY;i>=0;i--)
+		floyd_sift(a,i,n,a[i]);
+	for(last=n-1;last>0;last--)
+	{
+		v=a[last];
+		a[last]=a[0];
+		floyd_sift(a,0,last,v);
+	}
+}
@@ -1,51 +1,663 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
-void extractIpAddress(unsigned char *sourceString,short *ipAddress)
+// An IPv4 address is parsed into a uint32_t, the first octet in the top
+// byte, in a single pass that checks it as it goes: four octets of one
+// to three digits each (zero padding such as 010 is allowed, as the
+// xxx.xxx.xxx.xxx prompt suggests), none above 255, three dots and
+// nothing else. The old version copied each octet into buf[5] (which a
+// long one overflowed), ran atoi() on it and stored it in an unsigned
+// char, so 300 came out as 44, and its class checks missed 191 and 224.
+//
+// parseIpv4Simd() does the same on 16 bytes at once with SSSE3: digits
+// and dots are found by compares, the three dot positions give the
+// octet lengths, and those pick one of 81 shuffles that puts each
+// octet's hundreds, tens and ones in a 4-byte lane. pmaddubsw and
+// pmaddwd then weigh them by 100, 10 and 1, and one compare checks all
+// four against 255. It reads 16 bytes from where the address starts, so
+// the buffer needs 15 bytes of slack after the last one.
+//
+//     ip_address                 reads one address, prints it and its class
+//     ip_address --log FILE      counts the classes of the first field of
+//                                each line of FILE (- for stdin)
+//     ip_address --route CIDRS [FILE]
+//                                maps the first field of each line of FILE
+//                                (or stdin) to its longest prefix from the
+//                                "a.b.c.d/len [name]" lines of CIDRS
+//     ip_address --bench N       times N random addresses each way
+//     ip_address --bench-route P N
+//                                times N lookups in a table of P prefixes
+
+#define IP_BLOCK (1 << 20)
+#define IP_SLACK 16
+#define IP_BATCH 4096
+
+// *ip = the address in s[0 .. n); 0, or -1 if it is not one
+int parseIpv4(const char *s, size_t n, uint32_t *ip)
+{
+    uint32_t value = 0, octet = 0;
+    unsigned digits = 0, dots = 0;
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        unsigned d = (unsigned char)s[i] - '0';
+        if (d <= 9)
+        {
+            octet = octet * 10 + d;
+            if (++digits > 3)
+                return -1;
+        }
+        else if (s[i] == '.' && digits > 0 && octet <= 255 && dots < 3)
+        {
+            value = value << 8 | octet;
+            octet = 0;
+            digits = 0;
+            dots++;
+        }
+        else
+            return -1;
+    }
+    if (dots != 3 || digits == 0 || octet > 255)
+        return -1;
+    *ip = value << 8 | octet;
+    return 0;
+}
+
+#if defined(__SSSE3__)
+// for octet lengths a, b, c, d (1 to 3), entry 27 (a-1) + 9 (b-1) +
+// 3 (c-1) + d-1: where in the address the hundreds, tens and ones of
+// each octet are, 0x80 (a zero) for missing ones
+static unsigned char ipShuffle[81][16];
+
+void ipShuffleInit()
+{
+    int k;
+    for (k = 0; k < 81; k++)
+    {
+        int len[4] = {k / 27 + 1, k / 9 % 3 + 1, k / 3 % 3 + 1, k % 3 + 1}, start = 0, j, i;
+        for (j = 0; j < 4; j++)
+        {
+            for (i = 0; i < 4; i++)
+            {
+                // lane byte i holds digit 3 - i counted from the end, byte 3 is 0
+                int from = i < 3 && 3 - i <= len[j] ? start + len[j] - (3 - i) : -1;
+                ipShuffle[k][4 * j + i] = from < 0 ? 0x80 : (unsigned char)from;
+            }
+            start += len[j] + 1;
+        }
+    }
+}
+#endif
+
+// parseIpv4() of s[0 .. n), 16 bytes at a time where SSSE3 is there;
+// s[0 .. 16) must be readable
+int parseIpv4Simd(const char *s, size_t n, uint32_t *ip)
+{
+#if defined(__SSSE3__)
+    static int ready;
+    __m128i v, d, w;
+    unsigned all, dots, digits, d1, d2, d3, a, b, c, e;
+    if (!ready)
+    {
+        ipShuffleInit();
+        ready = 1;
+    }
+    if (n < 7 || n > 15)
+        return -1;
+    all = (1u << n) - 1;
+    v = _mm_loadu_si128((const __m128i *)s);
+    d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    dots = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.'))) & all;
+    digits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d)) & all;
+    if ((dots | digits) != all || __builtin_popcount(dots) != 3)
+        return -1;
+    d1 = (unsigned)__builtin_ctz(dots);
+    dots &= dots - 1;
+    d2 = (unsigned)__builtin_ctz(dots);
+    dots &= dots - 1;
+    d3 = (unsigned)__builtin_ctz(dots);
+    a = d1;
+    b = d2 - d1 - 1;
+    c = d3 - d2 - 1;
+    e = (unsigned)n - d3 - 1;
+    if (a - 1 > 2 || b - 1 > 2 || c - 1 > 2 || e - 1 > 2)
+        return -1;
+    d = _mm_shuffle_epi8(d, _mm_loadu_si128((const __m128i *)ipShuffle[27 * (a - 1) + 9 * (b - 1) + 3 * (c - 1) + e - 1]));
+    // 100 h + 10 t and o in 16 bits, then their sum in 32
+    w = _mm_maddubs_epi16(d, _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0));
+    w = _mm_madd_epi16(w, _mm_set1_epi16(1));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(w, _mm_set1_epi32(255))) != 0)
+        return -1;
+    w = _mm_packus_epi16(_mm_packs_epi32(w, w), w);
+    *ip = __builtin_bswap32((uint32_t)_mm_cvtsi128_si32(w));
+    return 0;
+#else
+    return parseIpv4(s, n, ip);
+#endif
+}
+
+// A 0-127, B 128-191, C 192-223, D 224-239 and E 240-255 by the first
+// octet
+char ipClass(uint32_t ip)
+{
+    unsigned first = ip >> 24;
+    return first < 128 ? 'A' : first < 192 ? 'B' : first < 224 ? 'C' : first < 240 ? 'D' : 'E';
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Reads f a block at a time and parses the first field of each complete
+// line; the addresses go to batch() IP_BATCH at a time. The buffer keeps
+// IP_SLACK bytes after the data for the 16-byte loads. 0, or -1 when out
+// of memory or a line is longer than IP_BLOCK.
+int scanLog(FILE *f, void (*batch)(const uint32_t *ip, size_t n, void *arg), void *arg, size_t *lines, size_t *bad)
+{
+    char *buf = malloc(IP_BLOCK + IP_SLACK);
+    uint32_t ip[IP_BATCH];
+    size_t have = 0, got, k = 0;
+    if (buf == NULL)
+        return -1;
+    *lines = *bad = 0;
+    do
+    {
+        char *p = buf, *end;
+        got = fread(buf + have, 1, IP_BLOCK - have, f);
+        have += got;
+        end = buf + have;
+        memset(end, 0, IP_SLACK);
+        for (;;)
+        {
+            char *nl = memchr(p, '\n', (size_t)(end - p)), *q;
+            // the last line of a block waits for the rest, unless the input is over
+            if (nl == NULL && (got > 0 || p == end))
+                break;
+            if (nl == NULL)
+                nl = end;
+            while (p < nl && (*p == ' ' || *p == '\t'))
+                p++;
+            for (q = p; q < nl && *q != ' ' && *q != '\t' && *q != '\r'; q++)
+                ;
+            ++*lines;
+            if (parseIpv4Simd(p, (size_t)(q - p), &ip[k]) != 0)
+                ++*bad;
+            else if (++k == IP_BATCH)
+            {
+                batch(ip, k, arg);
+                k = 0;
+            }
+            p = nl + (nl < end);
+        }
+        have = (size_t)(end - p);
+        memmove(buf, p, have);
+        if (have == IP_BLOCK)
+        {
+            free(buf);
+            return -1;
+        }
+    } while (got > 0);
+    batch(ip, k, arg);
+    free(buf);
+    return 0;
+}
+
+void countClasses(const uint32_t *ip, size_t n, void *arg)
+{
+    size_t *count = arg, i;
+    for (i = 0; i < n; i++)
+        count[ipClass(ip[i]) - 'A']++;
+}
+
+int classifyLog(FILE *f)
+{
+    size_t lines, bad, count[5] = {0, 0, 0, 0, 0};
+    double t0 = now(), t;
+    int k;
+    if (scanLog(f, countClasses, count, &lines, &bad) != 0)
+    {
+        printf("Out of memory, or a line longer than %d bytes\n", IP_BLOCK);
+        return 1;
+    }
+    t = now() - t0;
+    for (k = 0; k < 5; k++)
+        printf("Class %c: %zu\n", 'A' + k, count[k]);
+    printf("not an address: %zu\n%zu lines in %.3f s, %.1f M lines/s\n", bad, lines, t, lines / t / 1e6);
+    return 0;
+}
+
+// A longest-prefix-match table, DIR-24-8: tbl24 has an entry for every
+// /24, which is the answer for all 256 addresses in it unless a longer
+// prefix splits it. Then ROUTE_EXTENDED is set and the rest of the entry
+// picks a group of 256 in tbl8, one entry per address. So a lookup is one
+// memory access, or two for the few /24s with a longer prefix inside.
+// Entries are route numbers from 1, 0 for no match.
+//
+// The prefixes go in shortest first, each overwriting its range, so a
+// longer one always wins. tbl24 is 64 MB; it asks for huge pages, where
+// 4 KB pages would make nearly every random lookup a TLB miss too.
+#define ROUTE_EXTENDED 0x80000000u
+#define ROUTE_TBL24 (1u << 24)
+#define ROUTE_HUGE_PAGE (2u << 20)
+
+typedef struct
+{
+    uint32_t ip;
+    int len;
+    uint32_t value; // 1 ..
+} Route;
+
+typedef struct
+{
+    uint32_t *tbl24;
+    uint32_t *tbl8;
+    size_t groups, cap;
+} RouteTable;
+
+// shortest first, and of two equal prefixes the later one in the list
+// goes in last, so it is the one that stays
+int routeByLength(const void *a, const void *b)
+{
+    const Route *x = a, *y = b;
+    return x->len != y->len ? x->len - y->len : (x->value > y->value) - (x->value < y->value);
+}
+
+void routeFree(RouteTable *t)
+{
+    free(t->tbl24);
+    free(t->tbl8);
+    t->tbl24 = t->tbl8 = NULL;
+}
+
+// The table for r[0 .. n), which it sorts; 0, or -1 when out of memory
+// or a prefix is longer than 32 or a value does not fit
+int routeBuild(RouteTable *t, Route *r, size_t n)
+{
+    size_t i;
+    void *p;
+    t->tbl8 = NULL;
+    t->groups = t->cap = 0;
+    if (posix_memalign(&p, ROUTE_HUGE_PAGE, ROUTE_TBL24 * sizeof(uint32_t)) != 0)
+        return -1;
+    t->tbl24 = p;
+#if defined(MADV_HUGEPAGE)
+    madvise(p, ROUTE_TBL24 * sizeof(uint32_t), MADV_HUGEPAGE);
+#endif
+    memset(t->tbl24, 0, ROUTE_TBL24 * sizeof(uint32_t));
+    qsort(r, n, sizeof *r, routeByLength);
+    for (i = 0; i < n; i++)
+    {
+        uint32_t ip = r[i].len == 0 ? 0 : r[i].ip & ~0u << (32 - r[i].len), k, *e;
+        if (r[i].len < 0 || r[i].len > 32 || r[i].value == 0 || r[i].value >= ROUTE_EXTENDED)
+        {
+            routeFree(t);
+            return -1;
+        }
+        if (r[i].len <= 24)
+        {
+            for (k = 0; k < 1u << (24 - r[i].len); k++)
+                t->tbl24[(ip >> 8) + k] = r[i].value;
+            continue;
+        }
+        e = &t->tbl24[ip >> 8];
+        if (!(*e & ROUTE_EXTENDED))
+        {
+            if (t->groups == t->cap)
+            {
+                size_t cap = t->cap == 0 ? 64 : 2 * t->cap;
+                uint32_t *grown = realloc(t->tbl8, cap * 256 * sizeof(uint32_t));
+                if (grown == NULL)
+                {
+                    routeFree(t);
+                    return -1;
+                }
+                t->tbl8 = grown;
+                t->cap = cap;
+            }
+            // the group starts as the /24 it replaces
+            for (k = 0; k < 256; k++)
+                t->tbl8[t->groups * 256 + k] = *e;
+            *e = ROUTE_EXTENDED | (uint32_t)t->groups++;
+        }
+        for (k = 0; k < 1u << (32 - r[i].len); k++)
+            t->tbl8[(*e & ~ROUTE_EXTENDED) * 256 + (ip & 0xff) + k] = r[i].value;
+    }
+    return 0;
+}
+
+static inline uint32_t routeLookup(const RouteTable *t, uint32_t ip)
+{
+    uint32_t e = t->tbl24[ip >> 8];
+    return e & ROUTE_EXTENDED ? t->tbl8[(e & ~ROUTE_EXTENDED) * 256 + (ip & 0xff)] : e;
+}
+
+// out[i] = routeLookup(t, ip[i]). The tbl24 entries of the next block of
+// ROUTE_BATCH addresses are prefetched while this block is looked up, and
+// within a block every tbl24 entry is read before any tbl8 one, so their
+// cache misses overlap instead of coming one after another.
+#define ROUTE_BATCH 32
+
+void routeLookupBatch(const RouteTable *t, const uint32_t *ip, size_t n, uint32_t *out)
+{
+    size_t i, j;
+    for (i = 0; i < n; i += ROUTE_BATCH)
+    {
+        size_t k = n - i < ROUTE_BATCH ? n - i : ROUTE_BATCH;
+        for (j = i + ROUTE_BATCH; j < i + 2 * ROUTE_BATCH && j < n; j++)
+            __builtin_prefetch(&t->tbl24[ip[j] >> 8]);
+        for (j = 0; j < k; j++)
+        {
+            uint32_t e = t->tbl24[ip[i + j] >> 8];
+            if (e & ROUTE_EXTENDED)
+                __builtin_prefetch(&t->tbl8[(e & ~ROUTE_EXTENDED) * 256 + (ip[i + j] & 0xff)]);
+            out[i + j] = e;
+        }
+        for (j = 0; j < k; j++)
+            if (out[i + j] & ROUTE_EXTENDED)
+                out[i + j] = t->tbl8[(out[i + j] & ~ROUTE_EXTENDED) * 256 + (ip[i + j] & 0xff)];
+    }
+}
+
+typedef struct
+{
+    const RouteTable *table;
+    size_t *hits; // by route number, [0] for no match
+} RouteCount;
+
+void countRoutes(const uint32_t *ip, size_t n, void *arg)
+{
+    RouteCount *c = arg;
+    uint32_t out[IP_BATCH];
+    size_t i;
+    routeLookupBatch(c->table, ip, n, out);
+    for (i = 0; i < n; i++)
+        c->hits[out[i]]++;
+}
+
+// Reads "a.b.c.d/len [name]" lines from the file called cidrs, then maps
+// every address from f to the longest prefix it is in and prints the
+// hits of each
+int routeLog(const char *cidrs, FILE *f)
 {
-    unsigned short len=0;
-    unsigned char  oct[4]={0},cnt=0,cnt1=0,i,buf[5];
- 
-    len=strlen(sourceString);
-    for(i=0;i<len;i++)
+    FILE *in = fopen(cidrs, "r");
+    char line[256];
+    Route *r = NULL;
+    char **name = NULL;
+    size_t n = 0, cap = 0, lines, bad, i;
+    RouteTable t;
+    RouteCount c;
+    double t0, t1;
+    int rc = 1;
+    if (in == NULL)
+    {
+        printf("Cannot open %s\n", cidrs);
+        return 1;
+    }
+    while (fgets(line, sizeof line, in) != NULL)
     {
-        if(sourceString[i]!='.'){
-            buf[cnt++] =sourceString[i];
+        char *slash = strchr(line, '/'), *rest;
+        long len;
+        if (slash == NULL)
+            continue;
+        len = strtol(slash + 1, &rest, 10);
+        if (n == cap)
+        {
+            Route *gr = realloc(r, (cap = cap ? 2 * cap : 1024) * sizeof *r);
+            char **gn = realloc(name, cap * sizeof *name);
+            if (gr != NULL)
+                r = gr;
+            if (gn != NULL)
+                name = gn;
+            if (gr == NULL || gn == NULL)
+                goto done;
         }
-        if(sourceString[i]=='.' || i==len-1){
-            buf[cnt]='\0';
-            cnt=0;
-            oct[cnt1++]=atoi(buf);
+        if (parseIpv4(line, (size_t)(slash - line), &r[n].ip) != 0 || rest == slash + 1 || len < 0 || len > 32)
+        {
+            printf("Not a prefix: %s", line);
+            goto done;
         }
+        // the line itself, "a.b.c.d/len name", names the route
+        line[strcspn(line, "\r\n")] = '\0';
+        name[n] = malloc(strlen(line) + 1);
+        if (name[n] == NULL)
+            goto done;
+        strcpy(name[n], line);
+        r[n].len = (int)len;
+        r[n].value = (uint32_t)n + 1;
+        n++;
+    }
+    t0 = now();
+    if (routeBuild(&t, r, n) != 0)
+    {
+        printf("Out of memory\n");
+        goto done;
+    }
+    t1 = now();
+    c.table = &t;
+    c.hits = calloc(n + 1, sizeof(size_t));
+    if (c.hits == NULL || scanLog(f, countRoutes, &c, &lines, &bad) != 0)
+        printf("Out of memory, or a line longer than %d bytes\n", IP_BLOCK);
+    else
+    {
+        double t2 = now();
+        for (i = 0; i < n; i++)
+            if (c.hits[r[i].value] > 0)
+                printf("%s: %zu\n", name[r[i].value - 1], c.hits[r[i].value]);
+        printf("no match: %zu\nnot an address: %zu\n", c.hits[0], bad);
+        printf("%zu prefixes in %.3f s, %zu lines in %.3f s, %.1f M lines/s\n", n, t1 - t0, lines, t2 - t1,
+               lines / (t2 - t1) / 1e6);
+        rc = 0;
+    }
+    free(c.hits);
+    routeFree(&t);
+done:
+    fclose(in);
+    for (i = 0; i < n; i++)
+        free(name[i]);
+    free(name);
+    free(r);
+    return rc;
+}
+
+int bench(size_t n)
+{
+    char *text = malloc(n * 16 + IP_SLACK);
+    size_t *at = malloc((n + 1) * sizeof(size_t)), i, len = 0, mismatch = 0;
+    uint32_t *a = malloc(n * sizeof(uint32_t)), *b = malloc(n * sizeof(uint32_t)), *c = malloc(n * sizeof(uint32_t));
+    unsigned long long x = 88172645463325252ULL;
+    double t0, t1, t2, t3;
+    if (n == 0 || text == NULL || at == NULL || a == NULL || b == NULL || c == NULL)
+    {
+        printf("Cannot make %zu addresses\n", n);
+        return 1;
+    }
+    // one in 16 out of range, and none zero padded, which inet_pton() refuses
+    for (i = 0; i < n; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        at[i] = len;
+        len += (size_t)sprintf(text + len, "%u.%u.%u.%u", (unsigned)(x >> 24 & 0xff), (unsigned)(x >> 16 & 0xff),
+                               (unsigned)(x >> 8 & 0xff) + ((x & 15) == 0 ? 256 : 0), (unsigned)(x & 0xff));
+        text[len++] = '\0';
+    }
+    at[n] = len;
+    t0 = now();
+    for (i = 0; i < n; i++)
+    {
+        struct in_addr addr;
+        a[i] = inet_pton(AF_INET, text + at[i], &addr) == 1 ? ntohl(addr.s_addr) : 0xffffffffu;
     }
-    ipAddress[0]=oct[0];
-    ipAddress[1]=oct[1];
-    ipAddress[2]=oct[2];
-    ipAddress[3]=oct[3];
+    t1 = now();
+    for (i = 0; i < n; i++)
+        if (parseIpv4(text + at[i], at[i + 1] - at[i] - 1, &b[i]) != 0)
+            b[i] = 0xffffffffu;
+    t2 = now();
+    for (i = 0; i < n; i++)
+        if (parseIpv4Simd(text + at[i], at[i + 1] - at[i] - 1, &c[i]) != 0)
+            c[i] = 0xffffffffu;
+    t3 = now();
+    for (i = 0; i < n; i++)
+        mismatch += a[i] != b[i] || a[i] != c[i];
+    printf("%zu addresses, M per second: inet_pton() %.1f, parseIpv4() %.1f, parseIpv4Simd() %.1f%s\n", n,
+           n / (t1 - t0) / 1e6, n / (t2 - t1) / 1e6, n / (t3 - t2) / 1e6, mismatch == 0 ? "" : " (MISMATCH)");
+    free(text);
+    free(at);
+    free(a);
+    free(b);
+    free(c);
+    return mismatch != 0;
 }
 
-int main()
+// The longest of r[0 .. n) that ip is in, the slow way, to check against
+uint32_t routeSlow(const Route *r, size_t n, uint32_t ip)
 {
-    unsigned char ip[20]={0};
-    short ipAddress[4];
-     
+    size_t i;
+    int best = -1;
+    uint32_t value = 0;
+    for (i = 0; i < n; i++)
+        if ((r[i].len > best || (r[i].len == best && r[i].value > value)) &&
+            (r[i].len == 0 || ((ip ^ r[i].ip) >> (32 - r[i].len)) == 0))
+        {
+            best = r[i].len;
+            value = r[i].value;
+        }
+    return value;
+}
+
+int routeBench(size_t p, size_t n)
+{
+    Route *r = malloc((p ? p : 1) * sizeof *r);
+    uint32_t *ip = malloc(n * sizeof *ip), *a = malloc(n * sizeof *a), *b = malloc(n * sizeof *b);
+    unsigned long long x = 88172645463325252ULL;
+    size_t i, mismatch = 0, matched = 0, checks = n < 1000 ? n : 1000;
+    RouteTable t;
+    double t0, t1, t2, t3;
+    if (n == 0 || r == NULL || ip == NULL || a == NULL || b == NULL)
+    {
+        printf("Cannot make %zu prefixes and %zu addresses\n", p, n);
+        return 1;
+    }
+    // about like a routing table: most /24, then /16 to /23, a few /8 to
+    // /15 and a few longer than /24
+    for (i = 0; i < p; i++)
+    {
+        unsigned pick;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        pick = (unsigned)(x >> 56);
+        r[i].len = pick < 150 ? 24 : pick < 230 ? 16 + (int)(pick % 8) : pick < 236 ? 8 + (int)(pick % 8) : 25 + (int)(pick % 8);
+        r[i].ip = (uint32_t)x & ~0u << (32 - r[i].len);
+        r[i].value = (uint32_t)i + 1;
+    }
+    // most addresses inside some prefix, the rest anywhere
+    for (i = 0; i < n; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        ip[i] = (uint32_t)(x >> 32);
+        if (p > 0 && (x & 7) != 0)
+        {
+            const Route *q = &r[(x >> 3) % p];
+            ip[i] = q->ip | (q->len == 32 ? 0 : ip[i] >> q->len);
+        }
+    }
+    t0 = now();
+    if (routeBuild(&t, r, p) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    t1 = now();
+    for (i = 0; i < n; i++)
+        a[i] = routeLookup(&t, ip[i]);
+    t2 = now();
+    routeLookupBatch(&t, ip, n, b);
+    t3 = now();
+    for (i = 0; i < n; i++)
+    {
+        mismatch += a[i] != b[i];
+        matched += a[i] != 0;
+    }
+    for (i = 0; i < checks; i++)
+        mismatch += a[i] != routeSlow(r, p, ip[i]);
+    printf("%zu prefixes (%zu /24 groups split) built in %.3f s; %zu lookups, %.1f%% matched\n", p, t.groups,
+           t1 - t0, n, 100.0 * matched / n);
+    printf("M lookups per second: routeLookup() %.1f, routeLookupBatch() %.1f%s\n", n / (t2 - t1) / 1e6,
+           n / (t3 - t2) / 1e6, mismatch == 0 ? "" : " (MISMATCH)");
+    routeFree(&t);
+    free(r);
+    free(ip);
+    free(a);
+    free(b);
+    return mismatch != 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char ip[20 + IP_SLACK] = {0};
+    uint32_t ipAddress;
+
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+        return bench((size_t)strtod(argv[2], NULL));
+    if (argc > 3 && strcmp(argv[1], "--bench-route") == 0)
+        return routeBench((size_t)strtod(argv[2], NULL), (size_t)strtod(argv[3], NULL));
+    if (argc > 2 && strcmp(argv[1], "--route") == 0)
+    {
+        FILE *f = argc > 3 && strcmp(argv[3], "-") != 0 ? fopen(argv[3], "rb") : stdin;
+        int rc;
+        if (f == NULL)
+        {
+            printf("Cannot open %s\n", argv[3]);
+            return 1;
+        }
+        rc = routeLog(argv[2], f);
+        if (f != stdin)
+            fclose(f);
+        return rc;
+    }
+    if (argc > 2 && strcmp(argv[1], "--log") == 0)
+    {
+        FILE *f = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "rb");
+        int rc;
+        if (f == NULL)
+        {
+            printf("Cannot open %s\n", argv[2]);
+            return 1;
+        }
+        rc = classifyLog(f);
+        if (f != stdin)
+            fclose(f);
+        return rc;
+    }
+
     printf("Enter IP Address (xxx.xxx.xxx.xxx format): ");
-    scanf("%s",ip);
-     
-    extractIpAddress(ip,&ipAddress[0]);
-     
-    printf("\nIp Address: %03d. %03d. %03d. %03d\n",ipAddress[0],ipAddress[1],ipAddress[2],ipAddress[3]);
-    
-    if(ipAddress[0]>=0 && ipAddress[0]<=127)
-        printf("Class A Ip Address.\n");
-    if(ipAddress[0]>127 && ipAddress[0]<191)
-        printf("Class B Ip Address.\n");
-    if(ipAddress[0]>191 && ipAddress[0]<224)
-        printf("Class C Ip Address.\n");
-    if(ipAddress[0]>224 && ipAddress[0]<=239)
-        printf("Class D Ip Address.\n");
-    if(ipAddress[0]>239)
-        printf("Class E Ip Address.\n");
-     
+    if (scanf("%19s", ip) != 1)
+        return 1;
+
+    if (parseIpv4Simd(ip, strlen(ip), &ipAddress) != 0)
+    {
+        printf("\nNot a valid IP Address.\n");
+        return 1;
+    }
+
+    printf("\nIp Address: %03u. %03u. %03u. %03u\n", ipAddress >> 24, ipAddress >> 16 & 0xff, ipAddress >> 8 & 0xff,
+           ipAddress & 0xff);
+    printf("Class %c Ip Address.\n", ipClass(ipAddress));
+
     return 0;
 }
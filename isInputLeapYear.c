@@ -1,10 +1,49 @@
 #include <stdio.h>
-int main()
+#include <stdlib.h>
+#include <string.h>
+#include "Calendar.h"
+#include "OutBuffer.h"
+
+// isInputLeapYear                  asks for a year
+// isInputLeapYear --list FROM TO   the leap years of FROM .. TO, tested a block at a time
+
+#define BLOCK 4096
+
+static int list(int from, int to)
 {
-    int input,i;
+    int32_t year[BLOCK];
+    uint8_t leap[BLOCK];
+    long long count = 0, at;
+    OutBuffer out;
+    int i, k;
+
+    if (outInit(&out, stdout, 0) != 0)
+        return 1;
+    for (at = from; at <= to; at += k) {
+        k = to - at + 1 < BLOCK ? (int)(to - at + 1) : BLOCK;
+        for (i = 0; i < k; i++)
+            year[i] = (int32_t)(at + i);
+        calLeapArray(year, leap, k);
+        for (i = 0; i < k; i++)
+            if (leap[i]) {
+                outInt(&out, year[i]);
+                outChar(&out, '\n');
+                count++;
+            }
+    }
+    outInt(&out, count);
+    outStr(&out, " leap years\n");
+    return outClose(&out) != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int input;
+    if (argc == 4 && strcmp(argv[1], "--list") == 0)
+        return list(atoi(argv[2]), atoi(argv[3]));
     printf("Please input a year and I will tell you if it's a leap year: ");
     scanf("%d",&input);
-    if ((input%4==0 && input%100!=0) || input%400==0) {
+    if (calIsLeap(input)) {
         printf("Your input (%d) IS a leap year.\n\n",input);
     }
     else{
@@ -1,10 +1,18 @@
 #include<stdio.h>
 #include<stdlib.h>
-void merge(int a[],int f,int m,int l)
+#include<string.h>
+//Run with --select to find the kth smallest with introselect instead of
+//sorting: expected O(n), and never worse than O(n) either.
+//Run with --percentiles [P,P,...] to read one array of numbers from
+//stdin until end of input and print those percentiles (default
+//50,90,99), all found by the same partitioning passes.
+//tmp is one scratch buffer as long as a, shared by every merge: the
+//two halves are copied into it instead of into new arrays each call
+void merge(int a[],int f,int m,int l,int tmp[])
 {
     int n1=m+1-f;
     int n2=l-m;
-    int t1[n1],t2[n2];
+    int *t1=tmp+f,*t2=tmp+m+1;
     for (int i = 0; i<n1; i++) 
         t1[i]=a[f+i]; 
     for (int j = 0; j<n2; j++) 
@@ -36,33 +44,243 @@ void merge(int a[],int f,int m,int l)
     }
 }
 
-void sort(int a[],int f,int l)
+void sort(int a[],int f,int l,int tmp[])
 {
     if(f<l)
     {
         int m=(f+l)/2;
-        sort(a,f,m);
-        sort(a,m+1,l);
+        sort(a,f,m,tmp);
+        sort(a,m+1,l,tmp);
         
-        merge(a,f,m,l);
+        if(a[m]>a[m+1])    //halves already in order: nothing to merge
+            merge(a,f,m,l,tmp);
     }
 }
-int main()
+static void swap(int a[],int i,int j)
 {
+    int t=a[i];
+    a[i]=a[j];
+    a[j]=t;
+}
+
+//three-way partition of a[l..u] around the value v: afterwards
+//a[l..lt-1] < v, a[lt..gt] == v and a[gt+1..u] > v
+static void partition3(int a[],int l,int u,int v,int *lt,int *gt)
+{
+    int i=l;
+    *lt=l;
+    *gt=u;
+    while(i<=*gt)
+    {
+        if(a[i]<v)
+            swap(a,(*lt)++,i++);
+        else if(a[i]>v)
+            swap(a,i,(*gt)--);
+        else
+            i++;
+    }
+}
+
+static int median3(int a[],int l,int u)
+{
+    int x=a[l],y=a[l+(u-l)/2],z=a[u];
+    if(x<y)
+        return y<z ? y : (x<z ? z : x);
+    return z<y ? y : (z<x ? z : x);
+}
+
+static void select_many(int a[],int l,int u,const int ks[],int nk,int budget);
+
+//median of the medians of groups of five: a pivot with at least 30% of
+//a[l..u] on either side of it, which keeps selection O(n) on any input
+static int median_of_medians(int a[],int l,int u)
+{
+    int g,i,j,groups=(u-l+1+4)/5,k;
+    for(g=0;g<groups;g++)
+    {
+        int f=l+5*g,e=f+4<u ? f+4 : u;
+        for(i=f+1;i<=e;i++)
+            for(j=i;j>f && a[j-1]>a[j];j--)
+                swap(a,j,j-1);
+        //groups before g are done, so their slots are free for medians
+        swap(a,l+g,(f+e)/2);
+    }
+    k=l+(groups-1)/2;
+    select_many(a,l,l+groups-1,&k,1,0);
+    return a[k];
+}
+
+//Puts the order statistics with the sorted indexes ks[0..nk) in place:
+//afterwards each a[ks[i]] holds what a sorted a would hold there. One
+//partition serves every k in its range; only the sides that still hold
+//a wanted k are partitioned again. Median-of-three pivots are used for
+//budget partitions, median of medians after that (introselect).
+static void select_many(int a[],int l,int u,const int ks[],int nk,int budget)
+{
+    while(nk>0 && l<u)
+    {
+        int v,lt,gt,left=0,right;
+        if(budget>0)
+        {
+            budget--;
+            v=median3(a,l,u);
+        }
+        else
+            v=median_of_medians(a,l,u);
+        partition3(a,l,u,v,&lt,&gt);
+
+        while(left<nk && ks[left]<lt)
+            left++;
+        right=left;
+        while(right<nk && ks[right]<=gt)
+            right++;
+        //ks[0..left) lie left of the pivots, ks[right..nk) right of them
+        select_many(a,l,lt-1,ks,left,budget);
+        l=gt+1;
+        ks+=right;
+        nk-=right;
+    }
+}
+
+static int select_budget(int n)
+{
+    int depth=0;
+    while(n>1)
+    {
+        n/=2;
+        depth+=2;
+    }
+    return depth;
+}
+
+//kth smallest of a[0..n), k counted from 0; reorders a
+int select_kth(int a[],int n,int k)
+{
+    select_many(a,0,n-1,&k,1,select_budget(n));
+    return a[k];
+}
+
+//Reads numbers until end of input and prints the percentiles in list
+//(nearest rank: the smallest value with at least p% of the data at or
+//below it)
+static int percentiles(const char *list)
+{
+    int *a=NULL,*ks,n=0,cap=0,v,nk=0,i,j;
+    double p[64];
+    const char *s=list;
+    char *end;
+
+    while(nk<64)
+    {
+        p[nk]=strtod(s,&end);
+        if(end==s)
+            break;
+        if(p[nk]>=0 && p[nk]<=100)
+            nk++;
+        s=*end==',' ? end+1 : end;
+    }
+    while(scanf("%d",&v)==1)
+    {
+        if(n==cap)
+        {
+            int *bigger;
+            cap=cap ? 2*cap : 1024;
+            bigger=realloc(a,cap*sizeof(int));
+            if(bigger==NULL)
+            {
+                free(a);
+                printf("Out of memory\n");
+                return 1;
+            }
+            a=bigger;
+        }
+        a[n++]=v;
+    }
+    if(n==0 || nk==0)
+    {
+        free(a);
+        return 0;
+    }
+
+    ks=malloc(nk*sizeof(int));
+    if(ks==NULL)
+    {
+        free(a);
+        printf("Out of memory\n");
+        return 1;
+    }
+    for(i=0;i<nk;i++)
+    {
+        double rank=p[i]/100*n;
+        ks[i]=(int)rank;
+        if(ks[i]==rank && ks[i]>0)
+            ks[i]--; //rank is a whole number: that item itself
+        if(ks[i]>=n)
+            ks[i]=n-1;
+    }
+    //select_many wants the indexes in order
+    int *sorted=malloc(nk*sizeof(int));
+    if(sorted==NULL)
+    {
+        free(a);
+        free(ks);
+        printf("Out of memory\n");
+        return 1;
+    }
+    memcpy(sorted,ks,nk*sizeof(int));
+    for(i=1;i<nk;i++)
+        for(j=i;j>0 && sorted[j-1]>sorted[j];j--)
+        {
+            int t=sorted[j];
+            sorted[j]=sorted[j-1];
+            sorted[j-1]=t;
+        }
+    select_many(a,0,n-1,sorted,nk,select_budget(n));
+    for(i=0;i<nk;i++)
+        printf("p%g %d\n",p[i],a[ks[i]]);
+    free(a);
+    free(ks);
+    free(sorted);
+    return 0;
+}
+int main(int argc,char *argv[])
+{
+	int use_select=argc>1 && strcmp(argv[1],"--select")==0;
+	if(argc>1 && strcmp(argv[1],"--percentiles")==0)
+	    return percentiles(argc>2 ? argv[2] : "50,90,99");
 	int n;scanf("%d",&n);
 	while(n--)
 	{
 	    int num;scanf("%d",&num);
-	    /*int *a;
-	    a=(int *)malloc(num*sizeof(int));*/
-	    int a[num];
+	    int *a,*tmp;
+	    a=(int *)malloc(num*sizeof(int));
+	    tmp=(int *)malloc(num*sizeof(int));
+	    if(a==NULL || tmp==NULL)
+	    {
+	        printf("Out of memory\n");
+	        return 1;
+	    }
 	    for(int i=0;i<num;i++)
 	    {
 	        scanf("%d",&a[i]);
 	    }
 	    int r;scanf("%d",&r);
-	    sort(a,0,num-1);
-	    printf("%d\n",a[r-1]);
+	    if(r<1 || r>num)
+	    {
+	        printf("k must be between 1 and %d\n",num);
+	    }
+	    else if(use_select)
+	    {
+	        printf("%d\n",select_kth(a,num,r-1));
+	    }
+	    else
+	    {
+	        sort(a,0,num-1,tmp);
+	        printf("%d\n",a[r-1]);
+	    }
+	    free(a);
+	    free(tmp);
 	    
 	}
-}
+	return 0;
+}
\ No newline at end of file
@@ -1,40 +1,181 @@
-//c program to find factorial upto input of 5000
+//c program to find the factorial of any n, as far as memory goes
 
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "BigNum.h"
 
-int main(){
-	int ans[16500];
+//The product is a BigNum (BigNum.h): limbs of 9 decimal digits, of which
+//only the live ones are multiplied, where one digit per int over a fixed
+//16500 slots went through all of them for every factor. Consecutive
+//factors are multiplied together in 64 bits first, as long as they stay
+//below BIG_SMALL_MAX.
+//
+//Multiplying those into the product one after another is still quadratic,
+//since every step goes over the whole product. Two ways around it:
+//  - factorialTree(): a product tree (bigProduct()), so the big
+//    multiplies are between halves of the same size, where bigMul() is
+//    Karatsuba or a number-theoretic transform.
+//  - factorialPrimes(), the default: n! is the product of p^e over the
+//    primes p <= n, with e = n/p + n/p^2 + ... (Legendre). Writing every
+//    e in binary, n! = P_0 * P_1^2 * P_2^4 * ..., where P_i is the product
+//    of the primes whose e has bit i set, so from the top bit down it is
+//    a squaring and a product tree of primes per bit. There are only
+//    about n / ln n primes, and a squaring needs one transform less than
+//    a multiply.
+//
+//Run with --bench N to time N! both ways (and one factor at a time too
+//for N up to 100000) and print its number of digits instead.
+
+//ans = num!, one multiplier at a time; returns 0, or -1 when out of memory
+int factorialSimple(unsigned long num, BigNum *ans){
+	uint64_t acc=1;
+	if(bigSetU64(ans, 1)!=0)
+		return -1;
+	for(unsigned long i=2; i<=num; i++){
+		if(acc > (BIG_SMALL_MAX-1)/i){
+			if(bigMulSmall(ans, acc)!=0)
+				return -1;
+			acc=1;
+		}
+		acc*=i;
+	}
+	return bigMulSmall(ans, acc);
+}
+
+//Appends x to the list of multipliers, into the last one while the product
+//stays below BIG_SMALL_MAX
+void pack(uint64_t *w, size_t *n, uint64_t x){
+	if(*n>0 && w[*n-1] <= (BIG_SMALL_MAX-1)/x)
+		w[*n-1]*=x;
+	else
+		w[(*n)++]=x;
+}
+
+//ans = num! by a product tree over 2 .. num
+int factorialTree(unsigned long num, BigNum *ans){
+	uint64_t *w=malloc((num+1)*sizeof(uint64_t));
+	size_t n=0;
+	int rc;
+	if(w==NULL)
+		return -1;
+	for(unsigned long i=2; i<=num; i++)
+		pack(w, &n, i);
+	rc=bigProduct(w, n, ans);
+	free(w);
+	return rc;
+}
+
+//ans = num! from the primes up to num and their exponents
+int factorialPrimes(unsigned long num, BigNum *ans){
+	//composite[i] for the odd number 2i + 1
+	unsigned char *composite=calloc(num/2+1, 1);
+	uint64_t *prime=malloc((num/2+2)*sizeof(uint64_t)), *w=malloc((num/2+2)*sizeof(uint64_t));
+	int *exponent=malloc((num/2+2)*sizeof(int));
+	size_t primes=0, n, k;
+	int bit, top=0, rc=-1;
+	BigNum part;
+	bigInit(&part);
+	if(composite==NULL || prime==NULL || w==NULL || exponent==NULL)
+		goto done;
+	if(num>=2)
+		prime[primes++]=2;
+	for(uint64_t i=3; i<=num; i+=2){
+		if(composite[i/2])
+			continue;
+		prime[primes++]=i;
+		for(uint64_t j=i*i; j<=num; j+=2*i)
+			composite[j/2]=1;
+	}
+	for(k=0; k<primes; k++){
+		uint64_t q=num;
+		exponent[k]=0;
+		while((q/=prime[k])>0)
+			exponent[k]+=(int)q;
+		while(exponent[k]>>top > 1)
+			top++;
+	}
+	if(bigSetU64(ans, 1)!=0)
+		goto done;
+	for(bit=top; bit>=0; bit--){
+		//the primes are in order and exponents only go down, so the ones
+		//with any bit at or above this one are a prefix
+		for(k=0, n=0; k<primes && exponent[k]>>bit != 0; k++)
+			if(exponent[k]>>bit & 1)
+				pack(w, &n, prime[k]);
+		if(bigMul(ans, ans, ans)!=0 || bigProduct(w, n, &part)!=0 || bigMul(ans, ans, &part)!=0)
+			goto done;
+	}
+	rc=0;
+done:
+	free(composite);
+	free(prime);
+	free(w);
+	free(exponent);
+	bigFree(&part);
+	return rc;
+}
+
+double seconds(struct timespec *t0){
+	struct timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return t1.tv_sec-t0->tv_sec+(t1.tv_nsec-t0->tv_nsec)/1e9;
+}
+
+int bench(unsigned long num){
+	BigNum ans, other;
+	struct timespec t0;
+	int rc=1;
+	bigInit(&ans);
+	bigInit(&other);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if(factorialPrimes(num, &ans)!=0)
+		goto done;
+	printf("%lu! has %zu digits\n", num, bigDigits(&ans));
+	printf("primes        %.6f s\n", seconds(&t0));
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if(factorialTree(num, &other)!=0)
+		goto done;
+	printf("product tree  %.6f s%s\n", seconds(&t0), bigCompare(&ans, &other)==0 ? "" : " MISMATCH");
+	if(num<=100000){
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if(factorialSimple(num, &other)!=0)
+			goto done;
+		printf("one by one    %.6f s%s\n", seconds(&t0), bigCompare(&ans, &other)==0 ? "" : " MISMATCH");
+	}
+	rc=0;
+done:
+	if(rc!=0)
+		printf("Out of memory\n");
+	bigFree(&ans);
+	bigFree(&other);
+	return rc;
+}
+
+int main(int argc, char *argv[]){
+	BigNum ans;
 	int testcases;
+	if(argc>2 && strcmp(argv[1], "--bench")==0)
+		return bench(strtoul(argv[2], NULL, 10));
+	bigInit(&ans);
 	printf("Enter no of test cases: ");
-	scanf("%d", &testcases);
+	if(scanf("%d", &testcases)!=1)
+		return 1;
 	while(testcases--){
-		int num;
+		unsigned long num;
 		printf("Enter number:");
-		scanf("%d", &num);
-		for(int i=0; i<16500; i++)
-			ans[i]=0;
-		ans[0]=1;
-		int m, carry;
-		for(int i=2; i<=num; i++){
-			carry=0;
-			for(int j=0; j<16500; j++){
-				 m= i*ans[j];
-				 m+= carry;
-				 ans[j]=m%10;
-				 carry=m/10;
-			}
-		}
-		int i=16500-1;
-		while(ans[i]==0 && i>=0){
-			i--;
-		}
-		printf("\t%d! =", num);
-		while(i>=0){
-			printf("%d", ans[i]);
-			i--;
+		if(scanf("%lu", &num)!=1)
+			break;
+		if(factorialPrimes(num, &ans)!=0){
+			printf("Out of memory\n");
+			break;
 		}
+		printf("\t%lu! =", num);
+		bigPrint(stdout, &ans);
 		printf("\n");
 	}
+	bigFree(&ans);
+	return 0;
 }
-
@@ -1,26 +1,32 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include "Fibonacci.h"
 
-int last_digit_fib_optimized(const int index)
-{
-	int first = 0; 
-	int second = 1;
-	int current = 0;
-
-	for (int i = 2; i <= index; ++i) {
-		current = (first + second) % 10;
-		first = second;
-		second = current;
-	}
+/* The last digits of F(n) repeat every 60 terms (the Pisano period of
+   10), so one look-up in a table of those 60 answers any index. For any
+   other modulus, run with --mod M N: N is first reduced mod the period
+   of M (pisanoPeriod() in Fibonacci.h), then F(N) mod M comes from fast
+   doubling, O(log N) in all. */
+
+static const unsigned char lastDigit[60] = {
+	0, 1, 1, 2, 3, 5, 8, 3, 1, 4, 5, 9, 4, 3, 7, 0, 7, 7, 4, 1,
+	5, 6, 1, 7, 8, 5, 3, 8, 1, 9, 0, 9, 9, 8, 7, 5, 2, 7, 9, 6,
+	5, 1, 6, 7, 3, 0, 3, 3, 6, 9, 5, 4, 9, 3, 2, 5, 7, 2, 9, 1
+};
 
-	return (current);
+int last_digit_fib_optimized(unsigned long long index)
+{
+	return lastDigit[index % 60];
 }
 
 /* This is the direct solution for reference */
 int last_digit_fib_naive(const int index)
 {
 	int *arr;
-	arr = (int *)malloc((index+1) * sizeof(int));
+	arr = (int *)malloc((index + 2) * sizeof(int));
+	if (arr == NULL)
+		return -1;
 	arr[0] = 0;
 	arr[1] = 1;
 
@@ -29,15 +35,30 @@ int last_digit_fib_naive(const int index)
 	}
 
 	int res = arr[index];
+	free(arr);
 	return (res);
 }
 
 int main(int argc, char **argv)
 {
-	int index = 0;
-	scanf("%d", &index);
+	unsigned long long index = 0;
+	if (argc > 3 && strcmp(argv[1], "--mod") == 0) {
+		uint64_t m = strtoull(argv[2], NULL, 10), period;
+		if (m == 0 || m >= 1ULL << 63) {
+			printf("The modulus must be between 1 and 2^63 - 1\n");
+			return 1;
+		}
+		period = pisanoPeriod(m);
+		index = strtoull(argv[3], NULL, 10);
+		// a period past 2^64 is past any index too
+		printf("%llu (period %llu)\n", (unsigned long long)fibMod(period == 0 ? index : index % period, m),
+		       (unsigned long long)period);
+		return 0;
+	}
+	if (scanf("%llu", &index) != 1)
+		return 1;
 
 	printf("%d\n", last_digit_fib_optimized(index));
 	
 	return 0;
-}
\ No newline at end of file
+}
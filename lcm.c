@@ -1,42 +1,49 @@
 #include <stdio.h>
 #include <stdlib.h>
-
+#include <limits.h>
+#include <stdint.h>
+#include "Gcd.h"
+
+/*
+ * The gcd is gcd64() from Gcd.h, a binary gcd on the absolute values;
+ * the lcm divides by it before multiplying, and reports an lcm too big
+ * for a long instead of printing a wrapped-around product.
+ */
 long get_gcd_euclidian(long d1, long d2)
 {
-	/* swap the numbers if d2 is greater than d1 */
-	if (d2 > d1) {
-		d1 = d1 - d2;
-		d2 = d1 + d2;
-		d1 = d2 - d1;
-	}
-
-	if (d2 == 0) {
-		return d1;
-	}
-	
-	long rem = d1 % d2;
+	uint64_t a = d1 < 0 ? 0 - (uint64_t)d1 : (uint64_t)d1;
+	uint64_t b = d2 < 0 ? 0 - (uint64_t)d2 : (uint64_t)d2;
 
-	return get_gcd_euclidian(d2, rem);
+	return (long)gcd64(a, b);
 }
 
-long get_lcm_euclidian(long val1, long val2)
+/* returns 0 and the lcm in *lcm, or -1 when it does not fit in a long */
+int get_lcm_euclidian(long val1, long val2, long *lcm)
 {
-	if (val1 == 0 || val2 == 0) {
-		return 0;
-	}
-
-	long prod = (long) (val1*val2);
-	long gcd = get_gcd_euclidian(val1, val2);
+	uint64_t a = val1 < 0 ? 0 - (uint64_t)val1 : (uint64_t)val1;
+	uint64_t b = val2 < 0 ? 0 - (uint64_t)val2 : (uint64_t)val2;
+	uint64_t l;
 
-	return (prod/gcd);
+	if (lcm64(a, b, &l) != 0 || l > (uint64_t)LONG_MAX) {
+		return -1;
+	}
+	*lcm = (long)l;
+	return 0;
 }
 
 int main(int argc, char **argv)
 {
 	long ip1 = 0;
 	long ip2 = 0;
-	scanf("%ld %ld", &ip1, &ip2);
-	printf("%ld", get_lcm_euclidian(ip1, ip2));
+	long lcm;
+	if (scanf("%ld %ld", &ip1, &ip2) != 2) {
+		return 1;
+	}
+	if (get_lcm_euclidian(ip1, ip2, &lcm) != 0) {
+		printf("overflow");
+		return 1;
+	}
+	printf("%ld", lcm);
 
 	return 0;
-}
\ No newline at end of file
+}
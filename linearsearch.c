@@ -1,28 +1,180 @@
+//Linear search. The scan is simdFind() from SimdSearch.h, which compares
+//16 elements a step.
+//Run with --bench to compare scalar and SIMD linear search and binary
+//search on short sorted arrays, which is where SIMD_SEARCH_LINEAR comes from.
+//It then looks for keys that are mostly not there in longer arrays, with
+//and without a Bloom filter of the array (BloomFilter.h) in front of the
+//scan: a key the filter rules out costs one cache line, not n elements.
 #include<stdio.h>
-int main()
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include "SimdSearch.h"
+#include "BloomFilter.h"
+
+int bench();
+
+int main(int argc,char *argv[])
 {
   int n=0;
-  int i,a[];
-  int x,c=0;
+  int i,*a;
+  int x;
+  size_t at;
+  if(argc>1 && strcmp(argv[1],"--bench")==0)
+    return bench();
   printf("ENTER SIZE OF ARRAY AND ARRAY ELEMENTS\n");
-  scanf("%d",&n);
+  if(scanf("%d",&n)!=1 || n<0 || (a=malloc((n ? n : 1)*sizeof(int)))==NULL)
+  {
+    printf("INVALID SIZE\n");
+    return 1;
+  }
   for(i=0;i<n;i++)
   {
     scanf("%d",&a[i]);
   }
   printf("ENTER ELEMENT TO SEARCH\n");
   scanf("%d",&x);
-  for(i=0;i<n;i++)
+  at=simdFind(a,n,x);
+  if(at<(size_t)n)
+  {
+    printf("FOUND AT INDEX %d",(int)at);
+  }
+  else
   {
+    printf("ELEMENT NOT FOUND");
+  }
+  free(a);
+  return 1;
+}
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+size_t scalar_find(const int *a,size_t n,int x)
+{
+  size_t i;
+  for(i=0;i<n;i++)
     if(a[i]==x)
+      return i;
+  return n;
+}
+
+size_t binary_lower_bound(const int *a,size_t n,int x)
+{
+  size_t lo=0,hi=n;
+  while(lo<hi)
+  {
+    size_t mid=lo+(hi-lo)/2;
+    if(a[mid]<x)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  return lo;
+}
+
+//simdFind() behind the filter of a
+size_t bloom_find(const BloomFilter *bf,const int *a,size_t n,int x)
+{
+  return bloomMayContainInt(bf,x) ? simdFind(a,n,x) : n;
+}
+
+//keys of which 1 in 100 is in an unsorted array of n; ns per search
+int bench_absent()
+{
+  int sizes[]={64,1024,16384,262144};
+  int s,i,k;
+  unsigned seed=7;
+  printf("\n%8s %10s %10s %10s\n","n","simdFind","bloom","maybe");
+  for(s=0;s<(int)(sizeof sizes/sizeof sizes[0]);s++)
+  {
+    int n=sizes[s],keys=(int)((1<<26)/n);
+    int *a=malloc(n*sizeof(int)),*q=malloc(keys*sizeof(int));
+    size_t *at=malloc(keys*sizeof(size_t)),sum[2]={0,0},maybe;
+    double t[2];
+    BloomFilter bf;
+    if(a==NULL || q==NULL || at==NULL || bloomInit(&bf,n,BLOOM_BITS_PER_KEY)!=0)
+    {
+      printf("OUT OF MEMORY\n");
+      return 1;
+    }
+    for(i=0;i<n;i++)
+    {
+      seed=seed*1103515245+12345;
+      a[i]=2*(int)(seed>>4); //even
+    }
+    for(i=0;i<keys;i++)
+    {
+      seed=seed*1103515245+12345;
+      q[i]=(seed>>8)%100==0 ? a[(seed>>12)%n] : 2*(int)(seed>>4)+1;
+    }
+    bloomAddInts(&bf,a,n);
+    maybe=bloomMayContainInts(&bf,q,keys,at);
+    for(k=0;k<2;k++)
     {
-      printf("FOUND AT INDEX %d",i);
-      break;
+      t[k]=now();
+      for(i=0;i<keys;i++)
+        sum[k]+=k==0 ? simdFind(a,n,q[i]) : bloom_find(&bf,a,n,q[i]);
+      t[k]=(now()-t[k])/keys*1e9;
+    }
+    printf("%8d %10.2f %10.2f %9.2f%%\n",n,t[0],t[1],100.0*maybe/keys);
+    bloomFree(&bf);
+    free(a);
+    free(q);
+    free(at);
+    if(sum[0]!=sum[1])
+    {
+      printf("THE SEARCHES DISAGREE\n");
+      return 1;
     }
   }
-    if(c==0)
+  return 0;
+}
+
+//many small sorted arrays (each in cache), random keys that are in them;
+//ns per search for every way of searching
+int bench()
+{
+  enum { KEYS=1<<20, ROUNDS=8 };
+  static int keys[KEYS];
+  int sizes[]={4,8,16,32,64,128,256,1024};
+  int s,k,i,r,a[1024];
+  volatile size_t sink=0;
+  unsigned seed=1;
+  printf("%6s %10s %10s %10s %10s %10s\n","n","scalar","simdFind","binary","simdLower","hybrid");
+  for(s=0;s<(int)(sizeof sizes/sizeof sizes[0]);s++)
+  {
+    int n=sizes[s];
+    double t[5];
+    for(i=0;i<n;i++)
+      a[i]=3*i;
+    for(i=0;i<KEYS;i++)
     {
-      printf("ELEMENT NOT FOUND");
+      seed=seed*1103515245+12345;
+      keys[i]=3*(int)((seed>>8)%n);
     }
-  return 1;
+    for(k=0;k<5;k++)
+    {
+      size_t sum=0;
+      t[k]=now();
+      for(r=0;r<ROUNDS;r++)
+        for(i=0;i<KEYS;i++)
+          sum+=k==0 ? scalar_find(a,n,keys[i]) : k==1 ? simdFind(a,n,keys[i])
+              : k==2 ? binary_lower_bound(a,n,keys[i]) : k==3 ? simdLowerBound(a,n,keys[i])
+              : searchSorted(a,n,keys[i]);
+      t[k]=(now()-t[k])/((double)ROUNDS*KEYS)*1e9;
+      if(k>0 && sum!=sink)
+      {
+        printf("THE SEARCHES DISAGREE\n");
+        return 1;
+      }
+      sink=sum;
+    }
+    printf("%6d %10.2f %10.2f %10.2f %10.2f %10.2f\n",n,t[0],t[1],t[2],t[3],t[4]);
+  }
+  return bench_absent();
 }
@@ -1,76 +1,353 @@
 #include <iostream>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <time.h>
 
-/* The program demonstrates a basic linked list implemented using classes */
+#include "NodePool.h"
+
+/* The program demonstrates a basic linked list implemented using classes.
+
+   LinkedList<T, Allocator> owns its nodes: emplace_back() builds the value
+   in place inside a new node, with no copy, and the destructor destroys and
+   frees them all. A list can be moved, which hands the nodes over, but not
+   copied. Nodes come from the Allocator, std::allocator by default, or
+   PoolAllocator, which cuts them out of a NodePool (NodePool.h) so that a
+   list of n nodes calls malloc n / NODE_POOL_CHUNK times instead of n:
+
+       NodePool pool = NODE_POOL_INITIALIZER(LinkedList<T, PoolAllocator<T> >::nodeSize);
+       LinkedList<T, PoolAllocator<T> > list(PoolAllocator<T>(&pool));
+       ...
+       nodePoolRelease(&pool); // after the list is gone
+
+       linkedlist              the example list
+       linkedlist --bench N    N string records: copied in or built in place,
+                               nodes from new or from the pool */
 
 using namespace std;
 
-class Node
+// Allocates single nodes from a NodePool, and anything else, such as a
+// node larger than the pool's, with operator new
+template <class T>
+class PoolAllocator
 {
 public:
-        int data;
-        Node *next = NULL;
+        typedef T value_type;
+
+        NodePool *pool;
+
+        explicit PoolAllocator(NodePool *p) : pool(p) {}
+        template <class U>
+        PoolAllocator(const PoolAllocator<U> &other) : pool(other.pool) {}
+
+        T *allocate(size_t n)
+        {
+                if (!fits(n))
+                        return static_cast<T *>(::operator new(n * sizeof(T)));
+                void *p = nodePoolAlloc(pool);
+                if (p == NULL)
+                        throw bad_alloc();
+                return static_cast<T *>(p);
+        }
+
+        void deallocate(T *p, size_t n)
+        {
+                if (fits(n))
+                        nodePoolFree(pool, p);
+                else
+                        ::operator delete(p);
+        }
+
+private:
+        bool fits(size_t n) const
+        {
+                return n == 1 && sizeof(T) <= pool->nodeSize && alignof(T) <= NODE_POOL_ALIGN;
+        }
 };
 
+template <class T, class U>
+bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool == b.pool; }
+template <class T, class U>
+bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool != b.pool; }
+
+template <class T, class Allocator = allocator<T> >
 class LinkedList
 {
-public:
+        struct Node
+        {
+                Node *next;
+                T data;
+
+                template <class... Args>
+                explicit Node(Args &&... args) : next(NULL), data(std::forward<Args>(args)...) {}
+        };
+
+        typedef typename allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+        typedef allocator_traits<NodeAllocator> NodeTraits;
+
+        NodeAllocator alloc;
         Node *head = NULL;
         Node *tail = NULL;
-};
+        size_t count = 0;
 
-void addNode(LinkedList* list, Node* node)
-{
-        if(list->head == NULL && list->tail == NULL) { // For the first node only
-                list->tail = node;
-                list->head = node;
+public:
+        // what a NodePool for this list's nodes is made with
+        static constexpr size_t nodeSize = sizeof(Node);
+
+        template <bool Const>
+        class Iterator
+        {
+                friend class LinkedList;
+                Node *node;
+                explicit Iterator(Node *n) : node(n) {}
+
+        public:
+                typedef forward_iterator_tag iterator_category;
+                typedef T value_type;
+                typedef ptrdiff_t difference_type;
+                typedef typename conditional<Const, const T *, T *>::type pointer;
+                typedef typename conditional<Const, const T &, T &>::type reference;
+
+                Iterator() : node(NULL) {}
+                operator Iterator<true>() const { return Iterator<true>(node); }
+
+                reference operator*() const { return node->data; }
+                pointer operator->() const { return &node->data; }
+                Iterator &operator++()
+                {
+                        node = node->next;
+                        return *this;
+                }
+                Iterator operator++(int)
+                {
+                        Iterator before = *this;
+                        node = node->next;
+                        return before;
+                }
+                bool operator==(const Iterator &other) const { return node == other.node; }
+                bool operator!=(const Iterator &other) const { return node != other.node; }
+        };
+
+        typedef Iterator<false> iterator;
+        typedef Iterator<true> const_iterator;
+
+        explicit LinkedList(const Allocator &a = Allocator()) : alloc(a) {}
+
+        LinkedList(const LinkedList &) = delete;
+        LinkedList &operator=(const LinkedList &) = delete;
+
+        // the nodes move over with the allocator they came from
+        LinkedList(LinkedList &&other) noexcept
+                : alloc(std::move(other.alloc)), head(other.head), tail(other.tail), count(other.count)
+        {
+                other.head = other.tail = NULL;
+                other.count = 0;
+        }
+
+        LinkedList &operator=(LinkedList &&other) noexcept
+        {
+                if (this != &other) {
+                        clear();
+                        alloc = std::move(other.alloc);
+                        head = other.head;
+                        tail = other.tail;
+                        count = other.count;
+                        other.head = other.tail = NULL;
+                        other.count = 0;
+                }
+                return *this;
+        }
+
+        ~LinkedList() { clear(); }
+
+        // Builds a T from args at the end of the list
+        template <class... Args>
+        T &emplace_back(Args &&... args)
+        {
+                Node *node = NodeTraits::allocate(alloc, 1);
+                try {
+                        NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+                }
+                catch (...) {
+                        NodeTraits::deallocate(alloc, node, 1);
+                        throw;
+                }
+                if (head == NULL) // For the first node only
+                        head = node;
+                else
+                        tail->next = node;
+                tail = node;
+                count++;
+                return node->data;
+        }
+
+        void push_back(const T &value) { emplace_back(value); }
+        void push_back(T &&value) { emplace_back(std::move(value)); }
+
+        void clear()
+        {
+                Node *ptr = head;
+
+                while (ptr != NULL) {
+                        Node *next = ptr->next;
+                        NODE_PREFETCH(next);
+                        NodeTraits::destroy(alloc, ptr);
+                        NodeTraits::deallocate(alloc, ptr, 1);
+                        ptr = next;
+                }
+                head = tail = NULL;
+                count = 0;
         }
-        else {
-                list->tail->next = node;
-                list->tail = node;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        iterator begin() { return iterator(head); }
+        iterator end() { return iterator(NULL); }
+        const_iterator begin() const { return const_iterator(head); }
+        const_iterator end() const { return const_iterator(NULL); }
+
+        // The first element equal to value, or end()
+        template <class U>
+        const_iterator find(const U &value) const
+        {
+                Node *ptr = head;
+
+                while (ptr != NULL && !(ptr->data == value))
+                        ptr = ptr->next;
+                return const_iterator(ptr);
         }
+
+        template <class U>
+        bool contains(const U &value) const { return find(value) != end(); }
+};
+
+template <class List>
+void display(const List &list)
+{
+        for (const auto &value : list) // Loop to traverse the list
+                cout << value << "  ";
 }
 
-void display(LinkedList* list)
+template <class List, class U>
+void search(const List &list, const U &value)
 {
-        Node *ptr = list->head;
+        if (list.contains(value))
+                cout << "Value exists in the list" << endl;
+        else
+                cout << "Value does not exist in the list" << endl;
+}
 
-        while (ptr != NULL) { // Loop to traverse the list
-                cout << ptr->data << "  ";
-                ptr = ptr->next;
-        }
+static double now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec * 1e-9;
 }
 
-void search(LinkedList* list, int value)
+// A payload that owns memory: too long for the small-string buffer
+struct Record
 {
-        Node *ptr = list->head;
+        string name;
+        long id;
 
-        while(ptr != NULL) {
-                if(value == ptr->data) {
-                        cout << "Value exists in the list" << endl;
-                        break;
+        Record(const char *n, long i) : name(n), id(i) {}
+};
+
+// Builds a list of n records and deletes it, best of 3, ns a node; how is
+// 0 for copied in, 1 for built in place
+template <class List>
+static double buildRecords(size_t n, int how, List (*make)(NodePool *), NodePool *pool, long *check)
+{
+        double best = 1e30;
+        char name[48];
+
+        for (int rep = 0; rep < 3; rep++) {
+                double t = now();
+                {
+                        List list = make(pool);
+                        for (size_t i = 0; i < n; i++) {
+                                snprintf(name, sizeof name, "customer-record-%020zu", i);
+                                if (how == 0) {
+                                        Record record(name, (long)i);
+                                        list.push_back(record);
+                                }
+                                else
+                                        list.emplace_back(name, (long)i);
+                        }
+                        *check = 0;
+                        for (const Record &r : list)
+                                *check += r.id + (long)r.name.size();
                 }
-                ptr = ptr->next;
+                t = now() - t;
+                if (t < best)
+                        best = t;
+                if (pool != NULL)
+                        nodePoolRelease(pool);
         }
-        if(ptr == NULL)
-                cout << "Value does not exist in the list" << endl;
+        return best / n * 1e9;
 }
 
-int main()
+typedef LinkedList<Record> HeapList;
+typedef LinkedList<Record, PoolAllocator<Record> > PoolList;
+
+static HeapList makeHeap(NodePool *) { return HeapList(); }
+static PoolList makePool(NodePool *pool) { return PoolList(PoolAllocator<Record>(pool)); }
+
+static int bench(size_t n)
 {
-        LinkedList example_list;
+        NodePool pool = NODE_POOL_INITIALIZER(PoolList::nodeSize);
+        long c1, c2, c3, c4;
 
-        int arr[] = {5, 8, -2, 66, 78, 21, 90, 0, 2};
+        if (n == 0) {
+                cout << "Need N > 0" << endl;
+                return 1;
+        }
+        double copyNew = buildRecords(n, 0, makeHeap, NULL, &c1);
+        double placeNew = buildRecords(n, 1, makeHeap, NULL, &c2);
+        double copyPool = buildRecords(n, 0, makePool, &pool, &c3);
+        double placePool = buildRecords(n, 1, makePool, &pool, &c4);
 
-        for(int i = 0; i < 9; i++) {
-                Node *temp_node = new Node();
-                temp_node->data = arr[i];
-                addNode(&example_list, temp_node);
+        cout << n << " records, build and delete, best of 3, ns a node" << endl;
+        cout << "  copied in, new       " << copyNew << endl;
+        cout << "  in place, new        " << placeNew << endl;
+        cout << "  copied in, pool      " << copyPool << endl;
+        cout << "  in place, pool       " << placePool << endl;
+        if (c1 != c2 || c1 != c3 || c1 != c4) {
+                cout << "The lists differ" << endl;
+                return 1;
         }
+        return 0;
+}
 
-        search(&example_list, 78);
-        search(&example_list, 9);
+int main(int argc, char *argv[])
+{
+        if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+                return bench(strtoul(argv[2], NULL, 10));
+
+        typedef LinkedList<int, PoolAllocator<int> > IntList;
+        NodePool pool = NODE_POOL_INITIALIZER(IntList::nodeSize); // the nodes are built in here
+
+        {
+                IntList example_list{PoolAllocator<int>(&pool)};
+
+                int arr[] = {5, 8, -2, 66, 78, 21, 90, 0, 2};
+
+                for(int i = 0; i < 9; i++)
+                        example_list.emplace_back(arr[i]);
 
-        display(&example_list);
-        
+                search(example_list, 78);
+                search(example_list, 9);
+
+                display(example_list);
+        }
+
+        nodePoolRelease(&pool); // the list has given its nodes back already
         return 0;
-}
\ No newline at end of file
+}
@@ -1,52 +1,209 @@
 #include <stdio.h>
+// before m is defined: the headers use m as a name
+#include "Binomial.h"
 #define m 1000000007
-#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// nCr mod m = n! * (1/r!) * (1/(n-r)!) mod m, and with tables of n! and of
+// 1/n! that is two multiplies per query. The inverse factorials need only
+// one power: 1/top! = (top!)^(m-2) by Fermat's little theorem, and going
+// down, 1/(i-1)! = 1/i! * i.
+//
+// The tables start empty and grow to the largest n asked for, at least
+// doubling each time, so a run that only asks about small n never builds
+// 2M entries, and all the growing costs O(log n) powers in total.
+//
+// Run with --bench Q N to time Q random queries with n below N, against
+// a power per query.
+//
+// Run with --mod M to answer modulo any M below 2^63 instead, for n up to
+// 2^64 - 1 (Binomial.h): Lucas' theorem for the primes of M, Granville's
+// for its prime powers, joined by the Chinese remainder theorem. The
+// tables there are of size p^e, not n, so each prime power of M has to be
+// at most 2^24.
 
 // This function calcualtes the large powers with O(log(n))
 long fastexp(long x, long y)
 {
-	// In the form of pow(x, y) % m
-	if(y == 0)
-		return 1;
-	else if (y == 1)
-		return x;
-	else
+	// In the form of pow(x, y) % m, by squaring from the low bit up
+	long ans = 1;
+	x %= m;
+	for(; y > 0; y /= 2)
 	{
-		long ans = fastexp(x, y/2);
-		if(y % 2 == 0)
-			return (ans % m * ans % m) % m;
-		else
-			return ((ans % m * ans % m) % m * x % m) % m;
+		if(y % 2 == 1)
+			ans = ans * x % m;
+		x = x * x % m;
 	}
+	return ans;
+}
+
+static uint32_t *fact, *invFact;
+static size_t tableSize; // entries 0 .. tableSize - 1 are filled
+
+// Makes the tables cover 0 .. n; returns 0, or -1 when out of memory or
+// n >= m (m! is 0 mod m and has no inverse)
+int binomReserve(size_t n)
+{
+	size_t size = tableSize, i;
+	uint32_t *f, *inv;
+	if (n < tableSize)
+		return 0;
+	if (n >= m)
+		return -1;
+	while (size <= n)
+		size = size < 1024 ? 1024 : size * 2;
+	if (size > m)
+		size = n + 1;
+	f = realloc(fact, size * sizeof(uint32_t));
+	if (f == NULL)
+		return -1;
+	fact = f;
+	inv = realloc(invFact, size * sizeof(uint32_t));
+	if (inv == NULL)
+		return -1;
+	invFact = inv;
+	for (i = tableSize; i < size; i++)
+		fact[i] = i == 0 ? 1 : (uint32_t)((uint64_t)fact[i - 1] * i % m);
+	// one power for the top, then down to what was there before
+	invFact[size - 1] = (uint32_t)fastexp(fact[size - 1], m - 2);
+	for (i = size - 1; i > tableSize; i--)
+		invFact[i - 1] = (uint32_t)((uint64_t)invFact[i] * i % m);
+	tableSize = size;
+	return 0;
 }
 
-long fact[2000001] = {1};
+// nCr mod m with the tables already covering n; 0 when r > n
+static inline uint32_t binom(size_t n, size_t r)
+{
+	if (r > n)
+		return 0;
+	return (uint32_t)((uint64_t)fact[n] * invFact[r] % m * invFact[n - r] % m);
+}
 
-int main()
+// out[i] = n[i] C r[i] mod m; returns 0, or -1 as binomReserve()
+int binomBatch(const uint32_t *n, const uint32_t *r, uint32_t *out, size_t count)
 {
-	// FACTORIAL CALCULATION
-	// Using (a * b) % m = (a % m * b % m) % m
-	for(int i = 1; i < 2000001; i++)
-		fact[i] = ((fact[i-1] % m) * (i % m)) % m;
+	size_t i;
+	uint32_t top = 0;
+	for (i = 0; i < count; i++)
+		if (n[i] > top)
+			top = n[i];
+	if (count > 0 && binomReserve(top) != 0)
+		return -1;
+	for (i = 0; i < count; i++)
+		out[i] = binom(n[i], r[i]);
+	return 0;
+}
 
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench(size_t q, uint32_t maxN)
+{
+	uint32_t *n = malloc(q * sizeof(uint32_t)), *r = malloc(q * sizeof(uint32_t));
+	uint32_t *out = malloc(q * sizeof(uint32_t));
+	uint64_t seed = 88172645463325252ULL, sum = 0;
+	double t[3];
+	size_t i, checked = q < 1000000 ? q : 1000000;
+	if (n == NULL || r == NULL || out == NULL || q == 0 || maxN == 0)
+	{
+		printf("Cannot set up %zu queries\n", q);
+		return 1;
+	}
+	for (i = 0; i < q; i++)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		n[i] = (uint32_t)(seed % maxN);
+		r[i] = (uint32_t)((seed >> 32) % (n[i] + 1));
+	}
+	t[0] = now();
+	if (binomBatch(n, r, out, q) != 0)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+	t[1] = now();
+	// the old way: a power per query, on the first million
+	for (i = 0; i < checked; i++)
+	{
+		uint32_t old = (uint32_t)((uint64_t)fact[n[i]] *
+			fastexp((uint64_t)fact[r[i]] * fact[n[i] - r[i]] % m, m - 2) % m);
+		if (old != out[i])
+		{
+			printf("Mismatch at %zu\n", i);
+			return 1;
+		}
+		sum += old;
+	}
+	t[2] = now();
+	printf("%zu queries, n < %u\n", q, maxN);
+	printf("tables + batch  %.1f ns per query (tables: %zu entries)\n", (t[1] - t[0]) * 1e9 / q, tableSize);
+	printf("power per query %.1f ns per query (%llu)\n", (t[2] - t[1]) * 1e9 / checked, (unsigned long long)sum);
+	free(n);
+	free(r);
+	free(out);
+	return 0;
+}
+
+// The test cases of main(), modulo mod
+int anyModulus(uint64_t mod)
+{
+	const BinomMod *b = binomModGet(mod);
+	unsigned long long n, r;
+	int T;
+	if (b == NULL)
+	{
+		printf("The modulus must be below 2^63 with every prime power at most %u\n", BINOM_TABLE_LIMIT);
+		return 1;
+	}
+	printf("Enter the number of test cases: ");
+	if (scanf("%d", &T) != 1)
+		return 1;
+	while(T--)
+	{
+		printf("Enter the two numbers in the form of xCy: ");
+		if (scanf("%llu%llu", &n, &r) != 2)
+			return 1;
+		printf("%llu\n", (unsigned long long)binomModQuery(b, n, r));
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
 	// Number of test cases
 	int T;
-	long n, r, ans;
+	long n, r;
+	if (argc > 3 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoull(argv[2], NULL, 10), (uint32_t)strtoul(argv[3], NULL, 10));
+	if (argc > 2 && strcmp(argv[1], "--mod") == 0)
+		return anyModulus(strtoull(argv[2], NULL, 10));
 	printf("Enter the number of test cases: ");
-	scanf("%d", &T);
+	if (scanf("%d", &T) != 1)
+		return 1;
 	while(T--)
 	{
 		printf("Enter the two numbers in the form of xCy: ");
-		scanf("%ld%ld", &n, &r);
+		if (scanf("%ld%ld", &n, &r) != 2)
+			return 1;
 
 		// Formula used: (n)!/ (r! * (n-r)!)
-		// = (n+r)! * pow((r! * (n-r)!), -1) 
-		// Using FERMAT's LITTLE THEOREM (Google it!) 
-		// = (fact[n]%m * pow((r! * (n-r)!), m - 2) % m) % m
-		// = (fact[n]%m * fastexp((fact[r] * fact[n-r])%m, m - 2)%m)%m
-
-		ans = (fact[n]%m * fastexp((fact[r]%m * fact[n-r]%m) % m, m - 2) % m) % m;
-		printf("%ld\n", ans);
+		// = n! * (1/r!) * (1/(n-r)!), all mod m, from the tables
+		if (n < 0 || r < 0 || n >= m || binomReserve((size_t)n) != 0)
+		{
+			printf("n must be between 0 and %d\n", m - 1);
+			continue;
+		}
+		printf("%u\n", binom((size_t)n, (size_t)r));
 	}
 	return 0;
 }
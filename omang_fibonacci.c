@@ -1,18 +1,37 @@
  #include<stdio.h>
+#include "BigNum.h"
+//Each term is the sum of the two before it, so the loop keeps just those
+//two, passed along instead of kept in static variables (which made the
+//function work only once per run). They are BigNums (BigNum.h), so the
+//terms never overflow, however many are asked for.
 void printFibonacci(int n){
-    static int n1=0,n2=1,n3;
-    if(n>0){
-         n3 = n1 + n2;
+    BigNum n1, n2, n3;
+    bigInit(&n1);
+    bigInit(&n2);
+    bigInit(&n3);
+    if(bigSetU64(&n1,0)!=0 || bigSetU64(&n2,1)!=0)
+        n=0;
+    for(; n>0; n--){
+         if(bigAdd(&n3,&n1,&n2)!=0){
+             printf("(out of memory)");
+             break;
+         }
+         BigNum t = n1;
          n1 = n2;
          n2 = n3;
-         printf("%d ",n3);
-         printFibonacci(n-1);
+         n3 = t;
+         bigPrint(stdout,&n2);
+         printf(" ");
     }
+    bigFree(&n1);
+    bigFree(&n2);
+    bigFree(&n3);
 }
 int main(){
     int n;
     printf("Enter the number of elements: ");
-    scanf("%d",&n);
+    if(scanf("%d",&n)!=1)
+        return 1;
     printf("Fibonacci Series: ");
     printf("%d %d ",0,1);
     printFibonacci(n-2);
@@ -1,26 +1,28 @@
 #include <stdio.h>
+#include "Pattern.h"
  
+// Every row of the pyramid is a slice of one line of n - 1 blanks and
+// 2n - 1 stars (Pattern.h): row r starts n - r blanks before the stars.
+// The rows go out through one OutBuffer.
 int main()
 {
-  int row, c, n, s;
+  int row, n;
+  PatternTemplate t;
+  OutBuffer out;
  
   printf("Enter the number of rows in pyramid of stars you wish to see\n");
-  scanf("%d", &n);
- 
-  s = n;
+  if (scanf("%d", &n) != 1)
+    return 1;
+  if (n < 1)
+    return 0;
+  if (patternOpen(&t, n - 1, 2 * (size_t)n - 1) != 0 || outInit(&out, stdout, 0) != 0)
+    return 1;
+  patternRepeat(&t, "*");
  
   for (row = 1; row <= n; row++)  // Loop to print rows
-  {
-    for (c = 1; c < s; c++)  // Loop to print spaces in a row
-      printf(" ");
- 
-    s--;
- 
-    for (c = 1; c <= 2*row - 1; c++) // Loop to print stars in a row
-      printf("*");
- 
-    printf("\n");
-  }
+    patternRow(&out, &t, n - row, 2 * (size_t)row - 1);  // spaces, then stars
  
+  outClose(&out);
+  patternClose(&t);
   return 0;
 }
@@ -1,37 +1,226 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<stdbool.h>
+#include<stdint.h>
+#include<time.h>
+#include<pthread.h>
+#include<stdatomic.h>
+#include "Probe.h"
 
-int CAPACITY = 10;
-int size;
+// Each task has up to HEAP_ARITY children. A wider heap is flatter, so a
+// pop walks fewer levels, and the children of a task sit next to each
+// other in memory. Run with --arity D for another width.
+//
+// Run with --concurrent THREADS [--queues Q] [--tasks N] to time a
+// multiQueue, the version that many threads can share, instead of the
+// menu (build with -pthread).
+//
+// Run with --timers N to time a timerWheel, for tasks that are due at a
+// deadline, against keeping the same timers in a taskHeap.
+//
+// Run with --radix N to time a radixHeap, for priorities that only grow,
+// against a taskHeap on a Dijkstra-like run of N pops.
+//
+// Build with -DPROBE to time every heap operation and the locked part of
+// mqPush and mqPop (Probe.h); the numbers go to stderr, or to $PROBE_OUT,
+// as JSON at exit.
+#define HEAP_ARITY 4
+#define INITIAL_CAPACITY 16
 
 typedef struct task {
     int id;
     int priority;
 }task;
 
-int getLeftChildIndex(int i);
-int getRightChildIndex(int i);
-int getParentIndex(int i);
-bool hasLeftChild(int i);
-bool hasRightChild(int i);
-bool hasParent(int i);
-task leftChild(int i, task* taskList);
-task rightChild(int i, task* taskList);
-task parent(int i, task* taskList);
-void swap(int i, int j, task* taskList);
-void ensureExtraCapacity(task** taskList);
-task peek(task *taskList);
-task poll(task *taskList);
-void addTask(task t, task* taskList);
-void heapifyUp(task* taskList);
-void heapifyDown(task* taskList);
-
-
-int main() {
-    task *taskList = malloc(sizeof(int)*CAPACITY);
+// One entry of the id -> array position hash table; position < 0 is free
+typedef struct idSlot {
+    int id;
+    int position;
+}idSlot;
+
+// Max-heap of tasks in one growing array: the children of tasks[i] are
+// tasks[d*i + 1] .. tasks[d*i + d]. The hash table says where every task
+// is, so a task can be found by its id to change its priority or cancel
+// it. Ids are unique.
+typedef struct taskHeap {
+    task *tasks;
+    int size;
+    int capacity; // in tasks, not bytes
+    int arity;
+    idSlot *slots; // open addressing, at most half full
+    int slotMask;  // number of slots - 1
+}taskHeap;
+
+bool heapInit(taskHeap *heap, int arity);
+void heapFree(taskHeap *heap);
+bool ensureExtraCapacity(taskHeap *heap);
+bool reserveTasks(taskHeap *heap, int n);
+task peek(const taskHeap *heap);
+task poll(taskHeap *heap);
+bool addTask(taskHeap *heap, task t);
+bool addTasks(taskHeap *heap, const task *batch, int n);
+bool buildHeap(taskHeap *heap, const task *batch, int n);
+int pollBatch(taskHeap *heap, task *out, int k);
+bool updatePriority(taskHeap *heap, int id, int priority);
+bool removeTask(taskHeap *heap, int id);
+void heapifyUp(taskHeap *heap, int index, task t);
+void heapifyDown(taskHeap *heap, int index, task t);
+int findSlot(const taskHeap *heap, int id);
+bool hasTask(const taskHeap *heap, int id);
+bool growSlots(taskHeap *heap, int slots);
+void forgetId(taskHeap *heap, int id);
+void placeTask(taskHeap *heap, int index, task t);
+
+// A multiQueue is Q taskHeaps with a lock each (Rihani, Sanders and
+// Dementiev, "MultiQueues: Simple Relaxed Concurrent Priority Queues",
+// 2015). A push goes to a random queue. A pop looks at the tops of two
+// random queues and takes from the higher one. Threads rarely meet on a
+// lock, so it scales with the number of threads where one lock around
+// one heap does not.
+//
+// The price is a relaxed order: a pop returns one of the highest tasks,
+// not always the highest. With Q = c * threads the task popped is on
+// average about the Q-th highest, and never worse than the highest
+// task of the two queues it looked at. A pop that finds every queue
+// empty returns false, even if a push is in flight at that moment.
+// Ids only need to be unique within a queue; a push whose id is
+// already in the queue it picked returns false.
+typedef struct lockedHeap {
+    _Alignas(64) pthread_mutex_t lock;
+    taskHeap heap;
+    atomic_int size; // heap.size and heap.tasks[0].priority, for looking
+    atomic_int top;  // without the lock
+}lockedHeap;
+
+typedef struct multiQueue {
+    lockedHeap *queues;
+    int count;
+}multiQueue;
+
+bool mqInit(multiQueue *mq, int count, int arity);
+void mqFree(multiQueue *mq);
+bool mqPush(multiQueue *mq, task t, unsigned *seed);
+bool mqPop(multiQueue *mq, task *out, unsigned *seed);
+int concurrentMain(int threads, int queues, int tasks);
+
+// A hierarchical timing wheel (Varghese and Lauck, 1987) of timers, each
+// a task that is due at a tick. WHEEL_LEVELS wheels of WHEEL_SLOTS
+// slots: a timer due within this turn of the wheel below goes straight
+// into its slot of level 0, one due further out into a slot of a higher
+// level, and it moves down a level each time the wheel below comes
+// round to it. Adding and cancelling a timer is O(1) (a linked list
+// per slot), and each timer moves down at most WHEEL_LEVELS times. The
+// timers due at the same tick go through a taskHeap, so they fire
+// highest priority first.
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+typedef struct timer {
+    task t;
+    uint64_t deadline;
+    int prev, next; // in its slot's list, or the free list; -1 ends it
+    int level; // -1 when the timer is free, -2 once it is due this tick
+}timer;
+
+typedef struct timerWheel {
+    timer *timers;
+    int capacity;
+    int freeList;
+    int slot[WHEEL_LEVELS][WHEEL_SLOTS]; // first timer of each slot, -1 if none
+    int count[WHEEL_LEVELS + 1];         // timers per level; the last is the overflow
+    int overflow;                        // too far out for every level
+    uint64_t now;                        // every tick up to now has fired
+    taskHeap due;                        // id = timer handle
+}timerWheel;
+
+typedef void (*timerFn)(task t, uint64_t deadline, void *arg);
+
+bool wheelInit(timerWheel *wheel, uint64_t now);
+void wheelFree(timerWheel *wheel);
+int addTimer(timerWheel *wheel, task t, uint64_t deadline);
+bool cancelTimer(timerWheel *wheel, int handle);
+int runUntil(timerWheel *wheel, uint64_t now, timerFn fire, void *arg);
+int timersMain(int n);
+
+// A radix heap (Ahuja, Mehlhorn, Orlin and Tarjan, 1990) of tasks whose
+// priorities are monotone, as the distances of Dijkstra's algorithm
+// are: no task is added with a lower priority than the last one polled,
+// so, unlike taskHeap, the lowest priority comes out first. Bucket 0
+// holds the tasks whose priority is the base (the last one polled, as a
+// rule), and bucket b those whose priority first differs from it in bit
+// b - 1, so the buckets stay sorted among themselves. An add appends to
+// its bucket. A poll that finds bucket 0 empty takes the first bucket
+// that is not, makes its lowest priority the base and spreads its tasks
+// over the buckets below, each of which it can only move down: a task
+// moves at most 32 times (O(log C) for priorities up to C apart)
+// however long it waits. Each bucket is a growing array, so spreading one is a
+// few passes straight through memory. If the buckets below cannot grow
+// for it, the poll takes the lowest task out of that bucket instead,
+// which keeps the order, only slower. There are no ids, so no
+// updatePriority; add the task again, as Dijkstra's algorithm does
+// with lazy deletion.
+#define RADIX_BUCKETS 33
+
+typedef struct taskBucket {
+    task *tasks;
+    int size;
+    int capacity; // in tasks, not bytes
+}taskBucket;
+
+typedef struct radixHeap {
+    taskBucket bucket[RADIX_BUCKETS];
+    uint32_t base; // what the buckets are counted from, in radixKey form
+    uint32_t last; // the last priority polled, no lower than base
+    int size;
+}radixHeap;
+
+void radixInit(radixHeap *rh);
+void radixFree(radixHeap *rh);
+bool radixAdd(radixHeap *rh, task t);
+task radixPeek(radixHeap *rh);
+task radixPoll(radixHeap *rh);
+int radixMain(int n);
+
+
+int main(int argc, char *argv[]) {
+    taskHeap heap;
     task task;
-    int op;
+    int op, arity = HEAP_ARITY, threads = 0, queues = 0, tasks = 1000000, timers = 0, radix = 0;
+    bool bad = false;
+    for(int i = 1; i < argc; ++i) {
+        if(i + 1 == argc)
+            bad = true;
+        else if(strcmp(argv[i], "--arity") == 0)
+            arity = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--concurrent") == 0)
+            threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--queues") == 0)
+            queues = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--tasks") == 0)
+            tasks = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--timers") == 0)
+            timers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--radix") == 0)
+            radix = atoi(argv[++i]);
+        else
+            bad = true;
+    }
+    if(bad || arity < 2 || threads < 0 || queues < 0 || tasks < 1 || timers < 0 || radix < 0) {
+        printf("Usage: %s [--arity D] [--concurrent THREADS [--queues Q] [--tasks N]] [--timers N] [--radix N], D >= 2\n", argv[0]);
+        return 1;
+    }
+    if(timers > 0)
+        return timersMain(timers);
+    if(radix > 0)
+        return radixMain(radix);
+    if(threads > 0)
+        return concurrentMain(threads, queues ? queues : 2 * threads, tasks);
+    if(!heapInit(&heap, arity)) {
+        printf("Out of memory\n");
+        return 1;
+    }
     printf("\tIn this program the greater the priority value of the task, the higher is the priority of the task\n");
     for(int i = 0; i < 110; ++i)
             printf("-");
@@ -41,8 +230,14 @@ int main() {
         printf("2...Remove highest priority task\n");
         printf("3...Show highest priority task\n");
         printf("4...Exit\n");
+        printf("5...Change the priority of a task\n");
+        printf("6...Cancel a task\n");
+        printf("7...Enter many tasks\n");
+        printf("8...Remove the k highest priority tasks\n");
         printf("Enter you option below:\n");
-        printf("-> "); scanf("%d", &op);
+        printf("-> ");
+        if(scanf("%d", &op) != 1)
+            op = 4; // end of input
         printf("\n");
         
         switch(op) {
@@ -53,16 +248,27 @@ int main() {
                 printf("Enter the task Priority:\n");
                 printf("-> "); scanf("%d", &task.priority);
 
-                addTask(task, taskList);
+                if(hasTask(&heap, task.id))
+                    printf("There already is a task with ID %d\n", task.id);
+                else if(!addTask(&heap, task))
+                    printf("Out of memory, task not added\n");
             break;
             case 2:
-                task = poll(taskList);
+                if(!heap.size) {
+                    printf("Error ! There are no tasks\n");
+                    break;
+                }
+                task = poll(&heap);
                 printf("Element Processed is:\n");
                 printf("ID: %d\n", task.id);
                 printf("Priority: %d\n", task.priority);
             break;
             case 3:
-                task = peek(taskList);
+                if(!heap.size) {
+                    printf("Error ! There are no tasks\n");
+                    break;
+                }
+                task = peek(&heap);
                 printf("Element Ready to be Processed first is:\n");
                 printf("ID: %d\n", task.id);
                 printf("Priority: %d\n", task.priority);
@@ -70,6 +276,61 @@ int main() {
             case 4:
                 // nothing to see here...
             break;
+            case 5:
+                printf("Enter the task ID:\n");
+                printf("-> "); scanf("%d", &task.id);
+
+                printf("Enter the new task Priority:\n");
+                printf("-> "); scanf("%d", &task.priority);
+
+                if(!updatePriority(&heap, task.id, task.priority))
+                    printf("Error ! There is no task with ID %d\n", task.id);
+            break;
+            case 6:
+                printf("Enter the task ID:\n");
+                printf("-> "); scanf("%d", &task.id);
+
+                if(!removeTask(&heap, task.id))
+                    printf("Error ! There is no task with ID %d\n", task.id);
+            break;
+            case 7: {
+                int n = 0;
+                struct task *batch;
+                printf("How many tasks?\n");
+                printf("-> "); scanf("%d", &n);
+                batch = n > 0 ? malloc(n * sizeof *batch) : NULL;
+                if(batch == NULL) {
+                    printf("Error ! Can't take %d tasks\n", n);
+                    break;
+                }
+                printf("Enter the ID and Priority of each task:\n");
+                for(int i = 0; i < n; ++i)
+                    scanf("%d %d", &batch[i].id, &batch[i].priority);
+
+                if(!addTasks(&heap, batch, n))
+                    printf("Error ! Repeated ID or out of memory, no task added\n");
+                free(batch);
+            }
+            break;
+            case 8: {
+                int k = 0;
+                struct task *out;
+                printf("How many tasks?\n");
+                printf("-> "); scanf("%d", &k);
+                if(k > heap.size)
+                    k = heap.size;
+                out = malloc((k > 0 ? k : 1) * sizeof *out);
+                if(out == NULL) {
+                    printf("Out of memory\n");
+                    break;
+                }
+                k = pollBatch(&heap, out, k);
+                printf("Elements Processed are:\n");
+                for(int i = 0; i < k; ++i)
+                    printf("ID: %d Priority: %d\n", out[i].id, out[i].priority);
+                free(out);
+            }
+            break;
             default:
                 printf("Invalid option entered, please try again !\n\n");
             break;
@@ -78,105 +339,919 @@ int main() {
             printf("-");
         printf("\n");
     } while(op != 4);
-    free(taskList);
+    heapFree(&heap);
     return 0;
 }
 
-void heapifyDown(task* taskList) {
-    int index = 0;
-    int greaterChildIndex = getLeftChildIndex(index);
-    while(hasLeftChild(index)) {
-        if(hasRightChild(index) && rightChild(index, taskList).priority > leftChild(index, taskList).priority) {
-            greaterChildIndex = getRightChildIndex(index);
-        }
-        if(taskList[index].priority > taskList[greaterChildIndex].priority) {
+bool heapInit(taskHeap *heap, int arity) {
+    heap->tasks = malloc(INITIAL_CAPACITY * sizeof *heap->tasks);
+    heap->slots = malloc(2 * INITIAL_CAPACITY * sizeof *heap->slots);
+    heap->size = 0;
+    heap->capacity = INITIAL_CAPACITY;
+    heap->arity = arity;
+    heap->slotMask = 2 * INITIAL_CAPACITY - 1;
+    if(heap->tasks == NULL || heap->slots == NULL) {
+        heapFree(heap);
+        return false;
+    }
+    for(int i = 0; i <= heap->slotMask; ++i)
+        heap->slots[i].position = -1;
+    return true;
+}
+
+void heapFree(taskHeap *heap) {
+    free(heap->tasks);
+    free(heap->slots);
+    heap->tasks = NULL;
+    heap->slots = NULL;
+    heap->size = heap->capacity = 0;
+}
+
+// The slot that holds id, or the free one where it would go
+int findSlot(const taskHeap *heap, int id) {
+    unsigned hash = (unsigned)id * 2654435761u;
+    int i = (int)(hash ^ (hash >> 16)) & heap->slotMask;
+    while(heap->slots[i].position >= 0 && heap->slots[i].id != id)
+        i = (i + 1) & heap->slotMask;
+    return i;
+}
+
+bool hasTask(const taskHeap *heap, int id) {
+    return heap->slots[findSlot(heap, id)].position >= 0;
+}
+
+// Records that the task t is now at tasks[index]
+void placeTask(taskHeap *heap, int index, task t) {
+    int slot = findSlot(heap, t.id);
+    heap->tasks[index] = t;
+    heap->slots[slot].id = t.id;
+    heap->slots[slot].position = index;
+}
+
+// Empties the slot of id, then moves back any later task of the same
+// run that could not go where it wanted because the slot was taken
+void forgetId(taskHeap *heap, int id) {
+    int hole = findSlot(heap, id), i = hole;
+    heap->slots[hole].position = -1;
+    for(;;) {
+        int home;
+        i = (i + 1) & heap->slotMask;
+        if(heap->slots[i].position < 0)
+            return;
+        home = findSlot(heap, heap->slots[i].id);
+        if(home == i)
+            continue; // it still finds itself before reaching the hole
+        heap->slots[hole] = heap->slots[i];
+        heap->slots[i].position = -1;
+        hole = i;
+    }
+}
+
+// slots must be a power of two
+bool growSlots(taskHeap *heap, int slots) {
+    idSlot *old = heap->slots;
+    int oldMask = heap->slotMask;
+    idSlot *bigger = malloc(slots * sizeof *bigger);
+    if(bigger == NULL)
+        return false;
+    heap->slots = bigger;
+    heap->slotMask = slots - 1;
+    for(int i = 0; i <= heap->slotMask; ++i)
+        bigger[i].position = -1;
+    for(int i = 0; i <= oldMask; ++i)
+        if(old[i].position >= 0)
+            bigger[findSlot(heap, old[i].id)] = old[i];
+    free(old);
+    return true;
+}
+
+// Puts t into the hole at index, first moving the hole down past every
+// child with a higher priority. Only priorities are compared, in place,
+// and every task moves once instead of being swapped.
+void heapifyDown(taskHeap *heap, int index, task t) {
+    task *tasks = heap->tasks;
+    int d = heap->arity;
+    for(;;) {
+        int first = d*index + 1, last = first + d, greaterChildIndex = first;
+        if(first >= heap->size)
+            break;
+        if(last > heap->size)
+            last = heap->size;
+        for(int c = first + 1; c < last; ++c)
+            if(tasks[c].priority > tasks[greaterChildIndex].priority)
+                greaterChildIndex = c;
+        if(t.priority >= tasks[greaterChildIndex].priority)
             break;
+        placeTask(heap, index, tasks[greaterChildIndex]);
+        index = greaterChildIndex;
+    }
+    placeTask(heap, index, t);
+}
+
+// The same upwards: the hole moves up past every parent with a lower priority
+void heapifyUp(taskHeap *heap, int index, task t) {
+    task *tasks = heap->tasks;
+    while(index > 0) {
+        int parentIndex = (index - 1) / heap->arity;
+        if(tasks[parentIndex].priority >= t.priority)
+            break;
+        placeTask(heap, index, tasks[parentIndex]);
+        index = parentIndex;
+    }
+    placeTask(heap, index, t);
+}
+
+// t.id must not be in the heap yet
+bool addTask(taskHeap *heap, task t) {
+    PROBE_SCOPE("addTask");
+    if(!ensureExtraCapacity(heap))
+        return false;
+    heapifyUp(heap, heap->size++, t);
+    return true;
+}
+
+// The heap must not be empty
+task poll(taskHeap *heap) {
+    PROBE_SCOPE("poll");
+    task t = heap->tasks[0];
+    forgetId(heap, t.id);
+    if(--heap->size > 0)
+        heapifyDown(heap, 0, heap->tasks[heap->size]);
+    return t;
+}
+
+// False if there is no task with that id
+bool updatePriority(taskHeap *heap, int id, int priority) {
+    PROBE_SCOPE("updatePriority");
+    int slot = findSlot(heap, id), index;
+    task t;
+    if(heap->slots[slot].position < 0)
+        return false;
+    index = heap->slots[slot].position;
+    t = heap->tasks[index];
+    if(priority > t.priority) {
+        t.priority = priority;
+        heapifyUp(heap, index, t);
+    }
+    else {
+        t.priority = priority;
+        heapifyDown(heap, index, t);
+    }
+    return true;
+}
+
+// False if there is no task with that id. The last task fills its place.
+bool removeTask(taskHeap *heap, int id) {
+    PROBE_SCOPE("removeTask");
+    int slot = findSlot(heap, id), index;
+    task last;
+    if(heap->slots[slot].position < 0)
+        return false;
+    index = heap->slots[slot].position;
+    forgetId(heap, id);
+    last = heap->tasks[--heap->size];
+    if(index == heap->size)
+        return true;
+    if(last.priority > heap->tasks[index].priority)
+        heapifyUp(heap, index, last);
+    else
+        heapifyDown(heap, index, last);
+    return true;
+}
+
+// The heap must not be empty
+task peek(const taskHeap *heap) {
+    return heap->tasks[0];
+}
+
+// Doubles the array when it is full, so n pushes copy O(n) tasks in all
+bool ensureExtraCapacity(taskHeap *heap) {
+    return heap->size < heap->capacity || reserveTasks(heap, heap->size + 1);
+}
+
+// Makes room for n tasks, doubling the array as often as needed. The
+// hash table grows with it, to stay at most half full.
+bool reserveTasks(taskHeap *heap, int n) {
+    int capacity = heap->capacity, slots = heap->slotMask + 1;
+    task *bigger;
+    if(n <= capacity)
+        return true;
+    while(capacity < n)
+        capacity *= 2;
+    while(slots < 2 * capacity)
+        slots *= 2;
+    if(slots > heap->slotMask + 1 && !growSlots(heap, slots))
+        return false;
+    bigger = realloc(heap->tasks, capacity * sizeof *bigger);
+    if(bigger == NULL)
+        return false;
+    heap->tasks = bigger;
+    heap->capacity = capacity;
+    return true;
+}
+
+// Appends batch, then restores the heap. A small batch is sifted up task
+// by task; once it is big next to the heap (more than size / log2(size)
+// tasks), Floyd's bottom-up heapify of the whole array is cheaper: O(n)
+// instead of O(n log n). Adds nothing and returns false if an id is
+// repeated or already queued, or memory runs out.
+bool addTasks(taskHeap *heap, const task *batch, int n) {
+    PROBE_SCOPE("addTasks");
+    int old = heap->size, logSize = 1;
+    if(n <= 0)
+        return n == 0;
+    if(!reserveTasks(heap, old + n))
+        return false;
+    for(int i = 0; i < n; ++i) {
+        if(hasTask(heap, batch[i].id)) {
+            while(heap->size > old)
+                forgetId(heap, heap->tasks[--heap->size].id);
+            return false;
         }
-        else {
-            swap(index, greaterChildIndex, taskList);
+        placeTask(heap, heap->size++, batch[i]);
+    }
+    while((1 << logSize) < old)
+        ++logSize;
+    if(n > old / logSize) {
+        for(int i = (heap->size - 2) / heap->arity; i >= 0; --i)
+            heapifyDown(heap, i, heap->tasks[i]);
+    }
+    else {
+        for(int i = old; i < heap->size; ++i)
+            heapifyUp(heap, i, heap->tasks[i]);
+    }
+    return true;
+}
+
+// Replaces everything in the heap with batch, in O(n)
+bool buildHeap(taskHeap *heap, const task *batch, int n) {
+    while(heap->size > 0)
+        forgetId(heap, heap->tasks[--heap->size].id);
+    return addTasks(heap, batch, n);
+}
+
+// Takes the k highest priority tasks (fewer if there are not that many)
+// into out, highest first, and returns how many
+int pollBatch(taskHeap *heap, task *out, int k) {
+    PROBE_SCOPE("pollBatch");
+    int taken = 0;
+    for(; taken < k && heap->size > 0; ++taken) {
+        out[taken] = heap->tasks[0];
+        forgetId(heap, out[taken].id);
+        if(--heap->size > 0)
+            heapifyDown(heap, 0, heap->tasks[heap->size]);
+    }
+    return taken;
+}
+
+bool mqInit(multiQueue *mq, int count, int arity) {
+    mq->queues = aligned_alloc(64, count * sizeof *mq->queues);
+    mq->count = 0;
+    if(mq->queues == NULL)
+        return false;
+    for(; mq->count < count; ++mq->count) {
+        lockedHeap *q = &mq->queues[mq->count];
+        if(!heapInit(&q->heap, arity)) {
+            mqFree(mq);
+            return false;
         }
-        index = greaterChildIndex;
+        pthread_mutex_init(&q->lock, NULL);
+        atomic_init(&q->size, 0);
+        atomic_init(&q->top, 0);
     }
+    return true;
 }
 
-void heapifyUp(task* taskList) {
-    int index = size - 1;
-    while(hasParent(index) && parent(index, taskList).priority < taskList[index].priority) {
-        swap(getParentIndex(index), index, taskList);
-        index = getParentIndex(index);
+void mqFree(multiQueue *mq) {
+    for(int i = 0; i < mq->count; ++i) {
+        pthread_mutex_destroy(&mq->queues[i].lock);
+        heapFree(&mq->queues[i].heap);
     }
+    free(mq->queues);
+    mq->queues = NULL;
+    mq->count = 0;
 }
 
-void addTask(task t, task* taskList) {
-    ensureExtraCapacity(&taskList);
-    taskList[size] = t;
-    ++size;
-    heapifyUp(taskList);
+// xorshift, one seed per thread
+int randomQueue(const multiQueue *mq, unsigned *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return (int)(*seed % (unsigned)mq->count);
 }
 
-task poll(task *taskList) {
-    if(!size) {
-        printf("Error !\n");
-        exit(0);
+// Call with q->lock held
+void publishTop(lockedHeap *q) {
+    if(q->heap.size > 0)
+        atomic_store_explicit(&q->top, q->heap.tasks[0].priority, memory_order_relaxed);
+    atomic_store_explicit(&q->size, q->heap.size, memory_order_release);
+}
+
+bool mqPush(multiQueue *mq, task t, unsigned *seed) {
+    for(;;) {
+        lockedHeap *q = &mq->queues[randomQueue(mq, seed)];
+        bool added;
+        if(pthread_mutex_trylock(&q->lock) != 0) {
+            PROBE_COUNT("mqPush busy", 1);
+            continue; // busy: any other queue will do
+        }
+        PROBE_BEGIN(locked, "mqPush locked");
+        added = !hasTask(&q->heap, t.id) && addTask(&q->heap, t);
+        publishTop(q);
+        PROBE_END(locked);
+        pthread_mutex_unlock(&q->lock);
+        return added;
     }
-    task t = taskList[0];
-    taskList[0] = taskList[size-1];
-    --size;
-    heapifyDown(taskList);
-    return t;
 }
 
-task peek(task *taskList) {
-    if(!size) {
-        printf("Error !\n");
-        exit(0);
+bool mqPop(multiQueue *mq, task *out, unsigned *seed) {
+    for(;;) {
+        lockedHeap *a = &mq->queues[randomQueue(mq, seed)];
+        lockedHeap *b = &mq->queues[randomQueue(mq, seed)];
+        int sizeA = atomic_load_explicit(&a->size, memory_order_acquire);
+        int sizeB = atomic_load_explicit(&b->size, memory_order_acquire);
+        lockedHeap *q;
+        if(sizeA == 0 && sizeB == 0) {
+            // both look empty: before giving up, look at every queue
+            int i = 0;
+            while(i < mq->count && atomic_load_explicit(&mq->queues[i].size, memory_order_acquire) == 0)
+                ++i;
+            if(i == mq->count)
+                return false;
+            q = &mq->queues[i];
+        }
+        else if(sizeB == 0 || (sizeA > 0 &&
+                atomic_load_explicit(&a->top, memory_order_relaxed) >= atomic_load_explicit(&b->top, memory_order_relaxed)))
+            q = a;
+        else
+            q = b;
+        if(pthread_mutex_trylock(&q->lock) != 0) {
+            PROBE_COUNT("mqPop busy", 1);
+            continue;
+        }
+        if(q->heap.size == 0) { // emptied since we looked
+            pthread_mutex_unlock(&q->lock);
+            continue;
+        }
+        PROBE_BEGIN(locked, "mqPop locked");
+        *out = poll(&q->heap);
+        publishTop(q);
+        PROBE_END(locked);
+        pthread_mutex_unlock(&q->lock);
+        return true;
     }
-    return taskList[0];
 }
 
-void ensureExtraCapacity(task** taskList) {
-    if(size > 2*CAPACITY/3)
-        *taskList = realloc(*taskList,CAPACITY*=2);
+typedef struct mqWorker {
+    pthread_t tid;
+    multiQueue *mq;
+    int first, count; // pushes tasks first .. first + count - 1
+    int total;
+    atomic_long *tickets;
+    long rankError; // sum over its pops of |rank - ideal rank|
+    long pops;
+}mqWorker;
+
+// Priorities are a shuffle of 0 .. total - 1, so the ideal order of the
+// pops is total - 1, total - 2, ...
+int shuffledPriority(int i, int total) {
+    return (int)(((long long)i * 1000003) % total);
 }
 
-void swap(int i, int j, task* taskList) {
-    task temp = taskList[i];
-    taskList[i] = taskList[j];
-    taskList[j] = temp;
+void *mqProducer(void *arg) {
+    mqWorker *w = arg;
+    unsigned seed = 2463534242u + w->first;
+    for(int i = w->first; i < w->first + w->count; ++i) {
+        task t = { i, shuffledPriority(i, w->total) };
+        mqPush(w->mq, t, &seed);
+    }
+    return NULL;
 }
 
-task parent(int i, task* taskList) {
-    return taskList[getParentIndex(i)];
+void *mqConsumer(void *arg) {
+    mqWorker *w = arg;
+    unsigned seed = 88675123u + w->first;
+    task t;
+    while(mqPop(w->mq, &t, &seed)) {
+        long ticket = atomic_fetch_add(w->tickets, 1);
+        long ideal = w->total - 1 - ticket;
+        w->rankError += ideal > t.priority ? ideal - t.priority : t.priority - ideal;
+        w->pops++;
+    }
+    return NULL;
 }
 
-task rightChild(int i, task* taskList) {
-    return taskList[getRightChildIndex(i)];
+double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-task leftChild(int i, task* taskList) {
-    return taskList[getLeftChildIndex(i)];
+// All threads push tasks tasks, then all threads pop them. The rank
+// error of a pop is how far its priority is from the one an exact queue
+// would have returned at that point, going by the order in which the
+// consumers count their pops. A thread descheduled between its pop and
+// its count inflates it, so with more threads than cores it overstates
+// the relaxation.
+int concurrentMain(int threads, int queues, int tasks) {
+    multiQueue mq;
+    mqWorker *w = calloc(threads, sizeof *w);
+    atomic_long tickets;
+    long pops = 0, rankError = 0;
+    double start, pushTime, popTime;
+    if(w == NULL || !mqInit(&mq, queues, HEAP_ARITY)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    atomic_init(&tickets, 0);
+    if(1000003 % tasks == 0) // keep the shuffle a permutation
+        ++tasks;
+    for(int i = 0; i < threads; ++i) {
+        w[i].mq = &mq;
+        w[i].first = (int)((long long)tasks * i / threads);
+        w[i].count = (int)((long long)tasks * (i + 1) / threads) - w[i].first;
+        w[i].total = tasks;
+        w[i].tickets = &tickets;
+    }
+
+    start = seconds();
+    for(int i = 0; i < threads; ++i)
+        pthread_create(&w[i].tid, NULL, mqProducer, &w[i]);
+    for(int i = 0; i < threads; ++i)
+        pthread_join(w[i].tid, NULL);
+    pushTime = seconds() - start;
+
+    start = seconds();
+    for(int i = 0; i < threads; ++i)
+        pthread_create(&w[i].tid, NULL, mqConsumer, &w[i]);
+    for(int i = 0; i < threads; ++i) {
+        pthread_join(w[i].tid, NULL);
+        pops += w[i].pops;
+        rankError += w[i].rankError;
+    }
+    popTime = seconds() - start;
+
+    printf("%d tasks, %d threads, %d queues\n", tasks, threads, queues);
+    printf("push: %.2f M tasks/s\n", tasks / pushTime / 1e6);
+    printf("pop:  %.2f M tasks/s, %ld popped, mean rank error %.1f\n",
+           pops / popTime / 1e6, pops, pops ? (double)rankError / pops : 0.0);
+    mqFree(&mq);
+    free(w);
+    return pops == tasks ? 0 : 1;
+}
+
+bool wheelInit(timerWheel *wheel, uint64_t now) {
+    wheel->timers = NULL;
+    wheel->capacity = 0;
+    wheel->freeList = -1;
+    wheel->overflow = -1;
+    wheel->now = now;
+    memset(wheel->slot, -1, sizeof wheel->slot);
+    memset(wheel->count, 0, sizeof wheel->count);
+    return heapInit(&wheel->due, HEAP_ARITY);
 }
 
-bool hasParent(int i) {
-    return getParentIndex(i) >= 0;
+void wheelFree(timerWheel *wheel) {
+    free(wheel->timers);
+    wheel->timers = NULL;
+    wheel->capacity = 0;
+    heapFree(&wheel->due);
 }
 
-bool hasRightChild(int i) {
-    return getRightChildIndex(i) < size;
+// The list the timer belongs in, going by how far out its deadline is
+int *timerList(timerWheel *wheel, timer *tm) {
+    for(int level = 0; level < WHEEL_LEVELS; ++level) {
+        int shift = WHEEL_BITS * (level + 1);
+        if(shift >= 64 || (tm->deadline >> shift) == (wheel->now >> shift)) {
+            tm->level = level;
+            return &wheel->slot[level][(tm->deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+        }
+    }
+    tm->level = WHEEL_LEVELS;
+    return &wheel->overflow;
 }
 
-bool hasLeftChild(int i) {
-    return getLeftChildIndex(i) < size;
+void linkTimer(timerWheel *wheel, int handle) {
+    timer *tm = &wheel->timers[handle];
+    int *head = timerList(wheel, tm);
+    tm->prev = -1;
+    tm->next = *head;
+    if(*head >= 0)
+        wheel->timers[*head].prev = handle;
+    *head = handle;
+    wheel->count[tm->level]++;
 }
 
-int getLeftChildIndex(int i) {
-    return 2*i + 1;
+void unlinkTimer(timerWheel *wheel, int handle, int *head) {
+    timer *tm = &wheel->timers[handle];
+    if(tm->prev >= 0)
+        wheel->timers[tm->prev].next = tm->next;
+    else
+        *head = tm->next;
+    if(tm->next >= 0)
+        wheel->timers[tm->next].prev = tm->prev;
+    wheel->count[tm->level]--;
+    tm->level = -1;
+}
+
+// The list a linked timer is in
+int *timerHead(timerWheel *wheel, timer *tm) {
+    if(tm->level == WHEEL_LEVELS)
+        return &wheel->overflow;
+    return &wheel->slot[tm->level][(tm->deadline >> (WHEEL_BITS * tm->level)) & (WHEEL_SLOTS - 1)];
+}
+
+// Returns a handle for cancelTimer, -1 if out of memory. It stays valid
+// until the timer fires or is cancelled. A deadline that has passed
+// fires on the next runUntil.
+int addTimer(timerWheel *wheel, task t, uint64_t deadline) {
+    int handle;
+    if(wheel->freeList < 0) {
+        int capacity = wheel->capacity ? 2 * wheel->capacity : INITIAL_CAPACITY;
+        timer *bigger = realloc(wheel->timers, capacity * sizeof *bigger);
+        if(bigger == NULL)
+            return -1;
+        wheel->timers = bigger;
+        for(int i = capacity - 1; i >= wheel->capacity; --i) {
+            bigger[i].level = -1;
+            bigger[i].next = wheel->freeList;
+            wheel->freeList = i;
+        }
+        wheel->capacity = capacity;
+    }
+    handle = wheel->freeList;
+    wheel->freeList = wheel->timers[handle].next;
+    wheel->timers[handle].t = t;
+    wheel->timers[handle].deadline = deadline > wheel->now ? deadline : wheel->now + 1;
+    linkTimer(wheel, handle);
+    return handle;
 }
 
-int getRightChildIndex(int i) {
-    return 2*i + 2;
+void releaseTimer(timerWheel *wheel, int handle) {
+    wheel->timers[handle].level = -1;
+    wheel->timers[handle].next = wheel->freeList;
+    wheel->freeList = handle;
 }
 
-int getParentIndex(int i) {
-    return (i-1)/2;
-}
\ No newline at end of file
+// False if the handle is not a waiting timer
+bool cancelTimer(timerWheel *wheel, int handle) {
+    timer *tm;
+    if(handle < 0 || handle >= wheel->capacity || wheel->timers[handle].level == -1)
+        return false;
+    tm = &wheel->timers[handle];
+    if(tm->level == -2)
+        removeTask(&wheel->due, handle);
+    else
+        unlinkTimer(wheel, handle, timerHead(wheel, tm));
+    releaseTimer(wheel, handle);
+    return true;
+}
+
+// Moves every timer of a list to where it belongs now
+void cascade(timerWheel *wheel, int *head) {
+    int handle = *head;
+    int level = handle >= 0 ? wheel->timers[handle].level : 0;
+    *head = -1;
+    while(handle >= 0) {
+        int next = wheel->timers[handle].next;
+        wheel->count[level]--;
+        linkTimer(wheel, handle);
+        handle = next;
+    }
+}
+
+// Fires, in deadline order, every timer due by now. Timers due at the
+// same tick fire highest priority first. fire may add and cancel timers.
+// Returns how many fired.
+int runUntil(timerWheel *wheel, uint64_t now, timerFn fire, void *arg) {
+    int fired = 0;
+    while(wheel->now < now) {
+        uint64_t tick = wheel->now + 1;
+        int *head;
+
+        if(wheel->count[0] == 0) {
+            // Level 0 is empty, so nothing fires before the first timer of
+            // the lowest level that has any moves down: jump straight there
+            int level = 1;
+            uint64_t next;
+            while(level <= WHEEL_LEVELS && wheel->count[level] == 0)
+                ++level;
+            if(level > WHEEL_LEVELS) {
+                wheel->now = now;
+                break;
+            }
+            if(level == WHEEL_LEVELS) {
+                next = UINT64_MAX;
+                for(int h = wheel->overflow; h >= 0; h = wheel->timers[h].next)
+                    if(wheel->timers[h].deadline < next)
+                        next = wheel->timers[h].deadline;
+                next &= ~((UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1);
+            }
+            else {
+                int shift = WHEEL_BITS * level;
+                int digit = (int)((wheel->now >> shift) & (WHEEL_SLOTS - 1)) + 1;
+                while(wheel->slot[level][digit] < 0) // the timers are in a later slot
+                    ++digit;
+                next = (wheel->now >> (shift + WHEEL_BITS) << (shift + WHEEL_BITS)) |
+                       ((uint64_t)digit << shift);
+            }
+            if(next > now) {
+                wheel->now = now;
+                break;
+            }
+            tick = next;
+        }
+        wheel->now = tick;
+
+        // whenever a wheel comes round, the slot of the level above that
+        // is now current moves down, the top level first
+        for(int level = WHEEL_LEVELS; level >= 1; --level) {
+            int shift = WHEEL_BITS * level;
+            if((tick & ((UINT64_C(1) << shift) - 1)) != 0)
+                continue;
+            if(level == WHEEL_LEVELS)
+                cascade(wheel, &wheel->overflow);
+            else
+                cascade(wheel, &wheel->slot[level][(tick >> shift) & (WHEEL_SLOTS - 1)]);
+        }
+
+        head = &wheel->slot[0][tick & (WHEEL_SLOTS - 1)];
+        if(*head < 0)
+            continue;
+        while(*head >= 0) {
+            int handle = *head;
+            task byHandle = { handle, wheel->timers[handle].t.priority };
+            unlinkTimer(wheel, handle, head);
+            wheel->timers[handle].level = -2;
+            addTask(&wheel->due, byHandle);
+        }
+        while(wheel->due.size > 0) {
+            int handle = poll(&wheel->due).id;
+            timer tm = wheel->timers[handle];
+            releaseTimer(wheel, handle);
+            fire(tm.t, tm.deadline, arg);
+            ++fired;
+        }
+    }
+    return fired;
+}
+
+typedef struct timerCheck {
+    uint64_t last;
+    int lastPriority;
+    long fired;
+    long long sum;
+    bool wrong;
+}timerCheck;
+
+void checkTimer(task t, uint64_t deadline, void *arg) {
+    timerCheck *c = arg;
+    if(deadline < c->last || (deadline == c->last && t.priority > c->lastPriority) ||
+       (uint64_t)t.id != deadline)
+        c->wrong = true;
+    c->last = deadline;
+    c->lastPriority = t.priority;
+    c->fired++;
+    c->sum += t.priority;
+}
+
+// n timers due up to 2^20 ticks out, half of them cancelled, then the
+// clock runs on in steps of 64 ticks. The heap does the same with the
+// negated deadline as the priority and removeTask to cancel.
+int timersMain(int n) {
+    timerWheel wheel;
+    taskHeap heap;
+    int *handles = malloc(n * sizeof *handles);
+    uint64_t *deadlines = malloc(n * sizeof *deadlines);
+    unsigned seed = 2463534242u;
+    timerCheck c = { 0, 0, 0, 0, false };
+    long heapFired = 0;
+    long long heapSum = 0;
+    double start, wheelTime, heapTime;
+    if(handles == NULL || deadlines == NULL || !wheelInit(&wheel, 0) || !heapInit(&heap, HEAP_ARITY)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for(int i = 0; i < n; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        deadlines[i] = 1 + seed % (1u << 20);
+    }
+
+    start = seconds();
+    for(int i = 0; i < n; ++i) {
+        // the id is the deadline, so checkTimer can tell it fired on time
+        task t = { (int)deadlines[i], i % 100 };
+        handles[i] = addTimer(&wheel, t, deadlines[i]);
+    }
+    for(int i = 0; i < n; i += 2)
+        cancelTimer(&wheel, handles[i]);
+    for(uint64_t now = 64; now <= (1u << 20) + 64; now += 64)
+        runUntil(&wheel, now, checkTimer, &c);
+    wheelTime = seconds() - start;
+
+    start = seconds();
+    for(int i = 0; i < n; ++i) {
+        task t = { i, -(int)deadlines[i] };
+        addTask(&heap, t);
+    }
+    for(int i = 0; i < n; i += 2)
+        removeTask(&heap, i);
+    for(uint64_t now = 64; now <= (1u << 20) + 64; now += 64) {
+        while(heap.size > 0 && (uint64_t)-peek(&heap).priority <= now) {
+            heapSum += poll(&heap).id % 100;
+            ++heapFired;
+        }
+    }
+    heapTime = seconds() - start;
+
+    printf("%d timers, half cancelled\n", n);
+    printf("timer wheel: %.3f s, %ld fired\n", wheelTime, c.fired);
+    printf("heap:        %.3f s, %ld fired\n", heapTime, heapFired);
+    if(c.wrong || c.fired != heapFired || c.sum != heapSum) {
+        printf("Wrong: the wheel fired out of order or the wrong timers\n");
+        return 1;
+    }
+    wheelFree(&wheel);
+    heapFree(&heap);
+    free(handles);
+    free(deadlines);
+    return 0;
+}
+
+// Priorities as unsigned keys in the same order, negative ones included
+uint32_t radixKey(int priority) {
+    return (uint32_t)priority ^ 0x80000000u;
+}
+
+// 0 for the base priority, else 1 + the highest bit it differs in
+int radixBucket(uint32_t key, uint32_t base) {
+    return key == base ? 0 : 32 - __builtin_clz(key ^ base);
+}
+
+void radixInit(radixHeap *rh) {
+    memset(rh, 0, sizeof *rh);
+    rh->base = rh->last = radixKey(INT32_MIN);
+}
+
+void radixFree(radixHeap *rh) {
+    for(int b = 0; b < RADIX_BUCKETS; ++b)
+        free(rh->bucket[b].tasks);
+    radixInit(rh);
+}
+
+// Room for n tasks in the bucket, doubling its array as often as needed
+bool reserveBucket(taskBucket *bucket, int n) {
+    int capacity = bucket->capacity ? bucket->capacity : INITIAL_CAPACITY;
+    task *tasks;
+    if(n <= bucket->capacity)
+        return true;
+    while(capacity < n)
+        capacity *= 2;
+    tasks = realloc(bucket->tasks, capacity * sizeof *tasks);
+    if(tasks == NULL)
+        return false;
+    bucket->tasks = tasks;
+    bucket->capacity = capacity;
+    return true;
+}
+
+// False if t.priority is below the last priority polled, or out of memory
+bool radixAdd(radixHeap *rh, task t) {
+    uint32_t key = radixKey(t.priority);
+    taskBucket *bucket;
+    if(key < rh->last) // so key >= base too
+        return false;
+    bucket = &rh->bucket[radixBucket(key, rh->base)];
+    if(bucket->size == bucket->capacity && !reserveBucket(bucket, bucket->size + 1))
+        return false;
+    bucket->tasks[bucket->size++] = t;
+    rh->size++;
+    return true;
+}
+
+// Where the lowest task is: bucket 0 (refilled from the first bucket that
+// is not empty) or, if the buckets below could not grow for the refill,
+// that bucket. Every task of it agrees with its lowest priority above
+// the bit the bucket stands for, so each one lands in a lower bucket.
+task *radixLowest(radixHeap *rh, taskBucket **from) {
+    int b = 1, count[RADIX_BUCKETS] = { 0 }, low = 0;
+    taskBucket *src;
+    *from = &rh->bucket[0];
+    if(rh->bucket[0].size > 0)
+        return &rh->bucket[0].tasks[rh->bucket[0].size - 1];
+    while(rh->bucket[b].size == 0)
+        ++b;
+    src = &rh->bucket[b];
+    for(int i = 1; i < src->size; ++i)
+        if(radixKey(src->tasks[i].priority) < radixKey(src->tasks[low].priority))
+            low = i;
+    uint32_t key = radixKey(src->tasks[low].priority);
+    for(int i = 0; i < src->size; ++i)
+        count[radixBucket(radixKey(src->tasks[i].priority), key)]++;
+    for(int j = 0; j < b; ++j)
+        if(count[j] > 0 && !reserveBucket(&rh->bucket[j], rh->bucket[j].size + count[j])) {
+            *from = src;
+            return &src->tasks[low];
+        }
+    rh->base = key;
+    for(int i = 0; i < src->size; ++i) {
+        taskBucket *to = &rh->bucket[radixBucket(radixKey(src->tasks[i].priority), key)];
+        to->tasks[to->size++] = src->tasks[i];
+    }
+    src->size = 0;
+    return &rh->bucket[0].tasks[rh->bucket[0].size - 1];
+}
+
+// The heap must not be empty. Not const: it may move tasks between buckets
+task radixPeek(radixHeap *rh) {
+    taskBucket *from;
+    return *radixLowest(rh, &from);
+}
+
+// The heap must not be empty
+task radixPoll(radixHeap *rh) {
+    taskBucket *from;
+    task *lowest = radixLowest(rh, &from), t = *lowest;
+    *lowest = from->tasks[--from->size];
+    rh->last = radixKey(t.priority);
+    rh->size--;
+    return t;
+}
+
+// The next step of the push side of radixMain: 0 to 3 new tasks per pop,
+// each 1 to 1000 after the task popped, until n have been pushed
+typedef struct radixRun {
+    unsigned seed;
+    int pushed;
+    long long sum;
+    bool wrong;
+}radixRun;
+
+int radixFanout(radixRun *r, int n) {
+    r->seed ^= r->seed << 13;
+    r->seed ^= r->seed >> 17;
+    r->seed ^= r->seed << 5;
+    return r->pushed < n ? (int)(r->seed >> 30) : 0;
+}
+
+int radixStep(radixRun *r) {
+    r->seed ^= r->seed << 13;
+    r->seed ^= r->seed >> 17;
+    r->seed ^= r->seed << 5;
+    return 1 + (int)(r->seed % 1000);
+}
+
+// A Dijkstra-like run: every pop pushes a few tasks a little further
+// out, so the priorities polled never go down. The taskHeap does the
+// same with negated priorities. Both must pop the same priorities.
+int radixMain(int n) {
+    radixHeap rh;
+    taskHeap heap;
+    radixRun a = { 2463534242u, 0, 0, false }, b = a;
+    int last = 0;
+    double start, radixTime, heapTime;
+    radixInit(&rh);
+    if(!heapInit(&heap, HEAP_ARITY)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    start = seconds();
+    for(; a.pushed < 1000; ++a.pushed)
+        radixAdd(&rh, (task){ a.pushed, a.pushed });
+    while(rh.size > 0) {
+        task t = radixPoll(&rh);
+        a.wrong |= t.priority < last;
+        last = t.priority;
+        a.sum += t.priority;
+        for(int k = radixFanout(&a, n); k > 0; --k, ++a.pushed)
+            if(!radixAdd(&rh, (task){ a.pushed, t.priority + radixStep(&a) }))
+                a.wrong = true;
+    }
+    radixTime = seconds() - start;
+
+    start = seconds();
+    for(; b.pushed < 1000; ++b.pushed)
+        addTask(&heap, (task){ b.pushed, -b.pushed });
+    while(heap.size > 0) {
+        task t = poll(&heap);
+        b.sum -= t.priority;
+        for(int k = radixFanout(&b, n); k > 0; --k, ++b.pushed)
+            if(!addTask(&heap, (task){ b.pushed, t.priority - radixStep(&b) }))
+                b.wrong = true;
+    }
+    heapTime = seconds() - start;
+
+    printf("%d tasks pushed, monotone priorities\n", a.pushed);
+    printf("radix heap: %.3f s\n", radixTime);
+    printf("heap:       %.3f s\n", heapTime);
+    radixFree(&rh);
+    heapFree(&heap);
+    if(a.wrong || b.wrong || a.pushed != b.pushed || a.sum != b.sum) {
+        printf("Wrong: the radix heap popped out of order or the wrong tasks\n");
+        return 1;
+    }
+    return 0;
+}
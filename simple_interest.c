@@ -1,12 +1,13 @@
 //Program to Calculate Simple Interest
 #include<stdio.h>
 
-#include<conio.h>
+#include "Interest.h"
 
-void main() {
+int main() {
   float P, R, T, SI;
-  scanf("%f%f%f", & P, & R, & T);
-  SI = (P * R * T) / 100;
+  if (scanf("%f%f%f", & P, & R, & T) != 3)
+    return 1;
+  SI = (float)simpleInterest(P, R, T);
   printf("%f", SI);
-  getch();
+  return 0;
 }
@@ -28,9 +28,54 @@
       - Compute Longest Common Prefix (LCP) efficiently
 
     This program builds both:
-      ✅ Suffix Array  (in O(n log n))
+      ✅ Suffix Array  (in O(n log n), or O(n) with SA-IS)
       ✅ LCP Array     (in O(n))
       ✅ Allows Pattern Search using binary search.
+      ✅ Counts / locates every occurrence (LCP-LR binary search).
+      ✅ Optional BWT / FM-index backend for the same queries.
+      ✅ Saves / loads both arrays as a binary index file (mmap).
+      ✅ Indexes many documents at once and reports (doc, offset) hits
+         and which documents contain a pattern.
+
+    Two construction modes are available and give identical output:
+      - Prefix doubling (default)
+      - SA-IS induced sorting (run the program with --sais)
+
+    Options:
+      --sais            build with SA-IS
+      --save FILE       write the built index to FILE
+      --load FILE       query a saved index instead of building one
+      --input FILE      index the whole file ("-" = standard input)
+                        instead of one typed line
+      --docs FILE       index every line of FILE as a document of its
+                        own (one generalized suffix array, built with
+                        SA-IS; --sais / --parallel / --compact and the
+                        FM-index do not apply, nor --load / --save)
+      --pattern P       search for P instead of asking for a pattern
+      --top K           how many repeats to list (default 5)
+      --min-len L       shortest repeat length to list (default 2)
+      --batch FILE      also count every pattern in FILE (one per line)
+      --parallel        build SA and LCP on several threads
+      --fm              answer the searches with the FM-index backend
+      --compact         build only the 40-bit SA / byte LCP form
+                        (about 6 bytes per character instead of 8,
+                        texts above 2 GB, up to 1 TB) and answer the
+                        search, occurrences and --batch from it;
+                        always SA-IS, and --docs, --load, --save,
+                        --fm, --lz77 and --lce do not apply
+      --threads N       threads for --parallel and batched queries
+                        (--parallel alone uses all online CPUs)
+      --lz77            LZ77-factorize the text from the suffix array
+                        and report the phrases and container size
+      --lz77-save FILE  the same, and write the container to FILE
+      --lz77-unpack F   decompress container F to standard output
+                        (nothing is built)
+      --lce I J         length of the longest common prefix of the
+                        suffixes at positions I and J, in O(1) by a
+                        range minimum over the LCP array
+
+    Compile with:  gcc string_suffix_array_lcp_search.c -pthread
+    (add -DPROBE to time the build, LCP and search phases, Probe.h)
 
     ------------------------------------------------------------------------
     👶 Why it’s beginner-friendly
@@ -43,9 +88,14 @@
     ------------------------------------------------------------------------
     💡 Time Complexity
     ------------------------------------------------------------------------
-      Build Suffix Array : O(n log n)
+      Build Suffix Array : O(n log n)   (doubling)
+                           O(n)         (SA-IS)
       Build LCP Array    : O(n)
       Pattern Search     : O(m log n)
+      Count / Locate     : O(m + log n) (+ occ to list them)
+      LCE(i, j)          : O(1)          (after O(n) preprocessing)
+      LZ77 factorization : O(n)          (after the suffix array)
+      FM-index count     : O(m)          (locate: + sampleRate per hit)
 */
 
 #include <stdio.h>
@@ -54,6 +104,22 @@
 
 #include <string.h>
 
+#include <stdint.h>
+
+#include <fcntl.h>
+
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include <sys/stat.h>
+
+#include <pthread.h>
+
+#include "Probe.h"
+
+#include "AsyncRead.h"
+
 /* -------------------------------------------------------------------------
    STRUCTURE: represents one suffix during sorting.
    Each suffix has:
@@ -68,20 +134,49 @@ typedef struct {
 Suffix;
 
 /* -------------------------------------------------------------------------
-   Comparator for qsort().
-   Sorts suffixes by (rank[0], rank[1]).
+   Construction modes for buildSuffixArray().
+   Both produce exactly the same suffix array.
    ------------------------------------------------------------------------- */
-int cmpSuffix(const void * a,
-  const void * b) {
-  const Suffix * sa = (const Suffix * ) a;
-  const Suffix * sb = (const Suffix * ) b;
-  if (sa -> rank[0] == sb -> rank[0])
-    return sa -> rank[1] - sb -> rank[1];
-  return sa -> rank[0] - sb -> rank[0];
+typedef enum {
+  SA_BUILD_DOUBLING, // prefix doubling + radix sort, O(n log n)
+  SA_BUILD_SAIS, // induced sorting (Nong, Zhang & Chan), O(n)
+  SA_BUILD_PARALLEL // prefix doubling with multithreaded rounds
 }
+SABuildMode;
 
 /* -------------------------------------------------------------------------
-   FUNCTION: buildSuffixArray
+   FUNCTION: radixSortSuffixes
+   PURPOSE : Sorts suffixes by (rank[0], rank[1]) with two stable
+             counting-sort passes (LSD radix sort): first by rank[1],
+             then by rank[0]. No comparator calls are needed.
+             Ranks must lie in [-1, maxRank]; -1 means "past the end".
+   ------------------------------------------------------------------------- */
+void radixSortSuffixes(Suffix * suffixes, Suffix * tmp, int * count, int n,
+  int maxRank) {
+  int buckets = maxRank + 2; // one extra bucket for rank -1
+
+  for (int pass = 1; pass >= 0; pass--) {
+    memset(count, 0, buckets * sizeof(int));
+    for (int i = 0; i < n; i++)
+      count[suffixes[i].rank[pass] + 1]++;
+
+    // Turn counts into starting positions
+    int sum = 0;
+    for (int b = 0; b < buckets; b++) {
+      int c = count[b];
+      count[b] = sum;
+      sum += c;
+    }
+
+    // Stable scatter, then swap buffers back
+    for (int i = 0; i < n; i++)
+      tmp[count[suffixes[i].rank[pass] + 1]++] = suffixes[i];
+    memcpy(suffixes, tmp, n * sizeof(Suffix));
+  }
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildSuffixArrayDoubling
    PURPOSE : Constructs the suffix array in O(n log n) time.
 
    Steps:
@@ -89,24 +184,27 @@ int cmpSuffix(const void * a,
      2. Sort suffixes by these ranks.
      3. For k = 4, 8, 16, ... double the substring length each time:
          - Reassign new ranks based on previous sorting.
+         - Stop early once every rank is distinct.
          - Sort again using updated ranks.
+     Each sort is a linear-time radix sort, so one round costs O(n).
    ------------------------------------------------------------------------- */
-int * buildSuffixArray(const char * txt, int n) {
+int * buildSuffixArrayDoubling(const char * txt, int n) {
   // Allocate space for suffix structures
   Suffix * suffixes = malloc(n * sizeof(Suffix));
   int * ind = malloc(n * sizeof(int)); // maps index → suffix array position
+  Suffix * tmp = malloc(n * sizeof(Suffix)); // radix sort scratch buffer
+  int * count = malloc(((n > 256 ? n : 256) + 2) * sizeof(int));
 
   // Step 1: Initialize ranks for each suffix
   for (int i = 0; i < n; i++) {
     suffixes[i].index = i;
-    suffixes[i].rank[0] = txt[i]; // rank by first char
-    suffixes[i].rank[1] = (i + 1 < n) ? txt[i + 1] : -1; // next char
+    // characters are ranked as unsigned bytes, the same order strncmp uses
+    suffixes[i].rank[0] = (unsigned char) txt[i]; // rank by first char
+    suffixes[i].rank[1] = (i + 1 < n) ? (unsigned char) txt[i + 1] : -1;
   }
 
   // Step 2: Initial sort based on first 2 characters
-  qsort(suffixes, n, sizeof(Suffix), cmpSuffix);
-
-  int * suffixArr = malloc(n * sizeof(int));
+  radixSortSuffixes(suffixes, tmp, count, n, 255);
 
   // Step 3: Repeat sorting with doubled prefix length (k = 4, 8, 16…)
   for (int k = 4; k < 2 * n; k *= 2) {
@@ -129,6 +227,10 @@ int * buildSuffixArray(const char * txt, int n) {
       ind[suffixes[i].index] = i;
     }
 
+    // All ranks distinct → the order is already final
+    if (rank == n - 1)
+      break;
+
     // Assign next rank for each suffix
     for (int i = 0; i < n; i++) {
       int nextIndex = suffixes[i].index + k / 2;
@@ -137,145 +239,3236 @@ int * buildSuffixArray(const char * txt, int n) {
     }
 
     // Re-sort by first and next rank
-    qsort(suffixes, n, sizeof(Suffix), cmpSuffix);
+    radixSortSuffixes(suffixes, tmp, count, n, rank);
   }
 
-  // Extract final suffix array
+  free(tmp);
+  free(count);
+
+  // Extract final suffix array, reusing ind so that no extra n ints
+  // are allocated while the Suffix array is still alive
+  int * suffixArr = ind;
   for (int i = 0; i < n; i++)
     suffixArr[i] = suffixes[i].index;
 
   free(suffixes);
-  free(ind);
   return suffixArr;
 }
 
 /* -------------------------------------------------------------------------
-   FUNCTION: buildLCPArray
-   PURPOSE : Builds the LCP (Longest Common Prefix) array in O(n).
-   METHOD  : Kasai’s Algorithm
+   SA-IS helpers.
+   t[i] is the suffix type: 1 = S-type (smaller than the suffix after it),
+   0 = L-type (larger). Types are bit-packed, one bit per position.
+   An LMS position is an S-type position whose left neighbour is L-type.
+   ------------------------------------------------------------------------- */
+#define TYPE_GET(t, i) (((t)[(i) >> 3] >> ((i) & 7)) & 1)
+#define TYPE_SET_S(t, i) ((t)[(i) >> 3] |= (unsigned char)(1u << ((i) & 7)))
+#define IS_LMS(t, i) ((i) > 0 && TYPE_GET(t, i) && !TYPE_GET(t, (i) - 1))
 
-   Explanation:
-     - LCP[i] = length of longest common prefix between
-                suffixArr[i] and suffixArr[i+1].
-     - Uses the fact that LCP between neighbors differs by ≤1 each step.
+/* -------------------------------------------------------------------------
+   STRUCTURE: the string being sorted by SA-IS.
+   At the top level it reads the text bytes directly (shifted up by one)
+   and adds a virtual 0 sentinel at position n - 1, so no int copy of the
+   text is needed. Recursive levels read the reduced string of names.
    ------------------------------------------------------------------------- */
-int * buildLCPArray(const char * txt, int n, int * suffixArr) {
-  int * rank = malloc(n * sizeof(int));
-  int * lcp = malloc(n * sizeof(int));
+typedef struct {
+  const unsigned char * bytes; // top level, or NULL
+  const int * ints; // reduced string when bytes == NULL
+  int n;
+}
+SAISInput;
 
-  // Compute rank array → rank[i] gives position of suffix i in suffixArr
-  for (int i = 0; i < n; i++)
-    rank[suffixArr[i]] = i;
+static inline int symbolAt(const SAISInput * s, int i) {
+  if (s -> bytes != NULL)
+    return i == s -> n - 1 ? 0 : s -> bytes[i] + 1;
+  return s -> ints[i];
+}
 
-  int k = 0; // length of current LCP
+/* Computes bucket heads (end = 0) or bucket tails (end = 1) for alphabet K */
+static void getBuckets(const SAISInput * s, int K, int * bkt, int end) {
+  int sum = 0;
+  memset(bkt, 0, K * sizeof(int));
+  for (int i = 0; i < s -> n; i++)
+    bkt[symbolAt(s, i)]++;
+  for (int c = 0; c < K; c++) {
+    sum += bkt[c];
+    bkt[c] = end ? sum : sum - bkt[c];
+  }
+}
+
+/* Induces the order of L-type then S-type suffixes from the seeded ones */
+static void induceSort(const SAISInput * s, int * sa,
+  const unsigned char * t, int * bkt, int K) {
+  int n = s -> n;
+
+  // L-type: left to right, fill from the bucket heads
+  getBuckets(s, K, bkt, 0);
   for (int i = 0; i < n; i++) {
-    if (rank[i] == n - 1) { // last suffix has no next neighbor
-      k = 0;
-      continue;
+    int j = sa[i] - 1;
+    if (sa[i] > 0 && !TYPE_GET(t, j))
+      sa[bkt[symbolAt(s, j)]++] = j;
+  }
+
+  // S-type: right to left, fill from the bucket tails
+  getBuckets(s, K, bkt, 1);
+  for (int i = n - 1; i >= 0; i--) {
+    int j = sa[i] - 1;
+    if (sa[i] > 0 && TYPE_GET(t, j))
+      sa[--bkt[symbolAt(s, j)]] = j;
+  }
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: sais
+   PURPOSE : Sorts all suffixes of s (length n) into sa[] in O(n) time.
+             The last symbol must be a unique sentinel smaller than every
+             other symbol, and all symbols must lie in [0, K).
+
+   Steps:
+     1. Classify every position as S-type or L-type.
+     2. Place LMS positions at their bucket tails and induce-sort them;
+        this sorts all LMS substrings.
+     3. Name the LMS substrings. If two names collide, build the reduced
+        string of names and sort it recursively.
+     4. Put the LMS suffixes in their final order and induce once more.
+   ------------------------------------------------------------------------- */
+static void sais(const SAISInput * s, int * sa, int K) {
+  int n = s -> n;
+  unsigned char * t = calloc(n / 8 + 1, 1);
+  int * bkt = malloc(K * sizeof(int));
+
+  // Step 1: classify suffixes (the sentinel is S-type)
+  TYPE_SET_S(t, n - 1);
+  for (int i = n - 2; i >= 0; i--) {
+    int a = symbolAt(s, i), b = symbolAt(s, i + 1);
+    if (a < b || (a == b && TYPE_GET(t, i + 1)))
+      TYPE_SET_S(t, i);
+  }
+
+  // Step 2: sort LMS substrings
+  getBuckets(s, K, bkt, 1);
+  for (int i = 0; i < n; i++)
+    sa[i] = -1;
+  for (int i = 1; i < n; i++)
+    if (IS_LMS(t, i))
+      sa[--bkt[symbolAt(s, i)]] = i;
+  induceSort(s, sa, t, bkt, K);
+
+  // Compact the sorted LMS substrings into the first n1 slots
+  int n1 = 0;
+  for (int i = 0; i < n; i++)
+    if (IS_LMS(t, sa[i]))
+      sa[n1++] = sa[i];
+
+  // Step 3: name LMS substrings; equal substrings share a name
+  for (int i = n1; i < n; i++)
+    sa[i] = -1;
+  int name = 0, prev = -1;
+  for (int i = 0; i < n1; i++) {
+    int pos = sa[i], diff = 0;
+    for (int d = 0; d < n; d++) {
+      if (prev == -1 || symbolAt(s, pos + d) != symbolAt(s, prev + d) ||
+        TYPE_GET(t, pos + d) != TYPE_GET(t, prev + d)) {
+        diff = 1;
+        break;
+      } else if (d > 0 && (IS_LMS(t, pos + d) || IS_LMS(t, prev + d)))
+        break;
     }
-    int j = suffixArr[rank[i] + 1]; // index of next suffix
-    while (i + k < n && j + k < n && txt[i + k] == txt[j + k])
-      k++;
-    lcp[rank[i]] = k;
-    if (k > 0) k--; // LCP for next suffix will be ≥ (k - 1)
+    if (diff) {
+      name++;
+      prev = pos;
+    }
+    sa[n1 + pos / 2] = name - 1; // LMS positions are at least 2 apart
   }
+  for (int i = n - 1, j = n - 1; i >= n1; i--)
+    if (sa[i] >= 0)
+      sa[j--] = sa[i];
 
-  free(rank);
-  return lcp;
+  // Reduced string lives in the tail of sa, its suffix array in the head
+  int * s1 = sa + n - n1;
+  int * sa1 = sa;
+  if (name < n1) {
+    SAISInput reduced = {
+      NULL,
+      s1,
+      n1
+    };
+    sais( & reduced, sa1, name);
+  } else
+    for (int i = 0; i < n1; i++)
+      sa1[s1[i]] = i; // names are unique: order is known directly
+
+  // Step 4: seed the LMS suffixes in sorted order and induce
+  getBuckets(s, K, bkt, 1);
+  for (int i = 1, j = 0; i < n; i++)
+    if (IS_LMS(t, i))
+      s1[j++] = i; // s1[] now maps reduced index → text position
+  for (int i = 0; i < n1; i++)
+    sa1[i] = s1[sa1[i]];
+  for (int i = n1; i < n; i++)
+    sa[i] = -1;
+  for (int i = n1 - 1; i >= 0; i--) {
+    int j = sa[i];
+    sa[i] = -1;
+    sa[--bkt[symbolAt(s, j)]] = j;
+  }
+  induceSort(s, sa, t, bkt, K);
+
+  free(bkt);
+  free(t);
 }
 
 /* -------------------------------------------------------------------------
-   FUNCTION: searchPattern
-   PURPOSE : Uses binary search on suffix array to find a pattern.
-   Returns : Starting index of pattern if found, else -1.
-   Complexity: O(m log n)
+   FUNCTION: buildSuffixArraySAIS
+   PURPOSE : Constructs the suffix array in O(n) time with SA-IS.
+             The text is read in place, so the only large allocation is
+             the (n + 1)-entry result itself plus n / 8 bytes of types.
    ------------------------------------------------------------------------- */
-int searchPattern(const char * txt, int * suffixArr, int n,
-  const char * pat) {
-  int m = strlen(pat);
-  int low = 0, high = n - 1;
+int * buildSuffixArraySAIS(const char * txt, int n) {
+  int * sa = malloc((n + 1) * sizeof(int));
+  SAISInput s = {
+    (const unsigned char * ) txt,
+    NULL,
+    n + 1
+  };
+
+  sais( & s, sa, 257);
+
+  // sa[0] is always the sentinel; drop it
+  memmove(sa, sa + 1, n * sizeof(int));
+  int * suffixArr = realloc(sa, (n > 0 ? n : 1) * sizeof(int));
+  return suffixArr != NULL ? suffixArr : sa;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildSuffixArrayDocs
+   PURPOSE : Generalized suffix array of a corpus: docs documents, each
+             ended by a '\0' (see buildCorpus()). Every '\0' is sorted as
+             a separator of its own, the one of document d as symbol d + 1,
+             below every byte, which SA-IS takes as an integer alphabet of
+             docs + 257 symbols. So no suffix compares equal to another
+             past the end of its document, as with unique separators
+             $0 < $1 < ... between the documents.
+   ------------------------------------------------------------------------- */
+int * buildSuffixArrayDocs(const char * txt, int n, int docs) {
+  int * sym = malloc((n + 1) * sizeof(int));
+  int * sa = malloc((n + 1) * sizeof(int));
+  if (sym == NULL || sa == NULL) {
+    free(sym);
+    free(sa);
+    return NULL;
+  }
+  for (int i = 0, d = 0; i < n; i++)
+    sym[i] = txt[i] == '\0' ? 1 + d++ : docs + 1 + (unsigned char) txt[i];
+  sym[n] = 0;
+
+  SAISInput s = {
+    NULL,
+    sym,
+    n + 1
+  };
+  sais( & s, sa, docs + 257);
+  free(sym);
+
+  memmove(sa, sa + 1, n * sizeof(int));
+  int * suffixArr = realloc(sa, (n > 0 ? n : 1) * sizeof(int));
+  return suffixArr != NULL ? suffixArr : sa;
+}
+
+/* -------------------------------------------------------------------------
+   COMPACT FORM
+   An int suffix array stops at 2^31 characters. The builders below work
+   with 64-bit lengths and store the suffix array with 40-bit entries
+   (5 bytes, up to 1 TB of text) and the LCP array with one byte per
+   entry. LCP values of 255 or more are rare in real text; they go to a
+   small overflow table. --compact builds only these and answers the
+   queries from them (runCompact), so it also indexes texts too large
+   for the int arrays.
+   ------------------------------------------------------------------------- */
+#define SA40_BYTES 5
+#define SA40_NONE (((int64_t) 1 << 40) - 1) // "no suffix" marker
+
+typedef struct {
+  unsigned char * data; // n entries of SA40_BYTES little-endian bytes
+  int64_t n;
+}
+PackedSA;
+
+static inline int64_t sa40Get(const unsigned char * data, int64_t i) {
+  const unsigned char * p = data + i * SA40_BYTES;
+  return (int64_t) p[0] | (int64_t) p[1] << 8 | (int64_t) p[2] << 16 |
+    (int64_t) p[3] << 24 | (int64_t) p[4] << 32;
+}
+
+static inline void sa40Set(unsigned char * data, int64_t i, int64_t v) {
+  unsigned char * p = data + i * SA40_BYTES;
+  for (int b = 0; b < SA40_BYTES; b++)
+    p[b] = (unsigned char)(v >> (8 * b));
+}
+
+int64_t packedSAGet(const PackedSA * sa, int64_t i) {
+  return sa40Get(sa -> data, i);
+}
+
+void freePackedSA(PackedSA * sa) {
+  free(sa -> data);
+  sa -> data = NULL;
+  sa -> n = 0;
+}
+
+/* 64-bit counterpart of SAISInput */
+typedef struct {
+  const unsigned char * bytes;
+  const int64_t * ints;
+  int64_t n;
+}
+SAISInput64;
+
+static inline int64_t symbolAt64(const SAISInput64 * s, int64_t i) {
+  if (s -> bytes != NULL)
+    return i == s -> n - 1 ? 0 : s -> bytes[i] + 1;
+  return s -> ints[i];
+}
+
+static void getBuckets64(const SAISInput64 * s, int64_t K, int64_t * bkt,
+  int end) {
+  int64_t sum = 0;
+  memset(bkt, 0, K * sizeof(int64_t));
+  for (int64_t i = 0; i < s -> n; i++)
+    bkt[symbolAt64(s, i)]++;
+  for (int64_t c = 0; c < K; c++) {
+    sum += bkt[c];
+    bkt[c] = end ? sum : sum - bkt[c];
+  }
+}
+
+static void induceSort64(const SAISInput64 * s, int64_t * sa,
+  const unsigned char * t, int64_t * bkt, int64_t K) {
+  int64_t n = s -> n;
+  getBuckets64(s, K, bkt, 0);
+  for (int64_t i = 0; i < n; i++) {
+    int64_t j = sa[i] - 1;
+    if (sa[i] > 0 && !TYPE_GET(t, j))
+      sa[bkt[symbolAt64(s, j)]++] = j;
+  }
+  getBuckets64(s, K, bkt, 1);
+  for (int64_t i = n - 1; i >= 0; i--) {
+    int64_t j = sa[i] - 1;
+    if (sa[i] > 0 && TYPE_GET(t, j))
+      sa[--bkt[symbolAt64(s, j)]] = j;
+  }
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: sais64
+   PURPOSE : sais() with 64-bit positions. The steps are exactly the same;
+             see sais() for the explanation.
+   ------------------------------------------------------------------------- */
+static void sais64(const SAISInput64 * s, int64_t * sa, int64_t K) {
+  int64_t n = s -> n;
+  unsigned char * t = calloc(n / 8 + 1, 1);
+  int64_t * bkt = malloc(K * sizeof(int64_t));
+
+  TYPE_SET_S(t, n - 1);
+  for (int64_t i = n - 2; i >= 0; i--) {
+    int64_t a = symbolAt64(s, i), b = symbolAt64(s, i + 1);
+    if (a < b || (a == b && TYPE_GET(t, i + 1)))
+      TYPE_SET_S(t, i);
+  }
+
+  getBuckets64(s, K, bkt, 1);
+  for (int64_t i = 0; i < n; i++)
+    sa[i] = -1;
+  for (int64_t i = 1; i < n; i++)
+    if (IS_LMS(t, i))
+      sa[--bkt[symbolAt64(s, i)]] = i;
+  induceSort64(s, sa, t, bkt, K);
+
+  int64_t n1 = 0;
+  for (int64_t i = 0; i < n; i++)
+    if (IS_LMS(t, sa[i]))
+      sa[n1++] = sa[i];
+
+  for (int64_t i = n1; i < n; i++)
+    sa[i] = -1;
+  int64_t name = 0, prev = -1;
+  for (int64_t i = 0; i < n1; i++) {
+    int64_t pos = sa[i];
+    int diff = 0;
+    for (int64_t d = 0; d < n; d++) {
+      if (prev == -1 || symbolAt64(s, pos + d) != symbolAt64(s, prev + d) ||
+        TYPE_GET(t, pos + d) != TYPE_GET(t, prev + d)) {
+        diff = 1;
+        break;
+      } else if (d > 0 && (IS_LMS(t, pos + d) || IS_LMS(t, prev + d)))
+        break;
+    }
+    if (diff) {
+      name++;
+      prev = pos;
+    }
+    sa[n1 + pos / 2] = name - 1;
+  }
+  for (int64_t i = n - 1, j = n - 1; i >= n1; i--)
+    if (sa[i] >= 0)
+      sa[j--] = sa[i];
+
+  int64_t * s1 = sa + n - n1;
+  int64_t * sa1 = sa;
+  if (name < n1) {
+    SAISInput64 reduced = {
+      NULL,
+      s1,
+      n1
+    };
+    sais64( & reduced, sa1, name);
+  } else
+    for (int64_t i = 0; i < n1; i++)
+      sa1[s1[i]] = i;
+
+  getBuckets64(s, K, bkt, 1);
+  for (int64_t i = 1, j = 0; i < n; i++)
+    if (IS_LMS(t, i))
+      s1[j++] = i;
+  for (int64_t i = 0; i < n1; i++)
+    sa1[i] = s1[sa1[i]];
+  for (int64_t i = n1; i < n; i++)
+    sa[i] = -1;
+  for (int64_t i = n1 - 1; i >= 0; i--) {
+    int64_t j = sa[i];
+    sa[i] = -1;
+    sa[--bkt[symbolAt64(s, j)]] = j;
+  }
+  induceSort64(s, sa, t, bkt, K);
+
+  free(bkt);
+  free(t);
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildSuffixArray40
+   PURPOSE : Builds the suffix array of a text of any size up to 2^40
+             and stores it with 5-byte entries.
+             The 8-byte work array is packed in place when sorting is
+             done (entry i moves from byte 8(i+1) down to byte 5i, which
+             never overwrites an entry not yet read), then shrunk.
+   ------------------------------------------------------------------------- */
+PackedSA buildSuffixArray40(const char * txt, int64_t n) {
+  PackedSA out = {
+    NULL,
+    n
+  };
+  int64_t * sa = malloc((n + 1) * sizeof(int64_t));
+  if (sa == NULL)
+    return out;
+
+  SAISInput64 s = {
+    (const unsigned char * ) txt,
+    NULL,
+    n + 1
+  };
+  sais64( & s, sa, 257);
+
+  unsigned char * bytes = (unsigned char * ) sa;
+  for (int64_t i = 0; i < n; i++)
+    sa40Set(bytes, i, sa[i + 1]); // skip the sentinel at sa[0]
+
+  unsigned char * shrunk = realloc(bytes, (n > 0 ? n : 1) * SA40_BYTES);
+  out.data = shrunk != NULL ? shrunk : bytes;
+  return out;
+}
+
+/* -------------------------------------------------------------------------
+   STRUCTURE: byte-per-entry LCP array.
+   small[i] holds lcp[i] when it is below 255. Otherwise small[i] is 255
+   and the value is found in the overflow table, which is sorted by
+   position so lookups use binary search.
+   ------------------------------------------------------------------------- */
+#define LCP_ESCAPE 255
+
+typedef struct {
+  unsigned char * small;
+  int64_t n;
+  int64_t * bigPos;
+  int64_t * bigVal;
+  int64_t bigCount, bigCap;
+}
+ByteLCP;
+
+static void byteLcpPut(ByteLCP * l, int64_t i, int64_t v) {
+  if (v < LCP_ESCAPE) {
+    l -> small[i] = (unsigned char) v;
+    return;
+  }
+  l -> small[i] = LCP_ESCAPE;
+  if (l -> bigCount == l -> bigCap) {
+    l -> bigCap = l -> bigCap ? 2 * l -> bigCap : 64;
+    l -> bigPos = realloc(l -> bigPos, l -> bigCap * sizeof(int64_t));
+    l -> bigVal = realloc(l -> bigVal, l -> bigCap * sizeof(int64_t));
+  }
+  l -> bigPos[l -> bigCount] = i; // positions arrive in increasing order
+  l -> bigVal[l -> bigCount++] = v;
+}
+
+int64_t byteLcpGet(const ByteLCP * l, int64_t i) {
+  if (l -> small[i] < LCP_ESCAPE)
+    return l -> small[i];
+  int64_t lo = 0, hi = l -> bigCount - 1;
+  while (lo < hi) {
+    int64_t mid = lo + (hi - lo) / 2;
+    if (l -> bigPos[mid] < i)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return l -> bigVal[lo];
+}
+
+void freeByteLCP(ByteLCP * l) {
+  free(l -> small);
+  free(l -> bigPos);
+  free(l -> bigVal);
+  memset(l, 0, sizeof( * l));
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildLCP40
+   PURPOSE : Builds the byte-per-entry LCP array for a 40-bit suffix array
+             with the Φ algorithm (see buildLCPArrayParallel). phi and
+             then PLCP share one 5-byte-per-entry work array, so the
+             build needs about 11 bytes per character including the SA.
+   ------------------------------------------------------------------------- */
+ByteLCP buildLCP40(const char * txt,
+  const PackedSA * sa) {
+  int64_t n = sa -> n;
+  ByteLCP l;
+  memset( & l, 0, sizeof(l));
+  l.n = n;
+  l.small = malloc(n > 0 ? n : 1);
+  unsigned char * phi = malloc((n > 0 ? n : 1) * SA40_BYTES);
+  if (l.small == NULL || phi == NULL) { // l.small == NULL tells the caller
+    free(phi);
+    freeByteLCP( & l);
+    return l;
+  }
+
+  for (int64_t i = 0; i < n; i++)
+    sa40Set(phi, sa40Get(sa -> data, i),
+      i + 1 < n ? sa40Get(sa -> data, i + 1) : SA40_NONE);
+
+  int64_t h = 0;
+  for (int64_t i = 0; i < n; i++) {
+    int64_t j = sa40Get(phi, i);
+    if (j == SA40_NONE) {
+      sa40Set(phi, i, 0);
+      h = 0;
+      continue;
+    }
+    while (i + h < n && j + h < n && txt[i + h] == txt[j + h])
+      h++;
+    sa40Set(phi, i, h); // phi[i] now holds PLCP[i]
+    if (h > 0) h--;
+  }
+
+  for (int64_t i = 0; i < n; i++)
+    byteLcpPut( & l, i, sa40Get(phi, sa40Get(sa -> data, i)));
+
+  free(phi);
+  return l;
+}
+
+/* searchPattern() for the compact form: one match, or -1 */
+int64_t searchPattern40(const char * txt,
+  const PackedSA * sa,
+    const char * pat) {
+  size_t m = strlen(pat);
+  int64_t low = 0, high = sa -> n - 1;
 
   while (low <= high) {
-    int mid = (low + high) / 2;
-    int res = strncmp(pat, txt + suffixArr[mid], m);
+    int64_t mid = low + (high - low) / 2;
+    int64_t p = sa40Get(sa -> data, mid);
+    int res = strncmp(pat, txt + p, m);
     if (res == 0)
-      return suffixArr[mid]; // match found
+      return p;
     if (res < 0)
       high = mid - 1;
     else
       low = mid + 1;
   }
-  return -1; // not found
+  return -1;
+}
+
+static int cmpInt64(const void * a,
+  const void * b) {
+  int64_t x = * (const int64_t * ) a, y = * (const int64_t * ) b;
+  return (x > y) - (x < y);
 }
 
 /* -------------------------------------------------------------------------
-   MAIN PROGRAM
+   FUNCTION: boundSearch40
+   PURPOSE : boundSearch() on a 40-bit suffix array. There is no LCP-LR
+             array here; the comparison starts after the prefix pat is
+             known to share with both SA[L] and SA[R] (the smaller of
+             l and r), which skips most of the rescanning in practice.
    ------------------------------------------------------------------------- */
-int main() {
-  char txt[1000];
-  printf("Enter text: ");
-  scanf("%s", txt);
+static int64_t boundSearch40(const char * txt,
+  const PackedSA * sa,
+    const char * pat, int64_t m, int upper) {
+  int64_t n = sa -> n;
+  int64_t L = -1, R = n;
+  int64_t l = 0, r = 0;
 
-  int n = strlen(txt);
+  while (R - L > 1) {
+    int64_t M = L + (R - L) / 2;
+    int64_t k = l < r ? l : r;
+    int64_t start = sa40Get(sa -> data, M);
+    const char * suf = txt + start;
+    int64_t sufLen = n - start;
+    while (k < m && k < sufLen && pat[k] == suf[k])
+      k++;
 
-  // --- Step 1: Build Suffix Array ---
-  int * suffixArr = buildSuffixArray(txt, n);
+    int goRight;
+    if (k == m)
+      goRight = upper; // suffix starts with pat
+    else if (k == sufLen)
+      goRight = 1; // suffix is a proper prefix of pat
+    else
+      goRight = (unsigned char) pat[k] > (unsigned char) suf[k];
 
-  // --- Step 2: Build LCP Array ---
-  int * lcp = buildLCPArray(txt, n, suffixArr);
+    if (goRight) {
+      L = M;
+      l = k;
+    } else {
+      R = M;
+      r = k;
+    }
+  }
+  return R;
+}
 
-  // --- Display Suffix Array ---
-  printf("\n--- Suffix Array ---\n");
-  for (int i = 0; i < n; i++)
-    printf("%2d : %s\n", suffixArr[i], txt + suffixArr[i]);
+/* findInterval() for the compact form; returns hi - lo */
+int64_t findInterval40(const char * txt,
+  const PackedSA * sa,
+    const char * pat, int64_t * lo, int64_t * hi) {
+  int64_t m = strlen(pat);
+  * lo = boundSearch40(txt, sa, pat, m, 0);
+  * hi = boundSearch40(txt, sa, pat, m, 1);
+  return * hi - * lo;
+}
 
-  // --- Display LCP Array ---
-  printf("\n--- LCP Array ---\n");
-  for (int i = 0; i < n - 1; i++)
-    printf("lcp[%2d] = %d\n", i, lcp[i]);
+/* longestRepeat() for the compact form */
+int64_t longestRepeat40(const PackedSA * sa,
+  const ByteLCP * l, int64_t * pos) {
+  int64_t best = 0;
+  * pos = -1;
+  for (int64_t i = 0; i + 1 < sa -> n; i++) {
+    if (l -> small[i] < LCP_ESCAPE && l -> small[i] <= best)
+      continue; // most entries: no lookup needed
+    int64_t v = byteLcpGet(l, i);
+    if (v > best) {
+      best = v;
+      * pos = sa40Get(sa -> data, i);
+    }
+  }
+  return best;
+}
 
-  // --- Step 3: Pattern Search Demo ---
-  char pat[100];
-  printf("\nEnter pattern to search: ");
-  scanf("%s", pat);
+/* -------------------------------------------------------------------------
+   PARALLEL CONSTRUCTION
+   parallelFor() splits [0, n) into one fixed chunk per thread and runs fn
+   on every chunk. Chunk boundaries depend only on n and the thread count,
+   and no phase lets two threads write the same element, so the parallel
+   builders produce exactly the same arrays as the serial ones.
+   ------------------------------------------------------------------------- */
+typedef void( * RangeFn)(void * ctx, int t, int begin, int end);
 
-  int pos = searchPattern(txt, suffixArr, n, pat);
-  if (pos != -1)
-    printf("✅ Pattern found at index %d\n", pos);
-  else
-    printf("❌ Pattern not found\n");
+typedef struct {
+  RangeFn fn;
+  void * ctx;
+  int t, begin, end;
+}
+RangeTask;
+
+static void * runRangeTask(void * arg) {
+  RangeTask * task = arg;
+  task -> fn(task -> ctx, task -> t, task -> begin, task -> end);
+  return NULL;
+}
 
-  // Free allocated memory
-  free(suffixArr);
-  free(lcp);
+static void parallelFor(int n, int threads, RangeFn fn, void * ctx) {
+  RangeTask tasks[threads];
+  pthread_t tids[threads];
+  int started[threads];
 
-  return 0;
+  for (int t = 0; t < threads; t++) {
+    tasks[t].fn = fn;
+    tasks[t].ctx = ctx;
+    tasks[t].t = t;
+    tasks[t].begin = (int)((long long) n * t / threads);
+    tasks[t].end = (int)((long long) n * (t + 1) / threads);
+    started[t] = t > 0 &&
+      pthread_create( & tids[t], NULL, runRangeTask, & tasks[t]) == 0;
+  }
+  runRangeTask( & tasks[0]);
+  for (int t = 1; t < threads; t++) {
+    if (started[t])
+      pthread_join(tids[t], NULL);
+    else
+      runRangeTask( & tasks[t]); // no thread available: run inline
+  }
 }
 
-/*
-   -------------------------------------------------------------------------
-   🧩 Example Run
-   -------------------------------------------------------------------------
-   Input:
-       text = banana
-       pattern = ana
+#define RADIX_BITS 16
+#define RADIX_BUCKETS (1 << RADIX_BITS)
 
-   Output:
-       --- Suffix Array ---
-        5 : a
-        3 : ana
-        1 : anana
-        0 : banana
-        4 : na
-        2 : nana
+/* Shared state of one parallel doubling build */
+typedef struct {
+  const char * txt;
+  Suffix * src, * dst;
+  int * ind; // index → SA position
+  int * newRank; // per position: rank flag, then the new rank
+  int * hist; // threads × RADIX_BUCKETS counters / offsets
+  int * chunkSum; // per-thread totals for the prefix sum
+  int pass, shift; // radix digit being sorted
+  int half; // k / 2 of the current round
+  int n;
+}
+ParallelSA;
 
-       --- LCP Array ---
-       lcp[0] = 1
-       lcp[1] = 3
-       lcp[2] = 0
-       lcp[3] = 0
-       lcp[4] = 2
+static int radixDigit(const ParallelSA * p,
+  const Suffix * suf) {
+  return ((unsigned)(suf -> rank[p -> pass] + 1) >> p -> shift) &
+    (RADIX_BUCKETS - 1);
+}
+
+static void radixCount(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  int * h = p -> hist + (size_t) t * RADIX_BUCKETS;
+  memset(h, 0, RADIX_BUCKETS * sizeof(int));
+  for (int i = begin; i < end; i++)
+    h[radixDigit(p, & p -> src[i])]++;
+}
+
+static void radixScatter(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  int * h = p -> hist + (size_t) t * RADIX_BUCKETS;
+  for (int i = begin; i < end; i++)
+    p -> dst[h[radixDigit(p, & p -> src[i])]++] = p -> src[i];
+}
+
+/* One stable counting pass on a 16-bit digit of rank[pass] */
+static void parallelRadixPass(ParallelSA * p, int threads) {
+  parallelFor(p -> n, threads, radixCount, p);
+
+  // Bucket-major, thread-minor offsets keep the pass stable
+  int sum = 0;
+  for (int b = 0; b < RADIX_BUCKETS; b++)
+    for (int t = 0; t < threads; t++) {
+      int * h = p -> hist + (size_t) t * RADIX_BUCKETS + b;
+      int c = * h;
+      * h = sum;
+      sum += c;
+    }
+
+  parallelFor(p -> n, threads, radixScatter, p);
+  Suffix * swap = p -> src;
+  p -> src = p -> dst;
+  p -> dst = swap;
+}
+
+/* Sorts by (rank[0], rank[1]) with ranks in [-1, maxRank] */
+static void parallelRadixSort(ParallelSA * p, int threads, int maxRank) {
+  for (p -> pass = 1; p -> pass >= 0; p -> pass--)
+    for (p -> shift = 0; p -> shift < 32; p -> shift += RADIX_BITS) {
+      if (p -> shift > 0 && ((unsigned)(maxRank + 1) >> p -> shift) == 0)
+        break; // higher digits are all zero
+      parallelRadixPass(p, threads);
+    }
+}
+
+/* Marks each position whose rank pair differs from its predecessor */
+static void rankFlags(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  int sum = 0;
+  (void) t;
+  for (int i = begin; i < end; i++) {
+    int f = i > 0 && (p -> src[i].rank[0] != p -> src[i - 1].rank[0] ||
+      p -> src[i].rank[1] != p -> src[i - 1].rank[1]);
+    p -> newRank[i] = f;
+    sum += f;
+  }
+  p -> chunkSum[t] = sum;
+}
+
+/* Turns the flags into ranks (prefix sum) and stores them */
+static void rankAssign(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  int rank = p -> chunkSum[t]; // exclusive prefix of earlier chunks
+  for (int i = begin; i < end; i++) {
+    rank += p -> newRank[i];
+    p -> src[i].rank[0] = rank;
+    p -> ind[p -> src[i].index] = i;
+  }
+}
+
+static void nextRanks(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  (void) t;
+  for (int i = begin; i < end; i++) {
+    int nextIndex = p -> src[i].index + p -> half;
+    p -> src[i].rank[1] = (nextIndex < p -> n) ?
+      p -> src[p -> ind[nextIndex]].rank[0] : -1;
+  }
+}
+
+static void initRanks(void * ctx, int t, int begin, int end) {
+  ParallelSA * p = ctx;
+  const unsigned char * txt = (const unsigned char * ) p -> txt;
+  (void) t;
+  for (int i = begin; i < end; i++) {
+    p -> src[i].index = i;
+    p -> src[i].rank[0] = txt[i];
+    p -> src[i].rank[1] = (i + 1 < p -> n) ? txt[i + 1] : -1;
+  }
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildSuffixArrayParallel
+   PURPOSE : Prefix doubling like buildSuffixArrayDoubling(), but every
+             phase of a round (radix counting and scatter, re-ranking via
+             a parallel prefix sum, next-rank lookup) runs on `threads`
+             threads. The output is identical to the serial builders.
+   ------------------------------------------------------------------------- */
+int * buildSuffixArrayParallel(const char * txt, int n, int threads) {
+  if (threads < 1)
+    threads = 1;
+
+  ParallelSA p;
+  p.txt = txt;
+  p.n = n;
+  p.src = malloc((n > 0 ? n : 1) * sizeof(Suffix));
+  p.dst = malloc((n > 0 ? n : 1) * sizeof(Suffix));
+  p.ind = malloc((n > 0 ? n : 1) * sizeof(int));
+  p.newRank = malloc((n > 0 ? n : 1) * sizeof(int));
+  p.hist = malloc((size_t) threads * RADIX_BUCKETS * sizeof(int));
+  p.chunkSum = malloc(threads * sizeof(int));
+
+  // Step 1: initial ranks from the first two characters
+  parallelFor(n, threads, initRanks, & p);
+
+  // Step 2: initial sort
+  parallelRadixSort( & p, threads, 255);
+
+  // Step 3: doubling rounds
+  for (int k = 4; k < 2 * n; k *= 2) {
+    parallelFor(n, threads, rankFlags, & p);
+    int sum = 0;
+    for (int t = 0; t < threads; t++) {
+      int c = p.chunkSum[t];
+      p.chunkSum[t] = sum;
+      sum += c;
+    }
+    parallelFor(n, threads, rankAssign, & p);
+
+    if (sum == n - 1) // all ranks distinct
+      break;
+
+    p.half = k / 2;
+    parallelFor(n, threads, nextRanks, & p);
+    parallelRadixSort( & p, threads, sum);
+  }
+
+  int * suffixArr = malloc((n > 0 ? n : 1) * sizeof(int));
+  for (int i = 0; i < n; i++)
+    suffixArr[i] = p.src[i].index;
+
+  free(p.src);
+  free(p.dst);
+  free(p.ind);
+  free(p.newRank);
+  free(p.hist);
+  free(p.chunkSum);
+  return suffixArr;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildSuffixArray
+   PURPOSE : Builds the suffix array with the selected construction mode.
+             threads is only used by SA_BUILD_PARALLEL.
+   ------------------------------------------------------------------------- */
+int * buildSuffixArray(const char * txt, int n, SABuildMode mode,
+  int threads) {
+  PROBE_SCOPE("buildSuffixArray");
+  if (mode == SA_BUILD_SAIS)
+    return buildSuffixArraySAIS(txt, n);
+  if (mode == SA_BUILD_PARALLEL)
+    return buildSuffixArrayParallel(txt, n, threads);
+  return buildSuffixArrayDoubling(txt, n);
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildLCPArray
+   PURPOSE : Builds the LCP (Longest Common Prefix) array in O(n).
+   METHOD  : Kasai’s Algorithm
+
+   Explanation:
+     - LCP[i] = length of longest common prefix between
+                suffixArr[i] and suffixArr[i+1].
+     - Uses the fact that LCP between neighbors differs by ≤1 each step.
+   ------------------------------------------------------------------------- */
+int * buildLCPArray(const char * txt, int n, const int * suffixArr) {
+  PROBE_SCOPE("buildLCPArray");
+  int * rank = malloc(n * sizeof(int));
+  int * lcp = malloc(n * sizeof(int));
+
+  // Compute rank array → rank[i] gives position of suffix i in suffixArr
+  for (int i = 0; i < n; i++)
+    rank[suffixArr[i]] = i;
+
+  int k = 0; // length of current LCP
+  for (int i = 0; i < n; i++) {
+    if (rank[i] == n - 1) { // last suffix has no next neighbor
+      lcp[n - 1] = 0;
+      k = 0;
+      continue;
+    }
+    int j = suffixArr[rank[i] + 1]; // index of next suffix
+    while (i + k < n && j + k < n && txt[i + k] == txt[j + k])
+      k++;
+    lcp[rank[i]] = k;
+    if (k > 0) k--; // LCP for next suffix will be ≥ (k - 1)
+  }
+
+  free(rank);
+  return lcp;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildLCPArrayParallel
+   PURPOSE : Same result as buildLCPArray(), computed on several threads.
+   METHOD  : Φ algorithm (Kärkkäinen, Manzini & Puglisi)
+
+   Explanation:
+     - phi[j] = the suffix that follows suffix j in suffixArr.
+     - PLCP[j] = LCP(j, phi[j]) satisfies PLCP[j + 1] ≥ PLCP[j] - 1,
+       so each thread scans its own range of text positions in order,
+       restarting the running length at 0 at its chunk start.
+     - Finally lcp[i] = PLCP[suffixArr[i]].
+   PLCP overwrites phi in place, so only one extra array is needed.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  const char * txt;
+  const int * suffixArr;
+  int * phi;
+  int * lcp;
+  int n;
+}
+ParallelLCP;
+
+static void phiFill(void * ctx, int t, int begin, int end) {
+  ParallelLCP * p = ctx;
+  (void) t;
+  for (int i = begin; i < end; i++)
+    p -> phi[p -> suffixArr[i]] = (i + 1 < p -> n) ? p -> suffixArr[i + 1] :
+    -1;
+}
+
+static void plcpFill(void * ctx, int t, int begin, int end) {
+  ParallelLCP * p = ctx;
+  int h = 0;
+  (void) t;
+  for (int i = begin; i < end; i++) {
+    int j = p -> phi[i];
+    if (j < 0) { // last suffix in sorted order
+      p -> phi[i] = 0;
+      h = 0;
+      continue;
+    }
+    while (i + h < p -> n && j + h < p -> n && p -> txt[i + h] == p -> txt[j + h])
+      h++;
+    p -> phi[i] = h; // phi[i] now holds PLCP[i]
+    if (h > 0) h--;
+  }
+}
+
+static void lcpPermute(void * ctx, int t, int begin, int end) {
+  ParallelLCP * p = ctx;
+  (void) t;
+  for (int i = begin; i < end; i++)
+    p -> lcp[i] = p -> phi[p -> suffixArr[i]];
+}
+
+int * buildLCPArrayParallel(const char * txt, int n,
+  const int * suffixArr, int threads) {
+  PROBE_SCOPE("buildLCPArrayParallel");
+  if (threads < 1)
+    threads = 1;
+
+  ParallelLCP p;
+  p.txt = txt;
+  p.suffixArr = suffixArr;
+  p.n = n;
+  p.phi = malloc((n > 0 ? n : 1) * sizeof(int));
+  p.lcp = malloc((n > 0 ? n : 1) * sizeof(int));
+
+  parallelFor(n, threads, phiFill, & p);
+  parallelFor(n, threads, plcpFill, & p);
+  parallelFor(n, threads, lcpPermute, & p);
+
+  free(p.phi);
+  return p.lcp;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildLCPArrayDocs
+   PURPOSE : Kasai's algorithm for the generalized suffix array: the same
+             as buildLCPArray(), except that a '\0' matches nothing, since
+             every separator is a symbol of its own. A common prefix then
+             never runs from one document into the next, so the repeats
+             found from it are repeats within documents.
+   ------------------------------------------------------------------------- */
+int * buildLCPArrayDocs(const char * txt, int n, const int * suffixArr) {
+  PROBE_SCOPE("buildLCPArrayDocs");
+  int * rank = malloc((n > 0 ? n : 1) * sizeof(int));
+  int * lcp = malloc((n > 0 ? n : 1) * sizeof(int));
+
+  for (int i = 0; i < n; i++)
+    rank[suffixArr[i]] = i;
+
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    if (rank[i] == n - 1) {
+      lcp[n - 1] = 0;
+      k = 0;
+      continue;
+    }
+    int j = suffixArr[rank[i] + 1];
+    while (i + k < n && j + k < n && txt[i + k] == txt[j + k] &&
+      txt[i + k] != '\0')
+      k++;
+    lcp[rank[i]] = k;
+    if (k > 0) k--;
+  }
+
+  free(rank);
+  return lcp;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: searchPattern
+   PURPOSE : Uses binary search on suffix array to find a pattern.
+   Returns : Starting index of pattern if found, else -1.
+   Complexity: O(m log n)
+   ------------------------------------------------------------------------- */
+int searchPattern(const char * txt, const int * suffixArr, int n,
+  const char * pat) {
+  PROBE_SCOPE("searchPattern");
+  int m = strlen(pat);
+  int low = 0, high = n - 1;
+
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    int res = strncmp(pat, txt + suffixArr[mid], m);
+    if (res == 0)
+      return suffixArr[mid]; // match found
+    if (res < 0)
+      high = mid - 1;
+    else
+      low = mid + 1;
+  }
+  return -1; // not found
+}
+
+/* -------------------------------------------------------------------------
+   STRUCTURE: LCP-LR tables for accelerated binary search.
+   The binary search over the suffix array always visits the same tree of
+   (L, M, R) triples, and every M is the midpoint of exactly one of them.
+   For that M we store:
+     - left[M]  = LCP of suffixes SA[L] and SA[M]
+     - right[M] = LCP of suffixes SA[M] and SA[R]
+   L = -1 and R = n are virtual sentinels with LCP 0.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  int * left;
+  int * right;
+}
+LCPLR;
+
+/* Fills the tables for the search interval (L, R).
+   Returns LCP(SA[L], SA[R]) = min(lcp[L..R-1]). */
+static int fillLCPLR(const int * lcp, int n, LCPLR * lr, int L, int R) {
+  if (R - L <= 1)
+    return (L < 0 || R >= n) ? 0 : lcp[L];
+
+  int M = L + (R - L) / 2;
+  int a = fillLCPLR(lcp, n, lr, L, M);
+  int b = fillLCPLR(lcp, n, lr, M, R);
+  lr -> left[M] = a;
+  lr -> right[M] = b;
+
+  if (L < 0 || R >= n)
+    return 0;
+  return a < b ? a : b;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildLCPLR
+   PURPOSE : Derives the LCP-LR tables from the LCP array in O(n).
+   ------------------------------------------------------------------------- */
+LCPLR buildLCPLR(const int * lcp, int n) {
+  LCPLR lr;
+  lr.left = malloc((n > 0 ? n : 1) * sizeof(int));
+  lr.right = malloc((n > 0 ? n : 1) * sizeof(int));
+  fillLCPLR(lcp, n, & lr, -1, n);
+  return lr;
+}
+
+void freeLCPLR(LCPLR * lr) {
+  free(lr -> left);
+  free(lr -> right);
+  lr -> left = lr -> right = NULL;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: boundSearch
+   PURPOSE : Binary search for the first suffix that is
+               - not smaller than pat            (upper = 0, lower bound)
+               - greater and not prefixed by pat (upper = 1, upper bound)
+
+   l and r are the number of characters pat shares with SA[L] and SA[R].
+   Comparing the larger of them with the stored LCP-LR value tells us the
+   answer for SA[M] without touching the text, unless they are equal; then
+   the comparison resumes at that offset instead of at 0. Every character
+   of pat is matched at most once, so a search costs O(m + log n).
+   ------------------------------------------------------------------------- */
+static int boundSearch(const char * txt,
+  const int * suffixArr, int n,
+    const LCPLR * lr,
+      const char * pat, int m, int upper) {
+  int L = -1, R = n;
+  int l = 0, r = 0;
+
+  while (R - L > 1) {
+    int M = L + (R - L) / 2;
+    int k;
+
+    if (l >= r) {
+      int x = lr -> left[M];
+      if (x > l) { // SA[M] behaves like SA[L]
+        L = M;
+        continue;
+      }
+      if (x < l) { // SA[M] is larger than pat at offset x
+        R = M;
+        r = x;
+        continue;
+      }
+      k = l;
+    } else {
+      int x = lr -> right[M];
+      if (x > r) { // SA[M] behaves like SA[R]
+        R = M;
+        continue;
+      }
+      if (x < r) { // SA[M] is smaller than pat at offset x
+        L = M;
+        l = x;
+        continue;
+      }
+      k = r;
+    }
+
+    // Compare the remaining characters directly
+    const char * suf = txt + suffixArr[M];
+    int sufLen = n - suffixArr[M];
+    while (k < m && k < sufLen && pat[k] == suf[k])
+      k++;
+
+    int goRight;
+    if (k == m)
+      goRight = upper; // suffix starts with pat
+    else if (k == sufLen)
+      goRight = 1; // suffix is a proper prefix of pat
+    else
+      goRight = (unsigned char) pat[k] > (unsigned char) suf[k];
+
+    if (goRight) {
+      L = M;
+      l = k;
+    } else {
+      R = M;
+      r = k;
+    }
+  }
+  return R;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: findInterval
+   PURPOSE : Finds the suffix array interval [lo, hi) of all suffixes that
+             start with pat. Every SA entry in it is one occurrence.
+   Returns : Number of occurrences (hi - lo).
+   ------------------------------------------------------------------------- */
+int findInterval(const char * txt,
+  const int * suffixArr, int n,
+    const LCPLR * lr,
+      const char * pat, int * lo, int * hi) {
+  int m = strlen(pat);
+  * lo = boundSearch(txt, suffixArr, n, lr, pat, m, 0);
+  * hi = boundSearch(txt, suffixArr, n, lr, pat, m, 1);
+  return * hi - * lo;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: countPattern
+   PURPOSE : Counts all occurrences of pat in O(m + log n).
+   ------------------------------------------------------------------------- */
+int countPattern(const char * txt,
+  const int * suffixArr, int n,
+    const LCPLR * lr,
+      const char * pat) {
+  int lo, hi;
+  return findInterval(txt, suffixArr, n, lr, pat, & lo, & hi);
+}
+
+static int cmpInt(const void * a,
+  const void * b) {
+  int x = * (const int * ) a, y = * (const int * ) b;
+  return (x > y) - (x < y);
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: locateAll
+   PURPOSE : Returns every starting index of pat, in increasing order.
+             *count receives the number of occurrences. The array is
+             malloc'ed and must be freed by the caller (NULL if none).
+   ------------------------------------------------------------------------- */
+int * locateAll(const char * txt,
+  const int * suffixArr, int n,
+    const LCPLR * lr,
+      const char * pat, int * count) {
+  int lo, hi;
+  * count = findInterval(txt, suffixArr, n, lr, pat, & lo, & hi);
+  if ( * count == 0)
+    return NULL;
+
+  int * pos = malloc( * count * sizeof(int));
+  memcpy(pos, suffixArr + lo, * count * sizeof(int));
+  qsort(pos, * count, sizeof(int), cmpInt);
+  return pos;
+}
+
+/* -------------------------------------------------------------------------
+   BATCHED QUERIES
+   For many patterns at once we sort the patterns first. In sorted order
+   both bounds of pattern i are at or after the lower bound of pattern
+   i - 1, so each search gallops forward from the previous lower bound
+   instead of starting over. Nearby patterns then touch nearby parts of
+   the suffix array, which turns random probes into mostly sequential
+   access. The sorted patterns can be split into shards, one per thread.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  int lo; // first SA position whose suffix starts with the pattern
+  int hi; // one past the last such position
+}
+SAInterval;
+
+typedef struct {
+  const char * pat;
+  int id; // position in the caller's array
+}
+BatchPattern;
+
+static int cmpBatchPattern(const void * a,
+  const void * b) {
+  return strcmp(((const BatchPattern * ) a) -> pat,
+    ((const BatchPattern * ) b) -> pat);
+}
+
+/* Compares pat with the suffix at SA position M, resuming at offset *k.
+   Returns 1 if the search must continue to the right of M. */
+static int goesRight(const char * txt,
+  const int * suffixArr, int n, int M,
+    const char * pat, int m, int upper, int * k) {
+  const char * suf = txt + suffixArr[M];
+  int sufLen = n - suffixArr[M];
+  int i = * k;
+  while (i < m && i < sufLen && pat[i] == suf[i])
+    i++;
+  * k = i;
+  if (i == m)
+    return upper;
+  if (i == sufLen)
+    return 1;
+  return (unsigned char) pat[i] > (unsigned char) suf[i];
+}
+
+/* Finds the bound for pat knowing every SA position before start
+   goes right, by galloping from start and then binary searching.
+   Characters shared with both ends of the bracket are skipped. */
+static int gallopBound(const char * txt,
+  const int * suffixArr, int n,
+    const char * pat, int m, int upper, int start) {
+  int L = start - 1, R = start;
+  int l = 0, r = 0, step = 1;
+
+  // Gallop: probe start, start + 1, start + 3, start + 7, ...
+  while (R < n) {
+    int k = 0;
+    if (!goesRight(txt, suffixArr, n, R, pat, m, upper, & k)) {
+      r = k;
+      break;
+    }
+    L = R;
+    l = k;
+    R = L + step;
+    if (step < n)
+      step *= 2;
+  }
+  if (R > n) {
+    R = n;
+    r = 0;
+  }
+
+  // Binary search inside (L, R)
+  while (R - L > 1) {
+    int M = L + (R - L) / 2;
+    int k = l < r ? l : r;
+    if (goesRight(txt, suffixArr, n, M, pat, m, upper, & k)) {
+      L = M;
+      l = k;
+    } else {
+      R = M;
+      r = k;
+    }
+  }
+  return R;
+}
+
+typedef struct {
+  const char * txt;
+  const int * suffixArr;
+  int n;
+  const LCPLR * lr;
+  const BatchPattern * pats; // this shard, already sorted
+  int count;
+  SAInterval * out;
+}
+BatchShard;
+
+/* Answers one shard of sorted patterns, sharing lower bounds */
+static void * searchShard(void * arg) {
+  BatchShard * sh = arg;
+  int prevLo = 0;
+
+  for (int i = 0; i < sh -> count; i++) {
+    const char * pat = sh -> pats[i].pat;
+    int m = strlen(pat);
+    SAInterval * iv = & sh -> out[sh -> pats[i].id];
+
+    if (i == 0) { // no previous bound yet: full LCP-LR search
+      iv -> lo = boundSearch(sh -> txt, sh -> suffixArr, sh -> n, sh -> lr,
+        pat, m, 0);
+      iv -> hi = boundSearch(sh -> txt, sh -> suffixArr, sh -> n, sh -> lr,
+        pat, m, 1);
+    } else {
+      iv -> lo = gallopBound(sh -> txt, sh -> suffixArr, sh -> n, pat, m, 0,
+        prevLo);
+      iv -> hi = gallopBound(sh -> txt, sh -> suffixArr, sh -> n, pat, m, 1,
+        iv -> lo);
+    }
+    prevLo = iv -> lo;
+  }
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: findIntervalsBatch
+   PURPOSE : Finds the SA interval of every pattern in pats[0..count-1].
+             out[i] receives the interval of pats[i]. threads > 1 splits
+             the sorted patterns into that many shards searched in
+             parallel; the result does not depend on the thread count.
+             If a thread cannot be started its shard runs inline.
+   Returns : 0 on success, -1 if memory is unavailable.
+   ------------------------------------------------------------------------- */
+int findIntervalsBatch(const char * txt,
+  const int * suffixArr, int n,
+    const LCPLR * lr,
+      const char *
+        const * pats, int count, SAInterval * out, int threads) {
+  if (count <= 0)
+    return 0;
+  if (threads < 1)
+    threads = 1;
+  if (threads > count)
+    threads = count;
+
+  BatchPattern * sorted = malloc(count * sizeof(BatchPattern));
+  BatchShard * shards = malloc(threads * sizeof(BatchShard));
+  pthread_t * tids = malloc(threads * sizeof(pthread_t));
+  if (sorted == NULL || shards == NULL || tids == NULL) {
+    free(sorted);
+    free(shards);
+    free(tids);
+    return -1;
+  }
+
+  for (int i = 0; i < count; i++) {
+    sorted[i].pat = pats[i];
+    sorted[i].id = i;
+  }
+  qsort(sorted, count, sizeof(BatchPattern), cmpBatchPattern);
+
+  // Contiguous shards of the sorted order
+  for (int t = 0; t < threads; t++) {
+    int begin = (int)((long long) count * t / threads);
+    int end = (int)((long long) count * (t + 1) / threads);
+    shards[t].txt = txt;
+    shards[t].suffixArr = suffixArr;
+    shards[t].n = n;
+    shards[t].lr = lr;
+    shards[t].pats = sorted + begin;
+    shards[t].count = end - begin;
+    shards[t].out = out;
+  }
+
+  int started = 0;
+  for (int t = 1; t < threads; t++) {
+    if (pthread_create( & tids[t], NULL, searchShard, & shards[t]) != 0)
+      break;
+    started = t;
+  }
+  searchShard( & shards[0]); // the calling thread takes shard 0
+  for (int t = 1; t <= started; t++)
+    pthread_join(tids[t], NULL);
+
+  // Shards that could not get a thread are done here
+  for (int t = started + 1; t < threads; t++)
+    searchShard( & shards[t]);
+
+  free(sorted);
+  free(shards);
+  free(tids);
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   REPEAT ANALYSIS
+   All of these need only the suffix array and the LCP array and run in
+   a single linear pass.
+
+   LCP intervals: a range [lb, rb] of the suffix array whose suffixes all
+   share a prefix of length ℓ (and which cannot be extended) is an
+   "ℓ-interval". Each one is a repeated substring that occurs exactly
+   rb - lb + 1 times. Walking the LCP array with a stack of open
+   intervals visits every one of them in O(n) total.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  int pos; // one starting position of the repeat
+  int len; // its length
+  int freq; // number of occurrences
+}
+Repeat;
+
+/* -------------------------------------------------------------------------
+   FUNCTION: longestRepeat
+   PURPOSE : Longest substring occurring at least twice: the largest LCP
+             value. Returns its length (0 if nothing repeats); *pos gets
+             one of its starting positions.
+   ------------------------------------------------------------------------- */
+int longestRepeat(const int * suffixArr,
+  const int * lcp, int n, int * pos) {
+  int best = 0;
+  * pos = -1;
+  for (int i = 0; i + 1 < n; i++)
+    if (lcp[i] > best) {
+      best = lcp[i];
+      * pos = suffixArr[i];
+    }
+  return best;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: countDistinctSubstrings
+   PURPOSE : Every suffix of length L contributes L prefixes, of which the
+             first lcp-with-its-predecessor were already counted:
+                 distinct = n(n+1)/2 - Σ lcp[i]
+   ------------------------------------------------------------------------- */
+long long countDistinctSubstrings(const int * lcp, int n) {
+  long long total = (long long) n * (n + 1) / 2;
+  for (int i = 0; i + 1 < n; i++)
+    total -= lcp[i];
+  return total;
+}
+
+/* Heap order for the top-k selection: "worse" repeats sit on top */
+static int repeatWorse(const Repeat * a,
+  const Repeat * b) {
+  if (a -> freq != b -> freq)
+    return a -> freq < b -> freq;
+  if (a -> len != b -> len)
+    return a -> len < b -> len;
+  return a -> pos > b -> pos;
+}
+
+static void repeatSiftDown(Repeat * h, int size, int i) {
+  for (;;) {
+    int w = i, l = 2 * i + 1, r = l + 1;
+    if (l < size && repeatWorse( & h[l], & h[w])) w = l;
+    if (r < size && repeatWorse( & h[r], & h[w])) w = r;
+    if (w == i)
+      return;
+    Repeat t = h[i];
+    h[i] = h[w];
+    h[w] = t;
+    i = w;
+  }
+}
+
+static void repeatSiftUp(Repeat * h, int i) {
+  while (i > 0 && repeatWorse( & h[i], & h[(i - 1) / 2])) {
+    Repeat t = h[i];
+    h[i] = h[(i - 1) / 2];
+    h[(i - 1) / 2] = t;
+    i = (i - 1) / 2;
+  }
+}
+
+/* Offers one candidate to the size-k min-heap of best repeats */
+static void offerRepeat(Repeat * heap, int * size, int k, Repeat cand) {
+  if ( * size < k) {
+    heap[( * size)++] = cand;
+    repeatSiftUp(heap, * size - 1);
+  } else if (repeatWorse( & heap[0], & cand)) {
+    heap[0] = cand;
+    repeatSiftDown(heap, * size, 0);
+  }
+}
+
+static int cmpRepeatBest(const void * a,
+  const void * b) {
+  const Repeat * x = a, * y = b;
+  if (repeatWorse(x, y)) return 1;
+  if (repeatWorse(y, x)) return -1;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: topKRepeats
+   PURPOSE : The k most frequent repeated substrings of length ≥ minLen.
+             Each LCP interval is reported once, by its longest substring
+             (every shorter prefix down to the parent interval's length
+             occurs exactly as often). Ties prefer longer repeats.
+             out must hold k entries; they are written best first.
+   Returns : Number of repeats written (≤ k).
+   ------------------------------------------------------------------------- */
+int topKRepeats(const int * suffixArr,
+  const int * lcp, int n, int k, int minLen, Repeat * out) {
+  if (k <= 0 || n < 2)
+    return 0;
+  if (minLen < 1)
+    minLen = 1;
+
+  // Stack of open intervals: (lcp value, left boundary)
+  int * stLcp = malloc(n * sizeof(int));
+  int * stLb = malloc(n * sizeof(int));
+  int top = 0, size = 0;
+  stLcp[0] = 0;
+  stLb[0] = 0;
+
+  for (int i = 1; i <= n; i++) {
+    int h = (i < n) ? lcp[i - 1] : 0; // LCP of SA[i - 1] and SA[i]
+    int lb = i - 1;
+
+    // Close every interval deeper than h; it ends at i - 1
+    while (h < stLcp[top]) {
+      int ell = stLcp[top];
+      lb = stLb[top];
+      top--;
+      if (ell >= minLen) {
+        Repeat r = {
+          suffixArr[lb],
+          ell,
+          i - lb
+        };
+        offerRepeat(out, & size, k, r);
+      }
+    }
+    if (h > stLcp[top]) {
+      top++;
+      stLcp[top] = h;
+      stLb[top] = lb;
+    }
+  }
+
+  free(stLcp);
+  free(stLb);
+  qsort(out, size, sizeof(Repeat), cmpRepeatBest);
+  return size;
+}
+
+/* -------------------------------------------------------------------------
+   LONGEST COMMON EXTENSIONS
+   The LCP array only holds the common prefix of neighbours in suffix
+   array order. That of any two suffixes i and j is the minimum of
+   lcp[] between their rows:
+       LCE(i, j) = min lcp[r] for rank[i] <= r < rank[j]   (rank[i] < rank[j])
+   so one range-minimum query over lcp[] and the inverse suffix array
+   answer it in O(1), where comparing characters costs O(LCE).
+
+   The range minimum is block-decomposed, in O(n) space:
+     - blocks of RMQ_BLOCK = 32 rows; inside a block, mask[j] has a bit
+       for every row of the block up to j that is still a candidate
+       minimum of a range ending at j (the stack of smaller values a
+       left-to-right scan keeps), so the minimum of [i, j] is the lowest
+       bit of mask[j] at or above i: one shift and one count of trailing
+       zeros;
+     - a sparse table over the minimum of every block answers the whole
+       blocks in between with two lookups.
+   That is 4 bytes a row for the masks plus (n / 32) log(n / 32) ints.
+   ------------------------------------------------------------------------- */
+#define RMQ_BLOCK 32
+
+typedef struct {
+  const int * val;
+  int n;
+  uint32_t * mask;
+  int blocks;
+  int levels;
+  int ** sparse; // sparse[k][b] = row of the min over blocks b .. b + 2^k - 1
+}
+RangeMin;
+
+/* Row of the leftmost minimum of val[i..j], i <= j in the same block */
+static inline int rmqInBlock(const RangeMin * rm, int i, int j) {
+  int base = i & ~(RMQ_BLOCK - 1);
+  return base + __builtin_ctz(rm -> mask[j] & (~0u << (i - base)));
+}
+
+static inline int rmqBetter(const RangeMin * rm, int a, int b) {
+  return rm -> val[b] < rm -> val[a] ? b : a;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildRangeMin
+   PURPOSE : Range-minimum structure over val[0..n-1]; val must outlive
+             it and is not copied.
+   ------------------------------------------------------------------------- */
+RangeMin buildRangeMin(const int * val, int n) {
+  RangeMin rm;
+  rm.val = val;
+  rm.n = n;
+  rm.mask = malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+  for (int base = 0; base < n; base += RMQ_BLOCK) {
+    int end = base + RMQ_BLOCK < n ? base + RMQ_BLOCK : n;
+    uint32_t stack = 0;
+    for (int j = base; j < end; j++) {
+      while (stack != 0 && val[base + 31 - __builtin_clz(stack)] > val[j])
+        stack &= ~(1u << (31 - __builtin_clz(stack)));
+      stack |= 1u << (j - base);
+      rm.mask[j] = stack;
+    }
+  }
+
+  rm.blocks = (n + RMQ_BLOCK - 1) / RMQ_BLOCK;
+  rm.levels = 1;
+  while ((1 << rm.levels) <= rm.blocks)
+    rm.levels++;
+  rm.sparse = malloc(rm.levels * sizeof(int * ));
+  rm.sparse[0] = malloc((rm.blocks > 0 ? rm.blocks : 1) * sizeof(int));
+  for (int b = 0; b < rm.blocks; b++) {
+    int last = (b + 1) * RMQ_BLOCK - 1;
+    rm.sparse[0][b] = rmqInBlock( & rm, b * RMQ_BLOCK,
+      last < n ? last : n - 1);
+  }
+  for (int k = 1; k < rm.levels; k++) {
+    int span = 1 << (k - 1), count = rm.blocks - 2 * span + 1;
+    rm.sparse[k] = malloc((count > 0 ? count : 1) * sizeof(int));
+    for (int b = 0; b < count; b++)
+      rm.sparse[k][b] = rmqBetter( & rm, rm.sparse[k - 1][b],
+        rm.sparse[k - 1][b + span]);
+  }
+  return rm;
+}
+
+/* Row of the leftmost minimum of val[a..b-1], a < b, in O(1) */
+int rmqArgmin(const RangeMin * rm, int a, int b) {
+  int j = b - 1;
+  int ba = a / RMQ_BLOCK, bb = j / RMQ_BLOCK;
+  if (ba == bb)
+    return rmqInBlock(rm, a, j);
+
+  int best = rmqInBlock(rm, a, ba * RMQ_BLOCK + RMQ_BLOCK - 1);
+  if (bb - ba > 1) {
+    int from = ba + 1, whole = bb - from;
+    int k = 31 - __builtin_clz(whole);
+    best = rmqBetter(rm, best, rmqBetter(rm, rm -> sparse[k][from],
+      rm -> sparse[k][bb - (1 << k)]));
+  }
+  return rmqBetter(rm, best, rmqInBlock(rm, bb * RMQ_BLOCK, j));
+}
+
+void freeRangeMin(RangeMin * rm) {
+  for (int k = 0; k < rm -> levels; k++)
+    free(rm -> sparse[k]);
+  free(rm -> sparse);
+  free(rm -> mask);
+  memset(rm, 0, sizeof( * rm));
+}
+
+typedef struct {
+  int n;
+  const int * lcp;
+  int * rank; // inverse suffix array
+  RangeMin rmq;
+}
+LCEIndex;
+
+LCEIndex buildLCEIndex(const int * suffixArr,
+  const int * lcp, int n) {
+  LCEIndex lce;
+  lce.n = n;
+  lce.lcp = lcp;
+  lce.rank = malloc((n > 0 ? n : 1) * sizeof(int));
+  for (int r = 0; r < n; r++)
+    lce.rank[suffixArr[r]] = r;
+  // lcp[n - 1] is never part of a range
+  lce.rmq = buildRangeMin(lcp, n > 1 ? n - 1 : 0);
+  return lce;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: lceQuery
+   PURPOSE : Length of the longest common prefix of the suffixes at text
+             positions i and j, in O(1). LCE(i, i) is the length of the
+             suffix, n - i.
+   ------------------------------------------------------------------------- */
+int lceQuery(const LCEIndex * lce, int i, int j) {
+  if (i == j)
+    return lce -> n - i;
+  int a = lce -> rank[i], b = lce -> rank[j];
+  if (a > b) {
+    int t = a;
+    a = b;
+    b = t;
+  }
+  return lce -> lcp[rmqArgmin( & lce -> rmq, a, b)];
+}
+
+void freeLCEIndex(LCEIndex * lce) {
+  freeRangeMin( & lce -> rmq);
+  free(lce -> rank);
+  lce -> rank = NULL;
+}
+
+/* -------------------------------------------------------------------------
+   LEMPEL-ZIV FACTORIZATION
+   LZ77 cuts the text into phrases, each either the longest prefix of the
+   rest that also starts somewhere earlier (a copy: distance back and
+   length; the source may overlap the phrase) or, if there is none, one
+   literal byte. The number of phrases z measures how repetitive a text
+   is, and the phrases are a compressed form of it.
+
+   Among all earlier positions, the one sharing the longest prefix with
+   position i is one of its two neighbours in suffix array order that
+   are smaller than i (Kärkkäinen, Kempa & Puglisi):
+       psv[i] = SA value of the nearest row above rank[i] with SA < i
+       nsv[i] = the same below
+   One stack pass over the suffix array gives both for every position.
+   Comparing i with both candidates costs at most twice the phrase length,
+   so the whole factorization is O(n) after the suffix array.
+
+   Container (little-endian varints, LEB128):
+       LZ_MAGIC, n as 8 bytes, number of phrases as 8 bytes
+       per phrase: len; then the literal byte if len is 0, else distance
+   Decompression is one forward copy loop over the phrases.
+   ------------------------------------------------------------------------- */
+#define LZ_MAGIC "SALZ77\0\0"
+
+typedef struct {
+  int len; // 0 for a literal
+  int src; // source position, or the literal byte when len is 0
+}
+LZPhrase;
+
+/* -------------------------------------------------------------------------
+   FUNCTION: lzFactorize
+   PURPOSE : LZ77 factorization of txt from its suffix array.
+   Returns : the number of phrases; *out gets them (free() it).
+   ------------------------------------------------------------------------- */
+int lzFactorize(const char * txt, int n,
+  const int * suffixArr, LZPhrase ** out) {
+  int * psv = malloc((n > 0 ? n : 1) * sizeof(int));
+  int * nsv = malloc((n > 0 ? n : 1) * sizeof(int));
+  int * stack = malloc((n > 0 ? n : 1) * sizeof(int));
+  int top = 0;
+  for (int r = 0; r < n; r++) {
+    int p = suffixArr[r];
+    while (top > 0 && stack[top - 1] > p)
+      nsv[stack[--top]] = p;
+    psv[p] = top > 0 ? stack[top - 1] : -1;
+    stack[top++] = p;
+  }
+  while (top > 0)
+    nsv[stack[--top]] = -1;
+  free(stack);
+
+  int count = 0, cap = 1024;
+  LZPhrase * ph = malloc(cap * sizeof(LZPhrase));
+  for (int i = 0; i < n;) {
+    int best = 0, src = 0;
+    for (int c = 0; c < 2; c++) {
+      int j = c == 0 ? psv[i] : nsv[i];
+      if (j < 0)
+        continue;
+      int k = 0;
+      while (i + k < n && txt[j + k] == txt[i + k])
+        k++;
+      if (k > best) {
+        best = k;
+        src = j;
+      }
+    }
+    if (count == cap) {
+      cap *= 2;
+      ph = realloc(ph, cap * sizeof(LZPhrase));
+    }
+    ph[count].len = best;
+    ph[count].src = best > 0 ? src : (unsigned char) txt[i];
+    count++;
+    i += best > 0 ? best : 1;
+  }
+
+  free(psv);
+  free(nsv);
+  * out = ph;
+  return count;
+}
+
+static int varintSize(uint64_t v) {
+  int s = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    s++;
+  }
+  return s;
+}
+
+static void putVarint(FILE * fp, uint64_t v) {
+  while (v >= 0x80) {
+    putc((int)(v & 0x7f) | 0x80, fp);
+    v >>= 7;
+  }
+  putc((int) v, fp);
+}
+
+/* Returns 0, or -1 at end of file or on an overlong varint */
+static int getVarint(FILE * fp, uint64_t * v) {
+  * v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = getc(fp);
+    if (c == EOF)
+      return -1;
+    * v |= (uint64_t)(c & 0x7f) << shift;
+    if (c < 0x80)
+      return 0;
+  }
+  return -1;
+}
+
+static void putU64(FILE * fp, uint64_t v) {
+  for (int b = 0; b < 8; b++)
+    putc((int)(v >> (8 * b)) & 0xff, fp);
+}
+
+static int getU64(FILE * fp, uint64_t * v) {
+  * v = 0;
+  for (int b = 0; b < 8; b++) {
+    int c = getc(fp);
+    if (c == EOF)
+      return -1;
+    * v |= (uint64_t) c << (8 * b);
+  }
+  return 0;
+}
+
+/* Size in bytes of the container for these phrases */
+long long lzContainerSize(const LZPhrase * ph, int count) {
+  long long size = 8 + 8 + 8;
+  for (int k = 0, i = 0; k < count; k++) {
+    size += varintSize(ph[k].len);
+    size += ph[k].len == 0 ? 1 : varintSize(i - ph[k].src);
+    i += ph[k].len > 0 ? ph[k].len : 1;
+  }
+  return size;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: lzSave
+   PURPOSE : Writes the phrases of a text of n bytes as a container.
+   Returns : 0 on success, -1 on error (a message is printed).
+   ------------------------------------------------------------------------- */
+int lzSave(const char * path, int n,
+  const LZPhrase * ph, int count) {
+  FILE * fp = fopen(path, "wb");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  fwrite(LZ_MAGIC, 1, 8, fp);
+  putU64(fp, (uint64_t) n);
+  putU64(fp, (uint64_t) count);
+  for (int k = 0, i = 0; k < count; k++) {
+    putVarint(fp, (uint64_t) ph[k].len);
+    if (ph[k].len == 0)
+      putc(ph[k].src, fp);
+    else
+      putVarint(fp, (uint64_t)(i - ph[k].src));
+    i += ph[k].len > 0 ? ph[k].len : 1;
+  }
+  int err = ferror(fp);
+  if (fclose(fp) != 0 || err) {
+    fprintf(stderr, "%s: write failed\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: lzUnpack
+   PURPOSE : Decompresses a container to out, one phrase at a time: a
+             literal is stored, a copy is copied forward from the text
+             already rebuilt (byte by byte when it overlaps itself).
+   Returns : 0 on success, -1 on error (a message is printed).
+   ------------------------------------------------------------------------- */
+int lzUnpack(const char * path, FILE * out) {
+  FILE * fp = fopen(path, "rb");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  char magic[8];
+  uint64_t n, count;
+  if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, LZ_MAGIC, 8) != 0 ||
+    getU64(fp, & n) != 0 || getU64(fp, & count) != 0 || n > INT32_MAX ||
+    count > n) {
+    fprintf(stderr, "%s: not an LZ77 container\n", path);
+    fclose(fp);
+    return -1;
+  }
+
+  char * txt = malloc(n + 1);
+  uint64_t pos = 0;
+  const char * problem = txt == NULL ? "out of memory" : NULL;
+  for (uint64_t k = 0; k < count && problem == NULL; k++) {
+    uint64_t len, dist;
+    if (getVarint(fp, & len) != 0 || len > n - pos) {
+      problem = "truncated or corrupt container";
+    } else if (len == 0) {
+      int c = getc(fp);
+      if (c == EOF || pos == n)
+        problem = "truncated or corrupt container";
+      else
+        txt[pos++] = (char) c;
+    } else if (getVarint(fp, & dist) != 0 || dist == 0 || dist > pos) {
+      problem = "truncated or corrupt container";
+    } else {
+      char * dst = txt + pos;
+      const char * src = dst - dist;
+      if (dist >= len)
+        memcpy(dst, src, len);
+      else
+        for (uint64_t b = 0; b < len; b++)
+          dst[b] = src[b];
+      pos += len;
+    }
+  }
+  if (problem == NULL && pos != n)
+    problem = "truncated or corrupt container";
+  fclose(fp);
+
+  if (problem == NULL && fwrite(txt, 1, n, out) != n)
+    problem = "write failed";
+  if (problem != NULL)
+    fprintf(stderr, "%s: %s\n", path, problem);
+  free(txt);
+  return problem == NULL ? 0 : -1;
+}
+
+/* -------------------------------------------------------------------------
+   ON-DISK INDEX FORMAT (version 1)
+   Saving the index once lets later runs skip construction entirely.
+
+     offset 0          : IndexHeader
+     header.txtOffset  : text bytes followed by '\0'
+     header.saOffset   : n × int32 suffix array
+     header.lcpOffset  : n × int32 LCP array
+
+   Every section starts on an 8-byte boundary so the arrays can be used
+   straight from the mapping. Integers are stored in host byte order;
+   byteOrder detects a file written on a machine with the other order.
+   ------------------------------------------------------------------------- */
+#define INDEX_MAGIC "SAIDX\0\0\0"
+#define INDEX_VERSION 1
+#define INDEX_BYTE_ORDER 0x01020304u
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t n;
+  uint64_t txtOffset;
+  uint64_t saOffset;
+  uint64_t lcpOffset;
+  uint64_t fileSize;
+}
+IndexHeader;
+
+/* -------------------------------------------------------------------------
+   STRUCTURE: a suffix index ready for queries.
+   When loaded from disk all pointers refer into one read-only mapping,
+   so several processes opening the same file share it via the page cache.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  const char * txt;
+  int n;
+  const int * suffixArr;
+  const int * lcp;
+  void * map; // start of the mapping, NULL if not loaded from disk
+  size_t mapSize;
+}
+SuffixIndex;
+
+/* Rounds x up to the next multiple of 8 */
+static uint64_t align8(uint64_t x) {
+  return (x + 7) & ~(uint64_t) 7;
+}
+
+/* Writes len bytes, then zero padding up to the aligned offset */
+static int writeSection(FILE * fp, const void * data, uint64_t len,
+  uint64_t alignedLen) {
+  static const char zeros[8] = {
+    0
+  };
+  if (len > 0 && fwrite(data, 1, len, fp) != len)
+    return -1;
+  if (alignedLen > len && fwrite(zeros, 1, alignedLen - len, fp) !=
+    alignedLen - len)
+    return -1;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: saveIndex
+   PURPOSE : Writes text, suffix array and LCP array to a versioned file.
+   Returns : 0 on success, -1 on error.
+   ------------------------------------------------------------------------- */
+int saveIndex(const char * path,
+  const char * txt, int n,
+    const int * suffixArr,
+      const int * lcp) {
+  IndexHeader h;
+  memset( & h, 0, sizeof(h));
+  memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+  h.version = INDEX_VERSION;
+  h.byteOrder = INDEX_BYTE_ORDER;
+  h.n = (uint64_t) n;
+  h.txtOffset = align8(sizeof(IndexHeader));
+  h.saOffset = h.txtOffset + align8((uint64_t) n + 1);
+  h.lcpOffset = h.saOffset + align8((uint64_t) n * sizeof(int32_t));
+  h.fileSize = h.lcpOffset + align8((uint64_t) n * sizeof(int32_t));
+
+  FILE * fp = fopen(path, "wb");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  int err = writeSection(fp, & h, sizeof(h), h.txtOffset) ||
+    writeSection(fp, txt, (uint64_t) n + 1, h.saOffset - h.txtOffset) ||
+    writeSection(fp, suffixArr, (uint64_t) n * sizeof(int32_t),
+      h.lcpOffset - h.saOffset) ||
+    writeSection(fp, lcp, (uint64_t) n * sizeof(int32_t),
+      h.fileSize - h.lcpOffset);
+
+  if (fclose(fp) != 0)
+    err = 1;
+  if (err) {
+    fprintf(stderr, "%s: write failed\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: loadIndex
+   PURPOSE : Maps an index file read-only and validates its header.
+             No data is copied; pages are read lazily by the kernel.
+   Returns : 0 on success, -1 on error (a message is printed).
+   ------------------------------------------------------------------------- */
+int loadIndex(const char * path, SuffixIndex * idx) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, & st) != 0 || st.st_size < (off_t) sizeof(IndexHeader)) {
+    fprintf(stderr, "%s: not a suffix index\n", path);
+    close(fd);
+    return -1;
+  }
+
+  void * map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping stays valid after close
+  if (map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+
+  const IndexHeader * h = map;
+  const char * problem = NULL;
+  if (memcmp(h -> magic, INDEX_MAGIC, sizeof(h -> magic)) != 0)
+    problem = "not a suffix index";
+  else if (h -> byteOrder != INDEX_BYTE_ORDER)
+    problem = "written with a different byte order";
+  else if (h -> version != INDEX_VERSION)
+    problem = "unsupported index version";
+  else if (h -> n > INT32_MAX || h -> fileSize != (uint64_t) st.st_size ||
+    h -> lcpOffset + h -> n * sizeof(int32_t) > h -> fileSize)
+    problem = "truncated or corrupt index";
+
+  if (problem != NULL) {
+    fprintf(stderr, "%s: %s\n", path, problem);
+    munmap(map, st.st_size);
+    return -1;
+  }
+
+  idx -> map = map;
+  idx -> mapSize = st.st_size;
+  idx -> n = (int) h -> n;
+  idx -> txt = (const char * ) map + h -> txtOffset;
+  idx -> suffixArr = (const int * )((const char * ) map + h -> saOffset);
+  idx -> lcp = (const int * )((const char * ) map + h -> lcpOffset);
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: unloadIndex
+   PURPOSE : Releases an index, whether it was mapped or built in memory.
+   ------------------------------------------------------------------------- */
+void unloadIndex(SuffixIndex * idx) {
+  if (idx -> map != NULL) {
+    munmap(idx -> map, idx -> mapSize);
+  } else {
+    free((void * ) idx -> suffixArr);
+    free((void * ) idx -> lcp);
+  }
+  memset(idx, 0, sizeof( * idx));
+}
+
+/* -------------------------------------------------------------------------
+   FM-INDEX BACKEND
+   The Burrows–Wheeler transform (BWT) of the text is the character that
+   precedes each suffix in suffix array order:
+       BWT[r] = txt[SA'[r] - 1]
+   where SA' is the suffix array of txt + '$' ('$' = unique smallest
+   symbol, stored as byte 0, so the text itself must not contain '\0').
+
+   Backward search matches the pattern right to left using only
+       C[c]        = number of symbols smaller than c
+       occ(c, i)   = number of c's in BWT[0..i-1]
+   and needs O(m) rank queries whatever the length of the text.
+   The BWT is kept in a wavelet matrix: 8 bitvectors (one per bit of the
+   byte) with rank support, about 1.5 bytes per character. Every
+   sampleRate-th text position keeps its SA value so occurrences can
+   still be located by walking the LF mapping back to a sample.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  uint64_t * bits;
+  uint32_t * rank; // rank[w] = number of 1s in words before w
+  int64_t len;
+}
+RankBitvector;
+
+static void rbvInit(RankBitvector * bv, int64_t len) {
+  int64_t words = len / 64 + 1;
+  bv -> bits = calloc(words, sizeof(uint64_t));
+  bv -> rank = malloc(words * sizeof(uint32_t));
+  bv -> len = len;
+}
+
+static void rbvSet(RankBitvector * bv, int64_t i) {
+  bv -> bits[i >> 6] |= (uint64_t) 1 << (i & 63);
+}
+
+static int rbvGet(const RankBitvector * bv, int64_t i) {
+  return (bv -> bits[i >> 6] >> (i & 63)) & 1;
+}
+
+/* Fills the rank directory; call after the last rbvSet */
+static void rbvFinish(RankBitvector * bv) {
+  uint32_t sum = 0;
+  for (int64_t w = 0; w <= bv -> len / 64; w++) {
+    bv -> rank[w] = sum;
+    sum += __builtin_popcountll(bv -> bits[w]);
+  }
+}
+
+/* Number of 1s in positions [0, i) */
+static inline int64_t rbvRank1(const RankBitvector * bv, int64_t i) {
+  uint64_t mask = ((uint64_t) 1 << (i & 63)) - 1;
+  return bv -> rank[i >> 6] + __builtin_popcountll(bv -> bits[i >> 6] & mask);
+}
+
+static void rbvFree(RankBitvector * bv) {
+  free(bv -> bits);
+  free(bv -> rank);
+}
+
+typedef struct {
+  int n; // text length (the BWT has n + 1 symbols)
+  RankBitvector level[8]; // wavelet matrix, most significant bit first
+  int64_t zeros[8]; // number of 0 bits on each level
+  int64_t C[257]; // C[c] = symbols smaller than c
+  RankBitvector sampled; // 1 where a BWT row keeps its SA value
+  int * samples; // SA values of sampled rows, in row order
+  int sampleRate;
+}
+FMIndex;
+
+/* occ(c, i): occurrences of byte c in BWT[0..i-1] */
+static int64_t fmOcc(const FMIndex * fm, int c, int64_t i) {
+  int64_t p = 0;
+  for (int l = 0; l < 8; l++) {
+    const RankBitvector * bv = & fm -> level[l];
+    if ((c >> (7 - l)) & 1) {
+      p = fm -> zeros[l] + rbvRank1(bv, p);
+      i = fm -> zeros[l] + rbvRank1(bv, i);
+    } else {
+      p -= rbvRank1(bv, p);
+      i -= rbvRank1(bv, i);
+    }
+  }
+  return i - p;
+}
+
+/* BWT[r], together with occ(BWT[r], r) for the LF mapping */
+static int fmAccess(const FMIndex * fm, int64_t r, int64_t * occ) {
+  int c = 0;
+  int64_t i = r, p = 0;
+  for (int l = 0; l < 8; l++) {
+    const RankBitvector * bv = & fm -> level[l];
+    int b = rbvGet(bv, i);
+    c = (c << 1) | b;
+    if (b) {
+      p = fm -> zeros[l] + rbvRank1(bv, p);
+      i = fm -> zeros[l] + rbvRank1(bv, i);
+    } else {
+      p -= rbvRank1(bv, p);
+      i -= rbvRank1(bv, i);
+    }
+  }
+  // i and p were mapped like in fmOcc(), so i - p = occ(c, r)
+  * occ = i - p;
+  return c;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildFMIndex
+   PURPOSE : Derives the BWT from an existing suffix array and builds the
+             FM-index with one SA sample every sampleRate positions.
+             The suffix array can be freed afterwards.
+   ------------------------------------------------------------------------- */
+FMIndex * buildFMIndex(const char * txt, int n,
+  const int * suffixArr, int sampleRate) {
+  FMIndex * fm = calloc(1, sizeof(FMIndex));
+  int64_t rows = (int64_t) n + 1;
+  unsigned char * cur = malloc(rows), * next = malloc(rows);
+
+  if (sampleRate < 1)
+    sampleRate = 1;
+  fm -> n = n;
+  fm -> sampleRate = sampleRate;
+
+  // BWT over SA' = [n] + suffixArr; row 0 is the suffix "$"
+  cur[0] = n > 0 ? (unsigned char) txt[n - 1] : 0;
+  for (int i = 0; i < n; i++)
+    cur[i + 1] = suffixArr[i] > 0 ? (unsigned char) txt[suffixArr[i] - 1] : 0;
+
+  // C[] from symbol counts
+  int64_t freq[256] = {
+    0
+  };
+  for (int64_t r = 0; r < rows; r++)
+    freq[cur[r]]++;
+  fm -> C[0] = 0;
+  for (int c = 0; c < 256; c++)
+    fm -> C[c + 1] = fm -> C[c] + freq[c];
+
+  // Wavelet matrix: stable-partition by each bit, MSB first
+  for (int l = 0; l < 8; l++) {
+    RankBitvector * bv = & fm -> level[l];
+    int shift = 7 - l;
+    rbvInit(bv, rows);
+    int64_t z = 0;
+    for (int64_t r = 0; r < rows; r++)
+      if ((cur[r] >> shift) & 1)
+        rbvSet(bv, r);
+      else
+        z++;
+    rbvFinish(bv);
+    fm -> zeros[l] = z;
+
+    int64_t zi = 0, oi = z;
+    for (int64_t r = 0; r < rows; r++)
+      if ((cur[r] >> shift) & 1)
+        next[oi++] = cur[r];
+      else
+        next[zi++] = cur[r];
+    unsigned char * swap = cur;
+    cur = next;
+    next = swap;
+  }
+  free(cur);
+  free(next);
+
+  // Sample SA' at text positions divisible by sampleRate (and row 0)
+  rbvInit( & fm -> sampled, rows);
+  int64_t count = 0;
+  for (int64_t r = 0; r < rows; r++) {
+    int pos = r == 0 ? n : suffixArr[r - 1];
+    if (r == 0 || pos % sampleRate == 0) {
+      rbvSet( & fm -> sampled, r);
+      count++;
+    }
+  }
+  rbvFinish( & fm -> sampled);
+  fm -> samples = malloc(count * sizeof(int));
+  for (int64_t r = 0, k = 0; r < rows; r++)
+    if (rbvGet( & fm -> sampled, r))
+      fm -> samples[k++] = r == 0 ? n : suffixArr[r - 1];
+
+  return fm;
+}
+
+void freeFMIndex(FMIndex * fm) {
+  if (fm == NULL)
+    return;
+  for (int l = 0; l < 8; l++)
+    rbvFree( & fm -> level[l]);
+  rbvFree( & fm -> sampled);
+  free(fm -> samples);
+  free(fm);
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: fmFindInterval
+   PURPOSE : Backward search. Produces the same [lo, hi) suffix array
+             interval as findInterval(), in O(m) rank queries.
+   ------------------------------------------------------------------------- */
+int fmFindInterval(const FMIndex * fm,
+  const char * pat, int * lo, int * hi) {
+  int m = strlen(pat);
+  int64_t sp = 0, ep = (int64_t) fm -> n + 1; // rows of SA'
+
+  for (int k = m - 1; k >= 0 && sp < ep; k--) {
+    int c = (unsigned char) pat[k];
+    sp = fm -> C[c] + fmOcc(fm, c, sp);
+    ep = fm -> C[c] + fmOcc(fm, c, ep);
+  }
+
+  if (m == 0) { // empty pattern: every suffix of the text
+    * lo = 0;
+    * hi = fm -> n;
+  } else if (sp >= ep) {
+    * lo = * hi = 0;
+  } else { // row r of SA' is entry r - 1 of the suffix array
+    * lo = (int)(sp - 1);
+    * hi = (int)(ep - 1);
+  }
+  return * hi - * lo;
+}
+
+/* Text position of suffix array entry i, via LF steps to a sample */
+int fmLocate(const FMIndex * fm, int i) {
+  int64_t r = (int64_t) i + 1;
+  int steps = 0;
+  while (!rbvGet( & fm -> sampled, r)) {
+    int64_t occ;
+    int c = fmAccess(fm, r, & occ);
+    r = fm -> C[c] + occ; // LF(r): row of the suffix one position left
+    steps++;
+  }
+  return fm -> samples[rbvRank1( & fm -> sampled, r)] + steps;
+}
+
+/* -------------------------------------------------------------------------
+   SEARCH BACKENDS
+   One search API over either the suffix array (with LCP-LR) or the
+   FM-index. Both report the same intervals, counts and positions.
+   ------------------------------------------------------------------------- */
+typedef enum {
+  BACKEND_SUFFIX_ARRAY,
+  BACKEND_FM_INDEX
+}
+BackendKind;
+
+typedef struct {
+  BackendKind kind;
+  const SuffixIndex * idx; // BACKEND_SUFFIX_ARRAY
+  const LCPLR * lr;
+  const FMIndex * fm; // BACKEND_FM_INDEX
+}
+SearchBackend;
+
+int backendFindInterval(const SearchBackend * b,
+  const char * pat, int * lo, int * hi) {
+  if (b -> kind == BACKEND_FM_INDEX)
+    return fmFindInterval(b -> fm, pat, lo, hi);
+  return findInterval(b -> idx -> txt, b -> idx -> suffixArr, b -> idx -> n,
+    b -> lr, pat, lo, hi);
+}
+
+/* Text position of suffix array entry i */
+int backendLocate(const SearchBackend * b, int i) {
+  if (b -> kind == BACKEND_FM_INDEX)
+    return fmLocate(b -> fm, i);
+  return b -> idx -> suffixArr[i];
+}
+
+/* Same contract as searchPattern(): one match position, or -1 */
+int backendSearch(const SearchBackend * b,
+  const char * pat) {
+  if (b -> kind == BACKEND_SUFFIX_ARRAY)
+    return searchPattern(b -> idx -> txt, b -> idx -> suffixArr, b -> idx -> n,
+      pat);
+  int lo, hi;
+  if (backendFindInterval(b, pat, & lo, & hi) == 0)
+    return -1;
+  return backendLocate(b, lo);
+}
+
+int backendCount(const SearchBackend * b,
+  const char * pat) {
+  int lo, hi;
+  return backendFindInterval(b, pat, & lo, & hi);
+}
+
+/* Same contract as locateAll() */
+int * backendLocateAll(const SearchBackend * b,
+  const char * pat, int * count) {
+  int lo, hi;
+  * count = backendFindInterval(b, pat, & lo, & hi);
+  if ( * count == 0)
+    return NULL;
+
+  int * pos = malloc( * count * sizeof(int));
+  for (int i = 0; i < * count; i++)
+    pos[i] = backendLocate(b, lo + i);
+  qsort(pos, * count, sizeof(int), cmpInt);
+  return pos;
+}
+
+/* -------------------------------------------------------------------------
+   TEXT INPUT
+   The text can be any bytes, including spaces, newlines and '\0'.
+   A regular file is read whole with several reads in flight (AsyncRead.h),
+   so the disk never waits for the page faults of a mapping; pipes and
+   terminals are read in chunks into a growing heap buffer. Either way
+   the text is followed by a '\0' so string functions never run past its
+   end.
+   ------------------------------------------------------------------------- */
+#define READ_CHUNK (1 << 20)
+#define DISPLAY_LIMIT 20 // rows of SA / LCP printed by main()
+
+typedef struct {
+  char * data;
+  int64_t n;
+  size_t mapSize; // > 0 if data is a mapping, 0 if it is on the heap
+}
+TextBuffer;
+
+/* Reads the rest of a stream (at most maxLen bytes) into buf; 0 or -1 */
+static int readStream(FILE * fp, TextBuffer * buf, int64_t maxLen) {
+  size_t len = 0, cap = READ_CHUNK;
+  char * data = malloc(cap + 1);
+  if (data == NULL)
+    return -1;
+
+  for (;;) {
+    if (cap - len < READ_CHUNK) {
+      if ((int64_t) cap >= maxLen) {
+        free(data);
+        return -1;
+      }
+      cap *= 2;
+      char * bigger = realloc(data, cap + 1);
+      if (bigger == NULL) {
+        free(data);
+        return -1;
+      }
+      data = bigger;
+    }
+    size_t got = fread(data + len, 1, READ_CHUNK, fp);
+    len += got;
+    if (got < READ_CHUNK)
+      break;
+  }
+  if (ferror(fp) || (int64_t) len > maxLen) {
+    free(data);
+    return -1;
+  }
+
+  data[len] = '\0';
+  buf -> data = data;
+  buf -> n = (int64_t) len;
+  buf -> mapSize = 0;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: readText
+   PURPOSE : Loads the text from path ("-" means standard input). Texts
+             longer than maxLen are refused: INT32_MAX for the int
+             arrays, SA40_NONE for --compact.
+   Returns : 0 on success, -1 on error (a message is printed).
+   ------------------------------------------------------------------------- */
+int readText(const char * path, TextBuffer * buf, int64_t maxLen) {
+  if (strcmp(path, "-") == 0) {
+    if (readStream(stdin, buf, maxLen) != 0) {
+      fprintf(stderr, "stdin: read failed or text too large\n");
+      return -1;
+    }
+    return 0;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, & st) == 0 && S_ISREG(st.st_mode) && st.st_size <= maxLen) {
+    unsigned char * data;
+    size_t len;
+    if (asyncReadFile(path, 0, & data, & len) == 0) {
+      // asyncReadFile leaves zero bytes after the text, its '\0'
+      close(fd);
+      buf -> data = (char * ) data;
+      buf -> n = (int64_t) len;
+      buf -> mapSize = 0;
+      return 0;
+    }
+  }
+
+  FILE * fp = fdopen(fd, "rb");
+  if (fp == NULL || readStream(fp, buf, maxLen) != 0) {
+    fprintf(stderr, "%s: read failed or text too large\n", path);
+    if (fp != NULL)
+      fclose(fp);
+    else
+      close(fd);
+    return -1;
+  }
+  fclose(fp);
+  return 0;
+}
+
+void freeText(TextBuffer * buf) {
+  if (buf -> mapSize > 0)
+    munmap(buf -> data, buf -> mapSize);
+  else
+    free(buf -> data);
+  buf -> data = NULL;
+  buf -> n = 0;
+}
+
+/* Reads one line of any length (without the newline); NULL at EOF */
+char * readLine(FILE * fp) {
+  size_t len = 0, cap = 128;
+  char * line = malloc(cap);
+  int c;
+
+  while ((c = fgetc(fp)) != EOF && c != '\n') {
+    if (len + 1 == cap) {
+      cap *= 2;
+      line = realloc(line, cap);
+    }
+    line[len++] = (char) c;
+  }
+  if (c == EOF && len == 0) {
+    free(line);
+    return NULL;
+  }
+  if (len > 0 && line[len - 1] == '\r')
+    len--;
+  line[len] = '\0';
+  return line;
+}
+
+/* -------------------------------------------------------------------------
+   DOCUMENT COLLECTIONS
+   With --docs every line of the input is a document of its own, and one
+   generalized suffix array indexes them all: the corpus is the documents
+   one after another, each ended by a '\0' that buildSuffixArrayDocs()
+   sorts as a separator unique to that document, so no match and no LCP
+   runs into the next document.
+   A text position is mapped back to its document by a rank over a
+   bitvector with a 1 at every document start (doc = rank1(pos + 1) - 1),
+   n bits plus the rank directory, and the offset by the start of that
+   document. Listing the documents that contain a pattern does not walk
+   its occurrences: prevSame[r] is the last row before r whose suffix is
+   in the same document, and a row of the SA interval [lo, hi) whose
+   prevSame is below lo is the first of its document there (Muthukrishnan).
+   The row with the smallest prevSame found by a range-minimum query is
+   such a row as long as its value is below lo, and both sides of it are
+   the same problem again, so a pattern in 3 documents costs about 7
+   range-minimum queries whether it occurs 3 times or a million.
+   ------------------------------------------------------------------------- */
+typedef struct {
+  int docs;
+  int n; // corpus length, separators included
+  int * start; // start[d] = first position of document d; start[docs] = n
+  RankBitvector starts;
+  const int * suffixArr;
+  int * prevSame;
+  RangeMin firstRows; // range minimum of prevSame
+}
+DocMap;
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildCorpus
+   PURPOSE : Splits in into documents at every '\n' (a trailing '\r' is
+             dropped, as readLine() does) and returns them as one corpus
+             in out, each document followed by a '\0'. A final newline
+             does not start an empty document.
+   Returns : the number of documents, or -1 if out of memory.
+   ------------------------------------------------------------------------- */
+int buildCorpus(const TextBuffer * in, TextBuffer * out) {
+  if ((int64_t) in -> n + 1 > INT32_MAX)
+    return -1;
+  char * data = malloc((size_t) in -> n + 2);
+  if (data == NULL)
+    return -1;
+
+  int len = 0, docs = 0, lineStart = 0;
+  for (int64_t i = 0; i < in -> n; i++) {
+    if (in -> data[i] != '\n') {
+      data[len++] = in -> data[i];
+      continue;
+    }
+    if (len > lineStart && data[len - 1] == '\r')
+      len--;
+    data[len++] = '\0';
+    lineStart = len;
+    docs++;
+  }
+  if (len > lineStart || docs == 0) { // the last line had no newline
+    if (len > lineStart && data[len - 1] == '\r')
+      len--;
+    data[len++] = '\0';
+    docs++;
+  }
+  data[len] = '\0';
+
+  out -> data = data;
+  out -> n = len;
+  out -> mapSize = 0;
+  return docs;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: buildDocMap
+   PURPOSE : The document map of a corpus from buildCorpus() and its
+             suffix array: the start bitvector, prevSame and the range
+             minimum over it. Memory: about 8n bytes for prevSame and
+             its range minimum, 1.5n bits for the bitvector.
+   ------------------------------------------------------------------------- */
+DocMap buildDocMap(const char * txt, int n, int docs,
+  const int * suffixArr) {
+  DocMap dm;
+  memset( & dm, 0, sizeof(dm));
+  dm.docs = docs;
+  dm.n = n;
+  dm.suffixArr = suffixArr;
+
+  dm.start = malloc((docs + 1) * sizeof(int));
+  rbvInit( & dm.starts, (int64_t) n + 1);
+  for (int i = 0, d = 0; i < n; i++)
+    if (i == 0 || txt[i - 1] == '\0') {
+      dm.start[d++] = i;
+      rbvSet( & dm.starts, i);
+    }
+  dm.start[docs] = n;
+  rbvFinish( & dm.starts);
+
+  int * last = malloc(docs * sizeof(int));
+  for (int d = 0; d < docs; d++)
+    last[d] = -1;
+  dm.prevSame = malloc((n > 0 ? n : 1) * sizeof(int));
+  for (int r = 0; r < n; r++) {
+    int d = (int) rbvRank1( & dm.starts, (int64_t) suffixArr[r] + 1) - 1;
+    dm.prevSame[r] = last[d];
+    last[d] = r;
+  }
+  free(last);
+
+  dm.firstRows = buildRangeMin(dm.prevSame, n);
+  return dm;
+}
+
+void freeDocMap(DocMap * dm) {
+  freeRangeMin( & dm -> firstRows);
+  free(dm -> prevSame);
+  free(dm -> start);
+  rbvFree( & dm -> starts);
+  memset(dm, 0, sizeof( * dm));
+}
+
+/* Document of text position pos, and pos's offset in it */
+int docOf(const DocMap * dm, int pos, int * offset) {
+  int d = (int) rbvRank1( & dm -> starts, (int64_t) pos + 1) - 1;
+  if (offset != NULL)
+    * offset = pos - dm -> start[d];
+  return d;
+}
+
+/* Length of the suffix at pos up to the end of its document */
+int docSuffixLength(const DocMap * dm, int pos) {
+  return dm -> start[docOf(dm, pos, NULL) + 1] - 1 - pos;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: listDocuments
+   PURPOSE : The documents with at least one suffix in rows [lo, hi) of
+             the suffix array, each once and in increasing order, without
+             visiting every row: one range-minimum query per document
+             reported plus one per empty side.
+   Returns : the number of documents; *out gets them (free() it), or NULL
+             when there are none.
+   ------------------------------------------------------------------------- */
+int listDocuments(const DocMap * dm, int lo, int hi, int ** out) {
+  * out = NULL;
+  if (lo >= hi)
+    return 0;
+
+  int found = 0, cap = 16, top = 0, stackCap = 16;
+  int * res = malloc(cap * sizeof(int));
+  int * stack = malloc(2 * stackCap * sizeof(int));
+  stack[top++] = lo;
+  stack[top++] = hi;
+  while (top > 0) {
+    int b = stack[--top], a = stack[--top];
+    int m = rmqArgmin( & dm -> firstRows, a, b);
+    if (dm -> prevSame[m] >= lo)
+      continue; // every document here was already reported
+    if (found == cap) {
+      cap *= 2;
+      res = realloc(res, cap * sizeof(int));
+    }
+    res[found++] = docOf(dm, dm -> suffixArr[m], NULL);
+    if (top + 4 > 2 * stackCap) {
+      stackCap *= 2;
+      stack = realloc(stack, 2 * stackCap * sizeof(int));
+    }
+    if (a < m) {
+      stack[top++] = a;
+      stack[top++] = m;
+    }
+    if (m + 1 < b) {
+      stack[top++] = m + 1;
+      stack[top++] = b;
+    }
+  }
+  free(stack);
+  qsort(res, found, sizeof(int), cmpInt);
+  * out = res;
+  return found;
+}
+
+/* Distinct substrings of the documents: no substring spans a separator */
+long long countDistinctSubstringsDocs(const DocMap * dm,
+  const int * lcp) {
+  long long total = 0;
+  for (int r = 0; r < dm -> n; r++)
+    total += docSuffixLength(dm, dm -> suffixArr[r]);
+  for (int r = 0; r + 1 < dm -> n; r++)
+    total -= lcp[r];
+  return total;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: runBatchFile
+   PURPOSE : Reads one pattern per line from path, answers them all with
+             findIntervalsBatch() and prints the number of matches.
+   ------------------------------------------------------------------------- */
+void runBatchFile(const char * path,
+  const SuffixIndex * idx,
+    const LCPLR * lr, int threads) {
+  FILE * fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return;
+  }
+
+  int count = 0, cap = 16;
+  char ** pats = malloc(cap * sizeof(char * ));
+  char line[1024];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (count == cap) {
+      cap *= 2;
+      pats = realloc(pats, cap * sizeof(char * ));
+    }
+    pats[count] = malloc(strlen(line) + 1);
+    strcpy(pats[count++], line);
+  }
+  fclose(fp);
+
+  SAInterval * out = malloc((count > 0 ? count : 1) * sizeof(SAInterval));
+  if (findIntervalsBatch(idx -> txt, idx -> suffixArr, idx -> n, lr,
+      (const char *
+        const * ) pats, count, out, threads) == 0) {
+    printf("\n--- Batch results ---\n");
+    for (int i = 0; i < count; i++)
+      printf("%s : %d\n", pats[i], out[i].hi - out[i].lo);
+  }
+
+  for (int i = 0; i < count; i++)
+    free(pats[i]);
+  free(pats);
+  free(out);
+}
+
+/* Asks for the pattern on stdin; "" if there is none (e.g. the text came
+   from stdin) */
+char * readPattern(void) {
+  printf("\nEnter pattern to search: ");
+  char * pat = readLine(stdin);
+  if (pat == NULL) {
+    pat = malloc(1);
+    pat[0] = '\0';
+  }
+  return pat;
+}
+
+/* -------------------------------------------------------------------------
+   FUNCTION: runCompact
+   PURPOSE : The --compact run: builds the 40-bit suffix array and the
+             byte LCP array (never the int arrays), prints the first rows
+             and the longest repeat, then answers pat and every pattern
+             of batchPath with findInterval40(). About 6 bytes per
+             character stay allocated after the build (12 during it).
+   Returns : 0, or 1 if out of memory.
+   ------------------------------------------------------------------------- */
+int runCompact(const char * txt, int64_t n,
+  const char * pat,
+    const char * batchPath) {
+  PackedSA sa = buildSuffixArray40(txt, n);
+  if (sa.data == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  ByteLCP lcp = buildLCP40(txt, & sa);
+  if (lcp.small == NULL) {
+    fprintf(stderr, "out of memory\n");
+    freePackedSA( & sa);
+    return 1;
+  }
+  printf("Compact index: SA %lld bytes, LCP %lld bytes + %lld overflow\n",
+    (long long) sa.n * SA40_BYTES, (long long) lcp.n,
+    (long long) lcp.bigCount);
+
+  int64_t shown = n < DISPLAY_LIMIT ? n : DISPLAY_LIMIT;
+  printf("\n--- Suffix Array ---\n");
+  for (int64_t i = 0; i < shown; i++) {
+    int64_t p = sa40Get(sa.data, i);
+    printf("%2lld : %.60s\n", (long long) p, txt + p);
+  }
+  if (shown < n)
+    printf("... (%lld suffixes)\n", (long long) n);
+
+  printf("\n--- LCP Array ---\n");
+  for (int64_t i = 0; i < n - 1 && i < shown; i++)
+    printf("lcp[%2lld] = %lld\n", (long long) i,
+      (long long) byteLcpGet( & lcp, i));
+
+  int64_t repPos;
+  int64_t repLen = longestRepeat40( & sa, & lcp, & repPos);
+  printf("\n--- Repeats ---\n");
+  if (repLen > 0)
+    printf("Longest repeat: \"%.*s\" (length %lld, at %lld)\n",
+      repLen < 60 ? (int) repLen : 60, txt + repPos, (long long) repLen,
+      (long long) repPos);
+
+  int64_t pos = searchPattern40(txt, & sa, pat);
+  if (pos != -1)
+    printf("✅ Pattern found at index %lld\n", (long long) pos);
+  else
+    printf("❌ Pattern not found\n");
+
+  int64_t lo, hi;
+  int64_t count = findInterval40(txt, & sa, pat, & lo, & hi);
+  int64_t * all = malloc((count > 0 ? count : 1) * sizeof(int64_t));
+  printf("Occurrences: %lld\n", (long long) count);
+  if (all != NULL) {
+    for (int64_t i = 0; i < count; i++)
+      all[i] = sa40Get(sa.data, lo + i);
+    qsort(all, count, sizeof(int64_t), cmpInt64);
+    for (int64_t i = 0; i < count; i++)
+      printf("  at index %lld\n", (long long) all[i]);
+    free(all);
+  }
+
+  FILE * fp = batchPath != NULL ? fopen(batchPath, "r") : NULL;
+  if (batchPath != NULL && fp == NULL)
+    perror(batchPath);
+  if (fp != NULL) {
+    char line[1024];
+    printf("\n--- Batch results ---\n");
+    while (fgets(line, sizeof(line), fp) != NULL) {
+      line[strcspn(line, "\r\n")] = '\0';
+      printf("%s : %lld\n", line,
+        (long long) findInterval40(txt, & sa, line, & lo, & hi));
+    }
+    fclose(fp);
+  }
+
+  freePackedSA( & sa);
+  freeByteLCP( & lcp);
+  return 0;
+}
+
+/* -------------------------------------------------------------------------
+   MAIN PROGRAM
+   ------------------------------------------------------------------------- */
+int main(int argc, char * argv[]) {
+  // Options (see the comment at the top of the file)
+  SABuildMode mode = SA_BUILD_DOUBLING;
+  const char * savePath = NULL;
+  const char * loadPath = NULL;
+  const char * batchPath = NULL;
+  const char * inputPath = NULL;
+  const char * docsPath = NULL;
+  const char * patArg = NULL;
+  const char * lzSavePath = NULL;
+  const char * lzUnpackPath = NULL;
+  int threads = 0, compact = 0, useFM = 0, lz = 0;
+  int topK = 5, minLen = 2;
+  int lceI = -1, lceJ = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sais") == 0)
+      mode = SA_BUILD_SAIS;
+    else if (strcmp(argv[i], "--parallel") == 0)
+      mode = SA_BUILD_PARALLEL;
+    else if (strcmp(argv[i], "--compact") == 0)
+      compact = 1;
+    else if (strcmp(argv[i], "--fm") == 0)
+      useFM = 1;
+    else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+      savePath = argv[++i];
+    else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+      loadPath = argv[++i];
+    else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc)
+      inputPath = argv[++i];
+    else if (strcmp(argv[i], "--docs") == 0 && i + 1 < argc)
+      docsPath = argv[++i];
+    else if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+      patArg = argv[++i];
+    else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+      topK = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--min-len") == 0 && i + 1 < argc)
+      minLen = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+      batchPath = argv[++i];
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--lz77") == 0)
+      lz = 1;
+    else if (strcmp(argv[i], "--lz77-save") == 0 && i + 1 < argc) {
+      lz = 1;
+      lzSavePath = argv[++i];
+    } else if (strcmp(argv[i], "--lz77-unpack") == 0 && i + 1 < argc)
+      lzUnpackPath = argv[++i];
+    else if (strcmp(argv[i], "--lce") == 0 && i + 2 < argc) {
+      lceI = atoi(argv[++i]);
+      lceJ = atoi(argv[++i]);
+    }
+  }
+  if (threads < 1)
+    threads = (mode == SA_BUILD_PARALLEL) ? (int) sysconf(_SC_NPROCESSORS_ONLN) :
+    1;
+  if (threads < 1)
+    threads = 1;
+  if (lzUnpackPath != NULL) // no index needed: just rebuild the text
+    return lzUnpack(lzUnpackPath, stdout) == 0 ? 0 : 1;
+  if (docsPath != NULL && (loadPath != NULL || savePath != NULL ||
+      inputPath != NULL)) {
+    fprintf(stderr,
+      "--docs cannot be combined with --load, --save or --input\n");
+    return 1;
+  }
+  if (compact && (docsPath != NULL || loadPath != NULL || savePath != NULL ||
+      useFM || lz || lceI >= 0 || lceJ >= 0)) {
+    fprintf(stderr, "--compact cannot be combined with --docs, --load, "
+      "--save, --fm, --lz77 or --lce\n");
+    return 1;
+  }
+
+  TextBuffer text;
+  memset( & text, 0, sizeof(text));
+  SuffixIndex idx;
+  memset( & idx, 0, sizeof(idx));
+  DocMap dm;
+  memset( & dm, 0, sizeof(dm));
+  int docs = 0; // > 0 when indexing a document collection
+
+  if (loadPath != NULL) {
+    // --- Load a saved index instead of building one ---
+    if (loadIndex(loadPath, & idx) != 0)
+      return 1;
+  } else {
+    if (docsPath != NULL) {
+      TextBuffer raw;
+      if (readText(docsPath, & raw, INT32_MAX) != 0)
+        return 1;
+      docs = buildCorpus( & raw, & text);
+      freeText( & raw);
+      if (docs < 0) {
+        fprintf(stderr, "%s: out of memory or text too large\n", docsPath);
+        return 1;
+      }
+    } else if (inputPath != NULL) {
+      if (readText(inputPath, & text, compact ? SA40_NONE : INT32_MAX) != 0)
+        return 1;
+    } else {
+      printf("Enter text: ");
+      text.data = readLine(stdin);
+      if (text.data == NULL)
+        return 1;
+      text.n = strlen(text.data);
+    }
+
+    if (compact) {
+      // --- The 40-bit SA / byte LCP answer everything themselves ---
+      char * pat = patArg != NULL ? NULL : readPattern();
+      int status = runCompact(text.data, text.n, patArg != NULL ? patArg :
+        pat, batchPath);
+      free(pat);
+      freeText( & text);
+      return status;
+    }
+
+    const char * txt = text.data;
+    idx.txt = txt;
+    idx.n = (int) text.n;
+
+    // --- Step 1: Build Suffix Array ---
+    int * suffixArr = docs > 0 ? buildSuffixArrayDocs(txt, idx.n, docs) :
+      buildSuffixArray(txt, idx.n, mode, threads);
+
+    // --- Step 2: Build LCP Array ---
+    if (docs > 0)
+      idx.lcp = buildLCPArrayDocs(txt, idx.n, suffixArr);
+    else if (mode == SA_BUILD_PARALLEL)
+      idx.lcp = buildLCPArrayParallel(txt, idx.n, suffixArr, threads);
+    else
+      idx.lcp = buildLCPArray(txt, idx.n, suffixArr);
+    idx.suffixArr = suffixArr;
+
+    if (docs > 0) {
+      dm = buildDocMap(txt, idx.n, docs, suffixArr);
+      printf("Documents: %d (%d bytes with separators)\n", docs, idx.n);
+    }
+
+    if (savePath != NULL && saveIndex(savePath, txt, idx.n, idx.suffixArr,
+        idx.lcp) == 0)
+      printf("Index saved to %s\n", savePath);
+  }
+
+  int n = idx.n;
+
+  // --- Display Suffix Array (first rows only for big texts) ---
+  int shown = n < DISPLAY_LIMIT ? n : DISPLAY_LIMIT;
+  printf("\n--- Suffix Array ---\n");
+  for (int i = 0; i < shown; i++)
+    printf("%2d : %.60s\n", idx.suffixArr[i], idx.txt + idx.suffixArr[i]);
+  if (shown < n)
+    printf("... (%d suffixes)\n", n);
+
+  // --- Display LCP Array ---
+  printf("\n--- LCP Array ---\n");
+  for (int i = 0; i < n - 1 && i < shown; i++)
+    printf("lcp[%2d] = %d\n", i, idx.lcp[i]);
+
+  // --- Repeat analysis on the LCP array ---
+  int repPos;
+  int repLen = longestRepeat(idx.suffixArr, idx.lcp, n, & repPos);
+  printf("\n--- Repeats ---\n");
+  if (repLen > 0 && docs > 0) {
+    int offset, d = docOf( & dm, repPos, & offset);
+    printf("Longest repeat: \"%.*s\" (length %d, doc %d, offset %d)\n",
+      repLen < 60 ? repLen : 60, idx.txt + repPos, repLen, d, offset);
+  } else if (repLen > 0)
+    printf("Longest repeat: \"%.*s\" (length %d, at %d)\n",
+      repLen < 60 ? repLen : 60, idx.txt + repPos, repLen, repPos);
+  printf("Distinct substrings: %lld\n", docs > 0 ?
+    countDistinctSubstringsDocs( & dm, idx.lcp) :
+    countDistinctSubstrings(idx.lcp, n));
+  if (topK > 0) {
+    Repeat * reps = malloc(topK * sizeof(Repeat));
+    int found = topKRepeats(idx.suffixArr, idx.lcp, n, topK, minLen, reps);
+    for (int i = 0; i < found; i++)
+      printf("%3d x \"%.*s\"\n", reps[i].freq,
+        reps[i].len < 60 ? reps[i].len : 60, idx.txt + reps[i].pos);
+    free(reps);
+  }
+
+  // --- LZ77 factorization from the suffix array ---
+  if (lz) {
+    LZPhrase * phrases;
+    int z = lzFactorize(idx.txt, n, idx.suffixArr, & phrases);
+    int literals = 0;
+    for (int i = 0; i < z; i++)
+      literals += phrases[i].len == 0;
+    long long packed = lzContainerSize(phrases, z);
+    printf("\n--- LZ77 ---\n");
+    printf("Phrases: %d (%d literals), %.2f bytes per phrase\n", z,
+      literals, z > 0 ? (double) n / z : 0.0);
+    printf("Container: %lld bytes (%.1f%% of %d)\n", packed,
+      n > 0 ? 100.0 * packed / n : 0.0, n);
+    if (lzSavePath != NULL && lzSave(lzSavePath, n, phrases, z) == 0)
+      printf("LZ77 container saved to %s\n", lzSavePath);
+    free(phrases);
+  }
+
+  // --- Step 3: Pattern Search Demo ---
+  char * pat;
+  if (patArg != NULL) {
+    pat = malloc(strlen(patArg) + 1);
+    strcpy(pat, patArg);
+  } else
+    pat = readPattern();
+
+  LCPLR lr = buildLCPLR(idx.lcp, n);
+  SearchBackend backend = {
+    BACKEND_SUFFIX_ARRAY,
+    & idx,
+    & lr,
+    NULL
+  };
+  FMIndex * fm = NULL;
+  if (useFM && docs == 0 && memchr(idx.txt, '\0', n) != NULL) {
+    printf("Text contains '\\0'; using the suffix array backend\n");
+    useFM = 0;
+  }
+  if (useFM) {
+    fm = buildFMIndex(idx.txt, n, idx.suffixArr, 32);
+    backend.kind = BACKEND_FM_INDEX;
+    backend.fm = fm;
+  }
+
+  int pos = backendSearch( & backend, pat);
+  if (pos != -1 && docs > 0) {
+    int offset, d = docOf( & dm, pos, & offset);
+    printf("✅ Pattern found in doc %d at offset %d\n", d, offset);
+  } else if (pos != -1)
+    printf("✅ Pattern found at index %d\n", pos);
+  else
+    printf("❌ Pattern not found\n");
+
+  // --- Step 4: Count and locate every occurrence ---
+  int count;
+  int * all = backendLocateAll( & backend, pat, & count);
+  printf("Occurrences: %d\n", count);
+  for (int i = 0; i < count; i++) {
+    if (docs > 0) {
+      int offset, d = docOf( & dm, all[i], & offset);
+      printf("  doc %d, offset %d\n", d, offset);
+    } else
+      printf("  at index %d\n", all[i]);
+  }
+
+  // --- Step 4b: The documents that contain the pattern, each once ---
+  if (docs > 0) {
+    int lo, hi, * list;
+    backendFindInterval( & backend, pat, & lo, & hi);
+    int found = listDocuments( & dm, lo, hi, & list);
+    printf("Documents containing \"%s\": %d\n", pat, found);
+    for (int i = 0; i < found; i++)
+      printf("  doc %d\n", list[i]);
+    free(list);
+  }
+
+  // --- Step 4c: Longest common extension of two positions ---
+  if (lceI >= 0 || lceJ >= 0) {
+    if (lceI < 0 || lceJ < 0 || lceI >= n || lceJ >= n) {
+      printf("LCE: positions must be in 0..%d\n", n - 1);
+    } else {
+      LCEIndex lce = buildLCEIndex(idx.suffixArr, idx.lcp, n);
+      int k = lceQuery( & lce, lceI, lceJ);
+      if (docs > 0 && lceI == lceJ)
+        k = docSuffixLength( & dm, lceI);
+      printf("LCE(%d, %d) = %d \"%.*s\"\n", lceI, lceJ, k,
+        k < 60 ? k : 60, idx.txt + lceI);
+      freeLCEIndex( & lce);
+    }
+  }
+
+  // --- Step 5: Batched queries from a file ---
+  if (batchPath != NULL)
+    runBatchFile(batchPath, & idx, & lr, threads);
+
+  // Free allocated memory (or unmap the loaded index)
+  free(all);
+  free(pat);
+  freeFMIndex(fm);
+  freeLCPLR( & lr);
+  if (docs > 0)
+    freeDocMap( & dm);
+  unloadIndex( & idx);
+  freeText( & text);
+
+  return 0;
+}
+
+/*
+   -------------------------------------------------------------------------
+   🧩 Example Run
+   -------------------------------------------------------------------------
+   Input:
+       text = banana
+       pattern = ana
+
+   Output:
+       --- Suffix Array ---
+        5 : a
+        3 : ana
+        1 : anana
+        0 : banana
+        4 : na
+        2 : nana
+
+       --- LCP Array ---
+       lcp[0] = 1
+       lcp[1] = 3
+       lcp[2] = 0
+       lcp[3] = 0
+       lcp[4] = 2
+
+       --- Repeats ---
+       Longest repeat: "ana" (length 3, at 3)
+       Distinct substrings: 15
+         2 x "ana"
+         2 x "na"
 
        ✅ Pattern found at index 1
+       Occurrences: 2
+         at index 1
+         at index 3
    -------------------------------------------------------------------------
 */
\ No newline at end of file
@@ -1,40 +1,125 @@
 //C program to input a matrix of order MxN and find its transpose
+//
+//Run with --bench ROWS COLS to time walking the columns against the
+//blocked transpose and the in-place ones in Transpose.h.
 
 #include <stdio.h>
-#include<conio.h>
-int main()
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Matrix.h"
+#include "Transpose.h"
+
+static double now(void)
 {
-    static int array[10][10];
-    int i, j, row, col;
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
 
-    printf("Enter the order of the matrix \n");
-    scanf("%d %d", &row, &col);
-    printf("Enter the coefficients of the matrix\n");
-    for (i = 0; i < row; ++i)
+static void print_matrix(const Matrix *m)
+{
+    size_t i, j;
+    for (i = 0; i < m->rows; ++i)
     {
-        for (j = 0; j < col; ++j)
+        for (j = 0; j < m->cols; ++j)
         {
-            scanf("%d", &array[i][j]);
+            printf(" %d", *matrixAt(m, i, j));
         }
+        printf("\n");
     }
-    printf("The given matrix is \n");
-    for (i = 0; i < row; ++i)
+}
+
+static int bench(size_t row, size_t col)
+{
+    size_t n = row * col, i, j;
+    int *a = malloc(n * sizeof *a), *b = malloc(n * sizeof *b), *c = malloc(n * sizeof *c);
+    double t0, t1, t2, t3, t4;
+    int bad = 0;
+    if (a == NULL || b == NULL || c == NULL)
     {
-        for (j = 0; j < col; ++j)
-        {
-            printf(" %d", array[i][j]);
-        }
-        printf("\n");
+        printf("Out of memory\n");
+        free(a); free(b); free(c);
+        return 1;
     }
-    printf("Transpose of matrix is \n");
+    for (i = 0; i < n; i++)
+        a[i] = (int)(i * 2654435761u);
+    memset(b, 0, n * sizeof *b);
+    memset(c, 0, n * sizeof *c);
+    t0 = now();
+    // the column walk the interactive version does
     for (j = 0; j < col; ++j)
-    {
         for (i = 0; i < row; ++i)
+            b[j * row + i] = a[i * col + j];
+    t1 = now();
+    transpose(a, c, row, col);
+    t2 = now();
+    bad |= memcmp(b, c, n * sizeof *b) != 0;
+    if (transposeInPlace(a, row, col) != 0)
+    {
+        printf("Out of memory\n");
+        free(a); free(b); free(c);
+        return 1;
+    }
+    t3 = now();
+    bad |= memcmp(a, b, n * sizeof *a) != 0;
+    // and back, through the other in-place path when it is square
+    transposeInPlace(a, col, row);
+    t4 = now();
+    transpose(a, c, row, col);
+    bad |= memcmp(b, c, n * sizeof *b) != 0;
+    printf("%zu x %zu: column walk %.3f s, blocked %.3f s, in place %.3f s, back %.3f s%s\n",
+           row, col, t1 - t0, t2 - t1, t3 - t2, t4 - t3, bad ? " MISMATCH" : "");
+    free(a); free(b); free(c);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    Matrix array, result;
+    int row, col, i, j;
+
+    if (argc == 4 && strcmp(argv[1], "--bench") == 0)
+        return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10));
+
+    printf("Enter the order of the matrix \n");
+    if (scanf("%d %d", &row, &col) != 2 || row <= 0 || col <= 0)
+    {
+        printf("Invalid order\n");
+        return 1;
+    }
+    if (matrixInit(&array, row, col) != 0)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    if (matrixInit(&result, col, row) != 0)
+    {
+        printf("Out of memory\n");
+        matrixFree(&array);
+        return 1;
+    }
+    printf("Enter the coefficients of the matrix\n");
+    for (i = 0; i < row; ++i)
+    {
+        for (j = 0; j < col; ++j)
         {
-            printf(" %d", array[i][j]);
+            if (scanf("%d", matrixAt(&array, i, j)) != 1)
+            {
+                printf("Invalid coefficient\n");
+                matrixFree(&array);
+                matrixFree(&result);
+                return 1;
+            }
         }
-        printf("\n");
     }
+    printf("The given matrix is \n");
+    print_matrix(&array);
+    transposeStrided(array.data, array.stride, result.data, result.stride, row, col);
+    printf("Transpose of matrix is \n");
+    print_matrix(&result);
 
+    matrixFree(&array);
+    matrixFree(&result);
     return 0;
 }